@@ -250,6 +250,16 @@ get_n_processing_sessions (VALUE self)
     return UINT2NUM(n_processing_sessions);
 }
 
+static VALUE
+get_n_total_processing_sessions (VALUE self)
+{
+    guint n_total_processing_sessions;
+
+    n_total_processing_sessions =
+        milter_client_context_get_n_total_processing_sessions(SELF(self));
+    return UINT2NUM(n_total_processing_sessions);
+}
+
 static VALUE
 set_packet_buffer_size (VALUE self, VALUE size)
 {
@@ -343,6 +353,8 @@ Init_milter_client_context (void)
                      get_socket_address, 0);
     rb_define_method(rb_cMilterClientContext, "n_processing_sessions",
                      get_n_processing_sessions, 0);
+    rb_define_method(rb_cMilterClientContext, "n_total_processing_sessions",
+                     get_n_total_processing_sessions, 0);
     rb_define_method(rb_cMilterClientContext, "set_packet_buffer_size",
                      set_packet_buffer_size, 1);
     rb_define_method(rb_cMilterClientContext, "packet_buffer_size",
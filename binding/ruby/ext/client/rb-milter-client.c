@@ -295,6 +295,18 @@ client_get_worker_pids (VALUE self)
     return worker_pids;
 }
 
+static VALUE
+client_get_n_total_processing_sessions (VALUE self)
+{
+    return UINT2NUM(milter_client_get_n_total_processing_sessions(SELF(self)));
+}
+
+static VALUE
+client_get_n_total_processed_sessions (VALUE self)
+{
+    return UINT2NUM(milter_client_get_n_total_processed_sessions(SELF(self)));
+}
+
 static void
 mark (gpointer data)
 {
@@ -371,6 +383,10 @@ Init_milter_client (void)
                      client_set_default_unix_socket_mode, 1);
     rb_define_method(rb_cMilterClient, "worker_pids",
                      client_get_worker_pids, 0);
+    rb_define_method(rb_cMilterClient, "n_total_processing_sessions",
+                     client_get_n_total_processing_sessions, 0);
+    rb_define_method(rb_cMilterClient, "n_total_processed_sessions",
+                     client_get_n_total_processed_sessions, 0);
     rb_define_method(rb_cMilterClient, "create_event_loop",
                      client_create_event_loop, 1);
 
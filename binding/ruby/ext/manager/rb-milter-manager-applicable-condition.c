@@ -20,6 +20,183 @@
 #include "rb-milter-manager-private.h"
 
 #define SELF(self) (MILTER_MANAGER_APPLICABLE_CONDITION(RVAL2GOBJ(self)))
+#define RVAL2RULE(rule) \
+    ((MilterManagerConditionRule *)RVAL2BOXED(rule, MILTER_TYPE_MANAGER_CONDITION_RULE))
+
+static VALUE
+rule2rval (MilterManagerConditionRule *rule)
+{
+    VALUE rb_rule;
+
+    rb_rule = BOXED2RVAL(rule, MILTER_TYPE_MANAGER_CONDITION_RULE);
+    milter_manager_condition_rule_unref(rule);
+    return rb_rule;
+}
+
+static const gchar **
+rval2strings (VALUE rb_strings)
+{
+    const gchar **strings;
+    long i, n;
+
+    rb_strings = rb_Array(rb_strings);
+    n = RARRAY_LEN(rb_strings);
+    for (i = 0; i < n; i++) {
+        Check_Type(rb_ary_entry(rb_strings, i), T_STRING);
+    }
+
+    strings = g_new0(const gchar *, n + 1);
+    for (i = 0; i < n; i++) {
+        strings[i] = RVAL2CSTR(rb_ary_entry(rb_strings, i));
+    }
+    return strings;
+}
+
+static VALUE
+rule_s_strings (VALUE klass, VALUE rb_strings)
+{
+    const gchar **strings;
+    MilterManagerConditionRule *rule;
+
+    strings = rval2strings(rb_strings);
+    rule = milter_manager_condition_rule_new_strings(strings);
+    g_free(strings);
+    return rule2rval(rule);
+}
+
+static VALUE
+rule_s_regexps (VALUE klass, VALUE rb_patterns)
+{
+    const gchar **patterns;
+    MilterManagerConditionRule *rule;
+    GError *error = NULL;
+
+    patterns = rval2strings(rb_patterns);
+    rule = milter_manager_condition_rule_new_regexps(patterns, &error);
+    g_free(patterns);
+    if (!rule)
+        RAISE_GERROR(error);
+    return rule2rval(rule);
+}
+
+static VALUE
+rule_s_networks (VALUE klass, VALUE rb_networks)
+{
+    const gchar **networks;
+    MilterManagerConditionRule *rule;
+    GError *error = NULL;
+
+    networks = rval2strings(rb_networks);
+    rule = milter_manager_condition_rule_new_networks(networks, &error);
+    g_free(networks);
+    if (!rule)
+        RAISE_GERROR(error);
+    return rule2rval(rule);
+}
+
+static VALUE
+rule_s_ipv4_address (VALUE klass)
+{
+    return rule2rval(milter_manager_condition_rule_new_ipv4_address());
+}
+
+static VALUE
+rule_s_local_address (VALUE klass)
+{
+    return rule2rval(milter_manager_condition_rule_new_local_address());
+}
+
+static VALUE
+rule_s_unknown_address (VALUE klass)
+{
+    return rule2rval(milter_manager_condition_rule_new_unknown_address());
+}
+
+static VALUE
+rule_s_macro (int argc, VALUE *argv, VALUE klass)
+{
+    VALUE name, value;
+
+    rb_scan_args(argc, argv, "11", &name, &value);
+    return rule2rval(milter_manager_condition_rule_new_macro(
+                         RVAL2CSTR(name),
+                         RVAL2CSTR_ACCEPT_NIL(value)));
+}
+
+static VALUE
+rule_s_dnsbl (VALUE klass, VALUE dnsbl)
+{
+    return rule2rval(milter_manager_condition_rule_new_dnsbl(
+                         MILTER_MANAGER_DNSBL(RVAL2GOBJ(dnsbl))));
+}
+
+static VALUE
+rule_s_and (VALUE klass, VALUE left, VALUE right)
+{
+    return rule2rval(milter_manager_condition_rule_new_and(RVAL2RULE(left),
+                                                           RVAL2RULE(right)));
+}
+
+static VALUE
+rule_s_or (VALUE klass, VALUE left, VALUE right)
+{
+    return rule2rval(milter_manager_condition_rule_new_or(RVAL2RULE(left),
+                                                          RVAL2RULE(right)));
+}
+
+static VALUE
+rule_s_not (VALUE klass, VALUE operand)
+{
+    return rule2rval(milter_manager_condition_rule_new_not(RVAL2RULE(operand)));
+}
+
+static int
+collect_macro (VALUE name, VALUE value, VALUE data)
+{
+    GHashTable *macros = (GHashTable *)data;
+
+    g_hash_table_insert(macros,
+                        g_strdup(RVAL2CSTR(name)),
+                        g_strdup(RVAL2CSTR(value)));
+    return ST_CONTINUE;
+}
+
+static VALUE
+rule_match_p (int argc, VALUE *argv, VALUE self)
+{
+    VALUE value, address, rb_macros;
+    VALUE rb_packed_address = Qnil;
+    const struct sockaddr *packed_address = NULL;
+    socklen_t packed_address_length = 0;
+    GHashTable *macros = NULL;
+    gboolean matched;
+
+    rb_scan_args(argc, argv, "12", &value, &address, &rb_macros);
+
+    if (!NIL_P(address)) {
+        if (RVAL2CBOOL(rb_obj_is_kind_of(address, rb_cString)))
+            rb_packed_address = address;
+        else
+            rb_packed_address = rb_funcall(address, rb_intern("pack"), 0);
+        packed_address = (const struct sockaddr *)RSTRING_PTR(rb_packed_address);
+        packed_address_length = RSTRING_LEN(rb_packed_address);
+    }
+
+    if (!NIL_P(rb_macros)) {
+        macros = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+        rb_hash_foreach(rb_macros, collect_macro, (VALUE)macros);
+    }
+
+    matched = milter_manager_condition_rule_match(RVAL2RULE(self),
+                                                  RVAL2CSTR_ACCEPT_NIL(value),
+                                                  packed_address,
+                                                  packed_address_length,
+                                                  macros);
+    if (macros)
+        g_hash_table_unref(macros);
+
+    return CBOOL2RVAL(matched);
+}
 
 static VALUE
 initialize (VALUE self, VALUE name)
@@ -39,10 +216,114 @@ merge (VALUE self, VALUE other)
     return self;
 }
 
+static VALUE
+set_stopper_rule (VALUE self, MilterServerContextState state, VALUE rule)
+{
+    milter_manager_applicable_condition_set_stopper_rule(
+        SELF(self),
+        state,
+        NIL_P(rule) ? NULL : RVAL2RULE(rule));
+    return rule;
+}
+
+static VALUE
+get_stopper_rule (VALUE self, MilterServerContextState state)
+{
+    MilterManagerConditionRule *rule;
+
+    rule = milter_manager_applicable_condition_get_stopper_rule(SELF(self),
+                                                                state);
+    if (!rule)
+        return Qnil;
+    return BOXED2RVAL(rule, MILTER_TYPE_MANAGER_CONDITION_RULE);
+}
+
+static VALUE
+set_connect_stopper_rule (VALUE self, VALUE rule)
+{
+    return set_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_CONNECT, rule);
+}
+
+static VALUE
+get_connect_stopper_rule (VALUE self)
+{
+    return get_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_CONNECT);
+}
+
+static VALUE
+set_helo_stopper_rule (VALUE self, VALUE rule)
+{
+    return set_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_HELO, rule);
+}
+
+static VALUE
+get_helo_stopper_rule (VALUE self)
+{
+    return get_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_HELO);
+}
+
+static VALUE
+set_envelope_from_stopper_rule (VALUE self, VALUE rule)
+{
+    return set_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM,
+                            rule);
+}
+
+static VALUE
+get_envelope_from_stopper_rule (VALUE self)
+{
+    return get_stopper_rule(self, MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM);
+}
+
+static VALUE
+set_envelope_recipient_stopper_rule (VALUE self, VALUE rule)
+{
+    return set_stopper_rule(self,
+                            MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT,
+                            rule);
+}
+
+static VALUE
+get_envelope_recipient_stopper_rule (VALUE self)
+{
+    return get_stopper_rule(self,
+                            MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT);
+}
+
 void
 Init_milter_manager_applicable_condition (void)
 {
     VALUE rb_cMilterManagerApplicableCondition;
+    VALUE rb_cMilterManagerConditionRule;
+
+    rb_cMilterManagerConditionRule =
+        G_DEF_CLASS(MILTER_TYPE_MANAGER_CONDITION_RULE,
+                    "ConditionRule", rb_mMilterManager);
+
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "strings", rule_s_strings, 1);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "regexps", rule_s_regexps, 1);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "networks", rule_s_networks, 1);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "ipv4_address", rule_s_ipv4_address, 0);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "local_address", rule_s_local_address, 0);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "unknown_address", rule_s_unknown_address, 0);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "macro", rule_s_macro, -1);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "dnsbl", rule_s_dnsbl, 1);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "and", rule_s_and, 2);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "or", rule_s_or, 2);
+    rb_define_singleton_method(rb_cMilterManagerConditionRule,
+                               "not", rule_s_not, 1);
+    rb_define_method(rb_cMilterManagerConditionRule,
+                     "match?", rule_match_p, -1);
 
     rb_cMilterManagerApplicableCondition =
 	G_DEF_CLASS(MILTER_TYPE_MANAGER_APPLICABLE_CONDITION,
@@ -52,6 +333,26 @@ Init_milter_manager_applicable_condition (void)
                      "initialize", initialize, 1);
     rb_define_method(rb_cMilterManagerApplicableCondition,
                      "merge", merge, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "connect_stopper_rule", get_connect_stopper_rule, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_connect_stopper_rule", set_connect_stopper_rule, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "helo_stopper_rule", get_helo_stopper_rule, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_helo_stopper_rule", set_helo_stopper_rule, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "envelope_from_stopper_rule",
+                     get_envelope_from_stopper_rule, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_envelope_from_stopper_rule",
+                     set_envelope_from_stopper_rule, 1);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "envelope_recipient_stopper_rule",
+                     get_envelope_recipient_stopper_rule, 0);
+    rb_define_method(rb_cMilterManagerApplicableCondition,
+                     "set_envelope_recipient_stopper_rule",
+                     set_envelope_recipient_stopper_rule, 1);
 
     G_DEF_SETTERS(rb_cMilterManagerApplicableCondition);
 }
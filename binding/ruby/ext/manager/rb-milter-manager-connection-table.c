@@ -0,0 +1,138 @@
+/* -*- c-file-style: "ruby" -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rb-milter-manager-private.h"
+
+#define SELF(self) (MILTER_MANAGER_CONNECTION_TABLE(RVAL2GOBJ(self)))
+
+static VALUE
+initialize (VALUE self)
+{
+    G_INITIALIZE(self, milter_manager_connection_table_new());
+    return Qnil;
+}
+
+static VALUE
+set_lifetime (VALUE self, VALUE lifetime)
+{
+    milter_manager_connection_table_set_lifetime(SELF(self), NUM2DBL(lifetime));
+    return self;
+}
+
+static VALUE
+get_lifetime (VALUE self)
+{
+    return rb_float_new(milter_manager_connection_table_get_lifetime(SELF(self)));
+}
+
+static VALUE
+get_source (VALUE self)
+{
+    return GENUM2RVAL(milter_manager_connection_table_get_source(SELF(self)),
+                      MILTER_TYPE_MANAGER_CONNECTION_TABLE_SOURCE);
+}
+
+static VALUE
+get_size (VALUE self)
+{
+    return UINT2NUM(milter_manager_connection_table_get_size(SELF(self)));
+}
+
+static VALUE
+update (VALUE self)
+{
+    GError *error = NULL;
+
+    if (!milter_manager_connection_table_update(SELF(self), &error))
+        RAISE_GERROR(error);
+
+    return self;
+}
+
+static VALUE
+ensure_updated (VALUE self)
+{
+    return CBOOL2RVAL(milter_manager_connection_table_ensure_updated(SELF(self)));
+}
+
+static VALUE
+purge (VALUE self)
+{
+    milter_manager_connection_table_purge(SELF(self));
+    return self;
+}
+
+static VALUE
+lookup (VALUE self, VALUE address)
+{
+    VALUE rb_packed_address;
+    MilterManagerConnectionState state;
+    struct sockaddr *local_address = NULL;
+    socklen_t local_address_length = 0;
+
+    if (RVAL2CBOOL(rb_obj_is_kind_of(address, rb_cString)))
+        rb_packed_address = address;
+    else
+        rb_packed_address = rb_funcall(address, rb_intern("pack"), 0);
+
+    state = milter_manager_connection_table_lookup(
+        SELF(self),
+        (const struct sockaddr *)RSTRING_PTR(rb_packed_address),
+        RSTRING_LEN(rb_packed_address),
+        &local_address,
+        &local_address_length);
+    if (state == MILTER_MANAGER_CONNECTION_STATE_UNKNOWN)
+        return Qnil;
+
+    return rb_ary_new3(2,
+                       GENUM2RVAL(state, MILTER_TYPE_MANAGER_CONNECTION_STATE),
+                       ADDRESS2RVAL_FREE(local_address, local_address_length));
+}
+
+void
+Init_milter_manager_connection_table (void)
+{
+    VALUE rb_cMilterManagerConnectionTable;
+
+    rb_cMilterManagerConnectionTable =
+        G_DEF_CLASS(MILTER_TYPE_MANAGER_CONNECTION_TABLE, "ConnectionTable",
+                    rb_mMilterManager);
+    G_DEF_CLASS(MILTER_TYPE_MANAGER_CONNECTION_STATE, "ConnectionState",
+                rb_mMilterManager);
+    G_DEF_CLASS(MILTER_TYPE_MANAGER_CONNECTION_TABLE_SOURCE,
+                "ConnectionTableSource", rb_mMilterManager);
+
+    rb_define_method(rb_cMilterManagerConnectionTable,
+                     "initialize", initialize, 0);
+
+    rb_define_method(rb_cMilterManagerConnectionTable,
+                     "set_lifetime", set_lifetime, 1);
+    rb_define_method(rb_cMilterManagerConnectionTable,
+                     "lifetime", get_lifetime, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable,
+                     "source", get_source, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable, "size", get_size, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable, "update", update, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable,
+                     "ensure_updated", ensure_updated, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable, "purge", purge, 0);
+    rb_define_method(rb_cMilterManagerConnectionTable, "lookup", lookup, 1);
+
+    G_DEF_SETTERS(rb_cMilterManagerConnectionTable);
+}
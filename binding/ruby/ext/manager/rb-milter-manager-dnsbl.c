@@ -0,0 +1,145 @@
+/* -*- c-file-style: "ruby" -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "rb-milter-manager-private.h"
+
+#define SELF(self) (MILTER_MANAGER_DNSBL(RVAL2GOBJ(self)))
+
+static VALUE
+initialize (VALUE self)
+{
+    G_INITIALIZE(self, milter_manager_dnsbl_new());
+    return Qnil;
+}
+
+static VALUE
+add_zone (int argc, VALUE *argv, VALUE self)
+{
+    VALUE zone, expected_network;
+    GError *error = NULL;
+
+    rb_scan_args(argc, argv, "11", &zone, &expected_network);
+    if (!milter_manager_dnsbl_add_zone(SELF(self),
+                                       RVAL2CSTR(zone),
+                                       RVAL2CSTR_ACCEPT_NIL(expected_network),
+                                       &error))
+        RAISE_GERROR(error);
+
+    return self;
+}
+
+static VALUE
+get_n_zones (VALUE self)
+{
+    return UINT2NUM(milter_manager_dnsbl_get_n_zones(SELF(self)));
+}
+
+static VALUE
+clear_zones (VALUE self)
+{
+    milter_manager_dnsbl_clear_zones(SELF(self));
+    return self;
+}
+
+static VALUE
+set_name_server (VALUE self, VALUE name_server)
+{
+    GError *error = NULL;
+
+    if (!milter_manager_dnsbl_set_name_server(SELF(self),
+                                              RVAL2CSTR_ACCEPT_NIL(name_server),
+                                              &error))
+        RAISE_GERROR(error);
+
+    return self;
+}
+
+static VALUE
+get_name_server (VALUE self)
+{
+    return CSTR2RVAL(milter_manager_dnsbl_get_name_server(SELF(self)));
+}
+
+static VALUE
+set_timeout (VALUE self, VALUE timeout)
+{
+    milter_manager_dnsbl_set_timeout(SELF(self), NUM2DBL(timeout));
+    return self;
+}
+
+static VALUE
+get_timeout (VALUE self)
+{
+    return rb_float_new(milter_manager_dnsbl_get_timeout(SELF(self)));
+}
+
+static VALUE
+set_max_cache_size (VALUE self, VALUE size)
+{
+    milter_manager_dnsbl_set_max_cache_size(SELF(self), NUM2UINT(size));
+    return self;
+}
+
+static VALUE
+get_max_cache_size (VALUE self)
+{
+    return UINT2NUM(milter_manager_dnsbl_get_max_cache_size(SELF(self)));
+}
+
+static VALUE
+get_cache_size (VALUE self)
+{
+    return UINT2NUM(milter_manager_dnsbl_get_cache_size(SELF(self)));
+}
+
+static VALUE
+clear_cache (VALUE self)
+{
+    milter_manager_dnsbl_clear_cache(SELF(self));
+    return self;
+}
+
+void
+Init_milter_manager_dnsbl (void)
+{
+    VALUE rb_cMilterManagerDNSBL;
+
+    rb_cMilterManagerDNSBL =
+        G_DEF_CLASS(MILTER_TYPE_MANAGER_DNSBL, "DNSBL", rb_mMilterManager);
+
+    rb_define_method(rb_cMilterManagerDNSBL, "initialize", initialize, 0);
+
+    rb_define_method(rb_cMilterManagerDNSBL, "add_zone", add_zone, -1);
+    rb_define_method(rb_cMilterManagerDNSBL, "n_zones", get_n_zones, 0);
+    rb_define_method(rb_cMilterManagerDNSBL, "clear_zones", clear_zones, 0);
+    rb_define_method(rb_cMilterManagerDNSBL,
+                     "set_name_server", set_name_server, 1);
+    rb_define_method(rb_cMilterManagerDNSBL,
+                     "name_server", get_name_server, 0);
+    rb_define_method(rb_cMilterManagerDNSBL, "set_timeout", set_timeout, 1);
+    rb_define_method(rb_cMilterManagerDNSBL, "timeout", get_timeout, 0);
+    rb_define_method(rb_cMilterManagerDNSBL,
+                     "set_max_cache_size", set_max_cache_size, 1);
+    rb_define_method(rb_cMilterManagerDNSBL,
+                     "max_cache_size", get_max_cache_size, 0);
+    rb_define_method(rb_cMilterManagerDNSBL, "cache_size", get_cache_size, 0);
+    rb_define_method(rb_cMilterManagerDNSBL, "clear_cache", clear_cache, 0);
+
+    G_DEF_SETTERS(rb_cMilterManagerDNSBL);
+}
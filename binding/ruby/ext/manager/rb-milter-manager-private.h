@@ -31,6 +31,8 @@ extern void Init_milter_manager_gstring (void);
 extern void Init_milter_manager_configuration (void);
 extern void Init_milter_manager_child (void);
 extern void Init_milter_manager_applicable_condition (void);
+extern void Init_milter_manager_dnsbl (void);
+extern void Init_milter_manager_connection_table (void);
 extern void Init_milter_manager_egg (void);
 extern void Init_milter_manager_children (void);
 extern void Init_milter_manager_control_command_encoder (void);
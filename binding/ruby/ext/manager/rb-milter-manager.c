@@ -29,6 +29,8 @@ Init_milter_manager (void)
     Init_milter_manager_configuration();
     Init_milter_manager_child();
     Init_milter_manager_applicable_condition();
+    Init_milter_manager_dnsbl();
+    Init_milter_manager_connection_table();
     Init_milter_manager_egg();
     Init_milter_manager_children();
     Init_milter_manager_control_command_encoder();
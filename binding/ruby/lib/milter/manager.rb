@@ -61,6 +61,7 @@ require 'milter/manager/netstat-connection-checker'
 
 require 'milter/manager/policy-manager'
 require 'milter/manager/address-matcher'
+require 'milter/manager/condition-rule-builder'
 require 'milter/manager/breaker'
 
 require 'milter/manager/debian-detector'
@@ -229,12 +230,20 @@ module Milter
         dump_item("manager.event_loop_backend",
                   c.event_loop_backend.nick.dump)
         dump_item("manager.n_workers", c.n_workers)
+        dump_item("manager.reuse_port", c.reuse_port?)
+        dump_item("manager.n_event_loop_threads", c.n_event_loop_threads)
         dump_item("manager.packet_buffer_size", c.default_packet_buffer_size)
         dump_item("manager.connection_check_interval",
                   c.connection_check_interval.inspect)
         dump_item("manager.chunk_size", c.chunk_size)
         dump_item("manager.max_pending_finished_sessions",
                   c.max_pending_finished_sessions)
+        dump_item("manager.max_on_memory_body_size",
+                  c.max_on_memory_body_size)
+        dump_item("manager.max_on_memory_body_total_size",
+                  c.max_on_memory_body_total_size)
+        dump_item("manager.use_memfd_body_spool", c.use_memfd_body_spool?)
+        dump_item("manager.short_circuit_reject", c.short_circuit_reject?)
         @result << "\n"
       end
 
@@ -250,6 +259,8 @@ module Milter
                   c.remove_controller_unix_socket_on_create?)
         dump_item("controller.remove_unix_socket_on_close",
                   c.remove_controller_unix_socket_on_close?)
+        dump_item("controller.metrics_connection_spec",
+                  c.controller_metrics_connection_spec.inspect)
         @result << "\n"
       end
 
@@ -355,6 +366,20 @@ module Milter
         dump_egg_item(name, "writing_timeout", egg.writing_timeout)
         dump_egg_item(name, "reading_timeout", egg.reading_timeout)
         dump_egg_item(name, "end_of_message_timeout", egg.end_of_message_timeout)
+        dump_egg_item(name, "connection_pool_size", egg.connection_pool_size)
+        dump_egg_item(name, "connection_pool_idle_timeout",
+                      egg.connection_pool_idle_timeout)
+        dump_egg_item(name, "launch_interval", egg.launch_interval)
+        dump_egg_item(name, "maximum_launch_interval",
+                      egg.maximum_launch_interval)
+        dump_egg_item(name, "circuit_breaker_window_size",
+                      egg.circuit_breaker_window_size)
+        dump_egg_item(name, "circuit_breaker_error_rate",
+                      egg.circuit_breaker_error_rate)
+        dump_egg_item(name, "circuit_breaker_slow_reply_time",
+                      egg.circuit_breaker_slow_reply_time)
+        dump_egg_item(name, "circuit_breaker_open_time",
+                      egg.circuit_breaker_open_time)
         @result << "end\n"
       end
     end
@@ -401,6 +426,7 @@ module Milter
         log_config.use_syslog = configuration.use_syslog?
         @log = client_config_loader::LogConfigurationLoader.new(log_config)
         @policy_manager = Manager::PolicyManager.new(self)
+        @applicable_condition_loaders = []
       end
 
       def load_configuration(file)
@@ -481,6 +507,14 @@ module Milter
         loader = ApplicableConditionConfigurationLoader.new(name, self)
         yield(loader)
         loader.apply
+        # Stoppers are compiled after the whole configuration is
+        # loaded because later configurations may still change data
+        # used by them such as s25r.add_whitelist.
+        if @load_level.zero?
+          loader.setup_stoppers
+        else
+          @applicable_condition_loaders << loader
+        end
       end
 
       def defined_milters
@@ -505,6 +539,7 @@ module Milter
       def apply_configurations
         apply_log
         apply_policies
+        apply_applicable_conditions
       end
 
       def apply_log
@@ -516,6 +551,13 @@ module Milter
         @policy_manager.apply
       end
 
+      def apply_applicable_conditions
+        loaders, @applicable_condition_loaders = @applicable_condition_loaders, []
+        loaders.each do |loader|
+          loader.setup_stoppers
+        end
+      end
+
       class XMLConfigurationLoader
         def initialize(loader)
           @loader = loader
@@ -836,6 +878,16 @@ module Milter
           @configuration.remove_controller_unix_socket_on_close = remove
         end
 
+        def metrics_connection_spec
+          @configuration.controller_metrics_connection_spec
+        end
+
+        def metrics_connection_spec=(spec)
+          Connection.parse_spec(spec) unless spec.nil?
+          update_location("metrics_connection_spec", spec.nil?)
+          @configuration.controller_metrics_connection_spec = spec
+        end
+
         private
         def update_location(key, reset, deep_level=2)
           full_key = "controller.#{key}"
@@ -1024,6 +1076,63 @@ module Milter
           @raw_configuration.chunk_size = size
         end
 
+        def max_on_memory_body_size
+          @raw_configuration.max_on_memory_body_size
+        end
+
+        def max_on_memory_body_size=(size)
+          update_location("max_on_memory_body_size", size.nil?)
+          size ||= 5 * 1024 * 1024
+          @raw_configuration.max_on_memory_body_size = size
+        end
+
+        def max_on_memory_body_total_size
+          @raw_configuration.max_on_memory_body_total_size
+        end
+
+        def max_on_memory_body_total_size=(size)
+          update_location("max_on_memory_body_total_size", size.nil?)
+          size ||= 0
+          @raw_configuration.max_on_memory_body_total_size = size
+        end
+
+        def use_memfd_body_spool?
+          @raw_configuration.use_memfd_body_spool?
+        end
+
+        def use_memfd_body_spool=(boolean)
+          update_location("use_memfd_body_spool", false)
+          @raw_configuration.use_memfd_body_spool = boolean
+        end
+
+        def reuse_port?
+          @raw_configuration.reuse_port?
+        end
+
+        def reuse_port=(boolean)
+          update_location("reuse_port", false)
+          @raw_configuration.reuse_port = boolean
+        end
+
+        def n_event_loop_threads
+          @raw_configuration.n_event_loop_threads
+        end
+
+        def n_event_loop_threads=(n_threads)
+          update_location("n_event_loop_threads", n_threads.nil?)
+          n_threads ||= 0
+          @raw_configuration.n_event_loop_threads = n_threads
+        end
+
+        def short_circuit_reject?
+          @raw_configuration.short_circuit_reject?
+        end
+
+        def short_circuit_reject=(boolean)
+          update_location("short_circuit_reject", false)
+          @raw_configuration.short_circuit_reject = boolean
+        end
+
         def connection_check_interval
           @raw_configuration.connection_check_interval
         end
@@ -1055,8 +1164,13 @@ module Milter
           self.connection_check_interval = interval
           checker = netstat_connection_checker
           checker.database_lifetime = interval
-          define_connection_checker("netstat") do |context|
-            checker.connected?(context)
+          if checker.connection_table
+            # Leaders check their connection by the table without Ruby.
+            @raw_configuration.connection_table = checker.connection_table
+          else
+            define_connection_checker("netstat") do |context|
+              checker.connected?(context)
+            end
           end
         end
 
@@ -1238,20 +1352,24 @@ module Milter
           @condition.merge(exist_condition) if exist_condition
         end
 
-        def define_connect_stopper(&block)
-          @connect_stoppers << block
+        # If rule_builder is given, it is called with a
+        # ConditionRuleBuilder and should return a ConditionRule that
+        # is evaluated natively. block is used only when the rule
+        # can't be compiled.
+        def define_connect_stopper(rule_builder=nil, &block)
+          @connect_stoppers << [rule_builder, block]
         end
 
-        def define_helo_stopper(&block)
-          @helo_stoppers << block
+        def define_helo_stopper(rule_builder=nil, &block)
+          @helo_stoppers << [rule_builder, block]
         end
 
-        def define_envelope_from_stopper(&block)
-          @envelope_from_stoppers << block
+        def define_envelope_from_stopper(rule_builder=nil, &block)
+          @envelope_from_stoppers << [rule_builder, block]
         end
 
-        def define_envelope_recipient_stopper(&block)
-          @envelope_recipient_stoppers << block
+        def define_envelope_recipient_stopper(rule_builder=nil, &block)
+          @envelope_recipient_stoppers << [rule_builder, block]
         end
 
         def define_data_stopper(&block)
@@ -1299,12 +1417,20 @@ module Milter
 
         def apply
           @loader.configuration.remove_applicable_condition(@condition.name)
-          setup_stoppers
           @loader.configuration.add_applicable_condition(@condition)
         end
 
-        private
         def setup_stoppers
+          @connect_stoppers =
+            compile_stoppers(@connect_stoppers, :connect_stopper_rule=)
+          @helo_stoppers =
+            compile_stoppers(@helo_stoppers, :helo_stopper_rule=)
+          @envelope_from_stoppers =
+            compile_stoppers(@envelope_from_stoppers,
+                             :envelope_from_stopper_rule=)
+          @envelope_recipient_stoppers =
+            compile_stoppers(@envelope_recipient_stoppers,
+                             :envelope_recipient_stopper_rule=)
           return unless have_stopper?
 
           @condition.signal_connect("attach-to") do |_, child, children, context|
@@ -1409,6 +1535,35 @@ module Milter
           end
         end
 
+        private
+        def compile_stoppers(stoppers, rule_setter)
+          builder = nil
+          rules = []
+          blocks = []
+          stoppers.each do |rule_builder, block|
+            if rule_builder.nil?
+              blocks << block
+              next
+            end
+            begin
+              builder ||= ConditionRuleBuilder.new
+              rules << rule_builder.call(builder)
+            rescue ConditionRuleBuilder::Uncompilable
+              if block.nil?
+                message = "[applicable-condition][rule][uncompilable] "
+                message << "<#{@condition.name}>: #{$!.message}"
+                Logger.error(message)
+              else
+                blocks << block
+              end
+            end
+          end
+          unless rules.empty?
+            @condition.__send__(rule_setter, builder.any(*rules))
+          end
+          blocks
+        end
+
         def update_location(name, reset, deep_level=2)
           full_key = "applicable_condition[#{@condition.name}].#{name}"
           @loader.configuration.update_location(full_key, reset, deep_level)
@@ -46,6 +46,14 @@ module Milter::Manager
       @remote_addresses << ensure_address(address)
     end
 
+    # Returns a rule for Milter::Manager::ConditionRuleBuilder that
+    # matches the same addresses as local_address?.
+    def local_address_rule(builder)
+      builder.all(builder.not(builder.networks(@remote_addresses)),
+                  builder.any(builder.local_address,
+                              builder.networks(@local_addresses)))
+    end
+
     private
     def custom_local_address?(ip_address)
       @local_addresses.any? do |local_address|
@@ -71,6 +71,10 @@ module Milter::Manager
       @client_context.n_processing_sessions
     end
 
+    def n_total_processing_sessions
+      @client_context.n_total_processing_sessions
+    end
+
     private
     def create_child_contexts
       contexts = {}
@@ -0,0 +1,120 @@
+# Copyright (C) 2026  milter manager project
+#
+# This library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library.  If not, see <http://www.gnu.org/licenses/>.
+
+require "ipaddr"
+
+module Milter::Manager
+  # Builds Milter::Manager::ConditionRule that is evaluated without
+  # Ruby. Methods raise Uncompilable for conditions that can only be
+  # expressed in Ruby such as Proc matchers.
+  class ConditionRuleBuilder
+    class Uncompilable < Error
+    end
+
+    def initialize
+      unless Milter::Manager.const_defined?(:ConditionRule)
+        raise Uncompilable, "native condition rule isn't available"
+      end
+    end
+
+    # Matches the value passed to the stopper: host name on connect,
+    # FQDN on HELO and address on envelope from/recipient. matchers
+    # are String (exact match) or Regexp.
+    def match(matchers)
+      strings = []
+      patterns = []
+      matchers.each do |matcher|
+        case matcher
+        when String
+          strings << matcher
+        when Regexp
+          patterns << regexp_to_pattern(matcher)
+        else
+          raise Uncompilable, "unsupported matcher: #{matcher.inspect}"
+        end
+      end
+      any(ConditionRule.strings(strings),
+          wrap_error {ConditionRule.regexps(patterns)})
+    end
+
+    def networks(addresses)
+      wrap_error do
+        networks = addresses.collect do |address|
+          address = IPAddr.new(address) unless address.is_a?(IPAddr)
+          "#{address}/#{address.prefix}"
+        end
+        ConditionRule.networks(networks)
+      end
+    end
+
+    def ipv4_address
+      ConditionRule.ipv4_address
+    end
+
+    def local_address
+      ConditionRule.local_address
+    end
+
+    def unknown_address
+      ConditionRule.unknown_address
+    end
+
+    def macro(name, value=nil)
+      ConditionRule.macro(name, value)
+    end
+
+    # Matches when the connected host is listed in a zone of
+    # checker (Milter::Manager::DNSBL). Milters receive connect after
+    # checker answers so this is only meaningful for connect stopper.
+    def dnsbl(checker)
+      raise Uncompilable, "native DNSBL checker isn't available" if checker.nil?
+      ConditionRule.dnsbl(checker)
+    end
+
+    def all(*rules)
+      return self.not(never) if rules.empty?
+      rules.inject {|result, rule| ConditionRule.and(result, rule)}
+    end
+
+    def any(*rules)
+      return never if rules.empty?
+      rules.inject {|result, rule| ConditionRule.or(result, rule)}
+    end
+
+    def not(rule)
+      ConditionRule.not(rule)
+    end
+
+    private
+    def never
+      ConditionRule.strings([])
+    end
+
+    def regexp_to_pattern(regexp)
+      # "m" keeps Ruby's line-based ^ and $; Ruby's MULTILINE is "s".
+      flags = "m"
+      flags << "i" if regexp.casefold?
+      flags << "s" if (regexp.options & Regexp::MULTILINE).nonzero?
+      flags << "x" if (regexp.options & Regexp::EXTENDED).nonzero?
+      "(?#{flags}:#{regexp.source})"
+    end
+
+    def wrap_error
+      yield
+    rescue GLib::Error, IPAddr::Error
+      raise Uncompilable, $!.message
+    end
+  end
+end
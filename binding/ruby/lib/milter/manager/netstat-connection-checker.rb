@@ -32,9 +32,16 @@ module Milter::Manager
       @options = (options || {}).dup
       @database = nil
       @last_update = nil
-      detect_netstat_command_line
+      @connection_table = nil
+      detect_connection_table if @options.fetch(:use_connection_table, true)
+      detect_netstat_command_line if @connection_table.nil?
     end
 
+    # Milter::Manager::ConnectionTable that reads sock_diag or
+    # /proc/net/tcp{,6} directly. nil when it isn't available and
+    # netstat is used instead.
+    attr_reader :connection_table
+
     def connected?(context)
       return true unless context.smtp_server_address.local?
       info = connection_info(context.smtp_client_address)
@@ -64,6 +71,7 @@ module Milter::Manager
 
     def database_lifetime=(lifetime)
       @options[:database_lifetime] = lifetime
+      @connection_table.lifetime = lifetime if @connection_table
     end
 
     private
@@ -82,7 +90,7 @@ module Milter::Manager
     end
 
     def connection_info(address, options={})
-      return nil if @netstat_command_line.nil?
+      return nil if @connection_table.nil? and @netstat_command_line.nil?
       type = nil
       case address
       when Milter::SocketAddress::IPv4
@@ -101,6 +109,10 @@ module Milter::Manager
         return nil
       end
 
+      if @connection_table
+        return connection_table_info(type, address, options)
+      end
+
       tcp_address = "#{address.address}:#{address.port}"
       update_database
       info = @database[type][tcp_address]
@@ -112,6 +124,22 @@ module Milter::Manager
       info
     end
 
+    def connection_table_info(type, address, options)
+      @connection_table.ensure_updated
+      result = @connection_table.lookup(address)
+      if result.nil? and options[:retry]
+        @connection_table.purge
+        @connection_table.ensure_updated
+        result = @connection_table.lookup(address)
+      end
+      return nil if result.nil?
+      state, local_address = result
+      ConnectionInfo.new(type.to_s,
+                         local_address.address, local_address.port.to_s,
+                         address.address, address.port.to_s,
+                         state.nick.upcase.tr("-", "_"))
+    end
+
     def purge_cache
       @database = nil
       @last_update = nil
@@ -161,6 +189,19 @@ module Milter::Manager
       [ip_address, port]
     end
 
+    def detect_connection_table
+      return unless Milter::Manager.const_defined?(:ConnectionTable)
+      table = ConnectionTable.new
+      table.update
+      table.lifetime = database_lifetime
+      @connection_table = table
+      Milter::Logger.info("[netstat][detect][native] " +
+                          "<#{table.source.nick}>")
+    rescue GLib::Error
+      Milter::Logger.info("[netstat][detect][native][not-available] " +
+                          "#{$!.message}")
+    end
+
     def detect_netstat_command_line
       @netstat_command_line = nil
       @netstat_command_env = ENV.to_h
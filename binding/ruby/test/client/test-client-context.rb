@@ -131,6 +131,10 @@ class TestClientContext < Test::Unit::TestCase
     assert_equal(0, @context.n_processing_sessions)
   end
 
+  def test_n_total_processing_sessions
+    assert_equal(0, @context.n_total_processing_sessions)
+  end
+
   def test_packet_buffer_size
     assert_equal(0, @context.packet_buffer_size)
     @context.packet_buffer_size = 4096
@@ -0,0 +1,83 @@
+# Copyright (C) 2026  milter manager project
+#
+# This library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library.  If not, see <http://www.gnu.org/licenses/>.
+
+class TestApplicableConditionsS25R < Test::Unit::TestCase
+  def setup
+    @configuration = Milter::Manager::Configuration.new
+    @configuration.clear_load_paths
+    @configuration.append_load_path("#{ENV['TOP_SRCDIR']}/data")
+    @loader = Milter::Manager::ConfigurationLoader.new(@configuration)
+    @loader.load("applicable-conditions/s25r.conf")
+    @s25r = @loader.s25r
+    @builder = Milter::Manager::ConditionRuleBuilder.new
+  end
+
+  def test_stop_rule
+    rule = @s25r.stop_rule(@builder)
+    assert_true(rule.match?("mail-ot1-f41.google.com",
+                            ipv4("209.85.210.41")))
+    assert_false(rule.match?("ppp-12.example.com", ipv4("192.0.2.12")))
+    assert_true(rule.match?("mail.example.com", ipv4("192.0.2.25")))
+    assert_equal(expected_stops(samples), actual_stops(rule, samples))
+  end
+
+  def test_stop_rule_ipv6
+    @s25r.only_check_ipv4 = false
+    rule = @s25r.stop_rule(@builder)
+    assert_false(rule.match?("ppp-12.example.com", ipv6("2001:db8::12")))
+    assert_equal(expected_stops(samples), actual_stops(rule, samples))
+  end
+
+  private
+  def samples
+    [
+      ["mail-ot1-f41.google.com", ipv4("209.85.210.41")],
+      ["ppp-12.example.com", ipv4("192.0.2.12")],
+      ["h12345.example.net", ipv4("192.0.2.45")],
+      ["unknown", ipv4("192.0.2.1")],
+      ["[192.0.2.1]", ipv4("192.0.2.1")],
+      ["mail.example.com", ipv4("192.0.2.25")],
+      ["mail.example.com", ipv6("2001:db8::25")],
+      ["ppp-12.example.com", ipv6("2001:db8::12")],
+    ]
+  end
+
+  def expected_stops(samples)
+    samples.collect do |host, address|
+      stop = if @s25r.white?(host, address)
+               true
+             elsif @s25r.black?(host, address)
+               false
+             else
+               true
+             end
+      [host, address.to_s, stop]
+    end
+  end
+
+  def actual_stops(rule, samples)
+    samples.collect do |host, address|
+      [host, address.to_s, rule.match?(host, address)]
+    end
+  end
+
+  def ipv4(address, port=2929)
+    Milter::SocketAddress::IPv4.new(address, port)
+  end
+
+  def ipv6(address, port=2929)
+    Milter::SocketAddress::IPv6.new(address, port)
+  end
+end
@@ -52,7 +52,7 @@ class TestBreaker < Test::Unit::TestCase
 
   def context(n_processing_sessions)
     _context = OpenStruct.new
-    _context.n_processing_sessions = n_processing_sessions
+    _context.n_total_processing_sessions = n_processing_sessions
     _context
   end
 end
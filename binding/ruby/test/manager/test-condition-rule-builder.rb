@@ -0,0 +1,117 @@
+# Copyright (C) 2026  milter manager project
+#
+# This library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library.  If not, see <http://www.gnu.org/licenses/>.
+
+class TestConditionRuleBuilder < Test::Unit::TestCase
+  def setup
+    @builder = Milter::Manager::ConditionRuleBuilder.new
+  end
+
+  def test_match
+    rule = @builder.match(["unknown",
+                           /\.google\.com\z/,
+                           /\A(?:dhcp|dialup|ppp|[achrsvx]?dsl)[^.]*\d/i])
+    assert_true(rule.match?("unknown"))
+    assert_true(rule.match?("mail-ot1-f41.google.com"))
+    assert_true(rule.match?("PPP-12.example.com"))
+    assert_false(rule.match?("unknown.example.com"))
+    assert_false(rule.match?("mail.example.com"))
+  end
+
+  def test_match_proc
+    assert_raise(Milter::Manager::ConditionRuleBuilder::Uncompilable) do
+      @builder.match([Proc.new {|host| true}])
+    end
+  end
+
+  def test_networks
+    rule = @builder.networks(["160.29.167.0/24", IPAddr.new("2001:db8::/32")])
+    assert_true(rule.match?(nil, ipv4("160.29.167.10")))
+    assert_false(rule.match?(nil, ipv4("160.29.168.10")))
+    assert_true(rule.match?(nil, ipv6("2001:db8::29")))
+    assert_false(rule.match?(nil, ipv6("2001:db9::29")))
+  end
+
+  def test_networks_invalid
+    assert_raise(Milter::Manager::ConditionRuleBuilder::Uncompilable) do
+      @builder.networks(["160.29.167.0/xx"])
+    end
+  end
+
+  def test_macro
+    rule = @builder.macro("{auth_type}", "PLAIN")
+    assert_true(rule.match?(nil, nil, {"auth_type" => "PLAIN"}))
+    assert_false(rule.match?(nil, nil, {"auth_type" => "LOGIN"}))
+    assert_false(rule.match?(nil, nil, {}))
+  end
+
+  def test_logical
+    white = @builder.match([/\.example\.com\z/])
+    black = @builder.match([/\A[^.]*\d{5}/])
+    rule = @builder.all(@builder.ipv4_address, @builder.not(white), black)
+    assert_true(rule.match?("h12345.example.net", ipv4("160.29.167.10")))
+    assert_false(rule.match?("h12345.example.com", ipv4("160.29.167.10")))
+    assert_false(rule.match?("h12345.example.net", ipv6("2001:db8::1")))
+    assert_true(@builder.all.match?(nil))
+    assert_false(@builder.any.match?(nil))
+  end
+
+  def test_dnsbl
+    dnsbl = Milter::Manager::DNSBL.new
+    dnsbl.add_zone("bl.example.com")
+    rule = @builder.dnsbl(dnsbl)
+    assert_false(rule.match?(nil, ipv4("127.0.0.2")))
+    assert_true(@builder.not(rule).match?(nil, ipv4("127.0.0.2")))
+  end
+
+  def test_dnsbl_without_checker
+    assert_raise(Milter::Manager::ConditionRuleBuilder::Uncompilable) do
+      @builder.dnsbl(nil)
+    end
+  end
+
+  def test_address_matcher
+    matcher = Milter::Manager::AddressMatcher.new
+    matcher.add_local_address("160.29.167.0/24")
+    matcher.add_remote_address("192.168.1.0/24")
+    rule = matcher.local_address_rule(@builder)
+    [
+      ipv4("160.29.167.10"),
+      ipv4("160.29.168.10"),
+      ipv4("192.168.1.10"),
+      ipv4("192.168.2.10"),
+      ipv4("127.0.0.1"),
+      ipv6("::1"),
+      ipv6("2001:db8::1"),
+      unix("/tmp/milter-manager.sock"),
+    ].each do |address|
+      assert_equal(matcher.local_address?(address),
+                   rule.match?(nil, address),
+                   address)
+    end
+  end
+
+  private
+  def ipv4(address, port=2929)
+    Milter::SocketAddress::IPv4.new(address, port)
+  end
+
+  def ipv6(address, port=2929)
+    Milter::SocketAddress::IPv6.new(address, port)
+  end
+
+  def unix(path)
+    Milter::SocketAddress::Unix.new(path)
+  end
+end
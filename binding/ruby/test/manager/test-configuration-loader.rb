@@ -107,6 +107,15 @@ class TestConfigurationLoader < Test::Unit::TestCase
                  @configuration.controller_connection_spec)
   end
 
+  def test_controller_metrics_connection_spec
+    assert_nil(@configuration.controller_metrics_connection_spec)
+    @loader.controller.metrics_connection_spec = "inet:9290@localhost"
+    assert_equal("inet:9290@localhost",
+                 @configuration.controller_metrics_connection_spec)
+    assert_equal(@configuration.controller_metrics_connection_spec,
+                 @loader.controller.metrics_connection_spec)
+  end
+
   def test_manager_daemon
     assert_false(@configuration.daemon?)
     @loader.manager.daemon = true
@@ -257,6 +266,48 @@ class TestConfigurationLoader < Test::Unit::TestCase
     assert_equal(0, @configuration.max_pending_finished_sessions)
   end
 
+  def test_manager_reuse_port
+    assert_false(@configuration.reuse_port?)
+    @loader.manager.reuse_port = true
+    assert_true(@configuration.reuse_port?)
+  end
+
+  def test_manager_max_on_memory_body_size
+    assert_equal(5242880, @configuration.max_on_memory_body_size)
+    @loader.manager.max_on_memory_body_size = 1024
+    assert_equal(1024, @configuration.max_on_memory_body_size)
+    @loader.manager.max_on_memory_body_size = nil
+    assert_equal(5242880, @configuration.max_on_memory_body_size)
+  end
+
+  def test_manager_max_on_memory_body_total_size
+    assert_equal(0, @configuration.max_on_memory_body_total_size)
+    @loader.manager.max_on_memory_body_total_size = 1024 ** 3
+    assert_equal(1024 ** 3, @configuration.max_on_memory_body_total_size)
+    @loader.manager.max_on_memory_body_total_size = nil
+    assert_equal(0, @configuration.max_on_memory_body_total_size)
+  end
+
+  def test_manager_use_memfd_body_spool
+    assert_false(@configuration.use_memfd_body_spool?)
+    @loader.manager.use_memfd_body_spool = true
+    assert_true(@configuration.use_memfd_body_spool?)
+  end
+
+  def test_manager_n_event_loop_threads
+    assert_equal(0, @configuration.n_event_loop_threads)
+    @loader.manager.n_event_loop_threads = 4
+    assert_equal(4, @configuration.n_event_loop_threads)
+    @loader.manager.n_event_loop_threads = nil
+    assert_equal(0, @configuration.n_event_loop_threads)
+  end
+
+  def test_manager_short_circuit_reject
+    assert_false(@configuration.short_circuit_reject?)
+    @loader.manager.short_circuit_reject = true
+    assert_true(@configuration.short_circuit_reject?)
+  end
+
   def test_database_type
     assert_equal(nil, @configuration.database.type)
     @loader.database.type = "mysql"
@@ -29,6 +29,14 @@ class TestConfiguration < Test::Unit::TestCase
     assert_nil(@configuration.controller_connection_spec)
   end
 
+  def test_controller_metrics_connection_spec
+    @configuration.controller_metrics_connection_spec = "inet:9290@localhost"
+    assert_equal("inet:9290@localhost",
+                 @configuration.controller_metrics_connection_spec)
+    @configuration.controller_metrics_connection_spec = nil
+    assert_nil(@configuration.controller_metrics_connection_spec)
+  end
+
   def test_manager_connection_spec
     @configuration.manager_connection_spec = "inet:10025@localhost"
     assert_equal("inet:10025@localhost", @configuration.manager_connection_spec)
@@ -92,6 +100,42 @@ class TestConfiguration < Test::Unit::TestCase
     assert_equal(29, @configuration.max_pending_finished_sessions)
   end
 
+  def test_reuse_port
+    assert_false(@configuration.reuse_port?)
+    @configuration.reuse_port = true
+    assert_true(@configuration.reuse_port?)
+  end
+
+  def test_max_on_memory_body_size
+    assert_equal(5242880, @configuration.max_on_memory_body_size)
+    @configuration.max_on_memory_body_size = 1024
+    assert_equal(1024, @configuration.max_on_memory_body_size)
+  end
+
+  def test_max_on_memory_body_total_size
+    assert_equal(0, @configuration.max_on_memory_body_total_size)
+    @configuration.max_on_memory_body_total_size = 1024 ** 3
+    assert_equal(1024 ** 3, @configuration.max_on_memory_body_total_size)
+  end
+
+  def test_use_memfd_body_spool
+    assert_false(@configuration.use_memfd_body_spool?)
+    @configuration.use_memfd_body_spool = true
+    assert_true(@configuration.use_memfd_body_spool?)
+  end
+
+  def test_n_event_loop_threads
+    assert_equal(0, @configuration.n_event_loop_threads)
+    @configuration.n_event_loop_threads = 4
+    assert_equal(4, @configuration.n_event_loop_threads)
+  end
+
+  def test_short_circuit_reject
+    assert_false(@configuration.short_circuit_reject?)
+    @configuration.short_circuit_reject = true
+    assert_true(@configuration.short_circuit_reject?)
+  end
+
   def test_package
     @configuration.package_platform = "pkgsrc"
     assert_equal("pkgsrc", @configuration.package_platform)
@@ -296,6 +340,10 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.reuse_port = false
+# default
+manager.n_event_loop_threads = 0
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
@@ -303,6 +351,14 @@ manager.connection_check_interval = 0
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_on_memory_body_size = 5242880
+# default
+manager.max_on_memory_body_total_size = 0
+# default
+manager.use_memfd_body_spool = false
+# default
+manager.short_circuit_reject = false
 
 # default
 controller.connection_spec = nil
@@ -314,6 +370,8 @@ controller.unix_socket_group = nil
 controller.remove_unix_socket_on_create = true
 # default
 controller.remove_unix_socket_on_close = true
+# default
+controller.metrics_connection_spec = nil
 
 # default
 database.type = nil
@@ -441,6 +499,10 @@ manager.event_loop_backend = "glib"
 # default
 manager.n_workers = 0
 # default
+manager.reuse_port = false
+# default
+manager.n_event_loop_threads = 0
+# default
 manager.packet_buffer_size = 0
 # default
 manager.connection_check_interval = 0
@@ -448,6 +510,14 @@ manager.connection_check_interval = 0
 manager.chunk_size = 65535
 # default
 manager.max_pending_finished_sessions = 0
+# default
+manager.max_on_memory_body_size = 5242880
+# default
+manager.max_on_memory_body_total_size = 0
+# default
+manager.use_memfd_body_spool = false
+# default
+manager.short_circuit_reject = false
 
 # #{__FILE__}:#{controller_connection_spec}
 controller.connection_spec = "inet:10025"
@@ -459,6 +529,8 @@ controller.unix_socket_group = "nogroup"
 controller.remove_unix_socket_on_create = true
 # default
 controller.remove_unix_socket_on_close = true
+# default
+controller.metrics_connection_spec = nil
 
 # #{__FILE__}:#{database_type}
 database.type = "sqlite3"
@@ -511,6 +583,22 @@ define_milter("milter1") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
+  # default
+  milter.launch_interval = 1.0
+  # default
+  milter.maximum_launch_interval = 60.0
+  # default
+  milter.circuit_breaker_window_size = 0
+  # default
+  milter.circuit_breaker_error_rate = 0.5
+  # default
+  milter.circuit_breaker_slow_reply_time = 0.0
+  # default
+  milter.circuit_breaker_open_time = 30.0
 end
 
 # #{__FILE__}:#{milter2_lines[:define]}
@@ -541,6 +629,22 @@ define_milter("milter2") do |milter|
   milter.reading_timeout = 7.0
   # default
   milter.end_of_message_timeout = 297.0
+  # default
+  milter.connection_pool_size = 0
+  # default
+  milter.connection_pool_idle_timeout = 60.0
+  # default
+  milter.launch_interval = 1.0
+  # default
+  milter.maximum_launch_interval = 60.0
+  # default
+  milter.circuit_breaker_window_size = 0
+  # default
+  milter.circuit_breaker_error_rate = 0.5
+  # default
+  milter.circuit_breaker_slow_reply_time = 0.0
+  # default
+  milter.circuit_breaker_open_time = 30.0
 end
 EOD
                  @configuration.dump)
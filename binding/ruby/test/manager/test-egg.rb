@@ -72,6 +72,54 @@ class TestEgg < Test::Unit::TestCase
     assert_equal(end_of_message_timeout, @egg.end_of_message_timeout)
   end
 
+  def test_connection_pool_size
+    assert_equal(0, @egg.connection_pool_size)
+    @egg.connection_pool_size = 4
+    assert_equal(4, @egg.connection_pool_size)
+  end
+
+  def test_connection_pool_idle_timeout
+    assert_equal(60.0, @egg.connection_pool_idle_timeout)
+    @egg.connection_pool_idle_timeout = 29
+    assert_equal(29, @egg.connection_pool_idle_timeout)
+  end
+
+  def test_launch_interval
+    assert_equal(1.0, @egg.launch_interval)
+    @egg.launch_interval = 0.5
+    assert_equal(0.5, @egg.launch_interval)
+  end
+
+  def test_maximum_launch_interval
+    assert_equal(60.0, @egg.maximum_launch_interval)
+    @egg.maximum_launch_interval = 300
+    assert_equal(300, @egg.maximum_launch_interval)
+  end
+
+  def test_circuit_breaker_window_size
+    assert_equal(0, @egg.circuit_breaker_window_size)
+    @egg.circuit_breaker_window_size = 20
+    assert_equal(20, @egg.circuit_breaker_window_size)
+  end
+
+  def test_circuit_breaker_error_rate
+    assert_equal(0.5, @egg.circuit_breaker_error_rate)
+    @egg.circuit_breaker_error_rate = 0.8
+    assert_equal(0.8, @egg.circuit_breaker_error_rate)
+  end
+
+  def test_circuit_breaker_slow_reply_time
+    assert_equal(0.0, @egg.circuit_breaker_slow_reply_time)
+    @egg.circuit_breaker_slow_reply_time = 5
+    assert_equal(5, @egg.circuit_breaker_slow_reply_time)
+  end
+
+  def test_circuit_breaker_open_time
+    assert_equal(30.0, @egg.circuit_breaker_open_time)
+    @egg.circuit_breaker_open_time = 60
+    assert_equal(60, @egg.circuit_breaker_open_time)
+  end
+
   def test_user_name
     user_name = "milter-user"
     assert_nil(@egg.user_name)
@@ -13,6 +13,8 @@
 # You should have received a copy of the GNU Lesser General Public License
 # along with this library.  If not, see <http://www.gnu.org/licenses/>.
 
+require "socket"
+
 class TestNetstatConnectionChecker < Test::Unit::TestCase
   def setup
     @checker = Milter::Manager::NetstatConnectionChecker.new
@@ -161,6 +163,23 @@ EON
                  @checker.instance_variable_get(:@database))
   end
 
+  def test_connection_table
+    if @checker.connection_table.nil?
+      omit("native connection table isn't available")
+    end
+    server = TCPServer.new("127.0.0.1", 0)
+    client = TCPSocket.new("127.0.0.1", server.addr[1])
+    accepted = server.accept
+    address = Milter::SocketAddress::IPv4.new("127.0.0.1", client.addr[1])
+    assert_equal(["127.0.0.1", server.addr[1].to_s],
+                 [@checker.smtp_server_interface_ip_address(address),
+                  @checker.smtp_server_interface_port(address)])
+  ensure
+    accepted.close if accepted
+    client.close if client
+    server.close if server
+  end
+
   private
   def info(protocol,
            local_ip_address, local_port,
@@ -25,6 +25,8 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -39,6 +41,7 @@ static gchar *connection_spec = NULL;
 static GIOChannel *listen_channel = NULL;
 static gint listen_backlog = -1;
 static guint timeout = 7210;
+static guint n_callback_threads = 0;
 
 #define SMFI_CONTEXT_GET_PRIVATE(obj)                   \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
@@ -50,8 +53,71 @@ struct _SmfiContextPrivate
 {
     MilterClientContext *client_context;
     gpointer private_data;
+    GQueue pending_jobs;
+    gboolean job_running;
+    gboolean finished;
 };
 
+typedef enum
+{
+    SMFI_JOB_NEGOTIATE,
+    SMFI_JOB_CONNECT,
+    SMFI_JOB_HELO,
+    SMFI_JOB_ENVELOPE_FROM,
+    SMFI_JOB_ENVELOPE_RECIPIENT,
+    SMFI_JOB_DATA,
+    SMFI_JOB_UNKNOWN,
+    SMFI_JOB_HEADER,
+    SMFI_JOB_END_OF_HEADER,
+    SMFI_JOB_BODY,
+    SMFI_JOB_END_OF_MESSAGE,
+    SMFI_JOB_ABORT,
+    SMFI_JOB_CLOSE
+} SmfiJobType;
+
+/* A callback invocation. Strings and chunks are borrowed
+ * when it is run in the event loop and copied when it is
+ * passed to a callback thread. */
+typedef struct _SmfiJob SmfiJob;
+struct _SmfiJob
+{
+    SmfiContext *context;
+    SmfiJobType type;
+    MilterOption *option;
+    MilterMacrosRequests *macros_requests;
+    gchar *name;
+    gchar *value;
+    gchar *chunk;
+    gsize chunk_size;
+    struct sockaddr *address;
+    socklen_t address_length;
+    MilterStatus status;
+};
+
+/* Callbacks are run in a bounded thread pool like libmilter
+ * runs them in a thread per session. The event loop still
+ * owns all I/O: a finished job is passed back to the event
+ * loop through a pipe and the event loop replies. Jobs of a
+ * session are run one by one in order. */
+typedef struct _CallbackThreads CallbackThreads;
+struct _CallbackThreads
+{
+    GThreadPool *pool;
+    GAsyncQueue *finished_jobs;
+    MilterEventLoop *loop;
+    GIOChannel *notify_channel;
+    gint notify_fd;
+    guint notify_watch_id;
+    GMutex mutex;
+    GCond cond;
+    guint n_loop_requests;
+    gboolean loop_parked;
+    gboolean loop_owned;
+};
+
+static CallbackThreads *callback_threads = NULL;
+static GPrivate current_job = G_PRIVATE_INIT(NULL);
+
 enum
 {
     PROP_0,
@@ -103,6 +169,9 @@ smfi_context_init (SmfiContext *context)
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     priv->client_context = NULL;
     priv->private_data = NULL;
+    g_queue_init(&(priv->pending_jobs));
+    priv->job_running = FALSE;
+    priv->finished = FALSE;
 }
 
 static void
@@ -261,30 +330,470 @@ smfi_register (struct smfiDesc description)
     return MI_SUCCESS;
 }
 
+static MilterStatus
+run_job (SmfiJob *job)
+{
+    SmfiContext *smfi_context = job->context;
+    sfsistat status = SMFIS_CONTINUE;
+    gchar *arguments[2];
+
+    switch (job->type) {
+    case SMFI_JOB_NEGOTIATE:
+    {
+        gulong action, step, preserve1 = 0, preserve2 = 0;
+        gulong action_out, step_out, preserve1_out = 0, preserve2_out = 0;
+
+        action = action_out = milter_option_get_action(job->option);
+        step = step_out = milter_option_get_step(job->option);
+        status = filter_description->xxfi_negotiate(smfi_context,
+                                                    action, step,
+                                                    preserve1, preserve2,
+                                                    &action_out, &step_out,
+                                                    &preserve1_out,
+                                                    &preserve2_out);
+        if (status == SMFIS_CONTINUE) {
+            milter_option_set_action(job->option, action_out);
+            milter_option_set_step(job->option, step_out);
+        }
+        break;
+    }
+    case SMFI_JOB_CONNECT:
+        status = filter_description->xxfi_connect(smfi_context,
+                                                  job->name,
+                                                  job->address);
+        break;
+    case SMFI_JOB_HELO:
+        status = filter_description->xxfi_helo(smfi_context, job->name);
+        break;
+    case SMFI_JOB_ENVELOPE_FROM:
+        arguments[0] = job->name;
+        arguments[1] = NULL;
+        status = filter_description->xxfi_envfrom(smfi_context, arguments);
+        break;
+    case SMFI_JOB_ENVELOPE_RECIPIENT:
+        arguments[0] = job->name;
+        arguments[1] = NULL;
+        status = filter_description->xxfi_envrcpt(smfi_context, arguments);
+        break;
+    case SMFI_JOB_DATA:
+        status = filter_description->xxfi_data(smfi_context);
+        break;
+    case SMFI_JOB_UNKNOWN:
+        status = filter_description->xxfi_unknown(smfi_context, job->name);
+        break;
+    case SMFI_JOB_HEADER:
+        status = filter_description->xxfi_header(smfi_context,
+                                                 job->name,
+                                                 job->value);
+        break;
+    case SMFI_JOB_END_OF_HEADER:
+        status = filter_description->xxfi_eoh(smfi_context);
+        break;
+    case SMFI_JOB_BODY:
+        status = filter_description->xxfi_body(smfi_context,
+                                               (guchar *)job->chunk,
+                                               job->chunk_size);
+        break;
+    case SMFI_JOB_END_OF_MESSAGE:
+        if (job->chunk && job->chunk_size > 0 &&
+            filter_description->xxfi_body) {
+            status = filter_description->xxfi_body(smfi_context,
+                                                   (guchar *)job->chunk,
+                                                   job->chunk_size);
+            switch (status) {
+            case SMFIS_REJECT:
+            case SMFIS_DISCARD:
+            case SMFIS_ACCEPT:
+            case SMFIS_TEMPFAIL:
+                return libmilter_compatible_convert_status_to(status);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!filter_description->xxfi_eom)
+            return MILTER_STATUS_DEFAULT;
+
+        status = filter_description->xxfi_eom(smfi_context);
+        break;
+    case SMFI_JOB_ABORT:
+        status = filter_description->xxfi_abort(smfi_context);
+        break;
+    case SMFI_JOB_CLOSE:
+        if (filter_description->xxfi_close)
+            filter_description->xxfi_close(smfi_context);
+        return MILTER_STATUS_DEFAULT;
+        break;
+    }
+
+    return libmilter_compatible_convert_status_to(status);
+}
+
+static void
+job_init (SmfiJob *job, SmfiContext *context, SmfiJobType type)
+{
+    memset(job, 0, sizeof(*job));
+    job->context = context;
+    job->type = type;
+    job->status = MILTER_STATUS_DEFAULT;
+}
+
+static SmfiJob *
+job_copy (SmfiJob *job)
+{
+    SmfiJob *copied_job;
+
+    copied_job = g_memdup(job, sizeof(*job));
+    g_object_ref(copied_job->context);
+    if (copied_job->option)
+        g_object_ref(copied_job->option);
+    if (copied_job->macros_requests)
+        g_object_ref(copied_job->macros_requests);
+    copied_job->name = g_strdup(job->name);
+    copied_job->value = g_strdup(job->value);
+    if (job->chunk)
+        copied_job->chunk = g_memdup(job->chunk, job->chunk_size);
+    if (job->address)
+        copied_job->address = g_memdup(job->address, job->address_length);
+
+    return copied_job;
+}
+
+static void
+job_free (SmfiJob *job)
+{
+    g_object_unref(job->context);
+    if (job->option)
+        g_object_unref(job->option);
+    if (job->macros_requests)
+        g_object_unref(job->macros_requests);
+    g_free(job->name);
+    g_free(job->value);
+    g_free(job->chunk);
+    g_free(job->address);
+    g_free(job);
+}
+
+static const gchar *
+job_response_signal_name (SmfiJob *job)
+{
+    switch (job->type) {
+    case SMFI_JOB_CONNECT:
+        return "connect-response";
+    case SMFI_JOB_HELO:
+        return "helo-response";
+    case SMFI_JOB_ENVELOPE_FROM:
+        return "envelope-from-response";
+    case SMFI_JOB_ENVELOPE_RECIPIENT:
+        return "envelope-recipient-response";
+    case SMFI_JOB_DATA:
+        return "data-response";
+    case SMFI_JOB_UNKNOWN:
+        return "unknown-response";
+    case SMFI_JOB_HEADER:
+        return "header-response";
+    case SMFI_JOB_END_OF_HEADER:
+        return "end-of-header-response";
+    case SMFI_JOB_BODY:
+        return "body-response";
+    case SMFI_JOB_END_OF_MESSAGE:
+        return "end-of-message-response";
+    default:
+        return NULL;
+    }
+}
+
+static void
+callback_threads_notify (CallbackThreads *threads)
+{
+    ssize_t written;
+
+    /* A full pipe is OK. The event loop hasn't read the
+     * previous notification yet. */
+    do {
+        written = write(threads->notify_fd, "", 1);
+    } while (written == -1 && errno == EINTR);
+}
+
+static void
+callback_threads_run_job (gpointer data, gpointer user_data)
+{
+    SmfiJob *job = data;
+    CallbackThreads *threads = user_data;
+
+    g_private_set(&current_job, job);
+    job->status = run_job(job);
+    g_private_set(&current_job, NULL);
+
+    g_async_queue_push(threads->finished_jobs, job);
+    callback_threads_notify(threads);
+}
+
+static void finish_job (SmfiJob *job);
+
+static void
+start_next_job (SmfiContext *context)
+{
+    SmfiContextPrivate *priv;
+    SmfiJob *job;
+
+    priv = SMFI_CONTEXT_GET_PRIVATE(context);
+    if (priv->job_running)
+        return;
+
+    job = g_queue_pop_head(&(priv->pending_jobs));
+    if (!job)
+        return;
+
+    priv->job_running = TRUE;
+    if (callback_threads->pool) {
+        g_thread_pool_push(callback_threads->pool, job, NULL);
+    } else {
+        /* Callback threads are being stopped. */
+        job->status = run_job(job);
+        finish_job(job);
+    }
+}
+
+static void
+finish_job (SmfiJob *job)
+{
+    SmfiContext *context;
+    SmfiContextPrivate *priv;
+    const gchar *signal_name;
+
+    context = g_object_ref(job->context);
+    priv = SMFI_CONTEXT_GET_PRIVATE(context);
+    priv->job_running = FALSE;
+
+    if (job->type == SMFI_JOB_CLOSE) {
+        job_free(job);
+        /* The reference for the session. */
+        g_object_unref(context);
+    } else {
+        if (!priv->finished && priv->client_context) {
+            if (job->type == SMFI_JOB_NEGOTIATE) {
+                g_signal_emit_by_name(priv->client_context,
+                                      "negotiate-response",
+                                      job->option, job->macros_requests,
+                                      job->status);
+            } else {
+                signal_name = job_response_signal_name(job);
+                if (signal_name)
+                    g_signal_emit_by_name(priv->client_context, signal_name,
+                                          job->status);
+            }
+        }
+        job_free(job);
+        start_next_job(context);
+    }
+    g_object_unref(context);
+}
+
+static gboolean
+cb_callback_threads_notify (GIOChannel *channel, GIOCondition condition,
+                            gpointer user_data)
+{
+    CallbackThreads *threads = user_data;
+    SmfiJob *job;
+    gchar buffer[64];
+    ssize_t size;
+
+    do {
+        size = read(g_io_channel_unix_get_fd(channel), buffer, sizeof(buffer));
+    } while (size > 0 || (size == -1 && errno == EINTR));
+
+    /* Callbacks that call smfi_*() for modifications wait
+     * until the event loop is parked. */
+    g_mutex_lock(&(threads->mutex));
+    if (threads->n_loop_requests > 0) {
+        threads->loop_parked = TRUE;
+        g_cond_broadcast(&(threads->cond));
+        while (threads->n_loop_requests > 0) {
+            g_cond_wait(&(threads->cond), &(threads->mutex));
+        }
+        threads->loop_parked = FALSE;
+    }
+    g_mutex_unlock(&(threads->mutex));
+
+    while ((job = g_async_queue_try_pop(threads->finished_jobs))) {
+        finish_job(job);
+    }
+
+    return TRUE;
+}
+
+static CallbackThreads *
+callback_threads_new (MilterEventLoop *loop)
+{
+    CallbackThreads *threads;
+    gint pipe_fds[2];
+    guint i;
+    GError *error = NULL;
+
+    if (pipe(pipe_fds) == -1) {
+        milter_error("[%s][callback-threads][pipe][error] %s",
+                     filter_description->xxfi_name, g_strerror(errno));
+        return NULL;
+    }
+    for (i = 0; i < 2; i++) {
+        fcntl(pipe_fds[i], F_SETFL, fcntl(pipe_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(pipe_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    threads = g_new0(CallbackThreads, 1);
+    threads->pool = g_thread_pool_new(callback_threads_run_job,
+                                      threads,
+                                      n_callback_threads,
+                                      FALSE,
+                                      &error);
+    if (!threads->pool) {
+        milter_error("[%s][callback-threads][start][error] %s",
+                     filter_description->xxfi_name, error->message);
+        g_error_free(error);
+        close(pipe_fds[MILTER_UTILS_READ_PIPE]);
+        close(pipe_fds[MILTER_UTILS_WRITE_PIPE]);
+        g_free(threads);
+        return NULL;
+    }
+    threads->finished_jobs = g_async_queue_new();
+    threads->loop = g_object_ref(loop);
+    threads->notify_channel =
+        g_io_channel_unix_new(pipe_fds[MILTER_UTILS_READ_PIPE]);
+    g_io_channel_set_close_on_unref(threads->notify_channel, TRUE);
+    threads->notify_fd = pipe_fds[MILTER_UTILS_WRITE_PIPE];
+    threads->notify_watch_id =
+        milter_event_loop_watch_io(loop,
+                                   threads->notify_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   cb_callback_threads_notify,
+                                   threads);
+    g_mutex_init(&(threads->mutex));
+    g_cond_init(&(threads->cond));
+    threads->n_loop_requests = 0;
+    threads->loop_parked = FALSE;
+    threads->loop_owned = FALSE;
+
+    milter_debug("[%s][callback-threads][start] %u",
+                 filter_description->xxfi_name, n_callback_threads);
+
+    return threads;
+}
+
+static void
+callback_threads_stop (void)
+{
+    CallbackThreads *threads = callback_threads;
+    GThreadPool *pool;
+    SmfiJob *job;
+
+    if (!threads)
+        return;
+
+    /* The event loop isn't run anymore. Running callbacks
+     * can use it without waiting for it. */
+    g_mutex_lock(&(threads->mutex));
+    threads->loop_parked = TRUE;
+    g_cond_broadcast(&(threads->cond));
+    g_mutex_unlock(&(threads->mutex));
+
+    pool = threads->pool;
+    threads->pool = NULL;
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    while ((job = g_async_queue_try_pop(threads->finished_jobs))) {
+        finish_job(job);
+    }
+
+    if (threads->notify_watch_id > 0)
+        milter_event_loop_remove(threads->loop, threads->notify_watch_id);
+    g_io_channel_unref(threads->notify_channel);
+    close(threads->notify_fd);
+    g_object_unref(threads->loop);
+    g_async_queue_unref(threads->finished_jobs);
+    g_mutex_clear(&(threads->mutex));
+    g_cond_clear(&(threads->cond));
+    g_free(threads);
+    callback_threads = NULL;
+}
+
+static gboolean
+lock_event_loop (void)
+{
+    CallbackThreads *threads = callback_threads;
+
+    if (!threads || !g_private_get(&current_job))
+        return FALSE;
+
+    g_mutex_lock(&(threads->mutex));
+    if (threads->n_loop_requests++ == 0)
+        callback_threads_notify(threads);
+    while (!threads->loop_parked || threads->loop_owned) {
+        g_cond_wait(&(threads->cond), &(threads->mutex));
+    }
+    threads->loop_owned = TRUE;
+    g_mutex_unlock(&(threads->mutex));
+
+    return TRUE;
+}
+
+static void
+unlock_event_loop (gboolean locked)
+{
+    CallbackThreads *threads = callback_threads;
+
+    if (!locked)
+        return;
+
+    g_mutex_lock(&(threads->mutex));
+    threads->loop_owned = FALSE;
+    threads->n_loop_requests--;
+    g_cond_broadcast(&(threads->cond));
+    g_mutex_unlock(&(threads->mutex));
+}
+
+static MilterStatus
+dispatch_job (SmfiJob *job)
+{
+    SmfiContextPrivate *priv;
+
+    if (n_callback_threads > 0 && !callback_threads) {
+        priv = SMFI_CONTEXT_GET_PRIVATE(job->context);
+        callback_threads = callback_threads_new(
+            milter_agent_get_event_loop(MILTER_AGENT(priv->client_context)));
+    }
+
+    if (!callback_threads || !callback_threads->pool)
+        return run_job(job);
+
+    priv = SMFI_CONTEXT_GET_PRIVATE(job->context);
+    g_queue_push_tail(&(priv->pending_jobs), job_copy(job));
+    start_next_job(job->context);
+
+    switch (job->type) {
+    case SMFI_JOB_ABORT:
+    case SMFI_JOB_CLOSE:
+        /* They don't have replies. */
+        return MILTER_STATUS_DEFAULT;
+    default:
+        return MILTER_STATUS_PROGRESS;
+    }
+}
+
 static MilterStatus
 cb_negotiate (MilterClientContext *context, MilterOption *option,
-              gpointer user_data)
+              MilterMacrosRequests *macros_requests, gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
-    gulong action, step, preserve1 = 0, preserve2 = 0;
-    gulong action_out, step_out, preserve1_out = 0, preserve2_out = 0;
+    SmfiJob job;
 
     if (!filter_description->xxfi_negotiate)
         return MILTER_STATUS_DEFAULT;
 
-    action = action_out = milter_option_get_action(option);
-    step = step_out = milter_option_get_step(option);
-    status = filter_description->xxfi_negotiate(smfi_context,
-                                                action, step,
-                                                preserve1, preserve2,
-                                                &action_out, &step_out,
-                                                &preserve1_out, &preserve2_out);
-    if (status == SMFIS_CONTINUE) {
-        milter_option_set_action(option, action_out);
-        milter_option_set_step(option, step_out);
-    }
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_NEGOTIATE);
+    job.option = option;
+    job.macros_requests = macros_requests;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
@@ -292,135 +801,125 @@ cb_connect (MilterClientContext *context, const gchar *host_name,
             struct sockaddr *address, socklen_t address_length,
             gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_connect)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_connect(smfi_context,
-                                              (gchar *)host_name,
-                                              address);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_CONNECT);
+    job.name = (gchar *)host_name;
+    job.address = address;
+    job.address_length = address_length;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_helo (MilterClientContext *context, const gchar *fqdn, gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_helo)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_helo(smfi_context, (gchar *)fqdn);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_HELO);
+    job.name = (gchar *)fqdn;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_envelope_from (MilterClientContext *context, const gchar *from,
                   gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
-    gchar *arguments[2];
+    SmfiJob job;
 
     if (!filter_description->xxfi_envfrom)
         return MILTER_STATUS_DEFAULT;
 
-    arguments[0] = (gchar *)from;
-    arguments[1] = NULL;
-
-    status = filter_description->xxfi_envfrom(smfi_context, arguments);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_ENVELOPE_FROM);
+    job.name = (gchar *)from;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_envelope_recipient (MilterClientContext *context, const gchar *recipient,
                        gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
-    gchar *arguments[2];
+    SmfiJob job;
 
     if (!filter_description->xxfi_envrcpt)
         return MILTER_STATUS_DEFAULT;
 
-    arguments[0] = (gchar *)recipient;
-    arguments[1] = NULL;
-
-    status = filter_description->xxfi_envrcpt(smfi_context, arguments);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_ENVELOPE_RECIPIENT);
+    job.name = (gchar *)recipient;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_data (MilterClientContext *context, gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_data)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_data(smfi_context);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_DATA);
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_unknown (MilterClientContext *context, const gchar *command,
             gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_unknown)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_unknown(smfi_context, command);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_UNKNOWN);
+    job.name = (gchar *)command;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_header (MilterClientContext *context, const gchar *name, const gchar *value,
            gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_header)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_header(smfi_context,
-                                             (gchar *)name,
-                                             (gchar *)value);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_HEADER);
+    job.name = (gchar *)name;
+    job.value = (gchar *)value;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_end_of_header (MilterClientContext *context, gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_eoh)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_eoh(smfi_context);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_END_OF_HEADER);
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_body (MilterClientContext *context, const guchar *chunk, gsize size,
          gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_body)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_body(smfi_context, (guchar *)chunk, size);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_BODY);
+    job.chunk = (gchar *)chunk;
+    job.chunk_size = size;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
@@ -428,37 +927,23 @@ cb_end_of_message (MilterClientContext *context,
                    const gchar *chunk, gsize size,
                    gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
-    if (chunk && size > 0 && filter_description->xxfi_body) {
-        status = filter_description->xxfi_body(smfi_context,
-                                               (guchar *)chunk, size);
-        switch (status) {
-        case SMFIS_REJECT:
-        case SMFIS_DISCARD:
-        case SMFIS_ACCEPT:
-        case SMFIS_TEMPFAIL:
-            return libmilter_compatible_convert_status_to(status);
-            break;
-        default:
-            break;
-        }
-    }
-
-    if (!filter_description->xxfi_eom)
+    if (!(chunk && size > 0 && filter_description->xxfi_body) &&
+        !filter_description->xxfi_eom)
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_eom(smfi_context);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_END_OF_MESSAGE);
+    job.chunk = (gchar *)chunk;
+    job.chunk_size = size;
+    return dispatch_job(&job);
 }
 
 static MilterStatus
 cb_abort (MilterClientContext *context, MilterClientContextState state,
           gpointer user_data)
 {
-    SmfiContext *smfi_context = user_data;
-    sfsistat status;
+    SmfiJob job;
 
     if (!filter_description->xxfi_abort)
         return MILTER_STATUS_DEFAULT;
@@ -466,18 +951,25 @@ cb_abort (MilterClientContext *context, MilterClientContextState state,
     if (!MILTER_CLIENT_CONTEXT_STATE_IN_MESSAGE_PROCESSING(state))
         return MILTER_STATUS_DEFAULT;
 
-    status = filter_description->xxfi_abort(smfi_context);
-    return libmilter_compatible_convert_status_to(status);
+    job_init(&job, user_data, SMFI_JOB_ABORT);
+    return dispatch_job(&job);
 }
 
 static void
 cb_finished (MilterFinishedEmittable *emittable, gpointer user_data)
 {
     SmfiContext *smfi_context = user_data;
+    SmfiJob job;
 
-    if (filter_description->xxfi_close)
-        filter_description->xxfi_close(smfi_context);
+    SMFI_CONTEXT_GET_PRIVATE(smfi_context)->finished = TRUE;
+    job_init(&job, smfi_context, SMFI_JOB_CLOSE);
+    if (callback_threads && callback_threads->pool) {
+        /* The session is unreferenced after xxfi_close. */
+        dispatch_job(&job);
+        return;
+    }
 
+    run_job(&job);
     g_object_unref(smfi_context);
 }
 
@@ -578,10 +1070,32 @@ setup_milter_client_event_loop_backend (MilterClient *client)
     milter_client_set_event_loop_backend(client, backend);
 }
 
+static void
+setup_callback_threads (void)
+{
+    const gchar *n_threads_env;
+    gchar *end = NULL;
+    guint64 n_threads;
+
+    n_threads_env = g_getenv("MILTER_N_CALLBACK_THREADS");
+    if (!n_threads_env)
+        return;
+
+    n_threads = g_ascii_strtoull(n_threads_env, &end, 10);
+    if (end == n_threads_env || *end != '\0' || n_threads > G_MAXINT) {
+        milter_error("invalid MILTER_N_CALLBACK_THREADS value: <%s>",
+                     n_threads_env);
+        return;
+    }
+
+    libmilter_compatible_set_n_callback_threads(n_threads);
+}
+
 static void
 setup_milter_client (MilterClient *client)
 {
     setup_milter_client_event_loop_backend(client);
+    setup_callback_threads();
     milter_client_set_connection_spec(client, connection_spec, NULL);
     milter_client_set_listen_channel(client, listen_channel);
     milter_client_set_listen_backlog(client, listen_backlog);
@@ -607,6 +1121,7 @@ smfi_main (void)
         milter_error("failed to run main loop: %s", error->message);
         g_error_free(error);
     }
+    callback_threads_stop();
     g_object_unref(client);
     client = NULL;
 
@@ -704,8 +1219,13 @@ smfi_stop (void)
 {
     libmilter_compatible_initialize();
 
-    if (client)
+    if (client) {
+        gboolean locked;
+
+        locked = lock_event_loop();
         milter_client_shutdown(client);
+        unlock_event_loop(locked);
+    }
     return MI_SUCCESS;
 }
 
@@ -814,14 +1334,18 @@ int
 smfi_addheader (SMFICTX *context, char *name, char *value)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_add_header(priv->client_context, name, value,
-                                         &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_add_header(priv->client_context,
+                                               name, value, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -836,14 +1360,18 @@ int
 smfi_chgheader (SMFICTX *context, char *name, int index, char *value)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_change_header(priv->client_context,
-                                            name, index, value, &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_change_header(priv->client_context,
+                                                  name, index, value, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -858,14 +1386,18 @@ int
 smfi_insheader (SMFICTX *context, int index, char *name, char *value)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_insert_header(priv->client_context,
-                                            index, name, value, &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_insert_header(priv->client_context,
+                                                  index, name, value, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -880,14 +1412,18 @@ int
 smfi_chgfrom (SMFICTX *context, char *mail, char *arguments)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_change_from(priv->client_context, mail, arguments,
-                                          &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_change_from(priv->client_context,
+                                                mail, arguments, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -902,14 +1438,18 @@ int
 smfi_addrcpt (SMFICTX *context, char *recipient)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_add_recipient(priv->client_context,
-                                            recipient, NULL, &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_add_recipient(priv->client_context,
+                                                  recipient, NULL, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -924,14 +1464,18 @@ int
 smfi_addrcpt_par (SMFICTX *context, char *recipient, char *args)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_add_recipient(priv->client_context,
-                                            recipient, args, &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_add_recipient(priv->client_context,
+                                                  recipient, args, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -946,14 +1490,18 @@ int
 smfi_delrcpt (SMFICTX *context, char *recipient)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_delete_recipient(priv->client_context, recipient,
-                                               &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_delete_recipient(priv->client_context,
+                                                     recipient, &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -968,12 +1516,16 @@ int
 smfi_progress (SMFICTX *context)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_progress(priv->client_context))
+    locked = lock_event_loop();
+    success = milter_client_context_progress(priv->client_context);
+    unlock_event_loop(locked);
+    if (success)
         return MI_SUCCESS;
     else
         return MI_FAILURE;
@@ -983,15 +1535,20 @@ int
 smfi_replacebody (SMFICTX *context, unsigned char *new_body, int new_body_size)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
     GError *error = NULL;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_replace_body(priv->client_context,
-                                           (char *)new_body, new_body_size,
-                                           &error)) {
+    locked = lock_event_loop();
+    success = milter_client_context_replace_body(priv->client_context,
+                                                 (char *)new_body,
+                                                 new_body_size,
+                                                 &error);
+    unlock_event_loop(locked);
+    if (success) {
         return MI_SUCCESS;
     } else {
         if (error) {
@@ -1006,12 +1563,16 @@ int
 smfi_quarantine (SMFICTX *context, char *reason)
 {
     SmfiContextPrivate *priv;
+    gboolean locked, success;
 
     priv = SMFI_CONTEXT_GET_PRIVATE(context);
     if (!priv->client_context)
         return MI_FAILURE;
 
-    if (milter_client_context_quarantine(priv->client_context, reason))
+    locked = lock_event_loop();
+    success = milter_client_context_quarantine(priv->client_context, reason);
+    unlock_event_loop(locked);
+    if (success)
         return MI_SUCCESS;
     else
         return MI_FAILURE;
@@ -1059,6 +1620,8 @@ smfi_setsymlist (SMFICTX *context, int state, char *macros)
 void
 libmilter_compatible_reset (void)
 {
+    callback_threads_stop();
+    n_callback_threads = 0;
     if (client)
         g_object_unref(client);
     client = NULL;
@@ -1073,6 +1636,21 @@ libmilter_compatible_reset (void)
     timeout = 7210;
 }
 
+/* 0 runs callbacks in the event loop. N runs them in up to
+ * N threads so that a blocking callback stalls only its
+ * session. */
+void
+libmilter_compatible_set_n_callback_threads (guint n_threads)
+{
+    n_callback_threads = n_threads;
+}
+
+guint
+libmilter_compatible_get_n_callback_threads (void)
+{
+    return n_callback_threads;
+}
+
 MilterStatus
 libmilter_compatible_convert_status_to (sfsistat status)
 {
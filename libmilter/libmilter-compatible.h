@@ -61,6 +61,10 @@ GType                smfi_context_get_type          (void) G_GNUC_CONST;
 SmfiContext         *smfi_context_new               (MilterClientContext *client_context);
 
 void                 libmilter_compatible_reset     (void);
+void                 libmilter_compatible_set_n_callback_threads
+                                                    (guint        n_threads);
+guint                libmilter_compatible_get_n_callback_threads
+                                                    (void);
 
 MilterStatus         libmilter_compatible_convert_status_to
                                                     (sfsistat     status);
@@ -2163,6 +2163,8 @@ milter_client_context_init (MilterClientContext *context)
                                                          g_str_equal,
                                                          g_free,
                                                          g_free);
+
+    milter_agent_set_batch_writes(MILTER_AGENT(context), TRUE);
 }
 
 static void
@@ -3278,9 +3280,30 @@ milter_client_context_reset_message_related_data (MilterClientContext *context)
 {
     MilterClientContextPrivate *priv;
     MilterProtocolAgent *agent;
+    MilterReader *reader;
 
     priv = MILTER_CLIENT_CONTEXT_GET_PRIVATE(context);
 
+    reader = milter_agent_get_reader(MILTER_AGENT(context));
+    if (reader && milter_reader_get_n_reads(reader) > 0) {
+        milter_statistics("[reader][message](%u): "
+                          "reads=<%u> bytes=<%" G_GSIZE_FORMAT ">",
+                          milter_agent_get_tag(MILTER_AGENT(context)),
+                          milter_reader_get_n_reads(reader),
+                          milter_reader_get_n_read_bytes(reader));
+        milter_reader_reset_statistics(reader);
+    }
+    if (milter_agent_get_n_writes(MILTER_AGENT(context)) > 0) {
+        MilterAgent *writing_agent = MILTER_AGENT(context);
+
+        milter_statistics("[writer][message](%u): "
+                          "packets=<%u> writes=<%u>",
+                          milter_agent_get_tag(writing_agent),
+                          milter_agent_get_n_written_packets(writing_agent),
+                          milter_agent_get_n_writes(writing_agent));
+        milter_agent_reset_write_statistics(writing_agent);
+    }
+
     agent = MILTER_PROTOCOL_AGENT(context);
     milter_protocol_agent_clear_message_related_macros(agent);
     milter_client_context_clear_mail_transaction_shelf(context);
@@ -4267,7 +4290,9 @@ decoder_new (MilterAgent *agent)
 {
     MilterDecoder *decoder;
 
-    decoder = milter_command_decoder_new();
+    decoder = milter_agent_take_cached_decoder(MILTER_TYPE_COMMAND_DECODER);
+    if (!decoder)
+        decoder = milter_command_decoder_new();
 
 #define CONNECT(name)                                                   \
     g_signal_connect(decoder, #name, G_CALLBACK(cb_decoder_ ## name),   \
@@ -4296,7 +4321,13 @@ decoder_new (MilterAgent *agent)
 static MilterEncoder *
 encoder_new (MilterAgent *agent)
 {
-    return milter_reply_encoder_new();
+    MilterEncoder *encoder;
+
+    encoder = milter_agent_take_cached_encoder(MILTER_TYPE_REPLY_ENCODER);
+    if (!encoder)
+        encoder = milter_reply_encoder_new();
+
+    return encoder;
 }
 
 static gboolean
@@ -4371,10 +4402,7 @@ milter_client_context_feed (MilterClientContext *context,
                             const gchar *chunk, gsize size,
                             GError **error)
 {
-    MilterDecoder *decoder;
-
-    decoder = milter_agent_get_decoder(MILTER_AGENT(context));
-    return milter_decoder_decode(decoder, chunk, size, error);
+    return milter_agent_decode(MILTER_AGENT(context), chunk, size, error);
 }
 
 void
@@ -4543,6 +4571,17 @@ milter_client_context_get_n_processing_sessions (MilterClientContext *context)
     return milter_client_get_n_processing_sessions(priv->client);
 }
 
+guint
+milter_client_context_get_n_total_processing_sessions (MilterClientContext *context)
+{
+    MilterClientContextPrivate *priv;
+
+    priv = MILTER_CLIENT_CONTEXT_GET_PRIVATE(context);
+    if (!priv->client)
+        return 0;
+    return milter_client_get_n_total_processing_sessions(priv->client);
+}
+
 void
 milter_client_context_set_packet_buffer_size (MilterClientContext *context,
                                               guint size)
@@ -999,6 +999,21 @@ void                 milter_client_context_reset_message_related_data
 guint                milter_client_context_get_n_processing_sessions
                                                        (MilterClientContext  *context);
 
+/**
+ * milter_client_context_get_n_total_processing_sessions:
+ * @context: a %MilterClientContext.
+ *
+ * Returns number of the current processing sessions of all
+ * worker processes.
+ *
+ * Returns: number of the current processing sessions of all
+ * worker processes.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_context_get_n_total_processing_sessions
+                                                       (MilterClientContext  *context);
+
 /**
  * milter_client_context_set_packet_buffer_size:
  * @context: a %MilterClientContext.
@@ -449,6 +449,53 @@ parse_n_workers (const gchar *option_name,
     return TRUE;
 }
 
+static gboolean
+parse_n_event_loop_threads (const gchar *option_name,
+                            const gchar *value,
+                            gpointer data,
+                            GError **error)
+{
+    MilterClient *client = data;
+    gchar *end;
+    glong n_threads;
+
+    errno = 0;
+    n_threads = strtol(value, &end, 0);
+
+    if (end[0] != '\0') {
+        set_invalid_integer_value_error(error, option_name, value, end);
+        return FALSE;
+    }
+
+    if (n_threads > MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS || errno == ERANGE) {
+        g_set_error(error,
+                    G_OPTION_ERROR,
+                    G_OPTION_ERROR_BAD_VALUE,
+                    _("%s: too big: <%s>: parsed=<%ld>, max=<%d>"),
+                    option_name,
+                    value,
+                    n_threads,
+                    MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS);
+      return FALSE;
+    }
+
+    milter_client_set_n_event_loop_threads(client, n_threads);
+
+    return TRUE;
+}
+
+static gboolean
+parse_reuse_port (const gchar *option_name,
+                  const gchar *value,
+                  gpointer data,
+                  GError **error)
+{
+    MilterClient *client = data;
+
+    milter_client_set_reuse_port(client, TRUE);
+    return TRUE;
+}
+
 static gboolean
 parse_event_loop_backend (const gchar *option_name,
                           const gchar *value,
@@ -645,6 +692,13 @@ static const GOptionEntry option_entries[] =
      N_("Change UNIX domain socket mode to MODE (default: 0660)"), "MODE"},
     {"n-workers", 0, 0, G_OPTION_ARG_CALLBACK, parse_n_workers,
      N_("Run N_WORKERS processes (default: 0)"), "N_WORKERS"},
+    {"n-event-loop-threads", 0, 0, G_OPTION_ARG_CALLBACK,
+     parse_n_event_loop_threads,
+     N_("Run N_THREADS event loop threads in each process (default: 0)"),
+     "N_THREADS"},
+    {"reuse-port", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+     parse_reuse_port,
+     N_("Listen on a socket for each worker by SO_REUSEPORT"), NULL},
     {"event-loop-backend", 0, 0, G_OPTION_ARG_CALLBACK, parse_event_loop_backend,
      N_("Use BACKEND as event loop backend (glib|libev) (default: glib)"),
      "BACKEND"},
@@ -27,6 +27,11 @@
 #include <pwd.h>
 #include <grp.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <signal.h>
+#ifdef __linux__
+#  include <sys/epoll.h>
+#endif
 
 #include <errno.h>
 
@@ -52,7 +57,8 @@ enum
     PROP_SYSLOG_FACILITIY,
     PROP_START_SYSLOG,
     PROP_RUN_AS_DAEMON,
-    PROP_MAX_PENDING_FINISHED_SESSIONS
+    PROP_MAX_PENDING_FINISHED_SESSIONS,
+    PROP_N_EVENT_LOOP_THREADS
 };
 
 enum
@@ -64,11 +70,31 @@ enum
     EVENT_LOOP_CREATED,
     WORKERS_CREATED,
     WORKER_CREATED,
+    WORKER_EXITED,
     LAST_SIGNAL
 };
 
 static gint signals[LAST_SIGNAL] = {0};
 
+#define WORKER_STATS_SLOT_SIZE 64
+#define WORKER_STATS_ALIGN(size)                                        \
+    ((((size) + WORKER_STATS_SLOT_SIZE - 1) / WORKER_STATS_SLOT_SIZE) *  \
+     WORKER_STATS_SLOT_SIZE)
+
+/* One slot per process. A slot is written only by its owner
+ * and is cache line sized to avoid false sharing. The data
+ * reserved by milter_client_set_worker_data_size() follows
+ * the session counts in the same slot. */
+typedef union _MilterClientWorkerStats MilterClientWorkerStats;
+union _MilterClientWorkerStats
+{
+    struct {
+        gint n_processing_sessions;
+        gint n_processed_sessions;
+    } sessions;
+    gchar padding[WORKER_STATS_SLOT_SIZE];
+};
+
 #define MILTER_CLIENT_GET_PRIVATE(obj)                  \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
                                  MILTER_TYPE_CLIENT,    \
@@ -82,8 +108,10 @@ struct _MilterClientPrivate
     MilterEventLoop *event_loop;
     guint accept_watch_id;
     guint accept_error_watch_id;
+    GIOChannel *exclusive_accept_channel;
     gchar *connection_spec;
     GList *processing_data;
+    GMutex processing_data_mutex;
     guint n_processing_sessions;
     guint n_processed_sessions;
     guint maintenance_interval;
@@ -100,13 +128,27 @@ struct _MilterClientPrivate
     gboolean remove_unix_socket_on_create;
     guint suspend_time_on_unacceptable;
     guint max_connections;
-    gboolean multi_thread_mode;
-    GThreadPool *worker_threads;
+    gboolean reuse_port;
+    struct {
+        guint n_threads;
+        GPtrArray *threads;
+        guint next_thread;
+        GIOChannel *request_channel;
+        gint request_fd;
+        guint request_watch_id;
+        guint requests;
+    } event_loop_threads;
     struct {
         GIOChannel *control;
         guint n_process;
         guint id;
         GArray *pids;
+        gchar *stats;
+        guint n_stats;
+        gsize stats_size;
+        gsize data_size;
+        gboolean stats_shared;
+        GPtrArray *listen_channels;
     } workers;
     struct sockaddr *address;
     socklen_t address_size;
@@ -133,12 +175,40 @@ struct _MilterClientPrivate
     guint max_pending_finished_sessions;
 };
 
+/* An event loop thread owns the sessions passed to it. Only
+ * pending_channels, quitting and n_sessions are shared with
+ * other threads. */
+typedef struct _MilterClientEventLoopThread MilterClientEventLoopThread;
+struct _MilterClientEventLoopThread
+{
+    MilterClient *client;
+    guint id;
+    GThread *thread;
+    MilterEventLoop *loop;
+    GMutex mutex;
+    GQueue pending_channels;
+    gboolean quitting;
+    GIOChannel *notify_channel;
+    gint notify_fd;
+    guint notify_watch_id;
+    gint n_sessions;
+    GPtrArray *finished_data;
+    guint finisher_id;
+};
+
+/* Requests from event loop threads to the main event loop. */
+#define MAIN_LOOP_REQUEST_MAINTAIN   (1 << 0)
+#define MAIN_LOOP_REQUEST_CHECK_QUIT (1 << 1)
+
+static GPrivate current_event_loop_thread = G_PRIVATE_INIT(NULL);
+
 typedef struct _MilterClientProcessData
 {
     MilterClientPrivate *priv;
     MilterClient *client;
     MilterClientContext *context;
     gulong finished_handler_id;
+    MilterClientEventLoopThread *thread;
 } MilterClientProcessData;
 
 typedef gboolean (*AcceptConnectionFunction) (MilterClient *client, gint fd);
@@ -223,6 +293,9 @@ static void         set_max_pending_finished_sessions
                             guint            n_sessions);
 static GArray      *get_worker_pids
                            (MilterClient    *client);
+static void         worker_exited
+                           (MilterClient    *client,
+                            guint            worker_id);
 
 static void
 _milter_client_class_init (MilterClientClass *klass)
@@ -264,6 +337,7 @@ _milter_client_class_init (MilterClientClass *klass)
     client_class->set_max_pending_finished_sessions
                                          = set_max_pending_finished_sessions;
     client_class->get_worker_pids        = get_worker_pids;
+    client_class->worker_exited          = worker_exited;
 
     spec = g_param_spec_string("connection-spec",
                                "Connection Spec",
@@ -380,6 +454,14 @@ _milter_client_class_init (MilterClientClass *klass)
     g_object_class_install_property(gobject_class,
                                     PROP_MAX_PENDING_FINISHED_SESSIONS, spec);
 
+    spec = g_param_spec_uint("n-event-loop-threads",
+                             "Number of event loop threads",
+                             "The number of event loop threads of the client",
+                             0, MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS, 0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_N_EVENT_LOOP_THREADS, spec);
+
     signals[CONNECTION_ESTABLISHED] =
         g_signal_new("connection-established",
                      MILTER_TYPE_CLIENT,
@@ -443,6 +525,15 @@ _milter_client_class_init (MilterClientClass *klass)
                      NULL,
                      G_TYPE_NONE, 0);
 
+    signals[WORKER_EXITED] =
+        g_signal_new("worker-exited",
+                     MILTER_TYPE_CLIENT,
+                     G_SIGNAL_RUN_LAST,
+                     G_STRUCT_OFFSET(MilterClientClass, worker_exited),
+                     NULL, NULL,
+                     NULL,
+                     G_TYPE_NONE, 1, G_TYPE_UINT);
+
     g_type_class_add_private(gobject_class, sizeof(MilterClientPrivate));
 }
 
@@ -491,8 +582,10 @@ _milter_client_init (MilterClient *client)
 
     priv->accept_watch_id = 0;
     priv->accept_error_watch_id = 0;
+    priv->exclusive_accept_channel = NULL;
     priv->connection_spec = NULL;
     priv->processing_data = NULL;
+    g_mutex_init(&(priv->processing_data_mutex));
     priv->n_processing_sessions = 0;
     priv->n_processed_sessions = 0;
     priv->maintenance_interval = 0;
@@ -510,12 +603,24 @@ _milter_client_init (MilterClient *client)
     priv->suspend_time_on_unacceptable =
         MILTER_CLIENT_DEFAULT_SUSPEND_TIME_ON_UNACCEPTABLE;
     priv->max_connections = MILTER_CLIENT_DEFAULT_MAX_CONNECTIONS;
-    priv->multi_thread_mode = FALSE;
-    priv->worker_threads = NULL;
+    priv->reuse_port = FALSE;
+    priv->event_loop_threads.n_threads = 0;
+    priv->event_loop_threads.threads = NULL;
+    priv->event_loop_threads.next_thread = 0;
+    priv->event_loop_threads.request_channel = NULL;
+    priv->event_loop_threads.request_fd = -1;
+    priv->event_loop_threads.request_watch_id = 0;
+    priv->event_loop_threads.requests = 0;
     priv->workers.n_process = 0;
     priv->workers.id = 0;
     priv->workers.control = NULL;
     priv->workers.pids = NULL;
+    priv->workers.stats = NULL;
+    priv->workers.n_stats = 0;
+    priv->workers.stats_size = 0;
+    priv->workers.data_size = 0;
+    priv->workers.stats_shared = FALSE;
+    priv->workers.listen_channels = NULL;
     priv->address = NULL;
     priv->address_size = 0;
     priv->effective_user = NULL;
@@ -579,6 +684,22 @@ dispose_finisher (MilterClientPrivate *priv)
     }
 }
 
+static void
+add_processing_data (MilterClientPrivate *priv, MilterClientProcessData *data)
+{
+    g_mutex_lock(&(priv->processing_data_mutex));
+    priv->processing_data = g_list_prepend(priv->processing_data, data);
+    g_mutex_unlock(&(priv->processing_data_mutex));
+}
+
+static void multi_thread_request_main_loop (MilterClientPrivate *priv,
+                                            guint request);
+static void multi_thread_stop_event_loop_threads (MilterClient *client);
+static void process_client_channel (MilterClient *client,
+                                    GIOChannel *channel,
+                                    MilterGenericSocketAddress *address,
+                                    socklen_t address_size);
+
 static void
 finish_processing (MilterClientProcessData *data)
 {
@@ -591,11 +712,19 @@ finish_processing (MilterClientProcessData *data)
         milter_debug("[%u] [client][finish]", tag);
     }
 
+    g_mutex_lock(&(data->priv->processing_data_mutex));
     data->priv->processing_data =
         g_list_remove(data->priv->processing_data, data);
+    g_mutex_unlock(&(data->priv->processing_data_mutex));
     milter_client_session_finished(data->client);
 
-    if (data->priv->quitting && data->priv->event_loop) {
+    if (data->thread) {
+        g_atomic_int_add(&(data->thread->n_sessions), -1);
+        /* The main event loop must be quitted in its thread. */
+        if (data->priv->quitting)
+            multi_thread_request_main_loop(data->priv,
+                                           MAIN_LOOP_REQUEST_CHECK_QUIT);
+    } else if (data->priv->quitting && data->priv->event_loop) {
         n_processing_sessions = data->priv->n_processing_sessions;
         g_mutex_lock(&(data->priv->quit_mutex));
         if (data->priv->quitting && n_processing_sessions == 0) {
@@ -606,11 +735,11 @@ finish_processing (MilterClientProcessData *data)
     }
 
     if (milter_need_debug_log()) {
-        GList *processing_data, *process_data;
+        GList *process_data;
 
-        processing_data = g_list_copy(data->priv->processing_data);
         rest_process = g_string_new("[");
-        for (process_data = processing_data;
+        g_mutex_lock(&(data->priv->processing_data_mutex));
+        for (process_data = data->priv->processing_data;
              process_data;
              process_data = g_list_next(process_data)) {
             MilterClientProcessData *_process_data = process_data->data;
@@ -618,10 +747,10 @@ finish_processing (MilterClientProcessData *data)
                 rest_process, "<%u>, ",
                 milter_agent_get_tag(MILTER_AGENT(_process_data->context)));
         }
-        if (processing_data)
+        if (data->priv->processing_data)
             g_string_truncate(rest_process, rest_process->len - 2);
+        g_mutex_unlock(&(data->priv->processing_data_mutex));
         g_string_append(rest_process, "]");
-        g_list_free(processing_data);
         milter_debug("[%u] [client][rest] %s", tag, rest_process->str);
         g_string_free(rest_process, TRUE);
     }
@@ -669,37 +798,149 @@ milter_client_need_maintain (MilterClient *client, guint n_finished_sessions)
 }
 
 static void
-dispose_finished_data (MilterClient *client)
+finish_processing_data (MilterClient *client, GPtrArray *finished_data)
 {
     MilterClientPrivate *priv;
-    guint n_processed_sessions_before, n_finished_sessions;
+    guint n_finished_sessions;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    if (!priv->finished_data)
-        return;
 
-    n_processed_sessions_before = priv->n_processed_sessions;
-    g_ptr_array_foreach(priv->finished_data, (GFunc)finish_processing, NULL);
-    g_ptr_array_free(priv->finished_data, TRUE);
-    priv->finished_data = NULL;
-    n_finished_sessions =
-        priv->n_processed_sessions - n_processed_sessions_before;
+    n_finished_sessions = finished_data->len;
+    g_ptr_array_foreach(finished_data, (GFunc)finish_processing, NULL);
+    g_ptr_array_free(finished_data, TRUE);
     g_signal_emit(client, signals[SESSIONS_FINISHED], 0, n_finished_sessions);
 
-    milter_statistics("[sessions][finished] %u(+%u) %u",
-                      priv->n_processed_sessions,
-                      n_finished_sessions,
-                      priv->n_processing_sessions);
+    if (priv->workers.stats) {
+        milter_statistics("[sessions][finished] %u(+%u) %u [total] %u %u",
+                          priv->n_processed_sessions,
+                          n_finished_sessions,
+                          priv->n_processing_sessions,
+                          milter_client_get_n_total_processed_sessions(client),
+                          milter_client_get_n_total_processing_sessions(client));
+    } else {
+        milter_statistics("[sessions][finished] %u(+%u) %u",
+                          priv->n_processed_sessions,
+                          n_finished_sessions,
+                          priv->n_processing_sessions);
+    }
     if (milter_client_need_maintain(client, n_finished_sessions)) {
-        g_signal_emit(client, signals[MAINTAIN], 0);
+        if (g_private_get(&current_event_loop_thread)) {
+            multi_thread_request_main_loop(priv, MAIN_LOOP_REQUEST_MAINTAIN);
+        } else {
+            g_signal_emit(client, signals[MAINTAIN], 0);
+        }
     }
 }
 
+static void
+dispose_finished_data (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    GPtrArray *finished_data;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->finished_data)
+        return;
+
+    finished_data = priv->finished_data;
+    priv->finished_data = NULL;
+    finish_processing_data(client, finished_data);
+}
+
 static void
 watch_worker_process (GPid     pid,
                       gint     status,
                       gpointer data)
 {
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+    guint i;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.pids)
+        return;
+
+    for (i = 0; i < priv->workers.pids->len; i++) {
+        if (g_array_index(priv->workers.pids, GPid, i) != pid)
+            continue;
+        milter_debug("[client][worker][exited] [%u] pid=<%d>", i + 1, pid);
+        g_signal_emit(client, signals[WORKER_EXITED], 0, i + 1);
+        break;
+    }
+}
+
+static gsize
+get_worker_stats_slot_size (MilterClientPrivate *priv)
+{
+    return sizeof(MilterClientWorkerStats) +
+        WORKER_STATS_ALIGN(priv->workers.data_size);
+}
+
+static MilterClientWorkerStats *
+get_worker_stats (MilterClientPrivate *priv, guint worker_id)
+{
+    if (!priv->workers.stats || worker_id >= priv->workers.n_stats)
+        return NULL;
+    return (MilterClientWorkerStats *)
+        (priv->workers.stats + get_worker_stats_slot_size(priv) * worker_id);
+}
+
+static void
+dispose_worker_stats (MilterClientPrivate *priv)
+{
+    if (priv->workers.stats) {
+        if (priv->workers.stats_shared)
+            munmap(priv->workers.stats, priv->workers.stats_size);
+        else
+            g_free(priv->workers.stats);
+        priv->workers.stats = NULL;
+        priv->workers.n_stats = 0;
+        priv->workers.stats_size = 0;
+        priv->workers.stats_shared = FALSE;
+    }
+}
+
+/* The segment must be mapped before workers are forked so
+ * that every worker shares it. */
+static void
+ensure_worker_stats (MilterClientPrivate *priv, guint n_workers)
+{
+    MilterClientWorkerStats *stats;
+    gpointer segment;
+
+    if (priv->workers.stats && priv->workers.n_stats == n_workers + 1)
+        return;
+
+    dispose_worker_stats(priv);
+
+    priv->workers.n_stats = n_workers + 1;
+    priv->workers.stats_size =
+        get_worker_stats_slot_size(priv) * priv->workers.n_stats;
+    segment = mmap(NULL, priv->workers.stats_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (segment == MAP_FAILED) {
+        milter_error("[client][workers][stats][error] "
+                     "failed to map shared statistics: "
+                     "<%" G_GSIZE_FORMAT ">: %s",
+                     priv->workers.stats_size, g_strerror(errno));
+        priv->workers.stats = g_malloc0(priv->workers.stats_size);
+        priv->workers.stats_shared = FALSE;
+    } else {
+        priv->workers.stats = segment;
+        priv->workers.stats_shared = TRUE;
+    }
+
+    stats = get_worker_stats(priv, priv->workers.id);
+    g_atomic_int_set(&(stats->sessions.n_processing_sessions),
+                     priv->n_processing_sessions);
+    g_atomic_int_set(&(stats->sessions.n_processed_sessions),
+                     priv->n_processed_sessions);
+}
+
+static MilterClientWorkerStats *
+get_own_worker_stats (MilterClientPrivate *priv)
+{
+    return get_worker_stats(priv, priv->workers.id);
 }
 
 static void
@@ -724,6 +965,20 @@ dispose_accept_watchers (MilterClientPrivate *priv)
         }
         priv->accept_error_watch_id = 0;
     }
+
+    if (priv->exclusive_accept_channel) {
+        g_io_channel_unref(priv->exclusive_accept_channel);
+        priv->exclusive_accept_channel = NULL;
+    }
+}
+
+static void
+dispose_worker_listen_channels (MilterClientPrivate *priv)
+{
+    if (priv->workers.listen_channels) {
+        g_ptr_array_free(priv->workers.listen_channels, TRUE);
+        priv->workers.listen_channels = NULL;
+    }
 }
 
 static void
@@ -743,6 +998,7 @@ finalize (GObject *object)
     priv = MILTER_CLIENT_GET_PRIVATE(object);
 
     g_mutex_clear(&(priv->quit_mutex));
+    g_mutex_clear(&(priv->processing_data_mutex));
 
     G_OBJECT_CLASS(_milter_client_parent_class)->finalize(object);
 }
@@ -764,6 +1020,8 @@ dispose (GObject *object)
         priv->workers.pids = NULL;
     }
 
+    dispose_worker_listen_channels(priv);
+
     if (priv->listening_channel) {
         g_io_channel_unref(priv->listening_channel);
         priv->listening_channel = NULL;
@@ -771,6 +1029,8 @@ dispose (GObject *object)
 
     dispose_accept_watchers(priv);
 
+    multi_thread_stop_event_loop_threads(MILTER_CLIENT(object));
+
     if (priv->accept_loop) {
         g_object_unref(priv->accept_loop);
         priv->accept_loop = NULL;
@@ -807,11 +1067,6 @@ dispose (GObject *object)
         priv->default_unix_socket_group = NULL;
     }
 
-    if (priv->worker_threads) {
-        g_thread_pool_free(priv->worker_threads, TRUE, FALSE);
-        priv->worker_threads = NULL;
-    }
-
     dispose_address(priv);
 
     if (priv->effective_user) {
@@ -826,6 +1081,7 @@ dispose (GObject *object)
 
     dispose_finisher(priv);
     dispose_finished_data(MILTER_CLIENT(object));
+    dispose_worker_stats(priv);
 
     if (priv->pid_file) {
         g_free(priv->pid_file);
@@ -905,6 +1161,9 @@ set_property (GObject      *object,
         milter_client_set_max_pending_finished_sessions(client,
                                                         g_value_get_uint(value));
         break;
+    case PROP_N_EVENT_LOOP_THREADS:
+        milter_client_set_n_event_loop_threads(client, g_value_get_uint(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -969,6 +1228,9 @@ get_property (GObject    *object,
         g_value_set_uint(value,
                          milter_client_get_max_pending_finished_sessions(client));
         break;
+    case PROP_N_EVENT_LOOP_THREADS:
+        g_value_set_uint(value, milter_client_get_n_event_loop_threads(client));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -1233,21 +1495,19 @@ milter_client_start_context (MilterClient *client,
                              MilterGenericSocketAddress *address,
                              GError **error)
 {
-    MilterClientPrivate *priv;
     MilterAgent *agent;
     MilterWriter *writer;
     MilterReader *reader;
 
     agent = MILTER_AGENT(context);
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    milter_agent_set_event_loop(agent, priv->event_loop);
+    milter_agent_set_event_loop(agent, milter_client_get_event_loop(client));
 
-    writer = milter_writer_io_channel_new(channel);
+    writer = milter_writer_unix_io_channel_new(channel);
     milter_agent_set_writer(agent, writer);
     g_object_unref(writer);
 
-    reader = milter_reader_io_channel_new(channel);
+    reader = milter_reader_unix_io_channel_new(channel);
     milter_agent_set_reader(agent, reader);
     g_object_unref(reader);
 
@@ -1284,6 +1544,7 @@ single_thread_client_channel_setup (MilterClient *client,
     data->priv = priv;
     data->client = client;
     data->context = context;
+    data->thread = NULL;
 
     milter_debug("[%u] [client][single-thread][start]",
                  milter_agent_get_tag(agent));
@@ -1292,7 +1553,7 @@ single_thread_client_channel_setup (MilterClient *client,
         g_signal_connect(context, "finished",
                          G_CALLBACK(single_thread_cb_finished), data);
 
-    priv->processing_data = g_list_prepend(priv->processing_data, data);
+    add_processing_data(priv, data);
 
     if (milter_client_start_context(client, context, channel, address, &error)) {
         g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
@@ -1356,7 +1617,9 @@ accept_connection_fd (MilterClient *client, gint server_fd,
     suspend_time = milter_client_get_suspend_time_on_unacceptable(client);
     max_connections = milter_client_get_max_connections(client);
     for (n_suspend = 0;
-         0 < max_connections && max_connections <= priv->n_processing_sessions;
+         0 < max_connections &&
+         max_connections <=
+             (guint)g_atomic_int_get(&(priv->n_processing_sessions));
          n_suspend++) {
         milter_warning("[client][accept][suspend] "
                        "too many processing connection: %u, max: %u; "
@@ -1450,8 +1713,8 @@ single_thread_accept_connection (MilterClient *client, gint server_fd)
     accepted = accept_connection(client, server_fd, &client_channel,
                                  &address, &address_size);
     if (accepted) {
-        single_thread_process_client_channel(client, client_channel,
-                                             &address, address_size);
+        process_client_channel(client, client_channel,
+                               &address, address_size);
         g_io_channel_unref(client_channel);
     }
 
@@ -1554,218 +1817,616 @@ single_thread_start_accept (MilterClient *client, GError **error)
 }
 
 static void
-multi_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
-                                     MilterGenericSocketAddress *address,
-                                     socklen_t address_size)
+multi_thread_notify (gint fd)
 {
-    MilterClientPrivate *priv;
-    MilterClientContext *context;
-    MilterClientProcessData *data;
-    GError *error = NULL;
+    ssize_t written;
 
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    /* A full pipe is OK. The reader hasn't read the previous
+     * notification yet. */
+    do {
+        written = write(fd, "", 1);
+    } while (written == -1 && errno == EINTR);
+}
 
-    context = milter_client_create_context(client);
+static void
+multi_thread_drain (GIOChannel *channel)
+{
+    gchar buffer[64];
+    gint fd;
+    ssize_t size;
 
-    data = g_new(MilterClientProcessData, 1);
-    data->priv = priv;
-    data->client = client;
-    data->context = context;
-    data->finished_handler_id = 0;
+    fd = g_io_channel_unix_get_fd(channel);
+    do {
+        size = read(fd, buffer, sizeof(buffer));
+    } while (size > 0 || (size == -1 && errno == EINTR));
+}
 
-    priv->processing_data = g_list_prepend(priv->processing_data, data);
-    if (milter_client_start_context(client, context, channel, address, &error)) {
-        g_thread_pool_push(priv->worker_threads, data, &error);
-        if (error) {
-            GError *client_error;
-
-            client_error = g_error_new(MILTER_CLIENT_ERROR,
-                                       MILTER_CLIENT_ERROR_THREAD,
-                                       "failed to push a data to thread pool: %s",
-                                       error->message);
-            g_error_free(error);
-            milter_error("[%u] [client][multi-thread][error] %s",
-                         milter_agent_get_tag(MILTER_AGENT(context)),
-                         client_error->message);
-            milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(client),
-                                        client_error);
-            g_error_free(client_error);
-            milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
-        }
-    } else {
-        milter_error("[%u] [client][multi-thread][start][error] %s",
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(context), error);
-        g_error_free(error);
-        milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
+static gboolean
+multi_thread_open_pipe (gint *pipe_fds, GError **error)
+{
+    guint i;
+
+    if (pipe(pipe_fds) == -1) {
+        g_set_error(error,
+                    MILTER_CLIENT_ERROR,
+                    MILTER_CLIENT_ERROR_THREAD,
+                    "failed to create a pipe for event loop threads: %s",
+                    g_strerror(errno));
+        milter_error("[client][multi-thread][pipe][error] %s",
+                     g_strerror(errno));
+        return FALSE;
     }
 
-    g_io_channel_unref(channel);
+    for (i = 0; i < 2; i++) {
+        fcntl(pipe_fds[i], F_SETFL, fcntl(pipe_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(pipe_fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    return TRUE;
+}
+
+static void
+multi_thread_request_main_loop (MilterClientPrivate *priv, guint request)
+{
+    guint requests;
+
+    requests = g_atomic_int_or(&(priv->event_loop_threads.requests), request);
+    if (requests == 0 && priv->event_loop_threads.request_fd != -1)
+        multi_thread_notify(priv->event_loop_threads.request_fd);
 }
 
 static gboolean
-multi_thread_accept_connection (MilterClient *client, gint server_fd)
+multi_thread_cb_main_loop_request (GIOChannel *channel, GIOCondition condition,
+                                   gpointer user_data)
 {
-    gboolean accepted;
-    GIOChannel *client_channel;
-    MilterGenericSocketAddress address;
-    socklen_t address_size;
+    MilterClient *client = user_data;
+    MilterClientPrivate *priv;
+    guint requests;
 
-    accepted = accept_connection(client, server_fd, &client_channel,
-                                 &address, &address_size);
-    if (accepted) {
-        multi_thread_process_client_channel(client, client_channel,
-                                            &address, address_size);
-        g_io_channel_unref(client_channel);
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    multi_thread_drain(channel);
+    requests = g_atomic_int_and(&(priv->event_loop_threads.requests), 0);
+
+    if (requests & MAIN_LOOP_REQUEST_MAINTAIN) {
+        milter_debug("[client][multi-thread][maintain]");
+        g_signal_emit(client, signals[MAINTAIN], 0);
+    }
+
+    if (requests & MAIN_LOOP_REQUEST_CHECK_QUIT) {
+        g_mutex_lock(&(priv->quit_mutex));
+        if (priv->quitting &&
+            g_atomic_int_get(&(priv->n_processing_sessions)) == 0) {
+            milter_debug("[client][multi-thread][loop][quit]");
+            milter_event_loop_quit(priv->event_loop);
+        }
+        g_mutex_unlock(&(priv->quit_mutex));
     }
 
     return TRUE;
 }
 
 static gboolean
-multi_thread_accept_watch_func (GIOChannel *channel, GIOCondition condition,
-                                gpointer data)
+multi_thread_finisher (gpointer user_data)
 {
-    MilterClient *client = data;
-    gboolean keep_callback = TRUE;
-    gint fd;
+    MilterClientEventLoopThread *thread = user_data;
+    GPtrArray *finished_data;
 
-    fd = g_io_channel_unix_get_fd(channel);
-    keep_callback = multi_thread_accept_connection(client, fd);
-    if (!keep_callback)
-        milter_client_shutdown(client);
-    return keep_callback;
+    milter_debug("[client][multi-thread][%u][finisher][idle][run]",
+                 thread->id);
+
+    thread->finisher_id = 0;
+    finished_data = thread->finished_data;
+    thread->finished_data = NULL;
+    if (finished_data)
+        finish_processing_data(thread->client, finished_data);
+
+    return FALSE;
 }
 
 static void
 multi_thread_cb_finished (MilterClientContext *context, gpointer _data)
 {
     MilterClientProcessData *data = _data;
+    MilterClientEventLoopThread *thread = data->thread;
 
-    finish_processing(data);
+    dispose_process_data_finished_handler(data);
+    if (!thread->finished_data)
+        thread->finished_data = g_ptr_array_new();
+    g_ptr_array_add(thread->finished_data, data);
+
+    if (thread->finisher_id == 0) {
+        thread->finisher_id =
+            milter_event_loop_add_idle_full(thread->loop,
+                                            G_PRIORITY_DEFAULT,
+                                            multi_thread_finisher,
+                                            thread,
+                                            NULL);
+    }
 }
 
 static void
-multi_thread_process_client_channel_thread (gpointer data_, gpointer user_data)
+multi_thread_client_channel_setup (MilterClientEventLoopThread *thread,
+                                   GIOChannel *channel,
+                                   MilterGenericSocketAddress *address)
 {
+    MilterClient *client = thread->client;
+    MilterClientPrivate *priv;
     MilterAgent *agent;
     MilterClientContext *context;
-    MilterClient *client = data_;
-    MilterClientProcessData *data = user_data;
-    MilterEventLoop *event_loop;
+    MilterClientProcessData *data;
     GError *error = NULL;
 
-    event_loop = milter_client_create_event_loop(client, FALSE);
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    context = MILTER_CLIENT_CONTEXT(data->context);
+    context = milter_client_create_context(client);
     agent = MILTER_AGENT(context);
-    milter_debug("[%u] [client][multi-thread][start]",
-                 milter_agent_get_tag(agent));
+
+    data = g_new(MilterClientProcessData, 1);
+    data->priv = priv;
+    data->client = client;
+    data->context = context;
+    data->thread = thread;
+
+    milter_debug("[%u] [client][multi-thread][%u][start]",
+                 milter_agent_get_tag(agent), thread->id);
 
     data->finished_handler_id =
-        g_signal_connect(data->context, "finished",
+        g_signal_connect(context, "finished",
                          G_CALLBACK(multi_thread_cb_finished), data);
 
-    milter_agent_set_event_loop(agent, event_loop);
-    if (milter_agent_start(agent, &error)) {
+    add_processing_data(priv, data);
+
+    if (milter_client_start_context(client, context, channel, address, &error)) {
         g_signal_emit(client, signals[CONNECTION_ESTABLISHED], 0, context);
-        milter_event_loop_run(event_loop);
     } else {
-        milter_error("[%u] [client][multi-thread][start][error] %s",
-                     milter_agent_get_tag(agent), error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(client),
-                                    error);
+        milter_error("[%u] [client][multi-thread][%u][start][error] %s",
+                     milter_agent_get_tag(agent), thread->id, error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(agent), error);
         g_error_free(error);
         milter_finished_emittable_emit(MILTER_FINISHED_EMITTABLE(context));
     }
-
-    g_object_unref(event_loop);
 }
 
 static gboolean
-multi_thread_start_accept (MilterClient *client, GError **error)
+multi_thread_cb_notify (GIOChannel *channel, GIOCondition condition,
+                        gpointer user_data)
 {
-    MilterClientPrivate *priv;
-    gint max_threads = 10;
-    GError *local_error = NULL;
+    MilterClientEventLoopThread *thread = user_data;
+    GQueue pending_channels = G_QUEUE_INIT;
+    ClientChannelSetupData *setup_data;
+    gboolean quitting;
 
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->worker_threads =
-        g_thread_pool_new(multi_thread_process_client_channel_thread,
-                          client,
-                          max_threads,
-                          FALSE,
-                          &local_error);
-    if (!priv->worker_threads) {
-        GError *client_error;
-        client_error = g_error_new(MILTER_CLIENT_ERROR,
-                                   MILTER_CLIENT_ERROR_THREAD,
-                                   "failed to create a thread pool "
-                                   "for processing accepted connection: %s",
-                                   local_error->message);
-        g_error_free(local_error);
-        milter_error("[client][multi-thread][accept][error] %s",
-                     client_error->message);
-        g_propagate_error(error, client_error);
-        return FALSE;
+    /* Drain before taking channels. Otherwise a notification
+     * for a channel pushed after taking may be lost. */
+    multi_thread_drain(channel);
+
+    g_mutex_lock(&(thread->mutex));
+    pending_channels = thread->pending_channels;
+    g_queue_init(&(thread->pending_channels));
+    quitting = thread->quitting;
+    g_mutex_unlock(&(thread->mutex));
+
+    while ((setup_data = g_queue_pop_head(&pending_channels))) {
+        multi_thread_client_channel_setup(thread,
+                                          setup_data->channel,
+                                          &(setup_data->address));
+        g_io_channel_unref(setup_data->channel);
+        g_free(setup_data);
     }
 
-    milter_event_loop_run(priv->accept_loop);
-
-    g_thread_pool_free(priv->worker_threads, TRUE, TRUE);
-    priv->worker_threads = NULL;
+    if (quitting) {
+        milter_debug("[client][multi-thread][%u][quit]", thread->id);
+        thread->notify_watch_id = 0;
+        milter_event_loop_quit(thread->loop);
+        return FALSE;
+    }
 
     return TRUE;
 }
 
-
-static GIOChannel *
-milter_client_listen_channel (MilterClient  *client, GError **error)
+static gpointer
+multi_thread_event_loop_thread_run (gpointer user_data)
 {
-    MilterClientPrivate *priv;
-    GIOChannel *channel;
-    const gchar *connection_spec;
+    MilterClientEventLoopThread *thread = user_data;
 
-    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    g_private_set(&current_event_loop_thread, thread);
+    milter_debug("[client][multi-thread][%u][run]", thread->id);
+    milter_event_loop_run(thread->loop);
+    milter_debug("[client][multi-thread][%u][finish]", thread->id);
+    g_private_set(&current_event_loop_thread, NULL);
 
-    dispose_address(priv);
+    return NULL;
+}
 
-    connection_spec = milter_client_get_connection_spec(client);
-    channel = milter_connection_listen(connection_spec,
-                                       priv->listen_backlog,
-                                       &(priv->address),
-                                       &(priv->address_size),
-                                       priv->remove_unix_socket_on_create,
-                                       error);
-    if (priv->address_size > 0) {
-        g_signal_emit(client, signals[LISTEN_STARTED], 0,
-                      priv->address, priv->address_size);
-    }
+static MilterClientEventLoopThread *
+multi_thread_event_loop_thread_new (MilterClient *client, guint id,
+                                    GError **error)
+{
+    MilterClientEventLoopThread *thread;
+    gint pipe_fds[2];
 
-    return channel;
+    if (!multi_thread_open_pipe(pipe_fds, error))
+        return NULL;
+
+    thread = g_new0(MilterClientEventLoopThread, 1);
+    thread->client = client;
+    thread->id = id;
+    thread->thread = NULL;
+    /* Created in the main thread because event-loop-created
+     * handlers may not be thread safe. */
+    thread->loop = milter_client_create_event_loop(client, FALSE);
+    g_mutex_init(&(thread->mutex));
+    g_queue_init(&(thread->pending_channels));
+    thread->quitting = FALSE;
+    thread->notify_channel =
+        g_io_channel_unix_new(pipe_fds[MILTER_UTILS_READ_PIPE]);
+    g_io_channel_set_close_on_unref(thread->notify_channel, TRUE);
+    thread->notify_fd = pipe_fds[MILTER_UTILS_WRITE_PIPE];
+    thread->notify_watch_id =
+        milter_event_loop_watch_io(thread->loop,
+                                   thread->notify_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   multi_thread_cb_notify,
+                                   thread);
+    thread->n_sessions = 0;
+    thread->finished_data = NULL;
+    thread->finisher_id = 0;
+
+    return thread;
 }
 
-gboolean
-milter_client_listen (MilterClient  *client, GError **error)
+static void
+multi_thread_event_loop_thread_free (MilterClientEventLoopThread *thread)
 {
-    GIOChannel *channel;
+    ClientChannelSetupData *setup_data;
 
-    channel = milter_client_listen_channel(client, error);
-    if (!channel)
-        return FALSE;
+    if (thread->finisher_id > 0) {
+        milter_event_loop_remove(thread->loop, thread->finisher_id);
+        thread->finisher_id = 0;
+    }
+    if (thread->finished_data) {
+        finish_processing_data(thread->client, thread->finished_data);
+        thread->finished_data = NULL;
+    }
 
-    milter_client_set_listen_channel(client, channel);
-    g_io_channel_unref(channel);
-    return TRUE;
+    while ((setup_data = g_queue_pop_head(&(thread->pending_channels)))) {
+        milter_client_session_finished(thread->client);
+        g_io_channel_unref(setup_data->channel);
+        g_free(setup_data);
+    }
+
+    if (thread->notify_watch_id > 0)
+        milter_event_loop_remove(thread->loop, thread->notify_watch_id);
+    g_io_channel_unref(thread->notify_channel);
+    close(thread->notify_fd);
+    g_object_unref(thread->loop);
+    g_mutex_clear(&(thread->mutex));
+    g_free(thread);
 }
 
-static struct passwd *
-find_password (const gchar *effective_user, GError **error)
+static void
+multi_thread_stop_event_loop_threads (MilterClient *client)
 {
-    struct passwd *password;
+    MilterClientPrivate *priv;
+    GPtrArray *threads;
+    guint i;
 
-    if (!effective_user)
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    threads = priv->event_loop_threads.threads;
+    if (!threads)
+        return;
+    priv->event_loop_threads.threads = NULL;
+
+    for (i = 0; i < threads->len; i++) {
+        MilterClientEventLoopThread *thread = g_ptr_array_index(threads, i);
+
+        g_mutex_lock(&(thread->mutex));
+        thread->quitting = TRUE;
+        g_mutex_unlock(&(thread->mutex));
+        multi_thread_notify(thread->notify_fd);
+    }
+    for (i = 0; i < threads->len; i++) {
+        MilterClientEventLoopThread *thread = g_ptr_array_index(threads, i);
+
+        if (thread->thread)
+            g_thread_join(thread->thread);
+        multi_thread_event_loop_thread_free(thread);
+    }
+    g_ptr_array_free(threads, TRUE);
+
+    if (priv->event_loop_threads.request_watch_id > 0) {
+        milter_event_loop_remove(priv->event_loop,
+                                 priv->event_loop_threads.request_watch_id);
+        priv->event_loop_threads.request_watch_id = 0;
+    }
+    if (priv->event_loop_threads.request_channel) {
+        g_io_channel_unref(priv->event_loop_threads.request_channel);
+        priv->event_loop_threads.request_channel = NULL;
+    }
+    if (priv->event_loop_threads.request_fd != -1) {
+        close(priv->event_loop_threads.request_fd);
+        priv->event_loop_threads.request_fd = -1;
+    }
+    priv->event_loop_threads.requests = 0;
+
+    milter_debug("[client][multi-thread][stop]");
+}
+
+static gboolean
+multi_thread_start_event_loop_threads (MilterClient *client, GError **error)
+{
+    MilterClientPrivate *priv;
+    MilterEventLoop *loop;
+    GPtrArray *threads;
+    guint i, n_threads;
+    gint pipe_fds[2];
+    sigset_t all_signals, original_signals;
+    gboolean success = TRUE;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    n_threads = milter_client_get_n_event_loop_threads(client);
+    if (n_threads == 0)
+        return TRUE;
+
+    loop = milter_client_get_event_loop(client);
+    if (!loop) {
+        loop = milter_client_create_event_loop(client, TRUE);
+        milter_client_set_event_loop(client, loop);
+        g_object_unref(loop);
+    }
+
+    if (!multi_thread_open_pipe(pipe_fds, error))
+        return FALSE;
+    priv->event_loop_threads.request_channel =
+        g_io_channel_unix_new(pipe_fds[MILTER_UTILS_READ_PIPE]);
+    g_io_channel_set_close_on_unref(priv->event_loop_threads.request_channel,
+                                    TRUE);
+    priv->event_loop_threads.request_fd = pipe_fds[MILTER_UTILS_WRITE_PIPE];
+    priv->event_loop_threads.request_watch_id =
+        milter_event_loop_watch_io(loop,
+                                   priv->event_loop_threads.request_channel,
+                                   G_IO_IN | G_IO_PRI,
+                                   multi_thread_cb_main_loop_request,
+                                   client);
+
+    threads = g_ptr_array_new();
+    priv->event_loop_threads.threads = threads;
+    priv->event_loop_threads.next_thread = 0;
+
+    /* Signals are handled only by the main thread. */
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &original_signals);
+    for (i = 0; i < n_threads; i++) {
+        MilterClientEventLoopThread *thread;
+        GError *local_error = NULL;
+
+        thread = multi_thread_event_loop_thread_new(client, i, error);
+        if (!thread) {
+            success = FALSE;
+            break;
+        }
+        g_ptr_array_add(threads, thread);
+
+        thread->thread = g_thread_try_new("milter-event-loop",
+                                          multi_thread_event_loop_thread_run,
+                                          thread,
+                                          &local_error);
+        if (!thread->thread) {
+            g_set_error(error,
+                        MILTER_CLIENT_ERROR,
+                        MILTER_CLIENT_ERROR_THREAD,
+                        "failed to create an event loop thread: %s",
+                        local_error->message);
+            milter_error("[client][multi-thread][start][error] %s",
+                         local_error->message);
+            g_error_free(local_error);
+            success = FALSE;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &original_signals, NULL);
+
+    if (!success) {
+        multi_thread_stop_event_loop_threads(client);
+        return FALSE;
+    }
+
+    milter_info("[client][multi-thread][start] <%u>", n_threads);
+    return TRUE;
+}
+
+static MilterClientEventLoopThread *
+multi_thread_choose_thread (MilterClientPrivate *priv)
+{
+    GPtrArray *threads;
+    MilterClientEventLoopThread *chosen = NULL;
+    gint min_n_sessions = 0;
+    guint i, first;
+
+    /* Use the thread that has the fewest sessions. Ties are
+     * broken in round-robin order. */
+    threads = priv->event_loop_threads.threads;
+    first = priv->event_loop_threads.next_thread++ % threads->len;
+    for (i = 0; i < threads->len; i++) {
+        MilterClientEventLoopThread *thread;
+        gint n_sessions;
+
+        thread = g_ptr_array_index(threads, (first + i) % threads->len);
+        n_sessions = g_atomic_int_get(&(thread->n_sessions));
+        if (!chosen || n_sessions < min_n_sessions) {
+            chosen = thread;
+            min_n_sessions = n_sessions;
+        }
+    }
+
+    return chosen;
+}
+
+static void
+multi_thread_process_client_channel (MilterClient *client, GIOChannel *channel,
+                                     MilterGenericSocketAddress *address,
+                                     socklen_t address_size)
+{
+    MilterClientPrivate *priv;
+    MilterClientEventLoopThread *thread;
+    ClientChannelSetupData *data;
+    gboolean need_notify;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    thread = multi_thread_choose_thread(priv);
+
+    data = g_new(ClientChannelSetupData, 1);
+    data->client = client;
+    data->channel = channel;
+    memcpy(&(data->address), address, address_size);
+    g_io_channel_ref(channel);
+
+    milter_debug("[client][multi-thread][dispatch] <%u>: <%d>",
+                 thread->id, g_atomic_int_get(&(thread->n_sessions)));
+
+    g_atomic_int_inc(&(thread->n_sessions));
+    g_mutex_lock(&(thread->mutex));
+    need_notify = g_queue_is_empty(&(thread->pending_channels));
+    g_queue_push_tail(&(thread->pending_channels), data);
+    g_mutex_unlock(&(thread->mutex));
+
+    if (need_notify)
+        multi_thread_notify(thread->notify_fd);
+}
+
+static void
+process_client_channel (MilterClient *client, GIOChannel *channel,
+                        MilterGenericSocketAddress *address,
+                        socklen_t address_size)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (priv->event_loop_threads.threads &&
+        milter_client_is_event_loop_threads_usable(client)) {
+        multi_thread_process_client_channel(client, channel,
+                                            address, address_size);
+    } else {
+        single_thread_process_client_channel(client, channel,
+                                             address, address_size);
+    }
+}
+
+
+static gboolean
+need_worker_listen_channels (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (priv->workers.id > 0)
+        return FALSE;
+    if (milter_client_get_n_workers(client) == 0)
+        return FALSE;
+    return milter_client_is_reuse_port(client);
+}
+
+static void
+prepare_worker_listen_channels (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    const gchar *connection_spec;
+    guint i, n_workers;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    dispose_worker_listen_channels(priv);
+    if (!priv->listen_channel || !priv->address)
+        return;
+    if (priv->address->sa_family == AF_UNIX)
+        return;
+
+    connection_spec = milter_client_get_connection_spec(client);
+    n_workers = milter_client_get_n_workers(client);
+    priv->workers.listen_channels =
+        g_ptr_array_new_with_free_func((GDestroyNotify)g_io_channel_unref);
+    g_io_channel_ref(priv->listen_channel);
+    g_ptr_array_add(priv->workers.listen_channels, priv->listen_channel);
+    for (i = 1; i < n_workers; i++) {
+        GIOChannel *channel;
+        GError *error = NULL;
+
+        channel = milter_connection_listen_full(connection_spec,
+                                                priv->listen_backlog,
+                                                NULL,
+                                                NULL,
+                                                FALSE,
+                                                TRUE,
+                                                &error);
+        if (!channel) {
+            milter_error("[client][workers][listen][reuse-port][error] "
+                         "fall back to shared socket: %s",
+                         error->message);
+            g_error_free(error);
+            dispose_worker_listen_channels(priv);
+            return;
+        }
+        g_ptr_array_add(priv->workers.listen_channels, channel);
+    }
+
+    milter_debug("[client][workers][listen][reuse-port] <%s>: <%u>",
+                 connection_spec, n_workers);
+}
+
+static GIOChannel *
+milter_client_listen_channel (MilterClient  *client, GError **error)
+{
+    MilterClientPrivate *priv;
+    GIOChannel *channel;
+    const gchar *connection_spec;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+
+    dispose_address(priv);
+
+    connection_spec = milter_client_get_connection_spec(client);
+    channel = milter_connection_listen_full(connection_spec,
+                                            priv->listen_backlog,
+                                            &(priv->address),
+                                            &(priv->address_size),
+                                            priv->remove_unix_socket_on_create,
+                                            need_worker_listen_channels(client),
+                                            error);
+    if (priv->address_size > 0) {
+        g_signal_emit(client, signals[LISTEN_STARTED], 0,
+                      priv->address, priv->address_size);
+    }
+
+    return channel;
+}
+
+gboolean
+milter_client_listen (MilterClient  *client, GError **error)
+{
+    GIOChannel *channel;
+
+    channel = milter_client_listen_channel(client, error);
+    if (!channel)
+        return FALSE;
+
+    milter_client_set_listen_channel(client, channel);
+    g_io_channel_unref(channel);
+
+    /* Sockets for workers are created here because SO_REUSEPORT
+     * requires the same effective user as the first socket. */
+    if (need_worker_listen_channels(client))
+        prepare_worker_listen_channels(client);
+
+    return TRUE;
+}
+
+static struct passwd *
+find_password (const gchar *effective_user, GError **error)
+{
+    struct passwd *password;
+
+    if (!effective_user)
         effective_user = "nobody";
 
     errno = 0;
@@ -1923,6 +2584,7 @@ milter_client_daemonize (MilterClient *client, GError **error)
                     g_strerror(errno));
         return FALSE;
     default:
+        milter_log_writer_flush_all();
         _exit(EXIT_SUCCESS);
         break;
     }
@@ -1947,6 +2609,7 @@ milter_client_daemonize (MilterClient *client, GError **error)
                     g_strerror(errno));
         return FALSE;
     default:
+        milter_log_writer_flush_all();
         _exit(EXIT_SUCCESS);
         break;
     }
@@ -2160,6 +2823,9 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
             g_propagate_error(error, local_error);
             return FALSE;
         }
+    } else if (need_worker_listen_channels(client) &&
+               !priv->workers.listen_channels) {
+        prepare_worker_listen_channels(client);
     }
 
     if (pipe(pipe_fds) == -1) {
@@ -2172,6 +2838,7 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
     }
 
     priv->workers.pids = g_array_new(TRUE, TRUE, sizeof(GPid));
+    ensure_worker_stats(priv, n_workers);
 
     for (i = 0; i < n_workers; ++i) {
         GPid pid = milter_client_fork(client);
@@ -2180,16 +2847,24 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
             close(pipe_fds[MILTER_UTILS_WRITE_PIPE]);
             priv->workers.control = setup_client_channel(pipe_fds[MILTER_UTILS_READ_PIPE]);
             priv->workers.id = i + 1;
+            if (priv->workers.listen_channels) {
+                milter_client_set_listen_channel(
+                    client,
+                    g_ptr_array_index(priv->workers.listen_channels, i));
+                dispose_worker_listen_channels(priv);
+            }
             milter_event_loop_watch_io(loop, priv->workers.control,
                                        G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
                                        worker_watch_master, client);
             g_signal_emit(client, signals[WORKER_CREATED], 0);
             run_worker(client, error);
             milter_client_shutdown(client);
+            milter_log_writer_flush_all();
             _exit(EXIT_SUCCESS);
         default:
             g_array_append_val(priv->workers.pids, pid);
-            milter_event_loop_watch_child(loop, pid, watch_worker_process, NULL);
+            milter_event_loop_watch_child(loop, pid,
+                                          watch_worker_process, client);
             break;
         case -1:
             g_set_error(error,
@@ -2205,6 +2880,13 @@ client_run_workers (MilterClient *client, guint n_workers, GError **error)
     close(pipe_fds[MILTER_UTILS_READ_PIPE]);
     priv->workers.control = setup_client_channel(pipe_fds[MILTER_UTILS_WRITE_PIPE]);
 
+    /* Each socket must be owned only by its worker. Otherwise
+     * connections for an exited worker are never accepted. */
+    if (priv->workers.listen_channels) {
+        dispose_worker_listen_channels(priv);
+        milter_client_set_listen_channel(client, NULL);
+    }
+
     milter_info("[client][workers][run] <%d>", n_workers);
     return TRUE;
 }
@@ -2221,7 +2903,17 @@ single_thread_single_loop_accept_connection (MilterClient *client,
     accepted = accept_connection(client, server_fd, &client_channel,
                                  &address, &address_size);
     if (accepted) {
-        single_thread_client_channel_setup(client, client_channel, &address);
+        MilterClientPrivate *priv;
+
+        priv = MILTER_CLIENT_GET_PRIVATE(client);
+        if (priv->event_loop_threads.threads &&
+            milter_client_is_event_loop_threads_usable(client)) {
+            multi_thread_process_client_channel(client, client_channel,
+                                                &address, address_size);
+        } else {
+            single_thread_client_channel_setup(client, client_channel,
+                                               &address);
+        }
         g_io_channel_unref(client_channel);
     }
 
@@ -2280,15 +2972,6 @@ milter_client_run_loop (MilterClient *client, GError **error)
         }
         g_signal_emit(client, signals[WORKERS_CREATED], 0, n_workers);
         success = run_master(client, error);
-    } else if (priv->multi_thread_mode) {
-        priv->accept_loop = milter_client_create_event_loop(client, FALSE);
-        if (!milter_client_prepare(client,
-                                   priv->accept_loop,
-                                   multi_thread_accept_watch_func,
-                                   error)) {
-            return FALSE;
-        }
-        success = multi_thread_start_accept(client, error);
     } else {
         const gchar *use_accept_loop_env;
         gboolean use_accept_loop = FALSE;
@@ -2302,6 +2985,9 @@ milter_client_run_loop (MilterClient *client, GError **error)
             }
         }
 
+        if (!multi_thread_start_event_loop_threads(client, error))
+            return FALSE;
+
         if (use_accept_loop) {
             milter_debug("[client][single-thread][accept-loop]");
             if (!priv->accept_loop)
@@ -2318,6 +3004,8 @@ milter_client_run_loop (MilterClient *client, GError **error)
             milter_debug("[client][single-thread][single-loop]");
             success = single_thread_single_loop_run(client, error);
         }
+
+        multi_thread_stop_event_loop_threads(client);
     }
 
     return success;
@@ -2449,13 +3137,69 @@ worker_accept_watch_func (GIOChannel *channel, GIOCondition condition,
     } else {
         GIOChannel *client_channel;
         client_channel = setup_client_channel(client_fd);
-        single_thread_process_client_channel(client, client_channel,
-                                             &address, (socklen_t)address_size);
+        process_client_channel(client, client_channel,
+                               &address, (socklen_t)address_size);
         g_io_channel_unref(client_channel);
     }
     return keep_callback;
 }
 
+#if defined(__linux__) && defined(EPOLLEXCLUSIVE)
+static gboolean
+worker_exclusive_accept_watch_func (GIOChannel *channel,
+                                    GIOCondition condition,
+                                    gpointer data)
+{
+    MilterClient *client = data;
+    MilterClientPrivate *priv;
+    struct epoll_event event;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    epoll_wait(g_io_channel_unix_get_fd(channel), &event, 1, 0);
+    if (!priv->listening_channel)
+        return FALSE;
+    return worker_accept_watch_func(priv->listening_channel, condition, data);
+}
+
+/* UNIX domain sockets can't use SO_REUSEPORT. Instead, each
+ * worker waits on its own epoll instance that registers the
+ * shared socket with EPOLLEXCLUSIVE. The kernel wakes only one
+ * of them for a new connection. The epoll instance is just a
+ * readable FD for the event loop, so any backend can watch it. */
+static GIOChannel *
+create_exclusive_accept_channel (MilterClientPrivate *priv)
+{
+    gint epoll_fd;
+    struct epoll_event event;
+    GIOChannel *channel;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        milter_error("[client][worker][exclusive-accept][error] "
+                     "failed to epoll_create1(): %s",
+                     g_strerror(errno));
+        return NULL;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    if (epoll_ctl(epoll_fd,
+                  EPOLL_CTL_ADD,
+                  g_io_channel_unix_get_fd(priv->listening_channel),
+                  &event) == -1) {
+        milter_error("[client][worker][exclusive-accept][error] "
+                     "failed to epoll_ctl(): %s",
+                     g_strerror(errno));
+        close(epoll_fd);
+        return NULL;
+    }
+
+    channel = g_io_channel_unix_new(epoll_fd);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    return channel;
+}
+#endif
+
 static gboolean
 run_worker (MilterClient *client, GError **error)
 {
@@ -2493,15 +3237,36 @@ run_worker (MilterClient *client, GError **error)
     g_io_channel_set_flags(priv->listening_channel, G_IO_FLAG_NONBLOCK, NULL);
 
     priv->quitting = FALSE;
+    if (!multi_thread_start_event_loop_threads(client, error))
+        return FALSE;
     loop = milter_client_get_event_loop(client);
-    priv->accept_watch_id =
-        milter_event_loop_watch_io_full(loop,
-                                        G_PRIORITY_HIGH,
-                                        priv->listening_channel,
-                                        G_IO_IN | G_IO_PRI,
-                                        worker_accept_watch_func,
-                                        client,
-                                        NULL);
+#if defined(__linux__) && defined(EPOLLEXCLUSIVE)
+    if (milter_client_is_reuse_port(client) &&
+        priv->address && priv->address->sa_family == AF_UNIX) {
+        priv->exclusive_accept_channel =
+            create_exclusive_accept_channel(priv);
+    }
+    if (priv->exclusive_accept_channel) {
+        priv->accept_watch_id =
+            milter_event_loop_watch_io_full(loop,
+                                            G_PRIORITY_HIGH,
+                                            priv->exclusive_accept_channel,
+                                            G_IO_IN,
+                                            worker_exclusive_accept_watch_func,
+                                            client,
+                                            NULL);
+    } else
+#endif
+    {
+        priv->accept_watch_id =
+            milter_event_loop_watch_io_full(loop,
+                                            G_PRIORITY_HIGH,
+                                            priv->listening_channel,
+                                            G_IO_IN | G_IO_PRI,
+                                            worker_accept_watch_func,
+                                            client,
+                                            NULL);
+    }
     priv->accept_error_watch_id =
         milter_event_loop_watch_io_full(loop,
                                         G_PRIORITY_HIGH,
@@ -2512,6 +3277,8 @@ run_worker (MilterClient *client, GError **error)
                                         NULL);
     milter_event_loop_run(loop);
 
+    multi_thread_stop_event_loop_threads(client);
+
     return TRUE;
 }
 
@@ -2538,7 +3305,7 @@ milter_client_shutdown (MilterClient *client)
             priv->listening_channel = NULL;
         }
 
-        if (priv->n_processing_sessions == 0)
+        if (g_atomic_int_get(&(priv->n_processing_sessions)) == 0)
             milter_event_loop_quit(priv->event_loop);
     }
     g_mutex_unlock(&(priv->quit_mutex));
@@ -2756,6 +3523,67 @@ milter_client_set_max_connections (MilterClient *client, guint max_connections)
         MILTER_CLIENT_GET_PRIVATE(client)->max_connections = max_connections;
 }
 
+gboolean
+milter_client_is_reuse_port (MilterClient *client)
+{
+    MilterClientClass *klass;
+
+    klass = MILTER_CLIENT_GET_CLASS(client);
+    if (klass->is_reuse_port)
+        return klass->is_reuse_port(client);
+    else
+        return MILTER_CLIENT_GET_PRIVATE(client)->reuse_port;
+}
+
+void
+milter_client_set_reuse_port (MilterClient *client, gboolean reuse_port)
+{
+    MilterClientClass *klass;
+
+    klass = MILTER_CLIENT_GET_CLASS(client);
+    if (klass->set_reuse_port)
+        klass->set_reuse_port(client, reuse_port);
+    else
+        MILTER_CLIENT_GET_PRIVATE(client)->reuse_port = reuse_port;
+}
+
+guint
+milter_client_get_n_event_loop_threads (MilterClient *client)
+{
+    MilterClientClass *klass;
+
+    klass = MILTER_CLIENT_GET_CLASS(client);
+    if (klass->get_n_event_loop_threads)
+        return klass->get_n_event_loop_threads(client);
+    else
+        return MILTER_CLIENT_GET_PRIVATE(client)->event_loop_threads.n_threads;
+}
+
+gboolean
+milter_client_is_event_loop_threads_usable (MilterClient *client)
+{
+    MilterClientClass *klass;
+
+    klass = MILTER_CLIENT_GET_CLASS(client);
+    if (klass->is_event_loop_threads_usable)
+        return klass->is_event_loop_threads_usable(client);
+    else
+        return TRUE;
+}
+
+void
+milter_client_set_n_event_loop_threads (MilterClient *client, guint n_threads)
+{
+    MilterClientClass *klass;
+
+    klass = MILTER_CLIENT_GET_CLASS(client);
+    if (klass->set_n_event_loop_threads)
+        klass->set_n_event_loop_threads(client, n_threads);
+    else
+        MILTER_CLIENT_GET_PRIVATE(client)->event_loop_threads.n_threads =
+            n_threads;
+}
+
 static const gchar *
 get_effective_user (MilterClient *client)
 {
@@ -2869,29 +3697,43 @@ milter_client_processing_context_foreach (MilterClient *client,
     GList *node;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
+    g_mutex_lock(&(priv->processing_data_mutex));
     for (node = priv->processing_data; node; node = g_list_next(node)) {
         MilterClientProcessData *data = node->data;
         func(data->context, user_data);
     }
+    g_mutex_unlock(&(priv->processing_data_mutex));
 }
 
 void
 milter_client_session_started (MilterClient *client)
 {
     MilterClientPrivate *priv;
+    MilterClientWorkerStats *stats;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions++;
+    g_atomic_int_inc(&(priv->n_processing_sessions));
+
+    stats = get_own_worker_stats(priv);
+    if (stats)
+        g_atomic_int_inc(&(stats->sessions.n_processing_sessions));
 }
 
 void
 milter_client_session_finished (MilterClient *client)
 {
     MilterClientPrivate *priv;
+    MilterClientWorkerStats *stats;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
-    priv->n_processing_sessions--;
-    priv->n_processed_sessions++;
+    g_atomic_int_add(&(priv->n_processing_sessions), -1);
+    g_atomic_int_inc(&(priv->n_processed_sessions));
+
+    stats = get_own_worker_stats(priv);
+    if (stats) {
+        g_atomic_int_add(&(stats->sessions.n_processing_sessions), -1);
+        g_atomic_int_inc(&(stats->sessions.n_processed_sessions));
+    }
 }
 
 guint
@@ -2900,6 +3742,144 @@ milter_client_get_n_processing_sessions (MilterClient *client)
     return MILTER_CLIENT_GET_PRIVATE(client)->n_processing_sessions;
 }
 
+guint
+milter_client_get_n_processed_sessions (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->n_processed_sessions;
+}
+
+guint
+milter_client_get_worker_n_processing_sessions (MilterClient *client,
+                                                guint         worker_id)
+{
+    MilterClientPrivate *priv;
+    MilterClientWorkerStats *stats;
+    gint n_processing_sessions;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.stats) {
+        if (worker_id == priv->workers.id)
+            return priv->n_processing_sessions;
+        return 0;
+    }
+
+    stats = get_worker_stats(priv, worker_id);
+    if (!stats)
+        return 0;
+    n_processing_sessions =
+        g_atomic_int_get(&(stats->sessions.n_processing_sessions));
+    return MAX(n_processing_sessions, 0);
+}
+
+guint
+milter_client_get_worker_n_processed_sessions (MilterClient *client,
+                                               guint         worker_id)
+{
+    MilterClientPrivate *priv;
+    MilterClientWorkerStats *stats;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.stats) {
+        if (worker_id == priv->workers.id)
+            return priv->n_processed_sessions;
+        return 0;
+    }
+
+    stats = get_worker_stats(priv, worker_id);
+    if (!stats)
+        return 0;
+    return (guint)g_atomic_int_get(&(stats->sessions.n_processed_sessions));
+}
+
+void
+milter_client_set_worker_data_size (MilterClient *client,
+                                    gsize         size)
+{
+    MilterClientPrivate *priv;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (priv->workers.data_size == size)
+        return;
+    if (priv->workers.stats) {
+        milter_error("[client][workers][stats][error] "
+                     "worker data size can't be changed after "
+                     "statistics are shared: <%" G_GSIZE_FORMAT ">",
+                     size);
+        return;
+    }
+    priv->workers.data_size = size;
+}
+
+gsize
+milter_client_get_worker_data_size (MilterClient *client)
+{
+    return MILTER_CLIENT_GET_PRIVATE(client)->workers.data_size;
+}
+
+gpointer
+milter_client_get_worker_data (MilterClient *client,
+                               guint         worker_id)
+{
+    MilterClientPrivate *priv;
+    MilterClientWorkerStats *stats;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (priv->workers.data_size == 0)
+        return NULL;
+
+    ensure_worker_stats(priv, milter_client_get_n_workers(client));
+    stats = get_worker_stats(priv, worker_id);
+    if (!stats)
+        return NULL;
+    return stats + 1;
+}
+
+static void
+worker_exited (MilterClient *client, guint worker_id)
+{
+    MilterClientWorkerStats *stats;
+
+    /* The number of processed sessions is kept because it
+     * must never decrease. */
+    stats = get_worker_stats(MILTER_CLIENT_GET_PRIVATE(client), worker_id);
+    if (stats)
+        g_atomic_int_set(&(stats->sessions.n_processing_sessions), 0);
+}
+
+guint
+milter_client_get_n_total_processing_sessions (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    guint i, n_processing_sessions = 0;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.stats)
+        return priv->n_processing_sessions;
+
+    for (i = 0; i < priv->workers.n_stats; i++) {
+        n_processing_sessions +=
+            milter_client_get_worker_n_processing_sessions(client, i);
+    }
+    return n_processing_sessions;
+}
+
+guint
+milter_client_get_n_total_processed_sessions (MilterClient *client)
+{
+    MilterClientPrivate *priv;
+    guint i, n_processed_sessions = 0;
+
+    priv = MILTER_CLIENT_GET_PRIVATE(client);
+    if (!priv->workers.stats)
+        return priv->n_processed_sessions;
+
+    for (i = 0; i < priv->workers.n_stats; i++) {
+        n_processed_sessions +=
+            milter_client_get_worker_n_processed_sessions(client, i);
+    }
+    return n_processed_sessions;
+}
+
 gboolean
 milter_client_is_processing (MilterClient *client)
 {
@@ -3005,11 +3985,13 @@ MilterEventLoop *
 milter_client_get_event_loop (MilterClient *client)
 {
     MilterClientPrivate *priv;
+    MilterClientEventLoopThread *thread;
 
     priv = MILTER_CLIENT_GET_PRIVATE(client);
 
-    if (priv->multi_thread_mode) {
-        return NULL;
+    thread = g_private_get(&current_event_loop_thread);
+    if (thread && thread->client == client) {
+        return thread->loop;
     } else {
         return priv->event_loop;
     }
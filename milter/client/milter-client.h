@@ -64,6 +64,13 @@ G_BEGIN_DECLS
  */
 #define MILTER_CLIENT_MAX_N_WORKERS 1000
 
+/**
+ * MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS:
+ *
+ * The maximum number of event loop threads.
+ */
+#define MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS 256
+
 /**
  * MILTER_CLIENT_ERROR:
  *
@@ -201,6 +208,16 @@ struct _MilterClientClass
                                            guint         n_workers);
     void   (*worker_created)              (MilterClient *client);
     GArray *(*get_worker_pids)            (MilterClient *client);
+    gboolean (*is_reuse_port)             (MilterClient *client);
+    void   (*set_reuse_port)              (MilterClient *client,
+                                           gboolean      reuse_port);
+    guint  (*get_n_event_loop_threads)    (MilterClient *client);
+    void   (*set_n_event_loop_threads)    (MilterClient *client,
+                                           guint         n_threads);
+    gboolean (*is_event_loop_threads_usable)
+                                          (MilterClient *client);
+    void   (*worker_exited)               (MilterClient *client,
+                                           guint         worker_id);
 };
 
 
@@ -522,6 +539,45 @@ void                 milter_client_set_max_connections
                                                      (MilterClient  *client,
                                                       guint          max_connections);
 
+/**
+ * milter_client_is_reuse_port:
+ * @client: a %MilterClient.
+ *
+ * Returns whether each worker process listens on its own
+ * socket or not.
+ *
+ * If it is %TRUE and the connection spec is an inet or inet6
+ * spec, each worker process listens on its own socket with
+ * SO_REUSEPORT and the kernel distributes new connections to
+ * them. If the connection spec is a unix spec, worker
+ * processes share one socket but only one of them is woken
+ * up for a new connection on Linux.
+ *
+ * It is used only when milter_client_get_n_workers() is 1
+ * or more.
+ *
+ * Returns: %TRUE if each worker process listens on its own
+ * socket, %FALSE otherwise.
+ *
+ * Since: 2.2.9
+ */
+gboolean             milter_client_is_reuse_port     (MilterClient  *client);
+
+/**
+ * milter_client_set_reuse_port:
+ * @client: a %MilterClient.
+ * @reuse_port: whether each worker process listens on its
+ *              own socket or not.
+ *
+ * Sets whether each worker process listens on its own socket
+ * or not. See milter_client_is_reuse_port() for more
+ * details. It must be set before milter_client_listen().
+ *
+ * Since: 2.2.9
+ */
+void                 milter_client_set_reuse_port    (MilterClient  *client,
+                                                      gboolean       reuse_port);
+
 /**
  * milter_client_get_effective_user:
  * @client: a %MilterClient.
@@ -756,6 +812,135 @@ void                 milter_client_session_finished  (MilterClient  *client);
 guint                milter_client_get_n_processing_sessions
                                                      (MilterClient  *client);
 
+/**
+ * milter_client_get_n_processed_sessions:
+ * @client: a %MilterClient.
+ *
+ * Returns number of the processed sessions.
+ *
+ * Returns: number of the processed sessions.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_n_processed_sessions
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_get_n_total_processing_sessions:
+ * @client: a %MilterClient.
+ *
+ * Returns number of the current processing sessions of
+ * all worker processes. It is the same as
+ * milter_client_get_n_processing_sessions() when @client
+ * doesn't run worker processes.
+ *
+ * Returns: number of the current processing sessions of
+ * all worker processes.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_n_total_processing_sessions
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_get_n_total_processed_sessions:
+ * @client: a %MilterClient.
+ *
+ * Returns number of the processed sessions of all worker
+ * processes.
+ *
+ * Returns: number of the processed sessions of all worker
+ * processes.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_n_total_processed_sessions
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_get_worker_n_processing_sessions:
+ * @client: a %MilterClient.
+ * @worker_id: the worker ID. 0 is the parent process.
+ *
+ * Returns number of the current processing sessions of the
+ * worker process. Worker processes share their numbers so
+ * that any process can read them.
+ *
+ * Returns: number of the current processing sessions of the
+ * worker process.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_worker_n_processing_sessions
+                                                     (MilterClient  *client,
+                                                      guint          worker_id);
+
+/**
+ * milter_client_get_worker_n_processed_sessions:
+ * @client: a %MilterClient.
+ * @worker_id: the worker ID. 0 is the parent process.
+ *
+ * Returns number of the processed sessions of the worker
+ * process.
+ *
+ * Returns: number of the processed sessions of the worker
+ * process.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_worker_n_processed_sessions
+                                                     (MilterClient  *client,
+                                                      guint          worker_id);
+
+/**
+ * milter_client_set_worker_data_size:
+ * @client: a %MilterClient.
+ * @size: the size of data in bytes.
+ *
+ * Reserves @size bytes for each process in the segment
+ * that is shared by worker processes. It must be called
+ * before the segment is shared by
+ * milter_client_get_worker_data() or by running worker
+ * processes.
+ *
+ * Since: 2.2.9
+ */
+void                 milter_client_set_worker_data_size
+                                                     (MilterClient  *client,
+                                                      gsize          size);
+
+/**
+ * milter_client_get_worker_data_size:
+ * @client: a %MilterClient.
+ *
+ * Returns: the size of data reserved for each process.
+ *
+ * Since: 2.2.9
+ */
+gsize                milter_client_get_worker_data_size
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_get_worker_data:
+ * @client: a %MilterClient.
+ * @worker_id: the worker ID. 0 is the parent process.
+ *
+ * Returns data reserved by
+ * milter_client_set_worker_data_size() for the worker
+ * process. The data is shared by all worker processes when
+ * this is called before they are forked. A process should
+ * write only to its own data so that no lock is needed.
+ * The data is zero-filled at first.
+ *
+ * Returns: (transfer none): the data of the worker process
+ *   or %NULL if no data is reserved or @worker_id is out of
+ *   range.
+ *
+ * Since: 2.2.9
+ */
+gpointer             milter_client_get_worker_data   (MilterClient  *client,
+                                                      guint          worker_id);
+
 /**
  * milter_client_is_processing:
  * @client: a %MilterClient.
@@ -840,7 +1025,9 @@ gboolean             milter_client_get_syslog_enabled(MilterClient  *client);
  * milter_client_get_event_loop:
  * @client: a %MilterClient.
  *
- * Gets the %MilterEventLoop for processing requests.
+ * Gets the %MilterEventLoop for processing requests. In an
+ * event loop thread, it is the event loop of the thread.
+ * See milter_client_get_n_event_loop_threads().
  *
  * Returns: (transfer none) (nullable):
  *   the %MilterEventLoop for processing requests.
@@ -893,6 +1080,61 @@ guint                milter_client_get_n_workers     (MilterClient  *client);
 void                 milter_client_set_n_workers     (MilterClient  *client,
                                                       guint          n_workers);
 
+/**
+ * milter_client_get_n_event_loop_threads:
+ * @client: a %MilterClient.
+ *
+ * Gets the number of event loop threads of @client.
+ *
+ * If it is 1 or more, accepted connections are processed
+ * in the event loop threads instead of the main event
+ * loop. Each thread runs its own event loop and a new
+ * connection is passed to the thread that has the fewest
+ * sessions. The main event loop only accepts connections.
+ * It can be combined with worker processes. In that case,
+ * each worker process runs its own event loop threads.
+ *
+ * Returns: the number of event loop threads of @client.
+ *
+ * Since: 2.2.9
+ */
+guint                milter_client_get_n_event_loop_threads
+                                                     (MilterClient  *client);
+
+/**
+ * milter_client_set_n_event_loop_threads:
+ * @client: a %MilterClient.
+ * @n_threads: the number of event loop threads.
+ *
+ * Sets the number of event loop threads of @client. 0
+ * means that connections are processed in the main event
+ * loop. See milter_client_get_n_event_loop_threads() for
+ * more details.
+ *
+ * Since: 2.2.9
+ */
+void                 milter_client_set_n_event_loop_threads
+                                                     (MilterClient  *client,
+                                                      guint          n_threads);
+
+/**
+ * milter_client_is_event_loop_threads_usable:
+ * @client: a %MilterClient.
+ *
+ * Returns whether a new connection can be processed in an
+ * event loop thread. It is checked for each accepted
+ * connection. If it returns %FALSE, the connection is
+ * processed in the main event loop even when event loop
+ * threads are running.
+ *
+ * Returns: %TRUE if event loop threads can be used, %FALSE
+ *   otherwise.
+ *
+ * Since: 2.2.9
+ */
+gboolean             milter_client_is_event_loop_threads_usable
+                                                     (MilterClient  *client);
+
 /**
  * milter_client_fork:
  * @client: a %MilterClient.
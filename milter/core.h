@@ -38,8 +38,10 @@
 #include <milter/core/milter-agent.h>
 #include <milter/core/milter-protocol-agent.h>
 #include <milter/core/milter-macros-requests.h>
+#include <milter/core/milter-macros-packet-cache.h>
 #include <milter/core/milter-headers.h>
 #include <milter/core/milter-logger.h>
+#include <milter/core/milter-log-writer.h>
 #include <milter/core/milter-syslog-logger.h>
 #include <milter/core/milter-error-emittable.h>
 #include <milter/core/milter-finished-emittable.h>
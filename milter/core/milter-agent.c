@@ -47,6 +47,12 @@ struct _MilterAgentPrivate
     guint tag;
     GTimer *timer;
     gboolean shutting_down;
+    gboolean batch_writes;
+    guint decoding_depth;
+    GString *batched_packets;
+    guint n_batched_packets;
+    guint n_written_packets;
+    guint n_writes;
 };
 
 enum
@@ -70,6 +76,16 @@ static gint signals[LAST_SIGNAL] = {0};
 static GMutex auto_tag_mutex;
 static guint auto_tag = 0;
 
+#define DEFAULT_CODEC_CACHE_SIZE 32
+#define MAX_CACHED_ENCODER_BUFFER_SIZE (64 * 1024)
+
+static void codec_cache_free (gpointer data);
+
+/* Each thread has its own cache. Event loop threads don't
+ * need to lock it. */
+static GPrivate codec_cache = G_PRIVATE_INIT(codec_cache_free);
+static guint codec_cache_size = DEFAULT_CODEC_CACHE_SIZE;
+
 static void         finished           (MilterFinishedEmittable *emittable);
 
 MILTER_IMPLEMENT_ERROR_EMITTABLE(error_emittable_init);
@@ -226,6 +242,107 @@ constructor (GType type, guint n_props, GObjectConstructParam *props)
     return object;
 }
 
+static void
+codec_queue_free (gpointer data)
+{
+    g_queue_free_full(data, g_object_unref);
+}
+
+static void
+codec_cache_free (gpointer data)
+{
+    g_hash_table_unref(data);
+}
+
+static GHashTable *
+get_codec_cache (void)
+{
+    GHashTable *cache;
+
+    cache = g_private_get(&codec_cache);
+    if (!cache) {
+        cache = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                      NULL, codec_queue_free);
+        g_private_set(&codec_cache, cache);
+    }
+
+    return cache;
+}
+
+static gpointer
+take_cached_codec (GType type)
+{
+    GHashTable *cache;
+    GQueue *codecs;
+
+    cache = g_private_get(&codec_cache);
+    if (!cache)
+        return NULL;
+
+    codecs = g_hash_table_lookup(cache, GSIZE_TO_POINTER(type));
+    if (!codecs)
+        return NULL;
+
+    return g_queue_pop_tail(codecs);
+}
+
+static gboolean
+is_recyclable_codec (gpointer codec)
+{
+    if (G_OBJECT(codec)->ref_count != 1)
+        return FALSE;
+
+    if (MILTER_IS_ENCODER(codec)) {
+        GString *buffer;
+
+        buffer = milter_encoder_get_buffer(codec);
+        if (buffer->allocated_len > MAX_CACHED_ENCODER_BUFFER_SIZE)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Decoders and encoders are recycled for the next agent
+ * instead of being freed. It saves a GObject instance and
+ * a grown buffer per codec for each session. Signal
+ * handlers connected by the agent are disconnected. */
+static void
+recycle_codec (MilterAgent *agent, gpointer codec)
+{
+    GHashTable *cache;
+    GQueue *codecs;
+    GType type;
+    guint size;
+
+    size = g_atomic_int_get(&codec_cache_size);
+    if (size == 0 || !is_recyclable_codec(codec)) {
+        g_object_unref(codec);
+        return;
+    }
+
+    cache = get_codec_cache();
+    type = G_OBJECT_TYPE(codec);
+    codecs = g_hash_table_lookup(cache, GSIZE_TO_POINTER(type));
+    if (!codecs) {
+        codecs = g_queue_new();
+        g_hash_table_insert(cache, GSIZE_TO_POINTER(type), codecs);
+    }
+    if (g_queue_get_length(codecs) >= size) {
+        g_object_unref(codec);
+        return;
+    }
+
+    g_signal_handlers_disconnect_by_data(codec, agent);
+    if (MILTER_IS_DECODER(codec)) {
+        milter_decoder_reset(codec);
+    } else {
+        milter_encoder_clear_buffer(codec);
+        milter_encoder_set_tag(codec, 0);
+    }
+    g_queue_push_tail(codecs, codec);
+}
+
 static void
 milter_agent_init (MilterAgent *agent)
 {
@@ -241,6 +358,12 @@ milter_agent_init (MilterAgent *agent)
     priv->timer = NULL;
     priv->event_loop = NULL;
     priv->shutting_down = FALSE;
+    priv->batch_writes = FALSE;
+    priv->decoding_depth = 0;
+    priv->batched_packets = NULL;
+    priv->n_batched_packets = 0;
+    priv->n_written_packets = 0;
+    priv->n_writes = 0;
 }
 
 static void
@@ -261,12 +384,12 @@ dispose (GObject *object)
     milter_agent_set_writer(agent, NULL);
 
     if (priv->decoder) {
-        g_object_unref(priv->decoder);
+        recycle_codec(agent, priv->decoder);
         priv->decoder = NULL;
     }
 
     if (priv->encoder) {
-        g_object_unref(priv->encoder);
+        recycle_codec(agent, priv->encoder);
         priv->encoder = NULL;
     }
 
@@ -275,6 +398,11 @@ dispose (GObject *object)
         priv->event_loop = NULL;
     }
 
+    if (priv->batched_packets) {
+        g_string_free(priv->batched_packets, TRUE);
+        priv->batched_packets = NULL;
+    }
+
     G_OBJECT_CLASS(milter_agent_parent_class)->dispose(object);
 }
 
@@ -336,6 +464,12 @@ get_property (GObject    *object,
     }
 }
 
+static gboolean
+is_batching (MilterAgentPrivate *priv)
+{
+    return priv->batch_writes && priv->decoding_depth > 0;
+}
+
 static gboolean
 flush (MilterAgent *agent, GError **error)
 {
@@ -347,6 +481,10 @@ flush (MilterAgent *agent, GError **error)
     if (!priv->writer)
         return TRUE;
 
+    /* Batched packets are flushed after decoding. */
+    if (is_batching(priv))
+        return TRUE;
+
     success = milter_writer_flush(priv->writer, error);
 
     return success;
@@ -381,7 +519,8 @@ cb_reader_flow (MilterReader *reader,
 
     priv = MILTER_AGENT_GET_PRIVATE(user_data);
 
-    milter_decoder_decode(priv->decoder, data, data_size, &decoder_error);
+    milter_agent_decode(MILTER_AGENT(user_data), data, data_size,
+                        &decoder_error);
 
     if (decoder_error) {
         GError *error = NULL;
@@ -450,6 +589,7 @@ milter_agent_set_reader (MilterAgent *agent, MilterReader *reader)
         DISCONNECT(finished);
 #undef DISCONNECT
 
+        milter_reader_set_decoder(priv->reader, NULL);
         g_object_unref(priv->reader);
     }
 
@@ -465,10 +605,23 @@ milter_agent_set_reader (MilterAgent *agent, MilterReader *reader)
         CONNECT(finished);
 #undef CONNECT
 
+        milter_reader_set_decoder(priv->reader, priv->decoder);
         milter_reader_set_tag(priv->reader, priv->tag);
     }
 }
 
+/**
+ * milter_agent_get_reader:
+ * @agent: A #MilterAgent.
+ *
+ * Returns: (transfer none) (nullable): The reader of the agent.
+ */
+MilterReader *
+milter_agent_get_reader (MilterAgent *agent)
+{
+    return MILTER_AGENT_GET_PRIVATE(agent)->reader;
+}
+
 GQuark
 milter_agent_error_quark (void)
 {
@@ -519,6 +672,109 @@ cb_writer_finished (MilterFinishedEmittable *emittable, gpointer user_data)
     milter_agent_set_writer(agent, NULL);
 }
 
+static void
+batch_packet (MilterAgentPrivate *priv,
+              const struct iovec *vectors, gint n_vectors)
+{
+    gint i;
+
+    if (!priv->batched_packets)
+        priv->batched_packets = g_string_new(NULL);
+    for (i = 0; i < n_vectors; i++) {
+        g_string_append_len(priv->batched_packets,
+                            vectors[i].iov_base,
+                            vectors[i].iov_len);
+    }
+    priv->n_batched_packets++;
+}
+
+static gboolean
+write_batched_packets (MilterAgent *agent, GError **error)
+{
+    MilterAgentPrivate *priv;
+    gboolean success;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    if (priv->n_batched_packets == 0)
+        return TRUE;
+
+    milter_trace("[%u] [agent][batch][write] <%u>:<%" G_GSIZE_FORMAT ">",
+                 priv->tag,
+                 priv->n_batched_packets,
+                 priv->batched_packets->len);
+    priv->n_written_packets += priv->n_batched_packets;
+    priv->n_writes++;
+    priv->n_batched_packets = 0;
+    if (!priv->writer) {
+        g_string_truncate(priv->batched_packets, 0);
+        return TRUE;
+    }
+
+    success = milter_writer_write(priv->writer,
+                                  priv->batched_packets->str,
+                                  priv->batched_packets->len,
+                                  error);
+    g_string_truncate(priv->batched_packets, 0);
+    if (success)
+        success = milter_writer_flush(priv->writer, error);
+
+    return success;
+}
+
+/**
+ * milter_agent_decode:
+ * @agent: A #MilterAgent.
+ * @chunk: The data to be decoded.
+ * @size: The size of @chunk.
+ * @error: Return location for a #GError or %NULL.
+ *
+ * Decodes @chunk by the decoder of @agent. If
+ * milter_agent_set_batch_writes() is enabled, packets that
+ * are written while decoding are written at once after all
+ * commands in @chunk are processed. Errors on writing them
+ * are reported by the #MilterErrorEmittable::error signal.
+ *
+ * Returns: %TRUE if @chunk is decoded successfully, %FALSE
+ *   otherwise.
+ *
+ * Since: 2.2.9
+ */
+gboolean
+milter_agent_decode (MilterAgent *agent,
+                     const gchar *chunk, gsize size,
+                     GError **error)
+{
+    MilterAgentPrivate *priv;
+    gboolean success;
+    GError *write_error = NULL;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    g_object_ref(agent);
+    priv->decoding_depth++;
+    success = milter_decoder_decode(priv->decoder, chunk, size, error);
+    priv->decoding_depth--;
+    if (priv->decoding_depth == 0 &&
+        !write_batched_packets(agent, &write_error)) {
+        GError *agent_error = NULL;
+
+        milter_utils_set_error_with_sub_error(&agent_error,
+                                              MILTER_AGENT_ERROR,
+                                              MILTER_AGENT_ERROR_IO_ERROR,
+                                              write_error,
+                                              "Batched output error");
+        milter_error("[%u] [agent][error][batch][write] %s",
+                     priv->tag, agent_error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(agent),
+                                    agent_error);
+        g_error_free(agent_error);
+    }
+    g_object_unref(agent);
+
+    return success;
+}
+
 gboolean
 milter_agent_write_packet (MilterAgent *agent,
                            const gchar *packet, gsize packet_size,
@@ -532,6 +788,17 @@ milter_agent_write_packet (MilterAgent *agent,
     if (!priv->writer)
         return TRUE;
 
+    if (is_batching(priv)) {
+        struct iovec vector;
+
+        vector.iov_base = (gchar *)packet;
+        vector.iov_len = packet_size;
+        batch_packet(priv, &vector, 1);
+        return TRUE;
+    }
+
+    priv->n_written_packets++;
+    priv->n_writes++;
     success = milter_writer_write(priv->writer, packet, packet_size, error);
     if (success) {
         success = milter_agent_flush(agent, error);
@@ -540,6 +807,49 @@ milter_agent_write_packet (MilterAgent *agent,
     return success;
 }
 
+/**
+ * milter_agent_write_packet_vectors:
+ * @agent: A #MilterAgent.
+ * @vectors: Packets to be written.
+ * @n_vectors: The number of @vectors.
+ * @error: Return location for a #GError or %NULL.
+ *
+ * Writes packets in @vectors as a packet. It is useful to
+ * write a DEFINE_MACRO packet and its command without
+ * concatenating them.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ */
+gboolean
+milter_agent_write_packet_vectors (MilterAgent *agent,
+                                   const struct iovec *vectors,
+                                   gint n_vectors,
+                                   GError **error)
+{
+    MilterAgentPrivate *priv;
+    gboolean success;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+
+    if (!priv->writer)
+        return TRUE;
+
+    if (is_batching(priv)) {
+        batch_packet(priv, vectors, n_vectors);
+        return TRUE;
+    }
+
+    priv->n_written_packets++;
+    priv->n_writes++;
+    success = milter_writer_write_vectors(priv->writer, vectors, n_vectors,
+                                          error);
+    if (success) {
+        success = milter_agent_flush(agent, error);
+    }
+
+    return success;
+}
+
 gboolean
 milter_agent_flush (MilterAgent *agent, GError **error)
 {
@@ -565,6 +875,14 @@ milter_agent_set_writer (MilterAgent *agent, MilterWriter *writer)
                 g_error_free(error);
             }
         }
+        if (priv->n_batched_packets > 0) {
+            GError *error = NULL;
+            if (!write_batched_packets(agent, &error)) {
+                milter_error("[%u] [agent][error][set-writer][batch] %s",
+                             priv->tag, error->message);
+                g_error_free(error);
+            }
+        }
 
 #define DISCONNECT(name)                                                \
         g_signal_handlers_disconnect_by_func(priv->writer,              \
@@ -619,6 +937,80 @@ milter_agent_get_decoder (MilterAgent *agent)
     return MILTER_AGENT_GET_PRIVATE(agent)->decoder;
 }
 
+/**
+ * milter_agent_set_codec_cache_size:
+ * @size: The max number of cached decoders and encoders
+ *   per type and thread. 0 disables the cache.
+ *
+ * Sets the max number of decoders and encoders of
+ * finished agents that are kept for new agents.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_agent_set_codec_cache_size (guint size)
+{
+    GHashTable *cache;
+
+    g_atomic_int_set(&codec_cache_size, size);
+    cache = g_private_get(&codec_cache);
+    if (cache && size == 0)
+        g_hash_table_remove_all(cache);
+}
+
+/**
+ * milter_agent_get_codec_cache_size:
+ *
+ * Returns: The max number of cached decoders and encoders
+ *   per type and thread.
+ *
+ * Since: 2.2.9
+ */
+guint
+milter_agent_get_codec_cache_size (void)
+{
+    return g_atomic_int_get(&codec_cache_size);
+}
+
+/**
+ * milter_agent_take_cached_decoder:
+ * @decoder_type: The type of the decoder.
+ *
+ * Takes a decoder of a finished agent in the current
+ * thread. #MilterAgentClass::decoder_new implementations
+ * can use it before creating a new decoder. The taken
+ * decoder has no signal handlers of the finished agent.
+ *
+ * Returns: (transfer full) (nullable): A reset decoder of
+ *   @decoder_type or %NULL if there is no cached decoder.
+ *
+ * Since: 2.2.9
+ */
+MilterDecoder *
+milter_agent_take_cached_decoder (GType decoder_type)
+{
+    return take_cached_codec(decoder_type);
+}
+
+/**
+ * milter_agent_take_cached_encoder:
+ * @encoder_type: The type of the encoder.
+ *
+ * Takes an encoder of a finished agent in the current
+ * thread. #MilterAgentClass::encoder_new implementations
+ * can use it before creating a new encoder.
+ *
+ * Returns: (transfer full) (nullable): A cleared encoder of
+ *   @encoder_type or %NULL if there is no cached encoder.
+ *
+ * Since: 2.2.9
+ */
+MilterEncoder *
+milter_agent_take_cached_encoder (GType encoder_type)
+{
+    return take_cached_codec(encoder_type);
+}
+
 gboolean
 milter_agent_start (MilterAgent *agent, GError **error)
 {
@@ -663,6 +1055,18 @@ milter_agent_shutdown (MilterAgent *agent)
 
     priv->shutting_down = TRUE;
 
+    /* Shutdown may be requested while decoding. Replies that
+     * are batched until the end of decoding must be written
+     * before the writer is shut down. */
+    if (priv->n_batched_packets > 0) {
+        GError *error = NULL;
+        if (!write_batched_packets(agent, &error)) {
+            milter_error("[%u] [agent][error][shutdown][batch] %s",
+                         priv->tag, error->message);
+            g_error_free(error);
+        }
+    }
+
     if (priv->reader) {
         have_reader = TRUE;
         milter_trace("[%u] [agent][shutdown][reader]", priv->tag);
@@ -744,6 +1148,87 @@ milter_agent_get_elapsed (MilterAgent *agent)
     }
 }
 
+/**
+ * milter_agent_set_batch_writes:
+ * @agent: A #MilterAgent.
+ * @batch: Whether packets written while decoding are batched.
+ *
+ * Sets whether packets that are written while decoding a
+ * chunk by milter_agent_decode() are written at once. It
+ * reduces system calls when the peer pipelines commands.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_agent_set_batch_writes (MilterAgent *agent, gboolean batch)
+{
+    MILTER_AGENT_GET_PRIVATE(agent)->batch_writes = batch;
+}
+
+/**
+ * milter_agent_get_batch_writes:
+ * @agent: A #MilterAgent.
+ *
+ * Returns: %TRUE if packets written while decoding are
+ *   batched, %FALSE otherwise.
+ *
+ * Since: 2.2.9
+ */
+gboolean
+milter_agent_get_batch_writes (MilterAgent *agent)
+{
+    return MILTER_AGENT_GET_PRIVATE(agent)->batch_writes;
+}
+
+/**
+ * milter_agent_get_n_written_packets:
+ * @agent: A #MilterAgent.
+ *
+ * Returns: The number of written packets since the last
+ *   milter_agent_reset_write_statistics().
+ *
+ * Since: 2.2.9
+ */
+guint
+milter_agent_get_n_written_packets (MilterAgent *agent)
+{
+    return MILTER_AGENT_GET_PRIVATE(agent)->n_written_packets;
+}
+
+/**
+ * milter_agent_get_n_writes:
+ * @agent: A #MilterAgent.
+ *
+ * Returns: The number of writes to the writer since the last
+ *   milter_agent_reset_write_statistics(). Batched packets
+ *   are written by one write.
+ *
+ * Since: 2.2.9
+ */
+guint
+milter_agent_get_n_writes (MilterAgent *agent)
+{
+    return MILTER_AGENT_GET_PRIVATE(agent)->n_writes;
+}
+
+/**
+ * milter_agent_reset_write_statistics:
+ * @agent: A #MilterAgent.
+ *
+ * Resets the number of written packets and writes.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_agent_reset_write_statistics (MilterAgent *agent)
+{
+    MilterAgentPrivate *priv;
+
+    priv = MILTER_AGENT_GET_PRIVATE(agent);
+    priv->n_written_packets = 0;
+    priv->n_writes = 0;
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
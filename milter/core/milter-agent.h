@@ -70,12 +70,31 @@ void                 milter_agent_set_writer        (MilterAgent *agent,
                                                      MilterWriter *writer);
 void                 milter_agent_set_reader        (MilterAgent *agent,
                                                      MilterReader *reader);
+MilterReader        *milter_agent_get_reader        (MilterAgent *agent);
 gboolean             milter_agent_write_packet      (MilterAgent *agent,
                                                      const char *packet,
                                                      gsize packet_size,
                                                      GError **error);
+gboolean             milter_agent_write_packet_vectors
+                                                    (MilterAgent *agent,
+                                                     const struct iovec *vectors,
+                                                     gint n_vectors,
+                                                     GError **error);
 gboolean             milter_agent_flush             (MilterAgent *agent,
                                                      GError **error);
+gboolean             milter_agent_decode            (MilterAgent *agent,
+                                                     const gchar *chunk,
+                                                     gsize        size,
+                                                     GError     **error);
+
+void                 milter_agent_set_batch_writes  (MilterAgent *agent,
+                                                     gboolean     batch);
+gboolean             milter_agent_get_batch_writes  (MilterAgent *agent);
+guint                milter_agent_get_n_written_packets
+                                                    (MilterAgent *agent);
+guint                milter_agent_get_n_writes      (MilterAgent *agent);
+void                 milter_agent_reset_write_statistics
+                                                    (MilterAgent *agent);
 
 gboolean             milter_agent_start             (MilterAgent *agent,
                                                      GError     **error);
@@ -91,6 +110,15 @@ void                 milter_agent_set_event_loop    (MilterAgent *agent,
 
 gdouble              milter_agent_get_elapsed       (MilterAgent *agent);
 
+void                 milter_agent_set_codec_cache_size
+                                                    (guint        size);
+guint                milter_agent_get_codec_cache_size
+                                                    (void);
+MilterDecoder       *milter_agent_take_cached_decoder
+                                                    (GType        decoder_type);
+MilterEncoder       *milter_agent_take_cached_encoder
+                                                    (GType        encoder_type);
+
 G_END_DECLS
 
 #endif /* __MILTER_AGENT_H__ */
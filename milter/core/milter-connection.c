@@ -349,6 +349,47 @@ milter_connection_listen (const gchar *spec, gint backlog,
                           struct sockaddr **address, socklen_t *address_size,
                           gboolean remove_unix_socket,
                           GError **error)
+{
+    return milter_connection_listen_full(spec, backlog,
+                                         address, address_size,
+                                         remove_unix_socket,
+                                         FALSE,
+                                         error);
+}
+
+static gboolean
+set_reuse_port (gint fd, const gchar *spec, GError **error)
+{
+#ifdef SO_REUSEPORT
+    gint reuse_port = 1;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                   &reuse_port, sizeof(reuse_port)) == -1) {
+        g_set_error(error,
+                    MILTER_CONNECTION_ERROR,
+                    MILTER_CONNECTION_ERROR_SET_SOCKET_OPTION_FAILURE,
+                    "failed to setsockopt(SO_REUSEPORT): %s: %s",
+                    spec, g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+#else
+    g_set_error(error,
+                MILTER_CONNECTION_ERROR,
+                MILTER_CONNECTION_ERROR_SET_SOCKET_OPTION_FAILURE,
+                "SO_REUSEPORT isn't supported: %s",
+                spec);
+    return FALSE;
+#endif
+}
+
+GIOChannel *
+milter_connection_listen_full (const gchar *spec, gint backlog,
+                               struct sockaddr **address,
+                               socklen_t *address_size,
+                               gboolean remove_unix_socket,
+                               gboolean reuse_port,
+                               GError **error)
 {
     GIOChannel *socket_channel;
     gint fd;
@@ -403,6 +444,13 @@ milter_connection_listen (const gchar *spec, gint backlog,
         return NULL;
     }
 
+    if (reuse_port && local_address->sa_family != AF_UNIX &&
+        !set_reuse_port(fd, spec, error)) {
+        g_free(local_address);
+        close(fd);
+        return NULL;
+    }
+
     if (bind(fd, local_address, local_address_size) == -1) {
         g_set_error(error,
                     MILTER_CONNECTION_ERROR,
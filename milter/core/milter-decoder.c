@@ -35,6 +35,7 @@
 #include "milter-enum-types.h"
 
 #define COMMAND_LENGTH_BYTES (sizeof(guint32))
+#define MAX_KEPT_BUFFER_SIZE (64 * 1024)
 
 #define MILTER_DECODER_GET_PRIVATE(obj)                 \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                 \
@@ -46,6 +47,7 @@ struct _MilterDecoderPrivate
 {
     gint state;
     GString *buffer;
+    gsize offset;
     gint32 command_length;
     guint tag;
 };
@@ -121,6 +123,7 @@ milter_decoder_init (MilterDecoder *decoder)
 
     priv->state = IN_START;
     priv->buffer = g_string_new(NULL);
+    priv->offset = 0;
     priv->tag = 0;
 }
 
@@ -346,6 +349,27 @@ milter_decoder_decode_header_content (const gchar *buffer, gint length,
     return TRUE;
 }
 
+static void
+prepare_buffer (MilterDecoderPrivate *priv, gsize size)
+{
+    gsize rest_size;
+
+    if (priv->offset == 0)
+        return;
+
+    rest_size = priv->buffer->len - priv->offset;
+    if (rest_size == 0) {
+        g_string_truncate(priv->buffer, 0);
+        priv->offset = 0;
+    } else if (priv->buffer->len + size >= priv->buffer->allocated_len) {
+        milter_trace("[%u] [decoder][decode][compact] "
+                     "<%" G_GSIZE_FORMAT ">",
+                     priv->tag, rest_size);
+        g_string_erase(priv->buffer, 0, priv->offset);
+        priv->offset = 0;
+    }
+}
+
 /**
  * milter_decoder_decode:
  * @decoder: A #MilterDecoder.
@@ -355,6 +379,15 @@ milter_decoder_decode_header_content (const gchar *buffer, gint length,
  *
  * Decodes a chunk. You can get decoded data by MilterDecoder::decode signals.
  *
+ * Decoded commands aren't copied. MilterDecoder::decode
+ * signal handlers can refer the current command by
+ * milter_decoder_get_buffer() and
+ * milter_decoder_get_command_length(). They are valid only
+ * in the signal emission.
+ *
+ * If @chunk is received into the buffer returned by
+ * milter_decoder_reserve_buffer(), @chunk isn't copied.
+ *
  * Returns: %TRUE on success, %FALSE otherwise.
  */
 gboolean
@@ -364,6 +397,7 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
     MilterDecoderPrivate *priv;
     gboolean loop = TRUE;
     gboolean success = TRUE;
+    gsize rest_size;
 
     priv = MILTER_DECODER_GET_PRIVATE(decoder);
 
@@ -376,49 +410,59 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
                  "<%" G_GSIZE_FORMAT "> "
                  "(%" G_GSIZE_FORMAT ")",
                  priv->tag, size,
-                 priv->buffer->len);
-    g_string_append_len(priv->buffer, chunk, size);
+                 priv->buffer->len - priv->offset);
+    if (chunk == priv->buffer->str + priv->buffer->len &&
+        priv->buffer->len + size < priv->buffer->allocated_len) {
+        /* @chunk is received into the area that is reserved by
+         * milter_decoder_reserve_buffer(). */
+        priv->buffer->len += size;
+        priv->buffer->str[priv->buffer->len] = '\0';
+    } else {
+        prepare_buffer(priv, size);
+        g_string_append_len(priv->buffer, chunk, size);
+    }
     while (loop) {
+        rest_size = priv->buffer->len - priv->offset;
         switch (priv->state) {
         case IN_START:
             milter_trace("[%u] [decoder][decode][start]", priv->tag);
-            if (priv->buffer->len == 0) {
+            if (rest_size == 0) {
                 loop = FALSE;
             } else {
                 priv->state = IN_COMMAND_LENGTH;
             }
             break;
         case IN_COMMAND_LENGTH:
-            if (priv->buffer->len < COMMAND_LENGTH_BYTES) {
+            if (rest_size < COMMAND_LENGTH_BYTES) {
                 milter_trace("[%u] [decoder][decode][length][need-more]",
                              priv->tag);
                 loop = FALSE;
             } else {
                 memcpy(&priv->command_length,
-                       priv->buffer->str,
+                       priv->buffer->str + priv->offset,
                        COMMAND_LENGTH_BYTES);
                 priv->command_length = g_ntohl(priv->command_length);
                 milter_trace("[%u] [decoder][decode][length] <%d>",
                              priv->tag, priv->command_length);
-                g_string_erase(priv->buffer, 0, COMMAND_LENGTH_BYTES);
+                priv->offset += COMMAND_LENGTH_BYTES;
                 priv->state = IN_COMMAND_CONTENT;
             }
             break;
         case IN_COMMAND_CONTENT:
-            if (priv->buffer->len < priv->command_length) {
+            if (rest_size < priv->command_length) {
                 milter_trace("[%u] [decoder][decode][content][need-more] "
                              "<%" G_GSIZE_FORMAT ">/<%d>",
                              priv->tag,
-                             priv->buffer->len, priv->command_length);
+                             rest_size, priv->command_length);
                 loop = FALSE;
             } else {
                 milter_trace("[%u] [decoder][decode][content][fill] "
                              "<%d> (%" G_GSIZE_FORMAT ")",
-                             priv->tag, priv->command_length, priv->buffer->len);
+                             priv->tag, priv->command_length, rest_size);
                 g_signal_emit(decoder, signals[DECODE], 0, error, &success);
                 if (success) {
                     priv->state = IN_START;
-                    g_string_erase(priv->buffer, 0, priv->command_length);
+                    priv->offset += priv->command_length;
                 } else {
                     priv->state = IN_ERROR;
                     loop = FALSE;
@@ -428,7 +472,7 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
         case IN_ERROR:
             milter_error("[%u] [decoder][decode][error] "
                          "<%d> (%" G_GSIZE_FORMAT ")",
-                         priv->tag, priv->command_length, priv->buffer->len);
+                         priv->tag, priv->command_length, rest_size);
             loop = FALSE;
             break;
         }
@@ -437,6 +481,37 @@ milter_decoder_decode (MilterDecoder *decoder, const gchar *chunk, gsize size,
     return success;
 }
 
+/**
+ * milter_decoder_reserve_buffer:
+ * @decoder: A #MilterDecoder.
+ * @size: The number of bytes to be received.
+ *
+ * Reserves @size bytes after the data that aren't decoded
+ * yet. Data can be received into the returned buffer
+ * directly and be passed to milter_decoder_decode() without
+ * copying them. The returned buffer is valid until the next
+ * milter_decoder_decode() call.
+ *
+ * Returns: (transfer none): The buffer to receive data.
+ */
+gchar *
+milter_decoder_reserve_buffer (MilterDecoder *decoder, gsize size)
+{
+    MilterDecoderPrivate *priv;
+    gsize length;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+
+    prepare_buffer(priv, size);
+    length = priv->buffer->len;
+    if (length + size >= priv->buffer->allocated_len) {
+        g_string_set_size(priv->buffer, length + size);
+        g_string_truncate(priv->buffer, length);
+    }
+
+    return priv->buffer->str + length;
+}
+
 static void
 set_unexpected_end_error (GError **error, MilterDecoderPrivate *priv,
                           gsize required_length, const gchar *decoding_target)
@@ -445,8 +520,10 @@ set_unexpected_end_error (GError **error, MilterDecoderPrivate *priv,
 
     message = g_string_new("stream is ended unexpectedly: ");
     append_need_more_bytes_for_decoding_message(message,
-                                                priv->buffer->str,
-                                                priv->buffer->len,
+                                                priv->buffer->str +
+                                                priv->offset,
+                                                priv->buffer->len -
+                                                priv->offset,
                                                 required_length,
                                                 decoding_target);
     g_set_error(error,
@@ -485,10 +562,42 @@ milter_decoder_end_decode (MilterDecoder *decoder, GError **error)
     return priv->state != IN_ERROR;
 }
 
+/**
+ * milter_decoder_reset:
+ * @decoder: A #MilterDecoder.
+ *
+ * Discards data that aren't decoded yet and makes @decoder
+ * ready to decode a new stream. The buffer is kept for
+ * reuse unless it grew larger than the maximum read size.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_decoder_reset (MilterDecoder *decoder)
+{
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+
+    priv->state = IN_START;
+    priv->offset = 0;
+    priv->command_length = 0;
+    priv->tag = 0;
+    if (priv->buffer->allocated_len > MAX_KEPT_BUFFER_SIZE) {
+        g_string_free(priv->buffer, TRUE);
+        priv->buffer = g_string_new(NULL);
+    } else {
+        g_string_truncate(priv->buffer, 0);
+    }
+}
+
 const gchar *
 milter_decoder_get_buffer (MilterDecoder *decoder)
 {
-    return MILTER_DECODER_GET_PRIVATE(decoder)->buffer->str;
+    MilterDecoderPrivate *priv;
+
+    priv = MILTER_DECODER_GET_PRIVATE(decoder);
+    return priv->buffer->str + priv->offset;
 }
 
 gint32
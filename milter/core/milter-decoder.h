@@ -77,6 +77,9 @@ gboolean         milter_decoder_decode            (MilterDecoder   *decoder,
                                                    const gchar     *chunk,
                                                    gsize            size,
                                                    GError         **error);
+gchar           *milter_decoder_reserve_buffer    (MilterDecoder   *decoder,
+                                                   gsize            size);
+void             milter_decoder_reset             (MilterDecoder   *decoder);
 gboolean         milter_decoder_end_decode        (MilterDecoder   *decoder,
                                                    GError         **error);
 const gchar     *milter_decoder_get_buffer        (MilterDecoder   *decoder);
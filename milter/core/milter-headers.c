@@ -21,6 +21,8 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-headers.h"
 #include "milter-utils.h"
 
@@ -41,18 +43,50 @@ G_DEFINE_BOXED_TYPE(MilterHeader,
                     milter_header_copy,
                     milter_header_free)
 
+/* The name and the initial value are stored in the same
+ * memory block as the header. A header costs one allocation
+ * instead of three. */
 MilterHeader *
 milter_header_new (const gchar *name, const gchar *value)
 {
     MilterHeader *header;
-
-    header = g_new0(MilterHeader, 1);
-    header->name = g_strdup(name);
-    header->value = g_strdup(value);
+    gsize name_size = 0;
+    gsize value_size = 0;
+    gchar *strings;
+
+    if (name)
+        name_size = strlen(name) + 1;
+    if (value)
+        value_size = strlen(value) + 1;
+
+    header = g_malloc(sizeof(MilterHeader) + name_size + value_size);
+    strings = (gchar *)(header + 1);
+    header->name = NULL;
+    header->value = NULL;
+    if (name) {
+        memcpy(strings, name, name_size);
+        header->name = strings;
+    }
+    if (value) {
+        memcpy(strings + name_size, value, value_size);
+        header->value = strings + name_size;
+    }
 
     return header;
 }
 
+static gboolean
+milter_header_is_inline_value (MilterHeader *header)
+{
+    const gchar *strings;
+
+    strings = (const gchar *)(header + 1);
+    if (header->name)
+        strings += strlen(header->name) + 1;
+
+    return header->value == strings;
+}
+
 MilterHeader *
 milter_header_copy (MilterHeader *header)
 {
@@ -62,8 +96,8 @@ milter_header_copy (MilterHeader *header)
 void
 milter_header_free (MilterHeader *header)
 {
-    g_free(header->name);
-    g_free(header->value);
+    if (header->value && !milter_header_is_inline_value(header))
+        g_free(header->value);
 
     g_free(header);
 }
@@ -102,7 +136,7 @@ static void
 milter_header_change_value (MilterHeader *header,
                             const gchar *new_value)
 {
-    if (header->value)
+    if (header->value && !milter_header_is_inline_value(header))
         g_free(header->value);
     header->value = g_strdup(new_value);
 }
@@ -112,9 +146,21 @@ milter_header_change_value (MilterHeader *header,
                                  MILTER_TYPE_HEADERS,     \
                                  MilterHeadersPrivate))
 
+/*
+ * headers is the storage. name_index maps a header name to the
+ * positions of headers that have the name and folded_name_index
+ * maps a lower case header name to the first position + 1 of
+ * headers that have the name case-insensitively. Indexes are
+ * updated on append and rebuilt lazily after other changes.
+ * header_list is built lazily for milter_headers_get_list().
+ */
 typedef struct _MilterHeadersPrivate MilterHeadersPrivate;
 struct _MilterHeadersPrivate
 {
+    GPtrArray *headers;
+    GHashTable *name_index;
+    GHashTable *folded_name_index;
+    gboolean index_is_valid;
     GList *header_list;
 };
 
@@ -154,12 +200,39 @@ milter_headers_class_init (MilterHeadersClass *klass)
                              sizeof(MilterHeadersPrivate));
 }
 
+static guint
+name_hash (gconstpointer name)
+{
+    if (!name)
+        return 0;
+    return g_str_hash(name);
+}
+
+static gboolean
+name_equal (gconstpointer name1, gconstpointer name2)
+{
+    return string_equal(name1, name2);
+}
+
+static void
+positions_free (gpointer positions)
+{
+    g_array_free(positions, TRUE);
+}
+
 static void
 milter_headers_init (MilterHeaders *headers)
 {
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    priv->headers =
+        g_ptr_array_new_with_free_func((GDestroyNotify)milter_header_free);
+    priv->name_index = g_hash_table_new_full(name_hash, name_equal,
+                                             NULL, positions_free);
+    priv->folded_name_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                    g_free, NULL);
+    priv->index_is_valid = TRUE;
     priv->header_list = NULL;
 }
 
@@ -171,11 +244,25 @@ dispose (GObject *object)
     priv = MILTER_HEADERS_GET_PRIVATE(object);
 
     if (priv->header_list) {
-        g_list_foreach(priv->header_list, (GFunc)milter_header_free, NULL);
         g_list_free(priv->header_list);
         priv->header_list = NULL;
     }
 
+    if (priv->name_index) {
+        g_hash_table_unref(priv->name_index);
+        priv->name_index = NULL;
+    }
+
+    if (priv->folded_name_index) {
+        g_hash_table_unref(priv->folded_name_index);
+        priv->folded_name_index = NULL;
+    }
+
+    if (priv->headers) {
+        g_ptr_array_unref(priv->headers);
+        priv->headers = NULL;
+    }
+
     G_OBJECT_CLASS(milter_headers_parent_class)->dispose(object);
 }
 
@@ -205,6 +292,130 @@ get_property (GObject    *object,
     }
 }
 
+static void
+index_header (MilterHeadersPrivate *priv, MilterHeader *header, guint position)
+{
+    GArray *positions;
+
+    positions = g_hash_table_lookup(priv->name_index, header->name);
+    if (!positions) {
+        positions = g_array_new(FALSE, FALSE, sizeof(guint));
+        g_hash_table_insert(priv->name_index, header->name, positions);
+    }
+    g_array_append_val(positions, position);
+
+    if (header->name) {
+        gchar *folded_name;
+
+        folded_name = g_ascii_strdown(header->name, -1);
+        if (g_hash_table_contains(priv->folded_name_index, folded_name))
+            g_free(folded_name);
+        else
+            g_hash_table_insert(priv->folded_name_index,
+                                folded_name,
+                                GUINT_TO_POINTER(position + 1));
+    }
+}
+
+static void
+ensure_index (MilterHeadersPrivate *priv)
+{
+    guint i;
+
+    if (priv->index_is_valid)
+        return;
+
+    for (i = 0; i < priv->headers->len; i++) {
+        index_header(priv, g_ptr_array_index(priv->headers, i), i);
+    }
+    priv->index_is_valid = TRUE;
+}
+
+static void
+clear_header_list (MilterHeadersPrivate *priv)
+{
+    if (priv->header_list) {
+        g_list_free(priv->header_list);
+        priv->header_list = NULL;
+    }
+}
+
+/* Called after headers are inserted or removed. Keys of name_index
+ * refer names of headers so it's cleared before headers are freed. */
+static void
+invalidate_index (MilterHeadersPrivate *priv)
+{
+    clear_header_list(priv);
+    if (!priv->index_is_valid)
+        return;
+    g_hash_table_remove_all(priv->name_index);
+    g_hash_table_remove_all(priv->folded_name_index);
+    priv->index_is_valid = FALSE;
+}
+
+static GArray *
+lookup_positions (MilterHeadersPrivate *priv, const gchar *name)
+{
+    ensure_index(priv);
+    return g_hash_table_lookup(priv->name_index, name);
+}
+
+static gint
+find_position (MilterHeadersPrivate *priv, MilterHeader *target)
+{
+    GArray *positions;
+    guint i;
+
+    positions = lookup_positions(priv, target->name);
+    if (!positions)
+        return -1;
+
+    for (i = 0; i < positions->len; i++) {
+        guint position = g_array_index(positions, guint, i);
+        MilterHeader *header = g_ptr_array_index(priv->headers, position);
+
+        if (string_equal(header->value, target->value))
+            return position;
+    }
+    return -1;
+}
+
+static gint
+lookup_position_by_name_with_index (MilterHeadersPrivate *priv,
+                                    const gchar *name,
+                                    guint index)
+{
+    GArray *positions;
+
+    positions = lookup_positions(priv, name);
+    if (!positions || index < 1 || index > positions->len)
+        return -1;
+
+    return g_array_index(positions, guint, index - 1);
+}
+
+static void
+remove_position (MilterHeadersPrivate *priv, guint position)
+{
+    invalidate_index(priv);
+    g_ptr_array_remove_index(priv->headers, position);
+}
+
+static void
+insert_position (MilterHeadersPrivate *priv, guint position,
+                 MilterHeader *header)
+{
+    if (position >= priv->headers->len) {
+        clear_header_list(priv);
+        g_ptr_array_add(priv->headers, header);
+        if (priv->index_is_valid)
+            index_header(priv, header, priv->headers->len - 1);
+    } else {
+        invalidate_index(priv);
+        g_ptr_array_insert(priv->headers, position, header);
+    }
+}
+
 MilterHeaders *
 milter_headers_new (void)
 {
@@ -221,14 +432,14 @@ MilterHeaders *
 milter_headers_copy (MilterHeaders *headers)
 {
     MilterHeaders *copied_headers;
-    GList *node;
     MilterHeadersPrivate *priv;
+    guint i;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
     copied_headers = milter_headers_new();
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    for (i = 0; i < priv->headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(priv->headers, i);
 
         milter_headers_append_header(copied_headers, header->name, header->value);
     }
@@ -245,7 +456,20 @@ milter_headers_copy (MilterHeaders *headers)
 const GList *
 milter_headers_get_list (MilterHeaders *headers)
 {
-    return MILTER_HEADERS_GET_PRIVATE(headers)->header_list;
+    MilterHeadersPrivate *priv;
+
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    if (!priv->header_list) {
+        guint i;
+
+        for (i = priv->headers->len; i > 0; i--) {
+            priv->header_list =
+                g_list_prepend(priv->header_list,
+                               g_ptr_array_index(priv->headers, i - 1));
+        }
+    }
+
+    return priv->header_list;
 }
 
 MilterHeader *
@@ -253,22 +477,13 @@ milter_headers_find (MilterHeaders *headers,
                      MilterHeader *header)
 {
     MilterHeadersPrivate *priv;
-    GList *found_node;
+    gint position;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    found_node = g_list_find_custom(priv->header_list,
-                                    header,
-                                    (GCompareFunc)milter_header_compare);
-    if (!found_node)
+    position = find_position(priv, header);
+    if (position < 0)
         return NULL;
-    return (MilterHeader *)(found_node->data);
-}
-
-static gint
-milter_header_name_compare (MilterHeader *header1,
-                            const gchar *name)
-{
-    return milter_utils_strcmp0(header1->name, name);
+    return g_ptr_array_index(priv->headers, position);
 }
 
 MilterHeader *
@@ -276,16 +491,13 @@ milter_headers_lookup_by_name (MilterHeaders *headers,
                                const gchar *name)
 {
     MilterHeadersPrivate *priv;
-    GList *found_node;
+    gint position;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    found_node = g_list_find_custom(priv->header_list,
-                                    name,
-                                    (GCompareFunc)milter_header_name_compare);
-    if (!found_node)
+    position = lookup_position_by_name_with_index(priv, name, 1);
+    if (position < 0)
         return NULL;
-    return (MilterHeader*)found_node->data;
+    return g_ptr_array_index(priv->headers, position);
 }
 
 MilterHeader *
@@ -293,17 +505,15 @@ milter_headers_get_nth_header (MilterHeaders *headers,
                                guint index)
 {
     MilterHeadersPrivate *priv;
-    gpointer nth_data;
 
     if (index < 1)
         return NULL;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    nth_data = g_list_nth_data(priv->header_list, index - 1);
-    if (!nth_data)
+    if (index > priv->headers->len)
         return NULL;
 
-    return (MilterHeader*)nth_data;
+    return g_ptr_array_index(priv->headers, index - 1);
 }
 
 gint
@@ -311,21 +521,21 @@ milter_headers_index_in_same_header_name (MilterHeaders *headers,
                                           MilterHeader *target)
 {
     MilterHeadersPrivate *priv;
-    GList *node;
-    guint found_count = 0;
+    GArray *positions;
+    guint i;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
+    positions = lookup_positions(priv, target->name);
+    if (!positions)
+        return -1;
 
-        if (!string_equal(header->name, target->name))
-            continue;
-
-        found_count++;
+    for (i = 0; i < positions->len; i++) {
+        guint position = g_array_index(positions, guint, i);
+        MilterHeader *header = g_ptr_array_index(priv->headers, position);
 
         if (string_equal(header->value, target->value))
-            return found_count;
+            return i + 1;
     }
     return -1;
 }
@@ -335,16 +545,15 @@ milter_headers_remove (MilterHeaders *headers,
                        MilterHeader *header)
 {
     MilterHeadersPrivate *priv;
-    MilterHeader *found_header;
+    gint position;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    found_header = milter_headers_find(headers, header);
-    if (!found_header)
+    position = find_position(priv, header);
+    if (position < 0)
         return FALSE;
 
-    priv->header_list = g_list_remove(priv->header_list, found_header);
-    milter_header_free(found_header);
+    remove_position(priv, position);
 
     return TRUE;
 }
@@ -355,25 +564,24 @@ milter_headers_add_header (MilterHeaders *headers,
                            const gchar *value)
 {
     MilterHeadersPrivate *priv;
-    GList *node, *same_name_header = NULL;
+    gchar *folded_name;
+    guint same_name_position;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
 
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
-        if (g_ascii_strcasecmp(header->name, name) == 0) {
-            same_name_header = node;
-            break;
-        }
-    }
+    ensure_index(priv);
+    folded_name = g_ascii_strdown(name, -1);
+    same_name_position =
+        GPOINTER_TO_UINT(g_hash_table_lookup(priv->folded_name_index,
+                                             folded_name));
+    g_free(folded_name);
 
-    if (same_name_header) {
-        priv->header_list = g_list_insert_before(priv->header_list,
-                                                 same_name_header,
-                                                 milter_header_new(name, value));
+    if (same_name_position > 0) {
+        insert_position(priv, same_name_position - 1,
+                        milter_header_new(name, value));
     } else {
-        priv->header_list = g_list_append(priv->header_list,
-                                          milter_header_new(name, value));
+        insert_position(priv, priv->headers->len,
+                        milter_header_new(name, value));
     }
 
     return TRUE;
@@ -387,8 +595,7 @@ milter_headers_append_header (MilterHeaders *headers,
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_append(priv->header_list,
-                                      milter_header_new(name, value));
+    insert_position(priv, priv->headers->len, milter_header_new(name, value));
 
     return TRUE;
 }
@@ -402,54 +609,28 @@ milter_headers_insert_header (MilterHeaders *headers,
     MilterHeadersPrivate *priv;
 
     priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    priv->header_list = g_list_insert(priv->header_list,
-                                      milter_header_new(name, value),
-                                      position);
+    insert_position(priv, position, milter_header_new(name, value));
 
     return TRUE;
 }
 
-static MilterHeader *
-milter_headers_lookup_by_name_with_index (MilterHeaders *headers,
-                                          const gchar *name,
-                                          guint index)
-{
-    MilterHeadersPrivate *priv;
-    GList *node;
-    guint found_count = 0;
-
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-
-    for (node = priv->header_list; node; node = g_list_next(node)) {
-        MilterHeader *header = node->data;
-
-        if (!string_equal(header->name, name))
-            continue;
-
-        found_count++;
-
-        if (found_count == index)
-            return header;
-    }
-
-    return NULL;
-}
-
 gboolean
 milter_headers_change_header (MilterHeaders *headers,
                               const gchar *name,
                               guint index,
                               const gchar *value)
 {
-    MilterHeader *header;
+    MilterHeadersPrivate *priv;
+    gint position;
 
     if (!value)
         return milter_headers_delete_header(headers, name, index);
 
-    header = milter_headers_lookup_by_name_with_index(headers, name, index);
-    if (header)
-        milter_header_change_value(header, value);
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    position = lookup_position_by_name_with_index(priv, name, index);
+    if (position >= 0)
+        milter_header_change_value(g_ptr_array_index(priv->headers, position),
+                                   value);
     else
         milter_headers_add_header(headers, name, value);
 
@@ -461,16 +642,15 @@ milter_headers_delete_header (MilterHeaders *headers,
                               const gchar *name,
                               guint index)
 {
-    MilterHeader *header;
     MilterHeadersPrivate *priv;
+    gint position;
 
-    header = milter_headers_lookup_by_name_with_index(headers, name, index);
-    if (!header)
+    priv = MILTER_HEADERS_GET_PRIVATE(headers);
+    position = lookup_position_by_name_with_index(priv, name, index);
+    if (position < 0)
         return FALSE;
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    priv->header_list = g_list_remove(priv->header_list, header);
-    milter_header_free(header);
+    remove_position(priv, position);
 
     return TRUE;
 }
@@ -478,10 +658,186 @@ milter_headers_delete_header (MilterHeaders *headers,
 guint
 milter_headers_length (MilterHeaders *headers)
 {
-    MilterHeadersPrivate *priv;
+    return MILTER_HEADERS_GET_PRIVATE(headers)->headers->len;
+}
 
-    priv = MILTER_HEADERS_GET_PRIVATE(headers);
-    return g_list_length(priv->header_list);
+/*
+ * Headers in a group have the same name (or the same name and the
+ * same value) and are chained by next in original order. first
+ * skips removed headers lazily.
+ */
+typedef struct _DiffGroup DiffGroup;
+struct _DiffGroup
+{
+    gint first;
+    gint last;
+};
+
+static guint
+header_hash (gconstpointer data)
+{
+    const MilterHeader *header = data;
+
+    return name_hash(header->name) * 31 + name_hash(header->value);
+}
+
+static gboolean
+header_name_equal (gconstpointer data1, gconstpointer data2)
+{
+    const MilterHeader *header1 = data1;
+    const MilterHeader *header2 = data2;
+
+    return string_equal(header1->name, header2->name);
+}
+
+static guint
+header_name_hash (gconstpointer data)
+{
+    const MilterHeader *header = data;
+
+    return name_hash(header->name);
+}
+
+static void
+diff_group_add (GHashTable *groups, MilterHeader *header, gint position,
+                gint *next)
+{
+    DiffGroup *group;
+
+    group = g_hash_table_lookup(groups, header);
+    if (group) {
+        next[group->last] = position;
+        group->last = position;
+    } else {
+        group = g_new(DiffGroup, 1);
+        group->first = position;
+        group->last = position;
+        g_hash_table_insert(groups, header, group);
+    }
+}
+
+static gint
+diff_group_first (GHashTable *groups, MilterHeader *header,
+                  const gint *next, const gboolean *removed)
+{
+    DiffGroup *group;
+
+    group = g_hash_table_lookup(groups, header);
+    if (!group)
+        return -1;
+    while (group->first >= 0 && removed[group->first])
+        group->first = next[group->first];
+    return group->first;
+}
+
+/**
+ * milter_headers_diff:
+ * @original: The original headers.
+ * @headers: The changed headers.
+ * @func: (scope call): The function called for each operation.
+ * @user_data: The data passed to @func.
+ *
+ * Reports operations that change @original to @headers. Headers in
+ * @headers that aren't in @original are reported as
+ * %MILTER_HEADERS_DIFF_CHANGE of a header that has the same name in
+ * @original if there is, otherwise %MILTER_HEADERS_DIFF_INSERT at
+ * the position in @headers. Rest headers in @original are reported
+ * as %MILTER_HEADERS_DIFF_DELETE from the last one. Index of
+ * %MILTER_HEADERS_DIFF_CHANGE and %MILTER_HEADERS_DIFF_DELETE is
+ * the same as milter_headers_index_in_same_header_name() in
+ * @original.
+ *
+ * It runs in O(length of @original + length of @headers).
+ */
+void
+milter_headers_diff (MilterHeaders *original,
+                     MilterHeaders *headers,
+                     MilterHeadersDiffFunc func,
+                     gpointer user_data)
+{
+    GPtrArray *original_headers, *changed_headers;
+    GHashTable *name_groups, *pair_groups;
+    GHashTable *occurrences;
+    gint *next_in_name, *next_in_pair;
+    guint *pair_index;
+    gboolean *removed;
+    guint i, n_originals;
+
+    original_headers = MILTER_HEADERS_GET_PRIVATE(original)->headers;
+    changed_headers = MILTER_HEADERS_GET_PRIVATE(headers)->headers;
+    n_originals = original_headers->len;
+
+    next_in_name = g_new(gint, n_originals);
+    next_in_pair = g_new(gint, n_originals);
+    pair_index = g_new(guint, n_originals);
+    removed = g_new0(gboolean, n_originals);
+    name_groups = g_hash_table_new_full(header_name_hash, header_name_equal,
+                                        NULL, g_free);
+    pair_groups = g_hash_table_new_full(header_hash, milter_header_equal,
+                                        NULL, g_free);
+    occurrences = g_hash_table_new(header_name_hash, header_name_equal);
+
+    for (i = 0; i < n_originals; i++) {
+        MilterHeader *header = g_ptr_array_index(original_headers, i);
+        guint occurrence;
+        gint first_in_pair;
+
+        next_in_name[i] = -1;
+        next_in_pair[i] = -1;
+        diff_group_add(name_groups, header, i, next_in_name);
+        diff_group_add(pair_groups, header, i, next_in_pair);
+
+        occurrence = GPOINTER_TO_UINT(g_hash_table_lookup(occurrences,
+                                                          header)) + 1;
+        g_hash_table_insert(occurrences, header, GUINT_TO_POINTER(occurrence));
+        first_in_pair =
+            ((DiffGroup *)g_hash_table_lookup(pair_groups, header))->first;
+        if (first_in_pair == (gint)i)
+            pair_index[i] = occurrence;
+        else
+            pair_index[i] = pair_index[first_in_pair];
+    }
+
+    for (i = 0; i < changed_headers->len; i++) {
+        MilterHeader *header = g_ptr_array_index(changed_headers, i);
+        gint position;
+
+        position = diff_group_first(pair_groups, header,
+                                    next_in_pair, removed);
+        if (position >= 0) {
+            removed[position] = TRUE;
+            continue;
+        }
+
+        position = diff_group_first(name_groups, header,
+                                    next_in_name, removed);
+        if (position < 0) {
+            func(MILTER_HEADERS_DIFF_INSERT, i,
+                 header->name, header->value, user_data);
+            continue;
+        }
+        func(MILTER_HEADERS_DIFF_CHANGE, pair_index[position],
+             header->name, header->value, user_data);
+        removed[position] = TRUE;
+    }
+
+    for (i = n_originals; i > 0; i--) {
+        MilterHeader *header;
+
+        if (removed[i - 1])
+            continue;
+        header = g_ptr_array_index(original_headers, i - 1);
+        func(MILTER_HEADERS_DIFF_DELETE, pair_index[i - 1],
+             header->name, NULL, user_data);
+    }
+
+    g_hash_table_unref(occurrences);
+    g_hash_table_unref(pair_groups);
+    g_hash_table_unref(name_groups);
+    g_free(removed);
+    g_free(pair_index);
+    g_free(next_in_pair);
+    g_free(next_in_name);
 }
 
 /*
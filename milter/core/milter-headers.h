@@ -58,6 +58,22 @@ void          milter_header_inspect
 typedef struct _MilterHeaders         MilterHeaders;
 typedef struct _MilterHeadersClass    MilterHeadersClass;
 
+typedef enum
+{
+    MILTER_HEADERS_DIFF_INSERT,
+    MILTER_HEADERS_DIFF_CHANGE,
+    MILTER_HEADERS_DIFF_DELETE
+} MilterHeadersDiffType;
+
+/* index is the position for MILTER_HEADERS_DIFF_INSERT and the index
+ * in the same header name for others. value is NULL for
+ * MILTER_HEADERS_DIFF_DELETE. */
+typedef void (*MilterHeadersDiffFunc) (MilterHeadersDiffType type,
+                                       guint                 index,
+                                       const gchar          *name,
+                                       const gchar          *value,
+                                       gpointer              user_data);
+
 struct _MilterHeaders
 {
     GObject object;
@@ -110,6 +126,11 @@ gint           milter_headers_index_in_same_header_name
                                           (MilterHeaders *headers,
                                            MilterHeader *header);
 
+void           milter_headers_diff        (MilterHeaders *original,
+                                           MilterHeaders *headers,
+                                           MilterHeadersDiffFunc func,
+                                           gpointer user_data);
+
 G_END_DECLS
 
 #endif /* __MILTER_HEADERS_H__ */
@@ -0,0 +1,1036 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <glib/gstdio.h>
+
+#include "milter-log-writer.h"
+#include "milter-enum-types.h"
+
+/**
+ * SECTION: milter-log-writer
+ * @title: MilterLogWriter
+ * @short_description: Asynchronous log output.
+ *
+ * The %MilterLogWriter writes log lines to a file or
+ * syslog in a dedicated thread. Callers only push lines to
+ * a lock-free queue, so a slow disk doesn't block the event
+ * loop. Queued lines are written in large batches.
+ *
+ * A log record can also be queued with its level, location
+ * and time by milter_log_writer_write_log_va_list(). The
+ * writer thread decorates it with the items such as the
+ * level names and the time, so the caller only formats the
+ * message itself.
+ *
+ * The total size of queued lines is limited by
+ * milter_log_writer_set_max_buffered_size(). Lines over the
+ * limit are dropped and counted. The number of dropped
+ * lines is also written to the log.
+ *
+ * The thread is started by the first write. Queued lines
+ * are written before the process is forked, so they aren't
+ * lost by a parent that exits right after fork(). The child
+ * starts its own thread. Call milter_log_writer_flush_all()
+ * before _exit().
+ */
+
+#define BATCH_SIZE (64 * 1024)
+#define NO_PENDING_FD (-2)
+#define SYSLOG_PRIORITY_NONE (-1)
+
+#define MILTER_LOG_WRITER_GET_PRIVATE(obj)                      \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_LOG_WRITER,        \
+                                 MilterLogWriterPrivate))
+
+typedef struct _Entry Entry;
+struct _Entry
+{
+    Entry *next;
+    gint priority;
+    gsize size;
+    /* Only for a log record. Its domain, file and function
+     * are stored in data. */
+    gchar *message;
+    MilterLogLevelFlags level;
+    MilterLogItemFlags items;
+    gboolean colorize;
+    guint line;
+    gint64 timestamp;
+    const gchar *domain;
+    const gchar *file;
+    const gchar *function;
+    gchar data[1];
+};
+
+typedef struct _MilterLogWriterPrivate	MilterLogWriterPrivate;
+struct _MilterLogWriterPrivate
+{
+    /* Shared without lock. */
+    gpointer head;
+    gint buffered_size;
+    guint n_pushed;
+    guint n_dropped;
+    gsize max_buffered_size;
+
+    /* Protected by mutex. */
+    GMutex mutex;
+    GCond cond;
+    GCond flushed_cond;
+    GThread *thread;
+    pid_t pid;
+    gboolean quit;
+    guint n_written;
+    gchar *path;
+    gint pending_fd;
+    gboolean reopen_requested;
+
+    /* Used only by the writer thread. */
+    gint fd;
+    guint n_reported_dropped;
+    GString *batch;
+    GString *record;
+};
+
+G_DEFINE_TYPE(MilterLogWriter, milter_log_writer, G_TYPE_OBJECT)
+
+static GMutex writers_mutex;
+static GList *writers = NULL;
+static GOnce fork_handlers_once = G_ONCE_INIT;
+
+static void dispose        (GObject         *object);
+
+static void
+milter_log_writer_class_init (MilterLogWriterClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+
+    g_type_class_add_private(gobject_class, sizeof(MilterLogWriterPrivate));
+}
+
+static void prepare_fork (void);
+static void finish_fork_in_parent (void);
+static void finish_fork_in_child (void);
+
+static gpointer
+install_fork_handlers (gpointer data)
+{
+    pthread_atfork(prepare_fork, finish_fork_in_parent, finish_fork_in_child);
+    return NULL;
+}
+
+static void
+milter_log_writer_init (MilterLogWriter *writer)
+{
+    MilterLogWriterPrivate *priv;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+
+    priv->head = NULL;
+    priv->buffered_size = 0;
+    priv->n_pushed = 0;
+    priv->n_dropped = 0;
+    priv->max_buffered_size = MILTER_LOG_WRITER_DEFAULT_MAX_BUFFERED_SIZE;
+
+    g_mutex_init(&(priv->mutex));
+    g_cond_init(&(priv->cond));
+    g_cond_init(&(priv->flushed_cond));
+    priv->thread = NULL;
+    priv->pid = 0;
+    priv->quit = FALSE;
+    priv->n_written = 0;
+    priv->path = NULL;
+    priv->pending_fd = NO_PENDING_FD;
+    priv->reopen_requested = FALSE;
+
+    priv->fd = STDOUT_FILENO;
+    priv->n_reported_dropped = 0;
+    priv->batch = g_string_sized_new(BATCH_SIZE);
+    priv->record = g_string_new(NULL);
+
+    g_once(&fork_handlers_once, install_fork_handlers, NULL);
+    g_mutex_lock(&writers_mutex);
+    writers = g_list_prepend(writers, writer);
+    g_mutex_unlock(&writers_mutex);
+}
+
+static void
+free_entries (Entry *entries)
+{
+    while (entries) {
+        Entry *next = entries->next;
+        g_free(entries->message);
+        g_free(entries);
+        entries = next;
+    }
+}
+
+static void
+close_fd (gint fd)
+{
+    if (fd > STDERR_FILENO)
+        close(fd);
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterLogWriterPrivate *priv;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(object);
+
+    g_mutex_lock(&writers_mutex);
+    writers = g_list_remove(writers, object);
+    g_mutex_unlock(&writers_mutex);
+
+    if (priv->thread) {
+        if (priv->pid == getpid()) {
+            g_mutex_lock(&(priv->mutex));
+            priv->quit = TRUE;
+            g_cond_signal(&(priv->cond));
+            g_mutex_unlock(&(priv->mutex));
+            g_thread_join(priv->thread);
+        }
+        priv->thread = NULL;
+    }
+
+    if (priv->head) {
+        free_entries(priv->head);
+        priv->head = NULL;
+    }
+
+    if (priv->pending_fd != NO_PENDING_FD) {
+        close_fd(priv->pending_fd);
+        priv->pending_fd = NO_PENDING_FD;
+    }
+
+    if (priv->fd != -1) {
+        close_fd(priv->fd);
+        priv->fd = -1;
+    }
+
+    if (priv->path) {
+        g_free(priv->path);
+        priv->path = NULL;
+    }
+
+    if (priv->batch) {
+        g_string_free(priv->batch, TRUE);
+        priv->batch = NULL;
+    }
+
+    if (priv->record) {
+        g_string_free(priv->record, TRUE);
+        priv->record = NULL;
+    }
+
+    G_OBJECT_CLASS(milter_log_writer_parent_class)->dispose(object);
+}
+
+MilterLogWriter *
+milter_log_writer_new (void)
+{
+    return g_object_new(MILTER_TYPE_LOG_WRITER, NULL);
+}
+
+static gint
+open_path (const gchar *path, GError **error)
+{
+    gint fd;
+
+    fd = g_open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd == -1) {
+        g_set_error(error,
+                    G_FILE_ERROR,
+                    g_file_error_from_errno(errno),
+                    "failed to set log output path: <%s>: %s",
+                    path, g_strerror(errno));
+    }
+
+    return fd;
+}
+
+/* Must be called with mutex. */
+static void
+apply_output_changes (MilterLogWriterPrivate *priv)
+{
+    if (priv->pending_fd != NO_PENDING_FD) {
+        close_fd(priv->fd);
+        priv->fd = priv->pending_fd;
+        priv->pending_fd = NO_PENDING_FD;
+    }
+
+    if (priv->reopen_requested) {
+        priv->reopen_requested = FALSE;
+        if (priv->path) {
+            gint fd;
+
+            fd = open_path(priv->path, NULL);
+            if (fd != -1) {
+                close_fd(priv->fd);
+                priv->fd = fd;
+            }
+        }
+    }
+}
+
+static void
+write_all (gint fd, const gchar *data, gsize size)
+{
+    while (size > 0) {
+        gssize written_size;
+
+        written_size = write(fd, data, size);
+        if (written_size == -1) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += written_size;
+        size -= written_size;
+    }
+}
+
+static void
+flush_batch (MilterLogWriterPrivate *priv)
+{
+    if (priv->batch->len == 0)
+        return;
+
+    if (priv->fd != -1)
+        write_all(priv->fd, priv->batch->str, priv->batch->len);
+    g_string_truncate(priv->batch, 0);
+}
+
+static guint
+write_entries (MilterLogWriterPrivate *priv, Entry *entries)
+{
+    Entry *entry;
+    guint n_entries = 0;
+    guint n_dropped;
+    gboolean syslog_used = FALSE;
+
+    for (entry = entries; entry; entry = entry->next) {
+        if (entry->message) {
+            g_string_truncate(priv->record, 0);
+            milter_log_writer_format_log(priv->record,
+                                         entry->domain,
+                                         entry->level,
+                                         entry->items,
+                                         entry->colorize,
+                                         entry->file,
+                                         entry->line,
+                                         entry->function,
+                                         entry->timestamp,
+                                         entry->message);
+            if (priv->batch->len + priv->record->len > BATCH_SIZE)
+                flush_batch(priv);
+            g_string_append_len(priv->batch,
+                                priv->record->str, priv->record->len);
+        } else if (entry->priority == SYSLOG_PRIORITY_NONE) {
+            if (priv->batch->len + entry->size > BATCH_SIZE)
+                flush_batch(priv);
+            g_string_append_len(priv->batch, entry->data, entry->size);
+        } else {
+            syslog_used = TRUE;
+            syslog(entry->priority, "%s", entry->data);
+        }
+        g_atomic_int_add(&(priv->buffered_size), -(gint)(entry->size));
+        n_entries++;
+    }
+
+    n_dropped = g_atomic_int_get(&(priv->n_dropped));
+    if (n_dropped != priv->n_reported_dropped) {
+        gchar *message;
+
+        message = g_strdup_printf("[log-writer][dropped] <%u>",
+                                  n_dropped - priv->n_reported_dropped);
+        if (syslog_used) {
+            syslog(LOG_WARNING, "%s", message);
+        } else {
+            g_string_append(priv->batch, message);
+            g_string_append_c(priv->batch, '\n');
+        }
+        g_free(message);
+        priv->n_reported_dropped = n_dropped;
+    }
+
+    flush_batch(priv);
+
+    return n_entries;
+}
+
+/* Entries are pushed to the head. So the taken list is
+ * reversed to be written in the pushed order. */
+static Entry *
+take_entries (MilterLogWriterPrivate *priv)
+{
+    Entry *entries, *reversed = NULL;
+
+    do {
+        entries = g_atomic_pointer_get(&(priv->head));
+    } while (entries &&
+             !g_atomic_pointer_compare_and_exchange(&(priv->head),
+                                                    entries, NULL));
+
+    while (entries) {
+        Entry *next = entries->next;
+        entries->next = reversed;
+        reversed = entries;
+        entries = next;
+    }
+
+    return reversed;
+}
+
+static gpointer
+write_thread_func (gpointer data)
+{
+    MilterLogWriterPrivate *priv = data;
+
+    g_mutex_lock(&(priv->mutex));
+    while (TRUE) {
+        Entry *entries;
+        guint n_entries;
+
+        while (!g_atomic_pointer_get(&(priv->head)) &&
+               !priv->quit &&
+               !priv->reopen_requested &&
+               priv->pending_fd == NO_PENDING_FD) {
+            g_cond_wait(&(priv->cond), &(priv->mutex));
+        }
+        apply_output_changes(priv);
+
+        entries = take_entries(priv);
+        if (!entries) {
+            if (priv->quit)
+                break;
+            continue;
+        }
+
+        g_mutex_unlock(&(priv->mutex));
+        n_entries = write_entries(priv, entries);
+        free_entries(entries);
+        g_mutex_lock(&(priv->mutex));
+
+        priv->n_written += n_entries;
+        g_cond_broadcast(&(priv->flushed_cond));
+    }
+    g_mutex_unlock(&(priv->mutex));
+
+    return NULL;
+}
+
+/* The writer mutexes are held over fork() so that the child
+ * doesn't inherit a mutex that is locked by the writer
+ * thread, which doesn't exist in the child. */
+static void
+prepare_fork (void)
+{
+    GList *node;
+
+    g_mutex_lock(&writers_mutex);
+    for (node = writers; node; node = g_list_next(node)) {
+        milter_log_writer_flush(node->data);
+    }
+    for (node = writers; node; node = g_list_next(node)) {
+        MilterLogWriterPrivate *priv;
+
+        priv = MILTER_LOG_WRITER_GET_PRIVATE(node->data);
+        g_mutex_lock(&(priv->mutex));
+    }
+}
+
+static void
+finish_fork_in_parent (void)
+{
+    GList *node;
+
+    for (node = writers; node; node = g_list_next(node)) {
+        MilterLogWriterPrivate *priv;
+
+        priv = MILTER_LOG_WRITER_GET_PRIVATE(node->data);
+        g_mutex_unlock(&(priv->mutex));
+    }
+    g_mutex_unlock(&writers_mutex);
+}
+
+static void
+finish_fork_in_child (void)
+{
+    GList *node;
+
+    for (node = writers; node; node = g_list_next(node)) {
+        MilterLogWriterPrivate *priv;
+
+        priv = MILTER_LOG_WRITER_GET_PRIVATE(node->data);
+        /* Lines that are queued after prepare_fork() flushed
+         * the queue are written by the parent. The parent's
+         * GThread can't be freed because the thread doesn't
+         * exist in the child. */
+        free_entries(g_atomic_pointer_get(&(priv->head)));
+        priv->head = NULL;
+        priv->buffered_size = 0;
+        priv->n_pushed = 0;
+        priv->n_written = 0;
+        priv->thread = NULL;
+        g_string_truncate(priv->batch, 0);
+        g_mutex_unlock(&(priv->mutex));
+    }
+    g_mutex_unlock(&writers_mutex);
+}
+
+static gboolean
+ensure_thread (MilterLogWriterPrivate *priv)
+{
+    gboolean available;
+
+    if (priv->thread)
+        return TRUE;
+
+    g_mutex_lock(&(priv->mutex));
+    if (!priv->thread) {
+        priv->quit = FALSE;
+        priv->pid = getpid();
+        priv->thread = g_thread_try_new("milter-log-writer",
+                                        write_thread_func, priv,
+                                        NULL);
+    }
+    available = (priv->thread != NULL);
+    g_mutex_unlock(&(priv->mutex));
+
+    return available;
+}
+
+static gboolean
+push_entry (MilterLogWriterPrivate *priv, Entry *entry)
+{
+    Entry *head;
+    gint buffered_size;
+
+    if (!ensure_thread(priv)) {
+        g_mutex_lock(&(priv->mutex));
+        apply_output_changes(priv);
+        entry->next = NULL;
+        g_atomic_int_add(&(priv->buffered_size), entry->size);
+        write_entries(priv, entry);
+        g_mutex_unlock(&(priv->mutex));
+        g_free(entry->message);
+        g_free(entry);
+        return TRUE;
+    }
+
+    buffered_size = g_atomic_int_add(&(priv->buffered_size), entry->size);
+    if ((gsize)buffered_size + entry->size > priv->max_buffered_size) {
+        g_atomic_int_add(&(priv->buffered_size), -(gint)(entry->size));
+        g_atomic_int_inc(&(priv->n_dropped));
+        g_free(entry->message);
+        g_free(entry);
+        return FALSE;
+    }
+
+    do {
+        head = g_atomic_pointer_get(&(priv->head));
+        entry->next = head;
+    } while (!g_atomic_pointer_compare_and_exchange(&(priv->head),
+                                                    head, entry));
+    g_atomic_int_inc(&(priv->n_pushed));
+
+    /* The writer thread may wait only when the queue was empty. */
+    if (!head) {
+        g_mutex_lock(&(priv->mutex));
+        g_cond_signal(&(priv->cond));
+        g_mutex_unlock(&(priv->mutex));
+    }
+
+    return TRUE;
+}
+
+static Entry *
+entry_new (gint priority, const gchar *data, gsize size)
+{
+    Entry *entry;
+
+    entry = g_malloc0(G_STRUCT_OFFSET(Entry, data) + size + 1);
+    entry->next = NULL;
+    entry->priority = priority;
+    entry->size = size;
+    memcpy(entry->data, data, size);
+    entry->data[size] = '\0';
+
+    return entry;
+}
+
+static const gchar *
+copy_entry_string (gchar **data, const gchar *string)
+{
+    const gchar *copied;
+
+    if (!string)
+        return NULL;
+
+    copied = *data;
+    *data = g_stpcpy(*data, string) + 1;
+    return copied;
+}
+
+static Entry *
+entry_new_record (const gchar *domain,
+                  MilterLogLevelFlags level,
+                  MilterLogItemFlags items,
+                  gboolean colorize,
+                  const gchar *file,
+                  guint line,
+                  const gchar *function,
+                  gint64 timestamp,
+                  const gchar *format,
+                  va_list args)
+{
+    Entry *entry;
+    gsize size = 0;
+    gchar *data;
+
+    if (domain)
+        size += strlen(domain) + 1;
+    if (file)
+        size += strlen(file) + 1;
+    if (function)
+        size += strlen(function) + 1;
+
+    entry = g_malloc0(G_STRUCT_OFFSET(Entry, data) + size + 1);
+    entry->next = NULL;
+    entry->priority = SYSLOG_PRIORITY_NONE;
+    entry->message = g_strdup_vprintf(format, args);
+    entry->size = size + strlen(entry->message);
+    entry->level = level;
+    entry->items = items;
+    entry->colorize = colorize;
+    entry->line = line;
+    entry->timestamp = timestamp;
+    data = entry->data;
+    entry->domain = copy_entry_string(&data, domain);
+    entry->file = copy_entry_string(&data, file);
+    entry->function = copy_entry_string(&data, function);
+
+    return entry;
+}
+
+/**
+ * milter_log_writer_set_path:
+ * @writer: A #MilterLogWriter.
+ * @path: (nullable): An output path.
+ * @error: (nullable): Return location for a #GError or %NULL.
+ *
+ * Sets output path. If @path is %NULL or `"-"`, lines are
+ * written to the standard output. Lines that are already
+ * queued may be written to the new output.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ */
+gboolean
+milter_log_writer_set_path (MilterLogWriter *writer,
+                            const gchar *path,
+                            GError **error)
+{
+    MilterLogWriterPrivate *priv;
+    gint fd = STDOUT_FILENO;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+
+    if (path && strcmp(path, "-") == 0)
+        path = NULL;
+    if (path) {
+        fd = open_path(path, error);
+        if (fd == -1)
+            return FALSE;
+    }
+
+    g_mutex_lock(&(priv->mutex));
+    g_free(priv->path);
+    priv->path = g_strdup(path);
+    if (priv->pending_fd != NO_PENDING_FD)
+        close_fd(priv->pending_fd);
+    priv->pending_fd = fd;
+    g_cond_signal(&(priv->cond));
+    g_mutex_unlock(&(priv->mutex));
+
+    return TRUE;
+}
+
+const gchar *
+milter_log_writer_get_path (MilterLogWriter *writer)
+{
+    return MILTER_LOG_WRITER_GET_PRIVATE(writer)->path;
+}
+
+/**
+ * milter_log_writer_reopen:
+ * @writer: A #MilterLogWriter.
+ *
+ * Requests to reopen the output path for log rotation. The
+ * path is reopened by the writer thread before it writes
+ * the next lines. The current output is kept if the path
+ * can't be opened.
+ */
+void
+milter_log_writer_reopen (MilterLogWriter *writer)
+{
+    MilterLogWriterPrivate *priv;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+
+    g_mutex_lock(&(priv->mutex));
+    priv->reopen_requested = TRUE;
+    g_cond_signal(&(priv->cond));
+    g_mutex_unlock(&(priv->mutex));
+}
+
+/**
+ * milter_log_writer_write:
+ * @writer: A #MilterLogWriter.
+ * @line: A line to be written. It should end with a new line.
+ * @size: The size of @line in bytes, or -1 if @line is
+ *        NUL-terminated.
+ *
+ * Queues @line. This doesn't block on the output.
+ *
+ * Returns: %TRUE if @line is queued, %FALSE if @line is
+ * dropped because the queue is full.
+ */
+gboolean
+milter_log_writer_write (MilterLogWriter *writer,
+                         const gchar *line,
+                         gssize size)
+{
+    if (size < 0)
+        size = strlen(line);
+
+    return push_entry(MILTER_LOG_WRITER_GET_PRIVATE(writer),
+                      entry_new(SYSLOG_PRIORITY_NONE, line, size));
+}
+
+/**
+ * milter_log_writer_write_syslog:
+ * @writer: A #MilterLogWriter.
+ * @priority: A syslog priority such as `LOG_INFO`.
+ * @message: A message to be sent to syslog.
+ *
+ * Queues @message to be sent by syslog(3). openlog(3)
+ * should be called before.
+ *
+ * Returns: %TRUE if @message is queued, %FALSE if @message
+ * is dropped because the queue is full.
+ */
+gboolean
+milter_log_writer_write_syslog (MilterLogWriter *writer,
+                                gint priority,
+                                const gchar *message)
+{
+    return push_entry(MILTER_LOG_WRITER_GET_PRIVATE(writer),
+                      entry_new(priority, message, strlen(message)));
+}
+
+/**
+ * milter_log_writer_write_log_va_list:
+ * @writer: A #MilterLogWriter.
+ * @domain: (nullable): A log domain.
+ * @level: A log level.
+ * @items: The items to be written with the message.
+ * @colorize: Whether the message is colorized for console.
+ * @file: (nullable): A file name where the log is happened.
+ * @line: A line number where the log is happened.
+ * @function: (nullable): A function name where the log is happened.
+ * @timestamp: The time of the log in microseconds since the Epoch.
+ * @format: The format of the message.
+ * @args: The arguments for @format.
+ *
+ * Queues a log record. Only the message is formatted by the
+ * caller. The writer thread decorates it by
+ * milter_log_writer_format_log().
+ *
+ * Returns: %TRUE if the record is queued, %FALSE if it is
+ * dropped because the queue is full.
+ *
+ * Since: 2.2.9
+ */
+gboolean
+milter_log_writer_write_log_va_list (MilterLogWriter *writer,
+                                     const gchar *domain,
+                                     MilterLogLevelFlags level,
+                                     MilterLogItemFlags items,
+                                     gboolean colorize,
+                                     const gchar *file,
+                                     guint line,
+                                     const gchar *function,
+                                     gint64 timestamp,
+                                     const gchar *format,
+                                     va_list args)
+{
+    return push_entry(MILTER_LOG_WRITER_GET_PRIVATE(writer),
+                      entry_new_record(domain, level, items, colorize,
+                                       file, line, function, timestamp,
+                                       format, args));
+}
+
+#define BLACK_COLOR "\033[01;30m"
+#define BLACK_BACK_COLOR "\033[40m"
+#define RED_COLOR "\033[01;31m"
+#define RED_BACK_COLOR "\033[41m"
+#define GREEN_COLOR "\033[01;32m"
+#define GREEN_BACK_COLOR "\033[01;42m"
+#define YELLOW_COLOR "\033[01;33m"
+#define YELLOW_BACK_COLOR "\033[01;43m"
+#define BLUE_COLOR "\033[01;34m"
+#define BLUE_BACK_COLOR "\033[01;44m"
+#define MAGENTA_COLOR "\033[01;35m"
+#define MAGENTA_BACK_COLOR "\033[01;45m"
+#define CYAN_COLOR "\033[01;36m"
+#define CYAN_BACK_COLOR "\033[01;46m"
+#define WHITE_COLOR "\033[01;37m"
+#define WHITE_BACK_COLOR "\033[01;47m"
+#define NORMAL_COLOR "\033[00m"
+
+static void
+append_colorized_message (GString *output,
+                          MilterLogLevelFlags level,
+                          const gchar *message)
+{
+    const gchar *color = NULL;
+
+    switch (level) {
+      case MILTER_LOG_LEVEL_ERROR:
+        color = WHITE_COLOR RED_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_CRITICAL:
+        color = YELLOW_COLOR RED_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_WARNING:
+        color = WHITE_COLOR YELLOW_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_MESSAGE:
+        color = WHITE_COLOR GREEN_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_INFO:
+        color = WHITE_COLOR CYAN_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_DEBUG:
+        color = WHITE_COLOR BLUE_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_TRACE:
+        color = WHITE_COLOR MAGENTA_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_STATISTICS:
+        color = BLUE_COLOR WHITE_BACK_COLOR;
+        break;
+      case MILTER_LOG_LEVEL_PROFILE:
+        color = GREEN_COLOR BLACK_BACK_COLOR;
+        break;
+      default:
+        color = NULL;
+        break;
+    }
+
+    if (color)
+        g_string_append_printf(output, "%s%s%s", color, message, NORMAL_COLOR);
+    else
+        g_string_append(output, message);
+}
+
+/**
+ * milter_log_writer_format_log:
+ * @output: The output string.
+ * @domain: (nullable): A log domain.
+ * @level: A log level.
+ * @items: The items to be written with the message.
+ * @colorize: Whether the message is colorized for console.
+ * @file: (nullable): A file name where the log is happened.
+ * @line: A line number where the log is happened.
+ * @function: (nullable): A function name where the log is happened.
+ * @timestamp: The time of the log in microseconds since the Epoch.
+ * @message: A message.
+ *
+ * Appends a log line that has @message and @items to
+ * @output.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_log_writer_format_log (GString *output,
+                              const gchar *domain,
+                              MilterLogLevelFlags level,
+                              MilterLogItemFlags items,
+                              gboolean colorize,
+                              const gchar *file,
+                              guint line,
+                              const gchar *function,
+                              gint64 timestamp,
+                              const gchar *message)
+{
+    gsize start = output->len;
+
+    if (items & MILTER_LOG_ITEM_LEVEL) {
+        GFlagsClass *flags_class;
+
+        flags_class = g_type_class_ref(MILTER_TYPE_LOG_LEVEL_FLAGS);
+        if (flags_class) {
+            if (level & flags_class->mask) {
+                guint i;
+                for (i = 0; i < flags_class->n_values; i++) {
+                    GFlagsValue *value = flags_class->values + i;
+                    if (level & value->value)
+                        g_string_append_printf(output, "[%s]",
+                                               value->value_nick);
+                }
+            }
+            g_type_class_unref(flags_class);
+        }
+    }
+
+    if (domain && (items & MILTER_LOG_ITEM_DOMAIN))
+        g_string_append_printf(output, "[%s]", domain);
+
+    if (items & MILTER_LOG_ITEM_TIME) {
+        GTimeVal time_value;
+        gchar *time_string;
+
+        time_value.tv_sec = timestamp / G_USEC_PER_SEC;
+        time_value.tv_usec = timestamp % G_USEC_PER_SEC;
+        time_string = g_time_val_to_iso8601(&time_value);
+        g_string_append_printf(output, "[%s]", time_string);
+        g_free(time_string);
+    }
+
+    if (items & MILTER_LOG_ITEM_NAME) {
+        if (output->len > start)
+            g_string_append(output, " ");
+        g_string_append_printf(output, "[%s]", g_get_prgname());
+    }
+
+    if (items & MILTER_LOG_ITEM_PID) {
+        if (output->len > start && !(items & MILTER_LOG_ITEM_NAME))
+            g_string_append(output, " ");
+        g_string_append_printf(output, "[%u]", getpid());
+    }
+
+    if (file && (items & MILTER_LOG_ITEM_LOCATION)) {
+        if (output->len > start)
+            g_string_append(output, " ");
+        g_string_append_printf(output, "%s:%d: ", file, line);
+        if (function)
+            g_string_append_printf(output, "%s(): ", function);
+    } else {
+        if (output->len > start)
+            g_string_append(output, ": ");
+    }
+
+    if (colorize)
+        append_colorized_message(output, level, message);
+    else
+        g_string_append(output, message);
+    g_string_append(output, "\n");
+}
+
+/**
+ * milter_log_writer_flush:
+ * @writer: A #MilterLogWriter.
+ *
+ * Waits until all lines that are queued before this call
+ * are written.
+ */
+void
+milter_log_writer_flush (MilterLogWriter *writer)
+{
+    MilterLogWriterPrivate *priv;
+    guint n_pushed;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+
+    if (!priv->thread || priv->pid != getpid())
+        return;
+
+    n_pushed = g_atomic_int_get(&(priv->n_pushed));
+    g_mutex_lock(&(priv->mutex));
+    g_cond_signal(&(priv->cond));
+    while ((gint)(n_pushed - priv->n_written) > 0)
+        g_cond_wait(&(priv->flushed_cond), &(priv->mutex));
+    g_mutex_unlock(&(priv->mutex));
+}
+
+/**
+ * milter_log_writer_flush_all:
+ *
+ * Waits until all lines queued in all #MilterLogWriter are
+ * written. This should be called before _exit() because
+ * queued lines are lost otherwise.
+ */
+void
+milter_log_writer_flush_all (void)
+{
+    GList *node;
+
+    g_mutex_lock(&writers_mutex);
+    for (node = writers; node; node = g_list_next(node)) {
+        milter_log_writer_flush(node->data);
+    }
+    g_mutex_unlock(&writers_mutex);
+}
+
+gsize
+milter_log_writer_get_max_buffered_size (MilterLogWriter *writer)
+{
+    return MILTER_LOG_WRITER_GET_PRIVATE(writer)->max_buffered_size;
+}
+
+void
+milter_log_writer_set_max_buffered_size (MilterLogWriter *writer, gsize size)
+{
+    MilterLogWriterPrivate *priv;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+    priv->max_buffered_size = MIN(size, G_MAXINT);
+}
+
+guint
+milter_log_writer_get_n_dropped (MilterLogWriter *writer)
+{
+    MilterLogWriterPrivate *priv;
+
+    priv = MILTER_LOG_WRITER_GET_PRIVATE(writer);
+    return g_atomic_int_get(&(priv->n_dropped));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,105 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_LOG_WRITER_H__
+#define __MILTER_LOG_WRITER_H__
+
+#include <glib-object.h>
+
+#include <milter/core/milter-logger.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_LOG_WRITER_DEFAULT_MAX_BUFFERED_SIZE (8 * 1024 * 1024)
+
+#define MILTER_TYPE_LOG_WRITER            (milter_log_writer_get_type())
+#define MILTER_LOG_WRITER(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_LOG_WRITER, MilterLogWriter))
+#define MILTER_LOG_WRITER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_LOG_WRITER, MilterLogWriterClass))
+#define MILTER_IS_LOG_WRITER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_LOG_WRITER))
+#define MILTER_IS_LOG_WRITER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_LOG_WRITER))
+#define MILTER_LOG_WRITER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_LOG_WRITER, MilterLogWriterClass))
+
+typedef struct _MilterLogWriter         MilterLogWriter;
+typedef struct _MilterLogWriterClass    MilterLogWriterClass;
+
+struct _MilterLogWriter
+{
+    GObject object;
+};
+
+struct _MilterLogWriterClass
+{
+    GObjectClass parent_class;
+};
+
+GType            milter_log_writer_get_type       (void) G_GNUC_CONST;
+
+MilterLogWriter *milter_log_writer_new            (void);
+
+gboolean         milter_log_writer_set_path       (MilterLogWriter *writer,
+                                                   const gchar     *path,
+                                                   GError         **error);
+const gchar     *milter_log_writer_get_path       (MilterLogWriter *writer);
+void             milter_log_writer_reopen         (MilterLogWriter *writer);
+
+gboolean         milter_log_writer_write          (MilterLogWriter *writer,
+                                                   const gchar     *line,
+                                                   gssize           size);
+gboolean         milter_log_writer_write_syslog   (MilterLogWriter *writer,
+                                                   gint             priority,
+                                                   const gchar     *message);
+gboolean         milter_log_writer_write_log_va_list
+                                                  (MilterLogWriter *writer,
+                                                   const gchar     *domain,
+                                                   MilterLogLevelFlags level,
+                                                   MilterLogItemFlags items,
+                                                   gboolean         colorize,
+                                                   const gchar     *file,
+                                                   guint            line,
+                                                   const gchar     *function,
+                                                   gint64           timestamp,
+                                                   const gchar     *format,
+                                                   va_list          args);
+void             milter_log_writer_format_log     (GString         *output,
+                                                   const gchar     *domain,
+                                                   MilterLogLevelFlags level,
+                                                   MilterLogItemFlags items,
+                                                   gboolean         colorize,
+                                                   const gchar     *file,
+                                                   guint            line,
+                                                   const gchar     *function,
+                                                   gint64           timestamp,
+                                                   const gchar     *message);
+void             milter_log_writer_flush          (MilterLogWriter *writer);
+void             milter_log_writer_flush_all      (void);
+
+gsize            milter_log_writer_get_max_buffered_size
+                                                  (MilterLogWriter *writer);
+void             milter_log_writer_set_max_buffered_size
+                                                  (MilterLogWriter *writer,
+                                                   gsize            size);
+guint            milter_log_writer_get_n_dropped  (MilterLogWriter *writer);
+
+G_END_DECLS
+
+#endif /* __MILTER_LOG_WRITER_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
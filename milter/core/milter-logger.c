@@ -30,6 +30,7 @@
 #include <glib.h>
 
 #include "milter-logger.h"
+#include "milter-log-writer.h"
 #include "milter-core-internal.h"
 #include "milter-utils.h"
 #include "milter-enum-types.h"
@@ -74,7 +75,8 @@ struct _MilterLoggerPrivate
     GHashTable *interesting_levels;
     MilterLogLevelFlags interesting_level;
     gchar *path;
-    FILE *output;
+    MilterLogWriter *writer;
+    gboolean default_handler_connected;
 };
 
 enum
@@ -95,6 +97,7 @@ enum
 static gint signals[LAST_SIGNAL] = {0};
 
 static MilterLogger *singleton_milter_logger = NULL;
+MilterLogLevelFlags milter_log_interesting_level = 0;
 
 G_DEFINE_TYPE(MilterLogger, milter_logger, G_TYPE_OBJECT);
 
@@ -114,6 +117,8 @@ milter_logger_internal_init (void)
     GError *error = NULL;
 
     singleton_milter_logger = milter_logger_new();
+    milter_log_interesting_level =
+        milter_logger_get_interesting_level(singleton_milter_logger);
     milter_logger_connect_default_handler(singleton_milter_logger);
     if (!milter_logger_set_path(singleton_milter_logger,
                                 g_getenv("MILTER_LOG_PATH"),
@@ -144,6 +149,7 @@ milter_logger_internal_init (void)
 void
 milter_logger_internal_quit (void)
 {
+    milter_log_interesting_level = 0;
     g_object_unref(singleton_milter_logger);
     singleton_milter_logger = NULL;
 }
@@ -219,7 +225,8 @@ milter_logger_init (MilterLogger *logger)
                         g_strdup(DEFAULT_KEY),
                         GUINT_TO_POINTER(priv->interesting_level));
     priv->path = NULL;
-    priv->output = NULL;
+    priv->writer = NULL;
+    priv->default_handler_connected = FALSE;
 }
 
 static void
@@ -228,8 +235,11 @@ dispose_path (MilterLoggerPrivate *priv)
     if (priv->path) {
         g_free(priv->path);
         priv->path = NULL;
-        fclose(priv->output);
-        priv->output = NULL;
+    }
+
+    if (priv->writer) {
+        g_object_unref(priv->writer);
+        priv->writer = NULL;
     }
 }
 
@@ -338,73 +348,8 @@ milter_log_item_flags_from_string (const gchar *item_name,
                                           error);
 }
 
-#define BLACK_COLOR "\033[01;30m"
-#define BLACK_BACK_COLOR "\033[40m"
-#define RED_COLOR "\033[01;31m"
-#define RED_BACK_COLOR "\033[41m"
-#define GREEN_COLOR "\033[01;32m"
-#define GREEN_BACK_COLOR "\033[01;42m"
-#define YELLOW_COLOR "\033[01;33m"
-#define YELLOW_BACK_COLOR "\033[01;43m"
-#define BLUE_COLOR "\033[01;34m"
-#define BLUE_BACK_COLOR "\033[01;44m"
-#define MAGENTA_COLOR "\033[01;35m"
-#define MAGENTA_BACK_COLOR "\033[01;45m"
-#define CYAN_COLOR "\033[01;36m"
-#define CYAN_BACK_COLOR "\033[01;46m"
-#define WHITE_COLOR "\033[01;37m"
-#define WHITE_BACK_COLOR "\033[01;47m"
-#define NORMAL_COLOR "\033[00m"
-
-static void
-log_message_colorize_console (GString *log,
-                              MilterLogLevelFlags level,
-                              const gchar *message)
-{
-    const gchar *color = NULL;
-
-    switch (level) {
-      case MILTER_LOG_LEVEL_ERROR:
-        color = WHITE_COLOR RED_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_CRITICAL:
-        color = YELLOW_COLOR RED_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_WARNING:
-        color = WHITE_COLOR YELLOW_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_MESSAGE:
-        color = WHITE_COLOR GREEN_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_INFO:
-        color = WHITE_COLOR CYAN_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_DEBUG:
-        color = WHITE_COLOR BLUE_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_TRACE:
-        color = WHITE_COLOR MAGENTA_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_STATISTICS:
-        color = BLUE_COLOR WHITE_BACK_COLOR;
-        break;
-      case MILTER_LOG_LEVEL_PROFILE:
-        color = GREEN_COLOR BLACK_BACK_COLOR;
-        break;
-      default:
-        color = NULL;
-        break;
-    }
-
-    if (color)
-        g_string_append_printf(log, "%s%s%s", color, message, NORMAL_COLOR);
-    else
-        g_string_append(log, message);
-}
-
-static void
-log_message (MilterLoggerPrivate *priv, GString *log,
-             MilterLogLevelFlags level, const gchar *message)
+static gboolean
+resolve_colorize (MilterLoggerPrivate *priv)
 {
     const gchar *colorize_type;
     MilterLogColorize colorize = MILTER_LOG_COLORIZE_DEFAULT;
@@ -416,14 +361,8 @@ log_message (MilterLoggerPrivate *priv, GString *log,
                                                  NULL);
 
     if (colorize == MILTER_LOG_COLORIZE_DEFAULT) {
-        int output_fileno;
-
-        if (priv->output) {
-            output_fileno = fileno(priv->output);
-        } else {
-            output_fileno = STDOUT_FILENO;
-        }
-        if (isatty(output_fileno) &&
+        if (!priv->writer &&
+            isatty(STDOUT_FILENO) &&
             milter_utils_guess_console_color_usability()) {
             colorize = MILTER_LOG_COLORIZE_CONSOLE;
         } else {
@@ -431,14 +370,18 @@ log_message (MilterLoggerPrivate *priv, GString *log,
         }
     }
 
-    switch (colorize) {
-      case MILTER_LOG_COLORIZE_CONSOLE:
-        log_message_colorize_console(log, level, message);
-        break;
-      default:
-        g_string_append(log, message);
-        break;
-    }
+    return colorize == MILTER_LOG_COLORIZE_CONSOLE;
+}
+
+static MilterLogItemFlags
+resolve_target_item (MilterLoggerPrivate *priv)
+{
+    MilterLogItemFlags target_item;
+
+    target_item = priv->target_item;
+    if (target_item == MILTER_LOG_ITEM_DEFAULT)
+        target_item = DEFAULT_ITEM;
+    return target_item;
 }
 
 static inline void
@@ -465,18 +408,42 @@ check_milter_debug (MilterLogLevelFlags level)
     }
 }
 
-void
-milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
-                                   MilterLogLevelFlags level,
-                                   const gchar *file, guint line,
-                                   const gchar *function,
-                                   GTimeVal *time_value, const gchar *message,
-                                   gpointer user_data)
+static gboolean
+write_log_to_writer (MilterLogWriter *writer,
+                     const gchar *domain,
+                     MilterLogLevelFlags level,
+                     MilterLogItemFlags items,
+                     gboolean colorize,
+                     const gchar *file,
+                     guint line,
+                     const gchar *function,
+                     gint64 timestamp,
+                     const gchar *format,
+                     ...)
+{
+    gboolean written;
+    va_list args;
+
+    va_start(args, format);
+    written = milter_log_writer_write_log_va_list(writer, domain, level,
+                                                  items, colorize,
+                                                  file, line, function,
+                                                  timestamp, format, args);
+    va_end(args);
+
+    return written;
+}
+
+static void
+log_default (MilterLogger *logger, const gchar *domain,
+             MilterLogLevelFlags level,
+             const gchar *file, guint line, const gchar *function,
+             gint64 timestamp, const gchar *message)
 {
     MilterLoggerPrivate *priv;
     MilterLogLevelFlags target_level;
     MilterLogItemFlags target_item;
-    GString *log;
+    gboolean colorize;
 
     priv = MILTER_LOGGER_GET_PRIVATE(logger);
     target_level = milter_logger_get_resolved_target_level(logger);
@@ -485,72 +452,40 @@ milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
 
     check_milter_debug(level);
 
-    log = g_string_new(NULL);
-
-    target_item = priv->target_item;
-    if (target_item == MILTER_LOG_ITEM_DEFAULT)
-        target_item = DEFAULT_ITEM;
-
-    if (target_item & MILTER_LOG_ITEM_LEVEL) {
-        GFlagsClass *flags_class;
-
-        flags_class = g_type_class_ref(MILTER_TYPE_LOG_LEVEL_FLAGS);
-        if (flags_class) {
-            if (level & flags_class->mask) {
-                guint i;
-                for (i = 0; i < flags_class->n_values; i++) {
-                    GFlagsValue *value = flags_class->values + i;
-                    if (level & value->value)
-                        g_string_append_printf(log, "[%s]", value->value_nick);
-                }
-            }
-            g_type_class_unref(flags_class);
-        }
-    }
-
-    if (domain && (target_item & MILTER_LOG_ITEM_DOMAIN))
-        g_string_append_printf(log, "[%s]", domain);
-
-    if (target_item & MILTER_LOG_ITEM_TIME) {
-        gchar *time_string;
-
-        time_string = g_time_val_to_iso8601(time_value);
-        g_string_append_printf(log, "[%s]", time_string);
-        g_free(time_string);
-    }
-
-    if (target_item & MILTER_LOG_ITEM_NAME) {
-        if (log->len > 0)
-            g_string_append(log, " ");
-        g_string_append_printf(log, "[%s]", g_get_prgname());
-    }
-
-    if (target_item & MILTER_LOG_ITEM_PID) {
-        if (log->len > 0 && !(target_item & MILTER_LOG_ITEM_NAME))
-            g_string_append(log, " ");
-        g_string_append_printf(log, "[%u]", getpid());
-    }
-
-    if (file && (target_item & MILTER_LOG_ITEM_LOCATION)) {
-        if (log->len > 0)
-            g_string_append(log, " ");
-        g_string_append_printf(log, "%s:%d: ", file, line);
-        if (function)
-            g_string_append_printf(log, "%s(): ", function);
+    target_item = resolve_target_item(priv);
+    colorize = resolve_colorize(priv);
+    if (priv->writer) {
+        write_log_to_writer(priv->writer, domain, level, target_item, colorize,
+                            file, line, function, timestamp,
+                            "%s", message);
+        if (level & MILTER_LOG_LEVEL_CRITICAL)
+            milter_log_writer_flush(priv->writer);
     } else {
-        if (log->len > 0)
-            g_string_append(log, ": ");
-    }
+        GString *log;
 
-    log_message(priv, log, level, message);
-    g_string_append(log, "\n");
-    if (priv->output) {
-        fputs(log->str, priv->output);
-        fflush(priv->output);
-    } else {
+        log = g_string_new(NULL);
+        milter_log_writer_format_log(log, domain, level, target_item, colorize,
+                                     file, line, function, timestamp,
+                                     message);
         g_print("%s", log->str);
+        g_string_free(log, TRUE);
     }
-    g_string_free(log, TRUE);
+}
+
+void
+milter_logger_default_log_handler (MilterLogger *logger, const gchar *domain,
+                                   MilterLogLevelFlags level,
+                                   const gchar *file, guint line,
+                                   const gchar *function,
+                                   GTimeVal *time_value, const gchar *message,
+                                   gpointer user_data)
+{
+    gint64 timestamp;
+
+    timestamp =
+        (gint64)time_value->tv_sec * G_USEC_PER_SEC + time_value->tv_usec;
+    log_default(logger, domain, level, file, line, function,
+                timestamp, message);
 }
 
 /**
@@ -606,14 +541,52 @@ milter_logger_log_va_list (MilterLogger *logger,
                            const gchar *file, guint line, const gchar *function,
                            const gchar *format, va_list args)
 {
-    GTimeVal time_value;
+    MilterLoggerPrivate *priv;
+    gboolean need_signal;
+    gint64 timestamp;
     gchar *message;
 
-    g_get_current_time(&time_value);
+    priv = MILTER_LOGGER_GET_PRIVATE(logger);
+    need_signal =
+        MILTER_LOGGER_GET_CLASS(logger)->log ||
+        g_signal_has_handler_pending(logger, signals[LOG], 0, FALSE);
+    if (!priv->default_handler_connected && !need_signal)
+        return;
+
+    timestamp = g_get_real_time();
+
+    /* The common case: only the default handler writes to a
+     * log file. The message arguments are formatted here but
+     * the rest of the line is built by the log writer
+     * thread. */
+    if (priv->default_handler_connected && priv->writer && !need_signal) {
+        if (!(level & milter_logger_get_resolved_target_level(logger)))
+            return;
+
+        check_milter_debug(level);
+        milter_log_writer_write_log_va_list(priv->writer, domain, level,
+                                            resolve_target_item(priv),
+                                            resolve_colorize(priv),
+                                            file, line, function,
+                                            timestamp, format, args);
+        if (level & MILTER_LOG_LEVEL_CRITICAL)
+            milter_log_writer_flush(priv->writer);
+        return;
+    }
 
     message = g_strdup_vprintf(format, args);
-    g_signal_emit(logger, signals[LOG], 0,
-                  domain, level, file, line, function, &time_value, message);
+    if (priv->default_handler_connected)
+        log_default(logger, domain, level, file, line, function,
+                    timestamp, message);
+    if (need_signal) {
+        GTimeVal time_value;
+
+        time_value.tv_sec = timestamp / G_USEC_PER_SEC;
+        time_value.tv_usec = timestamp % G_USEC_PER_SEC;
+        g_signal_emit(logger, signals[LOG], 0,
+                      domain, level, file, line, function,
+                      &time_value, message);
+    }
     g_free(message);
 }
 
@@ -660,16 +633,10 @@ milter_logger_reopen (MilterLogger *logger)
     if (!priv->path)
         return;
 
-    milter_info("[logger][reopen][close]");
-    fclose(priv->output);
-    priv->output = fopen(priv->path, "a");
-    if (!priv->output) {
-        milter_warning("[logger][reopen][open][warning] <%s>: %s",
-                       priv->path, g_strerror(errno));
-        g_free(priv->path);
-        priv->path = NULL;
-    }
-    milter_info("[logger][reopen][open]");
+    /* The log writer thread reopens the path before it writes
+     * the next messages. */
+    milter_info("[logger][reopen]");
+    milter_log_writer_reopen(priv->writer);
 }
 
 MilterLogLevelFlags
@@ -750,6 +717,8 @@ milter_logger_set_interesting_level (MilterLogger *logger,
     g_hash_table_foreach(priv->interesting_levels,
                          update_interesting_level,
                          &(priv->interesting_level));
+    if (logger == singleton_milter_logger)
+        milter_log_interesting_level = priv->interesting_level;
 }
 
 MilterLogLevelFlags
@@ -809,7 +778,8 @@ milter_logger_get_path (MilterLogger *logger)
  * @error: (nullable): Return location for a #GError or %NULL.
  *
  * Sets output path. If @path is %NULL or `"-"`, log messages are
- * outputted to the standard output.
+ * outputted to the standard output. Log messages for a path are
+ * written asynchronously by a #MilterLogWriter.
  *
  * Returns: %TRUE on success, %FALSE otherwise.
  */
@@ -827,30 +797,36 @@ milter_logger_set_path (MilterLogger *logger, const gchar *path, GError **error)
     if (!path)
         return TRUE;
 
-    priv->output = fopen(path, "a");
-    if (priv->output) {
-        priv->path = g_strdup(path);
-        return TRUE;
-    } else {
-        g_set_error(error,
-                    G_FILE_ERROR,
-                    g_file_error_from_errno(errno),
-                    "failed to set log output path: <%s>: %s",
-                    path, g_strerror(errno));
+    priv->writer = milter_log_writer_new();
+    if (!milter_log_writer_set_path(priv->writer, path, error)) {
+        g_object_unref(priv->writer);
+        priv->writer = NULL;
         return FALSE;
     }
+    priv->path = g_strdup(path);
+
+    return TRUE;
 }
 
+/**
+ * milter_logger_connect_default_handler:
+ * @logger: A #MilterLogger.
+ *
+ * Enables the default handler that writes log messages to
+ * the standard output or the path. It's called without the
+ * "log" signal, so the writer thread can build log lines
+ * when nobody else handles the signal.
+ */
 void
 milter_logger_connect_default_handler (MilterLogger *logger)
 {
-    g_signal_connect(logger, "log",
-                     G_CALLBACK(milter_logger_default_log_handler), NULL);
+    MILTER_LOGGER_GET_PRIVATE(logger)->default_handler_connected = TRUE;
 }
 
 void
 milter_logger_disconnect_default_handler (MilterLogger *logger)
 {
+    MILTER_LOGGER_GET_PRIVATE(logger)->default_handler_connected = FALSE;
     g_signal_handlers_disconnect_by_func(
         logger, G_CALLBACK(milter_logger_default_log_handler), NULL);
 }
@@ -52,8 +52,23 @@ G_BEGIN_DECLS
     milter_log(MILTER_LOG_LEVEL_INFO, format, ## __VA_ARGS__)
 #define milter_debug(format, ...)                               \
     milter_log(MILTER_LOG_LEVEL_DEBUG, format, ## __VA_ARGS__)
-#define milter_trace(format, ...)                               \
+#ifdef MILTER_DISABLE_TRACE_LOG
+#  define milter_trace(format, ...)                             \
+    do {                                                        \
+        if (0) {                                                \
+            (milter_logger_log(milter_logger(),                 \
+                               MILTER_LOG_DOMAIN,               \
+                               MILTER_LOG_LEVEL_TRACE,          \
+                               __FILE__,                        \
+                               __LINE__,                        \
+                               G_STRFUNC,                       \
+                               format, ## __VA_ARGS__));        \
+        }                                                       \
+    } while (0)
+#else
+#  define milter_trace(format, ...)                             \
     milter_log(MILTER_LOG_LEVEL_TRACE, format, ## __VA_ARGS__)
+#endif
 #define milter_statistics(format, ...)                                  \
     milter_log(MILTER_LOG_LEVEL_STATISTICS, format, ## __VA_ARGS__)
 #define milter_profile(format, ...)                                  \
@@ -67,7 +82,7 @@ G_BEGIN_DECLS
     milter_logger_get_interesting_level(milter_logger())
 
 #define milter_need_log(level) \
-    (milter_get_interesting_log_level() & (level))
+    (G_UNLIKELY(milter_log_interesting_level & (level)))
 #define milter_need_critical_log() \
     (milter_need_log(MILTER_LOG_LEVEL_CRITICAL))
 #define milter_need_error_log() \
@@ -80,8 +95,12 @@ G_BEGIN_DECLS
     (milter_need_log(MILTER_LOG_LEVEL_INFO))
 #define milter_need_debug_log() \
     (milter_need_log(MILTER_LOG_LEVEL_DEBUG))
-#define milter_need_trace_log() \
+#ifdef MILTER_DISABLE_TRACE_LOG
+#  define milter_need_trace_log() (FALSE)
+#else
+#  define milter_need_trace_log() \
     (milter_need_log(MILTER_LOG_LEVEL_TRACE))
+#endif
 #define milter_need_statistics_log() \
     (milter_need_log(MILTER_LOG_LEVEL_STATISTICS))
 #define milter_need_profile_log() \
@@ -112,6 +131,11 @@ typedef enum
                               MILTER_LOG_LEVEL_STATISTICS |     \
                               MILTER_LOG_LEVEL_PROFILE)
 
+/* The interesting log level of milter_logger(). This is
+ * referred by milter_need_log() to check whether a log is
+ * needed without any function call. */
+extern MilterLogLevelFlags milter_log_interesting_level;
+
 #define MILTER_LOG_NULL_SAFE_STRING(string) ((string) ? (string) : "(null)")
 
 typedef enum
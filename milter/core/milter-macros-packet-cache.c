@@ -0,0 +1,300 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include "milter-macros-packet-cache.h"
+
+/**
+ * SECTION: milter-macros-packet-cache
+ * @title: MilterMacrosPacketCache
+ * @short_description: Cache of encoded DEFINE_MACRO packets.
+ *
+ * The %MilterMacrosPacketCache keeps DEFINE_MACRO packets
+ * that are already encoded for a command. A packet is
+ * identified by the command, the macros table that the
+ * packet is encoded from and the requested symbols. The
+ * macros table must not be changed while it is cached. So
+ * the cache should be used with macros tables that are
+ * shared by milter_protocol_agent_share_macros_hash_table().
+ *
+ * Packets for a command are dropped when they are stored
+ * with another macros table or
+ * milter_macros_packet_cache_invalidate() is called.
+ */
+
+#define MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(obj)                     \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
+                                 MILTER_TYPE_MACROS_PACKET_CACHE,       \
+                                 MilterMacrosPacketCachePrivate))
+
+typedef struct _MilterMacrosPacketCachePrivate	MilterMacrosPacketCachePrivate;
+struct _MilterMacrosPacketCachePrivate
+{
+    GHashTable *command_packets;
+    GString *key;
+};
+
+typedef struct _CommandPackets CommandPackets;
+struct _CommandPackets
+{
+    GHashTable *macros;
+    GHashTable *packets;
+};
+
+G_DEFINE_TYPE(MilterMacrosPacketCache, milter_macros_packet_cache, G_TYPE_OBJECT);
+
+static void dispose        (GObject         *object);
+
+static void
+milter_macros_packet_cache_class_init (MilterMacrosPacketCacheClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterMacrosPacketCachePrivate));
+}
+
+static void
+packet_free (gpointer data)
+{
+    GString *packet = data;
+
+    g_string_free(packet, TRUE);
+}
+
+static CommandPackets *
+command_packets_new (GHashTable *macros)
+{
+    CommandPackets *command_packets;
+
+    command_packets = g_slice_new(CommandPackets);
+    command_packets->macros = g_hash_table_ref(macros);
+    command_packets->packets = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                     g_free, packet_free);
+
+    return command_packets;
+}
+
+static void
+command_packets_free (gpointer data)
+{
+    CommandPackets *command_packets = data;
+
+    g_hash_table_unref(command_packets->macros);
+    g_hash_table_unref(command_packets->packets);
+    g_slice_free(CommandPackets, command_packets);
+}
+
+static void
+milter_macros_packet_cache_init (MilterMacrosPacketCache *cache)
+{
+    MilterMacrosPacketCachePrivate *priv;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+
+    priv->command_packets = g_hash_table_new_full(g_direct_hash,
+                                                  g_direct_equal,
+                                                  NULL,
+                                                  command_packets_free);
+    priv->key = g_string_new(NULL);
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterMacrosPacketCachePrivate *priv;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(object);
+
+    if (priv->command_packets) {
+        g_hash_table_unref(priv->command_packets);
+        priv->command_packets = NULL;
+    }
+
+    if (priv->key) {
+        g_string_free(priv->key, TRUE);
+        priv->key = NULL;
+    }
+
+    G_OBJECT_CLASS(milter_macros_packet_cache_parent_class)->dispose(object);
+}
+
+MilterMacrosPacketCache *
+milter_macros_packet_cache_new (void)
+{
+    return g_object_new(MILTER_TYPE_MACROS_PACKET_CACHE, NULL);
+}
+
+/* NULL symbols means "all macros" and it is the empty key. A
+ * symbol can't include a new line. */
+static const gchar *
+build_key (MilterMacrosPacketCachePrivate *priv, GList *symbols)
+{
+    GList *node;
+
+    g_string_truncate(priv->key, 0);
+    for (node = symbols; node; node = g_list_next(node)) {
+        const gchar *symbol = node->data;
+
+        g_string_append(priv->key, symbol);
+        g_string_append_c(priv->key, '\n');
+    }
+
+    return priv->key->str;
+}
+
+/**
+ * milter_macros_packet_cache_lookup:
+ * @cache: A #MilterMacrosPacketCache.
+ * @command: The command that the macros are defined for.
+ * @macros: (element-type utf8 utf8): The macros table.
+ * @symbols: (element-type utf8) (nullable): The requested symbols.
+ * @packet: (out) (transfer none): The cached packet.
+ * @packet_size: (out): The size of @packet.
+ *
+ * Looks up the packet encoded from @macros filtered by
+ * @symbols. @packet is %NULL and @packet_size is 0 when
+ * the cached result is "nothing to send".
+ *
+ * Returns: %TRUE if the packet is cached, %FALSE otherwise.
+ */
+gboolean
+milter_macros_packet_cache_lookup (MilterMacrosPacketCache *cache,
+                                   MilterCommand command,
+                                   GHashTable *macros,
+                                   GList *symbols,
+                                   const gchar **packet,
+                                   gsize *packet_size)
+{
+    MilterMacrosPacketCachePrivate *priv;
+    CommandPackets *command_packets;
+    GString *cached_packet;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+    command_packets = g_hash_table_lookup(priv->command_packets,
+                                          GINT_TO_POINTER(command));
+    if (!command_packets || command_packets->macros != macros)
+        return FALSE;
+
+    cached_packet = g_hash_table_lookup(command_packets->packets,
+                                        build_key(priv, symbols));
+    if (!cached_packet)
+        return FALSE;
+
+    if (cached_packet->len == 0) {
+        *packet = NULL;
+        *packet_size = 0;
+    } else {
+        *packet = cached_packet->str;
+        *packet_size = cached_packet->len;
+    }
+
+    return TRUE;
+}
+
+/**
+ * milter_macros_packet_cache_store:
+ * @cache: A #MilterMacrosPacketCache.
+ * @command: The command that the macros are defined for.
+ * @macros: (element-type utf8 utf8): The macros table.
+ * @symbols: (element-type utf8) (nullable): The requested symbols.
+ * @packet: (nullable): The encoded packet.
+ * @packet_size: The size of @packet.
+ *
+ * Stores the packet encoded from @macros filtered by
+ * @symbols. %NULL @packet means "nothing to send". Packets
+ * for @command that are encoded from another macros table
+ * are dropped. @macros is referenced until it is dropped.
+ */
+void
+milter_macros_packet_cache_store (MilterMacrosPacketCache *cache,
+                                  MilterCommand command,
+                                  GHashTable *macros,
+                                  GList *symbols,
+                                  const gchar *packet,
+                                  gsize packet_size)
+{
+    MilterMacrosPacketCachePrivate *priv;
+    CommandPackets *command_packets;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+    command_packets = g_hash_table_lookup(priv->command_packets,
+                                          GINT_TO_POINTER(command));
+    if (!command_packets || command_packets->macros != macros) {
+        command_packets = command_packets_new(macros);
+        g_hash_table_replace(priv->command_packets,
+                             GINT_TO_POINTER(command),
+                             command_packets);
+    }
+
+    g_hash_table_replace(command_packets->packets,
+                         g_strdup(build_key(priv, symbols)),
+                         g_string_new_len(packet, packet ? packet_size : 0));
+}
+
+void
+milter_macros_packet_cache_invalidate (MilterMacrosPacketCache *cache,
+                                       MilterCommand command)
+{
+    MilterMacrosPacketCachePrivate *priv;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+    g_hash_table_remove(priv->command_packets, GINT_TO_POINTER(command));
+}
+
+void
+milter_macros_packet_cache_clear (MilterMacrosPacketCache *cache)
+{
+    MilterMacrosPacketCachePrivate *priv;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+    g_hash_table_remove_all(priv->command_packets);
+}
+
+static void
+count_packets (gpointer key, gpointer value, gpointer user_data)
+{
+    CommandPackets *command_packets = value;
+    guint *size = user_data;
+
+    *size += g_hash_table_size(command_packets->packets);
+}
+
+guint
+milter_macros_packet_cache_get_size (MilterMacrosPacketCache *cache)
+{
+    MilterMacrosPacketCachePrivate *priv;
+    guint size = 0;
+
+    priv = MILTER_MACROS_PACKET_CACHE_GET_PRIVATE(cache);
+    g_hash_table_foreach(priv->command_packets, count_packets, &size);
+
+    return size;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,80 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MACROS_PACKET_CACHE_H__
+#define __MILTER_MACROS_PACKET_CACHE_H__
+
+#include <glib-object.h>
+#include <milter/core/milter-protocol.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_TYPE_MACROS_PACKET_CACHE            (milter_macros_packet_cache_get_type())
+#define MILTER_MACROS_PACKET_CACHE(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MACROS_PACKET_CACHE, MilterMacrosPacketCache))
+#define MILTER_MACROS_PACKET_CACHE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MACROS_PACKET_CACHE, MilterMacrosPacketCacheClass))
+#define MILTER_IS_MACROS_PACKET_CACHE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MACROS_PACKET_CACHE))
+#define MILTER_IS_MACROS_PACKET_CACHE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MACROS_PACKET_CACHE))
+#define MILTER_MACROS_PACKET_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MACROS_PACKET_CACHE, MilterMacrosPacketCacheClass))
+
+typedef struct _MilterMacrosPacketCache         MilterMacrosPacketCache;
+typedef struct _MilterMacrosPacketCacheClass    MilterMacrosPacketCacheClass;
+
+struct _MilterMacrosPacketCache
+{
+    GObject object;
+};
+
+struct _MilterMacrosPacketCacheClass
+{
+    GObjectClass parent_class;
+};
+
+GType                    milter_macros_packet_cache_get_type (void) G_GNUC_CONST;
+
+MilterMacrosPacketCache *milter_macros_packet_cache_new      (void);
+
+gboolean                 milter_macros_packet_cache_lookup
+                                        (MilterMacrosPacketCache *cache,
+                                         MilterCommand            command,
+                                         GHashTable              *macros,
+                                         GList                   *symbols,
+                                         const gchar            **packet,
+                                         gsize                   *packet_size);
+void                     milter_macros_packet_cache_store
+                                        (MilterMacrosPacketCache *cache,
+                                         MilterCommand            command,
+                                         GHashTable              *macros,
+                                         GList                   *symbols,
+                                         const gchar             *packet,
+                                         gsize                    packet_size);
+void                     milter_macros_packet_cache_invalidate
+                                        (MilterMacrosPacketCache *cache,
+                                         MilterCommand            command);
+void                     milter_macros_packet_cache_clear
+                                        (MilterMacrosPacketCache *cache);
+guint                    milter_macros_packet_cache_get_size
+                                        (MilterMacrosPacketCache *cache);
+
+G_END_DECLS
+
+#endif /* __MILTER_MACROS_PACKET_CACHE_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
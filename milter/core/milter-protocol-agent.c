@@ -38,6 +38,7 @@ typedef struct _MilterProtocolAgentPrivate	MilterProtocolAgentPrivate;
 struct _MilterProtocolAgentPrivate
 {
     GHashTable *macros;
+    GHashTable *shared_macros;
     GHashTable *available_macros;
     MilterCommand macro_context;
     MilterMacrosRequests *macros_requests;
@@ -108,6 +109,7 @@ milter_protocol_agent_init (MilterProtocolAgent *agent)
     priv->macros = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                          NULL,
                                          (GDestroyNotify)g_hash_table_unref);
+    priv->shared_macros = g_hash_table_new(g_direct_hash, g_direct_equal);
     priv->available_macros = NULL;
     priv->macro_context = MILTER_COMMAND_UNKNOWN;
     priv->macros_requests = NULL;
@@ -134,6 +136,11 @@ dispose (GObject *object)
         priv->macros = NULL;
     }
 
+    if (priv->shared_macros) {
+        g_hash_table_unref(priv->shared_macros);
+        priv->shared_macros = NULL;
+    }
+
     clear_available_macros(priv);
 
     if (priv->macros_requests) {
@@ -266,6 +273,7 @@ milter_protocol_agent_clear_macros (MilterProtocolAgent *agent,
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
     g_hash_table_remove(priv->macros, GINT_TO_POINTER(macro_context));
+    g_hash_table_remove(priv->shared_macros, GINT_TO_POINTER(macro_context));
     clear_available_macros(priv);
 }
 
@@ -275,9 +283,12 @@ milter_protocol_agent_clear_message_related_macros (MilterProtocolAgent *agent)
     MilterProtocolAgentPrivate *priv;
 
     priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
-#define CLEAR_MACRO(command)                                            \
-    g_hash_table_remove(priv->macros,                                   \
-                        GINT_TO_POINTER(MILTER_COMMAND_ ## command))
+#define CLEAR_MACRO(command) do {                                       \
+        g_hash_table_remove(priv->macros,                               \
+                            GINT_TO_POINTER(MILTER_COMMAND_ ## command)); \
+        g_hash_table_remove(priv->shared_macros,                        \
+                            GINT_TO_POINTER(MILTER_COMMAND_ ## command)); \
+    } while (0)
 
     CLEAR_MACRO(ENVELOPE_FROM);
     CLEAR_MACRO(ENVELOPE_RECIPIENT);
@@ -313,6 +324,16 @@ ensure_macros (MilterProtocolAgentPrivate *priv, MilterCommand macro_context)
         g_hash_table_insert(priv->macros,
                             GINT_TO_POINTER(macro_context),
                             macros);
+    } else if (g_hash_table_remove(priv->shared_macros,
+                                   GINT_TO_POINTER(macro_context))) {
+        GHashTable *shared_macros = macros;
+
+        macros = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       g_free, g_free);
+        milter_utils_merge_hash_string_string(macros, shared_macros);
+        g_hash_table_insert(priv->macros,
+                            GINT_TO_POINTER(macro_context),
+                            macros);
     }
     return macros;
 }
@@ -390,10 +411,51 @@ milter_protocol_agent_set_macros_hash_table (MilterProtocolAgent *agent,
     g_hash_table_insert(priv->macros,
                         GINT_TO_POINTER(macro_context),
                         new_macros);
+    g_hash_table_remove(priv->shared_macros, GINT_TO_POINTER(macro_context));
     g_hash_table_foreach(macros, cb_copy_macro, new_macros);
     clear_available_macros(priv);
 }
 
+/**
+ * milter_protocol_agent_share_macros_hash_table:
+ * @agent: A #MilterProtocolAgent.
+ * @macro_context: The macro context.
+ * @macros: (element-type utf8 utf8): The macros to be shared.
+ *
+ * Uses @macros as the macros for @macro_context without
+ * copying it. @macros is referenced and it must not be
+ * changed after this call. @agent copies @macros before
+ * it changes a shared macro.
+ */
+void
+milter_protocol_agent_share_macros_hash_table (MilterProtocolAgent *agent,
+                                               MilterCommand macro_context,
+                                               GHashTable *macros)
+{
+    MilterProtocolAgentPrivate *priv;
+
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    g_hash_table_insert(priv->macros,
+                        GINT_TO_POINTER(macro_context),
+                        g_hash_table_ref(macros));
+    g_hash_table_insert(priv->shared_macros,
+                        GINT_TO_POINTER(macro_context),
+                        GINT_TO_POINTER(macro_context));
+    clear_available_macros(priv);
+}
+
+gboolean
+milter_protocol_agent_is_shared_macros (MilterProtocolAgent *agent,
+                                        MilterCommand macro_context)
+{
+    MilterProtocolAgentPrivate *priv;
+
+    priv = MILTER_PROTOCOL_AGENT_GET_PRIVATE(agent);
+    return g_hash_table_lookup_extended(priv->shared_macros,
+                                        GINT_TO_POINTER(macro_context),
+                                        NULL, NULL);
+}
+
 void
 milter_protocol_agent_set_macro (MilterProtocolAgent *agent,
                                  MilterCommand  macro_context,
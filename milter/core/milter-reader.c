@@ -23,6 +23,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include <glib.h>
 
@@ -39,6 +41,11 @@ typedef struct _MilterReaderPrivate	MilterReaderPrivate;
 struct _MilterReaderPrivate
 {
     GIOChannel *io_channel;
+    gint fd;
+    MilterDecoder *decoder;
+    gsize read_size;
+    guint n_reads;
+    gsize n_read_bytes;
     MilterEventLoop *loop;
     guint read_watch_id;
     guint error_watch_id;
@@ -115,6 +122,9 @@ milter_reader_class_init (MilterReaderClass *klass)
     g_type_class_add_private(gobject_class, sizeof(MilterReaderPrivate));
 }
 
+#define MIN_READ_SIZE 4096
+#define MAX_READ_SIZE (64 * 1024)
+
 static void
 milter_reader_init (MilterReader *reader)
 {
@@ -122,6 +132,11 @@ milter_reader_init (MilterReader *reader)
 
     priv = MILTER_READER_GET_PRIVATE(reader);
     priv->io_channel = NULL;
+    priv->fd = -1;
+    priv->decoder = NULL;
+    priv->read_size = MIN_READ_SIZE;
+    priv->n_reads = 0;
+    priv->n_read_bytes = 0;
     priv->loop = NULL;
     priv->read_watch_id = 0;
     priv->error_watch_id = 0;
@@ -169,6 +184,8 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
     }
 
     if (length > 0) {
+        priv->n_reads++;
+        priv->n_read_bytes += length;
         if (milter_need_trace_log()) {
             GIOCondition condition;
             condition = g_io_channel_get_buffer_condition(priv->io_channel);
@@ -182,6 +199,79 @@ read_from_channel (MilterReader *reader, GIOChannel *channel)
     return !error_occurred && !eof;
 }
 
+/* The read size is doubled while reads fill the buffer, e.g. for
+ * a large body, and is halved while reads are small. */
+static void
+update_read_size (MilterReaderPrivate *priv, gsize length)
+{
+    if (length == priv->read_size) {
+        if (priv->read_size < MAX_READ_SIZE)
+            priv->read_size *= 2;
+    } else if (length < priv->read_size / 4) {
+        if (priv->read_size > MIN_READ_SIZE)
+            priv->read_size /= 2;
+    }
+}
+
+static gboolean
+read_from_fd (MilterReader *reader)
+{
+    MilterReaderPrivate *priv;
+    gchar *buffer;
+    gchar stream[MIN_READ_SIZE];
+    gsize read_size;
+    gssize length;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+
+    if (priv->decoder) {
+        read_size = priv->read_size;
+        buffer = milter_decoder_reserve_buffer(priv->decoder, read_size);
+    } else {
+        read_size = sizeof(stream);
+        buffer = stream;
+    }
+
+    do {
+        length = read(priv->fd, buffer, read_size);
+    } while (length == -1 && errno == EINTR);
+
+    if (length == -1) {
+        GError *error = NULL;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return TRUE;
+
+        priv->shutdown_requested = TRUE;
+        g_set_error(&error,
+                    MILTER_READER_ERROR,
+                    MILTER_READER_ERROR_IO_ERROR,
+                    "I/O error: %s", g_strerror(errno));
+        milter_error("[%u] [reader][error][read] %s",
+                     priv->tag, error->message);
+        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(reader),
+                                    error);
+        g_error_free(error);
+        return FALSE;
+    }
+
+    if (length == 0) {
+        milter_trace("[%u] [reader][eof]", priv->tag);
+        return FALSE;
+    }
+
+    priv->n_reads++;
+    priv->n_read_bytes += length;
+    milter_trace("[%u] [reader][read][direct] <%" G_GSSIZE_FORMAT ">/"
+                 "<%" G_GSIZE_FORMAT ">",
+                 priv->tag, length, read_size);
+    if (priv->decoder)
+        update_read_size(priv, length);
+    g_signal_emit(reader, signals[FLOW], 0, buffer, (gsize)length);
+
+    return TRUE;
+}
+
 static void
 clear_watch_id (MilterReaderPrivate *priv)
 {
@@ -225,8 +315,12 @@ read_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 
     if (!priv->shutdown_requested) {
         milter_trace("[%d] [reader][callback][read][reading] ...", priv->tag);
-        keep_callback = read_from_channel(reader, channel);
+        if (priv->fd >= 0)
+            keep_callback = read_from_fd(reader);
+        else
+            keep_callback = read_from_channel(reader, channel);
         while (keep_callback &&
+               priv->fd < 0 &&
                g_io_channel_get_buffered(priv->io_channel) &&
                (g_io_channel_get_buffer_condition(priv->io_channel) & G_IO_IN)) {
             milter_trace("[%d] [reader][callback][read][reading][buffer] ...",
@@ -360,6 +454,11 @@ dispose (GObject *object)
         priv->io_channel = NULL;
     }
 
+    if (priv->decoder) {
+        g_object_unref(priv->decoder);
+        priv->decoder = NULL;
+    }
+
     G_OBJECT_CLASS(milter_reader_parent_class)->dispose(object);
 }
 
@@ -423,6 +522,70 @@ milter_reader_io_channel_new (GIOChannel *channel)
                         NULL);
 }
 
+/**
+ * milter_reader_unix_io_channel_new:
+ * @channel: A #GIOChannel for an UNIX file descriptor.
+ *
+ * Creates a reader that reads from the file descriptor of
+ * @channel directly instead of through the #GIOChannel
+ * buffer. If a decoder is set by
+ * milter_reader_set_decoder(), data are read into the
+ * buffer of the decoder and the read size grows while
+ * large data such as a body are received.
+ *
+ * Returns: A new #MilterReader.
+ */
+MilterReader *
+milter_reader_unix_io_channel_new (GIOChannel *channel)
+{
+    MilterReader *reader;
+
+    reader = milter_reader_io_channel_new(channel);
+    if (channel)
+        MILTER_READER_GET_PRIVATE(reader)->fd = g_io_channel_unix_get_fd(channel);
+
+    return reader;
+}
+
+void
+milter_reader_set_decoder (MilterReader *reader, MilterDecoder *decoder)
+{
+    MilterReaderPrivate *priv;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+    if (priv->decoder == decoder)
+        return;
+
+    if (priv->decoder)
+        g_object_unref(priv->decoder);
+    priv->decoder = decoder;
+    if (priv->decoder)
+        g_object_ref(priv->decoder);
+    priv->read_size = MIN_READ_SIZE;
+}
+
+guint
+milter_reader_get_n_reads (MilterReader *reader)
+{
+    return MILTER_READER_GET_PRIVATE(reader)->n_reads;
+}
+
+gsize
+milter_reader_get_n_read_bytes (MilterReader *reader)
+{
+    return MILTER_READER_GET_PRIVATE(reader)->n_read_bytes;
+}
+
+void
+milter_reader_reset_statistics (MilterReader *reader)
+{
+    MilterReaderPrivate *priv;
+
+    priv = MILTER_READER_GET_PRIVATE(reader);
+    priv->n_reads = 0;
+    priv->n_read_bytes = 0;
+}
+
 void
 milter_reader_start (MilterReader *reader, MilterEventLoop *loop)
 {
@@ -27,6 +27,7 @@
 #include <milter/core/milter-error-emittable.h>
 #include <milter/core/milter-finished-emittable.h>
 #include <milter/core/milter-event-loop.h>
+#include <milter/core/milter-decoder.h>
 
 G_BEGIN_DECLS
 
@@ -67,12 +68,22 @@ GQuark           milter_reader_error_quark    (void);
 GType            milter_reader_get_type       (void) G_GNUC_CONST;
 
 MilterReader    *milter_reader_io_channel_new (GIOChannel       *channel);
+MilterReader    *milter_reader_unix_io_channel_new
+                                              (GIOChannel       *channel);
 
 void             milter_reader_start          (MilterReader     *reader,
                                                MilterEventLoop  *loop);
 gboolean         milter_reader_is_watching    (MilterReader     *reader);
 void             milter_reader_shutdown       (MilterReader     *reader);
 
+void             milter_reader_set_decoder    (MilterReader     *reader,
+                                               MilterDecoder    *decoder);
+guint            milter_reader_get_n_reads    (MilterReader     *reader);
+gsize            milter_reader_get_n_read_bytes
+                                              (MilterReader     *reader);
+void             milter_reader_reset_statistics
+                                              (MilterReader     *reader);
+
 guint            milter_reader_get_tag        (MilterReader     *reader);
 void             milter_reader_set_tag        (MilterReader     *reader,
                                                guint             tag);
@@ -24,6 +24,7 @@
 #include <syslog.h>
 
 #include "milter-syslog-logger.h"
+#include "milter-log-writer.h"
 
 #define INTERESTING_LEVEL_KEY "syslog"
 
@@ -36,6 +37,7 @@ typedef struct _MilterSyslogLoggerPrivate MilterSyslogLoggerPrivate;
 struct _MilterSyslogLoggerPrivate
 {
     MilterLogger *logger;
+    MilterLogWriter *writer;
     gchar *identity;
     MilterLogLevelFlags target_level;
     gchar *facility;
@@ -155,7 +157,7 @@ cb_log (MilterLogger *logger, const gchar *domain,
     g_string_append(log, message);
 
     syslog_level = milter_log_level_to_syslog_level(level);
-    syslog(syslog_level, "%s", log->str);
+    milter_log_writer_write_syslog(priv->writer, syslog_level, log->str);
 
     g_string_free(log, TRUE);
 }
@@ -224,6 +226,7 @@ setup_logger (MilterSyslogLoggerPrivate *priv)
         facility = resolve_syslog_facility(priv->facility);
     }
     openlog(priv->identity, LOG_PID, facility);
+    priv->writer = milter_log_writer_new();
     g_object_ref(priv->logger);
     g_signal_connect(priv->logger, "log", G_CALLBACK(cb_log), priv);
 }
@@ -237,6 +240,10 @@ teardown_logger (MilterSyslogLoggerPrivate *priv)
     g_signal_handlers_disconnect_by_func(priv->logger,
                                          G_CALLBACK(cb_log), priv);
     g_object_unref(priv->logger);
+    if (priv->writer) {
+        g_object_unref(priv->writer);
+        priv->writer = NULL;
+    }
     closelog();
 }
 
@@ -284,6 +291,7 @@ milter_syslog_logger_init (MilterSyslogLogger *logger)
 
     priv->identity = NULL;
     priv->facility = NULL;
+    priv->writer = NULL;
 }
 
 static void
@@ -23,6 +23,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 #include <glib.h>
 
@@ -35,12 +39,25 @@
                                  MILTER_TYPE_WRITER,    \
                                  MilterWriterPrivate))
 
+/* Small chunks are appended to the last segment until it
+ * reaches this size. */
+#define SEGMENT_SIZE 4096
+
+#if defined(IOV_MAX) && IOV_MAX < 64
+#  define MAX_VECTORS IOV_MAX
+#else
+#  define MAX_VECTORS 64
+#endif
+
 typedef struct _MilterWriterPrivate	MilterWriterPrivate;
 struct _MilterWriterPrivate
 {
     GIOChannel *io_channel;
+    gint fd;
     MilterEventLoop *loop;
-    GString *buffer;
+    GQueue *segments;
+    gsize head_offset;
+    gsize buffered_size;
     gsize flush_point;
     gboolean writing;
     guint write_watch_id;
@@ -132,8 +149,11 @@ milter_writer_init (MilterWriter *writer)
 
     priv = MILTER_WRITER_GET_PRIVATE(writer);
     priv->io_channel = NULL;
+    priv->fd = -1;
     priv->loop = NULL;
-    priv->buffer = g_string_new(NULL);
+    priv->segments = g_queue_new();
+    priv->head_offset = 0;
+    priv->buffered_size = 0;
     priv->flush_point = 0;
     priv->writing = FALSE;
     priv->write_watch_id = 0;
@@ -142,6 +162,132 @@ milter_writer_init (MilterWriter *writer)
     priv->tag = 0;
 }
 
+static void
+segment_free (gpointer data)
+{
+    GString *segment = data;
+
+    g_string_free(segment, TRUE);
+}
+
+static void
+clear_segments (MilterWriterPrivate *priv)
+{
+    g_queue_foreach(priv->segments, (GFunc)segment_free, NULL);
+    g_queue_clear(priv->segments);
+    priv->head_offset = 0;
+    priv->buffered_size = 0;
+}
+
+static void
+append_segment (MilterWriterPrivate *priv, const gchar *data, gsize size)
+{
+    GString *tail;
+
+    tail = g_queue_peek_tail(priv->segments);
+    if (tail && tail->len + size <= SEGMENT_SIZE) {
+        g_string_append_len(tail, data, size);
+    } else {
+        g_queue_push_tail(priv->segments, g_string_new_len(data, size));
+    }
+    priv->buffered_size += size;
+}
+
+static void
+consume_segments (MilterWriterPrivate *priv, gsize size)
+{
+    priv->buffered_size -= size;
+    while (size > 0) {
+        GString *head;
+        gsize rest_size;
+
+        head = g_queue_peek_head(priv->segments);
+        rest_size = head->len - priv->head_offset;
+        if (size < rest_size) {
+            priv->head_offset += size;
+            break;
+        }
+        size -= rest_size;
+        segment_free(g_queue_pop_head(priv->segments));
+        priv->head_offset = 0;
+    }
+}
+
+static gssize
+write_vectors (gint fd, const struct iovec *vectors, gint n_vectors)
+{
+    gssize written_size;
+
+    do {
+        written_size = writev(fd, vectors, n_vectors);
+    } while (written_size == -1 && errno == EINTR);
+
+    return written_size;
+}
+
+/* Writes buffered segments without copying them. The data
+ * are written by writev() directly when the file descriptor
+ * is known. Otherwise, they are written to the channel
+ * segment by segment. */
+static void
+write_segments (MilterWriterPrivate *priv,
+                gsize *written_size,
+                GError **error)
+{
+    GList *node;
+
+    *written_size = 0;
+
+    if (priv->fd >= 0) {
+        struct iovec vectors[MAX_VECTORS];
+        gint n_vectors = 0;
+        gssize size;
+
+        for (node = priv->segments->head;
+             node && n_vectors < MAX_VECTORS;
+             node = g_list_next(node)) {
+            GString *segment = node->data;
+            gsize offset = 0;
+
+            if (n_vectors == 0)
+                offset = priv->head_offset;
+            vectors[n_vectors].iov_base = segment->str + offset;
+            vectors[n_vectors].iov_len = segment->len - offset;
+            n_vectors++;
+        }
+
+        size = write_vectors(priv->fd, vectors, n_vectors);
+        if (size >= 0) {
+            *written_size = size;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            g_set_error(error,
+                        G_IO_CHANNEL_ERROR,
+                        g_io_channel_error_from_errno(errno),
+                        "%s", g_strerror(errno));
+        }
+        return;
+    }
+
+    for (node = priv->segments->head; node; node = g_list_next(node)) {
+        GString *segment = node->data;
+        gsize offset = 0;
+        gsize size = 0;
+
+        if (node == priv->segments->head)
+            offset = priv->head_offset;
+        g_io_channel_write_chars(priv->io_channel,
+                                 segment->str + offset,
+                                 segment->len - offset,
+                                 &size,
+                                 error);
+        *written_size += size;
+        if (size < segment->len - offset)
+            break;
+        if (error && *error)
+            break;
+    }
+}
+
 static void
 clear_write_watch_id (MilterWriterPrivate *priv)
 {
@@ -193,14 +339,15 @@ dispose (GObject *object)
         priv->io_channel = NULL;
     }
 
-    if (priv->buffer) {
-        if (priv->buffer->len > 0) {
+    if (priv->segments) {
+        if (priv->buffered_size > 0) {
             milter_debug("[%u] [writer][dispose][buffer][unwritten] "
                          "<%" G_GSIZE_FORMAT ">",
-                         priv->tag, priv->buffer->len);
+                         priv->tag, priv->buffered_size);
         }
-        g_string_free(priv->buffer, TRUE);
-        priv->buffer = NULL;
+        clear_segments(priv);
+        g_queue_free(priv->segments);
+        priv->segments = NULL;
     }
 
     G_OBJECT_CLASS(milter_writer_parent_class)->dispose(object);
@@ -266,6 +413,29 @@ milter_writer_io_channel_new (GIOChannel *channel)
                         NULL);
 }
 
+/**
+ * milter_writer_unix_io_channel_new:
+ * @channel: A #GIOChannel created by g_io_channel_unix_new().
+ *
+ * Creates a writer that writes to the file descriptor of
+ * @channel directly. Data are written by writev() on
+ * write and only unwritten data are buffered. @channel
+ * should be non-blocking and must not be written by others.
+ *
+ * Returns: A new #MilterWriter.
+ */
+MilterWriter *
+milter_writer_unix_io_channel_new (GIOChannel *channel)
+{
+    MilterWriter *writer;
+
+    writer = milter_writer_io_channel_new(channel);
+    if (channel)
+        MILTER_WRITER_GET_PRIVATE(writer)->fd = g_io_channel_unix_get_fd(channel);
+
+    return writer;
+}
+
 static gboolean
 flush_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 {
@@ -314,6 +484,22 @@ flush_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
     return keep_callback;
 }
 
+static gboolean
+flush_idle_func (gpointer data)
+{
+    MilterWriter *writer = data;
+    MilterWriterPrivate *priv;
+
+    priv = MILTER_WRITER_GET_PRIVATE(writer);
+
+    milter_trace("[%u] [writer][flush-callback][idle] [%u]",
+                 priv->tag, priv->flush_watch_id);
+    priv->flush_watch_id = 0;
+    g_signal_emit(writer, signals[FLUSHED], 0);
+
+    return FALSE;
+}
+
 static void
 request_flush (MilterWriter *writer)
 {
@@ -321,11 +507,19 @@ request_flush (MilterWriter *writer)
 
     priv = MILTER_WRITER_GET_PRIVATE(writer);
     if (priv->flush_watch_id == 0) {
-        priv->flush_watch_id =
-            milter_event_loop_watch_io(priv->loop,
-                                       priv->io_channel,
-                                       G_IO_OUT,
-                                       flush_watch_func, writer);
+        /* Data written to the file descriptor directly aren't
+         * buffered in the channel. So we don't need to wait
+         * for the channel to be writable. */
+        if (priv->fd >= 0)
+            priv->flush_watch_id =
+                milter_event_loop_add_idle(priv->loop,
+                                           flush_idle_func, writer);
+        else
+            priv->flush_watch_id =
+                milter_event_loop_watch_io(priv->loop,
+                                           priv->io_channel,
+                                           G_IO_OUT,
+                                           flush_watch_func, writer);
         milter_trace("[%u] [writer][flush-callback][registered] <%u>",
                      priv->tag, priv->flush_watch_id);
     } else {
@@ -345,9 +539,9 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 
     milter_trace("[%u] [writer][write-callback] [%u] "
                  "buffered: <%" G_GSIZE_FORMAT ">",
-                 priv->tag, priv->write_watch_id, priv->buffer->len);
+                 priv->tag, priv->write_watch_id, priv->buffered_size);
 
-    if (priv->buffer->len == 0) {
+    if (priv->buffered_size == 0) {
         keep_callback = FALSE;
         milter_trace("[%u] [writer][write-callback][empty] [%u] "
                      "stop write watch because buffer is empty",
@@ -357,18 +551,14 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
         GError *channel_error = NULL;
 
         priv->writing = TRUE;
-        g_io_channel_write_chars(priv->io_channel,
-                                 priv->buffer->str,
-                                 priv->buffer->len,
-                                 &written_size,
-                                 &channel_error);
+        write_segments(priv, &written_size, &channel_error);
         priv->writing = FALSE;
 
         if (written_size == 0) {
             milter_trace("[%u] [writer][write-callback][unwritten] [%u] "
                          "no buffered chunks are written: "
                          "rest: <%" G_GSIZE_FORMAT ">",
-                         priv->tag, priv->write_watch_id, priv->buffer->len);
+                         priv->tag, priv->write_watch_id, priv->buffered_size);
         } else {
             gboolean need_flush = FALSE;
 
@@ -380,7 +570,7 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
                     priv->flush_point -= written_size;
                 }
             }
-            g_string_erase(priv->buffer, 0, written_size);
+            consume_segments(priv, written_size);
             milter_trace("[%u] [writer][write-callback][wrote] [%u] "
                          "written: <%" G_GSIZE_FORMAT "> "
                          "rest: <%" G_GSIZE_FORMAT "> "
@@ -388,7 +578,7 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
                          priv->tag,
                          priv->write_watch_id,
                          written_size,
-                         priv->buffer->len,
+                         priv->buffered_size,
                          need_flush ? "true" : "false");
             if (need_flush && priv->loop) {
                 request_flush(writer);
@@ -426,8 +616,39 @@ write_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
 gboolean
 milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
                      GError **error)
+{
+    struct iovec vector;
+
+    vector.iov_base = (gchar *)chunk;
+    vector.iov_len = chunk_size;
+    return milter_writer_write_vectors(writer, &vector, 1, error);
+}
+
+/**
+ * milter_writer_write_vectors:
+ * @writer: A #MilterWriter.
+ * @vectors: Chunks to be written.
+ * @n_vectors: The number of @vectors.
+ * @error: Return location for a #GError or %NULL.
+ *
+ * Writes all chunks in @vectors in order. They are written
+ * by one writev() call if @writer is created by
+ * milter_writer_unix_io_channel_new() and there are no
+ * buffered data. Unwritten data are copied to the buffer
+ * and written when the channel is writable.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ */
+gboolean
+milter_writer_write_vectors (MilterWriter *writer,
+                             const struct iovec *vectors,
+                             gint n_vectors,
+                             GError **error)
 {
     MilterWriterPrivate *priv;
+    gsize total_size = 0;
+    gsize written_size = 0;
+    gint i;
 
     priv = MILTER_WRITER_GET_PRIVATE(writer);
 
@@ -451,14 +672,45 @@ milter_writer_write (MilterWriter *writer, const gchar *chunk, gsize chunk_size,
         return FALSE;
     }
 
-    if (chunk_size == 0) {
+    for (i = 0; i < n_vectors; i++) {
+        total_size += vectors[i].iov_len;
+    }
+
+    if (total_size == 0) {
         milter_debug("[%u] [writer][write][empty] "
                      "ignore empty chunk write request",
                      priv->tag);
         return TRUE;
     }
 
-    g_string_append_len(priv->buffer, chunk, chunk_size);
+    /* Write errors are reported by the write callback like
+     * buffered writes. */
+    if (priv->fd >= 0 && priv->buffered_size == 0 && !priv->writing) {
+        gssize size;
+
+        size = write_vectors(priv->fd, vectors, MIN(n_vectors, MAX_VECTORS));
+        if (size > 0)
+            written_size = size;
+        milter_trace("[%u] [writer][write][direct] "
+                     "written: <%" G_GSIZE_FORMAT "> "
+                     "rest: <%" G_GSIZE_FORMAT ">",
+                     priv->tag, written_size, total_size - written_size);
+        if (written_size == total_size)
+            return TRUE;
+    }
+
+    for (i = 0; i < n_vectors; i++) {
+        const gchar *chunk = vectors[i].iov_base;
+        gsize chunk_size = vectors[i].iov_len;
+
+        if (written_size >= chunk_size) {
+            written_size -= chunk_size;
+            continue;
+        }
+        append_segment(priv, chunk + written_size, chunk_size - written_size);
+        written_size = 0;
+    }
+
     if (priv->write_watch_id == 0) {
         priv->write_watch_id =
             milter_event_loop_watch_io(priv->loop,
@@ -503,7 +755,7 @@ milter_writer_flush (MilterWriter *writer, GError **error)
     }
 
     if (priv->write_watch_id > 0) {
-        priv->flush_point = priv->buffer->len;
+        priv->flush_point = priv->buffered_size;
         milter_trace("[%u] [writer][flush][flush-point][set] [%u] "
                      "<%" G_GSIZE_FORMAT ">",
                      priv->tag,
@@ -603,9 +855,9 @@ flush_buffer_on_shutdown (MilterWriter *writer)
 
     milter_trace("[%u] [writer][shutdown][flush-buffer] "
                  "<%" G_GSIZE_FORMAT ">",
-                 priv->tag, priv->buffer->len);
+                 priv->tag, priv->buffered_size);
 
-    if (priv->buffer->len == 0) {
+    if (priv->buffered_size == 0) {
         milter_trace("[%u] [writer][shutdown][flush-buffer][skip] "
                      "no buffered data",
                      priv->tag);
@@ -618,25 +870,21 @@ flush_buffer_on_shutdown (MilterWriter *writer)
         return;
     }
 
-    g_io_channel_write_chars(priv->io_channel,
-                             priv->buffer->str,
-                             priv->buffer->len,
-                             &written_size,
-                             &channel_error);
+    write_segments(priv, &written_size, &channel_error);
 
     if (written_size == 0) {
         milter_trace("[%u] [writer][shutdown][flush-buffer][unwritten] "
                      "no buffered chunks are written: "
                      "rest: <%" G_GSIZE_FORMAT ">",
-                     priv->tag, priv->buffer->len);
+                     priv->tag, priv->buffered_size);
     } else {
-        g_string_erase(priv->buffer, 0, written_size);
+        consume_segments(priv, written_size);
         milter_trace("[%u] [writer][shutdown][flush-buffer][wrote] "
                      "written: <%" G_GSIZE_FORMAT "> "
                      "rest: <%" G_GSIZE_FORMAT ">",
                      priv->tag,
                      written_size,
-                     priv->buffer->len);
+                     priv->buffered_size);
     }
 
     if (channel_error) {
@@ -20,6 +20,8 @@
 #ifndef __MILTER_WRITER_H__
 #define __MILTER_WRITER_H__
 
+#include <sys/uio.h>
+
 #include <glib-object.h>
 
 #include <milter/core/milter-protocol.h>
@@ -64,11 +66,17 @@ GQuark           milter_writer_error_quark    (void);
 GType            milter_writer_get_type       (void) G_GNUC_CONST;
 
 MilterWriter    *milter_writer_io_channel_new (GIOChannel       *channel);
+MilterWriter    *milter_writer_unix_io_channel_new
+                                              (GIOChannel       *channel);
 
 gboolean         milter_writer_write          (MilterWriter     *writer,
                                                const gchar      *chunk,
                                                gsize             chunk_size,
                                                GError          **error);
+gboolean         milter_writer_write_vectors  (MilterWriter     *writer,
+                                               const struct iovec *vectors,
+                                               gint              n_vectors,
+                                               GError          **error);
 gboolean         milter_writer_flush          (MilterWriter     *writer,
                                                GError          **error);
 
@@ -21,9 +21,73 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
 #include "milter-manager-applicable-condition.h"
 #include "milter-manager-enum-types.h"
 
+typedef enum
+{
+    RULE_STRINGS,
+    RULE_REGEXPS,
+    RULE_NETWORKS,
+    RULE_IPV4_ADDRESS,
+    RULE_LOCAL_ADDRESS,
+    RULE_UNKNOWN_ADDRESS,
+    RULE_MACRO,
+    RULE_DNSBL,
+    RULE_AND,
+    RULE_OR,
+    RULE_NOT
+} RuleType;
+
+/* Networks are kept in a binary trie per address family. Node 0 is
+ * the IPv4 root and node 1 is the IPv6 root, so 0 never appears as
+ * a child index and means "no child". */
+#define NETWORK_IPV4_ROOT 0
+#define NETWORK_IPV6_ROOT 1
+
+typedef struct _NetworkNode NetworkNode;
+struct _NetworkNode
+{
+    guint32 children[2];
+    gboolean terminal;
+};
+
+struct _MilterManagerConditionRule
+{
+    gint ref_count;
+    RuleType type;
+    union {
+        GHashTable *strings;
+        GRegex *regex;
+        GArray *networks;
+        struct {
+            gchar *name;
+            gchar *value;
+        } macro;
+        MilterManagerDNSBL *dnsbl;
+        struct {
+            MilterManagerConditionRule *left;
+            MilterManagerConditionRule *right;
+        } pair;
+        MilterManagerConditionRule *operand;
+    } data;
+};
+
+typedef struct _RuleInput RuleInput;
+struct _RuleInput
+{
+    const gchar *value;
+    const struct sockaddr *address;
+    socklen_t address_length;
+    GHashTable *macros;
+    MilterProtocolAgent *agent;
+};
+
 #define MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(obj)            \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
                                  MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, \
@@ -35,6 +99,10 @@ struct _MilterManagerApplicableConditionPrivate
     gchar *name;
     gchar *description;
     gchar *data;
+    MilterManagerConditionRule *connect_rule;
+    MilterManagerConditionRule *helo_rule;
+    MilterManagerConditionRule *envelope_from_rule;
+    MilterManagerConditionRule *envelope_recipient_rule;
 };
 
 enum
@@ -53,6 +121,11 @@ enum
 
 static gint signals[LAST_SIGNAL] = {0};
 
+G_DEFINE_BOXED_TYPE(MilterManagerConditionRule,
+                    milter_manager_condition_rule,
+                    milter_manager_condition_rule_ref,
+                    milter_manager_condition_rule_unref)
+
 G_DEFINE_TYPE(MilterManagerApplicableCondition,
               milter_manager_applicable_condition,
               G_TYPE_OBJECT)
@@ -66,6 +139,10 @@ static void get_property   (GObject         *object,
                             guint            prop_id,
                             GValue          *value,
                             GParamSpec      *pspec);
+static void attach_to      (MilterManagerApplicableCondition *condition,
+                            MilterManagerChild               *child,
+                            MilterManagerChildren            *children,
+                            MilterClientContext              *context);
 
 static void
 milter_manager_applicable_condition_class_init (MilterManagerApplicableConditionClass *klass)
@@ -79,6 +156,8 @@ milter_manager_applicable_condition_class_init (MilterManagerApplicableCondition
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
+    klass->attach_to = attach_to;
+
     spec = g_param_spec_string("name",
                                "Name",
                                "The name of the applicable condition",
@@ -126,6 +205,10 @@ milter_manager_applicable_condition_init (MilterManagerApplicableCondition *appl
     priv->name = NULL;
     priv->description = NULL;
     priv->data = NULL;
+    priv->connect_rule = NULL;
+    priv->helo_rule = NULL;
+    priv->envelope_from_rule = NULL;
+    priv->envelope_recipient_rule = NULL;
 }
 
 static void
@@ -150,6 +233,26 @@ dispose (GObject *object)
         priv->data = NULL;
     }
 
+    if (priv->connect_rule) {
+        milter_manager_condition_rule_unref(priv->connect_rule);
+        priv->connect_rule = NULL;
+    }
+
+    if (priv->helo_rule) {
+        milter_manager_condition_rule_unref(priv->helo_rule);
+        priv->helo_rule = NULL;
+    }
+
+    if (priv->envelope_from_rule) {
+        milter_manager_condition_rule_unref(priv->envelope_from_rule);
+        priv->envelope_from_rule = NULL;
+    }
+
+    if (priv->envelope_recipient_rule) {
+        milter_manager_condition_rule_unref(priv->envelope_recipient_rule);
+        priv->envelope_recipient_rule = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_applicable_condition_parent_class)->dispose(object);
 }
 
@@ -207,6 +310,498 @@ get_property (GObject    *object,
     }
 }
 
+GQuark
+milter_manager_condition_rule_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-condition-rule-error-quark");
+}
+
+static MilterManagerConditionRule *
+rule_new (RuleType type)
+{
+    MilterManagerConditionRule *rule;
+
+    rule = g_new0(MilterManagerConditionRule, 1);
+    rule->ref_count = 1;
+    rule->type = type;
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_strings (const gchar * const *strings)
+{
+    MilterManagerConditionRule *rule;
+    gint i;
+
+    rule = rule_new(RULE_STRINGS);
+    rule->data.strings = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, NULL);
+    for (i = 0; strings && strings[i]; i++) {
+        g_hash_table_add(rule->data.strings, g_strdup(strings[i]));
+    }
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_regexps (const gchar * const *patterns,
+                                           GError     **error)
+{
+    MilterManagerConditionRule *rule;
+    GString *pattern;
+    GRegex *regex;
+    GError *regex_error = NULL;
+    gint i;
+
+    /* All patterns are joined into one alternation and compiled once
+     * so that matching a value costs one regex execution instead of
+     * one per pattern. */
+    pattern = g_string_new(NULL);
+    for (i = 0; patterns && patterns[i]; i++) {
+        if (i > 0)
+            g_string_append_c(pattern, '|');
+        g_string_append_printf(pattern, "(?:%s)", patterns[i]);
+    }
+    if (pattern->len == 0)
+        g_string_append(pattern, "(?!)");
+
+    regex = g_regex_new(pattern->str, G_REGEX_OPTIMIZE | G_REGEX_RAW, 0,
+                        &regex_error);
+    if (!regex) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONDITION_RULE_ERROR,
+                    MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_REGEXP,
+                    "invalid regular expression: <%s>: %s",
+                    pattern->str, regex_error->message);
+        g_error_free(regex_error);
+        g_string_free(pattern, TRUE);
+        return NULL;
+    }
+    g_string_free(pattern, TRUE);
+
+    rule = rule_new(RULE_REGEXPS);
+    rule->data.regex = regex;
+
+    return rule;
+}
+
+static gboolean
+network_bit (const guint8 *address, guint i)
+{
+    return (address[i / 8] >> (7 - (i % 8))) & 1;
+}
+
+static void
+network_add (GArray *nodes, guint32 root,
+             const guint8 *address, guint prefix_length)
+{
+    guint32 index = root;
+    guint i;
+
+    for (i = 0; i < prefix_length; i++) {
+        NetworkNode *node;
+        gboolean bit;
+
+        node = &g_array_index(nodes, NetworkNode, index);
+        if (node->terminal)
+            return;
+
+        bit = network_bit(address, i);
+        if (node->children[bit] == 0) {
+            NetworkNode child = {{0, 0}, FALSE};
+
+            node->children[bit] = nodes->len;
+            g_array_append_val(nodes, child);
+            node = &g_array_index(nodes, NetworkNode, index);
+        }
+        index = node->children[bit];
+    }
+
+    g_array_index(nodes, NetworkNode, index).terminal = TRUE;
+}
+
+static gboolean
+network_include (GArray *nodes, guint32 root,
+                 const guint8 *address, guint address_length)
+{
+    guint32 index = root;
+    guint i;
+
+    for (i = 0; i < address_length; i++) {
+        const NetworkNode *node;
+
+        node = &g_array_index(nodes, NetworkNode, index);
+        if (node->terminal)
+            return TRUE;
+        index = node->children[network_bit(address, i)];
+        if (index == 0)
+            return FALSE;
+    }
+
+    return g_array_index(nodes, NetworkNode, index).terminal;
+}
+
+static gboolean
+network_parse (GArray *nodes, const gchar *network, GError **error)
+{
+    gchar *address_string;
+    gchar *prefix_string;
+    guint8 address[sizeof(struct in6_addr)];
+    guint32 root;
+    guint max_prefix_length;
+    guint prefix_length;
+
+    address_string = g_strdup(network);
+    prefix_string = strchr(address_string, '/');
+    if (prefix_string) {
+        *prefix_string = '\0';
+        prefix_string++;
+    }
+
+    if (inet_pton(AF_INET, address_string, address) == 1) {
+        root = NETWORK_IPV4_ROOT;
+        max_prefix_length = 32;
+    } else if (inet_pton(AF_INET6, address_string, address) == 1) {
+        root = NETWORK_IPV6_ROOT;
+        max_prefix_length = 128;
+    } else {
+        g_set_error(error,
+                    MILTER_MANAGER_CONDITION_RULE_ERROR,
+                    MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_NETWORK,
+                    "invalid network address: <%s>", network);
+        g_free(address_string);
+        return FALSE;
+    }
+
+    prefix_length = max_prefix_length;
+    if (prefix_string) {
+        gchar *end;
+        guint64 parsed_prefix_length;
+
+        parsed_prefix_length = g_ascii_strtoull(prefix_string, &end, 10);
+        if (prefix_string[0] == '\0' || end[0] != '\0' ||
+            parsed_prefix_length > max_prefix_length) {
+            g_set_error(error,
+                        MILTER_MANAGER_CONDITION_RULE_ERROR,
+                        MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_NETWORK,
+                        "invalid network prefix length: <%s>", network);
+            g_free(address_string);
+            return FALSE;
+        }
+        prefix_length = parsed_prefix_length;
+    }
+    g_free(address_string);
+
+    network_add(nodes, root, address, prefix_length);
+    return TRUE;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_networks (const gchar * const *networks,
+                                            GError     **error)
+{
+    MilterManagerConditionRule *rule;
+    GArray *nodes;
+    NetworkNode root = {{0, 0}, FALSE};
+    gint i;
+
+    nodes = g_array_new(FALSE, FALSE, sizeof(NetworkNode));
+    g_array_append_val(nodes, root);
+    g_array_append_val(nodes, root);
+    for (i = 0; networks && networks[i]; i++) {
+        if (!network_parse(nodes, networks[i], error)) {
+            g_array_free(nodes, TRUE);
+            return NULL;
+        }
+    }
+
+    rule = rule_new(RULE_NETWORKS);
+    rule->data.networks = nodes;
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_ipv4_address (void)
+{
+    return rule_new(RULE_IPV4_ADDRESS);
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_local_address (void)
+{
+    return rule_new(RULE_LOCAL_ADDRESS);
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_unknown_address (void)
+{
+    return rule_new(RULE_UNKNOWN_ADDRESS);
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_macro (const gchar *name,
+                                         const gchar *value)
+{
+    MilterManagerConditionRule *rule;
+    gsize name_length;
+
+    rule = rule_new(RULE_MACRO);
+    name_length = strlen(name);
+    if (name_length > 2 && name[0] == '{' && name[name_length - 1] == '}')
+        rule->data.macro.name = g_strndup(name + 1, name_length - 2);
+    else
+        rule->data.macro.name = g_strdup(name);
+    rule->data.macro.value = g_strdup(value);
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_dnsbl (MilterManagerDNSBL *dnsbl)
+{
+    MilterManagerConditionRule *rule;
+
+    rule = rule_new(RULE_DNSBL);
+    rule->data.dnsbl = g_object_ref(dnsbl);
+
+    return rule;
+}
+
+static MilterManagerConditionRule *
+rule_new_pair (RuleType type,
+               MilterManagerConditionRule *left,
+               MilterManagerConditionRule *right)
+{
+    MilterManagerConditionRule *rule;
+
+    rule = rule_new(type);
+    rule->data.pair.left = milter_manager_condition_rule_ref(left);
+    rule->data.pair.right = milter_manager_condition_rule_ref(right);
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_and (MilterManagerConditionRule *left,
+                                       MilterManagerConditionRule *right)
+{
+    return rule_new_pair(RULE_AND, left, right);
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_or (MilterManagerConditionRule *left,
+                                      MilterManagerConditionRule *right)
+{
+    return rule_new_pair(RULE_OR, left, right);
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_new_not (MilterManagerConditionRule *operand)
+{
+    MilterManagerConditionRule *rule;
+
+    rule = rule_new(RULE_NOT);
+    rule->data.operand = milter_manager_condition_rule_ref(operand);
+
+    return rule;
+}
+
+MilterManagerConditionRule *
+milter_manager_condition_rule_ref (MilterManagerConditionRule *rule)
+{
+    g_atomic_int_inc(&(rule->ref_count));
+    return rule;
+}
+
+void
+milter_manager_condition_rule_unref (MilterManagerConditionRule *rule)
+{
+    if (!g_atomic_int_dec_and_test(&(rule->ref_count)))
+        return;
+
+    switch (rule->type) {
+    case RULE_STRINGS:
+        g_hash_table_unref(rule->data.strings);
+        break;
+    case RULE_REGEXPS:
+        g_regex_unref(rule->data.regex);
+        break;
+    case RULE_NETWORKS:
+        g_array_free(rule->data.networks, TRUE);
+        break;
+    case RULE_MACRO:
+        g_free(rule->data.macro.name);
+        g_free(rule->data.macro.value);
+        break;
+    case RULE_DNSBL:
+        g_object_unref(rule->data.dnsbl);
+        break;
+    case RULE_AND:
+    case RULE_OR:
+        milter_manager_condition_rule_unref(rule->data.pair.left);
+        milter_manager_condition_rule_unref(rule->data.pair.right);
+        break;
+    case RULE_NOT:
+        milter_manager_condition_rule_unref(rule->data.operand);
+        break;
+    default:
+        break;
+    }
+
+    g_free(rule);
+}
+
+static sa_family_t
+input_family (RuleInput *input)
+{
+    if (!input->address ||
+        input->address_length < sizeof(input->address->sa_family))
+        return AF_UNSPEC;
+
+    return input->address->sa_family;
+}
+
+static gboolean
+match_networks (GArray *nodes, RuleInput *input)
+{
+    switch (input_family(input)) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+
+        address_inet = (const struct sockaddr_in *)(input->address);
+        return network_include(nodes, NETWORK_IPV4_ROOT,
+                               (const guint8 *)&(address_inet->sin_addr),
+                               32);
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+
+        address_inet6 = (const struct sockaddr_in6 *)(input->address);
+        return network_include(nodes, NETWORK_IPV6_ROOT,
+                               (const guint8 *)&(address_inet6->sin6_addr),
+                               128);
+    }
+    default:
+        return FALSE;
+    }
+}
+
+static gboolean
+match_local_address (RuleInput *input)
+{
+    switch (input_family(input)) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+        guint32 address;
+
+        address_inet = (const struct sockaddr_in *)(input->address);
+        address = g_ntohl(address_inet->sin_addr.s_addr);
+        return ((address & 0xff000000) == 0x7f000000 ||
+                (address & 0xff000000) == 0x0a000000 ||
+                (address & 0xfff00000) == 0xac100000 ||
+                (address & 0xffff0000) == 0xc0a80000);
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+        const struct in6_addr *address;
+
+        address_inet6 = (const struct sockaddr_in6 *)(input->address);
+        address = &(address_inet6->sin6_addr);
+        return IN6_IS_ADDR_LOOPBACK(address) || IN6_IS_ADDR_LINKLOCAL(address);
+    }
+    case AF_UNIX:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static gboolean
+match_macro (MilterManagerConditionRule *rule, RuleInput *input)
+{
+    const gchar *value;
+
+    if (!input->macros && input->agent)
+        input->macros = milter_protocol_agent_get_available_macros(input->agent);
+    if (!input->macros)
+        return FALSE;
+
+    value = g_hash_table_lookup(input->macros, rule->data.macro.name);
+    if (!value)
+        return FALSE;
+    if (!rule->data.macro.value)
+        return TRUE;
+    return strcmp(value, rule->data.macro.value) == 0;
+}
+
+static gboolean
+rule_match (MilterManagerConditionRule *rule, RuleInput *input)
+{
+    switch (rule->type) {
+    case RULE_STRINGS:
+        return input->value &&
+            g_hash_table_contains(rule->data.strings, input->value);
+    case RULE_REGEXPS:
+        return input->value &&
+            g_regex_match(rule->data.regex, input->value, 0, NULL);
+    case RULE_NETWORKS:
+        return match_networks(rule->data.networks, input);
+    case RULE_IPV4_ADDRESS:
+        return input_family(input) == AF_INET;
+    case RULE_LOCAL_ADDRESS:
+        return match_local_address(input);
+    case RULE_UNKNOWN_ADDRESS:
+        switch (input_family(input)) {
+        case AF_INET:
+        case AF_INET6:
+        case AF_UNIX:
+            return FALSE;
+        default:
+            return TRUE;
+        }
+    case RULE_MACRO:
+        return match_macro(rule, input);
+    case RULE_DNSBL:
+        return milter_manager_dnsbl_is_listed(rule->data.dnsbl,
+                                              input->address,
+                                              input->address_length);
+    case RULE_AND:
+        return rule_match(rule->data.pair.left, input) &&
+            rule_match(rule->data.pair.right, input);
+    case RULE_OR:
+        return rule_match(rule->data.pair.left, input) ||
+            rule_match(rule->data.pair.right, input);
+    case RULE_NOT:
+        return !rule_match(rule->data.operand, input);
+    default:
+        return FALSE;
+    }
+}
+
+gboolean
+milter_manager_condition_rule_match (MilterManagerConditionRule *rule,
+                                     const gchar *value,
+                                     const struct sockaddr *address,
+                                     socklen_t    address_length,
+                                     GHashTable  *macros)
+{
+    RuleInput input;
+
+    input.value = value;
+    input.address = address;
+    input.address_length = address_length;
+    input.macros = macros;
+    input.agent = NULL;
+
+    return rule_match(rule, &input);
+}
+
 MilterManagerApplicableCondition *
 milter_manager_applicable_condition_new (const gchar *name)
 {
@@ -284,6 +879,165 @@ milter_manager_applicable_condition_merge (MilterManagerApplicableCondition *con
         milter_manager_applicable_condition_set_data(condition, data);
 }
 
+static MilterManagerConditionRule **
+stopper_rule_location (MilterManagerApplicableConditionPrivate *priv,
+                       MilterServerContextState state)
+{
+    switch (state) {
+    case MILTER_SERVER_CONTEXT_STATE_CONNECT:
+        return &(priv->connect_rule);
+    case MILTER_SERVER_CONTEXT_STATE_HELO:
+        return &(priv->helo_rule);
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
+        return &(priv->envelope_from_rule);
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
+        return &(priv->envelope_recipient_rule);
+    default:
+        return NULL;
+    }
+}
+
+void
+milter_manager_applicable_condition_set_stopper_rule (MilterManagerApplicableCondition *condition,
+                                                      MilterServerContextState          state,
+                                                      MilterManagerConditionRule       *rule)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    MilterManagerConditionRule **location;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    location = stopper_rule_location(priv, state);
+    if (!location) {
+        gchar *state_name;
+
+        state_name = milter_utils_get_enum_nick_name(
+            MILTER_TYPE_SERVER_CONTEXT_STATE, state);
+        milter_error("[applicable-condition][rule][error] "
+                     "unsupported state: <%s>: <%s>",
+                     priv->name, state_name);
+        g_free(state_name);
+        return;
+    }
+
+    if (*location)
+        milter_manager_condition_rule_unref(*location);
+    *location = rule ? milter_manager_condition_rule_ref(rule) : NULL;
+}
+
+MilterManagerConditionRule *
+milter_manager_applicable_condition_get_stopper_rule (MilterManagerApplicableCondition *condition,
+                                                      MilterServerContextState          state)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+    MilterManagerConditionRule **location;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    location = stopper_rule_location(priv, state);
+    if (!location)
+        return NULL;
+    return *location;
+}
+
+static gboolean
+stop_by_rule (MilterManagerChild *child,
+              MilterManagerConditionRule *rule,
+              const gchar *value,
+              const struct sockaddr *address,
+              socklen_t address_length)
+{
+    RuleInput input;
+
+    input.value = value;
+    input.address = address;
+    input.address_length = address_length;
+    input.macros = NULL;
+    input.agent = MILTER_PROTOCOL_AGENT(child);
+
+    return rule_match(rule, &input);
+}
+
+static gboolean
+cb_stop_on_connect (MilterServerContext *context,
+                    const gchar *host_name,
+                    const struct sockaddr *address,
+                    socklen_t address_length,
+                    gpointer user_data)
+{
+    return stop_by_rule(MILTER_MANAGER_CHILD(context), user_data,
+                        host_name, address, address_length);
+}
+
+static gboolean
+cb_stop_on_string (MilterServerContext *context,
+                   const gchar *value,
+                   gpointer user_data)
+{
+    return stop_by_rule(MILTER_MANAGER_CHILD(context), user_data,
+                        value, NULL, 0);
+}
+
+static void
+connect_stopper_rule (MilterManagerChild *child,
+                      const gchar *signal_name,
+                      GCallback callback,
+                      MilterManagerConditionRule *rule)
+{
+    if (!rule)
+        return;
+
+    g_signal_connect_data(child, signal_name, callback,
+                          milter_manager_condition_rule_ref(rule),
+                          (GClosureNotify)milter_manager_condition_rule_unref,
+                          0);
+}
+
+/* DNSBL results are available only after children finish the
+ * checks started on connect. */
+static void
+add_dnsbls (MilterManagerConditionRule *rule, MilterManagerChildren *children)
+{
+    switch (rule->type) {
+    case RULE_DNSBL:
+        milter_manager_children_add_dnsbl(children, rule->data.dnsbl);
+        break;
+    case RULE_AND:
+    case RULE_OR:
+        add_dnsbls(rule->data.pair.left, children);
+        add_dnsbls(rule->data.pair.right, children);
+        break;
+    case RULE_NOT:
+        add_dnsbls(rule->data.operand, children);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+attach_to (MilterManagerApplicableCondition *condition,
+           MilterManagerChild               *child,
+           MilterManagerChildren            *children,
+           MilterClientContext              *context)
+{
+    MilterManagerApplicableConditionPrivate *priv;
+
+    priv = MILTER_MANAGER_APPLICABLE_CONDITION_GET_PRIVATE(condition);
+    if (priv->connect_rule && children)
+        add_dnsbls(priv->connect_rule, children);
+    connect_stopper_rule(child, "stop-on-connect",
+                         G_CALLBACK(cb_stop_on_connect),
+                         priv->connect_rule);
+    connect_stopper_rule(child, "stop-on-helo",
+                         G_CALLBACK(cb_stop_on_string),
+                         priv->helo_rule);
+    connect_stopper_rule(child, "stop-on-envelope-from",
+                         G_CALLBACK(cb_stop_on_string),
+                         priv->envelope_from_rule);
+    connect_stopper_rule(child, "stop-on-envelope-recipient",
+                         G_CALLBACK(cb_stop_on_string),
+                         priv->envelope_recipient_rule);
+}
+
 void
 milter_manager_applicable_condition_attach_to (MilterManagerApplicableCondition *condition,
                                                MilterManagerChild               *child,
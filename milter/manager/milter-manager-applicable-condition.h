@@ -27,6 +27,7 @@
 #include <milter/manager/milter-manager-objects.h>
 #include <milter/manager/milter-manager-child.h>
 #include <milter/manager/milter-manager-children.h>
+#include <milter/manager/milter-manager-dnsbl.h>
 
 G_BEGIN_DECLS
 
@@ -37,6 +38,17 @@ G_BEGIN_DECLS
 #define MILTER_MANAGER_IS_APPLICABLE_CONDITION_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION))
 #define MILTER_MANAGER_APPLICABLE_CONDITION_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_APPLICABLE_CONDITION, MilterManagerApplicableConditionClass))
 
+#define MILTER_TYPE_MANAGER_CONDITION_RULE  (milter_manager_condition_rule_get_type())
+#define MILTER_MANAGER_CONDITION_RULE_ERROR (milter_manager_condition_rule_error_quark())
+
+typedef enum
+{
+    MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_REGEXP,
+    MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_NETWORK
+} MilterManagerConditionRuleError;
+
+typedef struct _MilterManagerConditionRule MilterManagerConditionRule;
+
 typedef struct _MilterManagerApplicableConditionClass    MilterManagerApplicableConditionClass;
 
 struct _MilterManagerApplicableCondition
@@ -54,6 +66,48 @@ struct _MilterManagerApplicableConditionClass
                        MilterClientContext              *context);
 };
 
+GQuark       milter_manager_condition_rule_error_quark (void);
+
+GType        milter_manager_condition_rule_get_type (void) G_GNUC_CONST;
+
+MilterManagerConditionRule *milter_manager_condition_rule_new_strings
+                                   (const gchar * const *strings);
+MilterManagerConditionRule *milter_manager_condition_rule_new_regexps
+                                   (const gchar * const *patterns,
+                                    GError     **error);
+MilterManagerConditionRule *milter_manager_condition_rule_new_networks
+                                   (const gchar * const *networks,
+                                    GError     **error);
+MilterManagerConditionRule *milter_manager_condition_rule_new_ipv4_address
+                                   (void);
+MilterManagerConditionRule *milter_manager_condition_rule_new_local_address
+                                   (void);
+MilterManagerConditionRule *milter_manager_condition_rule_new_unknown_address
+                                   (void);
+MilterManagerConditionRule *milter_manager_condition_rule_new_macro
+                                   (const gchar *name,
+                                    const gchar *value);
+MilterManagerConditionRule *milter_manager_condition_rule_new_dnsbl
+                                   (MilterManagerDNSBL *dnsbl);
+MilterManagerConditionRule *milter_manager_condition_rule_new_and
+                                   (MilterManagerConditionRule *left,
+                                    MilterManagerConditionRule *right);
+MilterManagerConditionRule *milter_manager_condition_rule_new_or
+                                   (MilterManagerConditionRule *left,
+                                    MilterManagerConditionRule *right);
+MilterManagerConditionRule *milter_manager_condition_rule_new_not
+                                   (MilterManagerConditionRule *operand);
+MilterManagerConditionRule *milter_manager_condition_rule_ref
+                                   (MilterManagerConditionRule *rule);
+void         milter_manager_condition_rule_unref
+                                   (MilterManagerConditionRule *rule);
+gboolean     milter_manager_condition_rule_match
+                                   (MilterManagerConditionRule *rule,
+                                    const gchar *value,
+                                    const struct sockaddr *address,
+                                    socklen_t    address_length,
+                                    GHashTable  *macros);
+
 GType        milter_manager_applicable_condition_get_type (void) G_GNUC_CONST;
 
 MilterManagerApplicableCondition *milter_manager_applicable_condition_new
@@ -79,6 +133,14 @@ void         milter_manager_applicable_condition_merge
                                    (MilterManagerApplicableCondition *condition,
                                     MilterManagerApplicableCondition *other_condition);
 
+void         milter_manager_applicable_condition_set_stopper_rule
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterServerContextState          state,
+                                    MilterManagerConditionRule       *rule);
+MilterManagerConditionRule *milter_manager_applicable_condition_get_stopper_rule
+                                   (MilterManagerApplicableCondition *condition,
+                                    MilterServerContextState          state);
+
 void         milter_manager_applicable_condition_attach_to
                                    (MilterManagerApplicableCondition *condition,
                                     MilterManagerChild               *child,
@@ -0,0 +1,547 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* memfd_create() is a GNU extension. It must be enabled
+ * before any system header is included. */
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#ifdef HAVE_MEMFD_CREATE
+#  include <sys/mman.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include <milter/core.h>
+#include "milter-manager-body-spool.h"
+
+#define MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(obj)              \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_MANAGER_BODY_SPOOL, \
+                                 MilterManagerBodySpoolPrivate))
+
+typedef struct _MilterManagerBodySpoolPrivate MilterManagerBodySpoolPrivate;
+struct _MilterManagerBodySpoolPrivate
+{
+    gsize max_on_memory_size;
+    gboolean use_memfd;
+    GString *memory;
+    gint fd;
+    gsize size;
+    GMappedFile *mapped_file;
+    guint64 n_spooled_bytes;
+    guint64 n_read_bytes;
+    /* Protected by on_memory_mutex. */
+    GList *on_memory_node;
+    gsize on_memory_size;
+    gint spill_requested;
+};
+
+enum
+{
+    PROP_0,
+    PROP_MAX_ON_MEMORY_SIZE,
+    PROP_USE_MEMFD
+};
+
+/* Bodies on memory of all sessions in the process. The
+ * largest ones are spilled when they exceed
+ * max_on_memory_total_size. */
+static GMutex on_memory_mutex;
+static GList *on_memory_spools = NULL;
+static gsize on_memory_total_size = 0;
+static gsize on_memory_spill_requested_size = 0;
+static gsize max_on_memory_total_size = 0;
+
+G_DEFINE_TYPE(MilterManagerBodySpool,
+              milter_manager_body_spool,
+              G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+static void set_property   (GObject         *object,
+                            guint            prop_id,
+                            const GValue    *value,
+                            GParamSpec      *pspec);
+static void get_property   (GObject         *object,
+                            guint            prop_id,
+                            GValue          *value,
+                            GParamSpec      *pspec);
+
+static void
+milter_manager_body_spool_class_init (MilterManagerBodySpoolClass *klass)
+{
+    GObjectClass *gobject_class;
+    GParamSpec *spec;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+    gobject_class->set_property = set_property;
+    gobject_class->get_property = get_property;
+
+    spec = g_param_spec_uint64("max-on-memory-size",
+                               "Max on memory size",
+                               "The max size of body kept on memory. "
+                               "Larger body is spooled to a file.",
+                               0,
+                               G_MAXUINT64,
+                               MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_MAX_ON_MEMORY_SIZE,
+                                    spec);
+
+    spec = g_param_spec_boolean("use-memfd",
+                                "Use memfd",
+                                "Whether body is spooled to an anonymous "
+                                "memory file instead of a temporary file",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_USE_MEMFD, spec);
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerBodySpoolPrivate));
+}
+
+static void
+milter_manager_body_spool_init (MilterManagerBodySpool *spool)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool);
+    priv->max_on_memory_size =
+        MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE;
+    priv->use_memfd = FALSE;
+    priv->memory = NULL;
+    priv->fd = -1;
+    priv->size = 0;
+    priv->mapped_file = NULL;
+    priv->n_spooled_bytes = 0;
+    priv->n_read_bytes = 0;
+    priv->on_memory_node = NULL;
+    priv->on_memory_size = 0;
+    priv->spill_requested = FALSE;
+}
+
+static void
+remove_on_memory (MilterManagerBodySpoolPrivate *priv)
+{
+    g_mutex_lock(&on_memory_mutex);
+    if (priv->on_memory_node) {
+        on_memory_spools = g_list_delete_link(on_memory_spools,
+                                              priv->on_memory_node);
+        priv->on_memory_node = NULL;
+        on_memory_total_size -= priv->on_memory_size;
+        if (g_atomic_int_get(&(priv->spill_requested)))
+            on_memory_spill_requested_size -= priv->on_memory_size;
+        priv->on_memory_size = 0;
+    }
+    g_mutex_unlock(&on_memory_mutex);
+}
+
+static void
+dispose_mapped_file (MilterManagerBodySpoolPrivate *priv)
+{
+    if (priv->mapped_file) {
+        g_mapped_file_unref(priv->mapped_file);
+        priv->mapped_file = NULL;
+    }
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(object);
+
+    dispose_mapped_file(priv);
+    remove_on_memory(priv);
+
+    if (priv->memory) {
+        g_string_free(priv->memory, TRUE);
+        priv->memory = NULL;
+    }
+
+    if (priv->fd != -1) {
+        close(priv->fd);
+        priv->fd = -1;
+    }
+
+    G_OBJECT_CLASS(milter_manager_body_spool_parent_class)->dispose(object);
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    MilterManagerBodySpool *spool;
+
+    spool = MILTER_MANAGER_BODY_SPOOL(object);
+    switch (prop_id) {
+    case PROP_MAX_ON_MEMORY_SIZE:
+        milter_manager_body_spool_set_max_on_memory_size(
+            spool, g_value_get_uint64(value));
+        break;
+    case PROP_USE_MEMFD:
+        milter_manager_body_spool_set_use_memfd(spool,
+                                                g_value_get_boolean(value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+get_property (GObject    *object,
+              guint       prop_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(object);
+    switch (prop_id) {
+    case PROP_MAX_ON_MEMORY_SIZE:
+        g_value_set_uint64(value, priv->max_on_memory_size);
+        break;
+    case PROP_USE_MEMFD:
+        g_value_set_boolean(value, priv->use_memfd);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+MilterManagerBodySpool *
+milter_manager_body_spool_new (gsize max_on_memory_size)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_BODY_SPOOL,
+                        "max-on-memory-size", (guint64)max_on_memory_size,
+                        NULL);
+}
+
+gsize
+milter_manager_body_spool_get_max_on_memory_size (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->max_on_memory_size;
+}
+
+void
+milter_manager_body_spool_set_max_on_memory_size (MilterManagerBodySpool *spool,
+                                                  gsize                   size)
+{
+    MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->max_on_memory_size = size;
+}
+
+gboolean
+milter_manager_body_spool_get_use_memfd (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->use_memfd;
+}
+
+void
+milter_manager_body_spool_set_use_memfd (MilterManagerBodySpool *spool,
+                                         gboolean                use_memfd)
+{
+    MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->use_memfd = use_memfd;
+}
+
+gsize
+milter_manager_body_spool_get_max_on_memory_total_size (void)
+{
+    gsize size;
+
+    g_mutex_lock(&on_memory_mutex);
+    size = max_on_memory_total_size;
+    g_mutex_unlock(&on_memory_mutex);
+
+    return size;
+}
+
+void
+milter_manager_body_spool_set_max_on_memory_total_size (gsize size)
+{
+    g_mutex_lock(&on_memory_mutex);
+    max_on_memory_total_size = size;
+    g_mutex_unlock(&on_memory_mutex);
+}
+
+gsize
+milter_manager_body_spool_get_on_memory_total_size (void)
+{
+    gsize size;
+
+    g_mutex_lock(&on_memory_mutex);
+    size = on_memory_total_size;
+    g_mutex_unlock(&on_memory_mutex);
+
+    return size;
+}
+
+static gboolean
+write_to_file (MilterManagerBodySpoolPrivate *priv,
+               const gchar *chunk,
+               gsize size,
+               GError **error)
+{
+    while (size > 0) {
+        gssize written_size;
+
+        written_size = write(priv->fd, chunk, size);
+        if (written_size == -1) {
+            gint saved_errno = errno;
+
+            if (saved_errno == EINTR)
+                continue;
+
+            g_set_error(error,
+                        G_FILE_ERROR,
+                        g_file_error_from_errno(saved_errno),
+                        "failed to write body to spool file: %s",
+                        g_strerror(saved_errno));
+            return FALSE;
+        }
+        chunk += written_size;
+        size -= written_size;
+        priv->n_spooled_bytes += written_size;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+open_spool_file (MilterManagerBodySpoolPrivate *priv, GError **error)
+{
+    gchar *file_name = NULL;
+
+#ifdef HAVE_MEMFD_CREATE
+    if (priv->use_memfd) {
+        priv->fd = memfd_create("milter-manager-body", MFD_CLOEXEC);
+        if (priv->fd != -1) {
+            milter_debug("[body-spool][spool][memfd] size=%" G_GSIZE_FORMAT,
+                         priv->memory->len);
+            return TRUE;
+        }
+        milter_warning("[body-spool][spool][memfd][error] "
+                       "fall back to temporary file: %s",
+                       g_strerror(errno));
+    }
+#endif
+
+    priv->fd = g_file_open_tmp(NULL, &file_name, error);
+    if (priv->fd == -1)
+        return FALSE;
+
+    milter_debug("[body-spool][spool] <%s> size=%" G_GSIZE_FORMAT,
+                 file_name, priv->memory->len);
+    /* Only the descriptor is needed. The file disappears with it. */
+    g_unlink(file_name);
+    g_free(file_name);
+
+    return TRUE;
+}
+
+static gboolean
+spool_to_file (MilterManagerBodySpoolPrivate *priv, GError **error)
+{
+    gboolean success;
+
+    remove_on_memory(priv);
+    if (!open_spool_file(priv, error))
+        return FALSE;
+
+    success = write_to_file(priv, priv->memory->str, priv->memory->len, error);
+    g_string_free(priv->memory, TRUE);
+    priv->memory = NULL;
+
+    return success;
+}
+
+/* Must be called with on_memory_mutex locked. */
+static void
+request_spill (void)
+{
+    while (on_memory_total_size - on_memory_spill_requested_size >
+           max_on_memory_total_size) {
+        MilterManagerBodySpoolPrivate *largest = NULL;
+        GList *node;
+
+        for (node = on_memory_spools; node; node = g_list_next(node)) {
+            MilterManagerBodySpoolPrivate *priv = node->data;
+
+            if (g_atomic_int_get(&(priv->spill_requested)))
+                continue;
+            if (!largest || priv->on_memory_size > largest->on_memory_size)
+                largest = priv;
+        }
+        if (!largest)
+            break;
+
+        milter_debug("[body-spool][spill][request] "
+                     "size=%" G_GSIZE_FORMAT " "
+                     "total=%" G_GSIZE_FORMAT " "
+                     "max=%" G_GSIZE_FORMAT,
+                     largest->on_memory_size,
+                     on_memory_total_size,
+                     max_on_memory_total_size);
+        g_atomic_int_set(&(largest->spill_requested), TRUE);
+        on_memory_spill_requested_size += largest->on_memory_size;
+    }
+}
+
+/* Returns TRUE if the body should be spilled now. A body
+ * of other session is spilled by its own session on the
+ * next access because it may be used in other thread. */
+static gboolean
+update_on_memory (MilterManagerBodySpoolPrivate *priv)
+{
+    gboolean spill_requested;
+
+    g_mutex_lock(&on_memory_mutex);
+    if (!priv->on_memory_node) {
+        on_memory_spools = g_list_prepend(on_memory_spools, priv);
+        priv->on_memory_node = on_memory_spools;
+    }
+    on_memory_total_size += priv->memory->len - priv->on_memory_size;
+    if (g_atomic_int_get(&(priv->spill_requested)))
+        on_memory_spill_requested_size +=
+            priv->memory->len - priv->on_memory_size;
+    priv->on_memory_size = priv->memory->len;
+    if (max_on_memory_total_size > 0)
+        request_spill();
+    spill_requested = g_atomic_int_get(&(priv->spill_requested));
+    g_mutex_unlock(&on_memory_mutex);
+
+    return spill_requested;
+}
+
+gboolean
+milter_manager_body_spool_append (MilterManagerBodySpool *spool,
+                                  const gchar            *chunk,
+                                  gsize                   size,
+                                  GError                **error)
+{
+    MilterManagerBodySpoolPrivate *priv;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool);
+
+    if (!chunk || size == 0)
+        return TRUE;
+
+    priv->size += size;
+
+    if (priv->fd != -1) {
+        dispose_mapped_file(priv);
+        return write_to_file(priv, chunk, size, error);
+    }
+
+    if (!priv->memory)
+        priv->memory = g_string_new_len(chunk, size);
+    else
+        g_string_append_len(priv->memory, chunk, size);
+
+    if (priv->memory->len > priv->max_on_memory_size)
+        return spool_to_file(priv, error);
+
+    if (update_on_memory(priv))
+        return spool_to_file(priv, error);
+
+    return TRUE;
+}
+
+const gchar *
+milter_manager_body_spool_get_chunk (MilterManagerBodySpool *spool,
+                                     gsize                   offset,
+                                     gsize                   max_size,
+                                     gsize                  *chunk_size,
+                                     GError                **error)
+{
+    MilterManagerBodySpoolPrivate *priv;
+    const gchar *contents;
+
+    priv = MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool);
+
+    *chunk_size = 0;
+    if (offset >= priv->size)
+        return NULL;
+
+    if (priv->fd == -1 && g_atomic_int_get(&(priv->spill_requested))) {
+        if (!spool_to_file(priv, error))
+            return NULL;
+    }
+
+    if (priv->fd == -1) {
+        contents = priv->memory->str;
+    } else {
+        if (!priv->mapped_file) {
+            priv->mapped_file = g_mapped_file_new_from_fd(priv->fd,
+                                                          FALSE,
+                                                          error);
+            if (!priv->mapped_file)
+                return NULL;
+        }
+        contents = g_mapped_file_get_contents(priv->mapped_file);
+    }
+
+    *chunk_size = MIN(priv->size - offset, max_size);
+    priv->n_read_bytes += *chunk_size;
+
+    return contents + offset;
+}
+
+gsize
+milter_manager_body_spool_get_size (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->size;
+}
+
+gboolean
+milter_manager_body_spool_is_spooled (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->fd != -1;
+}
+
+guint64
+milter_manager_body_spool_get_n_spooled_bytes (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->n_spooled_bytes;
+}
+
+guint64
+milter_manager_body_spool_get_n_read_bytes (MilterManagerBodySpool *spool)
+{
+    return MILTER_MANAGER_BODY_SPOOL_GET_PRIVATE(spool)->n_read_bytes;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,99 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_BODY_SPOOL_H__
+#define __MILTER_MANAGER_BODY_SPOOL_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE 5242880 /* 5Mbyte */
+
+#define MILTER_TYPE_MANAGER_BODY_SPOOL            (milter_manager_body_spool_get_type())
+#define MILTER_MANAGER_BODY_SPOOL(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpool))
+#define MILTER_MANAGER_BODY_SPOOL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpoolClass))
+#define MILTER_MANAGER_IS_BODY_SPOOL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_BODY_SPOOL))
+#define MILTER_MANAGER_IS_BODY_SPOOL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_BODY_SPOOL))
+#define MILTER_MANAGER_BODY_SPOOL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_BODY_SPOOL, MilterManagerBodySpoolClass))
+
+typedef struct _MilterManagerBodySpool         MilterManagerBodySpool;
+typedef struct _MilterManagerBodySpoolClass    MilterManagerBodySpoolClass;
+
+struct _MilterManagerBodySpool
+{
+    GObject object;
+};
+
+struct _MilterManagerBodySpoolClass
+{
+    GObjectClass parent_class;
+};
+
+GType        milter_manager_body_spool_get_type (void) G_GNUC_CONST;
+
+MilterManagerBodySpool *milter_manager_body_spool_new
+                                   (gsize max_on_memory_size);
+
+gsize        milter_manager_body_spool_get_max_on_memory_size
+                                   (MilterManagerBodySpool *spool);
+void         milter_manager_body_spool_set_max_on_memory_size
+                                   (MilterManagerBodySpool *spool,
+                                    gsize                   size);
+gboolean     milter_manager_body_spool_get_use_memfd
+                                   (MilterManagerBodySpool *spool);
+void         milter_manager_body_spool_set_use_memfd
+                                   (MilterManagerBodySpool *spool,
+                                    gboolean                use_memfd);
+
+gsize        milter_manager_body_spool_get_max_on_memory_total_size
+                                   (void);
+void         milter_manager_body_spool_set_max_on_memory_total_size
+                                   (gsize                   size);
+gsize        milter_manager_body_spool_get_on_memory_total_size
+                                   (void);
+
+gboolean     milter_manager_body_spool_append
+                                   (MilterManagerBodySpool *spool,
+                                    const gchar            *chunk,
+                                    gsize                   size,
+                                    GError                **error);
+const gchar *milter_manager_body_spool_get_chunk
+                                   (MilterManagerBodySpool *spool,
+                                    gsize                   offset,
+                                    gsize                   max_size,
+                                    gsize                  *chunk_size,
+                                    GError                **error);
+
+gsize        milter_manager_body_spool_get_size
+                                   (MilterManagerBodySpool *spool);
+gboolean     milter_manager_body_spool_is_spooled
+                                   (MilterManagerBodySpool *spool);
+guint64      milter_manager_body_spool_get_n_spooled_bytes
+                                   (MilterManagerBodySpool *spool);
+guint64      milter_manager_body_spool_get_n_read_bytes
+                                   (MilterManagerBodySpool *spool);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_BODY_SPOOL_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
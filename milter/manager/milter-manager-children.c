@@ -21,16 +21,18 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <string.h>
+
 #include "milter-manager-children.h"
 
-#include <glib/gstdio.h>
 #include "milter-manager-configuration.h"
 #include "milter/core.h"
 #include "milter-manager-launch-command-encoder.h"
-
-#define MAX_ON_MEMORY_BODY_SIZE 5242880 /* 5Mbyte */
+#include "milter-manager-body-spool.h"
+#include "milter-manager-metrics.h"
 
 #define MAX_SUPPORTED_MILTER_PROTOCOL_VERSION 6
+#define MAX_STREAM_BODY_SIZE (1024 * 1024)
 
 #define MILTER_MANAGER_CHILDREN_GET_PRIVATE(obj)                    \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                             \
@@ -68,7 +70,9 @@ struct _MilterManagerChildrenPrivate
     GHashTable *try_negotiate_ids;
     MilterManagerConfiguration *configuration;
     MilterMacrosRequests *macros_requests;
+    MilterMacrosPacketCache *macros_packet_cache;
     MilterOption *option;
+    MilterOption *offered_option;
     MilterStepFlags initial_yes_steps;
     MilterStepFlags requested_yes_steps;
     gboolean negotiated;
@@ -86,18 +90,17 @@ struct _MilterManagerChildrenPrivate
     MilterHeaders *original_headers;
     MilterHeaders *headers;
     gint processing_header_index;
-    GString *body;
-    GIOChannel *body_file;
-    gchar *body_file_name;
+    MilterManagerBodySpool *body_spool;
     gchar *end_of_message_chunk;
     gsize end_of_message_size;
     guint sending_body;
-    guint sent_body_offset;
+    gsize sent_body_offset;
     gboolean replaced_body_for_each_child;
     gboolean replaced_body;
     gchar *change_from;
     gchar *change_from_parameters;
     gchar *quarantine_reason;
+    MilterServerContext *streaming_child;
     MilterWriter *launcher_writer;
     MilterReader *launcher_reader;
 
@@ -109,6 +112,30 @@ struct _MilterManagerChildrenPrivate
     MilterEventLoop *event_loop;
 
     guint lazy_reply_negotiate_id;
+
+    MilterManagerMetrics *metrics;
+    GHashTable *metrics_open_children;
+    GHashTable *metrics_in_flight_commands;
+    gsize metrics_buffered_body_size;
+
+    GList *dnsbls;
+    GList *dnsbl_checks;
+    gchar *dnsbl_host_name;
+};
+
+typedef struct _InFlightCommand InFlightCommand;
+struct _InFlightCommand
+{
+    gchar *name;
+    MilterServerContextState state;
+    gint64 started_time;
+};
+
+typedef struct _DNSBLCheck DNSBLCheck;
+struct _DNSBLCheck
+{
+    MilterManagerDNSBL *dnsbl;
+    guint id;
 };
 
 typedef struct _NegotiateData NegotiateData;
@@ -121,6 +148,13 @@ struct _NegotiateData
     gulong ready_signal_id;
     gulong connection_timeout_signal_id;
     gboolean is_retry;
+    GIOChannel *pooled_channel;
+    MilterOption *negotiate_reply_option;
+    MilterMacrosRequests *macros_requests;
+    MilterManagerEgg *egg;
+    MilterEventLoop *alive_event_loop;
+    guint alive_waiter_id;
+    MilterManagerMetrics *alive_metrics;
 };
 
 typedef struct _NegotiateTimeoutID NegotiateTimeoutID;
@@ -251,6 +285,13 @@ milter_manager_children_class_init (MilterManagerChildrenClass *klass)
                              sizeof(MilterManagerChildrenPrivate));
 }
 
+static void
+in_flight_command_free (InFlightCommand *command)
+{
+    g_free(command->name);
+    g_free(command);
+}
+
 static void
 milter_manager_children_init (MilterManagerChildren *milter)
 {
@@ -268,7 +309,9 @@ milter_manager_children_init (MilterManagerChildren *milter)
                               negotiate_timeout_id_hash_value_free);
     priv->milters = NULL;
     priv->macros_requests = milter_macros_requests_new();
+    priv->macros_packet_cache = milter_macros_packet_cache_new();
     priv->option = NULL;
+    priv->offered_option = NULL;
     priv->initial_yes_steps = MILTER_STEP_NONE;
     priv->requested_yes_steps = MILTER_STEP_NONE;
     priv->negotiated = FALSE;
@@ -280,9 +323,7 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->original_headers = NULL;
     priv->headers = NULL;
     priv->processing_header_index = 0;
-    priv->body = NULL;
-    priv->body_file = NULL;
-    priv->body_file_name = NULL;
+    priv->body_spool = NULL;
     priv->end_of_message_chunk = NULL;
     priv->end_of_message_size = 0;
     priv->sending_body = FALSE;
@@ -312,6 +353,41 @@ milter_manager_children_init (MilterManagerChildren *milter)
     priv->event_loop = NULL;
 
     priv->lazy_reply_negotiate_id = 0;
+
+    priv->metrics = NULL;
+    priv->metrics_open_children = g_hash_table_new(g_direct_hash,
+                                                   g_direct_equal);
+    priv->metrics_in_flight_commands =
+        g_hash_table_new_full(g_direct_hash,
+                              g_direct_equal,
+                              NULL,
+                              (GDestroyNotify)in_flight_command_free);
+    priv->metrics_buffered_body_size = 0;
+
+    priv->dnsbls = NULL;
+    priv->dnsbl_checks = NULL;
+    priv->dnsbl_host_name = NULL;
+
+    priv->streaming_child = NULL;
+}
+
+static void
+dispose_dnsbl_checks (MilterManagerChildrenPrivate *priv)
+{
+    while (priv->dnsbl_checks) {
+        DNSBLCheck *check = priv->dnsbl_checks->data;
+
+        milter_manager_dnsbl_cancel(check->dnsbl, check->id);
+        g_object_unref(check->dnsbl);
+        g_free(check);
+        priv->dnsbl_checks = g_list_delete_link(priv->dnsbl_checks,
+                                                priv->dnsbl_checks);
+    }
+
+    if (priv->dnsbl_host_name) {
+        g_free(priv->dnsbl_host_name);
+        priv->dnsbl_host_name = NULL;
+    }
 }
 
 static void
@@ -325,25 +401,54 @@ dispose_lazy_reply_negotiate_id (MilterManagerChildrenPrivate *priv)
     priv->lazy_reply_negotiate_id = 0;
 }
 
+/* Arguments are stored in the same memory block as the
+ * request. A request costs only one allocation. */
 static PendingMessageRequest *
-pending_message_request_new (MilterCommand command)
+pending_message_request_new (MilterCommand command, gsize arguments_size)
 {
     PendingMessageRequest *request;
 
-    request = g_new0(PendingMessageRequest, 1);
+    request = g_malloc0(sizeof(PendingMessageRequest) + arguments_size);
     request->command = command;
 
     return request;
 }
 
+static gchar *
+pending_message_request_copy_argument (PendingMessageRequest *request,
+                                       gsize offset,
+                                       const gchar *argument,
+                                       gsize size)
+{
+    gchar *copied_argument;
+
+    copied_argument = (gchar *)(request + 1) + offset;
+    if (size > 0)
+        memcpy(copied_argument, argument, size);
+    copied_argument[size] = '\0';
+
+    return copied_argument;
+}
+
 static PendingMessageRequest *
 pending_header_request_new (const gchar *name, const gchar *value)
 {
     PendingMessageRequest *request;
-
-    request = pending_message_request_new(MILTER_COMMAND_HEADER);
-    request->arguments.header.name = g_strdup(name);
-    request->arguments.header.value = g_strdup(value);
+    gsize name_length, value_length;
+
+    name_length = name ? strlen(name) : 0;
+    value_length = value ? strlen(value) : 0;
+    request = pending_message_request_new(MILTER_COMMAND_HEADER,
+                                          name_length + 1 +
+                                          value_length + 1);
+    if (name)
+        request->arguments.header.name =
+            pending_message_request_copy_argument(request, 0,
+                                                  name, name_length);
+    if (value)
+        request->arguments.header.value =
+            pending_message_request_copy_argument(request, name_length + 1,
+                                                  value, value_length);
 
     return request;
 }
@@ -353,7 +458,7 @@ pending_end_of_header_request_new (void)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_END_OF_HEADER);
+    request = pending_message_request_new(MILTER_COMMAND_END_OF_HEADER, 0);
 
     return request;
 }
@@ -363,8 +468,10 @@ pending_body_request_new (const gchar *chunk, gsize size)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_BODY);
-    request->arguments.body.chunk = g_strndup(chunk, size);
+    request = pending_message_request_new(MILTER_COMMAND_BODY, size + 1);
+    if (chunk)
+        request->arguments.body.chunk =
+            pending_message_request_copy_argument(request, 0, chunk, size);
     request->arguments.body.size = size;
 
     return request;
@@ -375,8 +482,11 @@ pending_end_of_message_request_new (const gchar *chunk, gsize size)
 {
     PendingMessageRequest *request;
 
-    request = pending_message_request_new(MILTER_COMMAND_END_OF_MESSAGE);
-    request->arguments.end_of_message.chunk = g_strndup(chunk, size);
+    request = pending_message_request_new(MILTER_COMMAND_END_OF_MESSAGE,
+                                          size + 1);
+    if (chunk)
+        request->arguments.end_of_message.chunk =
+            pending_message_request_copy_argument(request, 0, chunk, size);
     request->arguments.end_of_message.size = size;
 
     return request;
@@ -385,20 +495,6 @@ pending_end_of_message_request_new (const gchar *chunk, gsize size)
 static void
 pending_message_request_free (PendingMessageRequest *request)
 {
-    switch (request->command) {
-    case MILTER_COMMAND_HEADER:
-        g_free(request->arguments.header.name);
-        g_free(request->arguments.header.value);
-        break;
-    case MILTER_COMMAND_BODY:
-        g_free(request->arguments.body.chunk);
-        break;
-    case MILTER_COMMAND_END_OF_MESSAGE:
-        g_free(request->arguments.end_of_message.chunk);
-        break;
-    default:
-        break;
-    }
     g_free(request);
 }
 
@@ -416,20 +512,36 @@ dispose_body_related_data (MilterManagerChildrenPrivate *priv)
 {
     priv->emitted_reply_for_message_oriented_command = FALSE;
 
-    if (priv->body) {
-        g_string_free(priv->body, TRUE);
-        priv->body = NULL;
-    }
-
-    if (priv->body_file) {
-        g_io_channel_unref(priv->body_file);
-        priv->body_file = NULL;
-    }
-
-    if (priv->body_file_name) {
-        g_unlink(priv->body_file_name);
-        g_free(priv->body_file_name);
-        priv->body_file_name = NULL;
+    if (priv->metrics_buffered_body_size > 0) {
+        if (priv->metrics)
+            milter_manager_metrics_add_buffered_body_bytes(
+                priv->metrics,
+                -(gint64)priv->metrics_buffered_body_size);
+        priv->metrics_buffered_body_size = 0;
+    }
+
+    if (priv->body_spool) {
+        if (milter_manager_body_spool_is_spooled(priv->body_spool)) {
+            if (priv->metrics) {
+                milter_manager_metrics_add_spooled_body_bytes(
+                    priv->metrics,
+                    milter_manager_body_spool_get_n_spooled_bytes(
+                        priv->body_spool));
+            }
+            milter_statistics("[body][spool](%u): "
+                              "size=%" G_GSIZE_FORMAT " "
+                              "spooled=%" G_GUINT64_FORMAT " "
+                              "read=%" G_GUINT64_FORMAT,
+                              priv->tag,
+                              milter_manager_body_spool_get_size(
+                                  priv->body_spool),
+                              milter_manager_body_spool_get_n_spooled_bytes(
+                                  priv->body_spool),
+                              milter_manager_body_spool_get_n_read_bytes(
+                                  priv->body_spool));
+        }
+        g_object_unref(priv->body_spool);
+        priv->body_spool = NULL;
     }
 }
 
@@ -453,6 +565,7 @@ static void
 dispose_message_related_data (MilterManagerChildrenPrivate *priv)
 {
     dispose_pending_message_request(priv);
+    priv->streaming_child = NULL;
 
     if (priv->command_waiting_child_queue) {
         g_list_free(priv->command_waiting_child_queue);
@@ -507,6 +620,26 @@ dispose_smtp_client_address (MilterManagerChildrenPrivate *priv)
     priv->smtp_client_address_length = 0;
 }
 
+static void
+metrics_finish_all_commands (MilterManagerChildrenPrivate *priv)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    if (!priv->metrics)
+        return;
+
+    g_hash_table_iter_init(&iter, priv->metrics_in_flight_commands);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        InFlightCommand *command = value;
+
+        milter_manager_metrics_finish_command(priv->metrics,
+                                              command->name,
+                                              command->state,
+                                              command->started_time);
+    }
+}
+
 static void
 dispose (GObject *object)
 {
@@ -517,6 +650,13 @@ dispose (GObject *object)
     milter_debug("[%u] [children][dispose]", priv->tag);
 
     dispose_lazy_reply_negotiate_id(priv);
+    dispose_dnsbl_checks(priv);
+
+    if (priv->dnsbls) {
+        g_list_foreach(priv->dnsbls, (GFunc)g_object_unref, NULL);
+        g_list_free(priv->dnsbls);
+        priv->dnsbls = NULL;
+    }
 
     if (priv->reply_queue) {
         g_queue_free(priv->reply_queue);
@@ -548,11 +688,21 @@ dispose (GObject *object)
         priv->macros_requests = NULL;
     }
 
+    if (priv->macros_packet_cache) {
+        g_object_unref(priv->macros_packet_cache);
+        priv->macros_packet_cache = NULL;
+    }
+
     if (priv->option) {
         g_object_unref(priv->option);
         priv->option = NULL;
     }
 
+    if (priv->offered_option) {
+        g_object_unref(priv->offered_option);
+        priv->offered_option = NULL;
+    }
+
     if (priv->reply_statuses) {
         g_hash_table_unref(priv->reply_statuses);
         priv->reply_statuses = NULL;
@@ -569,6 +719,22 @@ dispose (GObject *object)
         priv->event_loop = NULL;
     }
 
+    if (priv->metrics_in_flight_commands) {
+        metrics_finish_all_commands(priv);
+        g_hash_table_unref(priv->metrics_in_flight_commands);
+        priv->metrics_in_flight_commands = NULL;
+    }
+
+    if (priv->metrics_open_children) {
+        g_hash_table_unref(priv->metrics_open_children);
+        priv->metrics_open_children = NULL;
+    }
+
+    if (priv->metrics) {
+        g_object_unref(priv->metrics);
+        priv->metrics = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_children_parent_class)->dispose(object);
 }
 
@@ -670,6 +836,8 @@ milter_manager_children_add_child (MilterManagerChildren *children,
 
     priv->milters = g_list_append(priv->milters, g_object_ref(child));
     milter_agent_set_event_loop(MILTER_AGENT(child), priv->event_loop);
+    milter_server_context_set_macros_packet_cache(MILTER_SERVER_CONTEXT(child),
+                                                  priv->macros_packet_cache);
 }
 
 guint
@@ -806,11 +974,217 @@ compile_reply_status (MilterManagerChildren *children,
     }
 }
 
+static void
+metrics_open_child (MilterManagerChildren *children,
+                    MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics || !priv->metrics_open_children)
+        return;
+
+    if (g_hash_table_lookup(priv->metrics_open_children, context))
+        return;
+
+    g_hash_table_insert(priv->metrics_open_children, context, context);
+    milter_manager_metrics_open_child(priv->metrics,
+                                      milter_server_context_get_name(context));
+}
+
+static void
+metrics_finish_command (MilterManagerChildren *children,
+                        MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    InFlightCommand *command;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics || !priv->metrics_in_flight_commands)
+        return;
+
+    command = g_hash_table_lookup(priv->metrics_in_flight_commands, context);
+    if (!command)
+        return;
+
+    milter_manager_metrics_finish_command(priv->metrics,
+                                          command->name,
+                                          command->state,
+                                          command->started_time);
+    g_hash_table_remove(priv->metrics_in_flight_commands, context);
+}
+
+static void
+metrics_start_command (MilterManagerChildren *children,
+                       MilterServerContext *context,
+                       MilterServerContextState state)
+{
+    MilterManagerChildrenPrivate *priv;
+    InFlightCommand *command;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics || !priv->metrics_in_flight_commands)
+        return;
+
+    switch (state) {
+    case MILTER_SERVER_CONTEXT_STATE_NEGOTIATE:
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
+        break;
+    case MILTER_SERVER_CONTEXT_STATE_CONNECT:
+    case MILTER_SERVER_CONTEXT_STATE_HELO:
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
+    case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
+    case MILTER_SERVER_CONTEXT_STATE_DATA:
+    case MILTER_SERVER_CONTEXT_STATE_UNKNOWN:
+    case MILTER_SERVER_CONTEXT_STATE_HEADER:
+    case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
+    case MILTER_SERVER_CONTEXT_STATE_BODY:
+        if (!milter_server_context_need_reply(context, state))
+            return;
+        break;
+    default:
+        return;
+    }
+
+    metrics_finish_command(children, context);
+
+    command = g_new(InFlightCommand, 1);
+    command->name = g_strdup(milter_server_context_get_name(context));
+    command->state = state;
+    command->started_time = g_get_monotonic_time();
+    g_hash_table_insert(priv->metrics_in_flight_commands, context, command);
+    milter_manager_metrics_start_command(priv->metrics,
+                                         command->name,
+                                         command->state,
+                                         command->started_time);
+}
+
+static void
+metrics_close_child (MilterManagerChildren *children,
+                     MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    InFlightCommand *command = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics || !priv->metrics_open_children)
+        return;
+
+    if (priv->metrics_in_flight_commands)
+        command = g_hash_table_lookup(priv->metrics_in_flight_commands,
+                                      context);
+    /* The child is closed before it replies to negotiate. */
+    if (command && command->state == MILTER_SERVER_CONTEXT_STATE_NEGOTIATE)
+        milter_manager_metrics_count_negotiate_failure(priv->metrics,
+                                                       command->name);
+    metrics_finish_command(children, context);
+
+    if (!g_hash_table_remove(priv->metrics_open_children, context))
+        return;
+
+    milter_manager_metrics_close_child(priv->metrics,
+                                       milter_server_context_get_name(context));
+}
+
+static void
+metrics_observe_reply (MilterManagerChildren *children,
+                       MilterServerContext *context,
+                       MilterStatus status)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics)
+        return;
+
+    metrics_finish_command(children, context);
+    milter_manager_metrics_observe_reply(
+        priv->metrics,
+        milter_server_context_get_name(context),
+        milter_server_context_get_state(context),
+        status,
+        milter_server_context_get_command_elapsed(context));
+}
+
+/* Each process has its own circuit breaker. Its state is
+ * published to the shared metrics so that the status shows
+ * the circuit breakers of workers too. */
+static void
+metrics_update_circuit_breaker (MilterManagerChildren *children,
+                                MilterManagerEgg *egg)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics)
+        return;
+    if (milter_manager_egg_get_circuit_breaker_window_size(egg) == 0)
+        return;
+
+    milter_manager_metrics_set_circuit_breaker(
+        priv->metrics,
+        milter_manager_egg_get_name(egg),
+        milter_manager_egg_get_circuit_breaker_state(egg),
+        milter_manager_egg_get_circuit_breaker_current_error_rate(egg));
+}
+
+static void
+report_circuit_breaker (MilterManagerChildren *children,
+                        MilterServerContext *context,
+                        gboolean success)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    gdouble elapsed = 0.0;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->configuration)
+        return;
+
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (!egg)
+        return;
+
+    if (success)
+        elapsed = milter_server_context_get_command_elapsed(context);
+    milter_manager_egg_report_reply(egg, success, elapsed);
+    metrics_update_circuit_breaker(children, egg);
+}
+
+static void
+observe_reply (MilterManagerChildren *children,
+               MilterServerContext *context,
+               MilterStatus status)
+{
+    report_circuit_breaker(children, context, TRUE);
+    metrics_observe_reply(children, context, status);
+}
+
+static void
+metrics_count_timeout (MilterManagerChildren *children,
+                       MilterServerContext *context,
+                       MilterManagerMetricsTimeoutKind kind)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (!priv->metrics)
+        return;
+
+    milter_manager_metrics_count_timeout(
+        priv->metrics,
+        milter_server_context_get_name(context),
+        kind);
+}
+
 static void
 cb_ready (MilterServerContext *context, gpointer user_data)
 {
     NegotiateData *negotiate_data = (NegotiateData *)user_data;
     MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(negotiate_data->children);
 
@@ -822,6 +1196,14 @@ cb_ready (MilterServerContext *context, gpointer user_data)
     setup_server_context_signals(negotiate_data->children, context);
     milter_server_context_negotiate(context, negotiate_data->option);
     g_hash_table_remove(priv->try_negotiate_ids, negotiate_data);
+
+    /* Wake sessions that are waiting for the milter in this
+     * event loop up. */
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (egg)
+        milter_manager_egg_mark_alive(egg, priv->event_loop);
 }
 
 static void
@@ -833,6 +1215,8 @@ cb_negotiate_reply (MilterServerContext *context, MilterOption *option,
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    metrics_finish_command(children, context);
+
     if (macros_requests)
         milter_macros_requests_merge(priv->macros_requests, macros_requests);
 
@@ -910,10 +1294,32 @@ report_result (MilterManagerChildren *children,
     g_free(last_state_name);
 }
 
+/* Commands are streamed to a child that doesn't reply to
+ * them. The child is continued when they are flushed
+ * instead of when it replies. */
+static void
+start_streaming (MilterManagerChildren *children,
+                 MilterServerContext *context)
+{
+    MILTER_MANAGER_CHILDREN_GET_PRIVATE(children)->streaming_child = context;
+}
+
+static void
+stop_streaming (MilterManagerChildren *children,
+                MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    if (priv->streaming_child == context)
+        priv->streaming_child = NULL;
+}
+
 static void
 expire_child (MilterManagerChildren *children,
               MilterServerContext *context)
 {
+    stop_streaming(children, context);
     report_result(children, context);
     milter_server_context_set_quitted(context, TRUE);
     teardown_server_context_signals(MILTER_MANAGER_CHILD(context), children);
@@ -1096,38 +1502,34 @@ remove_child_from_queue (MilterManagerChildren *children,
 }
 
 static gboolean
-emit_replace_body_signal_file (MilterManagerChildren *children)
+emit_replace_body_signal (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
     GError *error = NULL;
-    GIOStatus status = G_IO_STATUS_NORMAL;
-    gsize chunk_size;
+    gsize offset, chunk_size;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][read][seek] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-
-        return FALSE;
-    }
+    if (!priv->body_spool)
+        return TRUE;
 
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    while (status == G_IO_STATUS_NORMAL) {
-        gchar buffer[MILTER_CHUNK_SIZE + 1];
+    offset = 0;
+    while (TRUE) {
+        const gchar *chunk;
         gsize read_size;
 
-        status = g_io_channel_read_chars(priv->body_file,
-                                         buffer, chunk_size,
-                                         &read_size, &error);
+        chunk = milter_manager_body_spool_get_chunk(priv->body_spool,
+                                                    offset,
+                                                    chunk_size,
+                                                    &read_size,
+                                                    &error);
+        if (!chunk)
+            break;
 
-        if (status == G_IO_STATUS_NORMAL)
-            g_signal_emit_by_name(children, "replace-body", buffer, read_size);
+        g_signal_emit_by_name(children, "replace-body", chunk, read_size);
+        offset += read_size;
     }
 
     if (error) {
@@ -1143,38 +1545,6 @@ emit_replace_body_signal_file (MilterManagerChildren *children)
     return TRUE;
 }
 
-static gboolean
-emit_replace_body_signal_string (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-    gsize offset, chunk_size, write_size;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    chunk_size =
-        milter_manager_configuration_get_chunk_size(priv->configuration);
-    for (offset = 0; offset < priv->body->len; offset += write_size) {
-        write_size = MIN(priv->body->len - offset, chunk_size);
-        g_signal_emit_by_name(children, "replace-body",
-                              priv->body->str + offset,
-                              write_size);
-    }
-
-    return TRUE;
-}
-
-static gboolean
-emit_replace_body_signal (MilterManagerChildren *children)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (priv->body)
-        return emit_replace_body_signal_string(children);
-    else
-        return emit_replace_body_signal_file(children);
-}
-
 static MilterStatus
 send_command_to_child (MilterManagerChildren *children,
                        MilterServerContext *context,
@@ -1194,13 +1564,13 @@ send_command_to_child (MilterManagerChildren *children,
         break;
     case MILTER_COMMAND_END_OF_HEADER:
         priv->processing_state = MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER;
-        if (milter_server_context_end_of_header(context)) {
+        if (!milter_server_context_need_reply(context,
+                                              priv->processing_state))
+            start_streaming(children, context);
+        if (milter_server_context_end_of_header(context))
             status = MILTER_STATUS_PROGRESS;
-            if (!milter_server_context_need_reply(context,
-                                                 priv->processing_state)) {
-                g_signal_emit_by_name(context, "continue");
-            }
-        }
+        else
+            stop_streaming(children, context);
         break;
     case MILTER_COMMAND_BODY:
         status = send_body_to_child(children, context);
@@ -1221,71 +1591,39 @@ send_command_to_child (MilterManagerChildren *children,
 }
 
 static void
-emit_header_signals (MilterManagerChildren *children)
+emit_header_signal (MilterHeadersDiffType type,
+                    guint index,
+                    const gchar *name,
+                    const gchar *value,
+                    gpointer user_data)
 {
-    MilterManagerChildrenPrivate *priv;
-    const GList *header_list, *node;
-    MilterHeaders *processing_headers;
-    gint i;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    processing_headers = milter_headers_copy(priv->original_headers);
-    header_list = milter_headers_get_list(priv->headers);
-
-    /* FIXME the following process admits improvement. */
-    for (node = header_list, i = 0;
-         node;
-         node = g_list_next(node), i++) {
-        MilterHeader *header = node->data;
-        MilterHeader *found_header;
-        gint index;
-
-        if (milter_headers_find(processing_headers, header)) {
-            milter_headers_remove(processing_headers, header);
-            continue;
-        }
-
-        found_header = milter_headers_lookup_by_name(processing_headers,
-                                                     header->name);
-        if (!found_header) {
-            g_signal_emit_by_name(children, "insert-header",
-                                  i, header->name, header->value);
-            continue;
-        }
-        index = milter_headers_index_in_same_header_name(priv->original_headers,
-                                                         found_header);
-        if (index == -1) {
-            g_signal_emit_by_name(children, "add-header",
-                                  header->name, header->value);
-        } else {
-            g_signal_emit_by_name(children, "change-header",
-                                  header->name, index, header->value);
-            milter_headers_remove(processing_headers, found_header);
-        }
-    }
-
-    if (milter_headers_length(processing_headers) > 0) {
-        header_list = milter_headers_get_list(processing_headers);
-
-        for (node = g_list_last((GList *)header_list);
-             node;
-             node = g_list_previous(node)) {
-            MilterHeader *header = node->data;
-            gint index;
+    MilterManagerChildren *children = user_data;
 
-            index = milter_headers_index_in_same_header_name(priv->original_headers,
-                                                             header);
-            g_signal_emit_by_name(children, "delete-header",
-                                  header->name, index);
-        }
+    switch (type) {
+    case MILTER_HEADERS_DIFF_INSERT:
+        g_signal_emit_by_name(children, "insert-header", index, name, value);
+        break;
+    case MILTER_HEADERS_DIFF_CHANGE:
+        g_signal_emit_by_name(children, "change-header", name, index, value);
+        break;
+    case MILTER_HEADERS_DIFF_DELETE:
+        g_signal_emit_by_name(children, "delete-header", name, index);
+        break;
     }
-
-    g_object_unref(processing_headers);
 }
 
 static void
-emit_signals_on_end_of_message (MilterManagerChildren *children)
+emit_header_signals (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    milter_headers_diff(priv->original_headers, priv->headers,
+                        emit_header_signal, children);
+}
+
+static void
+emit_signals_on_end_of_message (MilterManagerChildren *children)
 {
     MilterManagerChildrenPrivate *priv;
 
@@ -1389,7 +1727,9 @@ cb_continue (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    stop_streaming(children, context);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_CONTINUE);
     compile_reply_status(children, state, MILTER_STATUS_CONTINUE);
 
     switch (state) {
@@ -1440,6 +1780,7 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_TEMPORARY_FAILURE);
 
     evaluation_mode =
         milter_manager_child_is_evaluation_mode(MILTER_MANAGER_CHILD(context));
@@ -1500,6 +1841,50 @@ cb_temporary_failure (MilterServerContext *context, gpointer user_data)
     }
 }
 
+static gboolean
+need_short_circuit_reject (MilterManagerChildren *children,
+                           MilterServerContextState state)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->configuration)
+        return FALSE;
+    if (!milter_manager_configuration_get_short_circuit_reject(
+            priv->configuration))
+        return FALSE;
+
+    return get_reply_status_for_state(children, state) == MILTER_STATUS_REJECT;
+}
+
+static void
+short_circuit_reject (MilterManagerChildren *children,
+                      MilterServerContext *rejected_context)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node, *waiting_children;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    waiting_children = g_list_copy(priv->reply_queue->head);
+    for (node = waiting_children; node; node = g_list_next(node)) {
+        MilterServerContext *context = MILTER_SERVER_CONTEXT(node->data);
+
+        if (context == rejected_context)
+            continue;
+
+        milter_debug("[%u] [children][short-circuit][reject][expire] [%u] %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     milter_server_context_get_name(context));
+        g_queue_remove(priv->reply_queue, context);
+        expire_child(children, context);
+        milter_server_context_quit(context);
+    }
+    g_list_free(waiting_children);
+}
+
 static void
 cb_reject (MilterServerContext *context, gpointer user_data)
 {
@@ -1511,6 +1896,7 @@ cb_reject (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_REJECT);
 
     evaluation_mode =
         milter_manager_child_is_evaluation_mode(MILTER_MANAGER_CHILD(context));
@@ -1534,6 +1920,8 @@ cb_reject (MilterServerContext *context, gpointer user_data)
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
     case MILTER_SERVER_CONTEXT_STATE_HELO:
         /* FIXME: should expire all children? */
+        if (need_short_circuit_reject(children, state))
+            short_circuit_reject(children, context);
         milter_server_context_quit(context);
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
@@ -1603,6 +1991,7 @@ cb_accept (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_ACCEPT);
 
     compile_reply_status(children, state, MILTER_STATUS_ACCEPT);
     switch (state) {
@@ -1655,6 +2044,7 @@ cb_discard (MilterServerContext *context, gpointer user_data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_DISCARD);
 
     evaluation_mode =
         milter_manager_child_is_evaluation_mode(MILTER_MANAGER_CHILD(context));
@@ -1717,7 +2107,9 @@ cb_skip (MilterServerContext *context, gpointer user_data)
     MilterServerContextState state;
     MilterManagerChildrenPrivate *priv;
 
+    stop_streaming(children, context);
     state = milter_server_context_get_state(context);
+    observe_reply(children, context, MILTER_STATUS_SKIP);
 
     compile_reply_status(children, state, MILTER_STATUS_SKIP);
 
@@ -2159,6 +2551,7 @@ cb_stopped (MilterServerContext *context, gpointer user_data)
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    stop_streaming(children, context);
     state = milter_server_context_get_state(context);
 
     switch (state) {
@@ -2242,6 +2635,9 @@ cb_writing_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    metrics_count_timeout(children, context,
+                          MILTER_MANAGER_METRICS_TIMEOUT_WRITING);
+    report_circuit_breaker(children, context, FALSE);
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2282,6 +2678,9 @@ cb_reading_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    metrics_count_timeout(children, context,
+                          MILTER_MANAGER_METRICS_TIMEOUT_READING);
+    report_circuit_breaker(children, context, FALSE);
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2323,6 +2722,9 @@ cb_end_of_message_timeout (MilterServerContext *context, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    metrics_count_timeout(children, context,
+                          MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE);
+    report_circuit_breaker(children, context, FALSE);
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2366,6 +2768,7 @@ cb_error (MilterErrorEmittable *emittable, GError *error, gpointer user_data)
         g_free(fallback_status_name);
     }
 
+    report_circuit_breaker(children, context, FALSE);
     compile_reply_status(children, state, fallback_status);
     expire_child(children, context);
     remove_child_from_queue(children, context);
@@ -2390,6 +2793,7 @@ cb_finished (MilterAgent *agent, gpointer user_data)
         fallback_status = milter_manager_child_get_fallback_status(child);
         state = milter_server_context_get_state(context);
         milter_server_context_set_status(context, fallback_status);
+        report_circuit_breaker(children, context, FALSE);
         compile_reply_status(children, state, fallback_status);
     }
 
@@ -2434,6 +2838,30 @@ cb_finished (MilterAgent *agent, gpointer user_data)
     }
 }
 
+static void
+cb_state_transited (MilterServerContext *context,
+                    MilterServerContextState state,
+                    gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    metrics_start_command(children, context, state);
+
+    if (priv->streaming_child != context)
+        return;
+    /* Rest body packets are still being written. */
+    if (milter_server_context_is_processing(context))
+        return;
+
+    milter_debug("[%u] [children][streaming][flushed] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+    cb_continue(context, children);
+}
+
 static void
 setup_server_context_signals (MilterManagerChildren *children,
                               MilterServerContext *server_context)
@@ -2464,6 +2892,7 @@ setup_server_context_signals (MilterManagerChildren *children,
     CONNECT(skip);
 
     CONNECT(stopped);
+    CONNECT(state_transited);
 
     CONNECT(writing_timeout);
     CONNECT(reading_timeout);
@@ -2472,6 +2901,8 @@ setup_server_context_signals (MilterManagerChildren *children,
     CONNECT(error);
     CONNECT(finished);
 #undef CONNECT
+
+    metrics_open_child(children, server_context);
 }
 
 static void
@@ -2505,6 +2936,7 @@ teardown_server_context_signals (MilterManagerChild *child,
     DISCONNECT(skip);
 
     DISCONNECT(stopped);
+    DISCONNECT(state_transited);
 
     DISCONNECT(writing_timeout);
     DISCONNECT(reading_timeout);
@@ -2513,6 +2945,9 @@ teardown_server_context_signals (MilterManagerChild *child,
     DISCONNECT(error);
     DISCONNECT(finished);
 #undef DISCONNECT
+
+    metrics_close_child(MILTER_MANAGER_CHILDREN(user_data),
+                        MILTER_SERVER_CONTEXT(child));
 }
 
 static gboolean
@@ -2545,6 +2980,7 @@ milter_manager_children_start_child (MilterManagerChildren *children,
     gchar *user_name;
     MilterManagerChildrenPrivate *priv;
     MilterServerContext *context;
+    MilterManagerEgg *egg;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     context = MILTER_SERVER_CONTEXT(child);
@@ -2570,6 +3006,30 @@ milter_manager_children_start_child (MilterManagerChildren *children,
         return FALSE;
     }
 
+    /* Concurrent sessions share one launch and wait for the
+     * milter by prepare_retry_establish_connection(). */
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (egg && !milter_manager_egg_try_launch(egg)) {
+        if (priv->metrics)
+            milter_manager_metrics_count_launch(
+                priv->metrics,
+                milter_server_context_get_name(context),
+                TRUE);
+        milter_debug("[%u] [children][start-child][shared] [%u] "
+                     "launched recently: %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     milter_server_context_get_name(context));
+        return TRUE;
+    }
+    if (egg && priv->metrics)
+        milter_manager_metrics_count_launch(
+            priv->metrics,
+            milter_server_context_get_name(context),
+            FALSE);
+
     milter_debug("[%u] [children][start-child] [%u] <%s>@<%s>",
                  priv->tag,
                  milter_agent_get_tag(MILTER_AGENT(context)),
@@ -2733,6 +3193,14 @@ clear_try_negotiate_data (NegotiateData *data)
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(data->children);
 
+    if (priv->metrics)
+        milter_manager_metrics_count_connect_failure(
+            priv->metrics,
+            milter_server_context_get_name(
+                MILTER_SERVER_CONTEXT(data->child)));
+    report_circuit_breaker(data->children,
+                           MILTER_SERVER_CONTEXT(data->child),
+                           FALSE);
     remove_queue_in_negotiate(data->children, data->child);
     expire_child(data->children, MILTER_SERVER_CONTEXT(data->child));
     g_hash_table_remove(priv->try_negotiate_ids, data);
@@ -2749,6 +3217,8 @@ cb_connection_timeout (MilterServerContext *context, gpointer user_data)
                  priv->tag,
                  milter_agent_get_tag(MILTER_AGENT(context)),
                  milter_server_context_get_name(context));
+    metrics_count_timeout(data->children, context,
+                          MILTER_MANAGER_METRICS_TIMEOUT_CONNECTION);
     clear_try_negotiate_data(data);
 }
 
@@ -2830,6 +3300,20 @@ negotiate_data_new (MilterManagerChildren *children,
     return negotiate_data;
 }
 
+static void
+metrics_remove_alive_waiter (NegotiateData *data)
+{
+    if (!data->alive_metrics)
+        return;
+
+    milter_manager_metrics_add_alive_waiters(
+        data->alive_metrics,
+        milter_server_context_get_name(MILTER_SERVER_CONTEXT(data->child)),
+        -1);
+    g_object_unref(data->alive_metrics);
+    data->alive_metrics = NULL;
+}
+
 static void
 negotiate_data_free (NegotiateData *data)
 {
@@ -2841,9 +3325,26 @@ negotiate_data_free (NegotiateData *data)
     if (data->ready_signal_id > 0)
         g_signal_handler_disconnect(data->child, data->ready_signal_id);
 
+    if (data->alive_waiter_id > 0)
+        milter_manager_egg_remove_alive_waiter(data->egg,
+                                               data->alive_event_loop,
+                                               data->alive_waiter_id);
+    metrics_remove_alive_waiter(data);
+    if (data->egg)
+        g_object_unref(data->egg);
+    if (data->alive_event_loop)
+        g_object_unref(data->alive_event_loop);
+
     g_object_unref(data->child);
     g_object_unref(data->option);
 
+    if (data->pooled_channel)
+        g_io_channel_unref(data->pooled_channel);
+    if (data->negotiate_reply_option)
+        g_object_unref(data->negotiate_reply_option);
+    if (data->macros_requests)
+        g_object_unref(data->macros_requests);
+
     g_free(data);
 }
 
@@ -2880,6 +3381,26 @@ negotiate_timeout_id_hash_value_free (gpointer data)
         negotiate_timeout_id_free(data);
 }
 
+static void
+cb_child_alive (MilterManagerEgg *egg, gpointer user_data)
+{
+    NegotiateData *data = user_data;
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(data->children);
+
+    milter_debug("[%u] [children][connection][alive] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(data->child)),
+                 milter_server_context_get_name(
+                     MILTER_SERVER_CONTEXT(data->child)));
+
+    /* The egg has removed this waiter. */
+    data->alive_waiter_id = 0;
+    metrics_remove_alive_waiter(data);
+    retry_establish_connection(data);
+}
+
 static void
 prepare_retry_establish_connection (MilterManagerChild *child,
                                     MilterOption *option,
@@ -2889,11 +3410,35 @@ prepare_retry_establish_connection (MilterManagerChild *child,
     MilterManagerChildrenPrivate *priv;
     NegotiateData *negotiate_data;
     NegotiateTimeoutID *negotiate_timeout_id;
+    MilterManagerEgg *egg;
     guint timeout_id;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
     negotiate_data = negotiate_data_new(children, child, option, is_retry);
+
+    /* Retry as soon as the milter accepts connections. The
+     * timeout below is the last chance. */
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(MILTER_SERVER_CONTEXT(child)));
+    if (egg) {
+        negotiate_data->egg = g_object_ref(egg);
+        negotiate_data->alive_event_loop = g_object_ref(priv->event_loop);
+        negotiate_data->alive_waiter_id =
+            milter_manager_egg_add_alive_waiter(egg,
+                                                priv->event_loop,
+                                                cb_child_alive,
+                                                negotiate_data);
+        if (priv->metrics) {
+            negotiate_data->alive_metrics = g_object_ref(priv->metrics);
+            milter_manager_metrics_add_alive_waiters(
+                priv->metrics,
+                milter_server_context_get_name(MILTER_SERVER_CONTEXT(child)),
+                1);
+        }
+    }
+
     timeout_id = milter_event_loop_add_timeout(priv->event_loop,
                                                priv->retry_connect_time,
                                                retry_establish_connection,
@@ -2920,6 +3465,101 @@ prepare_negotiate (MilterManagerChild *child,
     g_hash_table_insert(priv->try_negotiate_ids, negotiate_data, NULL);
 }
 
+static gboolean
+reuse_pooled_connection (gpointer user_data)
+{
+    NegotiateData *data = user_data;
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    NegotiateTimeoutID *id;
+    GError *error = NULL;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(data->children);
+    context = MILTER_SERVER_CONTEXT(data->child);
+
+    /* Negotiate reply may finish this session. Don't touch
+     * the hash table after that. */
+    id = g_hash_table_lookup(priv->try_negotiate_ids, data);
+    g_hash_table_steal(priv->try_negotiate_ids, data);
+    if (id)
+        negotiate_timeout_id_free(id);
+
+    milter_debug("[%u] [children][milter][reuse] [%u] %s",
+                 priv->tag,
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+
+    setup_server_context_signals(data->children, context);
+    if (!milter_server_context_reuse_connection(context,
+                                                data->pooled_channel,
+                                                priv->offered_option,
+                                                data->negotiate_reply_option,
+                                                data->macros_requests,
+                                                &error) &&
+        error) {
+        milter_error("[%u] [children][error][reuse] [%u] %s: %s",
+                     priv->tag,
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     error->message,
+                     milter_server_context_get_name(context));
+        g_error_free(error);
+        teardown_server_context_signals(data->child, data->children);
+        child_establish_connection(data->child, data->option, data->children,
+                                   FALSE);
+    }
+
+    negotiate_data_free(data);
+
+    return FALSE;
+}
+
+static gboolean
+prepare_reuse_pooled_connection (MilterManagerChild *child,
+                                 MilterOption *option,
+                                 MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    NegotiateData *negotiate_data;
+    GIOChannel *channel;
+    MilterOption *negotiate_reply_option = NULL;
+    MilterMacrosRequests *macros_requests = NULL;
+    guint idle_id;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->offered_option)
+        return FALSE;
+
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(MILTER_SERVER_CONTEXT(child)));
+    if (!egg)
+        return FALSE;
+
+    channel = milter_manager_egg_lease_connection(egg,
+                                                  priv->offered_option,
+                                                  &negotiate_reply_option,
+                                                  &macros_requests);
+    if (!channel)
+        return FALSE;
+
+    negotiate_data = negotiate_data_new(children, child, option, FALSE);
+    negotiate_data->pooled_channel = channel;
+    negotiate_data->negotiate_reply_option = negotiate_reply_option;
+    negotiate_data->macros_requests = macros_requests;
+    idle_id = milter_event_loop_add_idle_full(priv->event_loop,
+                                              G_PRIORITY_DEFAULT,
+                                              reuse_pooled_connection,
+                                              negotiate_data,
+                                              NULL);
+    g_hash_table_insert(priv->try_negotiate_ids,
+                        negotiate_data,
+                        negotiate_timeout_id_new(priv->event_loop, idle_id));
+
+    return TRUE;
+}
+
 static gboolean
 child_establish_connection (MilterManagerChild *child,
                             MilterOption *option,
@@ -2933,6 +3573,10 @@ child_establish_connection (MilterManagerChild *child,
     context = MILTER_SERVER_CONTEXT(child);
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    if (!is_retry &&
+        prepare_reuse_pooled_connection(child, option, children))
+        return TRUE;
+
     if (!milter_server_context_establish_connection(context, &error)) {
         milter_error("[%u] [children][error][connection] [%u] %s: %s",
                      priv->tag,
@@ -3096,6 +3740,73 @@ cb_idle_reply_negotiate_on_no_child (gpointer user_data)
     return FALSE;
 }
 
+static void
+reply_negotiate_on_no_child (MilterManagerChildren *children)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    priv->negotiated = TRUE;
+    dispose_lazy_reply_negotiate_id(priv);
+    priv->lazy_reply_negotiate_id =
+        milter_event_loop_add_idle_full(priv->event_loop,
+                                        G_PRIORITY_DEFAULT,
+                                        cb_idle_reply_negotiate_on_no_child,
+                                        children,
+                                        NULL);
+}
+
+static gboolean
+pass_circuit_breaker (MilterManagerChildren *children,
+                      MilterManagerChild *child)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterServerContext *context;
+    MilterManagerEgg *egg;
+    MilterStatus fallback_status;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+    context = MILTER_SERVER_CONTEXT(child);
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (!egg)
+        return TRUE;
+    if (milter_manager_egg_pass_circuit_breaker(egg)) {
+        metrics_update_circuit_breaker(children, egg);
+        return TRUE;
+    }
+
+    metrics_update_circuit_breaker(children, egg);
+    if (priv->metrics)
+        milter_manager_metrics_count_circuit_breaker_rejection(
+            priv->metrics,
+            milter_server_context_get_name(context));
+
+    /* The milter is skipped without connecting to it. Its
+     * fallback status is applied by
+     * check_fallback_status_on_negotiate() because it isn't
+     * negotiated. */
+    fallback_status = milter_manager_child_get_fallback_status(child);
+    if (milter_need_info_log()) {
+        gchar *fallback_status_name;
+
+        fallback_status_name =
+            milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS,
+                                            fallback_status);
+        milter_info("[%u] [children][circuit-breaker][open][%s] [%u] %s",
+                    priv->tag,
+                    fallback_status_name,
+                    milter_agent_get_tag(MILTER_AGENT(context)),
+                    milter_server_context_get_name(context));
+        g_free(fallback_status_name);
+    }
+    milter_server_context_set_status(context, fallback_status);
+    expire_child(children, context);
+
+    return FALSE;
+}
+
 gboolean
 milter_manager_children_negotiate (MilterManagerChildren *children,
                                    MilterOption          *option,
@@ -3121,15 +3832,15 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
         priv->initial_yes_steps = milter_option_get_step_yes(priv->option);
     }
 
+    if (priv->offered_option) {
+        g_object_unref(priv->offered_option);
+        priv->offered_option = NULL;
+    }
+    if (priv->option)
+        priv->offered_option = milter_option_copy(priv->option);
+
     if (!priv->milters) {
-        priv->negotiated = TRUE;
-        dispose_lazy_reply_negotiate_id(priv);
-        priv->lazy_reply_negotiate_id =
-            milter_event_loop_add_idle_full(priv->event_loop,
-                                            G_PRIORITY_DEFAULT,
-                                            cb_idle_reply_negotiate_on_no_child,
-                                            children,
-                                            NULL);
+        reply_negotiate_on_no_child(children);
         return success;
     }
 
@@ -3139,10 +3850,17 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
     init_reply_queue(children, MILTER_SERVER_CONTEXT_STATE_NEGOTIATE);
     for (node = priv->milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = MILTER_MANAGER_CHILD(node->data);
+        if (!pass_circuit_breaker(children, child))
+            continue;
         g_queue_push_tail(priv->reply_queue, child);
     }
 
-    copied_milters = g_list_copy(priv->milters);
+    if (g_queue_is_empty(priv->reply_queue)) {
+        reply_negotiate_on_no_child(children);
+        return success;
+    }
+
+    copied_milters = g_list_copy(priv->reply_queue->head);
     for (node = copied_milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = MILTER_MANAGER_CHILD(node->data);
 
@@ -3159,6 +3877,17 @@ milter_manager_children_negotiate (MilterManagerChildren *children,
     return success;
 }
 
+static void
+cb_copy_macro (gpointer key, gpointer value, gpointer user_data)
+{
+    GHashTable *macros = user_data;
+
+    if (!value)
+        return;
+
+    g_hash_table_insert(macros, g_strdup(key), g_strdup(value));
+}
+
 gboolean
 milter_manager_children_define_macro (MilterManagerChildren *children,
                                       MilterCommand command,
@@ -3166,9 +3895,18 @@ milter_manager_children_define_macro (MilterManagerChildren *children,
 {
     GList *node;
     MilterManagerChildrenPrivate *priv;
+    GHashTable *shared_macros;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
+    /* All children share one copy of the macros. It lets
+     * children that request the same symbols reuse one
+     * encoded DEFINE_MACRO packet. */
+    milter_macros_packet_cache_invalidate(priv->macros_packet_cache, command);
+    shared_macros = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          g_free, g_free);
+    g_hash_table_foreach(macros, cb_copy_macro, shared_macros);
+
     for (node = priv->milters; node; node = g_list_next(node)) {
         MilterManagerChild *child = node->data;
         MilterServerContext *context;
@@ -3202,8 +3940,11 @@ milter_manager_children_define_macro (MilterManagerChildren *children,
         default:
             break;
         }
-        milter_protocol_agent_set_macros_hash_table(agent, command, macros);
+        milter_protocol_agent_share_macros_hash_table(agent, command,
+                                                      shared_macros);
     }
+    g_hash_table_unref(shared_macros);
+
     return TRUE;
 }
 
@@ -3272,11 +4013,11 @@ milter_manager_children_check_processing_message (MilterManagerChildren *childre
     return FALSE;
 }
 
-gboolean
-milter_manager_children_connect (MilterManagerChildren *children,
-                                 const gchar           *host_name,
-                                 struct sockaddr       *address,
-                                 socklen_t              address_length)
+static gboolean
+children_connect (MilterManagerChildren *children,
+                  const gchar           *host_name,
+                  struct sockaddr       *address,
+                  socklen_t              address_length)
 {
     GList *child, *targets;
     MilterManagerChildrenPrivate *priv;
@@ -3286,13 +4027,6 @@ milter_manager_children_connect (MilterManagerChildren *children,
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    dispose_smtp_client_address(priv);
-    priv->smtp_client_address = g_memdup(address, address_length);
-    priv->smtp_client_address_length = address_length;
-
-    if (!milter_manager_children_check_alive(children))
-        return FALSE;
-
     init_reply_queue(children, state);
     for (child = priv->milters; child; child = g_list_next(child)) {
         MilterServerContext *context = MILTER_SERVER_CONTEXT(child->data);
@@ -3325,6 +4059,110 @@ milter_manager_children_connect (MilterManagerChildren *children,
     return success;
 }
 
+static void
+cb_dnsbl_checked (MilterManagerDNSBL *dnsbl, gboolean listed,
+                  gpointer user_data)
+{
+    MilterManagerChildren *children = user_data;
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+    gchar *host_name;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    for (node = priv->dnsbl_checks; node; node = g_list_next(node)) {
+        DNSBLCheck *check = node->data;
+
+        if (check->dnsbl == dnsbl) {
+            g_object_unref(check->dnsbl);
+            g_free(check);
+            priv->dnsbl_checks = g_list_delete_link(priv->dnsbl_checks, node);
+            break;
+        }
+    }
+    milter_debug("[%u] [children][connect][dnsbl][checked] "
+                 "listed=<%s> rest=<%u>",
+                 priv->tag,
+                 listed ? "true" : "false",
+                 g_list_length(priv->dnsbl_checks));
+    if (priv->dnsbl_checks)
+        return;
+
+    host_name = priv->dnsbl_host_name;
+    priv->dnsbl_host_name = NULL;
+    if (milter_manager_children_check_alive(children))
+        children_connect(children, host_name,
+                         priv->smtp_client_address,
+                         priv->smtp_client_address_length);
+    g_free(host_name);
+}
+
+static gboolean
+start_dnsbl_checks (MilterManagerChildren *children,
+                    const gchar           *host_name,
+                    struct sockaddr       *address,
+                    socklen_t              address_length)
+{
+    MilterManagerChildrenPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    dispose_dnsbl_checks(priv);
+    if (!priv->event_loop)
+        return FALSE;
+
+    for (node = priv->dnsbls; node; node = g_list_next(node)) {
+        MilterManagerDNSBL *dnsbl = node->data;
+        DNSBLCheck *check;
+        guint id;
+
+        id = milter_manager_dnsbl_check(dnsbl, priv->event_loop,
+                                        address, address_length,
+                                        cb_dnsbl_checked, children);
+        if (id == 0)
+            continue;
+
+        check = g_new0(DNSBLCheck, 1);
+        check->dnsbl = g_object_ref(dnsbl);
+        check->id = id;
+        priv->dnsbl_checks = g_list_prepend(priv->dnsbl_checks, check);
+    }
+
+    if (!priv->dnsbl_checks)
+        return FALSE;
+
+    priv->dnsbl_host_name = g_strdup(host_name);
+    milter_debug("[%u] [children][connect][dnsbl][wait] <%u>",
+                 priv->tag, g_list_length(priv->dnsbl_checks));
+    return TRUE;
+}
+
+gboolean
+milter_manager_children_connect (MilterManagerChildren *children,
+                                 const gchar           *host_name,
+                                 struct sockaddr       *address,
+                                 socklen_t              address_length)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    dispose_smtp_client_address(priv);
+    priv->smtp_client_address = g_memdup(address, address_length);
+    priv->smtp_client_address_length = address_length;
+
+    if (!milter_manager_children_check_alive(children))
+        return FALSE;
+
+    /* Connect is sent to children after DNSBL checks are finished
+     * so that stop-on-connect rules can use the cached results. */
+    if (start_dnsbl_checks(children, host_name, address, address_length))
+        return TRUE;
+
+    return children_connect(children, host_name, address, address_length);
+}
+
 gboolean
 milter_manager_children_helo (MilterManagerChildren *children,
                               const gchar           *fqdn)
@@ -3563,6 +4401,8 @@ send_next_header_to_child (MilterManagerChildren *children, MilterServerContext
     MilterManagerChildrenPrivate *priv;
     MilterHeader *header;
     gint value_offset = 0;
+    gboolean strip_leading_space;
+    gboolean success;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
     priv->processing_state = MILTER_SERVER_CONTEXT_STATE_HEADER;
@@ -3573,22 +4413,36 @@ send_next_header_to_child (MilterManagerChildren *children, MilterServerContext
     if (!header)
         return MILTER_STATUS_NOT_CHANGE;
 
-    if (need_header_value_leading_space_conversion(children, context)) {
-        if (header->value && header->value[0] == ' ')
-            value_offset = 1;
-    }
+    strip_leading_space =
+        need_header_value_leading_space_conversion(children, context);
+
+    if (!milter_server_context_need_reply(context, priv->processing_state)) {
+        guint first_index;
 
-    if (milter_server_context_header(context,
-                                     header->name,
-                                     header->value + value_offset)) {
-        MilterStatus status = MILTER_STATUS_PROGRESS;
-        if (!milter_server_context_need_reply(context, priv->processing_state)) {
-            g_signal_emit_by_name(context, "continue");
+        /* Send all received headers back-to-back. */
+        first_index = priv->processing_header_index;
+        priv->processing_header_index = milter_headers_length(priv->headers);
+        start_streaming(children, context);
+        success = milter_server_context_stream_headers(context,
+                                                       priv->headers,
+                                                       first_index,
+                                                       strip_leading_space);
+    } else {
+        if (strip_leading_space) {
+            if (header->value && header->value[0] == ' ')
+                value_offset = 1;
         }
-        return status;
+        success = milter_server_context_header(context,
+                                               header->name,
+                                               header->value + value_offset);
+    }
+
+    if (success) {
+        return MILTER_STATUS_PROGRESS;
     } else {
         MilterManagerChild *child;
 
+        stop_streaming(children, context);
         child = MILTER_MANAGER_CHILD(context);
         return milter_manager_child_get_fallback_status(child);
     }
@@ -3676,61 +4530,31 @@ milter_manager_children_end_of_header (MilterManagerChildren *children)
 }
 
 static gboolean
-open_body_file (MilterManagerChildren *children)
+write_body (MilterManagerChildren *children,
+            const gchar *chunk, gsize size)
 {
-    gint fd;
     GError *error = NULL;
     MilterManagerChildrenPrivate *priv;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
 
-    fd = g_file_open_tmp(NULL, &priv->body_file_name, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][open] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-        return FALSE;
-    }
-    priv->body_file = g_io_channel_unix_new(fd);
-    g_io_channel_set_close_on_unref(priv->body_file, TRUE);
+    if (!priv->body_spool) {
+        MilterManagerConfiguration *config = priv->configuration;
 
-    g_io_channel_set_encoding(priv->body_file, NULL, &error);
-    if (error) {
-        milter_error("[%u] [children][error][body][encoding] %s",
-                     priv->tag, error->message);
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children),
-                                    error);
-        g_error_free(error);
-        return FALSE;
+        priv->body_spool = milter_manager_body_spool_new(
+            milter_manager_configuration_get_max_on_memory_body_size(config));
+        milter_manager_body_spool_set_use_memfd(
+            priv->body_spool,
+            milter_manager_configuration_get_use_memfd_body_spool(config));
+        /* The budget is shared by all sessions in the process.
+         * It follows the current configuration. */
+        milter_manager_body_spool_set_max_on_memory_total_size(
+            milter_manager_configuration_get_max_on_memory_body_total_size(
+                config));
     }
 
-    return TRUE;
-}
-
-static gboolean
-write_body_to_file (MilterManagerChildren *children,
-                    const gchar *chunk,
-                    gsize size)
-{
-    GError *error = NULL;
-    gsize written_size;
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (!priv->body_file && !open_body_file(children))
-        return FALSE;
-
-    if (!priv->body_file)
-        return TRUE;
-
-    if (!chunk || size == 0)
-        return TRUE;
-
-    g_io_channel_write_chars(priv->body_file, chunk, size, &written_size, &error);
-    if (error) {
+    if (!milter_manager_body_spool_append(priv->body_spool,
+                                          chunk, size, &error)) {
         milter_error("[%u] [children][error][body][write] %s",
                      priv->tag,
                      error->message);
@@ -3740,50 +4564,13 @@ write_body_to_file (MilterManagerChildren *children,
         return FALSE;
     }
 
-    return TRUE;
-}
-
-static gboolean
-write_body_to_string (MilterManagerChildren *children,
-                      const gchar *chunk,
-                      gsize size)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (!priv->body)
-        priv->body = g_string_new_len(chunk, size);
-    else
-        g_string_append_len(priv->body, chunk, size);
-
-    if (priv->body->len > MAX_ON_MEMORY_BODY_SIZE) {
-        gboolean success;
-
-        success = write_body_to_file(children, priv->body->str, priv->body->len);
-        g_string_free(priv->body, TRUE);
-        priv->body = NULL;
-
-        return success;
-    }
+    priv->metrics_buffered_body_size += size;
+    if (priv->metrics)
+        milter_manager_metrics_add_buffered_body_bytes(priv->metrics, size);
 
     return TRUE;
 }
 
-static gboolean
-write_body (MilterManagerChildren *children,
-            const gchar *chunk, gsize size)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-
-    if (priv->body_file)
-        return write_body_to_file(children, chunk, size);
-    else
-        return write_body_to_string(children, chunk, size);
-}
-
 gboolean
 milter_manager_children_body (MilterManagerChildren *children,
                               const gchar           *chunk,
@@ -3846,48 +4633,6 @@ milter_manager_children_body (MilterManagerChildren *children,
 
 }
 
-static MilterStatus
-init_child_for_body_string (MilterManagerChildren *children,
-                            MilterServerContext *context)
-{
-    MilterManagerChildrenPrivate *priv;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    priv->sent_body_offset = 0;
-
-    return MILTER_STATUS_NOT_CHANGE;
-}
-
-static MilterStatus
-init_child_for_body_file (MilterManagerChildren *children,
-                          MilterServerContext *context)
-{
-    MilterManagerChildrenPrivate *priv;
-    GError *error = NULL;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
-        return MILTER_STATUS_NOT_CHANGE;
-
-    g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, &error);
-    if (error) {
-        MilterManagerChild *child;
-
-        milter_error("[%u] [children][error][body][send][seek] [%u] %s: %s",
-                     priv->tag,
-                     milter_agent_get_tag(MILTER_AGENT(context)),
-                     error->message,
-                     milter_server_context_get_name(context));
-        milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
-        g_error_free(error);
-
-        child = MILTER_MANAGER_CHILD(context);
-        return milter_manager_child_get_fallback_status(child);
-    }
-
-    return MILTER_STATUS_NOT_CHANGE;
-}
-
 static MilterStatus
 init_child_for_body (MilterManagerChildren *children,
                      MilterServerContext *context)
@@ -3905,57 +4650,39 @@ init_child_for_body (MilterManagerChildren *children,
 
     priv->replaced_body_for_each_child = FALSE;
     priv->sending_body = TRUE;
-    if (priv->body)
-        return init_child_for_body_string(children, context);
-    else
-        return init_child_for_body_file(children, context);
+    priv->sent_body_offset = 0;
+
+    return MILTER_STATUS_NOT_CHANGE;
 }
 
 static MilterStatus
-send_body_to_child_file (MilterManagerChildren *children,
-                         MilterServerContext *context)
+send_body_to_child_spool (MilterManagerChildren *children,
+                          MilterServerContext *context)
 {
     MilterStatus status = MILTER_STATUS_PROGRESS;
-    GError *error = NULL;
-    GIOStatus io_status = G_IO_STATUS_NORMAL;
     MilterManagerChildrenPrivate *priv;
-    gchar buffer[MILTER_CHUNK_SIZE + 1];
-    gsize read_size, chunk_size;
+    GError *error = NULL;
+    const gchar *chunk;
+    gsize chunk_size, write_size;
     MilterManagerChild *child;
 
     priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (!priv->body_file)
+    if (!priv->body_spool)
         return MILTER_STATUS_NOT_CHANGE;
 
+    child = MILTER_MANAGER_CHILD(context);
     chunk_size =
         milter_manager_configuration_get_chunk_size(priv->configuration);
-    io_status = g_io_channel_read_chars(priv->body_file,
-                                        buffer, chunk_size,
-                                        &read_size, &error);
-
-    child = MILTER_MANAGER_CHILD(context);
-    switch (io_status) {
-    case G_IO_STATUS_ERROR:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    case G_IO_STATUS_NORMAL:
-        if (milter_server_context_body(context, buffer, read_size)) {
-            status = MILTER_STATUS_PROGRESS;
-        } else {
-            status = milter_manager_child_get_fallback_status(child);
-        }
-        break;
-    case G_IO_STATUS_EOF:
-        status = MILTER_STATUS_NOT_CHANGE;
-        break;
-    case G_IO_STATUS_AGAIN:
-        status = MILTER_STATUS_PROGRESS;
-        break;
-    default:
-        status = milter_manager_child_get_fallback_status(child);
-        break;
-    }
-
+    /* A child that doesn't reply to body chunks receives
+     * larger pieces. They are sent by several packets
+     * back-to-back. */
+    if (!milter_server_context_need_reply(context, priv->processing_state))
+        chunk_size = MAX(chunk_size, MAX_STREAM_BODY_SIZE);
+    chunk = milter_manager_body_spool_get_chunk(priv->body_spool,
+                                                priv->sent_body_offset,
+                                                chunk_size,
+                                                &write_size,
+                                                &error);
     if (error) {
         milter_error("[%u] [children][error][body][send] [%u] %s: %s",
                      priv->tag,
@@ -3965,36 +4692,15 @@ send_body_to_child_file (MilterManagerChildren *children,
         milter_error_emittable_emit(MILTER_ERROR_EMITTABLE(children), error);
         g_error_free(error);
 
-        status = milter_manager_child_get_fallback_status(child);
+        return milter_manager_child_get_fallback_status(child);
     }
-
-    return status;
-}
-
-static MilterStatus
-send_body_to_child_string (MilterManagerChildren *children,
-                           MilterServerContext *context)
-{
-    MilterStatus status = MILTER_STATUS_PROGRESS;
-    MilterManagerChildrenPrivate *priv;
-    gsize chunk_size, write_size;
-
-    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
-    if (priv->sent_body_offset >= priv->body->len)
+    if (!chunk)
         return MILTER_STATUS_NOT_CHANGE;
 
-    chunk_size =
-        milter_manager_configuration_get_chunk_size(priv->configuration);
-    write_size = MIN(priv->body->len - priv->sent_body_offset, chunk_size);
-    if (milter_server_context_body(context,
-                                   priv->body->str + priv->sent_body_offset,
-                                   write_size)) {
+    if (milter_server_context_body(context, chunk, write_size)) {
         priv->sent_body_offset += write_size;
         init_command_waiting_child_queue(children, MILTER_COMMAND_BODY);
     } else {
-        MilterManagerChild *child;
-
-        child = MILTER_MANAGER_CHILD(context);
         status = milter_manager_child_get_fallback_status(child);
     }
 
@@ -4015,18 +4721,14 @@ send_body_to_child (MilterManagerChildren *children, MilterServerContext *contex
         return MILTER_STATUS_NOT_CHANGE;
     }
 
-    if (priv->body)
-        status = send_body_to_child_string(children, context);
-    else
-        status = send_body_to_child_file(children, context);
+    if (!milter_server_context_need_reply(context, priv->processing_state))
+        start_streaming(children, context);
+    status = send_body_to_child_spool(children, context);
 
-    if (status == MILTER_STATUS_PROGRESS &&
-        !milter_server_context_need_reply(context, priv->processing_state)) {
-        g_signal_emit_by_name(context, "continue");
-    }
-
-    if (status != MILTER_STATUS_PROGRESS)
+    if (status != MILTER_STATUS_PROGRESS) {
+        stop_streaming(children, context);
         priv->sending_body = FALSE;
+    }
 
     return status;
 }
@@ -4072,8 +4774,6 @@ milter_manager_children_end_of_message (MilterManagerChildren *children,
         g_free(priv->end_of_message_chunk);
     priv->end_of_message_chunk = g_strdup(chunk);
     priv->end_of_message_size = size;
-    if (priv->body_file)
-        g_io_channel_seek_position(priv->body_file, 0, G_SEEK_SET, NULL);
 
     priv->state = MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE;
     priv->processing_state = priv->state;
@@ -4082,6 +4782,66 @@ milter_manager_children_end_of_message (MilterManagerChildren *children,
                                             MILTER_COMMAND_END_OF_MESSAGE);
 }
 
+static gboolean
+release_child_connection (MilterManagerChildren *children,
+                          MilterServerContext *context)
+{
+    MilterManagerChildrenPrivate *priv;
+    MilterManagerEgg *egg;
+    MilterOption *negotiate_reply_option;
+    MilterMacrosRequests *macros_requests;
+    GIOChannel *channel;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (!priv->offered_option)
+        return FALSE;
+
+    if (!milter_server_context_is_negotiated(context) ||
+        milter_server_context_is_processing(context))
+        return FALSE;
+
+    negotiate_reply_option =
+        milter_server_context_get_negotiate_reply_option(context);
+    if (!negotiate_reply_option)
+        return FALSE;
+
+    egg = milter_manager_configuration_find_egg(
+        priv->configuration,
+        milter_server_context_get_name(context));
+    if (!egg)
+        return FALSE;
+    if (milter_manager_egg_get_n_pooled_connections(egg) >=
+        milter_manager_egg_get_connection_pool_size(egg))
+        return FALSE;
+
+    if (!milter_server_context_quit_new_connection(context))
+        return FALSE;
+
+    g_object_ref(context);
+    macros_requests =
+        milter_protocol_agent_get_macros_requests(MILTER_PROTOCOL_AGENT(context));
+    channel = milter_server_context_release_connection(context);
+    if (channel) {
+        milter_manager_egg_release_connection(egg,
+                                              channel,
+                                              priv->offered_option,
+                                              negotiate_reply_option,
+                                              macros_requests);
+        g_io_channel_unref(channel);
+    } else {
+        /* QUIT_NC is already sent. The connection is closed
+         * with the context because it can't be reused. */
+        milter_error("[%u] [children][error][connection-pool][release] [%s]",
+                     priv->tag,
+                     milter_server_context_get_name(context));
+        milter_manager_egg_count_broken_connection(egg);
+    }
+    g_object_unref(context);
+
+    return TRUE;
+}
+
 gboolean
 milter_manager_children_quit (MilterManagerChildren *children)
 {
@@ -4105,6 +4865,9 @@ milter_manager_children_quit (MilterManagerChildren *children)
         if (state == MILTER_SERVER_CONTEXT_STATE_QUIT)
             continue;
 
+        if (release_child_connection(children, context))
+            continue;
+
         if (!milter_server_context_quit(context))
             success = FALSE;
     }
@@ -4234,6 +4997,40 @@ milter_manager_children_set_launcher_channel (MilterManagerChildren *children,
     }
 }
 
+MilterManagerMetrics *
+milter_manager_children_get_metrics (MilterManagerChildren *children)
+{
+    return MILTER_MANAGER_CHILDREN_GET_PRIVATE(children)->metrics;
+}
+
+void
+milter_manager_children_set_metrics (MilterManagerChildren *children,
+                                     MilterManagerMetrics  *metrics)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (priv->metrics)
+        g_object_unref(priv->metrics);
+    priv->metrics = metrics;
+    if (priv->metrics)
+        g_object_ref(priv->metrics);
+}
+
+void
+milter_manager_children_add_dnsbl (MilterManagerChildren *children,
+                                   MilterManagerDNSBL    *dnsbl)
+{
+    MilterManagerChildrenPrivate *priv;
+
+    priv = MILTER_MANAGER_CHILDREN_GET_PRIVATE(children);
+
+    if (g_list_find(priv->dnsbls, dnsbl))
+        return;
+    priv->dnsbls = g_list_append(priv->dnsbls, g_object_ref(dnsbl));
+}
+
 guint
 milter_manager_children_get_tag (MilterManagerChildren *children)
 {
@@ -24,6 +24,8 @@
 
 #include <milter/manager/milter-manager-objects.h>
 #include <milter/manager/milter-manager-child.h>
+#include <milter/manager/milter-manager-metrics.h>
+#include <milter/manager/milter-manager-dnsbl.h>
 #include <milter/core/milter-reply-signals.h>
 
 G_BEGIN_DECLS
@@ -142,6 +144,11 @@ void                   milter_manager_children_set_launcher_channel
                                                            (MilterManagerChildren *children,
                                                             GIOChannel *read_channel,
                                                             GIOChannel *write_channel);
+MilterManagerMetrics  *milter_manager_children_get_metrics (MilterManagerChildren *children);
+void                   milter_manager_children_set_metrics (MilterManagerChildren *children,
+                                                            MilterManagerMetrics  *metrics);
+void                   milter_manager_children_add_dnsbl   (MilterManagerChildren *children,
+                                                            MilterManagerDNSBL    *dnsbl);
 
 guint                  milter_manager_children_get_tag     (MilterManagerChildren *children);
 void                   milter_manager_children_set_tag     (MilterManagerChildren *children,
@@ -31,6 +31,8 @@
 #include "milter-manager-configuration.h"
 #include "milter-manager-leader.h"
 #include "milter-manager-children.h"
+#include "milter-manager-connection-table.h"
+#include "milter-manager-body-spool.h"
 
 #define DEFAULT_FALLBACK_STATUS MILTER_STATUS_ACCEPT
 #define DEFAULT_FALLBACK_STATUS_AT_DISCONNECT MILTER_STATUS_TEMPORARY_FAILURE
@@ -50,6 +52,7 @@ struct _MilterManagerConfigurationPrivate
     GList *applicable_conditions;
     gboolean privilege_mode;
     gchar *controller_connection_spec;
+    gchar *controller_metrics_connection_spec;
     gchar *manager_connection_spec;
     MilterStatus fallback_status;
     MilterStatus fallback_status_at_disconnect;
@@ -76,11 +79,19 @@ struct _MilterManagerConfigurationPrivate
     guint connection_check_interval;
     MilterClientEventLoopBackend event_loop_backend;
     guint n_workers;
+    gboolean reuse_port;
+    guint n_event_loop_threads;
     guint default_packet_buffer_size;
     gboolean use_syslog;
     gchar *syslog_facility;
     guint chunk_size;
     guint max_pending_finished_sessions;
+    gsize max_on_memory_body_size;
+    gsize max_on_memory_body_total_size;
+    gboolean use_memfd_body_spool;
+    gboolean short_circuit_reject;
+    MilterManagerConnectionTable *connection_table;
+    GRWLock reload_lock;
 };
 
 enum
@@ -88,6 +99,7 @@ enum
     PROP_0,
     PROP_PRIVILEGE_MODE,
     PROP_CONTROLLER_CONNECTION_SPEC,
+    PROP_CONTROLLER_METRICS_CONNECTION_SPEC,
     PROP_MANAGER_CONNECTION_SPEC,
     PROP_FALLBACK_STATUS,
     PROP_FALLBACK_STATUS_AT_DISCONNECT,
@@ -113,12 +125,19 @@ enum
     PROP_CONNECTION_CHECK_INTERVAL,
     PROP_EVENT_LOOP_BACKEND,
     PROP_N_WORKERS,
+    PROP_REUSE_PORT,
+    PROP_N_EVENT_LOOP_THREADS,
     PROP_DEFAULT_PACKET_BUFFER_SIZE,
     PROP_PREFIX,
     PROP_USE_SYSLOG,
     PROP_SYSLOG_FACILITY,
     PROP_CHUNK_SIZE,
-    PROP_MAX_PENDING_FINISHED_SESSIONS
+    PROP_MAX_PENDING_FINISHED_SESSIONS,
+    PROP_MAX_ON_MEMORY_BODY_SIZE,
+    PROP_MAX_ON_MEMORY_BODY_TOTAL_SIZE,
+    PROP_USE_MEMFD_BODY_SPOOL,
+    PROP_SHORT_CIRCUIT_REJECT,
+    PROP_CONNECTION_TABLE
 };
 
 enum
@@ -137,6 +156,7 @@ G_DEFINE_TYPE(MilterManagerConfiguration, milter_manager_configuration,
               G_TYPE_OBJECT);
 
 static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
 static void set_property   (GObject         *object,
                             guint            prop_id,
                             const GValue    *value,
@@ -155,6 +175,7 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
     gobject_class = G_OBJECT_CLASS(klass);
 
     gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
@@ -175,6 +196,16 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                                     PROP_CONTROLLER_CONNECTION_SPEC,
                                     spec);
 
+    spec = g_param_spec_string("controller-metrics-connection-spec",
+                               "Controller metrics connection spec",
+                               "The connection spec of the metrics "
+                               "HTTP endpoint of the milter-manager",
+                               NULL,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONTROLLER_METRICS_CONNECTION_SPEC,
+                                    spec);
+
     spec = g_param_spec_string("manager-connection-spec",
                                "Manager connection spec",
                                "The manager connection spec "
@@ -416,6 +447,22 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                              G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_N_WORKERS, spec);
 
+    spec = g_param_spec_boolean("reuse-port",
+                                "Reuse port",
+                                "Whether each worker process listens "
+                                "on its own socket with SO_REUSEPORT",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_REUSE_PORT, spec);
+
+    spec = g_param_spec_uint("n-event-loop-threads",
+                             "Number of event loop threads",
+                             "The number of event loop threads of the client",
+                             0, MILTER_CLIENT_MAX_N_EVENT_LOOP_THREADS, 0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_N_EVENT_LOOP_THREADS,
+                                    spec);
+
     spec = g_param_spec_uint("default-packet-buffer-size",
                              "Default packet buffer size",
                              "The default packet buffer size of client contexts "
@@ -465,6 +512,59 @@ milter_manager_configuration_class_init (MilterManagerConfigurationClass *klass)
                                     PROP_MAX_PENDING_FINISHED_SESSIONS,
                                     spec);
 
+    spec = g_param_spec_uint64("max-on-memory-body-size",
+                               "Maximum on memory body size",
+                               "The maximum body size of a session kept "
+                               "on memory",
+                               0, G_MAXUINT64,
+                               MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAX_ON_MEMORY_BODY_SIZE,
+                                    spec);
+
+    spec = g_param_spec_uint64("max-on-memory-body-total-size",
+                               "Maximum on memory body total size",
+                               "The maximum total body size of all sessions "
+                               "kept on memory",
+                               0, G_MAXUINT64, 0,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAX_ON_MEMORY_BODY_TOTAL_SIZE,
+                                    spec);
+
+    spec = g_param_spec_boolean("use-memfd-body-spool",
+                                "Use memfd body spool",
+                                "Whether large body is spooled to an "
+                                "anonymous memory file",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_USE_MEMFD_BODY_SPOOL,
+                                    spec);
+
+    spec = g_param_spec_boolean("short-circuit-reject",
+                                "Short circuit reject",
+                                "Whether milter-manager replies reject "
+                                "on connect and helo without waiting "
+                                "for other milters",
+                                FALSE,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_SHORT_CIRCUIT_REJECT,
+                                    spec);
+
+    spec = g_param_spec_object("connection-table",
+                               "Connection table",
+                               "The table of TCP connections used for "
+                               "checking whether SMTP client is still "
+                               "connected",
+                               MILTER_TYPE_MANAGER_CONNECTION_TABLE,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONNECTION_TABLE,
+                                    spec);
+
     signals[CONNECTED] =
         g_signal_new("connected",
                      G_TYPE_FROM_CLASS(klass),
@@ -494,10 +594,12 @@ milter_manager_configuration_init (MilterManagerConfiguration *configuration)
     const gchar *config_dir_env;
 
     priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    g_rw_lock_init(&(priv->reload_lock));
     priv->load_paths = NULL;
     priv->eggs = NULL;
     priv->applicable_conditions = NULL;
     priv->controller_connection_spec = NULL;
+    priv->controller_metrics_connection_spec = NULL;
     priv->manager_connection_spec = NULL;
     priv->effective_user = NULL;
     priv->effective_group = NULL;
@@ -515,10 +617,18 @@ milter_manager_configuration_init (MilterManagerConfiguration *configuration)
                                             (GDestroyNotify)g_dataset_destroy);
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
     priv->n_workers = 0;
+    priv->reuse_port = FALSE;
+    priv->n_event_loop_threads = 0;
     priv->default_packet_buffer_size = 0;
     priv->syslog_facility = NULL;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->max_on_memory_body_size =
+        MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE;
+    priv->max_on_memory_body_total_size = 0;
+    priv->use_memfd_body_spool = FALSE;
+    priv->short_circuit_reject = FALSE;
+    priv->connection_table = NULL;
 
     config_dir_env = g_getenv("MILTER_MANAGER_CONFIG_DIR");
     if (config_dir_env)
@@ -527,6 +637,17 @@ milter_manager_configuration_init (MilterManagerConfiguration *configuration)
     priv->load_paths = g_list_append(priv->load_paths, g_strdup(CONFIG_DIR));
 }
 
+static void
+finalize (GObject *object)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(object);
+    g_rw_lock_clear(&(priv->reload_lock));
+
+    G_OBJECT_CLASS(milter_manager_configuration_parent_class)->finalize(object);
+}
+
 static void
 dispose (GObject *object)
 {
@@ -576,6 +697,10 @@ set_property (GObject      *object,
         milter_manager_configuration_set_controller_connection_spec(
             config, g_value_get_string(value));
         break;
+    case PROP_CONTROLLER_METRICS_CONNECTION_SPEC:
+        milter_manager_configuration_set_controller_metrics_connection_spec(
+            config, g_value_get_string(value));
+        break;
     case PROP_MANAGER_CONNECTION_SPEC:
         milter_manager_configuration_set_manager_connection_spec(
             config, g_value_get_string(value));
@@ -675,6 +800,14 @@ set_property (GObject      *object,
     case PROP_N_WORKERS:
         milter_manager_configuration_set_n_workers(config, g_value_get_uint(value));
         break;
+    case PROP_REUSE_PORT:
+        milter_manager_configuration_set_reuse_port(config,
+                                                    g_value_get_boolean(value));
+        break;
+    case PROP_N_EVENT_LOOP_THREADS:
+        milter_manager_configuration_set_n_event_loop_threads(
+            config, g_value_get_uint(value));
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         milter_manager_configuration_set_default_packet_buffer_size(
             config,
@@ -696,6 +829,26 @@ set_property (GObject      *object,
         milter_manager_configuration_set_max_pending_finished_sessions(
             config, g_value_get_uint(value));
         break;
+    case PROP_MAX_ON_MEMORY_BODY_SIZE:
+        milter_manager_configuration_set_max_on_memory_body_size(
+            config, g_value_get_uint64(value));
+        break;
+    case PROP_MAX_ON_MEMORY_BODY_TOTAL_SIZE:
+        milter_manager_configuration_set_max_on_memory_body_total_size(
+            config, g_value_get_uint64(value));
+        break;
+    case PROP_USE_MEMFD_BODY_SPOOL:
+        milter_manager_configuration_set_use_memfd_body_spool(
+            config, g_value_get_boolean(value));
+        break;
+    case PROP_SHORT_CIRCUIT_REJECT:
+        milter_manager_configuration_set_short_circuit_reject(
+            config, g_value_get_boolean(value));
+        break;
+    case PROP_CONNECTION_TABLE:
+        milter_manager_configuration_set_connection_table(
+            config, g_value_get_object(value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -718,6 +871,9 @@ get_property (GObject    *object,
     case PROP_CONTROLLER_CONNECTION_SPEC:
         g_value_set_string(value, priv->controller_connection_spec);
         break;
+    case PROP_CONTROLLER_METRICS_CONNECTION_SPEC:
+        g_value_set_string(value, priv->controller_metrics_connection_spec);
+        break;
     case PROP_MANAGER_CONNECTION_SPEC:
         g_value_set_string(value, priv->manager_connection_spec);
         break;
@@ -793,6 +949,12 @@ get_property (GObject    *object,
     case PROP_N_WORKERS:
         g_value_set_uint(value, priv->n_workers);
         break;
+    case PROP_REUSE_PORT:
+        g_value_set_boolean(value, priv->reuse_port);
+        break;
+    case PROP_N_EVENT_LOOP_THREADS:
+        g_value_set_uint(value, priv->n_event_loop_threads);
+        break;
     case PROP_DEFAULT_PACKET_BUFFER_SIZE:
         g_value_set_uint(value, priv->default_packet_buffer_size);
         break;
@@ -811,6 +973,21 @@ get_property (GObject    *object,
     case PROP_MAX_PENDING_FINISHED_SESSIONS:
         g_value_set_uint(value, priv->max_pending_finished_sessions);
         break;
+    case PROP_MAX_ON_MEMORY_BODY_SIZE:
+        g_value_set_uint64(value, priv->max_on_memory_body_size);
+        break;
+    case PROP_MAX_ON_MEMORY_BODY_TOTAL_SIZE:
+        g_value_set_uint64(value, priv->max_on_memory_body_total_size);
+        break;
+    case PROP_USE_MEMFD_BODY_SPOOL:
+        g_value_set_boolean(value, priv->use_memfd_body_spool);
+        break;
+    case PROP_SHORT_CIRCUIT_REJECT:
+        g_value_set_boolean(value, priv->short_circuit_reject);
+        break;
+    case PROP_CONNECTION_TABLE:
+        g_value_set_object(value, priv->connection_table);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -1156,13 +1333,20 @@ gboolean
 milter_manager_configuration_reload (MilterManagerConfiguration *configuration,
                                      GError **error)
 {
+    MilterManagerConfigurationPrivate *priv;
     GError *local_error = NULL;
+    gboolean success = FALSE;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+
+    /* Event loop threads may be hatching children from eggs. */
+    g_rw_lock_writer_lock(&(priv->reload_lock));
 
     if (!milter_manager_configuration_clear(configuration, &local_error)) {
         milter_error("[configuration][load][clear][error] <%s>: %s",
                      CONFIG_FILE_NAME, local_error->message);
         g_propagate_error(error, local_error);
-        return FALSE;
+        goto cleanup;
     }
 
     if (!milter_manager_configuration_load(configuration, CONFIG_FILE_NAME,
@@ -1170,7 +1354,7 @@ milter_manager_configuration_reload (MilterManagerConfiguration *configuration,
         milter_error("[configuration][load][error] <%s>: %s",
                      CONFIG_FILE_NAME, local_error->message);
         g_propagate_error(error, local_error);
-        return FALSE;
+        goto cleanup;
     }
 
     if (!milter_manager_configuration_load_custom_if_exist(
@@ -1178,10 +1362,14 @@ milter_manager_configuration_reload (MilterManagerConfiguration *configuration,
         milter_error("[configuration][load][custom][error] <%s>: %s",
                      CUSTOM_CONFIG_FILE_NAME, local_error->message);
         g_propagate_error(error, local_error);
-        return FALSE;
+        goto cleanup;
     }
 
-    return TRUE;
+    success = TRUE;
+
+cleanup:
+    g_rw_lock_writer_unlock(&(priv->reload_lock));
+    return success;
 }
 
 gboolean
@@ -1266,6 +1454,24 @@ milter_manager_configuration_set_controller_connection_spec (MilterManagerConfig
     priv->controller_connection_spec = g_strdup(spec);
 }
 
+const gchar *
+milter_manager_configuration_get_controller_metrics_connection_spec (MilterManagerConfiguration *configuration)
+{
+    return MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration)->controller_metrics_connection_spec;
+}
+
+void
+milter_manager_configuration_set_controller_metrics_connection_spec (MilterManagerConfiguration *configuration,
+                                                                     const gchar *spec)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    if (priv->controller_metrics_connection_spec)
+        g_free(priv->controller_metrics_connection_spec);
+    priv->controller_metrics_connection_spec = g_strdup(spec);
+}
+
 const gchar *
 milter_manager_configuration_get_manager_connection_spec (MilterManagerConfiguration *configuration)
 {
@@ -1747,6 +1953,7 @@ milter_manager_configuration_setup_children (MilterManagerConfiguration *configu
 
     priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
 
+    g_rw_lock_reader_lock(&(priv->reload_lock));
     for (node = priv->eggs; node; node = g_list_next(node)) {
         MilterManagerChild *child;
         MilterManagerEgg *egg = node->data;
@@ -1763,6 +1970,47 @@ milter_manager_configuration_setup_children (MilterManagerConfiguration *configu
             g_object_unref(child);
         }
     }
+    g_rw_lock_reader_unlock(&(priv->reload_lock));
+}
+
+/**
+ * milter_manager_configuration_has_session_handlers:
+ * @configuration: A #MilterManagerConfiguration.
+ *
+ * Returns: %TRUE if signal handlers that are called for each
+ *   session, such as connection checkers and applicable
+ *   conditions of eggs, are connected, %FALSE otherwise.
+ *   They may not be called in event loop threads.
+ */
+gboolean
+milter_manager_configuration_has_session_handlers (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+    GList *node;
+    guint attach_to_signal_id;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+
+    if (g_signal_has_handler_pending(configuration, signals[CONNECTED],
+                                     0, FALSE))
+        return TRUE;
+
+    attach_to_signal_id =
+        g_signal_lookup("attach-to", MILTER_TYPE_MANAGER_APPLICABLE_CONDITION);
+    for (node = priv->eggs; node; node = g_list_next(node)) {
+        MilterManagerEgg *egg = node->data;
+        const GList *condition_node;
+
+        condition_node = milter_manager_egg_get_applicable_conditions(egg);
+        for (; condition_node; condition_node = g_list_next(condition_node)) {
+            if (g_signal_has_handler_pending(condition_node->data,
+                                             attach_to_signal_id,
+                                             0, FALSE))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
 }
 
 MilterStatus
@@ -1963,6 +2211,11 @@ clear_controller (MilterManagerConfigurationPrivate *priv)
         priv->controller_connection_spec = NULL;
     }
 
+    if (priv->controller_metrics_connection_spec) {
+        g_free(priv->controller_metrics_connection_spec);
+        priv->controller_metrics_connection_spec = NULL;
+    }
+
     if (priv->controller_unix_socket_group) {
         g_free(priv->controller_unix_socket_group);
         priv->controller_unix_socket_group = NULL;
@@ -1991,9 +2244,20 @@ clear_manager (MilterManagerConfigurationPrivate *priv)
     priv->connection_check_interval = DEFAULT_CONNECTION_CHECK_INTERVAL;
     priv->event_loop_backend = MILTER_CLIENT_EVENT_LOOP_BACKEND_GLIB;
     priv->n_workers = 0;
+    priv->reuse_port = FALSE;
+    priv->n_event_loop_threads = 0;
     priv->default_packet_buffer_size = 0;
     priv->chunk_size = MILTER_CHUNK_SIZE;
     priv->max_pending_finished_sessions = 0;
+    priv->max_on_memory_body_size =
+        MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE;
+    priv->max_on_memory_body_total_size = 0;
+    priv->use_memfd_body_spool = FALSE;
+    priv->short_circuit_reject = FALSE;
+    if (priv->connection_table) {
+        g_object_unref(priv->connection_table);
+        priv->connection_table = NULL;
+    }
 }
 
 static void
@@ -2380,6 +2644,44 @@ milter_manager_configuration_set_n_workers (MilterManagerConfiguration *configur
     priv->n_workers = n_workers;
 }
 
+gboolean
+milter_manager_configuration_is_reuse_port (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->reuse_port;
+}
+
+void
+milter_manager_configuration_set_reuse_port (MilterManagerConfiguration *configuration,
+                                             gboolean                    reuse_port)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->reuse_port = reuse_port;
+}
+
+guint
+milter_manager_configuration_get_n_event_loop_threads (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->n_event_loop_threads;
+}
+
+void
+milter_manager_configuration_set_n_event_loop_threads (MilterManagerConfiguration *configuration,
+                                                       guint                       n_threads)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->n_event_loop_threads = n_threads;
+}
+
 guint
 milter_manager_configuration_get_default_packet_buffer_size (MilterManagerConfiguration *configuration)
 {
@@ -2484,6 +2786,135 @@ milter_manager_configuration_set_max_pending_finished_sessions (MilterManagerCon
     priv->max_pending_finished_sessions = n_sessions;
 }
 
+gsize
+milter_manager_configuration_get_max_on_memory_body_size (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->max_on_memory_body_size;
+}
+
+void
+milter_manager_configuration_set_max_on_memory_body_size (MilterManagerConfiguration *configuration,
+                                                          gsize                       size)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->max_on_memory_body_size = size;
+}
+
+gsize
+milter_manager_configuration_get_max_on_memory_body_total_size (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->max_on_memory_body_total_size;
+}
+
+void
+milter_manager_configuration_set_max_on_memory_body_total_size (MilterManagerConfiguration *configuration,
+                                                                gsize                       size)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->max_on_memory_body_total_size = size;
+}
+
+gboolean
+milter_manager_configuration_get_use_memfd_body_spool (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->use_memfd_body_spool;
+}
+
+void
+milter_manager_configuration_set_use_memfd_body_spool (MilterManagerConfiguration *configuration,
+                                                       gboolean                    use_memfd)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->use_memfd_body_spool = use_memfd;
+}
+
+gboolean
+milter_manager_configuration_get_short_circuit_reject (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->short_circuit_reject;
+}
+
+void
+milter_manager_configuration_set_short_circuit_reject (MilterManagerConfiguration *configuration,
+                                                       gboolean                    short_circuit_reject)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    priv->short_circuit_reject = short_circuit_reject;
+}
+
+MilterManagerConnectionTable *
+milter_manager_configuration_get_connection_table (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    return priv->connection_table;
+}
+
+/**
+ * milter_manager_configuration_ref_connection_table:
+ * @configuration: A #MilterManagerConfiguration.
+ *
+ * Gets the connection table with a new reference. Use this
+ * instead of milter_manager_configuration_get_connection_table()
+ * in event loop threads because reloading configuration in
+ * the main thread may release the connection table.
+ *
+ * Returns: (transfer full) (nullable): The connection table.
+ *   It should be released by g_object_unref().
+ */
+MilterManagerConnectionTable *
+milter_manager_configuration_ref_connection_table (MilterManagerConfiguration *configuration)
+{
+    MilterManagerConfigurationPrivate *priv;
+    MilterManagerConnectionTable *table = NULL;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+
+    g_rw_lock_reader_lock(&(priv->reload_lock));
+    if (priv->connection_table)
+        table = g_object_ref(priv->connection_table);
+    g_rw_lock_reader_unlock(&(priv->reload_lock));
+
+    return table;
+}
+
+void
+milter_manager_configuration_set_connection_table (MilterManagerConfiguration   *configuration,
+                                                   MilterManagerConnectionTable *table)
+{
+    MilterManagerConfigurationPrivate *priv;
+
+    priv = MILTER_MANAGER_CONFIGURATION_GET_PRIVATE(configuration);
+    if (priv->connection_table == table)
+        return;
+    if (priv->connection_table)
+        g_object_unref(priv->connection_table);
+    priv->connection_table = table;
+    if (priv->connection_table)
+        g_object_ref(priv->connection_table);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -25,6 +25,7 @@
 #include <milter/manager/milter-manager-objects.h>
 #include <milter/manager/milter-manager-child.h>
 #include <milter/manager/milter-manager-egg.h>
+#include <milter/manager/milter-manager-connection-table.h>
 
 G_BEGIN_DECLS
 
@@ -139,6 +140,11 @@ const gchar  *milter_manager_configuration_get_controller_connection_spec
 void          milter_manager_configuration_set_controller_connection_spec
                                      (MilterManagerConfiguration *configuration,
                                       const gchar                *spec);
+const gchar  *milter_manager_configuration_get_controller_metrics_connection_spec
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_controller_metrics_connection_spec
+                                     (MilterManagerConfiguration *configuration,
+                                      const gchar                *spec);
 
 const gchar  *milter_manager_configuration_get_manager_connection_spec
                                      (MilterManagerConfiguration *configuration);
@@ -289,6 +295,8 @@ void          milter_manager_configuration_setup_children
                                      (MilterManagerConfiguration *configuration,
                                       MilterManagerChildren      *children,
                                       MilterClientContext        *context);
+gboolean      milter_manager_configuration_has_session_handlers
+                                     (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_add_applicable_condition
                                      (MilterManagerConfiguration *configuration,
                                       MilterManagerApplicableCondition *condition);
@@ -363,6 +371,18 @@ void          milter_manager_configuration_set_n_workers
                                      (MilterManagerConfiguration *configuration,
                                       guint                       n_workers);
 
+gboolean      milter_manager_configuration_is_reuse_port
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_reuse_port
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    reuse_port);
+
+guint         milter_manager_configuration_get_n_event_loop_threads
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_n_event_loop_threads
+                                     (MilterManagerConfiguration *configuration,
+                                      guint                       n_threads);
+
 guint         milter_manager_configuration_get_default_packet_buffer_size
                                      (MilterManagerConfiguration *configuration);
 void          milter_manager_configuration_set_default_packet_buffer_size
@@ -396,6 +416,40 @@ void          milter_manager_configuration_set_max_pending_finished_sessions
                                      (MilterManagerConfiguration *configuration,
                                       guint                       n_sessions);
 
+gsize         milter_manager_configuration_get_max_on_memory_body_size
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_max_on_memory_body_size
+                                     (MilterManagerConfiguration *configuration,
+                                      gsize                       size);
+
+gsize         milter_manager_configuration_get_max_on_memory_body_total_size
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_max_on_memory_body_total_size
+                                     (MilterManagerConfiguration *configuration,
+                                      gsize                       size);
+
+gboolean      milter_manager_configuration_get_use_memfd_body_spool
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_use_memfd_body_spool
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    use_memfd);
+
+gboolean      milter_manager_configuration_get_short_circuit_reject
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_short_circuit_reject
+                                     (MilterManagerConfiguration *configuration,
+                                      gboolean                    short_circuit_reject);
+
+MilterManagerConnectionTable *
+              milter_manager_configuration_get_connection_table
+                                     (MilterManagerConfiguration *configuration);
+MilterManagerConnectionTable *
+              milter_manager_configuration_ref_connection_table
+                                     (MilterManagerConfiguration *configuration);
+void          milter_manager_configuration_set_connection_table
+                                     (MilterManagerConfiguration *configuration,
+                                      MilterManagerConnectionTable *table);
+
 G_END_DECLS
 
 #endif /* __MILTER_MANAGER_CONFIGURATION_H__ */
@@ -0,0 +1,698 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef __linux__
+#  include <linux/netlink.h>
+#  include <linux/sock_diag.h>
+#  include <linux/inet_diag.h>
+#  define USE_SOCK_DIAG 1
+#endif
+
+#include <milter/core.h>
+
+#include "milter-manager-connection-table.h"
+
+#define MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(obj)                \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                                 \
+                                 MILTER_TYPE_MANAGER_CONNECTION_TABLE,  \
+                                 MilterManagerConnectionTablePrivate))
+
+#define PROC_NET_TCP_PATH "/proc/net/tcp"
+#define PROC_NET_TCP6_PATH "/proc/net/tcp6"
+#define SOCK_DIAG_BUFFER_SIZE 32768
+
+/* Listening sockets never have a foreign address. */
+#define ALL_STATES_BUT_LISTEN                           \
+    (((1 << (MILTER_MANAGER_CONNECTION_STATE_CLOSING + 1)) - 1) &  \
+     ~(1 << MILTER_MANAGER_CONNECTION_STATE_LISTEN))
+
+/* IPv4 addresses including IPv4-mapped IPv6 addresses are stored as
+ * AF_INET. port is in host byte order. The whole struct is hashed so
+ * unused bytes must be zero. */
+typedef struct _Endpoint Endpoint;
+struct _Endpoint
+{
+    guint16 family;
+    guint16 port;
+    guint8 address[16];
+};
+
+typedef struct _Connection Connection;
+struct _Connection
+{
+    Endpoint foreign;
+    Endpoint local;
+    MilterManagerConnectionState state;
+};
+
+typedef struct _MilterManagerConnectionTablePrivate MilterManagerConnectionTablePrivate;
+struct _MilterManagerConnectionTablePrivate
+{
+    GArray *connections;
+    GHashTable *index;
+    gdouble lifetime;
+    gint64 last_update;
+    gboolean sock_diag_available;
+    MilterManagerConnectionTableSource source;
+    GMutex mutex;
+};
+
+G_DEFINE_TYPE(MilterManagerConnectionTable,
+              milter_manager_connection_table,
+              G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
+
+static void
+milter_manager_connection_table_class_init (MilterManagerConnectionTableClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerConnectionTablePrivate));
+}
+
+static guint
+endpoint_hash (gconstpointer key)
+{
+    const Endpoint *endpoint = key;
+    const guint8 *data = key;
+    guint hash = 5381;
+    gsize i, size;
+
+    size = G_STRUCT_OFFSET(Endpoint, address);
+    if (endpoint->family == AF_INET6)
+        size += sizeof(struct in6_addr);
+    else
+        size += sizeof(struct in_addr);
+    for (i = 0; i < size; i++)
+        hash = hash * 33 + data[i];
+    return hash;
+}
+
+static gboolean
+endpoint_equal (gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, sizeof(Endpoint)) == 0;
+}
+
+static void
+milter_manager_connection_table_init (MilterManagerConnectionTable *table)
+{
+    MilterManagerConnectionTablePrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+    priv->connections = g_array_new(FALSE, TRUE, sizeof(Connection));
+    priv->index = g_hash_table_new(endpoint_hash, endpoint_equal);
+    priv->lifetime = MILTER_MANAGER_CONNECTION_TABLE_DEFAULT_LIFETIME;
+    priv->last_update = 0;
+#ifdef USE_SOCK_DIAG
+    priv->sock_diag_available = TRUE;
+#else
+    priv->sock_diag_available = FALSE;
+#endif
+    priv->source = MILTER_MANAGER_CONNECTION_TABLE_SOURCE_NONE;
+    g_mutex_init(&(priv->mutex));
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerConnectionTablePrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(object);
+
+    if (priv->index) {
+        g_hash_table_unref(priv->index);
+        priv->index = NULL;
+    }
+
+    if (priv->connections) {
+        g_array_free(priv->connections, TRUE);
+        priv->connections = NULL;
+    }
+
+    G_OBJECT_CLASS(milter_manager_connection_table_parent_class)->dispose(object);
+}
+
+static void
+finalize (GObject *object)
+{
+    MilterManagerConnectionTablePrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(object);
+    g_mutex_clear(&(priv->mutex));
+
+    G_OBJECT_CLASS(milter_manager_connection_table_parent_class)->finalize(object);
+}
+
+GQuark
+milter_manager_connection_table_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-connection-table-error-quark");
+}
+
+MilterManagerConnectionTable *
+milter_manager_connection_table_new (void)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_CONNECTION_TABLE,
+                        NULL);
+}
+
+void
+milter_manager_connection_table_set_lifetime (MilterManagerConnectionTable *table,
+                                              gdouble lifetime)
+{
+    MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table)->lifetime = lifetime;
+}
+
+gdouble
+milter_manager_connection_table_get_lifetime (MilterManagerConnectionTable *table)
+{
+    return MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table)->lifetime;
+}
+
+MilterManagerConnectionTableSource
+milter_manager_connection_table_get_source (MilterManagerConnectionTable *table)
+{
+    return MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table)->source;
+}
+
+guint
+milter_manager_connection_table_get_size (MilterManagerConnectionTable *table)
+{
+    MilterManagerConnectionTablePrivate *priv;
+    guint size;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+    g_mutex_lock(&(priv->mutex));
+    size = g_hash_table_size(priv->index);
+    g_mutex_unlock(&(priv->mutex));
+    return size;
+}
+
+static void
+endpoint_set (Endpoint *endpoint, gint family, const guint8 *address,
+              guint16 port)
+{
+    static const guint8 ipv4_mapped_prefix[] =
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->port = port;
+    if (family == AF_INET6 &&
+        memcmp(address, ipv4_mapped_prefix, sizeof(ipv4_mapped_prefix)) != 0) {
+        endpoint->family = AF_INET6;
+        memcpy(endpoint->address, address, sizeof(struct in6_addr));
+    } else {
+        endpoint->family = AF_INET;
+        if (family == AF_INET6)
+            address += sizeof(ipv4_mapped_prefix);
+        memcpy(endpoint->address, address, sizeof(struct in_addr));
+    }
+}
+
+static gboolean
+endpoint_set_socket_address (Endpoint *endpoint,
+                             const struct sockaddr *address,
+                             socklen_t address_length)
+{
+    if (!address)
+        return FALSE;
+
+    switch (address->sa_family) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+
+        if (address_length < sizeof(struct sockaddr_in))
+            return FALSE;
+        address_inet = (const struct sockaddr_in *)address;
+        endpoint_set(endpoint, AF_INET,
+                     (const guint8 *)&(address_inet->sin_addr),
+                     g_ntohs(address_inet->sin_port));
+        return TRUE;
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+
+        if (address_length < sizeof(struct sockaddr_in6))
+            return FALSE;
+        address_inet6 = (const struct sockaddr_in6 *)address;
+        endpoint_set(endpoint, AF_INET6,
+                     (const guint8 *)&(address_inet6->sin6_addr),
+                     g_ntohs(address_inet6->sin6_port));
+        return TRUE;
+    }
+    default:
+        return FALSE;
+    }
+}
+
+static struct sockaddr *
+endpoint_to_socket_address (const Endpoint *endpoint, socklen_t *length)
+{
+    if (endpoint->family == AF_INET6) {
+        struct sockaddr_in6 *address_inet6;
+
+        address_inet6 = g_new0(struct sockaddr_in6, 1);
+        address_inet6->sin6_family = AF_INET6;
+        address_inet6->sin6_port = g_htons(endpoint->port);
+        memcpy(&(address_inet6->sin6_addr), endpoint->address,
+               sizeof(struct in6_addr));
+        *length = sizeof(*address_inet6);
+        return (struct sockaddr *)address_inet6;
+    } else {
+        struct sockaddr_in *address_inet;
+
+        address_inet = g_new0(struct sockaddr_in, 1);
+        address_inet->sin_family = AF_INET;
+        address_inet->sin_port = g_htons(endpoint->port);
+        memcpy(&(address_inet->sin_addr), endpoint->address,
+               sizeof(struct in_addr));
+        *length = sizeof(*address_inet);
+        return (struct sockaddr *)address_inet;
+    }
+}
+
+static void
+add_connection (MilterManagerConnectionTablePrivate *priv,
+                gint family,
+                const guint8 *local_address, guint16 local_port,
+                const guint8 *foreign_address, guint16 foreign_port,
+                guint state)
+{
+    Connection *connection;
+
+    if (state == MILTER_MANAGER_CONNECTION_STATE_LISTEN ||
+        state > MILTER_MANAGER_CONNECTION_STATE_CLOSING)
+        return;
+
+    g_array_set_size(priv->connections, priv->connections->len + 1);
+    connection = &g_array_index(priv->connections, Connection,
+                                priv->connections->len - 1);
+    endpoint_set(&(connection->local), family, local_address, local_port);
+    endpoint_set(&(connection->foreign), family, foreign_address, foreign_port);
+    connection->state = state;
+}
+
+#ifdef USE_SOCK_DIAG
+static gboolean
+sock_diag_dump (MilterManagerConnectionTablePrivate *priv, gint fd,
+                gint family, GError **error)
+{
+    struct {
+        struct nlmsghdr header;
+        struct inet_diag_req_v2 request;
+    } message;
+    struct sockaddr_nl address;
+    guint8 buffer[SOCK_DIAG_BUFFER_SIZE];
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+
+    memset(&message, 0, sizeof(message));
+    message.header.nlmsg_len = sizeof(message);
+    message.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    message.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    message.request.sdiag_family = family;
+    message.request.sdiag_protocol = IPPROTO_TCP;
+    message.request.idiag_states = ALL_STATES_BUT_LISTEN;
+
+    if (sendto(fd, &message, sizeof(message), 0,
+               (struct sockaddr *)&address, sizeof(address)) < 0) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR_READ,
+                    "failed to send sock_diag request: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    while (TRUE) {
+        struct nlmsghdr *header;
+        ssize_t size;
+
+        size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            g_set_error(error,
+                        MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                        MILTER_MANAGER_CONNECTION_TABLE_ERROR_READ,
+                        "failed to receive sock_diag response: %s",
+                        g_strerror(errno));
+            return FALSE;
+        }
+
+        for (header = (struct nlmsghdr *)buffer;
+             NLMSG_OK(header, size);
+             header = NLMSG_NEXT(header, size)) {
+            struct inet_diag_msg *diag;
+
+            if (header->nlmsg_type == NLMSG_DONE)
+                return TRUE;
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *netlink_error = NLMSG_DATA(header);
+                g_set_error(error,
+                            MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                            MILTER_MANAGER_CONNECTION_TABLE_ERROR_NOT_AVAILABLE,
+                            "sock_diag returns an error: %s",
+                            g_strerror(-netlink_error->error));
+                return FALSE;
+            }
+            if (header->nlmsg_type != SOCK_DIAG_BY_FAMILY)
+                continue;
+
+            diag = NLMSG_DATA(header);
+            add_connection(priv, diag->idiag_family,
+                           (const guint8 *)diag->id.idiag_src,
+                           g_ntohs(diag->id.idiag_sport),
+                           (const guint8 *)diag->id.idiag_dst,
+                           g_ntohs(diag->id.idiag_dport),
+                           diag->idiag_state);
+        }
+    }
+}
+
+static gboolean
+update_by_sock_diag (MilterManagerConnectionTablePrivate *priv,
+                     GError **error)
+{
+    gint fd;
+    gboolean success;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR_NOT_AVAILABLE,
+                    "failed to open sock_diag socket: %s",
+                    g_strerror(errno));
+        return FALSE;
+    }
+
+    success = sock_diag_dump(priv, fd, AF_INET, error) &&
+        sock_diag_dump(priv, fd, AF_INET6, error);
+    close(fd);
+    return success;
+}
+#endif
+
+/* Addresses in /proc/net/tcp{,6} are 32bit words in host byte order
+ * that hold network byte order data. */
+static gboolean
+parse_proc_address (const gchar *hex, guint8 *address, gsize address_size)
+{
+    gsize i;
+
+    if (strlen(hex) != address_size * 2)
+        return FALSE;
+
+    for (i = 0; i < address_size; i += sizeof(guint32)) {
+        gchar word_hex[9];
+        guint32 word;
+
+        memcpy(word_hex, hex + i * 2, 8);
+        word_hex[8] = '\0';
+        word = (guint32)strtoul(word_hex, NULL, 16);
+        memcpy(address + i, &word, sizeof(word));
+    }
+    return TRUE;
+}
+
+static gboolean
+update_by_proc_file (MilterManagerConnectionTablePrivate *priv,
+                     const gchar *path, gint family,
+                     gboolean *found, GError **error)
+{
+    FILE *file;
+    gchar line[512];
+    gsize address_size;
+
+    file = fopen(path, "r");
+    if (!file) {
+        if (errno == ENOENT)
+            return TRUE;
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR_READ,
+                    "failed to open <%s>: %s",
+                    path, g_strerror(errno));
+        return FALSE;
+    }
+    *found = TRUE;
+
+    if (family == AF_INET6)
+        address_size = sizeof(struct in6_addr);
+    else
+        address_size = sizeof(struct in_addr);
+
+    /* The first line is the header. */
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return TRUE;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        gchar local_hex[33], foreign_hex[33];
+        guint local_port, foreign_port, state;
+        guint8 local_address[16], foreign_address[16];
+
+        if (sscanf(line, " %*u: %32[0-9A-Fa-f]:%x %32[0-9A-Fa-f]:%x %x",
+                   local_hex, &local_port,
+                   foreign_hex, &foreign_port,
+                   &state) != 5)
+            continue;
+        if (!parse_proc_address(local_hex, local_address, address_size) ||
+            !parse_proc_address(foreign_hex, foreign_address, address_size))
+            continue;
+        add_connection(priv, family,
+                       local_address, local_port,
+                       foreign_address, foreign_port,
+                       state);
+    }
+    fclose(file);
+
+    return TRUE;
+}
+
+static gboolean
+update_by_proc (MilterManagerConnectionTablePrivate *priv, GError **error)
+{
+    gboolean found = FALSE;
+
+    if (!update_by_proc_file(priv, PROC_NET_TCP_PATH, AF_INET, &found, error))
+        return FALSE;
+    if (!update_by_proc_file(priv, PROC_NET_TCP6_PATH, AF_INET6, &found, error))
+        return FALSE;
+
+    if (!found) {
+        g_set_error(error,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR,
+                    MILTER_MANAGER_CONNECTION_TABLE_ERROR_NOT_AVAILABLE,
+                    "neither sock_diag nor <%s> is available",
+                    PROC_NET_TCP_PATH);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+build_index (MilterManagerConnectionTablePrivate *priv)
+{
+    guint i;
+
+    for (i = 0; i < priv->connections->len; i++) {
+        Connection *connection;
+
+        connection = &g_array_index(priv->connections, Connection, i);
+        g_hash_table_replace(priv->index, &(connection->foreign), connection);
+    }
+}
+
+static gboolean
+update (MilterManagerConnectionTablePrivate *priv, GError **error)
+{
+    gboolean success = FALSE;
+
+    g_hash_table_remove_all(priv->index);
+    g_array_set_size(priv->connections, 0);
+    priv->last_update = g_get_monotonic_time();
+
+#ifdef USE_SOCK_DIAG
+    if (priv->sock_diag_available) {
+        GError *sock_diag_error = NULL;
+
+        success = update_by_sock_diag(priv, &sock_diag_error);
+        if (success) {
+            priv->source = MILTER_MANAGER_CONNECTION_TABLE_SOURCE_SOCK_DIAG;
+        } else {
+            milter_debug("[connection-table][sock-diag][fallback] %s",
+                         sock_diag_error->message);
+            g_error_free(sock_diag_error);
+            priv->sock_diag_available = FALSE;
+            g_array_set_size(priv->connections, 0);
+        }
+    }
+#endif
+
+    if (!success) {
+        success = update_by_proc(priv, error);
+        if (success)
+            priv->source = MILTER_MANAGER_CONNECTION_TABLE_SOURCE_PROC;
+        else
+            priv->source = MILTER_MANAGER_CONNECTION_TABLE_SOURCE_NONE;
+    }
+
+    build_index(priv);
+
+    return success;
+}
+
+gboolean
+milter_manager_connection_table_update (MilterManagerConnectionTable *table,
+                                        GError **error)
+{
+    MilterManagerConnectionTablePrivate *priv;
+    gboolean success;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+
+    g_mutex_lock(&(priv->mutex));
+    success = update(priv, error);
+    g_mutex_unlock(&(priv->mutex));
+
+    return success;
+}
+
+gboolean
+milter_manager_connection_table_ensure_updated (MilterManagerConnectionTable *table)
+{
+    MilterManagerConnectionTablePrivate *priv;
+    gint64 now;
+    gboolean available;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+
+    /* Event loop threads share the table. */
+    g_mutex_lock(&(priv->mutex));
+    now = g_get_monotonic_time();
+    if (priv->last_update == 0 ||
+        now - priv->last_update > priv->lifetime * G_USEC_PER_SEC) {
+        GError *error = NULL;
+
+        if (!update(priv, &error)) {
+            milter_error("[connection-table][error][update] %s",
+                         error->message);
+            g_error_free(error);
+        }
+    }
+    available = priv->source != MILTER_MANAGER_CONNECTION_TABLE_SOURCE_NONE;
+    g_mutex_unlock(&(priv->mutex));
+
+    return available;
+}
+
+void
+milter_manager_connection_table_purge (MilterManagerConnectionTable *table)
+{
+    MilterManagerConnectionTablePrivate *priv;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+    g_mutex_lock(&(priv->mutex));
+    g_hash_table_remove_all(priv->index);
+    g_array_set_size(priv->connections, 0);
+    priv->last_update = 0;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+MilterManagerConnectionState
+milter_manager_connection_table_lookup (MilterManagerConnectionTable *table,
+                                        const struct sockaddr *foreign_address,
+                                        socklen_t foreign_address_length,
+                                        struct sockaddr **local_address,
+                                        socklen_t *local_address_length)
+{
+    MilterManagerConnectionTablePrivate *priv;
+    Endpoint foreign;
+    Connection *connection;
+    MilterManagerConnectionState state = MILTER_MANAGER_CONNECTION_STATE_UNKNOWN;
+
+    priv = MILTER_MANAGER_CONNECTION_TABLE_GET_PRIVATE(table);
+    if (!endpoint_set_socket_address(&foreign,
+                                     foreign_address, foreign_address_length))
+        return MILTER_MANAGER_CONNECTION_STATE_UNKNOWN;
+
+    g_mutex_lock(&(priv->mutex));
+    connection = g_hash_table_lookup(priv->index, &foreign);
+    if (connection) {
+        if (local_address) {
+            socklen_t length;
+
+            *local_address = endpoint_to_socket_address(&(connection->local),
+                                                        &length);
+            if (local_address_length)
+                *local_address_length = length;
+        }
+        state = connection->state;
+    }
+    g_mutex_unlock(&(priv->mutex));
+
+    return state;
+}
+
+gboolean
+milter_manager_connection_table_is_connected (MilterManagerConnectionTable *table,
+                                              const struct sockaddr *foreign_address,
+                                              socklen_t foreign_address_length)
+{
+    MilterManagerConnectionState state;
+
+    state = milter_manager_connection_table_lookup(table,
+                                                   foreign_address,
+                                                   foreign_address_length,
+                                                   NULL, NULL);
+    /* The SMTP client has closed the connection but the SMTP server
+     * doesn't notice it yet. */
+    return state != MILTER_MANAGER_CONNECTION_STATE_CLOSE_WAIT;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,125 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_CONNECTION_TABLE_H__
+#define __MILTER_MANAGER_CONNECTION_TABLE_H__
+
+#include <glib-object.h>
+#include <sys/socket.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_CONNECTION_TABLE_DEFAULT_LIFETIME 5.0
+
+#define MILTER_MANAGER_CONNECTION_TABLE_ERROR           (milter_manager_connection_table_error_quark())
+
+#define MILTER_TYPE_MANAGER_CONNECTION_TABLE            (milter_manager_connection_table_get_type())
+#define MILTER_MANAGER_CONNECTION_TABLE(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_CONNECTION_TABLE, MilterManagerConnectionTable))
+#define MILTER_MANAGER_CONNECTION_TABLE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_CONNECTION_TABLE, MilterManagerConnectionTableClass))
+#define MILTER_MANAGER_IS_CONNECTION_TABLE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_CONNECTION_TABLE))
+#define MILTER_MANAGER_IS_CONNECTION_TABLE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_CONNECTION_TABLE))
+#define MILTER_MANAGER_CONNECTION_TABLE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_CONNECTION_TABLE, MilterManagerConnectionTableClass))
+
+typedef enum
+{
+    MILTER_MANAGER_CONNECTION_TABLE_ERROR_NOT_AVAILABLE,
+    MILTER_MANAGER_CONNECTION_TABLE_ERROR_READ
+} MilterManagerConnectionTableError;
+
+/* The same order as TCP states in Linux. */
+typedef enum
+{
+    MILTER_MANAGER_CONNECTION_STATE_UNKNOWN,
+    MILTER_MANAGER_CONNECTION_STATE_ESTABLISHED,
+    MILTER_MANAGER_CONNECTION_STATE_SYN_SENT,
+    MILTER_MANAGER_CONNECTION_STATE_SYN_RECV,
+    MILTER_MANAGER_CONNECTION_STATE_FIN_WAIT1,
+    MILTER_MANAGER_CONNECTION_STATE_FIN_WAIT2,
+    MILTER_MANAGER_CONNECTION_STATE_TIME_WAIT,
+    MILTER_MANAGER_CONNECTION_STATE_CLOSE,
+    MILTER_MANAGER_CONNECTION_STATE_CLOSE_WAIT,
+    MILTER_MANAGER_CONNECTION_STATE_LAST_ACK,
+    MILTER_MANAGER_CONNECTION_STATE_LISTEN,
+    MILTER_MANAGER_CONNECTION_STATE_CLOSING
+} MilterManagerConnectionState;
+
+typedef enum
+{
+    MILTER_MANAGER_CONNECTION_TABLE_SOURCE_NONE,
+    MILTER_MANAGER_CONNECTION_TABLE_SOURCE_SOCK_DIAG,
+    MILTER_MANAGER_CONNECTION_TABLE_SOURCE_PROC
+} MilterManagerConnectionTableSource;
+
+typedef struct _MilterManagerConnectionTable         MilterManagerConnectionTable;
+typedef struct _MilterManagerConnectionTableClass    MilterManagerConnectionTableClass;
+
+struct _MilterManagerConnectionTable
+{
+    GObject object;
+};
+
+struct _MilterManagerConnectionTableClass
+{
+    GObjectClass parent_class;
+};
+
+GQuark       milter_manager_connection_table_error_quark (void);
+
+GType        milter_manager_connection_table_get_type (void) G_GNUC_CONST;
+
+MilterManagerConnectionTable *milter_manager_connection_table_new (void);
+
+void         milter_manager_connection_table_set_lifetime
+                                   (MilterManagerConnectionTable *table,
+                                    gdouble                       lifetime);
+gdouble      milter_manager_connection_table_get_lifetime
+                                   (MilterManagerConnectionTable *table);
+MilterManagerConnectionTableSource
+             milter_manager_connection_table_get_source
+                                   (MilterManagerConnectionTable *table);
+guint        milter_manager_connection_table_get_size
+                                   (MilterManagerConnectionTable *table);
+
+gboolean     milter_manager_connection_table_update
+                                   (MilterManagerConnectionTable *table,
+                                    GError                      **error);
+gboolean     milter_manager_connection_table_ensure_updated
+                                   (MilterManagerConnectionTable *table);
+void         milter_manager_connection_table_purge
+                                   (MilterManagerConnectionTable *table);
+
+MilterManagerConnectionState
+             milter_manager_connection_table_lookup
+                                   (MilterManagerConnectionTable *table,
+                                    const struct sockaddr        *foreign_address,
+                                    socklen_t                     foreign_address_length,
+                                    struct sockaddr             **local_address,
+                                    socklen_t                    *local_address_length);
+gboolean     milter_manager_connection_table_is_connected
+                                   (MilterManagerConnectionTable *table,
+                                    const struct sockaddr        *foreign_address,
+                                    socklen_t                     foreign_address_length);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_CONNECTION_TABLE_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
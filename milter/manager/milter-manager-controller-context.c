@@ -211,10 +211,197 @@ cb_decoder_reload (MilterManagerControlCommandDecoder *decoder,
     }
 }
 
+static void
+append_uint_element (GString *status, const gchar *name, guint value,
+                     guint indent)
+{
+    gchar *content;
+
+    content = g_strdup_printf("%u", value);
+    milter_utils_xml_append_text_element(status, name, content, indent);
+    g_free(content);
+}
+
+static void
+collect_connection_pool_status (MilterManagerEgg *egg, GString *status,
+                                guint indent)
+{
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<connection-pool>\n");
+    append_uint_element(status, "size",
+                        milter_manager_egg_get_connection_pool_size(egg),
+                        indent + 2);
+    append_uint_element(status, "idle",
+                        milter_manager_egg_get_n_pooled_connections(egg),
+                        indent + 2);
+    append_uint_element(status, "reused",
+                        milter_manager_egg_get_n_reused_connections(egg),
+                        indent + 2);
+    append_uint_element(status, "missed",
+                        milter_manager_egg_get_n_missed_connections(egg),
+                        indent + 2);
+    append_uint_element(status, "released",
+                        milter_manager_egg_get_n_released_connections(egg),
+                        indent + 2);
+    append_uint_element(status, "expired",
+                        milter_manager_egg_get_n_expired_connections(egg),
+                        indent + 2);
+    append_uint_element(status, "broken",
+                        milter_manager_egg_get_n_broken_connections(egg),
+                        indent + 2);
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</connection-pool>\n");
+}
+
+static void
+collect_launch_status (MilterManagerEgg *egg, GString *status, guint indent)
+{
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<launch>\n");
+    append_uint_element(status, "launched",
+                        milter_manager_egg_get_n_launches(egg),
+                        indent + 2);
+    append_uint_element(status, "suppressed",
+                        milter_manager_egg_get_n_suppressed_launches(egg),
+                        indent + 2);
+    append_uint_element(status, "waiting",
+                        milter_manager_egg_get_n_alive_waiters(egg),
+                        indent + 2);
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</launch>\n");
+}
+
+static void
+collect_circuit_breaker_status (MilterManagerEgg *egg, GString *status,
+                                guint indent)
+{
+    gchar *state_name;
+    gchar *error_rate;
+
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<circuit-breaker>\n");
+    state_name = milter_utils_get_enum_nick_name(
+        MILTER_TYPE_MANAGER_CIRCUIT_BREAKER_STATE,
+        milter_manager_egg_get_circuit_breaker_state(egg));
+    milter_utils_xml_append_text_element(status, "state", state_name,
+                                         indent + 2);
+    g_free(state_name);
+    error_rate = g_strdup_printf(
+        "%g",
+        milter_manager_egg_get_circuit_breaker_current_error_rate(egg));
+    milter_utils_xml_append_text_element(status, "error-rate", error_rate,
+                                         indent + 2);
+    g_free(error_rate);
+    append_uint_element(status, "opened",
+                        milter_manager_egg_get_n_circuit_breaker_opens(egg),
+                        indent + 2);
+    append_uint_element(status, "rejected",
+                        milter_manager_egg_get_n_circuit_breaker_rejections(egg),
+                        indent + 2);
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</circuit-breaker>\n");
+}
+
+static void
+collect_milter_status (MilterManagerEgg *egg, MilterManagerMetrics *metrics,
+                       GString *status, guint indent)
+{
+    const gchar *name;
+
+    name = milter_manager_egg_get_name(egg);
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<milter>\n");
+    milter_utils_xml_append_text_element(status, "name", name, indent + 2);
+    if (metrics)
+        milter_manager_metrics_egg_to_xml_string(metrics, name, status,
+                                                 indent + 2);
+    if (milter_manager_egg_get_connection_pool_size(egg) > 0)
+        collect_connection_pool_status(egg, status, indent + 2);
+    if (metrics)
+        milter_manager_metrics_egg_launch_to_xml_string(metrics, name, status,
+                                                        indent + 2);
+    else if (milter_manager_egg_get_n_launches(egg) > 0)
+        collect_launch_status(egg, status, indent + 2);
+    if (milter_manager_egg_get_circuit_breaker_window_size(egg) > 0) {
+        if (metrics)
+            milter_manager_metrics_egg_circuit_breaker_to_xml_string(
+                metrics, name, status, indent + 2);
+        else
+            collect_circuit_breaker_status(egg, status, indent + 2);
+    }
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</milter>\n");
+}
+
+static void
+collect_sessions_status (MilterClient *client, GString *status, guint indent)
+{
+    guint i, n_workers;
+
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "<sessions>\n");
+    append_uint_element(status, "processing",
+                        milter_client_get_n_total_processing_sessions(client),
+                        indent + 2);
+    append_uint_element(status, "processed",
+                        milter_client_get_n_total_processed_sessions(client),
+                        indent + 2);
+
+    n_workers = milter_client_get_n_workers(client);
+    if (n_workers > 0) {
+        milter_utils_append_indent(status, indent + 2);
+        g_string_append(status, "<workers>\n");
+        for (i = 1; i <= n_workers; i++) {
+            milter_utils_append_indent(status, indent + 4);
+            g_string_append(status, "<worker>\n");
+            append_uint_element(status, "id", i, indent + 6);
+            append_uint_element(
+                status, "processing",
+                milter_client_get_worker_n_processing_sessions(client, i),
+                indent + 6);
+            append_uint_element(
+                status, "processed",
+                milter_client_get_worker_n_processed_sessions(client, i),
+                indent + 6);
+            milter_utils_append_indent(status, indent + 4);
+            g_string_append(status, "</worker>\n");
+        }
+        milter_utils_append_indent(status, indent + 2);
+        g_string_append(status, "</workers>\n");
+    }
+
+    milter_utils_append_indent(status, indent);
+    g_string_append(status, "</sessions>\n");
+}
+
 static void
 collect_status (MilterManagerControllerContext *context, GString *status)
 {
-    g_string_append(status, "FIXME");
+    MilterManagerControllerContextPrivate *priv;
+    MilterManagerConfiguration *config;
+    MilterManagerMetrics *metrics;
+    const GList *node;
+
+    priv = MILTER_MANAGER_CONTROLLER_CONTEXT_GET_PRIVATE(context);
+    config = milter_manager_get_configuration(priv->manager);
+    metrics = milter_manager_get_metrics(priv->manager);
+
+    g_string_append(status, "<status>\n");
+    collect_sessions_status(MILTER_CLIENT(priv->manager), status, 2);
+    if (metrics)
+        milter_manager_metrics_to_xml_string(metrics, status, 2);
+    milter_utils_append_indent(status, 2);
+    g_string_append(status, "<milters>\n");
+    for (node = milter_manager_configuration_get_eggs(config);
+         node;
+         node = g_list_next(node)) {
+        MilterManagerEgg *egg = node->data;
+
+        collect_milter_status(egg, metrics, status, 4);
+    }
+    milter_utils_append_indent(status, 2);
+    g_string_append(status, "</milters>\n");
+    g_string_append(status, "</status>\n");
 }
 
 static void
@@ -43,8 +43,28 @@ struct _MilterManagerControllerPrivate
     MilterEventLoop *event_loop;
     guint watch_id;
     gchar *spec;
+    guint metrics_watch_id;
+    gchar *metrics_spec;
+    GList *metrics_connections;
 };
 
+typedef struct _MetricsConnection MetricsConnection;
+struct _MetricsConnection
+{
+    MilterManagerController *controller;
+    GIOChannel *channel;
+    guint watch_id;
+    guint timeout_id;
+    GString *request;
+    gchar *response;
+    gsize response_size;
+    gsize written_size;
+};
+
+#define MAX_METRICS_REQUEST_SIZE 8192
+#define MAX_METRICS_CONNECTIONS 16
+#define METRICS_CONNECTION_TIMEOUT 10.0
+
 enum
 {
     PROP_0,
@@ -105,23 +125,23 @@ milter_manager_controller_init (MilterManagerController *controller)
     priv->event_loop = NULL;
     priv->watch_id = 0;
     priv->spec = NULL;
+    priv->metrics_watch_id = 0;
+    priv->metrics_spec = NULL;
+    priv->metrics_connections = NULL;
 }
 
 static void
-dispose_spec (MilterManagerControllerPrivate *priv)
+remove_unix_socket (MilterManagerControllerPrivate *priv, const gchar *spec)
 {
     MilterManagerConfiguration *config;
 
-    if (!priv->spec)
-        return;
-
     config = milter_manager_get_configuration(priv->manager);
     if (milter_manager_configuration_is_remove_controller_unix_socket_on_close(config)) {
         struct sockaddr *address = NULL;
         socklen_t address_size = 0;
         GError *error = NULL;
 
-        if (milter_connection_parse_spec(priv->spec,
+        if (milter_connection_parse_spec(spec,
                                          NULL, &address, &address_size,
                                          &error)) {
             if (address->sa_family == AF_UNIX) {
@@ -140,11 +160,58 @@ dispose_spec (MilterManagerControllerPrivate *priv)
             g_error_free(error);
         }
     }
+}
+
+static void
+dispose_spec (MilterManagerControllerPrivate *priv)
+{
+    if (!priv->spec)
+        return;
 
+    remove_unix_socket(priv, priv->spec);
     g_free(priv->spec);
     priv->spec = NULL;
 }
 
+static void
+metrics_connection_free (MetricsConnection *connection)
+{
+    MilterManagerControllerPrivate *priv;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(connection->controller);
+    priv->metrics_connections = g_list_remove(priv->metrics_connections,
+                                              connection);
+
+    if (connection->watch_id > 0)
+        milter_event_loop_remove(priv->event_loop, connection->watch_id);
+    if (connection->timeout_id > 0)
+        milter_event_loop_remove(priv->event_loop, connection->timeout_id);
+    g_io_channel_unref(connection->channel);
+    g_string_free(connection->request, TRUE);
+    g_free(connection->response);
+    g_free(connection);
+}
+
+static void
+dispose_metrics (MilterManagerControllerPrivate *priv)
+{
+    while (priv->metrics_connections) {
+        metrics_connection_free(priv->metrics_connections->data);
+    }
+
+    if (priv->metrics_watch_id > 0) {
+        milter_event_loop_remove(priv->event_loop, priv->metrics_watch_id);
+        priv->metrics_watch_id = 0;
+    }
+
+    if (!priv->metrics_spec)
+        return;
+
+    remove_unix_socket(priv, priv->metrics_spec);
+    g_free(priv->metrics_spec);
+    priv->metrics_spec = NULL;
+}
+
 static void
 dispose (GObject *object)
 {
@@ -158,6 +225,7 @@ dispose (GObject *object)
     }
 
     dispose_spec(priv);
+    dispose_metrics(priv);
 
     if (priv->manager) {
         g_object_unref(priv->manager);
@@ -427,6 +495,356 @@ listen_started (MilterManagerController *controller,
     change_unix_socket_mode(controller, address_un, config);
 }
 
+static gboolean
+cb_metrics_connection_write (GIOChannel *channel,
+                             GIOCondition condition,
+                             gpointer data)
+{
+    MetricsConnection *connection = data;
+
+    if (condition & G_IO_ERR ||
+        condition & G_IO_HUP ||
+        condition & G_IO_NVAL) {
+        gchar *message;
+
+        message = milter_utils_inspect_io_condition_error(condition);
+        milter_error("[controller][metrics][error][write] %s", message);
+        g_free(message);
+        connection->watch_id = 0;
+        metrics_connection_free(connection);
+        return FALSE;
+    }
+
+    while (connection->written_size < connection->response_size) {
+        GIOStatus status;
+        gsize written_size = 0;
+        GError *error = NULL;
+
+        status = g_io_channel_write_chars(
+            channel,
+            connection->response + connection->written_size,
+            connection->response_size - connection->written_size,
+            &written_size,
+            &error);
+        connection->written_size += written_size;
+        if (status == G_IO_STATUS_AGAIN)
+            return TRUE;
+        if (status != G_IO_STATUS_NORMAL) {
+            if (error) {
+                milter_error("[controller][metrics][error][write] %s",
+                             error->message);
+                g_error_free(error);
+            }
+            break;
+        }
+    }
+
+    connection->watch_id = 0;
+    metrics_connection_free(connection);
+    return FALSE;
+}
+
+static void
+metrics_connection_respond (MetricsConnection *connection,
+                            const gchar *status,
+                            const gchar *content_type,
+                            const gchar *body)
+{
+    MilterManagerControllerPrivate *priv;
+    GString *response;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(connection->controller);
+
+    response = g_string_new(NULL);
+    g_string_append_printf(response,
+                           "HTTP/1.0 %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           status, content_type, strlen(body));
+    g_string_append(response, body);
+    connection->response_size = response->len;
+    connection->response = g_string_free(response, FALSE);
+    connection->written_size = 0;
+
+    connection->watch_id =
+        milter_event_loop_watch_io(priv->event_loop, connection->channel,
+                                   G_IO_OUT | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+                                   cb_metrics_connection_write, connection);
+}
+
+static void
+process_metrics_request (MetricsConnection *connection)
+{
+    MilterManagerControllerPrivate *priv;
+    const gchar *request;
+    gchar *request_line;
+    gchar **parts;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(connection->controller);
+
+    request = connection->request->str;
+    request_line = g_strndup(request, strcspn(request, "\r\n"));
+    parts = g_strsplit(request_line, " ", 3);
+    milter_debug("[controller][metrics][request] <%s>", request_line);
+
+    if (g_strv_length(parts) < 2 || strcmp(parts[0], "GET") != 0) {
+        metrics_connection_respond(connection,
+                                   "405 Method Not Allowed",
+                                   "text/plain",
+                                   "Method Not Allowed\n");
+    } else if (strcmp(parts[1], "/metrics") != 0 &&
+               !g_str_has_prefix(parts[1], "/metrics?")) {
+        metrics_connection_respond(connection,
+                                   "404 Not Found",
+                                   "text/plain",
+                                   "Not Found\n");
+    } else {
+        MilterManagerMetrics *metrics;
+        gchar *body;
+
+        metrics = milter_manager_get_metrics(priv->manager);
+        body = milter_manager_metrics_to_open_metrics(metrics);
+        metrics_connection_respond(connection,
+                                   "200 OK",
+                                   "text/plain; version=0.0.4; charset=utf-8",
+                                   body);
+        g_free(body);
+    }
+
+    g_strfreev(parts);
+    g_free(request_line);
+}
+
+static gboolean
+is_metrics_request_completed (GString *request)
+{
+    return strstr(request->str, "\r\n\r\n") || strstr(request->str, "\n\n");
+}
+
+static gboolean
+cb_metrics_connection_read (GIOChannel *channel,
+                            GIOCondition condition,
+                            gpointer data)
+{
+    MetricsConnection *connection = data;
+
+    if (condition & G_IO_IN ||
+        condition & G_IO_PRI) {
+        gchar buffer[4096];
+        gsize read_size = 0;
+        GIOStatus status;
+        GError *error = NULL;
+
+        status = g_io_channel_read_chars(channel, buffer, sizeof(buffer),
+                                         &read_size, &error);
+        if (status == G_IO_STATUS_AGAIN)
+            return TRUE;
+        if (status == G_IO_STATUS_NORMAL) {
+            g_string_append_len(connection->request, buffer, read_size);
+            if (is_metrics_request_completed(connection->request)) {
+                connection->watch_id = 0;
+                process_metrics_request(connection);
+                return FALSE;
+            }
+            if (connection->request->len > MAX_METRICS_REQUEST_SIZE) {
+                connection->watch_id = 0;
+                metrics_connection_respond(connection,
+                                           "431 Request Header Fields Too Large",
+                                           "text/plain",
+                                           "Request Header Fields Too Large\n");
+                return FALSE;
+            }
+            return TRUE;
+        }
+        if (error) {
+            milter_error("[controller][metrics][error][read] %s",
+                         error->message);
+            g_error_free(error);
+        }
+    }
+
+    connection->watch_id = 0;
+    metrics_connection_free(connection);
+    return FALSE;
+}
+
+static gboolean
+cb_metrics_connection_timeout (gpointer data)
+{
+    MetricsConnection *connection = data;
+
+    milter_error("[controller][metrics][error][timeout] %g",
+                 METRICS_CONNECTION_TIMEOUT);
+    connection->timeout_id = 0;
+    metrics_connection_free(connection);
+    return FALSE;
+}
+
+static void
+metrics_connection_new (MilterManagerController *controller, gint fd)
+{
+    MilterManagerControllerPrivate *priv;
+    MetricsConnection *connection;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(controller);
+
+    /* A scraper that doesn't send a request nor read a
+     * response must not be able to consume file
+     * descriptors. */
+    if (g_list_length(priv->metrics_connections) >= MAX_METRICS_CONNECTIONS) {
+        milter_error("[controller][metrics][error][accept] "
+                     "too many connections: <%u>",
+                     MAX_METRICS_CONNECTIONS);
+        close(fd);
+        return;
+    }
+
+    connection = g_new0(MetricsConnection, 1);
+    connection->controller = controller;
+    connection->channel = g_io_channel_unix_new(fd);
+    g_io_channel_set_encoding(connection->channel, NULL, NULL);
+    g_io_channel_set_buffered(connection->channel, FALSE);
+    g_io_channel_set_flags(connection->channel, G_IO_FLAG_NONBLOCK, NULL);
+    g_io_channel_set_close_on_unref(connection->channel, TRUE);
+    connection->request = g_string_new(NULL);
+    priv->metrics_connections = g_list_prepend(priv->metrics_connections,
+                                               connection);
+
+    connection->watch_id =
+        milter_event_loop_watch_io(priv->event_loop, connection->channel,
+                                   G_IO_IN | G_IO_PRI |
+                                   G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+                                   cb_metrics_connection_read, connection);
+    connection->timeout_id =
+        milter_event_loop_add_timeout(priv->event_loop,
+                                      METRICS_CONNECTION_TIMEOUT,
+                                      cb_metrics_connection_timeout,
+                                      connection);
+}
+
+static gboolean
+metrics_watch_func (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+    MilterManagerController *controller = data;
+    MilterManagerControllerPrivate *priv;
+    gboolean keep_callback = TRUE;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(controller);
+
+    if (condition & G_IO_IN ||
+        condition & G_IO_PRI) {
+        gint fd;
+
+        /* The listening socket is shared with workers. Another
+         * process may accept the connection first. */
+        fd = accept(g_io_channel_unix_get_fd(channel), NULL, NULL);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                milter_error("[controller][metrics][error][accept] %s",
+                             g_strerror(errno));
+        } else {
+            metrics_connection_new(controller, fd);
+        }
+    }
+
+    if (condition & G_IO_ERR ||
+        condition & G_IO_HUP ||
+        condition & G_IO_NVAL) {
+        gchar *message;
+
+        message = milter_utils_inspect_io_condition_error(condition);
+        milter_error("[controller][metrics][error][watch] %s", message);
+        g_free(message);
+        keep_callback = FALSE;
+    }
+
+    if (!keep_callback) {
+        priv->metrics_watch_id = 0;
+    }
+
+    return keep_callback;
+}
+
+static MilterManagerMetrics *
+ensure_metrics (MilterManagerController *controller)
+{
+    MilterManagerControllerPrivate *priv;
+    MilterManagerMetrics *metrics;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(controller);
+
+    /* Metrics must be shared before workers are forked. */
+    metrics = milter_manager_get_metrics(priv->manager);
+    if (!metrics) {
+        metrics =
+            milter_manager_metrics_new_with_client(MILTER_CLIENT(priv->manager));
+        milter_manager_set_metrics(priv->manager, metrics);
+        g_object_unref(metrics);
+    }
+
+    return metrics;
+}
+
+static gboolean
+listen_metrics (MilterManagerController *controller,
+                MilterManagerConfiguration *config,
+                GError **error)
+{
+    MilterManagerControllerPrivate *priv;
+    MilterManagerMetrics *metrics;
+    const gchar *spec;
+    GIOChannel *channel;
+    struct sockaddr *address = NULL;
+    socklen_t address_size = 0;
+    gboolean remove_socket;
+    GError *local_error = NULL;
+
+    priv = MILTER_MANAGER_CONTROLLER_GET_PRIVATE(controller);
+
+    dispose_metrics(priv);
+
+    spec = milter_manager_configuration_get_controller_metrics_connection_spec(config);
+    if (!spec) {
+        milter_debug("[controller][metrics][disabled] "
+                     "connection spec isn't specified");
+        return TRUE;
+    }
+
+    remove_socket = milter_manager_configuration_is_remove_controller_unix_socket_on_create(config);
+    channel = milter_connection_listen(spec, -1, &address, &address_size,
+                                       remove_socket, &local_error);
+    if (address) {
+        listen_started(controller, address, address_size, config);
+        g_free(address);
+    }
+
+    if (!channel) {
+        milter_error("[controller][metrics][error][listen] <%s>: %s",
+                     spec, local_error->message);
+        g_propagate_error(error, local_error);
+        return FALSE;
+    }
+
+    metrics = ensure_metrics(controller);
+    milter_manager_metrics_watch_event_loop(
+        metrics,
+        priv->event_loop,
+        MILTER_MANAGER_METRICS_DEFAULT_LAG_CHECK_INTERVAL);
+
+    g_io_channel_set_flags(channel, G_IO_FLAG_NONBLOCK, NULL);
+    priv->metrics_spec = g_strdup(spec);
+    priv->metrics_watch_id =
+        milter_event_loop_watch_io(priv->event_loop, channel,
+                                   G_IO_IN | G_IO_PRI |
+                                   G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+                                   metrics_watch_func, controller);
+    g_io_channel_unref(channel);
+
+    return TRUE;
+}
+
 gboolean
 milter_manager_controller_listen (MilterManagerController *controller,
                                   GError **error)
@@ -453,12 +871,18 @@ milter_manager_controller_listen (MilterManagerController *controller,
     dispose_spec(priv);
 
     config = milter_manager_get_configuration(priv->manager);
+    if (!listen_metrics(controller, config, error))
+        return FALSE;
+
     spec = milter_manager_configuration_get_controller_connection_spec(config);
     if (!spec) {
         milter_info("[controller][disabled] connection spec isn't specified");
         return TRUE;
     }
 
+    /* get-status reports the live counters in the metrics. */
+    ensure_metrics(controller);
+
     remove_socket = milter_manager_configuration_is_remove_controller_unix_socket_on_create(config);
     channel = milter_connection_listen(spec, -1, &address, &address_size,
                                        remove_socket, &local_error);
@@ -0,0 +1,1348 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "milter-manager-dnsbl.h"
+
+#define MILTER_MANAGER_DNSBL_GET_PRIVATE(obj)                   \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_MANAGER_DNSBL,     \
+                                 MilterManagerDNSBLPrivate))
+
+#define DNS_PORT 53
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_NAME_SIZE 255
+#define DNS_MAX_LABEL_SIZE 63
+#define DNS_MAX_PACKET_SIZE 4096
+#define DNS_FLAG_RESPONSE 0x8000
+#define DNS_FLAG_RECURSION_DESIRED 0x0100
+#define DNS_RCODE_MASK 0x000f
+#define DNS_RCODE_NO_ERROR 0
+#define DNS_RCODE_NAME_ERROR 3
+#define DNS_TYPE_A 1
+#define DNS_TYPE_SOA 6
+#define DNS_CLASS_IN 1
+
+#define DEFAULT_NAME_SERVER "127.0.0.1"
+#define RESOLV_CONF_PATH "/etc/resolv.conf"
+/* Used for negative answers without SOA record. */
+#define DEFAULT_NEGATIVE_TTL 60
+#define MAX_TTL (24 * 60 * 60)
+
+#define READ_UINT16(data) (((guint16)((data)[0]) << 8) | (data)[1])
+#define READ_UINT32(data) (((guint32)READ_UINT16(data) << 16) | \
+                           READ_UINT16((data) + 2))
+
+typedef struct _Zone Zone;
+struct _Zone
+{
+    gchar *name;
+    gboolean have_expected_network;
+    guint32 expected_address;
+    guint32 expected_mask;
+};
+
+/* The last checked results keyed by IPv4 address in host byte
+ * order. link is the node in cache_queue whose head is the most
+ * recently used entry. */
+typedef struct _CacheEntry CacheEntry;
+struct _CacheEntry
+{
+    guint32 address;
+    gboolean listed;
+    gint64 expire_time;
+    GList *link;
+};
+
+/* Each event loop has its own socket and lookups because a lookup
+ * and its checks must be processed in the event loop that started
+ * it. The socket is recreated when the name server is changed. */
+typedef struct _Resolver Resolver;
+struct _Resolver
+{
+    MilterManagerDNSBL *dnsbl;
+    MilterEventLoop *event_loop;
+    GIOChannel *channel;
+    guint watch_id;
+    guint name_server_generation;
+    GHashTable *lookups;
+};
+
+/* A lookup sends queries for all zones in parallel and is shared by
+ * all checks for the same address in the same event loop. */
+typedef struct _Lookup Lookup;
+struct _Lookup
+{
+    MilterManagerDNSBL *dnsbl;
+    Resolver *resolver;
+    MilterEventLoop *event_loop;
+    guint32 address;
+    guint n_waiting_zones;
+    guint32 ttl;
+    gboolean cacheable;
+    guint timeout_id;
+    GList *query_ids;
+    GList *checks;
+};
+
+typedef struct _Query Query;
+struct _Query
+{
+    guint16 id;
+    Lookup *lookup;
+    guint zone_index;
+    GByteArray *question;
+};
+
+typedef struct _Check Check;
+struct _Check
+{
+    guint id;
+    Lookup *lookup;
+    MilterManagerDNSBLCheckFunc func;
+    gpointer user_data;
+};
+
+typedef struct _MilterManagerDNSBLPrivate MilterManagerDNSBLPrivate;
+struct _MilterManagerDNSBLPrivate
+{
+    GPtrArray *zones;
+    gchar *name_server;
+    struct sockaddr_storage name_server_address;
+    socklen_t name_server_address_length;
+    guint name_server_generation;
+    gdouble timeout;
+    guint max_cache_size;
+    GHashTable *cache;
+    GQueue *cache_queue;
+    GHashTable *resolvers;
+    GHashTable *queries;
+    GHashTable *checks;
+    guint last_check_id;
+    GMutex mutex;
+};
+
+G_DEFINE_TYPE(MilterManagerDNSBL,
+              milter_manager_dnsbl,
+              G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
+
+static void
+milter_manager_dnsbl_class_init (MilterManagerDNSBLClass *klass)
+{
+    GObjectClass *gobject_class;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerDNSBLPrivate));
+}
+
+static void
+zone_free (Zone *zone)
+{
+    g_free(zone->name);
+    g_free(zone);
+}
+
+static void
+query_free (Query *query)
+{
+    g_byte_array_free(query->question, TRUE);
+    g_free(query);
+}
+
+static void resolver_free (Resolver *resolver);
+static void clear_cache   (MilterManagerDNSBLPrivate *priv);
+
+static void
+milter_manager_dnsbl_init (MilterManagerDNSBL *dnsbl)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    priv->zones = g_ptr_array_new_with_free_func((GDestroyNotify)zone_free);
+    priv->name_server = NULL;
+    priv->name_server_address_length = 0;
+    priv->name_server_generation = 0;
+    priv->timeout = MILTER_MANAGER_DNSBL_DEFAULT_TIMEOUT;
+    priv->max_cache_size = MILTER_MANAGER_DNSBL_DEFAULT_MAX_CACHE_SIZE;
+    priv->cache = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        NULL, g_free);
+    priv->cache_queue = g_queue_new();
+    priv->resolvers = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                            NULL,
+                                            (GDestroyNotify)resolver_free);
+    priv->queries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          NULL, (GDestroyNotify)query_free);
+    priv->checks = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, g_free);
+    priv->last_check_id = 0;
+    g_mutex_init(&(priv->mutex));
+}
+
+static void
+dispose_socket (Resolver *resolver)
+{
+    if (resolver->watch_id > 0) {
+        milter_event_loop_remove(resolver->event_loop, resolver->watch_id);
+        resolver->watch_id = 0;
+    }
+
+    if (resolver->channel) {
+        g_io_channel_unref(resolver->channel);
+        resolver->channel = NULL;
+    }
+}
+
+static void
+lookup_free (Lookup *lookup)
+{
+    if (lookup->event_loop)
+        g_object_unref(lookup->event_loop);
+    g_list_free(lookup->query_ids);
+    g_free(lookup);
+}
+
+static void
+dispose_lookup (gpointer key, gpointer value, gpointer user_data)
+{
+    Lookup *lookup = value;
+
+    if (lookup->timeout_id > 0)
+        milter_event_loop_remove(lookup->event_loop, lookup->timeout_id);
+    g_list_free(lookup->checks);
+    lookup_free(lookup);
+}
+
+static void
+resolver_free (Resolver *resolver)
+{
+    g_hash_table_foreach(resolver->lookups, dispose_lookup, NULL);
+    g_hash_table_unref(resolver->lookups);
+    dispose_socket(resolver);
+    g_object_unref(resolver->event_loop);
+    g_free(resolver);
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(object);
+
+    if (priv->checks) {
+        g_hash_table_unref(priv->checks);
+        priv->checks = NULL;
+    }
+
+    if (priv->queries) {
+        g_hash_table_unref(priv->queries);
+        priv->queries = NULL;
+    }
+
+    if (priv->resolvers) {
+        g_hash_table_unref(priv->resolvers);
+        priv->resolvers = NULL;
+    }
+
+    if (priv->cache_queue) {
+        g_queue_free(priv->cache_queue);
+        priv->cache_queue = NULL;
+    }
+
+    if (priv->cache) {
+        g_hash_table_unref(priv->cache);
+        priv->cache = NULL;
+    }
+
+    if (priv->zones) {
+        g_ptr_array_unref(priv->zones);
+        priv->zones = NULL;
+    }
+
+    if (priv->name_server) {
+        g_free(priv->name_server);
+        priv->name_server = NULL;
+    }
+
+    G_OBJECT_CLASS(milter_manager_dnsbl_parent_class)->dispose(object);
+}
+
+static void
+finalize (GObject *object)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(object);
+    g_mutex_clear(&(priv->mutex));
+
+    G_OBJECT_CLASS(milter_manager_dnsbl_parent_class)->finalize(object);
+}
+
+GQuark
+milter_manager_dnsbl_error_quark (void)
+{
+    return g_quark_from_static_string("milter-manager-dnsbl-error-quark");
+}
+
+MilterManagerDNSBL *
+milter_manager_dnsbl_new (void)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_DNSBL,
+                        NULL);
+}
+
+static gboolean
+parse_expected_network (Zone *zone, const gchar *network, GError **error)
+{
+    gchar **components;
+    struct in_addr address;
+    guint64 prefix = 32;
+    gboolean success = TRUE;
+
+    components = g_strsplit(network, "/", 2);
+    if (inet_pton(AF_INET, components[0], &address) != 1) {
+        success = FALSE;
+    } else if (components[1]) {
+        gchar *end = NULL;
+
+        prefix = g_ascii_strtoull(components[1], &end, 10);
+        if (components[1][0] == '\0' || end[0] != '\0' || prefix > 32)
+            success = FALSE;
+    }
+    g_strfreev(components);
+
+    if (!success) {
+        g_set_error(error,
+                    MILTER_MANAGER_DNSBL_ERROR,
+                    MILTER_MANAGER_DNSBL_ERROR_INVALID_NETWORK,
+                    "invalid expected network: <%s>", network);
+        return FALSE;
+    }
+
+    zone->have_expected_network = TRUE;
+    zone->expected_mask = prefix == 0 ? 0 : (0xffffffff << (32 - prefix));
+    zone->expected_address = g_ntohl(address.s_addr) & zone->expected_mask;
+    return TRUE;
+}
+
+static gboolean
+validate_zone (const gchar *zone)
+{
+    gchar **labels;
+    gboolean valid = TRUE;
+    gint i;
+
+    /* "255.255.255.255." is prepended to the zone. */
+    if (zone[0] == '\0' || strlen(zone) > DNS_MAX_NAME_SIZE - 17)
+        return FALSE;
+
+    labels = g_strsplit(zone, ".", -1);
+    for (i = 0; labels[i]; i++) {
+        gsize length;
+
+        length = strlen(labels[i]);
+        if (length == 0 || length > DNS_MAX_LABEL_SIZE) {
+            valid = FALSE;
+            break;
+        }
+    }
+    g_strfreev(labels);
+
+    return valid;
+}
+
+gboolean
+milter_manager_dnsbl_add_zone (MilterManagerDNSBL *dnsbl,
+                               const gchar        *zone,
+                               const gchar        *expected_network,
+                               GError            **error)
+{
+    MilterManagerDNSBLPrivate *priv;
+    Zone *new_zone;
+    gsize length;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    new_zone = g_new0(Zone, 1);
+    length = strlen(zone);
+    if (length > 0 && zone[length - 1] == '.')
+        length--;
+    new_zone->name = g_ascii_strdown(zone, length);
+    if (!validate_zone(new_zone->name)) {
+        g_set_error(error,
+                    MILTER_MANAGER_DNSBL_ERROR,
+                    MILTER_MANAGER_DNSBL_ERROR_INVALID_ZONE,
+                    "invalid DNSBL zone: <%s>", zone);
+        zone_free(new_zone);
+        return FALSE;
+    }
+
+    if (expected_network &&
+        !parse_expected_network(new_zone, expected_network, error)) {
+        zone_free(new_zone);
+        return FALSE;
+    }
+
+    g_mutex_lock(&(priv->mutex));
+    g_ptr_array_add(priv->zones, new_zone);
+    clear_cache(priv);
+    g_mutex_unlock(&(priv->mutex));
+
+    return TRUE;
+}
+
+guint
+milter_manager_dnsbl_get_n_zones (MilterManagerDNSBL *dnsbl)
+{
+    return MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl)->zones->len;
+}
+
+void
+milter_manager_dnsbl_clear_zones (MilterManagerDNSBL *dnsbl)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    g_mutex_lock(&(priv->mutex));
+    g_ptr_array_set_size(priv->zones, 0);
+    clear_cache(priv);
+    g_mutex_unlock(&(priv->mutex));
+}
+
+static gboolean
+parse_name_server (const gchar *name_server,
+                   struct sockaddr_storage *address,
+                   socklen_t *address_length)
+{
+    gchar *host;
+    const gchar *port_string = NULL;
+    guint64 port = DNS_PORT;
+    struct sockaddr_in *address_inet;
+    struct sockaddr_in6 *address_inet6;
+    gboolean success = TRUE;
+
+    if (name_server[0] == '[') {
+        const gchar *close;
+
+        close = strchr(name_server, ']');
+        if (!close)
+            return FALSE;
+        if (close[1] == ':')
+            port_string = close + 2;
+        else if (close[1] != '\0')
+            return FALSE;
+        host = g_strndup(name_server + 1, close - name_server - 1);
+    } else {
+        const gchar *colon;
+
+        colon = strchr(name_server, ':');
+        if (colon && !strchr(colon + 1, ':')) {
+            port_string = colon + 1;
+            host = g_strndup(name_server, colon - name_server);
+        } else {
+            host = g_strdup(name_server);
+        }
+    }
+
+    if (port_string) {
+        gchar *end = NULL;
+
+        port = g_ascii_strtoull(port_string, &end, 10);
+        if (port_string[0] == '\0' || end[0] != '\0' ||
+            port == 0 || port > G_MAXUINT16) {
+            g_free(host);
+            return FALSE;
+        }
+    }
+
+    memset(address, 0, sizeof(*address));
+    address_inet = (struct sockaddr_in *)address;
+    address_inet6 = (struct sockaddr_in6 *)address;
+    if (inet_pton(AF_INET, host, &(address_inet->sin_addr)) == 1) {
+        address_inet->sin_family = AF_INET;
+        address_inet->sin_port = g_htons(port);
+        *address_length = sizeof(*address_inet);
+    } else if (inet_pton(AF_INET6, host, &(address_inet6->sin6_addr)) == 1) {
+        address_inet6->sin6_family = AF_INET6;
+        address_inet6->sin6_port = g_htons(port);
+        *address_length = sizeof(*address_inet6);
+    } else {
+        success = FALSE;
+    }
+    g_free(host);
+
+    return success;
+}
+
+gboolean
+milter_manager_dnsbl_set_name_server (MilterManagerDNSBL *dnsbl,
+                                      const gchar        *name_server,
+                                      GError            **error)
+{
+    MilterManagerDNSBLPrivate *priv;
+    struct sockaddr_storage address;
+    socklen_t address_length = 0;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    if (name_server &&
+        !parse_name_server(name_server, &address, &address_length)) {
+        g_set_error(error,
+                    MILTER_MANAGER_DNSBL_ERROR,
+                    MILTER_MANAGER_DNSBL_ERROR_INVALID_NAME_SERVER,
+                    "invalid name server: <%s>", name_server);
+        return FALSE;
+    }
+
+    g_mutex_lock(&(priv->mutex));
+    if (priv->name_server)
+        g_free(priv->name_server);
+    priv->name_server = g_strdup(name_server);
+    if (name_server)
+        memcpy(&(priv->name_server_address), &address, address_length);
+    priv->name_server_address_length = address_length;
+    /* Sockets are recreated by their event loops on the next
+     * check. Queries in flight are expired by their timeout. */
+    priv->name_server_generation++;
+    g_mutex_unlock(&(priv->mutex));
+
+    return TRUE;
+}
+
+const gchar *
+milter_manager_dnsbl_get_name_server (MilterManagerDNSBL *dnsbl)
+{
+    return MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl)->name_server;
+}
+
+void
+milter_manager_dnsbl_set_timeout (MilterManagerDNSBL *dnsbl,
+                                  gdouble             timeout)
+{
+    MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl)->timeout = timeout;
+}
+
+gdouble
+milter_manager_dnsbl_get_timeout (MilterManagerDNSBL *dnsbl)
+{
+    return MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl)->timeout;
+}
+
+static void
+cache_remove (MilterManagerDNSBLPrivate *priv, CacheEntry *entry)
+{
+    g_queue_delete_link(priv->cache_queue, entry->link);
+    g_hash_table_remove(priv->cache, GUINT_TO_POINTER(entry->address));
+}
+
+/* The latest entry is always kept because stopper rules read the
+ * result just after the check is finished. */
+static void
+cache_truncate (MilterManagerDNSBLPrivate *priv)
+{
+    while (g_hash_table_size(priv->cache) > MAX(priv->max_cache_size, 1)) {
+        cache_remove(priv, priv->cache_queue->tail->data);
+    }
+}
+
+void
+milter_manager_dnsbl_set_max_cache_size (MilterManagerDNSBL *dnsbl,
+                                         guint               size)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    g_mutex_lock(&(priv->mutex));
+    priv->max_cache_size = size;
+    cache_truncate(priv);
+    g_mutex_unlock(&(priv->mutex));
+}
+
+guint
+milter_manager_dnsbl_get_max_cache_size (MilterManagerDNSBL *dnsbl)
+{
+    return MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl)->max_cache_size;
+}
+
+guint
+milter_manager_dnsbl_get_cache_size (MilterManagerDNSBL *dnsbl)
+{
+    MilterManagerDNSBLPrivate *priv;
+    guint size;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    g_mutex_lock(&(priv->mutex));
+    size = g_hash_table_size(priv->cache);
+    g_mutex_unlock(&(priv->mutex));
+    return size;
+}
+
+static void
+clear_cache (MilterManagerDNSBLPrivate *priv)
+{
+    g_queue_clear(priv->cache_queue);
+    g_hash_table_remove_all(priv->cache);
+}
+
+void
+milter_manager_dnsbl_clear_cache (MilterManagerDNSBL *dnsbl)
+{
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    g_mutex_lock(&(priv->mutex));
+    clear_cache(priv);
+    g_mutex_unlock(&(priv->mutex));
+}
+
+static CacheEntry *
+cache_lookup (MilterManagerDNSBLPrivate *priv, guint32 address)
+{
+    CacheEntry *entry;
+
+    entry = g_hash_table_lookup(priv->cache, GUINT_TO_POINTER(address));
+    if (!entry)
+        return NULL;
+
+    if (entry->expire_time <= g_get_monotonic_time()) {
+        cache_remove(priv, entry);
+        return NULL;
+    }
+
+    g_queue_unlink(priv->cache_queue, entry->link);
+    g_queue_push_head_link(priv->cache_queue, entry->link);
+    return entry;
+}
+
+static void
+cache_add (MilterManagerDNSBLPrivate *priv,
+           guint32 address,
+           gboolean listed,
+           guint32 ttl)
+{
+    CacheEntry *entry;
+
+    entry = g_hash_table_lookup(priv->cache, GUINT_TO_POINTER(address));
+    if (entry)
+        cache_remove(priv, entry);
+
+    entry = g_new0(CacheEntry, 1);
+    entry->address = address;
+    entry->listed = listed;
+    entry->expire_time =
+        g_get_monotonic_time() +
+        (gint64)CLAMP(ttl, 1, MAX_TTL) * G_USEC_PER_SEC;
+    entry->link = g_list_alloc();
+    entry->link->data = entry;
+    g_queue_push_head_link(priv->cache_queue, entry->link);
+    g_hash_table_insert(priv->cache, GUINT_TO_POINTER(address), entry);
+
+    cache_truncate(priv);
+}
+
+static gboolean
+extract_ipv4_address (const struct sockaddr *address,
+                      socklen_t address_length,
+                      guint32 *ipv4_address)
+{
+    if (!address || address_length < sizeof(address->sa_family))
+        return FALSE;
+
+    switch (address->sa_family) {
+    case AF_INET:
+    {
+        const struct sockaddr_in *address_inet;
+
+        if (address_length < sizeof(*address_inet))
+            return FALSE;
+        address_inet = (const struct sockaddr_in *)address;
+        *ipv4_address = g_ntohl(address_inet->sin_addr.s_addr);
+        return TRUE;
+    }
+    case AF_INET6:
+    {
+        const struct sockaddr_in6 *address_inet6;
+        const guint8 *bytes;
+
+        if (address_length < sizeof(*address_inet6))
+            return FALSE;
+        address_inet6 = (const struct sockaddr_in6 *)address;
+        if (!IN6_IS_ADDR_V4MAPPED(&(address_inet6->sin6_addr)))
+            return FALSE;
+        bytes = address_inet6->sin6_addr.s6_addr + 12;
+        *ipv4_address = READ_UINT32(bytes);
+        return TRUE;
+    }
+    default:
+        return FALSE;
+    }
+}
+
+static gchar *
+format_address (guint32 address)
+{
+    return g_strdup_printf("%u.%u.%u.%u",
+                           (address >> 24) & 0xff,
+                           (address >> 16) & 0xff,
+                           (address >> 8) & 0xff,
+                           address & 0xff);
+}
+
+static void
+ensure_name_server (MilterManagerDNSBLPrivate *priv)
+{
+    gchar *content = NULL;
+    gchar **lines;
+    gint i;
+
+    if (priv->name_server_address_length > 0)
+        return;
+
+    if (g_file_get_contents(RESOLV_CONF_PATH, &content, NULL, NULL)) {
+        lines = g_strsplit(content, "\n", -1);
+        for (i = 0; lines[i]; i++) {
+            gchar **fields;
+
+            fields = g_strsplit_set(g_strstrip(lines[i]), " \t", -1);
+            if (fields[0] && strcmp(fields[0], "nameserver") == 0 &&
+                fields[1] &&
+                parse_name_server(fields[1],
+                                  &(priv->name_server_address),
+                                  &(priv->name_server_address_length))) {
+                priv->name_server = g_strdup(fields[1]);
+            }
+            g_strfreev(fields);
+            if (priv->name_server)
+                break;
+        }
+        g_strfreev(lines);
+        g_free(content);
+    }
+
+    if (!priv->name_server) {
+        priv->name_server = g_strdup(DEFAULT_NAME_SERVER);
+        parse_name_server(priv->name_server,
+                          &(priv->name_server_address),
+                          &(priv->name_server_address_length));
+    }
+    milter_debug("[dnsbl][name-server] <%s>", priv->name_server);
+}
+
+static void zone_answered (Lookup *lookup, gboolean listed, guint32 ttl);
+
+static gboolean
+match_question (const guchar *data, gsize size, GByteArray *question)
+{
+    gsize i;
+
+    if (size < question->len)
+        return FALSE;
+
+    for (i = 0; i < question->len; i++) {
+        if (g_ascii_tolower(data[i]) != g_ascii_tolower(question->data[i]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+skip_name (const guchar *data, gsize size, gsize *offset)
+{
+    while (*offset < size) {
+        guint8 length = data[*offset];
+
+        if ((length & 0xc0) == 0xc0) {
+            if (*offset + 2 > size)
+                return FALSE;
+            *offset += 2;
+            return TRUE;
+        }
+        if (length & 0xc0)
+            return FALSE;
+        *offset += 1;
+        if (length == 0)
+            return TRUE;
+        *offset += length;
+    }
+    return FALSE;
+}
+
+static gboolean
+read_record (const guchar *data, gsize size, gsize *offset,
+             guint16 *type, guint16 *klass, guint32 *ttl,
+             const guchar **rdata, guint16 *rdata_length)
+{
+    if (!skip_name(data, size, offset))
+        return FALSE;
+    if (*offset + 10 > size)
+        return FALSE;
+    *type = READ_UINT16(data + *offset);
+    *klass = READ_UINT16(data + *offset + 2);
+    *ttl = READ_UINT32(data + *offset + 4);
+    *rdata_length = READ_UINT16(data + *offset + 8);
+    *offset += 10;
+    if (*offset + *rdata_length > size)
+        return FALSE;
+    *rdata = data + *offset;
+    *offset += *rdata_length;
+    return TRUE;
+}
+
+static guint32
+parse_negative_ttl (const guchar *data, gsize size, gsize offset,
+                    guint n_answers, guint n_authorities)
+{
+    guint i;
+
+    for (i = 0; i < n_answers + n_authorities; i++) {
+        guint16 type, klass, rdata_length;
+        guint32 ttl;
+        const guchar *rdata;
+
+        if (!read_record(data, size, &offset,
+                         &type, &klass, &ttl, &rdata, &rdata_length))
+            break;
+        if (i >= n_answers && type == DNS_TYPE_SOA && rdata_length >= 22) {
+            /* The last field of SOA RDATA is MINIMUM. */
+            guint32 minimum;
+
+            minimum = READ_UINT32(rdata + rdata_length - 4);
+            return MIN(ttl, minimum);
+        }
+    }
+
+    return DEFAULT_NEGATIVE_TTL;
+}
+
+static void
+process_response (Resolver *resolver, const guchar *data, gsize size)
+{
+    MilterManagerDNSBL *dnsbl = resolver->dnsbl;
+    MilterManagerDNSBLPrivate *priv;
+    Query *query;
+    Lookup *lookup;
+    Zone *zone = NULL;
+    guint16 id, flags, rcode;
+    guint n_questions, n_answers, n_authorities;
+    gsize offset;
+    gboolean have_address = FALSE;
+    gboolean listed = FALSE;
+    guint32 ttl = MAX_TTL;
+    guint i;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    if (size < DNS_HEADER_SIZE)
+        return;
+
+    id = READ_UINT16(data);
+    flags = READ_UINT16(data + 2);
+    n_questions = READ_UINT16(data + 4);
+    n_answers = READ_UINT16(data + 6);
+    n_authorities = READ_UINT16(data + 8);
+    if (!(flags & DNS_FLAG_RESPONSE) || n_questions != 1)
+        return;
+
+    query = g_hash_table_lookup(priv->queries, GUINT_TO_POINTER(id));
+    if (!query || query->lookup->resolver != resolver) {
+        milter_debug("[dnsbl][response][unknown] <%u>", id);
+        return;
+    }
+
+    offset = DNS_HEADER_SIZE;
+    if (!match_question(data + offset, size - offset, query->question)) {
+        milter_debug("[dnsbl][response][mismatch] <%u>", id);
+        return;
+    }
+    offset += query->question->len;
+
+    lookup = query->lookup;
+    if (query->zone_index < priv->zones->len)
+        zone = g_ptr_array_index(priv->zones, query->zone_index);
+    lookup->query_ids = g_list_remove(lookup->query_ids, GUINT_TO_POINTER(id));
+    g_hash_table_remove(priv->queries, GUINT_TO_POINTER(id));
+
+    rcode = flags & DNS_RCODE_MASK;
+    switch (rcode) {
+    case DNS_RCODE_NO_ERROR:
+    {
+        gsize answer_offset = offset;
+
+        for (i = 0; i < n_answers; i++) {
+            guint16 type, klass, rdata_length;
+            guint32 record_ttl;
+            const guchar *rdata;
+            guint32 address;
+
+            if (!read_record(data, size, &answer_offset,
+                             &type, &klass, &record_ttl,
+                             &rdata, &rdata_length))
+                break;
+            if (type != DNS_TYPE_A || klass != DNS_CLASS_IN ||
+                rdata_length != 4)
+                continue;
+
+            have_address = TRUE;
+            ttl = MIN(ttl, record_ttl);
+            address = READ_UINT32(rdata);
+            if (!zone || !zone->have_expected_network ||
+                (address & zone->expected_mask) == zone->expected_address) {
+                listed = zone != NULL;
+            }
+        }
+        if (!have_address)
+            ttl = parse_negative_ttl(data, size, offset,
+                                     n_answers, n_authorities);
+        break;
+    }
+    case DNS_RCODE_NAME_ERROR:
+        ttl = parse_negative_ttl(data, size, offset,
+                                 n_answers, n_authorities);
+        break;
+    default:
+        milter_debug("[dnsbl][response][error] <%s>: rcode=%u",
+                     zone ? zone->name : "(removed)", rcode);
+        lookup->cacheable = FALSE;
+        ttl = 0;
+        break;
+    }
+
+    zone_answered(lookup, listed, ttl);
+}
+
+static gboolean
+cb_socket_readable (GIOChannel *channel, GIOCondition condition,
+                    gpointer user_data)
+{
+    Resolver *resolver = user_data;
+    MilterManagerDNSBL *dnsbl = resolver->dnsbl;
+    MilterManagerDNSBLPrivate *priv;
+    guchar buffer[DNS_MAX_PACKET_SIZE];
+    gint fd;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    fd = g_io_channel_unix_get_fd(channel);
+
+    /* Check callbacks may release the last reference. */
+    g_object_ref(dnsbl);
+    while (resolver->channel == channel) {
+        ssize_t size;
+
+        size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                milter_error("[dnsbl][error][receive] %s",
+                             g_strerror(errno));
+            break;
+        }
+        g_mutex_lock(&(priv->mutex));
+        process_response(resolver, buffer, size);
+        g_mutex_unlock(&(priv->mutex));
+    }
+    g_object_unref(dnsbl);
+
+    return TRUE;
+}
+
+static Resolver *
+ensure_resolver (MilterManagerDNSBL *dnsbl, MilterEventLoop *loop)
+{
+    MilterManagerDNSBLPrivate *priv;
+    Resolver *resolver;
+    struct sockaddr *address;
+    gint fd;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    resolver = g_hash_table_lookup(priv->resolvers, loop);
+    if (!resolver) {
+        resolver = g_new0(Resolver, 1);
+        resolver->dnsbl = dnsbl;
+        resolver->event_loop = g_object_ref(loop);
+        resolver->lookups = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_hash_table_insert(priv->resolvers, loop, resolver);
+    }
+    if (resolver->channel &&
+        resolver->name_server_generation == priv->name_server_generation)
+        return resolver;
+
+    dispose_socket(resolver);
+    resolver->name_server_generation = priv->name_server_generation;
+    ensure_name_server(priv);
+
+    address = (struct sockaddr *)&(priv->name_server_address);
+    fd = socket(address->sa_family, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        milter_error("[dnsbl][error][socket] %s", g_strerror(errno));
+        return NULL;
+    }
+
+    /* Connected UDP socket only receives datagrams from the name
+     * server. */
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 ||
+        fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+        connect(fd, address, priv->name_server_address_length) == -1) {
+        milter_error("[dnsbl][error][socket] <%s>: %s",
+                     priv->name_server, g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    resolver->channel = g_io_channel_unix_new(fd);
+    g_io_channel_set_close_on_unref(resolver->channel, TRUE);
+    resolver->watch_id = milter_event_loop_watch_io(loop,
+                                                    resolver->channel,
+                                                    G_IO_IN | G_IO_PRI |
+                                                    G_IO_ERR | G_IO_HUP,
+                                                    cb_socket_readable,
+                                                    resolver);
+    return resolver;
+}
+
+static void
+build_question (GByteArray *question, guint32 address, const gchar *zone)
+{
+    gchar *name;
+    gchar **labels;
+    guint8 type_and_class[] = {
+        DNS_TYPE_A >> 8, DNS_TYPE_A & 0xff,
+        DNS_CLASS_IN >> 8, DNS_CLASS_IN & 0xff
+    };
+    guint8 terminator = 0;
+    gint i;
+
+    name = g_strdup_printf("%u.%u.%u.%u.%s",
+                           address & 0xff,
+                           (address >> 8) & 0xff,
+                           (address >> 16) & 0xff,
+                           (address >> 24) & 0xff,
+                           zone);
+    labels = g_strsplit(name, ".", -1);
+    g_free(name);
+    for (i = 0; labels[i]; i++) {
+        guint8 length;
+
+        length = strlen(labels[i]);
+        g_byte_array_append(question, &length, 1);
+        g_byte_array_append(question, (guint8 *)labels[i], length);
+    }
+    g_strfreev(labels);
+    g_byte_array_append(question, &terminator, 1);
+    g_byte_array_append(question, type_and_class, sizeof(type_and_class));
+}
+
+static gboolean
+send_query (MilterManagerDNSBL *dnsbl, Lookup *lookup, guint zone_index)
+{
+    MilterManagerDNSBLPrivate *priv;
+    Zone *zone;
+    Query *query;
+    GByteArray *packet;
+    guint8 header[DNS_HEADER_SIZE];
+    guint16 id;
+    ssize_t written;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    zone = g_ptr_array_index(priv->zones, zone_index);
+
+    if (g_hash_table_size(priv->queries) > G_MAXUINT16)
+        return FALSE;
+    do {
+        id = g_random_int_range(0, G_MAXUINT16 + 1);
+    } while (g_hash_table_lookup(priv->queries, GUINT_TO_POINTER(id)));
+
+    query = g_new0(Query, 1);
+    query->id = id;
+    query->lookup = lookup;
+    query->zone_index = zone_index;
+    query->question = g_byte_array_new();
+    build_question(query->question, lookup->address, zone->name);
+
+    memset(header, 0, sizeof(header));
+    header[0] = id >> 8;
+    header[1] = id & 0xff;
+    header[2] = DNS_FLAG_RECURSION_DESIRED >> 8;
+    header[5] = 1;
+    packet = g_byte_array_sized_new(sizeof(header) + query->question->len);
+    g_byte_array_append(packet, header, sizeof(header));
+    g_byte_array_append(packet, query->question->data, query->question->len);
+    written = send(g_io_channel_unix_get_fd(lookup->resolver->channel),
+                   packet->data, packet->len, 0);
+    g_byte_array_free(packet, TRUE);
+    if (written < 0) {
+        milter_error("[dnsbl][error][send] <%s>: <%s>: %s",
+                     priv->name_server, zone->name, g_strerror(errno));
+        query_free(query);
+        return FALSE;
+    }
+
+    g_hash_table_insert(priv->queries, GUINT_TO_POINTER(id), query);
+    lookup->query_ids = g_list_prepend(lookup->query_ids,
+                                       GUINT_TO_POINTER(id));
+    return TRUE;
+}
+
+/* This is called with the lock and releases it while check
+ * callbacks are called. */
+static void
+finish_lookup (Lookup *lookup, gboolean listed, guint32 ttl,
+               gboolean cacheable)
+{
+    MilterManagerDNSBL *dnsbl = lookup->dnsbl;
+    MilterManagerDNSBLPrivate *priv;
+    GList *node;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    if (milter_need_debug_log()) {
+        gchar *address;
+
+        address = format_address(lookup->address);
+        milter_debug("[dnsbl][finish] <%s>: listed=<%s> ttl=<%u> cached=<%s>",
+                     address,
+                     listed ? "true" : "false",
+                     ttl,
+                     cacheable ? "true" : "false");
+        g_free(address);
+    }
+
+    if (lookup->timeout_id > 0) {
+        milter_event_loop_remove(lookup->event_loop, lookup->timeout_id);
+        lookup->timeout_id = 0;
+    }
+    for (node = lookup->query_ids; node; node = g_list_next(node)) {
+        g_hash_table_remove(priv->queries, node->data);
+    }
+    g_hash_table_remove(lookup->resolver->lookups,
+                        GUINT_TO_POINTER(lookup->address));
+    if (cacheable)
+        cache_add(priv, lookup->address, listed, ttl);
+
+    /* A callback may cancel other checks of this lookup. */
+    g_object_ref(dnsbl);
+    while (lookup->checks) {
+        Check *check = lookup->checks->data;
+        MilterManagerDNSBLCheckFunc func = check->func;
+        gpointer user_data = check->user_data;
+
+        lookup->checks = g_list_delete_link(lookup->checks, lookup->checks);
+        g_hash_table_remove(priv->checks, GUINT_TO_POINTER(check->id));
+        g_mutex_unlock(&(priv->mutex));
+        func(dnsbl, listed, user_data);
+        g_mutex_lock(&(priv->mutex));
+    }
+    g_object_unref(dnsbl);
+
+    lookup_free(lookup);
+}
+
+static void
+zone_answered (Lookup *lookup, gboolean listed, guint32 ttl)
+{
+    lookup->n_waiting_zones--;
+    if (listed) {
+        finish_lookup(lookup, TRUE, ttl, TRUE);
+        return;
+    }
+
+    lookup->ttl = MIN(lookup->ttl, ttl);
+    if (lookup->n_waiting_zones == 0)
+        finish_lookup(lookup, FALSE, lookup->ttl, lookup->cacheable);
+}
+
+static gboolean
+cb_lookup_timeout (gpointer user_data)
+{
+    Lookup *lookup = user_data;
+    MilterManagerDNSBLPrivate *priv;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(lookup->dnsbl);
+
+    g_mutex_lock(&(priv->mutex));
+    lookup->timeout_id = 0;
+    milter_debug("[dnsbl][timeout] <%u> zone(s) aren't answered",
+                 lookup->n_waiting_zones);
+    finish_lookup(lookup, FALSE, 0, FALSE);
+    g_mutex_unlock(&(priv->mutex));
+
+    return FALSE;
+}
+
+static Lookup *
+start_lookup (MilterManagerDNSBL *dnsbl, Resolver *resolver, guint32 address)
+{
+    MilterManagerDNSBLPrivate *priv;
+    MilterEventLoop *loop = resolver->event_loop;
+    Lookup *lookup;
+    guint i;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    lookup = g_new0(Lookup, 1);
+    lookup->dnsbl = dnsbl;
+    lookup->resolver = resolver;
+    lookup->event_loop = g_object_ref(loop);
+    lookup->address = address;
+    lookup->ttl = MAX_TTL;
+    lookup->cacheable = TRUE;
+    for (i = 0; i < priv->zones->len; i++) {
+        if (send_query(dnsbl, lookup, i))
+            lookup->n_waiting_zones++;
+        else
+            lookup->cacheable = FALSE;
+    }
+
+    if (lookup->n_waiting_zones == 0) {
+        lookup_free(lookup);
+        return NULL;
+    }
+
+    lookup->timeout_id = milter_event_loop_add_timeout(loop,
+                                                       priv->timeout,
+                                                       cb_lookup_timeout,
+                                                       lookup);
+    g_hash_table_insert(resolver->lookups, GUINT_TO_POINTER(address), lookup);
+
+    return lookup;
+}
+
+guint
+milter_manager_dnsbl_check (MilterManagerDNSBL *dnsbl,
+                            MilterEventLoop    *loop,
+                            const struct sockaddr *address,
+                            socklen_t           address_length,
+                            MilterManagerDNSBLCheckFunc func,
+                            gpointer            user_data)
+{
+    MilterManagerDNSBLPrivate *priv;
+    guint32 ipv4_address;
+    Resolver *resolver;
+    Lookup *lookup;
+    Check *check;
+    guint id;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    if (!extract_ipv4_address(address, address_length, &ipv4_address))
+        return 0;
+
+    /* The cache and zones are shared by event loop threads. */
+    g_mutex_lock(&(priv->mutex));
+    if (priv->zones->len == 0 || cache_lookup(priv, ipv4_address)) {
+        g_mutex_unlock(&(priv->mutex));
+        return 0;
+    }
+
+    resolver = ensure_resolver(dnsbl, loop);
+    if (!resolver) {
+        g_mutex_unlock(&(priv->mutex));
+        return 0;
+    }
+
+    lookup = g_hash_table_lookup(resolver->lookups,
+                                 GUINT_TO_POINTER(ipv4_address));
+    if (!lookup) {
+        lookup = start_lookup(dnsbl, resolver, ipv4_address);
+        if (!lookup) {
+            g_mutex_unlock(&(priv->mutex));
+            return 0;
+        }
+    }
+
+    check = g_new0(Check, 1);
+    do {
+        check->id = ++priv->last_check_id;
+    } while (check->id == 0 ||
+             g_hash_table_lookup(priv->checks, GUINT_TO_POINTER(check->id)));
+    check->lookup = lookup;
+    check->func = func;
+    check->user_data = user_data;
+    lookup->checks = g_list_append(lookup->checks, check);
+    g_hash_table_insert(priv->checks, GUINT_TO_POINTER(check->id), check);
+    id = check->id;
+    g_mutex_unlock(&(priv->mutex));
+
+    return id;
+}
+
+void
+milter_manager_dnsbl_cancel (MilterManagerDNSBL *dnsbl,
+                             guint               check_id)
+{
+    MilterManagerDNSBLPrivate *priv;
+    Check *check;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+    g_mutex_lock(&(priv->mutex));
+    check = g_hash_table_lookup(priv->checks, GUINT_TO_POINTER(check_id));
+    if (check) {
+        /* The lookup is kept to cache its result for the next check. */
+        check->lookup->checks = g_list_remove(check->lookup->checks, check);
+        g_hash_table_remove(priv->checks, GUINT_TO_POINTER(check_id));
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+gboolean
+milter_manager_dnsbl_is_listed (MilterManagerDNSBL *dnsbl,
+                                const struct sockaddr *address,
+                                socklen_t           address_length)
+{
+    MilterManagerDNSBLPrivate *priv;
+    guint32 ipv4_address;
+    CacheEntry *entry;
+    gboolean listed;
+
+    priv = MILTER_MANAGER_DNSBL_GET_PRIVATE(dnsbl);
+
+    if (!extract_ipv4_address(address, address_length, &ipv4_address))
+        return FALSE;
+
+    g_mutex_lock(&(priv->mutex));
+    entry = cache_lookup(priv, ipv4_address);
+    listed = entry ? entry->listed : FALSE;
+    g_mutex_unlock(&(priv->mutex));
+
+    return listed;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
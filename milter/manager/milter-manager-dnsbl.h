@@ -0,0 +1,129 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_DNSBL_H__
+#define __MILTER_MANAGER_DNSBL_H__
+
+#include <glib-object.h>
+#include <sys/socket.h>
+
+#include <milter/core.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_DNSBL_DEFAULT_TIMEOUT 5.0
+#define MILTER_MANAGER_DNSBL_DEFAULT_MAX_CACHE_SIZE 4096
+
+#define MILTER_MANAGER_DNSBL_ERROR           (milter_manager_dnsbl_error_quark())
+
+#define MILTER_TYPE_MANAGER_DNSBL            (milter_manager_dnsbl_get_type())
+#define MILTER_MANAGER_DNSBL(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_DNSBL, MilterManagerDNSBL))
+#define MILTER_MANAGER_DNSBL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_DNSBL, MilterManagerDNSBLClass))
+#define MILTER_MANAGER_IS_DNSBL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_DNSBL))
+#define MILTER_MANAGER_IS_DNSBL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_DNSBL))
+#define MILTER_MANAGER_DNSBL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_DNSBL, MilterManagerDNSBLClass))
+
+typedef enum
+{
+    MILTER_MANAGER_DNSBL_ERROR_INVALID_ZONE,
+    MILTER_MANAGER_DNSBL_ERROR_INVALID_NETWORK,
+    MILTER_MANAGER_DNSBL_ERROR_INVALID_NAME_SERVER
+} MilterManagerDNSBLError;
+
+typedef struct _MilterManagerDNSBL         MilterManagerDNSBL;
+typedef struct _MilterManagerDNSBLClass    MilterManagerDNSBLClass;
+
+struct _MilterManagerDNSBL
+{
+    GObject object;
+};
+
+struct _MilterManagerDNSBLClass
+{
+    GObjectClass parent_class;
+};
+
+/* Called when all zones answered or the timeout is expired. The
+ * result can also be retrieved by milter_manager_dnsbl_is_listed()
+ * while it is cached. */
+typedef void (*MilterManagerDNSBLCheckFunc) (MilterManagerDNSBL *dnsbl,
+                                             gboolean            listed,
+                                             gpointer            user_data);
+
+GQuark       milter_manager_dnsbl_error_quark (void);
+
+GType        milter_manager_dnsbl_get_type (void) G_GNUC_CONST;
+
+MilterManagerDNSBL *milter_manager_dnsbl_new (void);
+
+gboolean     milter_manager_dnsbl_add_zone
+                                   (MilterManagerDNSBL *dnsbl,
+                                    const gchar        *zone,
+                                    const gchar        *expected_network,
+                                    GError            **error);
+guint        milter_manager_dnsbl_get_n_zones
+                                   (MilterManagerDNSBL *dnsbl);
+void         milter_manager_dnsbl_clear_zones
+                                   (MilterManagerDNSBL *dnsbl);
+
+gboolean     milter_manager_dnsbl_set_name_server
+                                   (MilterManagerDNSBL *dnsbl,
+                                    const gchar        *name_server,
+                                    GError            **error);
+const gchar *milter_manager_dnsbl_get_name_server
+                                   (MilterManagerDNSBL *dnsbl);
+
+void         milter_manager_dnsbl_set_timeout
+                                   (MilterManagerDNSBL *dnsbl,
+                                    gdouble             timeout);
+gdouble      milter_manager_dnsbl_get_timeout
+                                   (MilterManagerDNSBL *dnsbl);
+
+void         milter_manager_dnsbl_set_max_cache_size
+                                   (MilterManagerDNSBL *dnsbl,
+                                    guint               size);
+guint        milter_manager_dnsbl_get_max_cache_size
+                                   (MilterManagerDNSBL *dnsbl);
+guint        milter_manager_dnsbl_get_cache_size
+                                   (MilterManagerDNSBL *dnsbl);
+void         milter_manager_dnsbl_clear_cache
+                                   (MilterManagerDNSBL *dnsbl);
+
+guint        milter_manager_dnsbl_check
+                                   (MilterManagerDNSBL *dnsbl,
+                                    MilterEventLoop    *loop,
+                                    const struct sockaddr *address,
+                                    socklen_t           address_length,
+                                    MilterManagerDNSBLCheckFunc func,
+                                    gpointer            user_data);
+void         milter_manager_dnsbl_cancel
+                                   (MilterManagerDNSBL *dnsbl,
+                                    guint               check_id);
+gboolean     milter_manager_dnsbl_is_listed
+                                   (MilterManagerDNSBL *dnsbl,
+                                    const struct sockaddr *address,
+                                    socklen_t           address_length);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_DNSBL_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -21,6 +21,11 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
 #include "milter-manager-egg.h"
 #include "milter-manager-enum-types.h"
 
@@ -34,6 +39,17 @@
 #define DEFAULT_END_OF_MESSAGE_TIMEOUT \
     (MILTER_SERVER_CONTEXT_DEFAULT_END_OF_MESSAGE_TIMEOUT - TIMEOUT_LEEWAY)
 
+#define DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT 60.0
+
+#define DEFAULT_LAUNCH_INTERVAL 1.0
+#define DEFAULT_MAXIMUM_LAUNCH_INTERVAL 60.0
+
+#define DEFAULT_CIRCUIT_BREAKER_ERROR_RATE 0.5
+#define DEFAULT_CIRCUIT_BREAKER_OPEN_TIME 30.0
+
+#define MINIMUM_PROBE_INTERVAL 0.005
+#define MAXIMUM_PROBE_INTERVAL 1.0
+
 #define MILTER_MANAGER_EGG_GET_PRIVATE(obj)                     \
     (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
                                  MILTER_TYPE_MANAGER_EGG,       \
@@ -56,6 +72,71 @@ struct _MilterManagerEggPrivate
     GList *applicable_conditions;
     MilterStatus fallback_status;
     gboolean evaluation_mode;
+    guint connection_pool_size;
+    gdouble connection_pool_idle_timeout;
+    GQueue *pooled_connections;
+    GMutex pool_mutex;
+    guint n_reused_connections;
+    guint n_missed_connections;
+    guint n_released_connections;
+    guint n_expired_connections;
+    guint n_broken_connections;
+    gdouble launch_interval;
+    gdouble maximum_launch_interval;
+    GMutex launch_mutex;
+    gint64 last_launch_time;
+    gdouble current_launch_interval;
+    guint n_launches;
+    guint n_suppressed_launches;
+    GHashTable *alive_probes;
+    guint last_alive_waiter_id;
+    guint circuit_breaker_window_size;
+    gdouble circuit_breaker_error_rate;
+    gdouble circuit_breaker_slow_reply_time;
+    gdouble circuit_breaker_open_time;
+    GMutex circuit_breaker_mutex;
+    MilterManagerCircuitBreakerState circuit_breaker_state;
+    guint8 *circuit_breaker_results;
+    guint circuit_breaker_results_size;
+    guint circuit_breaker_results_index;
+    guint circuit_breaker_n_results;
+    guint circuit_breaker_n_failures;
+    gint64 circuit_breaker_changed_time;
+    guint n_circuit_breaker_opens;
+    guint n_circuit_breaker_rejections;
+};
+
+typedef struct _AliveWaiter AliveWaiter;
+struct _AliveWaiter
+{
+    guint id;
+    MilterManagerEggAliveFunc function;
+    gpointer user_data;
+};
+
+/* Waiters are kept per event loop because they must be
+ * called in the event loop that added them. The probe of an
+ * event loop runs while it has waiters. */
+typedef struct _AliveProbe AliveProbe;
+struct _AliveProbe
+{
+    MilterManagerEgg *egg;
+    MilterEventLoop *event_loop;
+    GList *waiters;
+    gdouble interval;
+    guint timeout_id;
+    guint watch_id;
+    GIOChannel *channel;
+};
+
+typedef struct _PooledConnection PooledConnection;
+struct _PooledConnection
+{
+    GIOChannel *channel;
+    MilterOption *option;
+    MilterOption *negotiate_reply_option;
+    MilterMacrosRequests *macros_requests;
+    gint64 released_time;
 };
 
 enum
@@ -73,7 +154,15 @@ enum
     PROP_COMMAND,
     PROP_COMMAND_OPTIONS,
     PROP_FALLBACK_STATUS,
-    PROP_REPUTATION_MODE
+    PROP_REPUTATION_MODE,
+    PROP_CONNECTION_POOL_SIZE,
+    PROP_CONNECTION_POOL_IDLE_TIMEOUT,
+    PROP_LAUNCH_INTERVAL,
+    PROP_MAXIMUM_LAUNCH_INTERVAL,
+    PROP_CIRCUIT_BREAKER_WINDOW_SIZE,
+    PROP_CIRCUIT_BREAKER_ERROR_RATE,
+    PROP_CIRCUIT_BREAKER_SLOW_REPLY_TIME,
+    PROP_CIRCUIT_BREAKER_OPEN_TIME
 };
 
 enum
@@ -90,6 +179,7 @@ MILTER_DEFINE_ERROR_EMITTABLE_TYPE(MilterManagerEgg,
                                    G_TYPE_OBJECT)
 
 static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
 static void set_property   (GObject         *object,
                             guint            prop_id,
                             const GValue    *value,
@@ -108,6 +198,7 @@ milter_manager_egg_class_init (MilterManagerEggClass *klass)
     gobject_class = G_OBJECT_CLASS(klass);
 
     gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
@@ -215,6 +306,102 @@ milter_manager_egg_class_init (MilterManagerEggClass *klass)
                                 G_PARAM_READWRITE);
     g_object_class_install_property(gobject_class, PROP_REPUTATION_MODE, spec);
 
+    spec = g_param_spec_uint("connection-pool-size",
+                             "Connection pool size",
+                             "The max number of idle connections kept "
+                             "for reuse. 0 means connection pool is disabled",
+                             0,
+                             G_MAXUINT,
+                             0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_CONNECTION_POOL_SIZE,
+                                    spec);
+
+    spec = g_param_spec_double("connection-pool-idle-timeout",
+                               "Connection pool idle timeout",
+                               "The timeout in seconds for closing "
+                               "an idle connection in the connection pool",
+                               0,
+                               G_MAXDOUBLE,
+                               DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CONNECTION_POOL_IDLE_TIMEOUT,
+                                    spec);
+
+    spec = g_param_spec_double("launch-interval",
+                               "Launch interval",
+                               "The minimum interval in seconds between "
+                               "launches of the milter",
+                               0,
+                               G_MAXDOUBLE,
+                               DEFAULT_LAUNCH_INTERVAL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class, PROP_LAUNCH_INTERVAL, spec);
+
+    spec = g_param_spec_double("maximum-launch-interval",
+                               "Maximum launch interval",
+                               "The maximum interval in seconds between "
+                               "launches of the milter that doesn't "
+                               "accept connections",
+                               0,
+                               G_MAXDOUBLE,
+                               DEFAULT_MAXIMUM_LAUNCH_INTERVAL,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAXIMUM_LAUNCH_INTERVAL,
+                                    spec);
+
+    spec = g_param_spec_uint("circuit-breaker-window-size",
+                             "Circuit breaker window size",
+                             "The number of recent replies that are used "
+                             "to compute the error rate. "
+                             "0 means circuit breaker is disabled",
+                             0,
+                             G_MAXUINT,
+                             0,
+                             G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CIRCUIT_BREAKER_WINDOW_SIZE,
+                                    spec);
+
+    spec = g_param_spec_double("circuit-breaker-error-rate",
+                               "Circuit breaker error rate",
+                               "The error rate of recent replies that "
+                               "opens the circuit breaker",
+                               0,
+                               1,
+                               DEFAULT_CIRCUIT_BREAKER_ERROR_RATE,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CIRCUIT_BREAKER_ERROR_RATE,
+                                    spec);
+
+    spec = g_param_spec_double("circuit-breaker-slow-reply-time",
+                               "Circuit breaker slow reply time",
+                               "The time in seconds of a reply that is "
+                               "counted as an error. "
+                               "0 means that slow replies aren't errors",
+                               0,
+                               G_MAXDOUBLE,
+                               0,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CIRCUIT_BREAKER_SLOW_REPLY_TIME,
+                                    spec);
+
+    spec = g_param_spec_double("circuit-breaker-open-time",
+                               "Circuit breaker open time",
+                               "The time in seconds to skip the milter "
+                               "after the circuit breaker is opened",
+                               0,
+                               G_MAXDOUBLE,
+                               DEFAULT_CIRCUIT_BREAKER_OPEN_TIME,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property(gobject_class,
+                                    PROP_CIRCUIT_BREAKER_OPEN_TIME,
+                                    spec);
+
     signals[HATCHED] =
         g_signal_new("hatched",
                      G_TYPE_FROM_CLASS(klass),
@@ -258,6 +445,66 @@ milter_manager_egg_init (MilterManagerEgg *egg)
     priv->applicable_conditions = NULL;
     priv->fallback_status = MILTER_STATUS_ACCEPT;
     priv->evaluation_mode = FALSE;
+    priv->connection_pool_size = 0;
+    priv->connection_pool_idle_timeout = DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT;
+    priv->pooled_connections = g_queue_new();
+    g_mutex_init(&(priv->pool_mutex));
+    priv->n_reused_connections = 0;
+    priv->n_missed_connections = 0;
+    priv->n_released_connections = 0;
+    priv->n_expired_connections = 0;
+    priv->n_broken_connections = 0;
+    priv->launch_interval = DEFAULT_LAUNCH_INTERVAL;
+    priv->maximum_launch_interval = DEFAULT_MAXIMUM_LAUNCH_INTERVAL;
+    g_mutex_init(&(priv->launch_mutex));
+    priv->last_launch_time = 0;
+    priv->current_launch_interval = 0;
+    priv->n_launches = 0;
+    priv->n_suppressed_launches = 0;
+    priv->alive_probes =
+        g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                              NULL, (GDestroyNotify)alive_probe_free);
+    priv->last_alive_waiter_id = 0;
+    priv->circuit_breaker_window_size = 0;
+    priv->circuit_breaker_error_rate = DEFAULT_CIRCUIT_BREAKER_ERROR_RATE;
+    priv->circuit_breaker_slow_reply_time = 0;
+    priv->circuit_breaker_open_time = DEFAULT_CIRCUIT_BREAKER_OPEN_TIME;
+    g_mutex_init(&(priv->circuit_breaker_mutex));
+    priv->circuit_breaker_state = MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED;
+    priv->circuit_breaker_results = NULL;
+    priv->circuit_breaker_results_size = 0;
+    priv->circuit_breaker_results_index = 0;
+    priv->circuit_breaker_n_results = 0;
+    priv->circuit_breaker_n_failures = 0;
+    priv->circuit_breaker_changed_time = 0;
+    priv->n_circuit_breaker_opens = 0;
+    priv->n_circuit_breaker_rejections = 0;
+}
+
+static void
+alive_probe_free (AliveProbe *probe)
+{
+    if (probe->timeout_id > 0)
+        milter_event_loop_remove(probe->event_loop, probe->timeout_id);
+    if (probe->watch_id > 0)
+        milter_event_loop_remove(probe->event_loop, probe->watch_id);
+    if (probe->channel)
+        g_io_channel_unref(probe->channel);
+    g_list_free_full(probe->waiters, g_free);
+    g_object_unref(probe->event_loop);
+    g_free(probe);
+}
+
+static void
+pooled_connection_free (PooledConnection *connection)
+{
+    g_io_channel_unref(connection->channel);
+    g_object_unref(connection->option);
+    if (connection->negotiate_reply_option)
+        g_object_unref(connection->negotiate_reply_option);
+    if (connection->macros_requests)
+        g_object_unref(connection->macros_requests);
+    g_free(connection);
 }
 
 static void
@@ -301,9 +548,34 @@ dispose (GObject *object)
 
     milter_manager_egg_clear_applicable_conditions(egg);
 
+    if (priv->pooled_connections) {
+        milter_manager_egg_clear_pooled_connections(egg);
+        g_queue_free(priv->pooled_connections);
+        priv->pooled_connections = NULL;
+    }
+
+    if (priv->alive_probes) {
+        g_hash_table_unref(priv->alive_probes);
+        priv->alive_probes = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_egg_parent_class)->dispose(object);
 }
 
+static void
+finalize (GObject *object)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(object);
+    g_mutex_clear(&(priv->pool_mutex));
+    g_mutex_clear(&(priv->launch_mutex));
+    g_free(priv->circuit_breaker_results);
+    g_mutex_clear(&(priv->circuit_breaker_mutex));
+
+    G_OBJECT_CLASS(milter_manager_egg_parent_class)->finalize(object);
+}
+
 static void
 set_property (GObject      *object,
               guint         prop_id,
@@ -355,6 +627,32 @@ set_property (GObject      *object,
     case PROP_REPUTATION_MODE:
         milter_manager_egg_set_evaluation_mode(egg, g_value_get_boolean(value));
         break;
+    case PROP_CONNECTION_POOL_SIZE:
+        milter_manager_egg_set_connection_pool_size(egg,
+                                                    g_value_get_uint(value));
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        priv->connection_pool_idle_timeout = g_value_get_double(value);
+        break;
+    case PROP_LAUNCH_INTERVAL:
+        priv->launch_interval = g_value_get_double(value);
+        break;
+    case PROP_MAXIMUM_LAUNCH_INTERVAL:
+        priv->maximum_launch_interval = g_value_get_double(value);
+        break;
+    case PROP_CIRCUIT_BREAKER_WINDOW_SIZE:
+        milter_manager_egg_set_circuit_breaker_window_size(
+            egg, g_value_get_uint(value));
+        break;
+    case PROP_CIRCUIT_BREAKER_ERROR_RATE:
+        priv->circuit_breaker_error_rate = g_value_get_double(value);
+        break;
+    case PROP_CIRCUIT_BREAKER_SLOW_REPLY_TIME:
+        priv->circuit_breaker_slow_reply_time = g_value_get_double(value);
+        break;
+    case PROP_CIRCUIT_BREAKER_OPEN_TIME:
+        priv->circuit_breaker_open_time = g_value_get_double(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -410,6 +708,30 @@ get_property (GObject    *object,
     case PROP_REPUTATION_MODE:
         g_value_set_boolean(value, priv->evaluation_mode);
         break;
+    case PROP_CONNECTION_POOL_SIZE:
+        g_value_set_uint(value, priv->connection_pool_size);
+        break;
+    case PROP_CONNECTION_POOL_IDLE_TIMEOUT:
+        g_value_set_double(value, priv->connection_pool_idle_timeout);
+        break;
+    case PROP_LAUNCH_INTERVAL:
+        g_value_set_double(value, priv->launch_interval);
+        break;
+    case PROP_MAXIMUM_LAUNCH_INTERVAL:
+        g_value_set_double(value, priv->maximum_launch_interval);
+        break;
+    case PROP_CIRCUIT_BREAKER_WINDOW_SIZE:
+        g_value_set_uint(value, priv->circuit_breaker_window_size);
+        break;
+    case PROP_CIRCUIT_BREAKER_ERROR_RATE:
+        g_value_set_double(value, priv->circuit_breaker_error_rate);
+        break;
+    case PROP_CIRCUIT_BREAKER_SLOW_REPLY_TIME:
+        g_value_set_double(value, priv->circuit_breaker_slow_reply_time);
+        break;
+    case PROP_CIRCUIT_BREAKER_OPEN_TIME:
+        g_value_set_double(value, priv->circuit_breaker_open_time);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -738,6 +1060,921 @@ milter_manager_egg_is_evaluation_mode (MilterManagerEgg *egg)
     return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->evaluation_mode;
 }
 
+void
+milter_manager_egg_set_connection_pool_size (MilterManagerEgg *egg,
+                                             guint             size)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    g_mutex_lock(&(priv->pool_mutex));
+    priv->connection_pool_size = size;
+    while (g_queue_get_length(priv->pooled_connections) > size) {
+        pooled_connection_free(g_queue_pop_head(priv->pooled_connections));
+    }
+    g_mutex_unlock(&(priv->pool_mutex));
+}
+
+guint
+milter_manager_egg_get_connection_pool_size (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_size;
+}
+
+void
+milter_manager_egg_set_connection_pool_idle_timeout (MilterManagerEgg *egg,
+                                                     gdouble idle_timeout)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_idle_timeout =
+        idle_timeout;
+}
+
+gdouble
+milter_manager_egg_get_connection_pool_idle_timeout (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->connection_pool_idle_timeout;
+}
+
+static gboolean
+pooled_connection_is_expired (MilterManagerEggPrivate *priv,
+                              PooledConnection *connection,
+                              gint64 now)
+{
+    gdouble idle_time;
+
+    idle_time = (now - connection->released_time) / (gdouble)G_USEC_PER_SEC;
+    return idle_time >= priv->connection_pool_idle_timeout;
+}
+
+static void
+expire_pooled_connections (MilterManagerEggPrivate *priv)
+{
+    gint64 now;
+
+    now = g_get_monotonic_time();
+    while (!g_queue_is_empty(priv->pooled_connections)) {
+        PooledConnection *connection;
+
+        connection = g_queue_peek_head(priv->pooled_connections);
+        if (!pooled_connection_is_expired(priv, connection, now))
+            break;
+        g_queue_pop_head(priv->pooled_connections);
+        priv->n_expired_connections++;
+        pooled_connection_free(connection);
+    }
+}
+
+static gboolean
+pooled_connection_is_alive (PooledConnection *connection)
+{
+    GPollFD poll_fd;
+
+    /* An idle milter must not send anything. Readable data
+     * means EOF or garbage. Both can't be reused. */
+    poll_fd.fd = g_io_channel_unix_get_fd(connection->channel);
+    poll_fd.events = G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL;
+    poll_fd.revents = 0;
+    if (g_poll(&poll_fd, 1, 0) == -1)
+        return FALSE;
+
+    return poll_fd.revents == 0;
+}
+
+/**
+ * milter_manager_egg_lease_connection:
+ * @egg: A #MilterManagerEgg.
+ * @option: The negotiate option for the new session.
+ * @negotiate_reply_option: (out) (transfer full):
+ *   The negotiate reply option of the leased connection.
+ * @macros_requests: (out) (transfer full) (nullable):
+ *   The macros requests of the leased connection.
+ *
+ * Takes an idle connection that was negotiated with
+ * @option from the connection pool. Expired or broken
+ * connections are closed.
+ *
+ * Returns: (transfer full) (nullable): The leased connection
+ *   or %NULL if there is no reusable connection.
+ */
+GIOChannel *
+milter_manager_egg_lease_connection (MilterManagerEgg      *egg,
+                                     MilterOption          *option,
+                                     MilterOption         **negotiate_reply_option,
+                                     MilterMacrosRequests **macros_requests)
+{
+    MilterManagerEggPrivate *priv;
+    GIOChannel *channel = NULL;
+    GList *node;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    if (priv->connection_pool_size == 0)
+        return NULL;
+
+    /* Event loop threads share eggs. */
+    g_mutex_lock(&(priv->pool_mutex));
+
+    expire_pooled_connections(priv);
+
+    /* Use the most recently released connection first. It is
+     * the least likely to be closed by the milter. */
+    node = g_queue_peek_tail_link(priv->pooled_connections);
+    while (node) {
+        PooledConnection *connection = node->data;
+        GList *previous_node;
+
+        previous_node = g_list_previous(node);
+        if (!milter_option_equal(connection->option, option)) {
+            node = previous_node;
+            continue;
+        }
+
+        g_queue_delete_link(priv->pooled_connections, node);
+        if (!pooled_connection_is_alive(connection)) {
+            milter_debug("[egg][connection-pool][broken] <%s>: %d",
+                         priv->name ? priv->name : "(null)",
+                         g_io_channel_unix_get_fd(connection->channel));
+            priv->n_broken_connections++;
+            pooled_connection_free(connection);
+            node = previous_node;
+            continue;
+        }
+
+        channel = connection->channel;
+        *negotiate_reply_option = connection->negotiate_reply_option;
+        *macros_requests = connection->macros_requests;
+        g_object_unref(connection->option);
+        g_free(connection);
+
+        priv->n_reused_connections++;
+        milter_debug("[egg][connection-pool][reuse] <%s>: %d",
+                     priv->name ? priv->name : "(null)",
+                     g_io_channel_unix_get_fd(channel));
+        break;
+    }
+
+    if (!channel)
+        priv->n_missed_connections++;
+    g_mutex_unlock(&(priv->pool_mutex));
+
+    return channel;
+}
+
+/**
+ * milter_manager_egg_release_connection:
+ * @egg: A #MilterManagerEgg.
+ * @channel: A connection that is quitted by SMFIC_QUIT_NC.
+ * @option: The negotiate option sent on the connection.
+ * @negotiate_reply_option: The negotiate reply option
+ *   received on the connection.
+ * @macros_requests: (nullable): The macros requests
+ *   received on the connection.
+ *
+ * Puts @channel into the connection pool. @channel isn't
+ * pooled if the pool is disabled or full.
+ *
+ * Returns: %TRUE if @channel is pooled, %FALSE otherwise.
+ */
+gboolean
+milter_manager_egg_release_connection (MilterManagerEgg     *egg,
+                                       GIOChannel           *channel,
+                                       MilterOption         *option,
+                                       MilterOption         *negotiate_reply_option,
+                                       MilterMacrosRequests *macros_requests)
+{
+    MilterManagerEggPrivate *priv;
+    PooledConnection *connection;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->pool_mutex));
+
+    expire_pooled_connections(priv);
+
+    if (g_queue_get_length(priv->pooled_connections) >=
+        priv->connection_pool_size) {
+        g_mutex_unlock(&(priv->pool_mutex));
+        return FALSE;
+    }
+
+    connection = g_new0(PooledConnection, 1);
+    connection->channel = g_io_channel_ref(channel);
+    connection->option = milter_option_copy(option);
+    connection->negotiate_reply_option =
+        milter_option_copy(negotiate_reply_option);
+    if (macros_requests)
+        connection->macros_requests = g_object_ref(macros_requests);
+    connection->released_time = g_get_monotonic_time();
+    g_queue_push_tail(priv->pooled_connections, connection);
+
+    priv->n_released_connections++;
+    milter_debug("[egg][connection-pool][release] <%s>: %d: <%u>/<%u>",
+                 priv->name ? priv->name : "(null)",
+                 g_io_channel_unix_get_fd(channel),
+                 g_queue_get_length(priv->pooled_connections),
+                 priv->connection_pool_size);
+
+    g_mutex_unlock(&(priv->pool_mutex));
+
+    return TRUE;
+}
+
+void
+milter_manager_egg_expire_pooled_connections (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->pool_mutex));
+    expire_pooled_connections(priv);
+    g_mutex_unlock(&(priv->pool_mutex));
+}
+
+void
+milter_manager_egg_clear_pooled_connections (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    g_mutex_lock(&(priv->pool_mutex));
+    while (!g_queue_is_empty(priv->pooled_connections)) {
+        pooled_connection_free(g_queue_pop_head(priv->pooled_connections));
+    }
+    g_mutex_unlock(&(priv->pool_mutex));
+}
+
+guint
+milter_manager_egg_get_n_pooled_connections (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    guint n_connections;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    g_mutex_lock(&(priv->pool_mutex));
+    n_connections = g_queue_get_length(priv->pooled_connections);
+    g_mutex_unlock(&(priv->pool_mutex));
+    return n_connections;
+}
+
+guint
+milter_manager_egg_get_n_reused_connections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_reused_connections;
+}
+
+guint
+milter_manager_egg_get_n_missed_connections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_missed_connections;
+}
+
+guint
+milter_manager_egg_get_n_released_connections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_released_connections;
+}
+
+guint
+milter_manager_egg_get_n_expired_connections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_expired_connections;
+}
+
+guint
+milter_manager_egg_get_n_broken_connections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_broken_connections;
+}
+
+/**
+ * milter_manager_egg_count_broken_connection:
+ * @egg: A #MilterManagerEgg.
+ *
+ * Counts a connection that can't be pooled because it is
+ * broken while it is released.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_manager_egg_count_broken_connection (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+    g_mutex_lock(&(priv->pool_mutex));
+    priv->n_broken_connections++;
+    g_mutex_unlock(&(priv->pool_mutex));
+}
+
+void
+milter_manager_egg_set_launch_interval (MilterManagerEgg *egg,
+                                        gdouble           interval)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->launch_interval = interval;
+}
+
+gdouble
+milter_manager_egg_get_launch_interval (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->launch_interval;
+}
+
+void
+milter_manager_egg_set_maximum_launch_interval (MilterManagerEgg *egg,
+                                                gdouble           interval)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->maximum_launch_interval = interval;
+}
+
+gdouble
+milter_manager_egg_get_maximum_launch_interval (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->maximum_launch_interval;
+}
+
+/**
+ * milter_manager_egg_try_launch:
+ * @egg: A #MilterManagerEgg.
+ *
+ * Decides whether the milter should be launched now. A
+ * launch is allowed once per interval. The interval starts
+ * at #MilterManagerEgg:launch-interval and is doubled up to
+ * #MilterManagerEgg:maximum-launch-interval while the
+ * milter doesn't accept connections after launches.
+ * milter_manager_egg_mark_alive() resets it.
+ *
+ * Returns: %TRUE if the caller should launch the milter,
+ *   %FALSE if it has been launched recently.
+ */
+gboolean
+milter_manager_egg_try_launch (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    gint64 now;
+    gboolean launch = TRUE;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    now = g_get_monotonic_time();
+    g_mutex_lock(&(priv->launch_mutex));
+    if (priv->last_launch_time == 0) {
+        priv->current_launch_interval = priv->launch_interval;
+    } else if (now - priv->last_launch_time <
+               priv->current_launch_interval * G_USEC_PER_SEC) {
+        launch = FALSE;
+    } else {
+        priv->current_launch_interval =
+            MIN(priv->current_launch_interval * 2,
+                priv->maximum_launch_interval);
+    }
+    if (launch) {
+        priv->last_launch_time = now;
+        priv->n_launches++;
+    } else {
+        priv->n_suppressed_launches++;
+    }
+    g_mutex_unlock(&(priv->launch_mutex));
+
+    if (launch) {
+        milter_debug("[egg][launch] <%s>: next=<%g>",
+                     priv->name ? priv->name : "(null)",
+                     priv->current_launch_interval);
+    } else {
+        milter_debug("[egg][launch][suppress] <%s>",
+                     priv->name ? priv->name : "(null)");
+    }
+
+    return launch;
+}
+
+guint
+milter_manager_egg_get_n_launches (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_launches;
+}
+
+guint
+milter_manager_egg_get_n_suppressed_launches (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_suppressed_launches;
+}
+
+/**
+ * milter_manager_egg_mark_alive:
+ * @egg: A #MilterManagerEgg.
+ * @loop: The event loop of the caller.
+ *
+ * Records that the milter accepts connections. It resets the
+ * launch interval and calls all waiters that are added in
+ * @loop by milter_manager_egg_add_alive_waiter(). Waiters in
+ * other event loops are called by their own probes.
+ */
+void
+milter_manager_egg_mark_alive (MilterManagerEgg *egg, MilterEventLoop *loop)
+{
+    MilterManagerEggPrivate *priv;
+    AliveProbe *probe;
+    GList *waiters = NULL;
+    GList *node;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->launch_mutex));
+    priv->last_launch_time = 0;
+    priv->current_launch_interval = priv->launch_interval;
+    probe = g_hash_table_lookup(priv->alive_probes, loop);
+    if (probe) {
+        waiters = probe->waiters;
+        probe->waiters = NULL;
+        g_hash_table_remove(priv->alive_probes, loop);
+    }
+    g_mutex_unlock(&(priv->launch_mutex));
+
+    if (!waiters)
+        return;
+
+    milter_debug("[egg][alive] <%s>: <%u>",
+                 priv->name ? priv->name : "(null)",
+                 g_list_length(waiters));
+    g_object_ref(egg);
+    for (node = waiters; node; node = g_list_next(node)) {
+        AliveWaiter *waiter = node->data;
+
+        waiter->function(egg, waiter->user_data);
+    }
+    g_list_free_full(waiters, g_free);
+    g_object_unref(egg);
+}
+
+static void probe_connection (AliveProbe *probe);
+
+static gboolean
+cb_probe_timeout (gpointer user_data)
+{
+    AliveProbe *probe = user_data;
+
+    probe->timeout_id = 0;
+    probe_connection(probe);
+
+    return FALSE;
+}
+
+static void
+schedule_probe (AliveProbe *probe)
+{
+    probe->timeout_id = milter_event_loop_add_timeout(probe->event_loop,
+                                                      probe->interval,
+                                                      cb_probe_timeout,
+                                                      probe);
+    probe->interval = MIN(probe->interval * 2, MAXIMUM_PROBE_INTERVAL);
+}
+
+static gboolean
+cb_probe_connected (GIOChannel *channel, GIOCondition condition,
+                    gpointer user_data)
+{
+    AliveProbe *probe = user_data;
+    gint socket_errno = 0;
+    socklen_t option_length;
+
+    option_length = sizeof(socket_errno);
+    if (getsockopt(g_io_channel_unix_get_fd(channel),
+                   SOL_SOCKET, SO_ERROR,
+                   &socket_errno, &option_length) == -1) {
+        socket_errno = errno;
+    }
+
+    probe->watch_id = 0;
+    g_io_channel_unref(probe->channel);
+    probe->channel = NULL;
+
+    if (socket_errno == 0) {
+        /* probe is freed. */
+        milter_manager_egg_mark_alive(probe->egg, probe->event_loop);
+    } else {
+        schedule_probe(probe);
+    }
+
+    return FALSE;
+}
+
+static void
+probe_connection (AliveProbe *probe)
+{
+    MilterManagerEggPrivate *priv;
+    gint domain;
+    struct sockaddr *address = NULL;
+    socklen_t address_size;
+    gint fd;
+    gint result;
+    gint connect_errno;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(probe->egg);
+
+    if (!priv->connection_spec ||
+        !milter_connection_parse_spec(priv->connection_spec,
+                                      &domain, &address, &address_size,
+                                      NULL)) {
+        schedule_probe(probe);
+        return;
+    }
+
+    fd = socket(domain, SOCK_STREAM, 0);
+    if (fd == -1 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1) {
+        if (fd != -1)
+            close(fd);
+        g_free(address);
+        schedule_probe(probe);
+        return;
+    }
+
+    result = connect(fd, address, address_size);
+    connect_errno = errno;
+    g_free(address);
+
+    if (result == 0 || connect_errno == EAGAIN) {
+        /* EAGAIN means that a UNIX domain socket is listened
+         * but its backlog is full. */
+        close(fd);
+        /* probe is freed. */
+        milter_manager_egg_mark_alive(probe->egg, probe->event_loop);
+    } else if (connect_errno == EINPROGRESS) {
+        probe->channel = g_io_channel_unix_new(fd);
+        g_io_channel_set_close_on_unref(probe->channel, TRUE);
+        probe->watch_id =
+            milter_event_loop_watch_io(probe->event_loop,
+                                       probe->channel,
+                                       G_IO_OUT | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+                                       cb_probe_connected,
+                                       probe);
+    } else {
+        close(fd);
+        schedule_probe(probe);
+    }
+}
+
+/**
+ * milter_manager_egg_add_alive_waiter:
+ * @egg: A #MilterManagerEgg.
+ * @loop: The event loop that calls @function.
+ * @function: The function called when the milter accepts
+ *   connections.
+ * @user_data: The data passed to @function.
+ *
+ * Waits for the milter to accept connections. While @loop
+ * has waiters, it probes the milter's connection spec with
+ * an increasing interval from a few milliseconds. The first
+ * successful probe or milter_manager_egg_mark_alive() calls
+ * all waiters in @loop at once.
+ *
+ * Returns: The ID of the added waiter.
+ */
+guint
+milter_manager_egg_add_alive_waiter (MilterManagerEgg          *egg,
+                                     MilterEventLoop           *loop,
+                                     MilterManagerEggAliveFunc  function,
+                                     gpointer                   user_data)
+{
+    MilterManagerEggPrivate *priv;
+    AliveProbe *probe;
+    AliveWaiter *waiter;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    waiter = g_new0(AliveWaiter, 1);
+    waiter->function = function;
+    waiter->user_data = user_data;
+
+    g_mutex_lock(&(priv->launch_mutex));
+    priv->last_alive_waiter_id++;
+    if (priv->last_alive_waiter_id == 0)
+        priv->last_alive_waiter_id++;
+    waiter->id = priv->last_alive_waiter_id;
+    probe = g_hash_table_lookup(priv->alive_probes, loop);
+    if (!probe) {
+        probe = g_new0(AliveProbe, 1);
+        probe->egg = egg;
+        probe->event_loop = g_object_ref(loop);
+        probe->interval = MINIMUM_PROBE_INTERVAL;
+        g_hash_table_insert(priv->alive_probes, loop, probe);
+        schedule_probe(probe);
+    }
+    probe->waiters = g_list_append(probe->waiters, waiter);
+    g_mutex_unlock(&(priv->launch_mutex));
+
+    return waiter->id;
+}
+
+void
+milter_manager_egg_remove_alive_waiter (MilterManagerEgg *egg,
+                                        MilterEventLoop  *loop,
+                                        guint             id)
+{
+    MilterManagerEggPrivate *priv;
+    AliveProbe *probe;
+    GList *node;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->launch_mutex));
+    probe = g_hash_table_lookup(priv->alive_probes, loop);
+    if (probe) {
+        for (node = probe->waiters; node; node = g_list_next(node)) {
+            AliveWaiter *waiter = node->data;
+
+            if (waiter->id == id) {
+                g_free(waiter);
+                probe->waiters = g_list_delete_link(probe->waiters, node);
+                break;
+            }
+        }
+        if (!probe->waiters)
+            g_hash_table_remove(priv->alive_probes, loop);
+    }
+    g_mutex_unlock(&(priv->launch_mutex));
+}
+
+guint
+milter_manager_egg_get_n_alive_waiters (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    GHashTableIter iter;
+    gpointer value;
+    guint n_waiters = 0;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->launch_mutex));
+    g_hash_table_iter_init(&iter, priv->alive_probes);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        AliveProbe *probe = value;
+
+        n_waiters += g_list_length(probe->waiters);
+    }
+    g_mutex_unlock(&(priv->launch_mutex));
+
+    return n_waiters;
+}
+
+static void
+reset_circuit_breaker_results (MilterManagerEggPrivate *priv)
+{
+    if (priv->circuit_breaker_results_size !=
+        priv->circuit_breaker_window_size) {
+        g_free(priv->circuit_breaker_results);
+        priv->circuit_breaker_results =
+            g_new0(guint8, priv->circuit_breaker_window_size);
+        priv->circuit_breaker_results_size =
+            priv->circuit_breaker_window_size;
+    }
+    priv->circuit_breaker_results_index = 0;
+    priv->circuit_breaker_n_results = 0;
+    priv->circuit_breaker_n_failures = 0;
+}
+
+void
+milter_manager_egg_set_circuit_breaker_window_size (MilterManagerEgg *egg,
+                                                    guint             size)
+{
+    MilterManagerEggPrivate *priv;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    if (priv->circuit_breaker_window_size == size)
+        return;
+
+    g_mutex_lock(&(priv->circuit_breaker_mutex));
+    priv->circuit_breaker_window_size = size;
+    priv->circuit_breaker_state = MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED;
+    reset_circuit_breaker_results(priv);
+    g_mutex_unlock(&(priv->circuit_breaker_mutex));
+}
+
+guint
+milter_manager_egg_get_circuit_breaker_window_size (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_window_size;
+}
+
+void
+milter_manager_egg_set_circuit_breaker_error_rate (MilterManagerEgg *egg,
+                                                   gdouble           rate)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_error_rate = rate;
+}
+
+gdouble
+milter_manager_egg_get_circuit_breaker_error_rate (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_error_rate;
+}
+
+void
+milter_manager_egg_set_circuit_breaker_slow_reply_time (MilterManagerEgg *egg,
+                                                        gdouble           time)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_slow_reply_time = time;
+}
+
+gdouble
+milter_manager_egg_get_circuit_breaker_slow_reply_time (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_slow_reply_time;
+}
+
+void
+milter_manager_egg_set_circuit_breaker_open_time (MilterManagerEgg *egg,
+                                                  gdouble           time)
+{
+    MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_open_time = time;
+}
+
+gdouble
+milter_manager_egg_get_circuit_breaker_open_time (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_open_time;
+}
+
+static void
+open_circuit_breaker (MilterManagerEggPrivate *priv, gint64 now)
+{
+    priv->circuit_breaker_state = MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN;
+    priv->circuit_breaker_changed_time = now;
+    priv->n_circuit_breaker_opens++;
+    milter_error("[egg][circuit-breaker][open] <%s>: <%u>/<%u>",
+                 priv->name ? priv->name : "(null)",
+                 priv->circuit_breaker_n_failures,
+                 priv->circuit_breaker_n_results);
+}
+
+/**
+ * milter_manager_egg_pass_circuit_breaker:
+ * @egg: A #MilterManagerEgg.
+ *
+ * Decides whether a new session uses the milter. While the
+ * circuit breaker is open, sessions skip the milter and its
+ * fallback status is used immediately. After
+ * #MilterManagerEgg:circuit-breaker-open-time, the circuit
+ * breaker becomes half-open and passes one session as a
+ * trial.
+ *
+ * Returns: %TRUE if the session should use the milter,
+ *   %FALSE otherwise.
+ */
+gboolean
+milter_manager_egg_pass_circuit_breaker (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    gboolean pass = TRUE;
+    gint64 now;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    if (priv->circuit_breaker_window_size == 0)
+        return TRUE;
+
+    now = g_get_monotonic_time();
+    g_mutex_lock(&(priv->circuit_breaker_mutex));
+    switch (priv->circuit_breaker_state) {
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED:
+        break;
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN:
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN:
+        /* A half-open trial that doesn't report anything in
+         * the open time is replaced by a new trial. */
+        if (now - priv->circuit_breaker_changed_time <
+            priv->circuit_breaker_open_time * G_USEC_PER_SEC) {
+            pass = FALSE;
+            break;
+        }
+        priv->circuit_breaker_state =
+            MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN;
+        priv->circuit_breaker_changed_time = now;
+        milter_info("[egg][circuit-breaker][half-open] <%s>",
+                    priv->name ? priv->name : "(null)");
+        break;
+    }
+    if (!pass)
+        priv->n_circuit_breaker_rejections++;
+    g_mutex_unlock(&(priv->circuit_breaker_mutex));
+
+    return pass;
+}
+
+/**
+ * milter_manager_egg_report_reply:
+ * @egg: A #MilterManagerEgg.
+ * @success: Whether the milter replied or not.
+ * @elapsed: The elapsed time in seconds for the reply.
+ *
+ * Records a reply or a failure such as a timeout or a
+ * connection error for the circuit breaker. A reply that
+ * takes #MilterManagerEgg:circuit-breaker-slow-reply-time or
+ * more is recorded as a failure.
+ */
+void
+milter_manager_egg_report_reply (MilterManagerEgg *egg,
+                                 gboolean          success,
+                                 gdouble           elapsed)
+{
+    MilterManagerEggPrivate *priv;
+    guint8 failure;
+    gint64 now;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    if (priv->circuit_breaker_window_size == 0)
+        return;
+
+    if (success &&
+        priv->circuit_breaker_slow_reply_time > 0 &&
+        elapsed >= priv->circuit_breaker_slow_reply_time)
+        success = FALSE;
+    failure = success ? 0 : 1;
+
+    now = g_get_monotonic_time();
+    g_mutex_lock(&(priv->circuit_breaker_mutex));
+    switch (priv->circuit_breaker_state) {
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED:
+        if (priv->circuit_breaker_n_results ==
+            priv->circuit_breaker_results_size) {
+            priv->circuit_breaker_n_failures -=
+                priv->circuit_breaker_results[
+                    priv->circuit_breaker_results_index];
+        } else {
+            priv->circuit_breaker_n_results++;
+        }
+        priv->circuit_breaker_results[priv->circuit_breaker_results_index] =
+            failure;
+        priv->circuit_breaker_n_failures += failure;
+        priv->circuit_breaker_results_index =
+            (priv->circuit_breaker_results_index + 1) %
+            priv->circuit_breaker_results_size;
+        if (priv->circuit_breaker_n_results ==
+            priv->circuit_breaker_results_size &&
+            priv->circuit_breaker_n_failures >=
+            priv->circuit_breaker_error_rate *
+            priv->circuit_breaker_results_size) {
+            open_circuit_breaker(priv, now);
+        }
+        break;
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN:
+        /* A late result of a session that is started before
+         * the circuit breaker is opened. */
+        break;
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN:
+        if (success) {
+            priv->circuit_breaker_state =
+                MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED;
+            priv->circuit_breaker_changed_time = now;
+            reset_circuit_breaker_results(priv);
+            milter_info("[egg][circuit-breaker][close] <%s>",
+                        priv->name ? priv->name : "(null)");
+        } else {
+            open_circuit_breaker(priv, now);
+        }
+        break;
+    }
+    g_mutex_unlock(&(priv->circuit_breaker_mutex));
+}
+
+MilterManagerCircuitBreakerState
+milter_manager_egg_get_circuit_breaker_state (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->circuit_breaker_state;
+}
+
+gdouble
+milter_manager_egg_get_circuit_breaker_current_error_rate (MilterManagerEgg *egg)
+{
+    MilterManagerEggPrivate *priv;
+    gdouble rate = 0.0;
+
+    priv = MILTER_MANAGER_EGG_GET_PRIVATE(egg);
+
+    g_mutex_lock(&(priv->circuit_breaker_mutex));
+    if (priv->circuit_breaker_n_results > 0)
+        rate = (gdouble)priv->circuit_breaker_n_failures /
+            priv->circuit_breaker_n_results;
+    g_mutex_unlock(&(priv->circuit_breaker_mutex));
+
+    return rate;
+}
+
+guint
+milter_manager_egg_get_n_circuit_breaker_opens (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_circuit_breaker_opens;
+}
+
+guint
+milter_manager_egg_get_n_circuit_breaker_rejections (MilterManagerEgg *egg)
+{
+    return MILTER_MANAGER_EGG_GET_PRIVATE(egg)->n_circuit_breaker_rejections;
+}
+
 void
 milter_manager_egg_add_applicable_condition (MilterManagerEgg *egg,
                                              MilterManagerApplicableCondition *condition)
@@ -822,6 +2059,31 @@ milter_manager_egg_merge (MilterManagerEgg *egg,
 
 #undef MERGE_TIMEOUT
 
+    milter_manager_egg_set_connection_pool_size(
+        egg,
+        milter_manager_egg_get_connection_pool_size(other_egg));
+    milter_manager_egg_set_connection_pool_idle_timeout(
+        egg,
+        milter_manager_egg_get_connection_pool_idle_timeout(other_egg));
+    milter_manager_egg_set_launch_interval(
+        egg,
+        milter_manager_egg_get_launch_interval(other_egg));
+    milter_manager_egg_set_maximum_launch_interval(
+        egg,
+        milter_manager_egg_get_maximum_launch_interval(other_egg));
+    milter_manager_egg_set_circuit_breaker_window_size(
+        egg,
+        milter_manager_egg_get_circuit_breaker_window_size(other_egg));
+    milter_manager_egg_set_circuit_breaker_error_rate(
+        egg,
+        milter_manager_egg_get_circuit_breaker_error_rate(other_egg));
+    milter_manager_egg_set_circuit_breaker_slow_reply_time(
+        egg,
+        milter_manager_egg_get_circuit_breaker_slow_reply_time(other_egg));
+    milter_manager_egg_set_circuit_breaker_open_time(
+        egg,
+        milter_manager_egg_get_circuit_breaker_open_time(other_egg));
+
     description = milter_manager_egg_get_description(other_egg);
     if (description)
         milter_manager_egg_set_description(egg, description);
@@ -909,6 +2171,24 @@ milter_manager_egg_to_xml_string (MilterManagerEgg *egg,
                                              priv->command_options,
                                              indent + 2);
 
+    if (priv->connection_pool_size > 0) {
+        gchar *size;
+        gchar idle_timeout[G_ASCII_DTOSTR_BUF_SIZE];
+
+        size = g_strdup_printf("%u", priv->connection_pool_size);
+        milter_utils_xml_append_text_element(string,
+                                             "connection-pool-size",
+                                             size,
+                                             indent + 2);
+        g_free(size);
+        g_ascii_dtostr(idle_timeout, sizeof(idle_timeout),
+                       priv->connection_pool_idle_timeout);
+        milter_utils_xml_append_text_element(string,
+                                             "connection-pool-idle-timeout",
+                                             idle_timeout,
+                                             indent + 2);
+    }
+
     if (priv->applicable_conditions) {
         GList *node = priv->applicable_conditions;
 
@@ -44,8 +44,18 @@ typedef enum
     MILTER_MANAGER_EGG_ERROR_INVALID
 } MilterManagerEggError;
 
+typedef enum
+{
+    MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED,
+    MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN,
+    MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN
+} MilterManagerCircuitBreakerState;
+
 typedef struct _MilterManagerEggClass    MilterManagerEggClass;
 
+typedef void (*MilterManagerEggAliveFunc) (MilterManagerEgg *egg,
+                                           gpointer          user_data);
+
 struct _MilterManagerEgg
 {
     GObject object;
@@ -135,6 +145,114 @@ void                milter_manager_egg_set_evaluation_mode
 gboolean            milter_manager_egg_is_evaluation_mode
                                                 (MilterManagerEgg *egg);
 
+void                milter_manager_egg_set_connection_pool_size
+                                                (MilterManagerEgg *egg,
+                                                 guint             size);
+guint               milter_manager_egg_get_connection_pool_size
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           idle_timeout);
+gdouble             milter_manager_egg_get_connection_pool_idle_timeout
+                                                (MilterManagerEgg *egg);
+
+GIOChannel         *milter_manager_egg_lease_connection
+                                                (MilterManagerEgg      *egg,
+                                                 MilterOption          *option,
+                                                 MilterOption         **negotiate_reply_option,
+                                                 MilterMacrosRequests **macros_requests);
+gboolean            milter_manager_egg_release_connection
+                                                (MilterManagerEgg     *egg,
+                                                 GIOChannel           *channel,
+                                                 MilterOption         *option,
+                                                 MilterOption         *negotiate_reply_option,
+                                                 MilterMacrosRequests *macros_requests);
+void                milter_manager_egg_expire_pooled_connections
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_clear_pooled_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_pooled_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_reused_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_missed_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_released_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_expired_connections
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_broken_connections
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_count_broken_connection
+                                                (MilterManagerEgg *egg);
+
+void                milter_manager_egg_set_launch_interval
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           interval);
+gdouble             milter_manager_egg_get_launch_interval
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_maximum_launch_interval
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           interval);
+gdouble             milter_manager_egg_get_maximum_launch_interval
+                                                (MilterManagerEgg *egg);
+gboolean            milter_manager_egg_try_launch
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_launches
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_suppressed_launches
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_mark_alive
+                                                (MilterManagerEgg *egg,
+                                                 MilterEventLoop  *loop);
+guint               milter_manager_egg_add_alive_waiter
+                                                (MilterManagerEgg          *egg,
+                                                 MilterEventLoop           *loop,
+                                                 MilterManagerEggAliveFunc  function,
+                                                 gpointer                   user_data);
+void                milter_manager_egg_remove_alive_waiter
+                                                (MilterManagerEgg *egg,
+                                                 MilterEventLoop  *loop,
+                                                 guint             id);
+guint               milter_manager_egg_get_n_alive_waiters
+                                                (MilterManagerEgg *egg);
+
+void                milter_manager_egg_set_circuit_breaker_window_size
+                                                (MilterManagerEgg *egg,
+                                                 guint             size);
+guint               milter_manager_egg_get_circuit_breaker_window_size
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_circuit_breaker_error_rate
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           rate);
+gdouble             milter_manager_egg_get_circuit_breaker_error_rate
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_circuit_breaker_slow_reply_time
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           time);
+gdouble             milter_manager_egg_get_circuit_breaker_slow_reply_time
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_set_circuit_breaker_open_time
+                                                (MilterManagerEgg *egg,
+                                                 gdouble           time);
+gdouble             milter_manager_egg_get_circuit_breaker_open_time
+                                                (MilterManagerEgg *egg);
+gboolean            milter_manager_egg_pass_circuit_breaker
+                                                (MilterManagerEgg *egg);
+void                milter_manager_egg_report_reply
+                                                (MilterManagerEgg *egg,
+                                                 gboolean          success,
+                                                 gdouble           elapsed);
+MilterManagerCircuitBreakerState
+                    milter_manager_egg_get_circuit_breaker_state
+                                                (MilterManagerEgg *egg);
+gdouble             milter_manager_egg_get_circuit_breaker_current_error_rate
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_circuit_breaker_opens
+                                                (MilterManagerEgg *egg);
+guint               milter_manager_egg_get_n_circuit_breaker_rejections
+                                                (MilterManagerEgg *egg);
+
 void                milter_manager_egg_add_applicable_condition
                                                 (MilterManagerEgg *egg,
                                                  MilterManagerApplicableCondition *condition);
@@ -21,6 +21,8 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <netinet/in.h>
+
 #include "milter-manager-leader.h"
 #include "milter-manager-enum-types.h"
 #include "milter-manager-children.h"
@@ -40,6 +42,7 @@ struct _MilterManagerLeaderPrivate
     gboolean sent_end_of_message;
     GIOChannel *launcher_read_channel;
     GIOChannel *launcher_write_channel;
+    MilterManagerMetrics *metrics;
     gboolean processing;
     guint tag;
 };
@@ -152,6 +155,7 @@ milter_manager_leader_init (MilterManagerLeader *leader)
     priv->sent_end_of_message = FALSE;
     priv->launcher_read_channel = NULL;
     priv->launcher_write_channel = NULL;
+    priv->metrics = NULL;
     priv->processing = FALSE;
     priv->tag = 0;
 }
@@ -271,7 +275,7 @@ dispose (GObject *object)
         priv->children = NULL;
     }
     milter_manager_leader_set_launcher_channel(leader, NULL, NULL);
-
+    milter_manager_leader_set_metrics(leader, NULL);
 
     G_OBJECT_CLASS(milter_manager_leader_parent_class)->dispose(object);
 }
@@ -334,10 +338,74 @@ get_property (GObject    *object,
     }
 }
 
+static gboolean
+is_local_address (MilterGenericSocketAddress *address)
+{
+    switch (address->address.base.sa_family) {
+    case AF_INET:
+    {
+        guint32 address_inet;
+
+        address_inet = g_ntohl(address->address.inet.sin_addr.s_addr);
+        return ((address_inet & 0xff000000) == 0x7f000000 ||
+                (address_inet & 0xff000000) == 0x0a000000 ||
+                (address_inet & 0xfff00000) == 0xac100000 ||
+                (address_inet & 0xffff0000) == 0xc0a80000);
+    }
+    case AF_INET6:
+    {
+        struct in6_addr *address_inet6;
+
+        address_inet6 = &(address->address.inet6.sin6_addr);
+        return IN6_IS_ADDR_LOOPBACK(address_inet6) ||
+            IN6_IS_ADDR_LINKLOCAL(address_inet6);
+    }
+    case AF_UNIX:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
 static gboolean
 connection_check_default (MilterManagerLeader *leader)
 {
+    MilterManagerLeaderPrivate *priv;
+    MilterManagerConnectionTable *table;
+    MilterGenericSocketAddress *server_address;
+    struct sockaddr *client_address = NULL;
+    socklen_t client_address_length = 0;
     gboolean connecting = TRUE;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+
+    if (!priv->children)
+        return connecting;
+
+    /* We can only see the connection between SMTP client and SMTP
+     * server when they are on the same host as milter-manager. */
+    server_address = milter_client_context_get_socket_address(priv->client_context);
+    if (!server_address || !is_local_address(server_address))
+        return connecting;
+
+    /* This may be called in an event loop thread while the
+     * configuration is reloaded in the main thread. */
+    table = milter_manager_configuration_ref_connection_table(priv->configuration);
+    if (!table)
+        return connecting;
+
+    if (milter_manager_connection_table_ensure_updated(table) &&
+        milter_manager_children_get_smtp_client_address(priv->children,
+                                                        &client_address,
+                                                        &client_address_length)) {
+        connecting =
+            milter_manager_connection_table_is_connected(table,
+                                                         client_address,
+                                                         client_address_length);
+        g_free(client_address);
+    }
+    g_object_unref(table);
+
     return connecting;
 }
 
@@ -436,6 +504,18 @@ state_to_response_signal_name (MilterManagerLeaderState state)
     return signal_name;
 }
 
+static void
+set_state (MilterManagerLeader *leader, MilterManagerLeaderState state)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+    if (priv->metrics)
+        milter_manager_metrics_transit_leader(priv->metrics,
+                                              priv->state, state);
+    priv->state = state;
+}
+
 static MilterManagerLeaderState
 next_state (MilterManagerLeader *leader,
             MilterManagerLeaderState state)
@@ -559,7 +639,7 @@ reply (MilterManagerLeader *leader, MilterStatus status)
             return;
         }
     }
-    priv->state = next_state(leader, priv->state);
+    set_state(leader, next_state(leader, priv->state));
 }
 
 static void
@@ -994,7 +1074,7 @@ milter_manager_leader_negotiate (MilterManagerLeader *leader,
     MilterEventLoop *event_loop;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_NEGOTIATE;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_NEGOTIATE);
 
     event_loop = milter_agent_get_event_loop(MILTER_AGENT(priv->client_context));
     priv->children = milter_manager_children_new(priv->configuration,
@@ -1012,6 +1092,7 @@ milter_manager_leader_negotiate (MilterManagerLeader *leader,
     milter_manager_children_set_launcher_channel(priv->children,
                                                  priv->launcher_read_channel,
                                                  priv->launcher_write_channel);
+    milter_manager_children_set_metrics(priv->children, priv->metrics);
     milter_debug("[%u] [leader][setup][children]", priv->tag);
 
     if (milter_manager_children_negotiate(priv->children, option,
@@ -1032,7 +1113,7 @@ milter_manager_leader_connect (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_CONNECT;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_CONNECT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1054,7 +1135,7 @@ milter_manager_leader_helo (MilterManagerLeader *leader, const gchar *fqdn)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_HELO;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_HELO);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1076,7 +1157,7 @@ milter_manager_leader_envelope_from (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ENVELOPE_FROM;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_ENVELOPE_FROM);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1098,7 +1179,7 @@ milter_manager_leader_envelope_recipient (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ENVELOPE_RECIPIENT;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_ENVELOPE_RECIPIENT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1119,7 +1200,7 @@ milter_manager_leader_data (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_DATA;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_DATA);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1141,7 +1222,7 @@ milter_manager_leader_unknown (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_UNKNOWN;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_UNKNOWN);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1163,7 +1244,7 @@ milter_manager_leader_header (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_HEADER;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_HEADER);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1184,7 +1265,7 @@ milter_manager_leader_end_of_header (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_END_OF_HEADER;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_END_OF_HEADER);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1206,7 +1287,7 @@ milter_manager_leader_body (MilterManagerLeader *leader,
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_BODY;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_BODY);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1254,7 +1335,7 @@ milter_manager_leader_end_of_message (MilterManagerLeader *leader,
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
     if (is_replied_state(priv->state)) {
-        priv->state = MILTER_MANAGER_LEADER_STATE_END_OF_MESSAGE;
+        set_state(leader, MILTER_MANAGER_LEADER_STATE_END_OF_MESSAGE);
     } else {
         priv->sent_end_of_message = TRUE;
     }
@@ -1278,7 +1359,7 @@ milter_manager_leader_quit (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_QUIT;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_QUIT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1296,7 +1377,7 @@ milter_manager_leader_abort (MilterManagerLeader *leader)
     MilterStatus fallback_status;
 
     priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
-    priv->state = MILTER_MANAGER_LEADER_STATE_ABORT;
+    set_state(leader, MILTER_MANAGER_LEADER_STATE_ABORT);
 
     fallback_status =
         milter_manager_configuration_get_fallback_status(priv->configuration);
@@ -1363,6 +1444,29 @@ milter_manager_leader_set_launcher_channel (MilterManagerLeader *leader,
         g_io_channel_ref(priv->launcher_read_channel);
 }
 
+void
+milter_manager_leader_set_metrics (MilterManagerLeader  *leader,
+                                   MilterManagerMetrics *metrics)
+{
+    MilterManagerLeaderPrivate *priv;
+
+    priv = MILTER_MANAGER_LEADER_GET_PRIVATE(leader);
+
+    if (priv->metrics) {
+        milter_manager_metrics_transit_leader(priv->metrics,
+                                              priv->state,
+                                              MILTER_MANAGER_LEADER_STATE_INVALID);
+        g_object_unref(priv->metrics);
+    }
+    priv->metrics = metrics;
+    if (priv->metrics) {
+        g_object_ref(priv->metrics);
+        milter_manager_metrics_transit_leader(priv->metrics,
+                                              MILTER_MANAGER_LEADER_STATE_INVALID,
+                                              priv->state);
+    }
+}
+
 /**
  * milter_manager_leader_get_children:
  * @leader: A #MilterManagerLeader.
@@ -25,6 +25,7 @@
 #include <milter/client.h>
 #include <milter/server.h>
 #include <milter/manager/milter-manager-configuration.h>
+#include <milter/manager/milter-manager-metrics.h>
 
 G_BEGIN_DECLS
 
@@ -103,6 +104,9 @@ void                  milter_manager_leader_set_launcher_channel
                                           (MilterManagerLeader *leader,
                                            GIOChannel *read_channel,
                                            GIOChannel *write_channel);
+void                  milter_manager_leader_set_metrics
+                                          (MilterManagerLeader  *leader,
+                                           MilterManagerMetrics *metrics);
 
 gboolean              milter_manager_leader_check_connection
                                           (MilterManagerLeader *leader);
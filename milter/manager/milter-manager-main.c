@@ -439,8 +439,10 @@ start_process_launcher_process (MilterManager *manager)
                                                             &read_channel,
                                                             &write_channel);
         if (start_process_launcher(read_channel, write_channel, daemon)) {
+            milter_log_writer_flush_all();
             _exit(EXIT_SUCCESS);
         } else {
+            milter_log_writer_flush_all();
             _exit(EXIT_FAILURE);
         }
         break;
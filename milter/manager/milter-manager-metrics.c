@@ -0,0 +1,1397 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <milter/client.h>
+#include "milter-manager-metrics.h"
+#include "milter-manager-leader.h"
+#include "milter-manager-egg.h"
+#include "milter-manager-enum-types.h"
+
+#define MILTER_MANAGER_METRICS_GET_PRIVATE(obj)                 \
+    (G_TYPE_INSTANCE_GET_PRIVATE((obj),                         \
+                                 MILTER_TYPE_MANAGER_METRICS,   \
+                                 MilterManagerMetricsPrivate))
+
+#define CACHE_LINE_SIZE 64
+#define EGG_NAME_SIZE 64
+#define FIRST_STAGE MILTER_SERVER_CONTEXT_STATE_CONNECT
+#define LAST_STAGE MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE
+#define N_STAGES (LAST_STAGE - FIRST_STAGE + 1)
+#define FIRST_COMMAND_STATE MILTER_SERVER_CONTEXT_STATE_NEGOTIATE
+#define N_COMMAND_STATES (LAST_STAGE - FIRST_COMMAND_STATE + 1)
+#define N_LEADER_STATES (MILTER_MANAGER_LEADER_STATE_ABORT_REPLIED + 1)
+#define N_STATUSES (MILTER_STATUS_ERROR + 1)
+#define N_TIMEOUT_KINDS (MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE + 1)
+
+static const gdouble latency_bounds[] = {
+    0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+#define N_LATENCY_BOUNDS G_N_ELEMENTS(latency_bounds)
+
+static const gchar *timeout_kind_names[] = {
+    "connection",
+    "writing",
+    "reading",
+    "end-of-message"
+};
+
+typedef struct _Histogram Histogram;
+struct _Histogram
+{
+    guint64 buckets[N_LATENCY_BOUNDS + 1];
+    guint64 count;
+    guint64 sum_usec;
+};
+
+typedef struct _EggEntry EggEntry;
+struct _EggEntry
+{
+    gchar name[EGG_NAME_SIZE];
+    Histogram latencies[N_STAGES];
+    guint64 n_replies[N_STATUSES];
+    guint64 n_timeouts[N_TIMEOUT_KINDS];
+    gint64 n_open_children;
+    guint64 n_connect_failures;
+    guint64 n_negotiate_failures;
+    /* Commands that are waiting for a reply. The sum of
+     * their start times gives their average age. */
+    gint64 n_in_flight_commands[N_COMMAND_STATES];
+    gint64 in_flight_started_usec[N_COMMAND_STATES];
+    guint64 n_launches;
+    guint64 n_suppressed_launches;
+    gint64 n_alive_waiters;
+    gint circuit_breaker_state;
+    gdouble circuit_breaker_error_rate;
+    guint64 n_circuit_breaker_opens;
+    guint64 n_circuit_breaker_rejections;
+};
+
+/* Each process writes only to its own slot. Other processes
+ * only read it so no lock is needed. Slots are stored in the
+ * worker data of MilterClient so that they are shared with
+ * worker processes. */
+typedef struct _Slot Slot;
+struct _Slot
+{
+    gint n_eggs;
+    gint pid;
+    guint64 n_spooled_body_bytes;
+    gint64 n_buffered_body_bytes;
+    gint64 event_loop_lag_usec;
+    gint64 n_leaders[N_LEADER_STATES];
+    EggEntry eggs[MILTER_MANAGER_METRICS_MAX_EGGS];
+};
+
+#define SLOT_SIZE                                                       \
+    (((sizeof(Slot) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE)
+
+typedef struct _MilterManagerMetricsPrivate MilterManagerMetricsPrivate;
+struct _MilterManagerMetricsPrivate
+{
+    MilterClient *client;
+    guint n_slots;
+    guint slot;
+    gchar *segment;
+    gboolean egg_overflow_reported;
+    MilterEventLoop *event_loop;
+    guint lag_watch_id;
+    gint64 lag_interval_usec;
+    gint64 lag_expected_time;
+    GMutex mutex;
+};
+
+enum
+{
+    PROP_0,
+    PROP_N_SLOTS
+};
+
+G_DEFINE_TYPE(MilterManagerMetrics,
+              milter_manager_metrics,
+              G_TYPE_OBJECT)
+
+static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
+static void set_property   (GObject         *object,
+                            guint            prop_id,
+                            const GValue    *value,
+                            GParamSpec      *pspec);
+static void get_property   (GObject         *object,
+                            guint            prop_id,
+                            GValue          *value,
+                            GParamSpec      *pspec);
+
+static void
+milter_manager_metrics_class_init (MilterManagerMetricsClass *klass)
+{
+    GObjectClass *gobject_class;
+    GParamSpec *spec;
+
+    gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
+    gobject_class->set_property = set_property;
+    gobject_class->get_property = get_property;
+
+    spec = g_param_spec_uint("n-slots",
+                             "Number of slots",
+                             "The number of processes that share the metrics",
+                             1,
+                             MILTER_CLIENT_MAX_N_WORKERS + 1,
+                             1,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property(gobject_class, PROP_N_SLOTS, spec);
+
+    g_type_class_add_private(gobject_class,
+                             sizeof(MilterManagerMetricsPrivate));
+}
+
+static void
+milter_manager_metrics_init (MilterManagerMetrics *metrics)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    priv->client = NULL;
+    priv->n_slots = 0;
+    priv->slot = 0;
+    priv->segment = NULL;
+    priv->egg_overflow_reported = FALSE;
+    priv->event_loop = NULL;
+    priv->lag_watch_id = 0;
+    priv->lag_interval_usec = 0;
+    priv->lag_expected_time = 0;
+    g_mutex_init(&(priv->mutex));
+}
+
+static void
+dispose_lag_watch (MilterManagerMetricsPrivate *priv)
+{
+    if (priv->lag_watch_id > 0) {
+        milter_event_loop_remove(priv->event_loop, priv->lag_watch_id);
+        priv->lag_watch_id = 0;
+    }
+
+    if (priv->event_loop) {
+        g_object_unref(priv->event_loop);
+        priv->event_loop = NULL;
+    }
+}
+
+static void
+dispose_segment (MilterManagerMetricsPrivate *priv)
+{
+    if (!priv->segment)
+        return;
+
+    g_free(priv->segment);
+    priv->segment = NULL;
+    priv->n_slots = 0;
+}
+
+static void cb_client_finalized (gpointer data, GObject *where_the_object_was);
+
+static void
+dispose_client (MilterManagerMetrics *metrics)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    if (!priv->client)
+        return;
+
+    g_object_weak_unref(G_OBJECT(priv->client), cb_client_finalized, metrics);
+    priv->client = NULL;
+}
+
+static void
+dispose (GObject *object)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(object);
+
+    dispose_lag_watch(priv);
+    dispose_client(MILTER_MANAGER_METRICS(object));
+    dispose_segment(priv);
+
+    G_OBJECT_CLASS(milter_manager_metrics_parent_class)->dispose(object);
+}
+
+static void
+finalize (GObject *object)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(object);
+    g_mutex_clear(&(priv->mutex));
+
+    G_OBJECT_CLASS(milter_manager_metrics_parent_class)->finalize(object);
+}
+
+static guint
+get_n_slots (MilterManagerMetricsPrivate *priv)
+{
+    if (priv->client)
+        return milter_client_get_n_workers(priv->client) + 1;
+    return priv->n_slots;
+}
+
+static Slot *
+get_slot (MilterManagerMetricsPrivate *priv, guint slot)
+{
+    if (priv->client)
+        return milter_client_get_worker_data(priv->client, slot);
+    return (Slot *)(priv->segment + SLOT_SIZE * slot);
+}
+
+static void
+allocate_segment (MilterManagerMetricsPrivate *priv, guint n_slots)
+{
+    dispose_segment(priv);
+
+    priv->n_slots = n_slots;
+    priv->segment = g_malloc0(SLOT_SIZE * n_slots);
+    priv->slot = 0;
+    get_slot(priv, priv->slot)->pid = getpid();
+}
+
+static void
+cb_client_finalized (gpointer data, GObject *where_the_object_was)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(data);
+    priv->client = NULL;
+    allocate_segment(priv, priv->n_slots);
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(object);
+    switch (prop_id) {
+    case PROP_N_SLOTS:
+        allocate_segment(priv, g_value_get_uint(value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+get_property (GObject    *object,
+              guint       prop_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(object);
+    switch (prop_id) {
+    case PROP_N_SLOTS:
+        g_value_set_uint(value, get_n_slots(priv));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+MilterManagerMetrics *
+milter_manager_metrics_new (guint n_slots)
+{
+    return g_object_new(MILTER_TYPE_MANAGER_METRICS,
+                        "n-slots", n_slots,
+                        NULL);
+}
+
+MilterManagerMetrics *
+milter_manager_metrics_new_with_client (MilterClient *client)
+{
+    MilterManagerMetrics *metrics;
+    MilterManagerMetricsPrivate *priv;
+    guint n_slots;
+
+    n_slots = milter_client_get_n_workers(client) + 1;
+    metrics = milter_manager_metrics_new(n_slots);
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    milter_client_set_worker_data_size(client, SLOT_SIZE);
+    if (milter_client_get_worker_data_size(client) != SLOT_SIZE)
+        return metrics;
+
+    dispose_segment(priv);
+    priv->n_slots = n_slots;
+    priv->client = client;
+    g_object_weak_ref(G_OBJECT(client), cb_client_finalized, metrics);
+    get_slot(priv, priv->slot)->pid = getpid();
+
+    return metrics;
+}
+
+guint
+milter_manager_metrics_get_n_slots (MilterManagerMetrics *metrics)
+{
+    return get_n_slots(MILTER_MANAGER_METRICS_GET_PRIVATE(metrics));
+}
+
+guint
+milter_manager_metrics_get_slot (MilterManagerMetrics *metrics)
+{
+    return MILTER_MANAGER_METRICS_GET_PRIVATE(metrics)->slot;
+}
+
+/* A respawned worker reuses the slot of the dead worker. Its
+ * gauges are cleared but its counters are kept because they
+ * must never decrease. */
+static void
+clear_slot_gauges (Slot *slot)
+{
+    gint i, n_eggs;
+
+    slot->event_loop_lag_usec = 0;
+    slot->n_buffered_body_bytes = 0;
+    memset(slot->n_leaders, 0, sizeof(slot->n_leaders));
+    n_eggs = g_atomic_int_get(&(slot->n_eggs));
+    for (i = 0; i < n_eggs; i++) {
+        EggEntry *entry = &(slot->eggs[i]);
+
+        entry->n_open_children = 0;
+        entry->n_alive_waiters = 0;
+        entry->circuit_breaker_state =
+            MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED;
+        entry->circuit_breaker_error_rate = 0.0;
+        memset(entry->n_in_flight_commands, 0,
+               sizeof(entry->n_in_flight_commands));
+        memset(entry->in_flight_started_usec, 0,
+               sizeof(entry->in_flight_started_usec));
+    }
+}
+
+void
+milter_manager_metrics_set_slot (MilterManagerMetrics *metrics,
+                                 guint                 slot)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    if (slot >= get_n_slots(priv)) {
+        milter_error("[metrics][error][slot] out of range: <%u>: <%u>",
+                     slot, get_n_slots(priv));
+        return;
+    }
+
+    g_mutex_lock(&(priv->mutex));
+    priv->slot = slot;
+    get_slot(priv, priv->slot)->pid = getpid();
+    clear_slot_gauges(get_slot(priv, priv->slot));
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_clear_slot (MilterManagerMetrics *metrics,
+                                   guint                 slot)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    if (slot >= get_n_slots(priv))
+        return;
+
+    g_mutex_lock(&(priv->mutex));
+    clear_slot_gauges(get_slot(priv, slot));
+    g_mutex_unlock(&(priv->mutex));
+}
+
+static EggEntry *
+find_egg_entry (Slot *slot, const gchar *egg_name)
+{
+    gint i, n_eggs;
+
+    n_eggs = g_atomic_int_get(&(slot->n_eggs));
+    for (i = 0; i < n_eggs; i++) {
+        if (strncmp(slot->eggs[i].name, egg_name, EGG_NAME_SIZE - 1) == 0)
+            return &(slot->eggs[i]);
+    }
+
+    return NULL;
+}
+
+static EggEntry *
+ensure_egg_entry (MilterManagerMetricsPrivate *priv, const gchar *egg_name)
+{
+    Slot *slot;
+    EggEntry *entry;
+    gint n_eggs;
+
+    if (!egg_name)
+        return NULL;
+
+    slot = get_slot(priv, priv->slot);
+    entry = find_egg_entry(slot, egg_name);
+    if (entry)
+        return entry;
+
+    n_eggs = g_atomic_int_get(&(slot->n_eggs));
+    if (n_eggs >= MILTER_MANAGER_METRICS_MAX_EGGS) {
+        if (!priv->egg_overflow_reported) {
+            milter_error("[metrics][error][egg] too many milters: <%s>: <%d>",
+                         egg_name, MILTER_MANAGER_METRICS_MAX_EGGS);
+            priv->egg_overflow_reported = TRUE;
+        }
+        return NULL;
+    }
+
+    entry = &(slot->eggs[n_eggs]);
+    g_strlcpy(entry->name, egg_name, EGG_NAME_SIZE);
+    /* Publish the name before readers can see the entry. */
+    g_atomic_int_set(&(slot->n_eggs), n_eggs + 1);
+
+    return entry;
+}
+
+static void
+observe_histogram (Histogram *histogram, gdouble elapsed)
+{
+    guint i;
+
+    if (elapsed < 0)
+        elapsed = 0;
+
+    for (i = 0; i < N_LATENCY_BOUNDS; i++) {
+        if (elapsed <= latency_bounds[i])
+            break;
+    }
+    histogram->buckets[i]++;
+    histogram->count++;
+    histogram->sum_usec += (guint64)(elapsed * G_USEC_PER_SEC + 0.5);
+}
+
+void
+milter_manager_metrics_observe_reply (MilterManagerMetrics *metrics,
+                                      const gchar          *egg_name,
+                                      MilterServerContextState state,
+                                      MilterStatus          status,
+                                      gdouble               elapsed)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    /* Event loop threads share a slot. */
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry) {
+        if (FIRST_STAGE <= state && state <= LAST_STAGE)
+            observe_histogram(&(entry->latencies[state - FIRST_STAGE]),
+                              elapsed);
+        if ((guint)status < N_STATUSES)
+            entry->n_replies[status]++;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_count_timeout (MilterManagerMetrics *metrics,
+                                      const gchar          *egg_name,
+                                      MilterManagerMetricsTimeoutKind kind)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry && (guint)kind < N_TIMEOUT_KINDS)
+        entry->n_timeouts[kind]++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_open_child (MilterManagerMetrics *metrics,
+                                   const gchar          *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry)
+        entry->n_open_children++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_close_child (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry && entry->n_open_children > 0)
+        entry->n_open_children--;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_add_spooled_body_bytes (MilterManagerMetrics *metrics,
+                                               guint64               n_bytes)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    get_slot(priv, priv->slot)->n_spooled_body_bytes += n_bytes;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_add_buffered_body_bytes (MilterManagerMetrics *metrics,
+                                                gint64                n_bytes)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    get_slot(priv, priv->slot)->n_buffered_body_bytes += n_bytes;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_count_connect_failure (MilterManagerMetrics *metrics,
+                                              const gchar          *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry)
+        entry->n_connect_failures++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_count_negotiate_failure (MilterManagerMetrics *metrics,
+                                                const gchar          *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry)
+        entry->n_negotiate_failures++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+static gboolean
+is_command_state (MilterServerContextState state)
+{
+    return FIRST_COMMAND_STATE <= state && state <= LAST_STAGE;
+}
+
+void
+milter_manager_metrics_start_command (MilterManagerMetrics *metrics,
+                                      const gchar          *egg_name,
+                                      MilterServerContextState state,
+                                      gint64                started_time)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    if (!is_command_state(state))
+        return;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry) {
+        entry->n_in_flight_commands[state - FIRST_COMMAND_STATE]++;
+        entry->in_flight_started_usec[state - FIRST_COMMAND_STATE] +=
+            started_time;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_finish_command (MilterManagerMetrics *metrics,
+                                       const gchar          *egg_name,
+                                       MilterServerContextState state,
+                                       gint64                started_time)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    if (!is_command_state(state))
+        return;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry && entry->n_in_flight_commands[state - FIRST_COMMAND_STATE] > 0) {
+        entry->n_in_flight_commands[state - FIRST_COMMAND_STATE]--;
+        entry->in_flight_started_usec[state - FIRST_COMMAND_STATE] -=
+            started_time;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_transit_leader (MilterManagerMetrics *metrics,
+                                       gint                  previous_state,
+                                       gint                  state)
+{
+    MilterManagerMetricsPrivate *priv;
+    Slot *slot;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    slot = get_slot(priv, priv->slot);
+    if (0 < previous_state && previous_state < N_LEADER_STATES &&
+        slot->n_leaders[previous_state] > 0)
+        slot->n_leaders[previous_state]--;
+    if (0 < state && state < N_LEADER_STATES)
+        slot->n_leaders[state]++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_count_launch (MilterManagerMetrics *metrics,
+                                     const gchar          *egg_name,
+                                     gboolean              suppressed)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry) {
+        if (suppressed)
+            entry->n_suppressed_launches++;
+        else
+            entry->n_launches++;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_add_alive_waiters (MilterManagerMetrics *metrics,
+                                          const gchar          *egg_name,
+                                          gint                  n_waiters)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry) {
+        entry->n_alive_waiters += n_waiters;
+        if (entry->n_alive_waiters < 0)
+            entry->n_alive_waiters = 0;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+/* An open is counted when the state becomes open so that a
+ * half-open trial that fails is counted too. */
+void
+milter_manager_metrics_set_circuit_breaker (MilterManagerMetrics *metrics,
+                                            const gchar          *egg_name,
+                                            gint                  state,
+                                            gdouble               error_rate)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry) {
+        if (state == MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN &&
+            entry->circuit_breaker_state != state)
+            entry->n_circuit_breaker_opens++;
+        entry->circuit_breaker_state = state;
+        entry->circuit_breaker_error_rate = error_rate;
+    }
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_count_circuit_breaker_rejection
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *entry;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    g_mutex_lock(&(priv->mutex));
+    entry = ensure_egg_entry(priv, egg_name);
+    if (entry)
+        entry->n_circuit_breaker_rejections++;
+    g_mutex_unlock(&(priv->mutex));
+}
+
+void
+milter_manager_metrics_set_event_loop_lag (MilterManagerMetrics *metrics,
+                                           gdouble               lag)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+    get_slot(priv, priv->slot)->event_loop_lag_usec =
+        (gint64)(lag * G_USEC_PER_SEC + 0.5);
+}
+
+static gboolean
+cb_check_event_loop_lag (gpointer user_data)
+{
+    MilterManagerMetrics *metrics = user_data;
+    MilterManagerMetricsPrivate *priv;
+    gint64 now, lag;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    now = g_get_monotonic_time();
+    lag = now - priv->lag_expected_time;
+    if (lag < 0)
+        lag = 0;
+    get_slot(priv, priv->slot)->event_loop_lag_usec = lag;
+    priv->lag_expected_time = now + priv->lag_interval_usec;
+
+    return TRUE;
+}
+
+void
+milter_manager_metrics_watch_event_loop (MilterManagerMetrics *metrics,
+                                         MilterEventLoop      *loop,
+                                         gdouble               interval)
+{
+    MilterManagerMetricsPrivate *priv;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    dispose_lag_watch(priv);
+    if (!loop)
+        return;
+
+    priv->event_loop = g_object_ref(loop);
+    priv->lag_interval_usec = (gint64)(interval * G_USEC_PER_SEC);
+    priv->lag_expected_time = g_get_monotonic_time() + priv->lag_interval_usec;
+    priv->lag_watch_id = milter_event_loop_add_timeout(loop,
+                                                       interval,
+                                                       cb_check_event_loop_lag,
+                                                       metrics);
+}
+
+static gint
+get_circuit_breaker_severity (gint state)
+{
+    switch (state) {
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN:
+        return 2;
+    case MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void
+merge_egg_entry (EggEntry *total, EggEntry *entry)
+{
+    guint i, j;
+
+    for (i = 0; i < N_STAGES; i++) {
+        Histogram *total_histogram = &(total->latencies[i]);
+        Histogram *histogram = &(entry->latencies[i]);
+
+        for (j = 0; j < N_LATENCY_BOUNDS + 1; j++) {
+            total_histogram->buckets[j] += histogram->buckets[j];
+        }
+        total_histogram->count += histogram->count;
+        total_histogram->sum_usec += histogram->sum_usec;
+    }
+    for (i = 0; i < N_STATUSES; i++) {
+        total->n_replies[i] += entry->n_replies[i];
+    }
+    for (i = 0; i < N_TIMEOUT_KINDS; i++) {
+        total->n_timeouts[i] += entry->n_timeouts[i];
+    }
+    total->n_open_children += entry->n_open_children;
+    total->n_connect_failures += entry->n_connect_failures;
+    total->n_negotiate_failures += entry->n_negotiate_failures;
+    for (i = 0; i < N_COMMAND_STATES; i++) {
+        total->n_in_flight_commands[i] += entry->n_in_flight_commands[i];
+        total->in_flight_started_usec[i] += entry->in_flight_started_usec[i];
+    }
+    total->n_launches += entry->n_launches;
+    total->n_suppressed_launches += entry->n_suppressed_launches;
+    total->n_alive_waiters += entry->n_alive_waiters;
+    /* The state of the worst worker and the highest error
+     * rate are reported. */
+    if (get_circuit_breaker_severity(entry->circuit_breaker_state) >
+        get_circuit_breaker_severity(total->circuit_breaker_state))
+        total->circuit_breaker_state = entry->circuit_breaker_state;
+    total->circuit_breaker_error_rate =
+        MAX(total->circuit_breaker_error_rate,
+            entry->circuit_breaker_error_rate);
+    total->n_circuit_breaker_opens += entry->n_circuit_breaker_opens;
+    total->n_circuit_breaker_rejections +=
+        entry->n_circuit_breaker_rejections;
+}
+
+static void
+append_label (GString *output, const gchar *name, const gchar *value)
+{
+    const gchar *character;
+
+    g_string_append_printf(output, "%s=\"", name);
+    for (character = value; *character; character++) {
+        switch (*character) {
+        case '\\':
+            g_string_append(output, "\\\\");
+            break;
+        case '"':
+            g_string_append(output, "\\\"");
+            break;
+        case '\n':
+            g_string_append(output, "\\n");
+            break;
+        default:
+            g_string_append_c(output, *character);
+            break;
+        }
+    }
+    g_string_append_c(output, '"');
+}
+
+static void
+append_double (GString *output, const gchar *format, gdouble value)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_string_append(output,
+                    g_ascii_formatd(buffer, sizeof(buffer), format, value));
+}
+
+static void
+append_header (GString *output,
+               const gchar *name, const gchar *type, const gchar *help)
+{
+    g_string_append_printf(output, "# HELP %s %s\n", name, help);
+    g_string_append_printf(output, "# TYPE %s %s\n", name, type);
+}
+
+static void
+append_latencies (GString *output, GList *entries)
+{
+    const gchar *name = "milter_manager_child_reply_duration_seconds";
+    GList *node;
+
+    append_header(output, name, "histogram",
+                  "Time until a child milter replies to a command.");
+    for (node = entries; node; node = g_list_next(node)) {
+        EggEntry *entry = node->data;
+        guint i, j;
+
+        for (i = 0; i < N_STAGES; i++) {
+            Histogram *histogram = &(entry->latencies[i]);
+            gchar *stage;
+            guint64 n_observed = 0;
+
+            if (histogram->count == 0)
+                continue;
+
+            stage = milter_utils_get_enum_nick_name(
+                MILTER_TYPE_SERVER_CONTEXT_STATE, FIRST_STAGE + i);
+            for (j = 0; j < N_LATENCY_BOUNDS + 1; j++) {
+                n_observed += histogram->buckets[j];
+                g_string_append_printf(output, "%s_bucket{", name);
+                append_label(output, "milter", entry->name);
+                g_string_append_c(output, ',');
+                append_label(output, "stage", stage);
+                g_string_append(output, ",le=\"");
+                if (j < N_LATENCY_BOUNDS)
+                    append_double(output, "%g", latency_bounds[j]);
+                else
+                    g_string_append(output, "+Inf");
+                g_string_append_printf(output,
+                                       "\"} %" G_GUINT64_FORMAT "\n",
+                                       n_observed);
+            }
+
+            g_string_append_printf(output, "%s_sum{", name);
+            append_label(output, "milter", entry->name);
+            g_string_append_c(output, ',');
+            append_label(output, "stage", stage);
+            g_string_append(output, "} ");
+            append_double(output, "%.6f",
+                          (gdouble)histogram->sum_usec / G_USEC_PER_SEC);
+            g_string_append_c(output, '\n');
+
+            g_string_append_printf(output, "%s_count{", name);
+            append_label(output, "milter", entry->name);
+            g_string_append_c(output, ',');
+            append_label(output, "stage", stage);
+            g_string_append_printf(output, "} %" G_GUINT64_FORMAT "\n",
+                                   histogram->count);
+            g_free(stage);
+        }
+    }
+}
+
+static void
+append_replies (GString *output, GList *entries)
+{
+    const gchar *name = "milter_manager_child_replies_total";
+    GList *node;
+
+    append_header(output, name, "counter",
+                  "The number of replies from child milters by status.");
+    for (node = entries; node; node = g_list_next(node)) {
+        EggEntry *entry = node->data;
+        guint i;
+
+        for (i = 0; i < N_STATUSES; i++) {
+            gchar *status;
+
+            if (entry->n_replies[i] == 0)
+                continue;
+
+            status = milter_utils_get_enum_nick_name(MILTER_TYPE_STATUS, i);
+            g_string_append_printf(output, "%s{", name);
+            append_label(output, "milter", entry->name);
+            g_string_append_c(output, ',');
+            append_label(output, "status", status);
+            g_string_append_printf(output, "} %" G_GUINT64_FORMAT "\n",
+                                   entry->n_replies[i]);
+            g_free(status);
+        }
+    }
+}
+
+static void
+append_timeouts (GString *output, GList *entries)
+{
+    const gchar *name = "milter_manager_child_timeouts_total";
+    GList *node;
+
+    append_header(output, name, "counter",
+                  "The number of timeouts of child milters by kind.");
+    for (node = entries; node; node = g_list_next(node)) {
+        EggEntry *entry = node->data;
+        guint i;
+
+        for (i = 0; i < N_TIMEOUT_KINDS; i++) {
+            g_string_append_printf(output, "%s{", name);
+            append_label(output, "milter", entry->name);
+            g_string_append_c(output, ',');
+            append_label(output, "kind", timeout_kind_names[i]);
+            g_string_append_printf(output, "} %" G_GUINT64_FORMAT "\n",
+                                   entry->n_timeouts[i]);
+        }
+    }
+}
+
+static void
+append_connections (GString *output, GList *entries)
+{
+    const gchar *name = "milter_manager_child_connections";
+    GList *node;
+
+    append_header(output, name, "gauge",
+                  "The number of open connections to child milters.");
+    for (node = entries; node; node = g_list_next(node)) {
+        EggEntry *entry = node->data;
+
+        g_string_append_printf(output, "%s{", name);
+        append_label(output, "milter", entry->name);
+        g_string_append_printf(output, "} %" G_GINT64_FORMAT "\n",
+                               entry->n_open_children);
+    }
+}
+
+static gint
+compare_egg_entry (gconstpointer a, gconstpointer b)
+{
+    const EggEntry *entry1 = a;
+    const EggEntry *entry2 = b;
+
+    return strcmp(entry1->name, entry2->name);
+}
+
+gchar *
+milter_manager_metrics_to_open_metrics (MilterManagerMetrics *metrics)
+{
+    MilterManagerMetricsPrivate *priv;
+    GHashTable *totals;
+    GList *entries;
+    GString *output;
+    guint64 n_spooled_body_bytes = 0;
+    guint i;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    totals = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    for (i = 0; i < get_n_slots(priv); i++) {
+        Slot *slot;
+        gint j, n_eggs;
+
+        slot = get_slot(priv, i);
+        n_spooled_body_bytes += slot->n_spooled_body_bytes;
+        n_eggs = g_atomic_int_get(&(slot->n_eggs));
+        for (j = 0; j < n_eggs; j++) {
+            EggEntry *entry = &(slot->eggs[j]);
+            EggEntry *total;
+
+            total = g_hash_table_lookup(totals, entry->name);
+            if (!total) {
+                total = g_new0(EggEntry, 1);
+                g_strlcpy(total->name, entry->name, EGG_NAME_SIZE);
+                g_hash_table_insert(totals, total->name, total);
+            }
+            merge_egg_entry(total, entry);
+        }
+    }
+    entries = g_list_sort(g_hash_table_get_values(totals), compare_egg_entry);
+
+    output = g_string_new(NULL);
+    append_latencies(output, entries);
+    append_replies(output, entries);
+    append_timeouts(output, entries);
+    append_connections(output, entries);
+
+    append_header(output, "milter_manager_body_spooled_bytes_total", "counter",
+                  "The number of body bytes spooled to files.");
+    g_string_append_printf(output,
+                           "milter_manager_body_spooled_bytes_total "
+                           "%" G_GUINT64_FORMAT "\n",
+                           n_spooled_body_bytes);
+
+    append_header(output, "milter_manager_event_loop_lag_seconds", "gauge",
+                  "The last delay of the event loop iteration.");
+    for (i = 0; i < get_n_slots(priv); i++) {
+        Slot *slot;
+
+        slot = get_slot(priv, i);
+        if (slot->pid == 0)
+            continue;
+        g_string_append_printf(output,
+                               "milter_manager_event_loop_lag_seconds"
+                               "{worker=\"%u\"} ",
+                               i);
+        append_double(output, "%.6f",
+                      (gdouble)slot->event_loop_lag_usec / G_USEC_PER_SEC);
+        g_string_append_c(output, '\n');
+    }
+
+    g_list_free(entries);
+    g_hash_table_unref(totals);
+
+    return g_string_free(output, FALSE);
+}
+
+static void
+append_uint64_element (GString *string, const gchar *name, guint64 value,
+                       guint indent)
+{
+    gchar *content;
+
+    content = g_strdup_printf("%" G_GUINT64_FORMAT, value);
+    milter_utils_xml_append_text_element(string, name, content, indent);
+    g_free(content);
+}
+
+static void
+append_double_element (GString *string, const gchar *name, gdouble value,
+                       guint indent)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    milter_utils_xml_append_text_element(
+        string, name,
+        g_ascii_formatd(buffer, sizeof(buffer), "%.6f", value),
+        indent);
+}
+
+/**
+ * milter_manager_metrics_to_xml_string:
+ * @metrics: A #MilterManagerMetrics.
+ * @string: The output string.
+ * @indent: The indent of the output.
+ *
+ * Appends the live leaders by state and the body bytes of
+ * all processes to @string as XML. It only reads counters
+ * so it is cheap enough to be called frequently.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_manager_metrics_to_xml_string (MilterManagerMetrics *metrics,
+                                      GString              *string,
+                                      guint                 indent)
+{
+    MilterManagerMetricsPrivate *priv;
+    gint64 n_leaders[N_LEADER_STATES];
+    gint64 n_buffered_body_bytes = 0;
+    guint64 n_spooled_body_bytes = 0;
+    guint i, j;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    memset(n_leaders, 0, sizeof(n_leaders));
+    for (i = 0; i < get_n_slots(priv); i++) {
+        Slot *slot;
+
+        slot = get_slot(priv, i);
+        for (j = 0; j < N_LEADER_STATES; j++) {
+            n_leaders[j] += slot->n_leaders[j];
+        }
+        n_buffered_body_bytes += slot->n_buffered_body_bytes;
+        n_spooled_body_bytes += slot->n_spooled_body_bytes;
+    }
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<leaders>\n");
+    for (j = 0; j < N_LEADER_STATES; j++) {
+        gchar *state;
+
+        if (n_leaders[j] <= 0)
+            continue;
+
+        state = milter_utils_get_enum_nick_name(
+            MILTER_TYPE_MANAGER_LEADER_STATE, j);
+        milter_utils_append_indent(string, indent + 2);
+        g_string_append(string, "<state>\n");
+        milter_utils_xml_append_text_element(string, "name", state,
+                                             indent + 4);
+        append_uint64_element(string, "count", n_leaders[j], indent + 4);
+        milter_utils_append_indent(string, indent + 2);
+        g_string_append(string, "</state>\n");
+        g_free(state);
+    }
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</leaders>\n");
+
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<body>\n");
+    append_uint64_element(string, "buffered",
+                          MAX(n_buffered_body_bytes, 0), indent + 2);
+    append_uint64_element(string, "spooled", n_spooled_body_bytes, indent + 2);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</body>\n");
+}
+
+static EggEntry *
+collect_egg_entry (MilterManagerMetrics *metrics, const gchar *egg_name)
+{
+    MilterManagerMetricsPrivate *priv;
+    EggEntry *total;
+    guint i;
+
+    priv = MILTER_MANAGER_METRICS_GET_PRIVATE(metrics);
+
+    total = g_new0(EggEntry, 1);
+    for (i = 0; i < get_n_slots(priv); i++) {
+        EggEntry *entry;
+
+        entry = find_egg_entry(get_slot(priv, i), egg_name);
+        if (entry)
+            merge_egg_entry(total, entry);
+    }
+
+    return total;
+}
+
+/**
+ * milter_manager_metrics_egg_to_xml_string:
+ * @metrics: A #MilterManagerMetrics.
+ * @egg_name: The name of a child milter.
+ * @string: The output string.
+ * @indent: The indent of the output.
+ *
+ * Appends the open connections, the connect and negotiate
+ * failures and the commands waiting for a reply of
+ * @egg_name in all processes to @string as XML.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_manager_metrics_egg_to_xml_string (MilterManagerMetrics *metrics,
+                                          const gchar          *egg_name,
+                                          GString              *string,
+                                          guint                 indent)
+{
+    EggEntry *total;
+    gint64 now;
+    guint i;
+
+    total = collect_egg_entry(metrics, egg_name);
+    append_uint64_element(string, "connections",
+                          MAX(total->n_open_children, 0), indent);
+    append_uint64_element(string, "connect-failures",
+                          total->n_connect_failures, indent);
+    append_uint64_element(string, "negotiate-failures",
+                          total->n_negotiate_failures, indent);
+
+    now = g_get_monotonic_time();
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<in-flight>\n");
+    for (i = 0; i < N_COMMAND_STATES; i++) {
+        gint64 n_commands = total->n_in_flight_commands[i];
+        gchar *command;
+        gdouble age;
+
+        if (n_commands <= 0)
+            continue;
+
+        age = (gdouble)(now * n_commands - total->in_flight_started_usec[i]) /
+            n_commands / G_USEC_PER_SEC;
+        command = milter_utils_get_enum_nick_name(
+            MILTER_TYPE_SERVER_CONTEXT_STATE, FIRST_COMMAND_STATE + i);
+        milter_utils_append_indent(string, indent + 2);
+        g_string_append(string, "<command>\n");
+        milter_utils_xml_append_text_element(string, "name", command,
+                                             indent + 4);
+        append_uint64_element(string, "count", n_commands, indent + 4);
+        append_double_element(string, "average-age", MAX(age, 0), indent + 4);
+        milter_utils_append_indent(string, indent + 2);
+        g_string_append(string, "</command>\n");
+        g_free(command);
+    }
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</in-flight>\n");
+
+    g_free(total);
+}
+
+/**
+ * milter_manager_metrics_egg_launch_to_xml_string:
+ * @metrics: A #MilterManagerMetrics.
+ * @egg_name: The name of a child milter.
+ * @string: The output string.
+ * @indent: The indent of the output.
+ *
+ * Appends the launches, the suppressed launches and the
+ * sessions waiting for @egg_name in all processes to
+ * @string as XML. Nothing is appended if @egg_name has
+ * never been launched.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_manager_metrics_egg_launch_to_xml_string (MilterManagerMetrics *metrics,
+                                                 const gchar          *egg_name,
+                                                 GString              *string,
+                                                 guint                 indent)
+{
+    EggEntry *total;
+
+    total = collect_egg_entry(metrics, egg_name);
+    if (total->n_launches > 0) {
+        milter_utils_append_indent(string, indent);
+        g_string_append(string, "<launch>\n");
+        append_uint64_element(string, "launched",
+                              total->n_launches, indent + 2);
+        append_uint64_element(string, "suppressed",
+                              total->n_suppressed_launches, indent + 2);
+        append_uint64_element(string, "waiting",
+                              MAX(total->n_alive_waiters, 0), indent + 2);
+        milter_utils_append_indent(string, indent);
+        g_string_append(string, "</launch>\n");
+    }
+    g_free(total);
+}
+
+/**
+ * milter_manager_metrics_egg_circuit_breaker_to_xml_string:
+ * @metrics: A #MilterManagerMetrics.
+ * @egg_name: The name of a child milter.
+ * @string: The output string.
+ * @indent: The indent of the output.
+ *
+ * Appends the circuit breaker of @egg_name in all processes
+ * to @string as XML. Each process has its own circuit
+ * breaker. The most open state and the highest error rate
+ * of them are appended with the total counts.
+ *
+ * Since: 2.2.9
+ */
+void
+milter_manager_metrics_egg_circuit_breaker_to_xml_string
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    GString              *string,
+                                    guint                 indent)
+{
+    EggEntry *total;
+    gchar *state_name;
+    gchar *error_rate;
+
+    total = collect_egg_entry(metrics, egg_name);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "<circuit-breaker>\n");
+    state_name = milter_utils_get_enum_nick_name(
+        MILTER_TYPE_MANAGER_CIRCUIT_BREAKER_STATE,
+        total->circuit_breaker_state);
+    milter_utils_xml_append_text_element(string, "state", state_name,
+                                         indent + 2);
+    g_free(state_name);
+    error_rate = g_strdup_printf("%g", total->circuit_breaker_error_rate);
+    milter_utils_xml_append_text_element(string, "error-rate", error_rate,
+                                         indent + 2);
+    g_free(error_rate);
+    append_uint64_element(string, "opened",
+                          total->n_circuit_breaker_opens, indent + 2);
+    append_uint64_element(string, "rejected",
+                          total->n_circuit_breaker_rejections, indent + 2);
+    milter_utils_append_indent(string, indent);
+    g_string_append(string, "</circuit-breaker>\n");
+    g_free(total);
+}
+
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,175 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MILTER_MANAGER_METRICS_H__
+#define __MILTER_MANAGER_METRICS_H__
+
+#include <glib-object.h>
+
+#include <milter/core.h>
+#include <milter/server.h>
+#include <milter/client.h>
+
+G_BEGIN_DECLS
+
+#define MILTER_MANAGER_METRICS_MAX_EGGS 32
+#define MILTER_MANAGER_METRICS_DEFAULT_LAG_CHECK_INTERVAL 1.0
+
+#define MILTER_TYPE_MANAGER_METRICS            (milter_manager_metrics_get_type())
+#define MILTER_MANAGER_METRICS(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj), MILTER_TYPE_MANAGER_METRICS, MilterManagerMetrics))
+#define MILTER_MANAGER_METRICS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), MILTER_TYPE_MANAGER_METRICS, MilterManagerMetricsClass))
+#define MILTER_MANAGER_IS_METRICS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj), MILTER_TYPE_MANAGER_METRICS))
+#define MILTER_MANAGER_IS_METRICS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), MILTER_TYPE_MANAGER_METRICS))
+#define MILTER_MANAGER_METRICS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), MILTER_TYPE_MANAGER_METRICS, MilterManagerMetricsClass))
+
+typedef enum
+{
+    MILTER_MANAGER_METRICS_TIMEOUT_CONNECTION,
+    MILTER_MANAGER_METRICS_TIMEOUT_WRITING,
+    MILTER_MANAGER_METRICS_TIMEOUT_READING,
+    MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE
+} MilterManagerMetricsTimeoutKind;
+
+typedef struct _MilterManagerMetrics         MilterManagerMetrics;
+typedef struct _MilterManagerMetricsClass    MilterManagerMetricsClass;
+
+struct _MilterManagerMetrics
+{
+    GObject object;
+};
+
+struct _MilterManagerMetricsClass
+{
+    GObjectClass parent_class;
+};
+
+GType        milter_manager_metrics_get_type (void) G_GNUC_CONST;
+
+MilterManagerMetrics *milter_manager_metrics_new
+                                   (guint n_slots);
+MilterManagerMetrics *milter_manager_metrics_new_with_client
+                                   (MilterClient *client);
+
+guint        milter_manager_metrics_get_n_slots
+                                   (MilterManagerMetrics *metrics);
+guint        milter_manager_metrics_get_slot
+                                   (MilterManagerMetrics *metrics);
+void         milter_manager_metrics_set_slot
+                                   (MilterManagerMetrics *metrics,
+                                    guint                 slot);
+void         milter_manager_metrics_clear_slot
+                                   (MilterManagerMetrics *metrics,
+                                    guint                 slot);
+
+void         milter_manager_metrics_observe_reply
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    MilterServerContextState state,
+                                    MilterStatus          status,
+                                    gdouble               elapsed);
+void         milter_manager_metrics_count_timeout
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    MilterManagerMetricsTimeoutKind kind);
+void         milter_manager_metrics_open_child
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name);
+void         milter_manager_metrics_close_child
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name);
+void         milter_manager_metrics_add_spooled_body_bytes
+                                   (MilterManagerMetrics *metrics,
+                                    guint64               n_bytes);
+void         milter_manager_metrics_add_buffered_body_bytes
+                                   (MilterManagerMetrics *metrics,
+                                    gint64                n_bytes);
+void         milter_manager_metrics_count_connect_failure
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name);
+void         milter_manager_metrics_count_negotiate_failure
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name);
+void         milter_manager_metrics_start_command
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    MilterServerContextState state,
+                                    gint64                started_time);
+void         milter_manager_metrics_finish_command
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    MilterServerContextState state,
+                                    gint64                started_time);
+void         milter_manager_metrics_transit_leader
+                                   (MilterManagerMetrics *metrics,
+                                    gint                  previous_state,
+                                    gint                  state);
+void         milter_manager_metrics_count_launch
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    gboolean              suppressed);
+void         milter_manager_metrics_add_alive_waiters
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    gint                  n_waiters);
+void         milter_manager_metrics_set_circuit_breaker
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    gint                  state,
+                                    gdouble               error_rate);
+void         milter_manager_metrics_count_circuit_breaker_rejection
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name);
+void         milter_manager_metrics_set_event_loop_lag
+                                   (MilterManagerMetrics *metrics,
+                                    gdouble               lag);
+
+void         milter_manager_metrics_watch_event_loop
+                                   (MilterManagerMetrics *metrics,
+                                    MilterEventLoop      *loop,
+                                    gdouble               interval);
+
+gchar       *milter_manager_metrics_to_open_metrics
+                                   (MilterManagerMetrics *metrics);
+void         milter_manager_metrics_to_xml_string
+                                   (MilterManagerMetrics *metrics,
+                                    GString              *string,
+                                    guint                 indent);
+void         milter_manager_metrics_egg_to_xml_string
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    GString              *string,
+                                    guint                 indent);
+void         milter_manager_metrics_egg_launch_to_xml_string
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    GString              *string,
+                                    guint                 indent);
+void         milter_manager_metrics_egg_circuit_breaker_to_xml_string
+                                   (MilterManagerMetrics *metrics,
+                                    const gchar          *egg_name,
+                                    GString              *string,
+                                    guint                 indent);
+
+G_END_DECLS
+
+#endif /* __MILTER_MANAGER_METRICS_H__ */
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
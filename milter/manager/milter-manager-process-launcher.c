@@ -28,6 +28,7 @@
 #include <pwd.h>
 #include <grp.h>
 #include <errno.h>
+#include <signal.h>
 
 #include "milter-manager-process-launcher.h"
 #include "milter-manager-enum-types.h"
@@ -39,10 +40,15 @@
                                  MILTER_TYPE_MANAGER_PROCESS_LAUNCHER,     \
                                  MilterManagerProcessLauncherPrivate))
 
+#define MINIMUM_RESTART_INTERVAL 0.1
+#define MAXIMUM_RESTART_INTERVAL 60.0
+#define STABLE_LIFETIME 60.0
+
 typedef struct _MilterManagerProcessLauncherPrivate MilterManagerProcessLauncherPrivate;
 struct _MilterManagerProcessLauncherPrivate
 {
     GList *processes;
+    GHashTable *restarts;
 };
 
 enum
@@ -69,8 +75,24 @@ typedef struct _ProcessData
     gchar *user_name;
     MilterReader *standard_output;
     MilterReader *standard_error;
+    gint64 started_time;
 } ProcessData;
 
+typedef struct _RestartData
+{
+    MilterManagerProcessLauncher *launcher;
+    MilterEventLoop *loop;
+    gchar *command_line;
+    gchar *user_name;
+    gdouble interval;
+    guint timeout_id;
+} RestartData;
+
+static gboolean launch (MilterManagerProcessLauncher *launcher,
+                        const gchar *command_line,
+                        const gchar *user_name,
+                        GError **error);
+
 static void dispose        (GObject         *object);
 static void set_property   (GObject         *object,
                             guint            prop_id,
@@ -157,6 +179,7 @@ process_data_new (MilterEventLoop *loop, GPid pid, guint watch_id,
     data->watch_id = watch_id;
     data->command_line = g_strdup(command_line);
     data->user_name = g_strdup(user_name);
+    data->started_time = g_get_monotonic_time();
 
     data->standard_output = create_reader(pid, standard_output_fd);
     data->standard_error = create_reader(pid, standard_error_fd);
@@ -201,6 +224,98 @@ compare_process_data_pid (gconstpointer a, gconstpointer b)
     return (data->pid - GPOINTER_TO_INT(b));
 }
 
+static void
+restart_data_free (RestartData *restart)
+{
+    if (restart->timeout_id > 0)
+        milter_event_loop_remove(restart->loop, restart->timeout_id);
+    g_object_unref(restart->loop);
+    g_free(restart->command_line);
+    g_free(restart->user_name);
+    g_free(restart);
+}
+
+static gboolean
+cb_restart (gpointer user_data)
+{
+    RestartData *restart = user_data;
+    GError *error = NULL;
+
+    restart->timeout_id = 0;
+    if (!launch(restart->launcher,
+                restart->command_line, restart->user_name,
+                &error)) {
+        if (!g_error_matches(
+                error,
+                MILTER_MANAGER_PROCESS_LAUNCHER_ERROR,
+                MILTER_MANAGER_PROCESS_LAUNCHER_ERROR_ALREADY_LAUNCHED)) {
+            milter_error("[launcher][error][restart] <%s>@<%s>: %s",
+                         restart->command_line,
+                         restart->user_name ? restart->user_name : "NULL",
+                         error->message);
+        }
+        g_error_free(error);
+    }
+
+    return FALSE;
+}
+
+static gboolean
+is_crash_signal (gint signal_number)
+{
+    switch (signal_number) {
+    case SIGSEGV:
+    case SIGBUS:
+    case SIGILL:
+    case SIGFPE:
+    case SIGABRT:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* A crashed milter is launched again before a session needs
+ * it. The interval is doubled while it keeps crashing soon
+ * after launch. */
+static void
+schedule_restart (MilterManagerProcessLauncher *launcher, ProcessData *data)
+{
+    MilterManagerProcessLauncherPrivate *priv;
+    RestartData *restart;
+    gdouble lifetime;
+
+    priv = MILTER_MANAGER_PROCESS_LAUNCHER_GET_PRIVATE(launcher);
+
+    lifetime = (g_get_monotonic_time() - data->started_time) /
+        (gdouble)G_USEC_PER_SEC;
+    restart = g_hash_table_lookup(priv->restarts, data->command_line);
+    if (!restart) {
+        restart = g_new0(RestartData, 1);
+        restart->launcher = launcher;
+        restart->loop = g_object_ref(data->loop);
+        restart->command_line = g_strdup(data->command_line);
+        restart->user_name = g_strdup(data->user_name);
+        restart->interval = MINIMUM_RESTART_INTERVAL;
+        g_hash_table_insert(priv->restarts, restart->command_line, restart);
+    } else if (lifetime >= STABLE_LIFETIME) {
+        restart->interval = MINIMUM_RESTART_INTERVAL;
+    } else {
+        restart->interval = MIN(restart->interval * 2,
+                                MAXIMUM_RESTART_INTERVAL);
+    }
+
+    if (restart->timeout_id > 0)
+        return;
+
+    milter_info("[launcher][restart][schedule] <%s>: <%g>",
+                data->command_line, restart->interval);
+    restart->timeout_id = milter_event_loop_add_timeout(restart->loop,
+                                                        restart->interval,
+                                                        cb_restart,
+                                                        restart);
+}
+
 static void
 child_watch_func (GPid pid, gint status, gpointer user_data)
 {
@@ -217,7 +332,16 @@ child_watch_func (GPid pid, gint status, gpointer user_data)
 
     data = process->data;
     if (WIFSIGNALED(status)) {
-        /* FIXME restart */
+        milter_error("[launcher][finish][signal] %d: <%s>",
+                     WTERMSIG(status), data->command_line);
+        if (is_crash_signal(WTERMSIG(status))) {
+            priv->processes = g_list_remove_link(priv->processes, process);
+            schedule_restart(MILTER_MANAGER_PROCESS_LAUNCHER(user_data),
+                             data);
+            process_data_free(data);
+            g_list_free_1(process);
+            return;
+        }
     } else if (WIFEXITED(status)){
         milter_debug("[launcher][finish][success] <%s>", data->command_line);
     } else {
@@ -465,6 +589,9 @@ milter_manager_process_launcher_init (MilterManagerProcessLauncher *launcher)
     priv = MILTER_MANAGER_PROCESS_LAUNCHER_GET_PRIVATE(launcher);
 
     priv->processes = NULL;
+    priv->restarts = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           NULL,
+                                           (GDestroyNotify)restart_data_free);
 }
 
 static void
@@ -480,6 +607,11 @@ dispose (GObject *object)
         priv->processes = NULL;
     }
 
+    if (priv->restarts) {
+        g_hash_table_unref(priv->restarts);
+        priv->restarts = NULL;
+    }
+
     G_OBJECT_CLASS(milter_manager_process_launcher_parent_class)->dispose(object);
 }
 
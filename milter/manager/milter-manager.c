@@ -41,23 +41,36 @@ typedef struct _MilterManagerPrivate MilterManagerPrivate;
 struct _MilterManagerPrivate
 {
     MilterManagerConfiguration *configuration;
-    GList *leaders;
-    GList *next_connection_checked_leader;
-    gboolean connection_checking;
+    GHashTable *leaders_states;
+    GMutex leaders_states_mutex;
 
     GIOChannel *launcher_read_channel;
     GIOChannel *launcher_write_channel;
 
-    guint periodical_connection_checker_id;
-    guint current_periodical_connection_check_interval;
-
-    GList *finished_leaders;
+    MilterManagerMetrics *metrics;
 
     gboolean is_custom_n_workers;
     gboolean is_custom_run_as_daemon;
     gboolean is_custom_max_pending_finished_sessions;
 };
 
+/* Leaders are owned by the event loop that processes their
+ * sessions. Each event loop thread has its own state. */
+typedef struct _LeadersState LeadersState;
+struct _LeadersState
+{
+    MilterManager *manager;
+    MilterEventLoop *loop;
+    GList *leaders;
+    GList *next_connection_checked_leader;
+    gboolean connection_checking;
+
+    guint periodical_connection_checker_id;
+    guint current_periodical_connection_check_interval;
+
+    GList *finished_leaders;
+};
+
 enum
 {
     PROP_0,
@@ -67,6 +80,7 @@ enum
 G_DEFINE_TYPE(MilterManager, milter_manager, MILTER_TYPE_CLIENT)
 
 static void dispose        (GObject         *object);
+static void finalize       (GObject         *object);
 static void set_property   (GObject         *object,
                             guint            prop_id,
                             const GValue    *value,
@@ -128,6 +142,14 @@ static void   set_default_packet_buffer_size
 static const gchar *get_pid_file          (MilterClient *client);
 static void   set_pid_file                (MilterClient *client,
                                            const gchar  *pid_file);
+static gboolean is_reuse_port             (MilterClient *client);
+static void   set_reuse_port              (MilterClient *client,
+                                           gboolean      reuse_port);
+static guint  get_n_event_loop_threads    (MilterClient *client);
+static void   set_n_event_loop_threads    (MilterClient *client,
+                                           guint         n_threads);
+static gboolean is_event_loop_threads_usable
+                                          (MilterClient *client);
 static gboolean is_run_as_daemon          (MilterClient *client);
 static void   set_run_as_daemon           (MilterClient *client,
                                            gboolean      daemon);
@@ -140,6 +162,8 @@ static void   set_max_pending_finished_sessions
 static void   workers_created             (MilterClient *client,
                                            guint         n_workers);
 static void   worker_created              (MilterClient *client);
+static void   worker_exited               (MilterClient *client,
+                                           guint         worker_id);
 
 static void
 milter_manager_class_init (MilterManagerClass *klass)
@@ -152,6 +176,7 @@ milter_manager_class_init (MilterManagerClass *klass)
     client_class = MILTER_CLIENT_CLASS(klass);
 
     gobject_class->dispose      = dispose;
+    gobject_class->finalize     = finalize;
     gobject_class->set_property = set_property;
     gobject_class->get_property = get_property;
 
@@ -183,6 +208,11 @@ milter_manager_class_init (MilterManagerClass *klass)
         set_default_packet_buffer_size;
     client_class->get_pid_file = get_pid_file;
     client_class->set_pid_file = set_pid_file;
+    client_class->is_reuse_port = is_reuse_port;
+    client_class->set_reuse_port = set_reuse_port;
+    client_class->get_n_event_loop_threads = get_n_event_loop_threads;
+    client_class->set_n_event_loop_threads = set_n_event_loop_threads;
+    client_class->is_event_loop_threads_usable = is_event_loop_threads_usable;
     client_class->is_run_as_daemon = is_run_as_daemon;
     client_class->set_run_as_daemon = set_run_as_daemon;
     client_class->fork = fork_delegate;
@@ -195,6 +225,7 @@ milter_manager_class_init (MilterManagerClass *klass)
         set_max_pending_finished_sessions;
     client_class->workers_created = workers_created;
     client_class->worker_created = worker_created;
+    client_class->worker_exited = worker_exited;
 
     spec = g_param_spec_object("configuration",
                                "Configuration",
@@ -215,17 +246,13 @@ milter_manager_init (MilterManager *manager)
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
     priv->configuration = NULL;
-    priv->leaders = NULL;
-    priv->next_connection_checked_leader = NULL;
-    priv->connection_checking = FALSE;
+    priv->leaders_states = NULL;
+    g_mutex_init(&(priv->leaders_states_mutex));
 
     priv->launcher_read_channel = NULL;
     priv->launcher_write_channel = NULL;
 
-    priv->periodical_connection_checker_id = 0;
-    priv->current_periodical_connection_check_interval = 0;
-
-    priv->finished_leaders = NULL;
+    priv->metrics = NULL;
 }
 
 static void
@@ -236,42 +263,90 @@ configuration_set_manager (MilterManagerConfiguration *configuration,
 }
 
 static void
-dispose_periodical_connection_checker (MilterManager *manager)
+dispose_periodical_connection_checker (LeadersState *state)
 {
-    MilterManagerPrivate *priv;
-    MilterEventLoop *loop;
-
-    priv = MILTER_MANAGER_GET_PRIVATE(manager);
-    priv->current_periodical_connection_check_interval = 0;
+    state->current_periodical_connection_check_interval = 0;
 
-    if (priv->periodical_connection_checker_id == 0)
+    if (state->periodical_connection_checker_id == 0)
         return;
 
-    loop = milter_client_get_event_loop(MILTER_CLIENT(manager));
-    milter_event_loop_remove(loop, priv->periodical_connection_checker_id);
-    priv->periodical_connection_checker_id = 0;
+    milter_event_loop_remove(state->loop,
+                             state->periodical_connection_checker_id);
+    state->periodical_connection_checker_id = 0;
 }
 
 static void
-dispose_finished_leaders (MilterManagerPrivate *priv)
+dispose_finished_leaders (LeadersState *state)
 {
     GList *node;
     guint n_leaders = 0;
 
-    if (!priv->finished_leaders)
+    if (!state->finished_leaders)
         return;
 
-    for (node = priv->finished_leaders; node; node = g_list_next(node)) {
+    for (node = state->finished_leaders; node; node = g_list_next(node)) {
         MilterManagerLeader *leader = node->data;
         g_object_unref(leader);
         n_leaders++;
     }
-    g_list_free(priv->finished_leaders);
-    priv->finished_leaders = NULL;
+    g_list_free(state->finished_leaders);
+    state->finished_leaders = NULL;
 
     milter_debug("[manager][dispose][leaders] %u", n_leaders);
 }
 
+static void
+leaders_state_free (LeadersState *state)
+{
+    dispose_periodical_connection_checker(state);
+    dispose_finished_leaders(state);
+    if (state->leaders)
+        g_list_free(state->leaders);
+    g_object_unref(state->loop);
+    g_free(state);
+}
+
+static LeadersState *
+lookup_leaders_state (MilterManager *manager, MilterEventLoop *loop,
+                      gboolean create)
+{
+    MilterManagerPrivate *priv;
+    LeadersState *state = NULL;
+
+    if (!loop)
+        return NULL;
+
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    g_mutex_lock(&(priv->leaders_states_mutex));
+    if (priv->leaders_states)
+        state = g_hash_table_lookup(priv->leaders_states, loop);
+    if (!state && create) {
+        if (!priv->leaders_states) {
+            priv->leaders_states =
+                g_hash_table_new_full(g_direct_hash,
+                                      g_direct_equal,
+                                      NULL,
+                                      (GDestroyNotify)leaders_state_free);
+        }
+        state = g_new0(LeadersState, 1);
+        state->manager = manager;
+        state->loop = g_object_ref(loop);
+        g_hash_table_insert(priv->leaders_states, loop, state);
+    }
+    g_mutex_unlock(&(priv->leaders_states_mutex));
+
+    return state;
+}
+
+static LeadersState *
+lookup_current_leaders_state (MilterManager *manager)
+{
+    MilterEventLoop *loop;
+
+    loop = milter_client_get_event_loop(MILTER_CLIENT(manager));
+    return lookup_leaders_state(manager, loop, FALSE);
+}
+
 static void
 dispose (GObject *object)
 {
@@ -281,8 +356,12 @@ dispose (GObject *object)
     manager = MILTER_MANAGER(object);
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
-    dispose_periodical_connection_checker(manager);
-    dispose_finished_leaders(priv);
+    g_mutex_lock(&(priv->leaders_states_mutex));
+    if (priv->leaders_states) {
+        g_hash_table_unref(priv->leaders_states);
+        priv->leaders_states = NULL;
+    }
+    g_mutex_unlock(&(priv->leaders_states_mutex));
 
     if (priv->configuration) {
         configuration_set_manager(priv->configuration, NULL);
@@ -290,17 +369,23 @@ dispose (GObject *object)
         priv->configuration = NULL;
     }
 
-    if (priv->leaders) {
-        g_list_free(priv->leaders);
-        priv->leaders = NULL;
-    }
-    priv->next_connection_checked_leader = NULL;
-
     milter_manager_set_launcher_channel(MILTER_MANAGER(object), NULL, NULL);
+    milter_manager_set_metrics(MILTER_MANAGER(object), NULL);
 
     G_OBJECT_CLASS(milter_manager_parent_class)->dispose(object);
 }
 
+static void
+finalize (GObject *object)
+{
+    MilterManagerPrivate *priv;
+
+    priv = MILTER_MANAGER_GET_PRIVATE(object);
+    g_mutex_clear(&(priv->leaders_states_mutex));
+
+    G_OBJECT_CLASS(milter_manager_parent_class)->finalize(object);
+}
+
 static void
 set_property (GObject      *object,
               guint         prop_id,
@@ -363,64 +448,64 @@ milter_manager_new (MilterManagerConfiguration *configuration)
 static gboolean
 connection_check (gpointer data)
 {
-    MilterManager *manager = data;
-    MilterManagerPrivate *priv;
+    LeadersState *state = data;
     GList *node, *next_node;
     guint i;
     guint n_leaders_per_connection_check = 30; /* FIXME: make customizable */
 
-    priv = MILTER_MANAGER_GET_PRIVATE(manager);
-
-    priv->connection_checking = TRUE;
+    state->connection_checking = TRUE;
 
-    if (!priv->next_connection_checked_leader)
-        priv->next_connection_checked_leader = priv->leaders;
-    node = priv->next_connection_checked_leader;
+    if (!state->next_connection_checked_leader)
+        state->next_connection_checked_leader = state->leaders;
+    node = state->next_connection_checked_leader;
     i = 0;
     while (node && i < n_leaders_per_connection_check) {
         MilterManagerLeader *leader = node->data;
         next_node = g_list_next(node);
         if (!milter_manager_leader_check_connection(leader)) {
-            priv->leaders = g_list_delete_link(priv->leaders, node);
+            state->leaders = g_list_delete_link(state->leaders, node);
         }
         node = next_node;
         i++;
     }
-    priv->next_connection_checked_leader = node;
+    state->next_connection_checked_leader = node;
+
+    state->connection_checking = FALSE;
 
-    priv->connection_checking = FALSE;
+    if (state->leaders)
+        return TRUE;
 
-    return priv->leaders != NULL;
+    state->periodical_connection_checker_id = 0;
+    state->current_periodical_connection_check_interval = 0;
+    return FALSE;
 }
 
 static void
-start_periodical_connection_checker (MilterManager *manager)
+start_periodical_connection_checker (LeadersState *state)
 {
     MilterManagerPrivate *priv;
     guint interval;
 
-    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    priv = MILTER_MANAGER_GET_PRIVATE(state->manager);
 
     interval = milter_manager_configuration_get_connection_check_interval(priv->configuration);
 
     if (interval > 0) {
-        if (priv->periodical_connection_checker_id == 0 ||
-            interval != priv->current_periodical_connection_check_interval) {
-            MilterEventLoop *loop;
+        if (state->periodical_connection_checker_id == 0 ||
+            interval != state->current_periodical_connection_check_interval) {
             milter_debug("[manager][connection-check][start] <%u> -> <%u>: %s",
-                         priv->current_periodical_connection_check_interval,
+                         state->current_periodical_connection_check_interval,
                          interval,
-                         priv->periodical_connection_checker_id == 0 ?
+                         state->periodical_connection_checker_id == 0 ?
                          "initial" : "update");
-            dispose_periodical_connection_checker(manager);
-            priv->current_periodical_connection_check_interval = interval;
-            loop = milter_client_get_event_loop(MILTER_CLIENT(manager));
-            priv->periodical_connection_checker_id =
-                milter_event_loop_add_timeout(loop, interval,
-                                              connection_check, manager);
+            dispose_periodical_connection_checker(state);
+            state->current_periodical_connection_check_interval = interval;
+            state->periodical_connection_checker_id =
+                milter_event_loop_add_timeout(state->loop, interval,
+                                              connection_check, state);
         }
     } else {
-        dispose_periodical_connection_checker(manager);
+        dispose_periodical_connection_checker(state);
     }
 }
 
@@ -692,7 +777,7 @@ cb_client_finished (MilterClientContext *context, gpointer user_data)
 
 typedef struct _LeaderFinishData
 {
-    MilterManager *manager;
+    LeadersState *state;
     MilterClientContext *client_context;
 } LeaderFinishData;
 
@@ -735,37 +820,38 @@ cb_leader_finished (MilterFinishedEmittable *emittable, gpointer user_data)
     LeaderFinishData *finish_data = user_data;
     MilterClientContext *client_context;
     MilterManagerLeader *leader;
-    MilterManagerPrivate *priv;
+    LeadersState *state;
 
     client_context = finish_data->client_context;
 
     leader = MILTER_MANAGER_LEADER(emittable);
     teardown_client_context_signals(client_context, leader, finish_data);
 
-    priv = MILTER_MANAGER_GET_PRIVATE(finish_data->manager);
-    if (!priv->connection_checking) {
+    state = finish_data->state;
+    if (!state->connection_checking) {
         GList *node;
-        node = g_list_find(priv->leaders, leader);
+        node = g_list_find(state->leaders, leader);
         if (node) {
-            if (priv->next_connection_checked_leader == node)
-                priv->next_connection_checked_leader = g_list_next(node);
-            priv->leaders = g_list_delete_link(priv->leaders, node);
+            if (state->next_connection_checked_leader == node)
+                state->next_connection_checked_leader = g_list_next(node);
+            state->leaders = g_list_delete_link(state->leaders, node);
         }
-        if (!priv->leaders) {
+        if (!state->leaders) {
             milter_debug("[manager][connection-check][dispose] no leaders");
-            dispose_periodical_connection_checker(finish_data->manager);
+            dispose_periodical_connection_checker(state);
         }
     }
 
-    priv->finished_leaders = g_list_prepend(priv->finished_leaders, leader);
+    state->finished_leaders = g_list_prepend(state->finished_leaders, leader);
 
     g_free(finish_data);
 }
 
 static void
 setup_context_signals (MilterClientContext *context,
-                       MilterManager *manager)
+                       LeadersState *state)
 {
+    MilterManager *manager = state->manager;
     MilterManagerLeader *leader;
     MilterManagerPrivate *priv;
     LeaderFinishData *finish_data;
@@ -773,7 +859,7 @@ setup_context_signals (MilterClientContext *context,
     priv = MILTER_MANAGER_GET_PRIVATE(manager);
 
     leader = milter_manager_leader_new(priv->configuration, context);
-    priv->leaders = g_list_prepend(priv->leaders, leader);
+    state->leaders = g_list_prepend(state->leaders, leader);
 
 #define CONNECT(name)                                   \
     g_signal_connect(context, #name,                    \
@@ -800,13 +886,14 @@ setup_context_signals (MilterClientContext *context,
 #undef CONNECT
 
     finish_data = g_new(LeaderFinishData, 1);
-    finish_data->manager = manager;
+    finish_data->state = state;
     finish_data->client_context = context;
     g_signal_connect(leader, "finished",
                      G_CALLBACK(cb_leader_finished), finish_data);
     milter_manager_leader_set_launcher_channel(leader,
                                                priv->launcher_read_channel,
                                                priv->launcher_write_channel);
+    milter_manager_leader_set_metrics(leader, priv->metrics);
 
     g_signal_emit_by_name(priv->configuration, "connected", leader);
 }
@@ -814,15 +901,17 @@ setup_context_signals (MilterClientContext *context,
 static void
 connection_established (MilterClient *client, MilterClientContext *context)
 {
-    MilterManager *manager;
+    MilterEventLoop *loop;
+    LeadersState *state;
 
-    manager = MILTER_MANAGER(client);
-    setup_context_signals(context, MILTER_MANAGER(client));
+    loop = milter_agent_get_event_loop(MILTER_AGENT(context));
+    state = lookup_leaders_state(MILTER_MANAGER(client), loop, TRUE);
+    setup_context_signals(context, state);
 
     milter_debug("[%u] [manager][session][start]",
                  milter_agent_get_tag(MILTER_AGENT(context)));
 
-    start_periodical_connection_checker(manager);
+    start_periodical_connection_checker(state);
 }
 
 static const gchar *
@@ -1016,6 +1105,85 @@ set_max_connections (MilterClient *client, guint max_connections)
                                                      max_connections);
 }
 
+static gboolean
+is_reuse_port (MilterClient *client)
+{
+    MilterManager *manager;
+    MilterManagerPrivate *priv;
+    MilterManagerConfiguration *configuration;
+
+    manager = MILTER_MANAGER(client);
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    configuration = priv->configuration;
+    return milter_manager_configuration_is_reuse_port(configuration);
+}
+
+static void
+set_reuse_port (MilterClient *client, gboolean reuse_port)
+{
+    MilterManager *manager;
+    MilterManagerPrivate *priv;
+    MilterManagerConfiguration *configuration;
+
+    manager = MILTER_MANAGER(client);
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    configuration = priv->configuration;
+    milter_manager_configuration_set_reuse_port(configuration, reuse_port);
+}
+
+static guint
+get_n_event_loop_threads (MilterClient *client)
+{
+    MilterManager *manager;
+    MilterManagerPrivate *priv;
+    MilterManagerConfiguration *configuration;
+    guint n_threads;
+
+    manager = MILTER_MANAGER(client);
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    configuration = priv->configuration;
+    n_threads =
+        milter_manager_configuration_get_n_event_loop_threads(configuration);
+    /* Handlers written in Ruby can't be called in threads that
+     * aren't created by Ruby. */
+    if (n_threads > 0 &&
+        milter_manager_configuration_has_session_handlers(configuration)) {
+        milter_warning("[manager][event-loop-threads][disable] "
+                       "handlers are used for sessions: <%u>",
+                       n_threads);
+        n_threads = 0;
+    }
+    return n_threads;
+}
+
+static void
+set_n_event_loop_threads (MilterClient *client, guint n_threads)
+{
+    MilterManager *manager;
+    MilterManagerPrivate *priv;
+    MilterManagerConfiguration *configuration;
+
+    manager = MILTER_MANAGER(client);
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    configuration = priv->configuration;
+    milter_manager_configuration_set_n_event_loop_threads(configuration,
+                                                          n_threads);
+}
+
+static gboolean
+is_event_loop_threads_usable (MilterClient *client)
+{
+    MilterManager *manager;
+    MilterManagerPrivate *priv;
+
+    manager = MILTER_MANAGER(client);
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+    /* Handlers written in Ruby may be connected by reloading
+     * configuration after event loop threads are started. */
+    return !milter_manager_configuration_has_session_handlers(
+        priv->configuration);
+}
+
 static const gchar *
 get_effective_user (MilterClient *client)
 {
@@ -1192,22 +1360,30 @@ static void
 maintain (MilterClient *client)
 {
     MilterManagerPrivate *priv;
+    const GList *node;
 
     milter_debug("[manager][maintain]");
 
     priv = MILTER_MANAGER_GET_PRIVATE(client);
     milter_manager_configuration_maintain(priv->configuration);
+
+    for (node = milter_manager_configuration_get_eggs(priv->configuration);
+         node;
+         node = g_list_next(node)) {
+        milter_manager_egg_expire_pooled_connections(node->data);
+    }
 }
 
 static void
 sessions_finished (MilterClient *client, guint n_finished_sessions)
 {
-    MilterManagerPrivate *priv;
+    LeadersState *state;
 
     milter_debug("[manager][sessions][finished] %u", n_finished_sessions);
 
-    priv = MILTER_MANAGER_GET_PRIVATE(client);
-    dispose_finished_leaders(priv);
+    state = lookup_current_leaders_state(MILTER_MANAGER(client));
+    if (state)
+        dispose_finished_leaders(state);
 }
 
 static void
@@ -1404,7 +1580,28 @@ workers_created (MilterClient *client, guint n_workers)
 static void
 worker_created (MilterClient *client)
 {
+    MilterManagerPrivate *priv;
+
     milter_debug("[manager][worker-created] pid=<%d>", getpid());
+
+    priv = MILTER_MANAGER_GET_PRIVATE(client);
+    if (priv->metrics)
+        milter_manager_metrics_set_slot(priv->metrics,
+                                        milter_client_get_worker_id(client));
+}
+
+static void
+worker_exited (MilterClient *client, guint worker_id)
+{
+    MilterClientClass *klass;
+    MilterManagerPrivate *priv;
+
+    klass = MILTER_CLIENT_CLASS(milter_manager_parent_class);
+    klass->worker_exited(client, worker_id);
+
+    priv = MILTER_MANAGER_GET_PRIVATE(client);
+    if (priv->metrics)
+        milter_manager_metrics_clear_slot(priv->metrics, worker_id);
 }
 
 /**
@@ -1424,12 +1621,18 @@ milter_manager_get_configuration (MilterManager *manager)
  * @manager: A #MilterManager.
  *
  * Returns: (transfer none) (element-type MilterManagerLeader):
- *   The leaders of @manager.
+ *   The leaders of @manager. In an event loop thread, they
+ *   are the leaders processed by the thread.
  */
 const GList *
 milter_manager_get_leaders (MilterManager *manager)
 {
-    return MILTER_MANAGER_GET_PRIVATE(manager)->leaders;
+    LeadersState *state;
+
+    state = lookup_current_leaders_state(manager);
+    if (!state)
+        return NULL;
+    return state->leaders;
 }
 
 static void
@@ -1588,6 +1791,33 @@ milter_manager_set_launcher_channel (MilterManager *manager,
         g_io_channel_ref(priv->launcher_read_channel);
 }
 
+/**
+ * milter_manager_get_metrics:
+ * @manager: A #MilterManager.
+ *
+ * Returns: (transfer none): The metrics of @manager or %NULL.
+ */
+MilterManagerMetrics *
+milter_manager_get_metrics (MilterManager *manager)
+{
+    return MILTER_MANAGER_GET_PRIVATE(manager)->metrics;
+}
+
+void
+milter_manager_set_metrics (MilterManager        *manager,
+                            MilterManagerMetrics *metrics)
+{
+    MilterManagerPrivate *priv;
+
+    priv = MILTER_MANAGER_GET_PRIVATE(manager);
+
+    if (priv->metrics)
+        g_object_unref(priv->metrics);
+    priv->metrics = metrics;
+    if (priv->metrics)
+        g_object_ref(priv->metrics);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -25,6 +25,7 @@
 #include <milter/client.h>
 #include <milter/server.h>
 #include <milter/manager/milter-manager-configuration.h>
+#include <milter/manager/milter-manager-metrics.h>
 
 G_BEGIN_DECLS
 
@@ -62,6 +63,9 @@ void                  milter_manager_set_launcher_channel
                                                  (MilterManager *manager,
                                                   GIOChannel *read_channel,
                                                   GIOChannel *write_channel);
+MilterManagerMetrics *milter_manager_get_metrics (MilterManager *manager);
+void                  milter_manager_set_metrics (MilterManager        *manager,
+                                                  MilterManagerMetrics *metrics);
 
 G_END_DECLS
 
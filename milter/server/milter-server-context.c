@@ -36,6 +36,9 @@
 
 #define NULL_SAFE_NAME(name) ((name) ? (name) : "(unknown)")
 
+/* 16 packets of MILTER_CHUNK_SIZE are about 1MiB. */
+#define MAX_STREAM_BODY_PACKETS 16
+
 enum
 {
     STOP_ON_CONNECT,
@@ -91,6 +94,7 @@ struct _MilterServerContextPrivate
     MilterServerContextState last_state;
     gchar *reply_code;
     MilterOption *option;
+    MilterOption *negotiate_reply_option;
 
     gdouble connection_timeout;
     gdouble writing_timeout;
@@ -108,14 +112,19 @@ struct _MilterServerContextPrivate
     gboolean sent_end_of_message;
 
     GTimer *elapsed;
+    gint64 command_sent_time;
 
     gboolean negotiated;
     gboolean processing_message;
     gboolean quitted;
+    gboolean quit_new_connection;
 
     gchar *current_recipient;
 
     MilterMessageResult *message_result;
+
+    MilterMacrosPacketCache *macros_packet_cache;
+    MilterEncoder *macros_encoder;
 };
 
 enum
@@ -467,6 +476,7 @@ milter_server_context_init (MilterServerContext *context)
     priv->last_state = MILTER_SERVER_CONTEXT_STATE_START;
 
     priv->option = NULL;
+    priv->negotiate_reply_option = NULL;
     priv->name = NULL;
     priv->body_response_queue = NULL;
     priv->process_body_count = 0;
@@ -485,14 +495,19 @@ milter_server_context_init (MilterServerContext *context)
     priv->elapsed = g_timer_new();
     g_timer_stop(priv->elapsed);
     g_timer_reset(priv->elapsed);
+    priv->command_sent_time = 0;
 
     priv->negotiated = FALSE;
     priv->processing_message = FALSE;
     priv->quitted = FALSE;
+    priv->quit_new_connection = FALSE;
 
     priv->current_recipient = NULL;
 
     priv->message_result = NULL;
+
+    priv->macros_packet_cache = NULL;
+    priv->macros_encoder = NULL;
 }
 
 static void
@@ -632,6 +647,11 @@ dispose (GObject *object)
         priv->option = NULL;
     }
 
+    if (priv->negotiate_reply_option) {
+        g_object_unref(priv->negotiate_reply_option);
+        priv->negotiate_reply_option = NULL;
+    }
+
     if (priv->body) {
         if (priv->body->len > 0) {
             milter_error("[%u] [server][dispose][body][remained] [%s] "
@@ -666,6 +686,16 @@ dispose (GObject *object)
 
     dispose_message_result(priv);
 
+    if (priv->macros_packet_cache) {
+        g_object_unref(priv->macros_packet_cache);
+        priv->macros_packet_cache = NULL;
+    }
+
+    if (priv->macros_encoder) {
+        g_object_unref(priv->macros_encoder);
+        priv->macros_encoder = NULL;
+    }
+
     G_OBJECT_CLASS(milter_server_context_parent_class)->dispose(object);
 }
 
@@ -995,48 +1025,40 @@ filter_macros (GHashTable *macros, GList *request_symbols)
 }
 
 static void
-prepend_macro (MilterServerContext *context, GString *packed_packet,
-               MilterCommand command)
+encode_define_macro (MilterServerContext *context,
+                     MilterCommand command,
+                     GHashTable *macros,
+                     GList *request_symbols,
+                     const gchar **packet,
+                     gsize *packet_size)
 {
-    GHashTable *macros, *filtered_macros = NULL, *target_macros;
-    GList *request_symbols = NULL;
-    const gchar *packet = NULL;
-    gsize packet_size;
-    MilterEncoder *encoder;
+    MilterServerContextPrivate *priv;
+    GHashTable *filtered_macros = NULL, *target_macros;
     MilterAgent *agent;
-    MilterProtocolAgent *protocol_agent;
-    MilterMacrosRequests *macros_requests;
 
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
     agent = MILTER_AGENT(context);
-    protocol_agent = MILTER_PROTOCOL_AGENT(context);
-
-    milter_protocol_agent_set_macro_context(protocol_agent, command);
-    macros = milter_protocol_agent_get_macros(protocol_agent);
-    milter_protocol_agent_set_macro_context(protocol_agent,
-                                            MILTER_COMMAND_UNKNOWN);
-    if (!macros || g_hash_table_size(macros) == 0)
-        return;
 
     target_macros = macros;
-    macros_requests = milter_protocol_agent_get_macros_requests(protocol_agent);
-
-    if (macros_requests) {
-        request_symbols =
-            milter_macros_requests_get_symbols(macros_requests, command);
-        if (request_symbols)
-            filtered_macros = filter_macros(macros, request_symbols);
-        if (!filtered_macros)
+    if (request_symbols) {
+        filtered_macros = filter_macros(macros, request_symbols);
+        if (!filtered_macros) {
+            *packet = NULL;
+            *packet_size = 0;
             return;
+        }
         target_macros = filtered_macros;
     }
 
-    encoder = milter_agent_get_encoder(agent);
-    milter_command_encoder_encode_define_macro(MILTER_COMMAND_ENCODER(encoder),
-                                               &packet, &packet_size,
-                                               command,
-                                               target_macros);
-    if (filtered_macros)
-        g_hash_table_unref(filtered_macros);
+    /* The agent's encoder may still have the command packet
+     * that follows the macros. */
+    if (!priv->macros_encoder)
+        priv->macros_encoder = milter_command_encoder_new();
+    milter_command_encoder_encode_define_macro(
+        MILTER_COMMAND_ENCODER(priv->macros_encoder),
+        packet, packet_size,
+        command,
+        target_macros);
 
     if (milter_need_debug_log()) {
         gchar *command_name;
@@ -1055,7 +1077,60 @@ prepend_macro (MilterServerContext *context, GString *packed_packet,
         g_free(inspected_macros);
     }
 
-    g_string_prepend_len(packed_packet, packet, packet_size);
+    if (filtered_macros)
+        g_hash_table_unref(filtered_macros);
+}
+
+static void
+get_macros_packet (MilterServerContext *context, MilterCommand command,
+                   const gchar **packet, gsize *packet_size)
+{
+    MilterServerContextPrivate *priv;
+    GHashTable *macros;
+    GList *request_symbols = NULL;
+    MilterProtocolAgent *protocol_agent;
+    MilterMacrosRequests *macros_requests;
+    MilterMacrosPacketCache *cache = NULL;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    protocol_agent = MILTER_PROTOCOL_AGENT(context);
+
+    *packet = NULL;
+    *packet_size = 0;
+
+    milter_protocol_agent_set_macro_context(protocol_agent, command);
+    macros = milter_protocol_agent_get_macros(protocol_agent);
+    milter_protocol_agent_set_macro_context(protocol_agent,
+                                            MILTER_COMMAND_UNKNOWN);
+    if (!macros || g_hash_table_size(macros) == 0)
+        return;
+
+    macros_requests = milter_protocol_agent_get_macros_requests(protocol_agent);
+    if (macros_requests) {
+        request_symbols =
+            milter_macros_requests_get_symbols(macros_requests, command);
+        if (!request_symbols)
+            return;
+    }
+
+    /* Shared macros are never changed in place. So a packet
+     * encoded from them can be reused by other contexts that
+     * share the same macros. */
+    if (priv->macros_packet_cache &&
+        milter_protocol_agent_is_shared_macros(protocol_agent, command))
+        cache = priv->macros_packet_cache;
+
+    if (!cache ||
+        !milter_macros_packet_cache_lookup(cache, command,
+                                           macros, request_symbols,
+                                           packet, packet_size)) {
+        encode_define_macro(context, command, macros, request_symbols,
+                            packet, packet_size);
+        if (cache)
+            milter_macros_packet_cache_store(cache, command,
+                                             macros, request_symbols,
+                                             *packet, *packet_size);
+    }
 }
 
 static void
@@ -1217,6 +1292,9 @@ flush_body (MilterServerContext *context)
     const gchar *packet = NULL;
     gsize packet_size;
     gsize packed_size;
+    GString *batch = NULL;
+    guint i, n_packets = 1;
+    gboolean success;
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
@@ -1241,11 +1319,43 @@ flush_body (MilterServerContext *context)
                                        priv->body->str,
                                        priv->body->len,
                                        &packed_size);
-    if (!write_packet(context, packet, packet_size, state))
+    /* A milter that doesn't reply to body chunks receives
+     * several packets by one write. write_packet() prepends
+     * macros to the first packet. */
+    if (packed_size < priv->body->len &&
+        !milter_server_context_need_reply(context, state)) {
+        batch = g_string_new_len(packet, packet_size);
+        while (packed_size < priv->body->len &&
+               n_packets < MAX_STREAM_BODY_PACKETS) {
+            const gchar *macros_packet = NULL;
+            gsize macros_packet_size = 0;
+            gsize size;
+
+            get_macros_packet(context, MILTER_COMMAND_BODY,
+                              &macros_packet, &macros_packet_size);
+            if (macros_packet)
+                g_string_append_len(batch, macros_packet, macros_packet_size);
+            milter_command_encoder_encode_body(command_encoder,
+                                               &packet, &packet_size,
+                                               priv->body->str + packed_size,
+                                               priv->body->len - packed_size,
+                                               &size);
+            g_string_append_len(batch, packet, packet_size);
+            packed_size += size;
+            n_packets++;
+        }
+        success = write_packet(context, batch->str, batch->len, state);
+        g_string_free(batch, TRUE);
+    } else {
+        success = write_packet(context, packet, packet_size, state);
+    }
+    if (!success)
         return FALSE;
 
     g_string_erase(priv->body, 0, packed_size);
-    increment_process_body_count(context);
+    for (i = 0; i < n_packets; i++) {
+        increment_process_body_count(context);
+    }
 
     g_timer_stop(priv->elapsed);
     milter_debug("[%u] [server][timer][stop] [%s] <%g>",
@@ -1481,7 +1591,11 @@ write_packet (MilterServerContext *context,
 {
     GError *agent_error = NULL;
     MilterServerContextPrivate *priv;
-    GString *packed_packet;
+    MilterCommand macro_command = MILTER_COMMAND_UNKNOWN;
+    const gchar *macros_packet = NULL;
+    gsize macros_packet_size = 0;
+    struct iovec vectors[2];
+    gint n_vectors = 0;
     guint tag;
     MilterEventLoop *loop;
     const gchar *name;
@@ -1554,43 +1668,55 @@ write_packet (MilterServerContext *context,
         break;
     }
 
-    packed_packet = g_string_new_len(packet, packet_size);
     switch (next_state) {
     case MILTER_SERVER_CONTEXT_STATE_HELO:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_HELO);
+        macro_command = MILTER_COMMAND_HELO;
         break;
     case MILTER_SERVER_CONTEXT_STATE_CONNECT:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_CONNECT);
+        macro_command = MILTER_COMMAND_CONNECT;
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_ENVELOPE_FROM);
+        macro_command = MILTER_COMMAND_ENVELOPE_FROM;
         break;
     case MILTER_SERVER_CONTEXT_STATE_ENVELOPE_RECIPIENT:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_ENVELOPE_RECIPIENT);
+        macro_command = MILTER_COMMAND_ENVELOPE_RECIPIENT;
         break;
     case MILTER_SERVER_CONTEXT_STATE_DATA:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_DATA);
+        macro_command = MILTER_COMMAND_DATA;
         break;
     case MILTER_SERVER_CONTEXT_STATE_HEADER:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_HEADER);
+        macro_command = MILTER_COMMAND_HEADER;
         break;
     case MILTER_SERVER_CONTEXT_STATE_END_OF_HEADER:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_END_OF_HEADER);
+        macro_command = MILTER_COMMAND_END_OF_HEADER;
         break;
     case MILTER_SERVER_CONTEXT_STATE_BODY:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_BODY);
+        macro_command = MILTER_COMMAND_BODY;
         break;
     case MILTER_SERVER_CONTEXT_STATE_END_OF_MESSAGE:
-        prepend_macro(context, packed_packet, MILTER_COMMAND_END_OF_MESSAGE);
+        macro_command = MILTER_COMMAND_END_OF_MESSAGE;
         break;
     default:
         break;
     }
 
-    milter_agent_write_packet(MILTER_AGENT(context),
-                              packed_packet->str, packed_packet->len,
-                              &agent_error);
-    g_string_free(packed_packet, TRUE);
+    /* The macros packet and the command packet are written
+     * together without concatenating them. */
+    if (macro_command != MILTER_COMMAND_UNKNOWN)
+        get_macros_packet(context, macro_command,
+                          &macros_packet, &macros_packet_size);
+    if (macros_packet) {
+        vectors[n_vectors].iov_base = (gchar *)macros_packet;
+        vectors[n_vectors].iov_len = macros_packet_size;
+        n_vectors++;
+    }
+    vectors[n_vectors].iov_base = (gchar *)packet;
+    vectors[n_vectors].iov_len = packet_size;
+    n_vectors++;
+
+    milter_agent_write_packet_vectors(MILTER_AGENT(context),
+                                      vectors, n_vectors,
+                                      &agent_error);
 
     if (agent_error) {
         GError *error = NULL;
@@ -1616,6 +1742,7 @@ write_packet (MilterServerContext *context,
         return FALSE;
     }
 
+    priv->command_sent_time = g_get_monotonic_time();
     priv->next_states = g_list_append(priv->next_states,
                                       GUINT_TO_POINTER(next_state));
     return TRUE;
@@ -1760,6 +1887,19 @@ milter_server_context_get_option (MilterServerContext *context)
     return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->option;
 }
 
+/**
+ * milter_server_context_get_negotiate_reply_option:
+ * @context: A #MilterServerContext.
+ *
+ * Returns: (transfer none) (nullable):
+ *   The option replied by the client on negotiation.
+ */
+MilterOption *
+milter_server_context_get_negotiate_reply_option (MilterServerContext *context)
+{
+    return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->negotiate_reply_option;
+}
+
 gboolean
 milter_server_context_is_enable_step (MilterServerContext *context,
                                       MilterStepFlags step)
@@ -2125,6 +2265,98 @@ milter_server_context_header (MilterServerContext *context,
                         MILTER_SERVER_CONTEXT_STATE_HEADER);
 }
 
+gboolean
+milter_server_context_stream_headers (MilterServerContext *context,
+                                      MilterHeaders       *headers,
+                                      guint                first_index,
+                                      gboolean             strip_leading_space)
+{
+    MilterServerContextPrivate *priv;
+    MilterEncoder *encoder;
+    MilterHeaders *result_headers;
+    GString *batch;
+    guint i, length;
+    guint tag = 0;
+    const gchar *name = NULL;
+    gboolean success = TRUE;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+
+    if (milter_need_debug_log()) {
+        tag = milter_agent_get_tag(MILTER_AGENT(context));
+        name = milter_server_context_get_name(context);
+    }
+
+    length = milter_headers_length(headers);
+    milter_debug("[%u] [server][send][headers] [%s] <%u>..<%u>",
+                 tag, NULL_SAFE_NAME(name), first_index, length);
+
+    if (milter_server_context_is_enable_step(context, MILTER_STEP_NO_HEADERS)) {
+        milter_debug("[%u] [server][headers][skip] [%s]",
+                     tag, NULL_SAFE_NAME(name));
+        milter_server_context_set_state(context,
+                                        MILTER_SERVER_CONTEXT_STATE_HEADER);
+        g_signal_emit_by_name(context, "continue");
+        return TRUE;
+    }
+
+    ensure_message_result(priv);
+    result_headers = milter_message_result_get_headers(priv->message_result);
+    milter_message_result_set_state(priv->message_result, MILTER_STATE_HEADER);
+
+    encoder = milter_agent_get_encoder(MILTER_AGENT(context));
+    batch = g_string_new(NULL);
+    for (i = first_index; i <= length; i++) {
+        MilterHeader *header;
+        const gchar *value;
+        const gchar *packet = NULL;
+        gsize packet_size;
+        gboolean stop = FALSE;
+
+        header = milter_headers_get_nth_header(headers, i);
+        value = header->value;
+        if (strip_leading_space && value && value[0] == ' ')
+            value++;
+
+        milter_headers_add_header(result_headers, header->name, value);
+
+        milter_protocol_agent_set_macro_context(MILTER_PROTOCOL_AGENT(context),
+                                                MILTER_COMMAND_HEADER);
+        g_signal_emit(context, signals[STOP_ON_HEADER], 0,
+                      header->name, value, &stop);
+        if (stop) {
+            if (batch->len > 0)
+                write_packet(context, batch->str, batch->len,
+                             MILTER_SERVER_CONTEXT_STATE_HEADER);
+            stop_on_state(context, MILTER_SERVER_CONTEXT_STATE_HEADER);
+            g_string_free(batch, TRUE);
+            return TRUE;
+        }
+
+        /* write_packet() prepends macros to the first header. */
+        if (batch->len > 0) {
+            const gchar *macros_packet = NULL;
+            gsize macros_packet_size = 0;
+
+            get_macros_packet(context, MILTER_COMMAND_HEADER,
+                              &macros_packet, &macros_packet_size);
+            if (macros_packet)
+                g_string_append_len(batch, macros_packet, macros_packet_size);
+        }
+        milter_command_encoder_encode_header(MILTER_COMMAND_ENCODER(encoder),
+                                             &packet, &packet_size,
+                                             header->name, value);
+        g_string_append_len(batch, packet, packet_size);
+    }
+
+    if (batch->len > 0)
+        success = write_packet(context, batch->str, batch->len,
+                               MILTER_SERVER_CONTEXT_STATE_HEADER);
+    g_string_free(batch, TRUE);
+
+    return success;
+}
+
 gboolean
 milter_server_context_end_of_header (MilterServerContext *context)
 {
@@ -2299,6 +2531,29 @@ milter_server_context_quit (MilterServerContext *context)
                         MILTER_SERVER_CONTEXT_STATE_QUIT);
 }
 
+gboolean
+milter_server_context_quit_new_connection (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+    const gchar *packet = NULL;
+    gsize packet_size;
+    MilterEncoder *encoder;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    priv->quitted = TRUE;
+    priv->quit_new_connection = TRUE;
+
+    milter_debug("[%u] [server][send][quit-new-connection] [%s]",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context));
+    encoder = milter_agent_get_encoder(MILTER_AGENT(context));
+    milter_command_encoder_encode_quit_new_connection(
+        MILTER_COMMAND_ENCODER(encoder), &packet, &packet_size);
+
+    return write_packet(context, packet, packet_size,
+                        MILTER_SERVER_CONTEXT_STATE_QUIT);
+}
+
 
 gboolean
 milter_server_context_abort (MilterServerContext *context)
@@ -2390,18 +2645,15 @@ invalid_state (MilterServerContext *context,
 }
 
 static void
-cb_decoder_negotiate_reply (MilterDecoder *decoder,
-                            MilterOption *option,
-                            MilterMacrosRequests *macros_requests,
-                            gpointer user_data)
+receive_negotiate_reply (MilterServerContext *context,
+                         MilterOption *option,
+                         MilterMacrosRequests *macros_requests)
 {
-    MilterServerContext *context;
     MilterServerContextState state;
     MilterServerContextPrivate *priv;
     guint tag = 0;
     const gchar *name = NULL;
 
-    context = MILTER_SERVER_CONTEXT(user_data);
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
     state = priv->state;
 
@@ -2442,6 +2694,10 @@ cb_decoder_negotiate_reply (MilterDecoder *decoder,
         priv->option = milter_option_copy(option);
     }
 
+    if (priv->negotiate_reply_option)
+        g_object_unref(priv->negotiate_reply_option);
+    priv->negotiate_reply_option = milter_option_copy(option);
+
     if (state == MILTER_SERVER_CONTEXT_STATE_NEGOTIATE) {
         g_timer_stop(priv->elapsed);
         milter_debug("[%u] [server][timer][stop] [%s] <%g>",
@@ -2459,6 +2715,16 @@ cb_decoder_negotiate_reply (MilterDecoder *decoder,
     }
 }
 
+static void
+cb_decoder_negotiate_reply (MilterDecoder *decoder,
+                            MilterOption *option,
+                            MilterMacrosRequests *macros_requests,
+                            gpointer user_data)
+{
+    receive_negotiate_reply(MILTER_SERVER_CONTEXT(user_data),
+                            option, macros_requests);
+}
+
 static void
 clear_process_body_count (MilterServerContext *context)
 {
@@ -3279,7 +3545,9 @@ decoder_new (MilterAgent *agent)
 {
     MilterDecoder *decoder;
 
-    decoder = milter_reply_decoder_new();
+    decoder = milter_agent_take_cached_decoder(MILTER_TYPE_REPLY_DECODER);
+    if (!decoder)
+        decoder = milter_reply_decoder_new();
 
 #define CONNECT(name)                                                   \
     g_signal_connect(decoder, #name, G_CALLBACK(cb_decoder_ ## name),   \
@@ -3314,7 +3582,13 @@ decoder_new (MilterAgent *agent)
 static MilterEncoder *
 encoder_new (MilterAgent *agent)
 {
-    return milter_command_encoder_new();
+    MilterEncoder *encoder;
+
+    encoder = milter_agent_take_cached_encoder(MILTER_TYPE_COMMAND_ENCODER);
+    if (!encoder)
+        encoder = milter_command_encoder_new();
+
+    return encoder;
 }
 
 gboolean
@@ -3378,7 +3652,7 @@ prepare_reader (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    reader = milter_reader_io_channel_new(priv->client_channel);
+    reader = milter_reader_unix_io_channel_new(priv->client_channel);
     milter_agent_set_reader(MILTER_AGENT(context), reader);
     g_object_unref(reader);
 
@@ -3393,7 +3667,7 @@ prepare_writer (MilterServerContext *context)
 
     priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
 
-    writer = milter_writer_io_channel_new(priv->client_channel);
+    writer = milter_writer_unix_io_channel_new(priv->client_channel);
     milter_agent_set_writer(MILTER_AGENT(context), writer);
     g_object_unref(writer);
 
@@ -3577,6 +3851,93 @@ milter_server_context_establish_connection (MilterServerContext *context,
     return TRUE;
 }
 
+gboolean
+milter_server_context_reuse_connection (MilterServerContext *context,
+                                        GIOChannel *channel,
+                                        MilterOption *option,
+                                        MilterOption *negotiate_reply_option,
+                                        MilterMacrosRequests *macros_requests,
+                                        GError **error)
+{
+    MilterServerContextPrivate *priv;
+    GError *agent_error = NULL;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+
+    if (priv->client_channel) {
+        g_set_error(error,
+                    MILTER_SERVER_CONTEXT_ERROR,
+                    MILTER_SERVER_CONTEXT_ERROR_BUSY,
+                    "connection has been established already");
+        return FALSE;
+    }
+
+    priv->client_channel = g_io_channel_ref(channel);
+    if (!prepare_reader(context) || !prepare_writer(context)) {
+        dispose_client_channel(priv);
+        g_set_error(error,
+                    MILTER_SERVER_CONTEXT_ERROR,
+                    MILTER_SERVER_CONTEXT_ERROR_CONNECTION_FAILURE,
+                    "failed to prepare reused connection");
+        return FALSE;
+    }
+
+    if (!milter_agent_start(MILTER_AGENT(context), &agent_error)) {
+        dispose_client_channel(priv);
+        milter_utils_set_error_with_sub_error(
+            error,
+            MILTER_SERVER_CONTEXT_ERROR,
+            MILTER_SERVER_CONTEXT_ERROR_CONNECTION_FAILURE,
+            agent_error,
+            "failed to start reused connection");
+        return FALSE;
+    }
+
+    milter_debug("[%u] [server][reuse] [%s] %d",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context),
+                 g_io_channel_unix_get_fd(channel));
+
+    g_timer_start(priv->elapsed);
+    if (priv->option)
+        g_object_unref(priv->option);
+    priv->option = milter_option_copy(option);
+    milter_server_context_set_state(context,
+                                    MILTER_SERVER_CONTEXT_STATE_NEGOTIATE);
+    receive_negotiate_reply(context, negotiate_reply_option, macros_requests);
+
+    return priv->negotiated;
+}
+
+GIOChannel *
+milter_server_context_release_connection (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+    GIOChannel *channel;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+
+    if (!priv->quit_new_connection || !priv->client_channel)
+        return NULL;
+
+    milter_agent_shutdown(MILTER_AGENT(context));
+    if (priv->state != MILTER_SERVER_CONTEXT_STATE_QUIT) {
+        milter_debug("[%u] [server][release][unflushed] [%s]",
+                     milter_agent_get_tag(MILTER_AGENT(context)),
+                     milter_server_context_get_name(context));
+        return NULL;
+    }
+
+    channel = priv->client_channel;
+    priv->client_channel = NULL;
+    milter_debug("[%u] [server][release] [%s] %d",
+                 milter_agent_get_tag(MILTER_AGENT(context)),
+                 milter_server_context_get_name(context),
+                 g_io_channel_unix_get_fd(channel));
+
+    return channel;
+}
+
 void
 milter_server_context_set_connection_timeout (MilterServerContext *context,
                                               gdouble timeout)
@@ -3663,6 +4024,19 @@ milter_server_context_get_elapsed (MilterServerContext *context)
                            NULL);
 }
 
+gdouble
+milter_server_context_get_command_elapsed (MilterServerContext *context)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (priv->command_sent_time == 0)
+        return 0.0;
+
+    return (gdouble)(g_get_monotonic_time() - priv->command_sent_time) /
+        G_USEC_PER_SEC;
+}
+
 gboolean
 milter_server_context_is_negotiated (MilterServerContext *context)
 {
@@ -3722,6 +4096,36 @@ milter_server_context_set_quitted (MilterServerContext *context,
     MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->quitted = quitted;
 }
 
+/**
+ * milter_server_context_get_macros_packet_cache:
+ * @context: A #MilterServerContext.
+ *
+ * Returns: (transfer none) (nullable): The cache of
+ *   DEFINE_MACRO packets used by @context.
+ */
+MilterMacrosPacketCache *
+milter_server_context_get_macros_packet_cache (MilterServerContext *context)
+{
+    return MILTER_SERVER_CONTEXT_GET_PRIVATE(context)->macros_packet_cache;
+}
+
+void
+milter_server_context_set_macros_packet_cache (MilterServerContext *context,
+                                               MilterMacrosPacketCache *cache)
+{
+    MilterServerContextPrivate *priv;
+
+    priv = MILTER_SERVER_CONTEXT_GET_PRIVATE(context);
+    if (priv->macros_packet_cache == cache)
+        return;
+
+    if (priv->macros_packet_cache)
+        g_object_unref(priv->macros_packet_cache);
+    priv->macros_packet_cache = cache;
+    if (priv->macros_packet_cache)
+        g_object_ref(priv->macros_packet_cache);
+}
+
 /**
  * milter_server_context_get_message_result:
  * @context: A #MilterServerContext.
@@ -332,6 +332,50 @@ gboolean             milter_server_context_establish_connection
                                                        (MilterServerContext *context,
                                                         GError **error);
 
+/**
+ * milter_server_context_reuse_connection:
+ * @context: a %MilterServerContext.
+ * @channel: a connection released by
+ *           milter_server_context_release_connection().
+ * @option: the negotiate option for the new session.
+ * @negotiate_reply_option: the option replied by the
+ *                          client on the first negotiation.
+ * @macros_requests: the macros requested by the client on
+ *                   the first negotiation.
+ * @error: return location for an error, or %NULL.
+ *
+ * Uses an already negotiated connection instead of
+ * establishing a new connection. The client isn't asked
+ * negotiation again. Instead, @negotiate_reply_option and
+ * @macros_requests are used as the negotiate reply and
+ * #MilterServerContext::negotiate-reply is emitted.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean             milter_server_context_reuse_connection
+                                                       (MilterServerContext *context,
+                                                        GIOChannel *channel,
+                                                        MilterOption *option,
+                                                        MilterOption *negotiate_reply_option,
+                                                        MilterMacrosRequests *macros_requests,
+                                                        GError **error);
+
+/**
+ * milter_server_context_release_connection:
+ * @context: a %MilterServerContext.
+ *
+ * Takes the connection that is kept by
+ * milter_server_context_quit_new_connection(). Pending
+ * data are flushed before the connection is released.
+ *
+ * Returns: (transfer full) (nullable): the released
+ *   connection or %NULL if the connection can't be
+ *   reused. It should be unrefed by g_io_channel_unref()
+ *   when no longer needed.
+ */
+GIOChannel          *milter_server_context_release_connection
+                                                       (MilterServerContext *context);
+
 
 /**
  * milter_server_context_get_status:
@@ -500,6 +544,31 @@ gboolean             milter_server_context_header      (MilterServerContext *con
                                                         const gchar         *name,
                                                         const gchar         *value);
 
+/**
+ * milter_server_context_stream_headers:
+ * @context: a %MilterServerContext.
+ * @headers: the headers to be sent.
+ * @first_index: the index of the first header to be sent.
+ *   It starts from 1.
+ * @strip_leading_space: whether a leading space of each
+ *   value is removed.
+ *
+ * Sends headers in @headers from @first_index back-to-back
+ * by one write. It's for a milter that doesn't reply to
+ * headers. The state is transited to
+ * %MILTER_SERVER_CONTEXT_STATE_HEADER when all of them are
+ * flushed.
+ *
+ * Returns: %TRUE on success.
+ *
+ * Since: 2.2.9
+ */
+gboolean             milter_server_context_stream_headers
+                                                       (MilterServerContext *context,
+                                                        MilterHeaders       *headers,
+                                                        guint                first_index,
+                                                        gboolean             strip_leading_space);
+
 /**
  * milter_server_context_end_of_header:
  * @context: a %MilterServerContext.
@@ -551,6 +620,21 @@ gboolean             milter_server_context_end_of_message
  */
 gboolean             milter_server_context_quit        (MilterServerContext *context);
 
+/**
+ * milter_server_context_quit_new_connection:
+ * @context: a %MilterServerContext.
+ *
+ * Quits the current session but keeps the connection
+ * open for the next session (SMFIC_QUIT_NC). The client
+ * must support SMFIC_QUIT_NC. Use
+ * milter_server_context_release_connection() to take
+ * the kept connection.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean             milter_server_context_quit_new_connection
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_abort:
  * @context: a %MilterServerContext.
@@ -573,6 +657,19 @@ void                 milter_server_context_set_option  (MilterServerContext *con
 
 MilterOption        *milter_server_context_get_option  (MilterServerContext *context);
 
+/**
+ * milter_server_context_get_negotiate_reply_option:
+ * @context: a %MilterServerContext.
+ *
+ * Gets the option that is replied by the client on
+ * negotiation as is. The option isn't combined with the
+ * option sent by milter_server_context_negotiate().
+ *
+ * Returns: the negotiate reply option or %NULL.
+ */
+MilterOption        *milter_server_context_get_negotiate_reply_option
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_is_enable_step:
  * @context: a %MilterServerContext.
@@ -630,6 +727,21 @@ void                 milter_server_context_set_name    (MilterServerContext *con
  */
 gdouble              milter_server_context_get_elapsed (MilterServerContext *context);
 
+/**
+ * milter_server_context_get_command_elapsed:
+ * @context: a %MilterServerContext.
+ *
+ * Gets the elapsed time since the last command was sent.
+ *
+ * Returns: the elapsed time in seconds since the last
+ * command was sent to the milter, or 0 if no command was
+ * sent yet.
+ *
+ * Since: 2.2.9
+ */
+gdouble              milter_server_context_get_command_elapsed
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_is_negotiated:
  * @context: a %MilterServerContext.
@@ -687,6 +799,21 @@ void                 milter_server_context_set_message_result
                                                        (MilterServerContext *context,
                                                         MilterMessageResult *result);
 
+/**
+ * milter_server_context_set_macros_packet_cache:
+ * @context: a %MilterServerContext.
+ * @cache: a %MilterMacrosPacketCache.
+ *
+ * Sets the cache of DEFINE_MACRO packets. A packet for
+ * shared macros is encoded once and reused by all contexts
+ * that have the same cache and request the same symbols.
+ */
+void                 milter_server_context_set_macros_packet_cache
+                                                       (MilterServerContext *context,
+                                                        MilterMacrosPacketCache *cache);
+MilterMacrosPacketCache *milter_server_context_get_macros_packet_cache
+                                                       (MilterServerContext *context);
+
 /**
  * milter_server_context_need_reply:
  * @context: a %MilterServerContext.
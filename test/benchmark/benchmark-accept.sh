@@ -0,0 +1,105 @@
+#!/bin/sh
+#
+#  Copyright (C) 2026  milter manager project
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: benchmark-accept.sh [N_WORKERS] [N_SESSIONS] [CONCURRENCY]
+#
+# Runs milter-test-client with N_WORKERS workers twice: once with a
+# shared listening socket and once with --reuse-port. Reports how
+# accepted sessions are distributed over workers and p99 session time
+# measured by milter-test-server.
+
+base_dir=$(cd "$(dirname "$0")" && pwd)
+top_dir="$base_dir/../.."
+tool_dir="${TOOL_DIR:-$top_dir/tool}"
+
+n_workers=${1:-8}
+n_sessions=${2:-2000}
+concurrency=${3:-64}
+port=${PORT:-10029}
+spec="inet:${port}@127.0.0.1"
+
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+run_test_client()
+{
+    MILTER_LOG_LEVEL=debug MILTER_LOG_ITEM=pid \
+        "$tool_dir/milter-test-client" \
+        --connection-spec="$spec" \
+        --n-workers="$n_workers" \
+        "$@" > "$work_dir/client.log" 2>&1 &
+    client_pid=$!
+    sleep 1
+}
+
+run_test_servers()
+{
+    i=0
+    while [ $i -lt "$n_sessions" ]; do
+        j=0
+        while [ $j -lt "$concurrency" ] && [ $i -lt "$n_sessions" ]; do
+            "$tool_dir/milter-test-server" --connection-spec="$spec" \
+                2>/dev/null | grep '^elapsed-time:' &
+            i=$((i + 1))
+            j=$((j + 1))
+        done
+        wait_test_servers
+    done
+}
+
+wait_test_servers()
+{
+    for pid in $(jobs -p); do
+        [ "$pid" = "$client_pid" ] && continue
+        wait "$pid"
+    done
+}
+
+report()
+{
+    label=$1
+    echo "$label:"
+    sort -n -k 2 "$work_dir/elapsed.log" | \
+        awk '{times[NR] = $2}
+             END {
+               if (NR == 0) exit;
+               p50 = int(NR * 0.50); if (p50 < 1) p50 = 1;
+               p99 = int(NR * 0.99); if (p99 < 1) p99 = 1;
+               printf("  sessions: %d\n", NR);
+               printf("  p50: %g seconds\n", times[p50]);
+               printf("  p99: %g seconds\n", times[p99]);
+             }'
+    echo "  accepts per worker:"
+    grep '\[client\]\[accept\]' "$work_dir/client.log" | \
+        sed -e 's/^.*\[\([0-9][0-9]*\)\].*\[client\]\[accept\].*$/\1/' | \
+        sort | uniq -c | sort -rn | \
+        awk '{printf("    %s: %d\n", $2, $1)}'
+}
+
+benchmark()
+{
+    label=$1
+    shift
+    run_test_client "$@"
+    run_test_servers > "$work_dir/elapsed.log"
+    kill -TERM "$client_pid"
+    wait "$client_pid" 2>/dev/null
+    report "$label"
+}
+
+benchmark "shared"
+benchmark "reuse-port" --reuse-port
@@ -0,0 +1,190 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <milter/core.h>
+
+static gint n_iterations = 10000;
+static gint chunk_size = 0;
+
+static const GOptionEntry option_entries[] =
+{
+    {"n-iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+     "Replay each stream N times (default: 10000)", "N"},
+    {"chunk-size", 'c', 0, G_OPTION_ARG_INT, &chunk_size,
+     "Feed the decoder SIZE bytes per read. "
+     "0 feeds the whole stream at once. (default: 0)", "SIZE"},
+    {NULL}
+};
+
+static gboolean
+is_hex_dump_line (const gchar *line)
+{
+    gint i;
+
+    for (i = 0; i < 4; i++) {
+        if (!g_ascii_isxdigit(line[i]))
+            return FALSE;
+    }
+    return line[4] == ' ' && line[5] == ' ';
+}
+
+/*
+ * Packet logs in data/packet/ have tshark's hex dumps. Packets from
+ * MTA aren't indented and packets from milter are
+ * indented. We only need packets from MTA.
+ */
+static gboolean
+load_stream (const gchar *path, GString *stream, guint *n_packets,
+             GError **error)
+{
+    gchar *content;
+    gchar **lines;
+    gint i;
+    gsize start;
+
+    if (!g_file_get_contents(path, &content, NULL, error))
+        return FALSE;
+
+    start = stream->len;
+    lines = g_strsplit(content, "\n", -1);
+    g_free(content);
+    for (i = 0; lines[i]; i++) {
+        const gchar *bytes;
+        gint j;
+
+        if (!is_hex_dump_line(lines[i]))
+            continue;
+        bytes = lines[i] + 6;
+        for (j = 0; j < 16; j++) {
+            gint high, low;
+
+            if (!bytes[0] || !bytes[1] || bytes[2] != ' ')
+                break;
+            high = g_ascii_xdigit_value(bytes[0]);
+            low = g_ascii_xdigit_value(bytes[1]);
+            if (high < 0 || low < 0)
+                break;
+            g_string_append_c(stream, (gchar)((high << 4) | low));
+            bytes += 3;
+        }
+    }
+    g_strfreev(lines);
+
+    while (start + sizeof(guint32) <= stream->len) {
+        guint32 length;
+
+        memcpy(&length, stream->str + start, sizeof(length));
+        start += sizeof(length) + g_ntohl(length);
+        (*n_packets)++;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+replay (MilterDecoder *decoder, GString *stream, GError **error)
+{
+    gsize offset;
+    gsize size;
+
+    size = chunk_size > 0 ? (gsize)chunk_size : stream->len;
+    for (offset = 0; offset < stream->len; offset += size) {
+        if (!milter_decoder_decode(decoder,
+                                   stream->str + offset,
+                                   MIN(size, stream->len - offset),
+                                   error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *option_context;
+    GError *error = NULL;
+    GString *stream;
+    MilterDecoder *decoder;
+    GTimer *timer;
+    guint n_packets = 0;
+    gdouble elapsed;
+    gint i;
+
+    milter_init();
+
+    option_context = g_option_context_new("LOG_FILE...");
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(option_context);
+
+    stream = g_string_new(NULL);
+    for (i = 1; i < argc; i++) {
+        if (!load_stream(argv[i], stream, &n_packets, &error)) {
+            g_print("%s\n", error->message);
+            g_error_free(error);
+            g_string_free(stream, TRUE);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    decoder = milter_command_decoder_new();
+    timer = g_timer_new();
+    for (i = 0; i < n_iterations; i++) {
+        if (!replay(decoder, stream, &error)) {
+            g_print("%s\n", error->message);
+            g_error_free(error);
+            break;
+        }
+    }
+    g_timer_stop(timer);
+    elapsed = g_timer_elapsed(timer, NULL);
+
+    g_print("streams:     %d\n", argc - 1);
+    g_print("bytes:       %" G_GSIZE_FORMAT "\n", stream->len);
+    g_print("packets:     %u\n", n_packets);
+    g_print("chunk size:  %d\n", chunk_size);
+    g_print("iterations:  %d\n", i);
+    g_print("elapsed:     %.3fs\n", elapsed);
+    if (elapsed > 0)
+        g_print("packets/sec: %.0f\n", (n_packets * i) / elapsed);
+
+    g_timer_destroy(timer);
+    g_object_unref(decoder);
+    g_string_free(stream, TRUE);
+
+    milter_quit();
+
+    return i == n_iterations ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -0,0 +1,170 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include <milter/core.h>
+
+static gint n_iterations = 1000;
+static gint n_headers = 500;
+static gint n_children = 8;
+
+static const GOptionEntry option_entries[] =
+{
+    {"n-iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+     "Process the message N times (default: 1000)", "N"},
+    {"n-headers", 'H', 0, G_OPTION_ARG_INT, &n_headers,
+     "Use a message that has N headers (default: 500)", "N"},
+    {"n-children", 'C', 0, G_OPTION_ARG_INT, &n_children,
+     "Pass headers to N child milters (default: 8)", "N"},
+    {NULL}
+};
+
+/* Received, ARC and DKIM headers are repeated like a mail that
+ * passed many hops. */
+static MilterHeaders *
+create_original_headers (void)
+{
+    static const gchar *names[] = {
+        "Received",
+        "ARC-Seal",
+        "ARC-Message-Signature",
+        "ARC-Authentication-Results",
+        "DKIM-Signature"
+    };
+    MilterHeaders *headers;
+    gint i;
+
+    headers = milter_headers_new();
+    milter_headers_append_header(headers, "From", "<from@example.com>");
+    milter_headers_append_header(headers, "To", "<to@example.com>");
+    milter_headers_append_header(headers, "Subject", "Hello");
+    for (i = 3; i < n_headers; i++) {
+        gchar *value;
+
+        value = g_strdup_printf("from mx%d.example.com", i);
+        milter_headers_append_header(headers,
+                                     names[i % G_N_ELEMENTS(names)],
+                                     value);
+        g_free(value);
+    }
+
+    return headers;
+}
+
+static void
+count_operation (MilterHeadersDiffType type, guint index,
+                 const gchar *name, const gchar *value,
+                 gpointer user_data)
+{
+    guint *n_operations = user_data;
+
+    (*n_operations)++;
+}
+
+/* Each child reads all headers by index like
+ * send_next_header_to_child() and changes some of them at
+ * end-of-message like milters that add a score, rewrite the subject
+ * and remove a signature. */
+static guint
+process (MilterHeaders *original_headers)
+{
+    MilterHeaders *headers;
+    guint n_operations = 0;
+    gint i;
+
+    headers = milter_headers_copy(original_headers);
+    for (i = 0; i < n_children; i++) {
+        guint j, length;
+        gchar *value;
+
+        length = milter_headers_length(original_headers);
+        for (j = 1; j <= length; j++) {
+            milter_headers_get_nth_header(original_headers, j);
+        }
+
+        value = g_strdup_printf("%d", i);
+        milter_headers_add_header(headers, "X-Score", value);
+        milter_headers_change_header(headers, "Received", n_headers / 10 + i,
+                                     value);
+        g_free(value);
+        milter_headers_change_header(headers, "Subject", 1, "[SPAM] Hello");
+        milter_headers_delete_header(headers, "DKIM-Signature", 1);
+    }
+    milter_headers_diff(original_headers, headers,
+                        count_operation, &n_operations);
+    g_object_unref(headers);
+
+    return n_operations;
+}
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *option_context;
+    GError *error = NULL;
+    MilterHeaders *original_headers;
+    GTimer *timer;
+    gdouble elapsed;
+    guint n_operations = 0;
+    gint i;
+
+    milter_init();
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(option_context);
+
+    original_headers = create_original_headers();
+    timer = g_timer_new();
+    for (i = 0; i < n_iterations; i++) {
+        n_operations = process(original_headers);
+    }
+    g_timer_stop(timer);
+    elapsed = g_timer_elapsed(timer, NULL);
+
+    g_print("headers:      %u\n", milter_headers_length(original_headers));
+    g_print("children:     %d\n", n_children);
+    g_print("operations:   %u\n", n_operations);
+    g_print("iterations:   %d\n", n_iterations);
+    g_print("elapsed:      %.3fs\n", elapsed);
+    if (elapsed > 0)
+        g_print("messages/sec: %.0f\n", n_iterations / elapsed);
+
+    g_timer_destroy(timer);
+    g_object_unref(original_headers);
+
+    milter_quit();
+
+    return EXIT_SUCCESS;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
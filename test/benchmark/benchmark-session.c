@@ -0,0 +1,219 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+
+#include <milter/core.h>
+#include <milter/server.h>
+
+static gint n_sessions = 10000;
+static gint n_children = 8;
+static gint n_headers = 30;
+
+static const GOptionEntry option_entries[] =
+{
+    {"n-sessions", 'n', 0, G_OPTION_ARG_INT, &n_sessions,
+     "Run N sessions (default: 10000)", "N"},
+    {"n-children", 'C', 0, G_OPTION_ARG_INT, &n_children,
+     "Create N child milters per session (default: 8)", "N"},
+    {"n-headers", 'H', 0, G_OPTION_ARG_INT, &n_headers,
+     "Receive N headers per session (default: 30)", "N"},
+    {NULL}
+};
+
+/*
+ * Allocator calls are counted by wrapping glibc's
+ * allocator. Libraries that are linked to this program
+ * use these wrappers too.
+ */
+#ifdef __GLIBC__
+#  define HAVE_ALLOCATOR_COUNTER 1
+
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t n_members, size_t size);
+extern void *__libc_realloc (void *memory, size_t size);
+extern void  __libc_free    (void *memory);
+
+static guint64 n_allocator_calls = 0;
+
+void *
+malloc (size_t size)
+{
+    n_allocator_calls++;
+    return __libc_malloc(size);
+}
+
+void *
+calloc (size_t n_members, size_t size)
+{
+    n_allocator_calls++;
+    return __libc_calloc(n_members, size);
+}
+
+void *
+realloc (void *memory, size_t size)
+{
+    n_allocator_calls++;
+    return __libc_realloc(memory, size);
+}
+
+void
+free (void *memory)
+{
+    if (memory)
+        n_allocator_calls++;
+    __libc_free(memory);
+}
+#endif
+
+/* Each child receives a helo and the headers, reads a reply
+ * into its decoder and is freed at the end of the session
+ * like MilterManagerChildren does. */
+static void
+run_session (void)
+{
+    MilterServerContext **contexts;
+    MilterHeaders *original_headers;
+    MilterHeaders *headers;
+    gint i;
+
+    original_headers = milter_headers_new();
+    for (i = 0; i < n_headers; i++) {
+        gchar value[64];
+
+        g_snprintf(value, sizeof(value), "from mx%d.example.com", i);
+        milter_headers_append_header(original_headers, "Received", value);
+    }
+    headers = milter_headers_copy(original_headers);
+    milter_headers_change_header(headers, "Received", 1, "changed");
+
+    contexts = g_new(MilterServerContext *, n_children);
+    for (i = 0; i < n_children; i++) {
+        MilterAgent *agent;
+        MilterCommandEncoder *encoder;
+        const gchar *packet;
+        gsize packet_size;
+        guint j, length;
+
+        contexts[i] = milter_server_context_new();
+        agent = MILTER_AGENT(contexts[i]);
+        encoder = MILTER_COMMAND_ENCODER(milter_agent_get_encoder(agent));
+        milter_command_encoder_encode_helo(encoder, &packet, &packet_size,
+                                           "mx.example.com");
+        length = milter_headers_length(original_headers);
+        for (j = 1; j <= length; j++) {
+            MilterHeader *header;
+
+            header = milter_headers_get_nth_header(original_headers, j);
+            milter_command_encoder_encode_header(encoder,
+                                                 &packet, &packet_size,
+                                                 header->name,
+                                                 header->value);
+        }
+        milter_decoder_reserve_buffer(milter_agent_get_decoder(agent), 4096);
+    }
+
+    for (i = 0; i < n_children; i++) {
+        g_object_unref(contexts[i]);
+    }
+    g_free(contexts);
+    g_object_unref(headers);
+    g_object_unref(original_headers);
+}
+
+static void
+run_sessions (const gchar *label)
+{
+    GTimer *timer;
+    gdouble elapsed;
+    gint i;
+#ifdef HAVE_ALLOCATOR_COUNTER
+    guint64 n_allocator_calls_before;
+#endif
+
+    /* Warm up caches. */
+    run_session();
+
+#ifdef HAVE_ALLOCATOR_COUNTER
+    n_allocator_calls_before = n_allocator_calls;
+#endif
+    timer = g_timer_new();
+    for (i = 0; i < n_sessions; i++) {
+        run_session();
+    }
+    g_timer_stop(timer);
+    elapsed = g_timer_elapsed(timer, NULL);
+
+    g_print("%s:\n", label);
+    g_print("  elapsed:                   %.3fs\n", elapsed);
+    if (elapsed > 0)
+        g_print("  sessions/sec:              %.0f\n", n_sessions / elapsed);
+#ifdef HAVE_ALLOCATOR_COUNTER
+    if (n_sessions > 0)
+        g_print("  allocator calls/session:   %.1f\n",
+                (gdouble)(n_allocator_calls - n_allocator_calls_before) /
+                n_sessions);
+#endif
+
+    g_timer_destroy(timer);
+}
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *option_context;
+    GError *error = NULL;
+    guint codec_cache_size;
+
+    milter_init();
+    milter_server_init();
+
+    option_context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(option_context, option_entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(option_context);
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(option_context);
+
+    g_print("children:     %d\n", n_children);
+    g_print("headers:      %d\n", n_headers);
+    g_print("sessions:     %d\n", n_sessions);
+
+    codec_cache_size = milter_agent_get_codec_cache_size();
+    milter_agent_set_codec_cache_size(0);
+    run_sessions("without codec cache");
+    milter_agent_set_codec_cache_size(codec_cache_size);
+    run_sessions("with codec cache");
+
+    milter_server_quit();
+    milter_quit();
+
+    return EXIT_SUCCESS;
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
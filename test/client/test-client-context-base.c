@@ -36,6 +36,7 @@
 void test_tag (void);
 void test_socket_address (void);
 void test_n_processing_sessions (void);
+void test_n_total_processing_sessions (void);
 void test_packet_buffer_size (void);
 void test_quarantine_reason (void);
 void test_mail_transaction_shelf (void);
@@ -150,6 +151,13 @@ test_n_processing_sessions (void)
         0, milter_client_context_get_n_processing_sessions(context));
 }
 
+void
+test_n_total_processing_sessions (void)
+{
+    cut_assert_equal_uint(
+        0, milter_client_context_get_n_total_processing_sessions(context));
+}
+
 void
 test_packet_buffer_size (void)
 {
@@ -36,6 +36,8 @@
 void test_progress (void);
 void test_quarantine (void);
 void test_negotiate (void);
+void test_batch_writes (void);
+void test_batch_writes_quit (void);
 
 static MilterEventLoop *loop;
 
@@ -53,6 +55,8 @@ static gchar *quarantine_reason;
 static MilterMacrosRequests *macros_requests;
 static MilterOption *option;
 
+static GError *agent_error;
+
 static MilterStatus
 cb_negotiate (MilterClientContext *context, MilterOption *_option,
               MilterMacrosRequests *_macros_requests, gpointer user_data)
@@ -175,6 +179,14 @@ setup_signals (MilterClientContext *context)
 #undef CONNECT
 }
 
+static void
+cb_error (MilterErrorEmittable *emittable, GError *error, gpointer user_data)
+{
+    if (agent_error)
+        g_error_free(agent_error);
+    agent_error = g_error_copy(error);
+}
+
 void
 cut_setup (void)
 {
@@ -201,6 +213,9 @@ cut_setup (void)
     quarantine_reason = NULL;
     option = NULL;
     macros_requests = NULL;
+
+    agent_error = NULL;
+    g_signal_connect(context, "error", G_CALLBACK(cb_error), NULL);
 }
 
 void
@@ -229,6 +244,9 @@ cut_teardown (void)
         g_object_unref(option);
     if (macros_requests)
         g_object_unref(macros_requests);
+
+    if (agent_error)
+        g_error_free(agent_error);
 }
 
 typedef void (*HookFunction) (void);
@@ -324,6 +342,75 @@ test_negotiate (void)
                             actual_data->str, actual_data->len);
 }
 
+void
+test_batch_writes (void)
+{
+    GString *data;
+    GString *actual_data;
+    const gchar *packet;
+    gsize packet_size;
+    const gchar *commands;
+    gsize commands_size;
+    const gchar *expected_replies;
+    gsize expected_replies_size;
+
+    data = g_string_new(NULL);
+    milter_command_encoder_encode_helo(command_encoder,
+                                       &packet, &packet_size,
+                                       "delian");
+    g_string_append_len(data, packet, packet_size);
+    milter_command_encoder_encode_envelope_from(command_encoder,
+                                                &packet, &packet_size,
+                                                "<kou@example.com>");
+    g_string_append_len(data, packet, packet_size);
+    commands_size = data->len;
+    commands = cut_take_string(g_string_free(data, FALSE));
+    gcut_assert_error(feed(commands, commands_size));
+
+    data = g_string_new(NULL);
+    milter_reply_encoder_encode_continue(reply_encoder, &packet, &packet_size);
+    g_string_append_len(data, packet, packet_size);
+    g_string_append_len(data, packet, packet_size);
+    expected_replies_size = data->len;
+    expected_replies = cut_take_string(g_string_free(data, FALSE));
+
+    actual_data = gcut_string_io_channel_get_string(channel);
+    cut_assert_equal_memory(expected_replies, expected_replies_size,
+                            actual_data->str, actual_data->len);
+    cut_assert_equal_uint(
+        2, milter_agent_get_n_written_packets(MILTER_AGENT(context)));
+    cut_assert_equal_uint(1, milter_agent_get_n_writes(MILTER_AGENT(context)));
+}
+
+void
+test_batch_writes_quit (void)
+{
+    GString *data;
+    GString *actual_data;
+    const gchar *packet;
+    gsize packet_size;
+    const gchar *commands;
+    gsize commands_size;
+
+    data = g_string_new(NULL);
+    milter_command_encoder_encode_helo(command_encoder,
+                                       &packet, &packet_size,
+                                       "delian");
+    g_string_append_len(data, packet, packet_size);
+    milter_command_encoder_encode_quit(command_encoder,
+                                       &packet, &packet_size);
+    g_string_append_len(data, packet, packet_size);
+    commands_size = data->len;
+    commands = cut_take_string(g_string_free(data, FALSE));
+    gcut_assert_error(feed(commands, commands_size));
+    gcut_assert_error(agent_error);
+
+    milter_reply_encoder_encode_continue(reply_encoder, &packet, &packet_size);
+    actual_data = gcut_string_io_channel_get_string(channel);
+    cut_assert_equal_memory(packet, packet_size,
+                            actual_data->str, actual_data->len);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -22,12 +22,14 @@
 #endif
 
 #include <errno.h>
+#include <stdlib.h>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <grp.h>
 
@@ -70,9 +72,14 @@ void test_need_maintain_no_processing_sessions (void);
 void test_need_maintain_no_processing_sessions_below_processed_sessions (void);
 void test_need_maintain_no_processing_sessions_no_interval (void);
 void test_n_workers (void);
+void test_n_event_loop_threads (void);
+void test_event_loop_threads_usable (void);
 void test_custom_fork (void);
 void test_default_packet_buffer_size (void);
 void test_worker_id (void);
+void test_n_sessions (void);
+void test_worker_data_fork (void);
+void test_worker_exited (void);
 void test_max_pending_finished_sessions (void);
 
 static MilterEventLoop *loop;
@@ -1051,6 +1058,22 @@ test_n_workers (void)
         10, milter_client_get_n_workers(client));
 }
 
+void
+test_n_event_loop_threads (void)
+{
+    cut_assert_equal_uint(
+        0, milter_client_get_n_event_loop_threads(client));
+    milter_client_set_n_event_loop_threads(client, 4);
+    cut_assert_equal_uint(
+        4, milter_client_get_n_event_loop_threads(client));
+}
+
+void
+test_event_loop_threads_usable (void)
+{
+    cut_assert_true(milter_client_is_event_loop_threads_usable(client));
+}
+
 static GPid
 worker_fork (MilterClient *loop)
 {
@@ -1093,6 +1116,80 @@ test_worker_id (void)
     cut_assert_equal_uint(0, milter_client_get_worker_id(client));
 }
 
+void
+test_n_sessions (void)
+{
+    milter_client_session_started(client);
+    milter_client_session_started(client);
+    milter_client_session_finished(client);
+
+    cut_assert_equal_uint(1, milter_client_get_n_processing_sessions(client));
+    cut_assert_equal_uint(1, milter_client_get_n_processed_sessions(client));
+    cut_assert_equal_uint(
+        1, milter_client_get_n_total_processing_sessions(client));
+    cut_assert_equal_uint(
+        1, milter_client_get_n_total_processed_sessions(client));
+    cut_assert_equal_uint(
+        1, milter_client_get_worker_n_processing_sessions(client, 0));
+    cut_assert_equal_uint(
+        0, milter_client_get_worker_n_processing_sessions(client, 1));
+}
+
+void
+test_worker_data_fork (void)
+{
+    gint *data;
+    GPid pid;
+    gint status;
+
+    milter_client_set_n_workers(client, 2);
+    milter_client_set_worker_data_size(client, sizeof(gint));
+    data = milter_client_get_worker_data(client, 2);
+    cut_assert_not_null(data);
+    cut_assert_equal_int(0, *data);
+    cut_assert_null(milter_client_get_worker_data(client, 3));
+
+    pid = fork();
+    if (pid == 0) {
+        *data = 29;
+        milter_client_session_started(client);
+        milter_client_session_started(client);
+        milter_client_session_finished(client);
+        _exit(EXIT_SUCCESS);
+    }
+    cut_assert_operator_int(0, <, pid);
+    cut_assert_equal_int(pid, waitpid(pid, &status, 0));
+    cut_assert_true(WIFEXITED(status));
+
+    cut_assert_equal_int(29, *data);
+    cut_assert_equal_uint(0, milter_client_get_n_processing_sessions(client));
+    cut_assert_equal_uint(
+        1, milter_client_get_worker_n_processing_sessions(client, 0));
+    cut_assert_equal_uint(
+        1, milter_client_get_worker_n_processed_sessions(client, 0));
+    cut_assert_equal_uint(
+        1, milter_client_get_n_total_processed_sessions(client));
+}
+
+void
+test_worker_exited (void)
+{
+    milter_client_set_worker_data_size(client, sizeof(gint));
+    cut_assert_not_null(milter_client_get_worker_data(client, 0));
+
+    milter_client_session_started(client);
+    milter_client_session_started(client);
+    milter_client_session_finished(client);
+    cut_assert_equal_uint(
+        1, milter_client_get_worker_n_processing_sessions(client, 0));
+
+    g_signal_emit_by_name(client, "worker-exited", 0);
+    cut_assert_equal_uint(
+        0, milter_client_get_worker_n_processing_sessions(client, 0));
+    cut_assert_equal_uint(
+        1, milter_client_get_worker_n_processed_sessions(client, 0));
+}
+
 void
 test_max_pending_finished_sessions (void)
 {
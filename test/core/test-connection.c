@@ -49,6 +49,7 @@ void test_listen (void);
 void test_listen_exist_socket (void);
 void test_listen_remove_failure (void);
 void test_listen_nonexistent_path (void);
+void test_listen_reuse_port (void);
 
 static struct sockaddr *actual_address;
 static socklen_t actual_address_size;
@@ -618,6 +619,51 @@ test_listen_nonexistent_path (void)
     cut_assert_equal_int(0, address_size);
 }
 
+void
+test_listen_reuse_port (void)
+{
+    GIOChannel *channel, *reuse_port_channel;
+    struct sockaddr_in address_in;
+    socklen_t address_in_size = sizeof(address_in);
+    const gchar *spec;
+    GError *error = NULL;
+
+#ifndef SO_REUSEPORT
+    cut_omit("SO_REUSEPORT isn't supported.");
+#endif
+
+    channel = milter_connection_listen_full("inet:0@127.0.0.1", 5,
+                                            NULL, NULL,
+                                            FALSE, TRUE,
+                                            &error);
+    gcut_assert_error(error);
+    cut_assert_not_null(channel);
+    if (getsockname(g_io_channel_unix_get_fd(channel),
+                    (struct sockaddr *)&address_in,
+                    &address_in_size) == -1)
+        cut_assert_errno();
+
+    spec = cut_take_printf("inet:%u@127.0.0.1", ntohs(address_in.sin_port));
+    reuse_port_channel = milter_connection_listen_full(spec, 5,
+                                                       NULL, NULL,
+                                                       FALSE, TRUE,
+                                                       &error);
+    gcut_assert_error(error);
+    cut_assert_not_null(reuse_port_channel);
+    g_io_channel_unref(reuse_port_channel);
+
+    expected_error = g_error_new(MILTER_CONNECTION_ERROR,
+                                 MILTER_CONNECTION_ERROR_BIND_FAILURE,
+                                 "failed to bind(): %s: %s",
+                                 spec,
+                                 g_strerror(EADDRINUSE));
+    cut_assert_null(milter_connection_listen(spec, 5, NULL, NULL,
+                                             FALSE, &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+
+    g_io_channel_unref(channel);
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
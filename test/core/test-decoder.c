@@ -38,6 +38,9 @@ void test_end_decode_immediately (void);
 void test_end_decode_in_command_length_decoding (void);
 void test_end_decode_in_command_content_decoding (void);
 void test_tag (void);
+void test_decode_commands_in_split_chunks (void);
+void test_decode_reserved_buffer (void);
+void test_reset (void);
 
 static MilterDecoder *decoder;
 static GString *buffer;
@@ -45,6 +48,8 @@ static GString *buffer;
 static GError *expected_error;
 static GError *actual_error;
 
+static gint n_abort_received;
+
 void
 cut_setup (void)
 {
@@ -53,6 +58,8 @@ cut_setup (void)
     expected_error = NULL;
     actual_error = NULL;
 
+    n_abort_received = 0;
+
     buffer = g_string_new(NULL);
 }
 
@@ -128,6 +135,71 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_decoder_get_tag(decoder));
 }
 
+static void
+cb_abort (MilterCommandDecoder *decoder, gpointer user_data)
+{
+    n_abort_received++;
+}
+
+void
+test_decode_commands_in_split_chunks (void)
+{
+    g_signal_connect(decoder, "abort", G_CALLBACK(cb_abort), NULL);
+
+    g_string_append_len(buffer, "\0\0\0\1A" "\0\0\0\1A" "\0\0\0\1A", 15);
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str, 7,
+                                          &actual_error));
+    cut_assert_equal_int(1, n_abort_received);
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str + 7, 5,
+                                          &actual_error));
+    cut_assert_equal_int(2, n_abort_received);
+    cut_assert_true(milter_decoder_decode(decoder, buffer->str + 12, 3,
+                                          &actual_error));
+    cut_assert_equal_int(3, n_abort_received);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+}
+
+void
+test_decode_reserved_buffer (void)
+{
+    gchar *reserved_buffer;
+
+    g_signal_connect(decoder, "abort", G_CALLBACK(cb_abort), NULL);
+
+    reserved_buffer = milter_decoder_reserve_buffer(decoder, 7);
+    memcpy(reserved_buffer, "\0\0\0\1A" "\0\0", 7);
+    cut_assert_true(milter_decoder_decode(decoder, reserved_buffer, 7,
+                                          &actual_error));
+    cut_assert_equal_int(1, n_abort_received);
+
+    reserved_buffer = milter_decoder_reserve_buffer(decoder, 8192);
+    memcpy(reserved_buffer, "\0\1A" "\0\0\0\1A", 8);
+    cut_assert_true(milter_decoder_decode(decoder, reserved_buffer, 8,
+                                          &actual_error));
+    cut_assert_equal_int(3, n_abort_received);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+}
+
+void
+test_reset (void)
+{
+    g_signal_connect(decoder, "abort", G_CALLBACK(cb_abort), NULL);
+
+    milter_decoder_set_tag(decoder, 29);
+    cut_assert_true(milter_decoder_decode(decoder, "\0\0\0\1A" "\0\0", 7,
+                                          &actual_error));
+    cut_assert_equal_int(1, n_abort_received);
+
+    milter_decoder_reset(decoder);
+    cut_assert_equal_uint(0, milter_decoder_get_tag(decoder));
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+
+    cut_assert_true(milter_decoder_decode(decoder, "\0\0\0\1A", 5,
+                                          &actual_error));
+    cut_assert_equal_int(2, n_abort_received);
+    cut_assert_true(milter_decoder_end_decode(decoder, &actual_error));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
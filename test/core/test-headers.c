@@ -42,15 +42,18 @@ void test_insert_header (void);
 void test_change_header (void);
 void test_delete_header_with_change_header (void);
 void test_delete_header (void);
+void test_diff (void);
 
 static MilterHeaders *headers;
 static GList *expected_list;
+static GString *diff;
 
 void
 setup (void)
 {
     headers = milter_headers_new();
     expected_list = NULL;
+    diff = g_string_new(NULL);
 }
 
 void
@@ -62,6 +65,8 @@ teardown (void)
         g_list_foreach(expected_list, (GFunc)milter_header_free, NULL);
         g_list_free(expected_list);
     }
+    if (diff)
+        g_string_free(diff, TRUE);
 }
 
 void
@@ -535,6 +540,55 @@ test_delete_header (void)
             NULL);
 }
 
+static void
+cb_diff (MilterHeadersDiffType type, guint index,
+         const gchar *name, const gchar *value, gpointer user_data)
+{
+    const gchar *type_name = NULL;
+
+    switch (type) {
+    case MILTER_HEADERS_DIFF_INSERT:
+        type_name = "insert";
+        break;
+    case MILTER_HEADERS_DIFF_CHANGE:
+        type_name = "change";
+        break;
+    case MILTER_HEADERS_DIFF_DELETE:
+        type_name = "delete";
+        break;
+    }
+    g_string_append_printf(diff, "%s:%u:<%s>:<%s>\n",
+                           type_name, index, name, value ? value : "(null)");
+}
+
+void
+test_diff (void)
+{
+    MilterHeaders *changed_headers;
+
+    milter_headers_append_header(headers, "From", "from@example.com");
+    milter_headers_append_header(headers, "Received", "from mx1");
+    milter_headers_append_header(headers, "Received", "from mx2");
+    milter_headers_append_header(headers, "Subject", "Hello");
+    milter_headers_append_header(headers, "X-Deleted", "deleted");
+
+    changed_headers = milter_headers_copy(headers);
+    gcut_take_object(G_OBJECT(changed_headers));
+    milter_headers_insert_header(changed_headers, 0, "X-Top", "top");
+    milter_headers_change_header(changed_headers, "Received", 2, "from mx3");
+    milter_headers_change_header(changed_headers, "Subject", 1, "[SPAM] Hello");
+    milter_headers_delete_header(changed_headers, "X-Deleted", 1);
+    milter_headers_append_header(changed_headers, "X-Bottom", "bottom");
+
+    milter_headers_diff(headers, changed_headers, cb_diff, NULL);
+    cut_assert_equal_string("insert:0:<X-Top>:<top>\n"
+                            "change:2:<Received>:<from mx3>\n"
+                            "change:1:<Subject>:<[SPAM] Hello>\n"
+                            "insert:5:<X-Bottom>:<bottom>\n"
+                            "delete:1:<X-Deleted>:<(null)>\n",
+                            diff->str);
+}
+
 
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
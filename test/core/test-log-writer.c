@@ -0,0 +1,258 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gcutter.h>
+
+#include <glib/gstdio.h>
+
+#define shutdown inet_shutdown
+#include <milter-test-utils.h>
+#include <milter/core/milter-log-writer.h>
+#undef shutdown
+
+void test_write (void);
+void test_write_log (void);
+void test_reopen (void);
+void test_drop (void);
+void test_fork (void);
+void test_flush_all (void);
+
+static MilterLogWriter *writer;
+static gchar *tmp_dir;
+static const gchar *path;
+static GError *error;
+
+void
+setup (void)
+{
+    writer = milter_log_writer_new();
+    error = NULL;
+
+    tmp_dir = g_build_filename(milter_test_get_base_dir(),
+                               "tmp",
+                               NULL);
+    cut_remove_path(tmp_dir, NULL);
+    if (g_mkdir_with_parents(tmp_dir, 0700) == -1)
+        cut_assert_errno();
+
+    path = cut_build_path(tmp_dir, "output.log", NULL);
+}
+
+void
+teardown (void)
+{
+    if (writer)
+        g_object_unref(writer);
+
+    if (error)
+        g_error_free(error);
+
+    if (tmp_dir) {
+        cut_remove_path(tmp_dir, NULL);
+        g_free(tmp_dir);
+    }
+}
+
+static void
+wait_child (pid_t pid)
+{
+    gint status;
+
+    if (waitpid(pid, &status, 0) == -1)
+        cut_assert_errno();
+    cut_assert_true(WIFEXITED(status));
+    cut_assert_equal_int(EXIT_SUCCESS, WEXITSTATUS(status));
+}
+
+static const gchar *
+read_log (const gchar *log_path)
+{
+    gchar *content = NULL;
+
+    g_file_get_contents(log_path, &content, NULL, &error);
+    gcut_assert_error(error);
+
+    return cut_take_string(content);
+}
+
+void
+test_write (void)
+{
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+    cut_assert_equal_string(path, milter_log_writer_get_path(writer));
+
+    cut_assert_true(milter_log_writer_write(writer, "first\n", -1));
+    cut_assert_true(milter_log_writer_write(writer, "second\nthird", 7));
+    milter_log_writer_flush(writer);
+
+    cut_assert_equal_string("first\nsecond\n", read_log(path));
+}
+
+static gboolean
+write_log (const gchar *domain,
+           MilterLogLevelFlags level,
+           MilterLogItemFlags items,
+           const gchar *file,
+           guint line,
+           const gchar *function,
+           gint64 timestamp,
+           const gchar *format,
+           ...)
+{
+    gboolean written;
+    va_list args;
+
+    va_start(args, format);
+    written = milter_log_writer_write_log_va_list(writer, domain, level,
+                                                  items, FALSE,
+                                                  file, line, function,
+                                                  timestamp, format, args);
+    va_end(args);
+
+    return written;
+}
+
+void
+test_write_log (void)
+{
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+
+    cut_assert_true(write_log("domain", MILTER_LOG_LEVEL_INFO,
+                              MILTER_LOG_ITEM_LEVEL |
+                              MILTER_LOG_ITEM_DOMAIN |
+                              MILTER_LOG_ITEM_TIME |
+                              MILTER_LOG_ITEM_LOCATION,
+                              "file.c", 29, "function",
+                              G_GINT64_CONSTANT(1234567890) * G_USEC_PER_SEC +
+                              123456,
+                              "message: <%d>", 29));
+    cut_assert_true(write_log(NULL, MILTER_LOG_LEVEL_ERROR,
+                              MILTER_LOG_ITEM_LEVEL,
+                              NULL, 0, NULL,
+                              0,
+                              "%s", "no location"));
+    milter_log_writer_flush(writer);
+
+    cut_assert_equal_string("[info][domain][2009-02-13T23:31:30.123456Z] "
+                            "file.c:29: function(): message: <29>\n"
+                            "[error]: no location\n",
+                            read_log(path));
+}
+
+void
+test_reopen (void)
+{
+    const gchar *rotated_path;
+
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+    milter_log_writer_write(writer, "before\n", -1);
+    milter_log_writer_flush(writer);
+
+    rotated_path = cut_build_path(tmp_dir, "output.log.1", NULL);
+    if (g_rename(path, rotated_path) == -1)
+        cut_assert_errno();
+    milter_log_writer_reopen(writer);
+    milter_log_writer_write(writer, "after\n", -1);
+    milter_log_writer_flush(writer);
+
+    cut_assert_equal_string("before\n", read_log(rotated_path));
+    cut_assert_equal_string("after\n", read_log(path));
+}
+
+void
+test_drop (void)
+{
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+
+    milter_log_writer_set_max_buffered_size(writer, 4);
+    cut_assert_equal_uint(4, milter_log_writer_get_max_buffered_size(writer));
+    cut_assert_false(milter_log_writer_write(writer, "too long\n", -1));
+    cut_assert_equal_uint(1, milter_log_writer_get_n_dropped(writer));
+
+    milter_log_writer_set_max_buffered_size(writer,
+                                            MILTER_LOG_WRITER_DEFAULT_MAX_BUFFERED_SIZE);
+    cut_assert_true(milter_log_writer_write(writer, "short\n", -1));
+    milter_log_writer_flush(writer);
+
+    cut_assert_equal_string("short\n"
+                            "[log-writer][dropped] <1>\n",
+                            read_log(path));
+}
+
+void
+test_fork (void)
+{
+    pid_t pid;
+
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+    milter_log_writer_write(writer, "before fork\n", -1);
+
+    pid = fork();
+    if (pid == -1)
+        cut_assert_errno();
+    if (pid == 0) {
+        milter_log_writer_write(writer, "child\n", -1);
+        milter_log_writer_flush(writer);
+        _exit(EXIT_SUCCESS);
+    }
+    wait_child(pid);
+
+    cut_assert_equal_string("before fork\n"
+                            "child\n",
+                            read_log(path));
+}
+
+void
+test_flush_all (void)
+{
+    pid_t pid;
+
+    cut_assert_true(milter_log_writer_set_path(writer, path, &error));
+    gcut_assert_error(error);
+
+    pid = fork();
+    if (pid == -1)
+        cut_assert_errno();
+    if (pid == 0) {
+        milter_log_writer_write(writer, "last line\n", -1);
+        milter_log_writer_flush_all();
+        _exit(EXIT_SUCCESS);
+    }
+    wait_child(pid);
+
+    cut_assert_equal_string("last line\n", read_log(path));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
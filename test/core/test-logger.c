@@ -47,6 +47,7 @@ void test_info (void);
 void test_console_output (void);
 void test_target_level (void);
 void test_interesting_level (void);
+void test_need_log (void);
 void test_path_success (void);
 void test_path_null (void);
 void test_path_nonexistent (void);
@@ -354,6 +355,24 @@ test_interesting_level (void)
                             milter_logger_get_interesting_level(logger));
 }
 
+void
+test_need_log (void)
+{
+    milter_set_log_level(MILTER_LOG_LEVEL_INFO);
+    cut_assert_true(milter_need_info_log());
+    cut_assert_false(milter_need_debug_log());
+
+    milter_logger_set_interesting_level(milter_logger(),
+                                        "test",
+                                        MILTER_LOG_LEVEL_DEBUG);
+    cut_assert_true(milter_need_debug_log());
+
+    milter_logger_set_interesting_level(milter_logger(),
+                                        "test",
+                                        MILTER_LOG_LEVEL_NONE);
+    cut_assert_false(milter_need_debug_log());
+}
+
 void
 test_path_success (void)
 {
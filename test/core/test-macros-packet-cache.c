@@ -0,0 +1,177 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <gcutter.h>
+
+#include <milter/core/milter-macros-packet-cache.h>
+
+void test_lookup (void);
+void test_symbols (void);
+void test_nothing_to_send (void);
+void test_other_macros (void);
+void test_invalidate (void);
+void test_clear (void);
+
+static MilterMacrosPacketCache *cache;
+static GHashTable *macros;
+static GList *symbols;
+
+static const gchar *actual_packet;
+static gsize actual_packet_size;
+
+void
+setup (void)
+{
+    cache = milter_macros_packet_cache_new();
+    macros = gcut_take_new_hash_table_string_string("j", "mail.example.com",
+                                                    "{daemon_name}", "mta",
+                                                    NULL);
+    symbols = NULL;
+
+    actual_packet = NULL;
+    actual_packet_size = 0;
+}
+
+void
+teardown (void)
+{
+    if (cache)
+        g_object_unref(cache);
+    if (symbols)
+        g_list_free(symbols);
+}
+
+static gboolean
+lookup (MilterCommand command, GHashTable *target_macros, GList *target_symbols)
+{
+    return milter_macros_packet_cache_lookup(cache, command,
+                                             target_macros, target_symbols,
+                                             &actual_packet,
+                                             &actual_packet_size);
+}
+
+#define PACKET "packet"
+
+void
+test_lookup (void)
+{
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, macros, NULL));
+
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+    cut_assert_true(lookup(MILTER_COMMAND_CONNECT, macros, NULL));
+    cut_assert_equal_memory(PACKET, strlen(PACKET),
+                            actual_packet, actual_packet_size);
+    cut_assert_false(lookup(MILTER_COMMAND_HELO, macros, NULL));
+    cut_assert_equal_uint(1, milter_macros_packet_cache_get_size(cache));
+}
+
+void
+test_symbols (void)
+{
+    GList *same_symbols = NULL;
+
+    symbols = g_list_append(symbols, "j");
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     macros, symbols,
+                                     PACKET, strlen(PACKET));
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, macros, NULL));
+
+    same_symbols = g_list_append(same_symbols, g_strdup("j"));
+    gcut_take_list(same_symbols, g_free);
+    cut_assert_true(lookup(MILTER_COMMAND_CONNECT, macros, same_symbols));
+    cut_assert_equal_memory(PACKET, strlen(PACKET),
+                            actual_packet, actual_packet_size);
+
+    symbols = g_list_append(symbols, "{daemon_name}");
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, macros, symbols));
+}
+
+void
+test_nothing_to_send (void)
+{
+    symbols = g_list_append(symbols, "{auth_authen}");
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_ENVELOPE_FROM,
+                                     macros, symbols, NULL, 0);
+    cut_assert_true(lookup(MILTER_COMMAND_ENVELOPE_FROM, macros, symbols));
+    cut_assert_null(actual_packet);
+    cut_assert_equal_uint(0, actual_packet_size);
+}
+
+void
+test_other_macros (void)
+{
+    GHashTable *other_macros;
+
+    other_macros = gcut_take_new_hash_table_string_string("j",
+                                                          "mail.example.com",
+                                                          NULL);
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, other_macros, NULL));
+
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     other_macros, NULL,
+                                     "other", strlen("other"));
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, macros, NULL));
+    cut_assert_true(lookup(MILTER_COMMAND_CONNECT, other_macros, NULL));
+    cut_assert_equal_memory("other", strlen("other"),
+                            actual_packet, actual_packet_size);
+    cut_assert_equal_uint(1, milter_macros_packet_cache_get_size(cache));
+}
+
+void
+test_invalidate (void)
+{
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_HELO,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+
+    milter_macros_packet_cache_invalidate(cache, MILTER_COMMAND_CONNECT);
+    cut_assert_false(lookup(MILTER_COMMAND_CONNECT, macros, NULL));
+    cut_assert_true(lookup(MILTER_COMMAND_HELO, macros, NULL));
+    cut_assert_equal_uint(1, milter_macros_packet_cache_get_size(cache));
+}
+
+void
+test_clear (void)
+{
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_CONNECT,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+    milter_macros_packet_cache_store(cache, MILTER_COMMAND_HELO,
+                                     macros, NULL,
+                                     PACKET, strlen(PACKET));
+    cut_assert_equal_uint(2, milter_macros_packet_cache_get_size(cache));
+
+    milter_macros_packet_cache_clear(cache);
+    cut_assert_equal_uint(0, milter_macros_packet_cache_get_size(cache));
+    cut_assert_false(lookup(MILTER_COMMAND_HELO, macros, NULL));
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
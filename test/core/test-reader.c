@@ -29,8 +29,10 @@
 #define shutdown inet_shutdown
 #include <milter-test-utils.h>
 #include <milter/core/milter-reader.h>
+#include <milter/core/milter-command-decoder.h>
 #undef shutdown
 #include <unistd.h>
+#include <sys/socket.h>
 
 void test_reader_io_channel (void);
 void test_reader_io_channel_binary (void);
@@ -39,12 +41,15 @@ void test_io_error (void);
 void test_finished_signal (void);
 void test_shutdown (void);
 void test_tag (void);
+void test_unix_reader_decoder (void);
 
 static MilterEventLoop *loop;
 
 static MilterReader *reader;
 
 static GIOChannel *channel;
+static GIOChannel *unix_channel;
+static MilterDecoder *decoder;
 
 static gsize actual_read_size;
 static GString *actual_read_string;
@@ -71,6 +76,9 @@ cut_setup (void)
     reader = milter_reader_io_channel_new(channel);
     milter_reader_start(reader, loop);
 
+    unix_channel = NULL;
+    decoder = NULL;
+
     actual_read_string = g_string_new(NULL);
     actual_read_size = 0;
 
@@ -93,6 +101,10 @@ cut_teardown (void)
 
     if (channel)
         g_io_channel_unref(channel);
+    if (unix_channel)
+        g_io_channel_unref(unix_channel);
+    if (decoder)
+        g_object_unref(decoder);
 
     if (loop)
         g_object_unref(loop);
@@ -256,6 +268,54 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_reader_get_tag(reader));
 }
 
+void
+test_unix_reader_decoder (void)
+{
+    gchar *binary_data;
+    gsize data_size = 96 * 1024;
+    gsize written_size = 0;
+    gint fds[2];
+    guint i;
+
+    cut_assert_errno(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    unix_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(unix_channel, TRUE);
+    g_io_channel_set_encoding(unix_channel, NULL, NULL);
+
+    g_object_unref(reader);
+    reader = milter_reader_unix_io_channel_new(unix_channel);
+    decoder = milter_command_decoder_new();
+    milter_reader_set_decoder(reader, decoder);
+    signal_id = g_signal_connect(reader, "flow", G_CALLBACK(cb_flow), NULL);
+    milter_reader_start(reader, loop);
+
+    binary_data = g_new(gchar, data_size);
+    cut_take_memory(binary_data);
+    for (i = 0; i < data_size; i++)
+        binary_data[i] = i % 251;
+    while (written_size < data_size) {
+        gssize size;
+
+        size = write(fds[1], binary_data + written_size,
+                     data_size - written_size);
+        cut_assert_operator_int(0, <, size);
+        written_size += size;
+    }
+    close(fds[1]);
+
+    for (i = 0; i < 100 && actual_read_size < data_size; i++)
+        milter_event_loop_iterate(loop, FALSE);
+    cut_assert_equal_memory(binary_data, data_size,
+                            actual_read_string->str, actual_read_size);
+    cut_assert_equal_uint(data_size, milter_reader_get_n_read_bytes(reader));
+    cut_assert_operator_uint(milter_reader_get_n_reads(reader),
+                             <,
+                             data_size / 4096);
+
+    milter_reader_reset_statistics(reader);
+    cut_assert_equal_uint(0, milter_reader_get_n_reads(reader));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -28,17 +28,25 @@
 #include <milter/core/milter-writer.h>
 #undef shutdown
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 void test_writer (void);
 void test_writer_huge_data (void);
 void test_writer_error (void);
 void test_tag (void);
+void test_unix_write_vectors (void);
+void test_unix_write_huge_data (void);
 
 static MilterEventLoop *loop;
 
 static MilterWriter *writer;
 
 static GIOChannel *channel;
+static GIOChannel *unix_channel;
+static gint peer_fd;
+static GString *peer_data;
 
 static GError *expected_error;
 static GError *actual_error;
@@ -69,6 +77,10 @@ cut_setup (void)
 
     expected_error = NULL;
     actual_error = NULL;
+
+    unix_channel = NULL;
+    peer_fd = -1;
+    peer_data = g_string_new(NULL);
 }
 
 void
@@ -76,6 +88,12 @@ cut_teardown (void)
 {
     if (channel)
         g_io_channel_unref(channel);
+    if (unix_channel)
+        g_io_channel_unref(unix_channel);
+    if (peer_fd >= 0)
+        close(peer_fd);
+    if (peer_data)
+        g_string_free(peer_data, TRUE);
 
     if (writer)
         g_object_unref(writer);
@@ -209,6 +227,95 @@ test_tag (void)
     cut_assert_equal_uint(29, milter_writer_get_tag(writer));
 }
 
+static void
+setup_unix_writer (void)
+{
+    gint fds[2];
+
+    cut_assert_errno(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    peer_fd = fds[1];
+    cut_assert_errno(fcntl(peer_fd, F_SETFL, O_NONBLOCK));
+
+    unix_channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(unix_channel, TRUE);
+    g_io_channel_set_encoding(unix_channel, NULL, NULL);
+    g_io_channel_set_flags(unix_channel, G_IO_FLAG_NONBLOCK, NULL);
+
+    g_object_unref(writer);
+    writer = milter_writer_unix_io_channel_new(unix_channel);
+    milter_writer_start(writer, loop);
+    setup_error_callback();
+}
+
+static void
+read_from_peer (void)
+{
+    gchar buffer[4096];
+    gssize size;
+
+    while ((size = read(peer_fd, buffer, sizeof(buffer))) > 0) {
+        g_string_append_len(peer_data, buffer, size);
+    }
+}
+
+void
+test_unix_write_vectors (void)
+{
+    struct iovec vectors[2];
+    GError *error = NULL;
+
+    setup_unix_writer();
+
+    vectors[0].iov_base = "macro\0";
+    vectors[0].iov_len = strlen("macro") + 1;
+    vectors[1].iov_base = "command";
+    vectors[1].iov_len = strlen("command");
+    milter_writer_write_vectors(writer, vectors, 2, &error);
+    gcut_assert_error(error);
+
+    read_from_peer();
+    cut_assert_equal_memory("macro\0command",
+                            strlen("macro") + 1 + strlen("command"),
+                            peer_data->str, peer_data->len);
+}
+
+void
+test_unix_write_huge_data (void)
+{
+    gchar *binary_data;
+    gsize data_size, offset;
+    GError *error = NULL;
+    gint i;
+
+    setup_unix_writer();
+
+    data_size = 192 * 8192;
+    binary_data = g_new(gchar, data_size);
+    cut_take_memory(binary_data);
+    for (offset = 0; offset < data_size; offset++) {
+        binary_data[offset] = offset % 251;
+    }
+
+    milter_writer_write(writer, binary_data, data_size, &error);
+    gcut_assert_error(error);
+    milter_writer_write(writer, "tail", strlen("tail"), &error);
+    gcut_assert_error(error);
+
+    for (i = 0;
+         i < 1000 && peer_data->len < data_size + strlen("tail");
+         i++) {
+        read_from_peer();
+        milter_event_loop_iterate(loop, FALSE);
+    }
+    gcut_assert_error(actual_error);
+
+    cut_assert_equal_uint(data_size + strlen("tail"), peer_data->len);
+    cut_assert_equal_memory(binary_data, data_size,
+                            peer_data->str, data_size);
+    cut_assert_equal_memory("tail", strlen("tail"),
+                            peer_data->str + data_size, strlen("tail"));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -51,6 +51,7 @@ void test_delrcpt (gconstpointer data);
 void test_progress (void);
 void test_quarantine (void);
 void test_replacebody (void);
+void test_callback_threads (void);
 
 static MilterEventLoop *loop;
 
@@ -103,6 +104,18 @@ static sfsistat reply_status;
 static gboolean set_mlreply;
 static int set_mlreply_result;
 
+static SmfiContext *second_context;
+static MilterClientContext *second_client_context;
+static GIOChannel *second_channel;
+static MilterWriter *second_writer;
+
+static GMutex helo_mutex;
+static GCond helo_cond;
+static gboolean helo_blocked;
+static gboolean helo_released;
+
+#define BLOCKED_HELO_FQDN "blocked.example.com"
+
 static sfsistat
 xxfi_connect (SMFICTX *context, char *host_name, _SOCK_ADDR *address)
 {
@@ -115,6 +128,16 @@ xxfi_helo (SMFICTX *context, char *fqdn)
     if (send_progress)
         smfi_progress(context);
 
+    if (g_str_equal(fqdn, BLOCKED_HELO_FQDN)) {
+        g_mutex_lock(&helo_mutex);
+        helo_blocked = TRUE;
+        g_cond_broadcast(&helo_cond);
+        while (!helo_released) {
+            g_cond_wait(&helo_cond, &helo_mutex);
+        }
+        g_mutex_unlock(&helo_mutex);
+    }
+
     return SMFIS_CONTINUE;
 }
 
@@ -331,16 +354,51 @@ cut_setup (void)
 
     set_mlreply = FALSE;
     set_mlreply_result = MI_FAILURE;
+
+    second_context = NULL;
+    second_client_context = NULL;
+    second_channel = NULL;
+    second_writer = NULL;
+
+    g_mutex_init(&helo_mutex);
+    g_cond_init(&helo_cond);
+    helo_blocked = FALSE;
+    helo_released = FALSE;
+}
+
+static void
+release_helo (void)
+{
+    g_mutex_lock(&helo_mutex);
+    helo_released = TRUE;
+    g_cond_broadcast(&helo_cond);
+    g_mutex_unlock(&helo_mutex);
 }
 
 void
 cut_teardown (void)
 {
+    /* A blocked callback thread must be finished before
+     * callback threads are stopped. */
+    release_helo();
+    libmilter_compatible_reset();
+    g_mutex_clear(&helo_mutex);
+    g_cond_clear(&helo_cond);
+
     if (context)
         g_object_unref(context);
     if (client_context)
         g_object_unref(client_context);
 
+    if (second_context)
+        g_object_unref(second_context);
+    if (second_client_context)
+        g_object_unref(second_client_context);
+    if (second_channel)
+        g_io_channel_unref(second_channel);
+    if (second_writer)
+        g_object_unref(second_writer);
+
     if (channel)
         g_io_channel_unref(channel);
     if (writer)
@@ -1033,6 +1091,116 @@ test_replacebody (void)
                             actual_data->str, actual_data->len);
 }
 
+static gboolean
+cb_wait_timeout (gpointer user_data)
+{
+    gboolean *timed_out = user_data;
+
+    *timed_out = TRUE;
+    return FALSE;
+}
+
+static void
+wait_output (GIOChannel *output_channel, gsize size)
+{
+    GString *actual_data;
+    gboolean timed_out = FALSE;
+    guint timeout_id;
+
+    actual_data = gcut_string_io_channel_get_string(output_channel);
+    timeout_id = milter_event_loop_add_timeout(loop, 5,
+                                               cb_wait_timeout, &timed_out);
+    while (!timed_out && actual_data->len < size) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    if (!timed_out)
+        milter_event_loop_remove(loop, timeout_id);
+    cut_assert_false(timed_out);
+}
+
+static void
+wait_helo_blocked (void)
+{
+    gint64 end_time;
+    gboolean blocked;
+
+    end_time = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+    g_mutex_lock(&helo_mutex);
+    while (!helo_blocked) {
+        if (!g_cond_wait_until(&helo_cond, &helo_mutex, end_time))
+            break;
+    }
+    blocked = helo_blocked;
+    g_mutex_unlock(&helo_mutex);
+    cut_assert_true(blocked);
+}
+
+static void
+setup_second_session (void)
+{
+    GError *error = NULL;
+
+    second_client_context = milter_client_context_new(NULL);
+    setup_signals(second_client_context);
+    milter_agent_set_event_loop(MILTER_AGENT(second_client_context), loop);
+    second_context = smfi_context_new(second_client_context);
+
+    second_channel = gcut_string_io_channel_new(NULL);
+    g_io_channel_set_encoding(second_channel, NULL, NULL);
+    second_writer = milter_writer_io_channel_new(second_channel);
+    milter_agent_set_writer(MILTER_AGENT(second_client_context),
+                            second_writer);
+    milter_agent_start(MILTER_AGENT(second_client_context), &error);
+    gcut_assert_error(error);
+}
+
+void
+test_callback_threads (void)
+{
+    const gchar *packet;
+    gsize packet_size;
+    GString *actual_data;
+    GString *second_actual_data;
+    GError *error = NULL;
+
+    if (MILTER_IS_LIBEV_EVENT_LOOP(loop))
+        cut_omit("MilterLibevEventLoop doesn't support GCutStringIOChannel.");
+
+    libmilter_compatible_set_n_callback_threads(2);
+    setup_second_session();
+
+    milter_command_encoder_encode_helo(command_encoder,
+                                       &packet, &packet_size,
+                                       BLOCKED_HELO_FQDN);
+    gcut_assert_error(feed(packet, packet_size));
+    wait_helo_blocked();
+
+    milter_command_encoder_encode_helo(command_encoder,
+                                       &packet, &packet_size,
+                                       "mx.example.com");
+    milter_client_context_feed(second_client_context,
+                               packet, packet_size, &error);
+    gcut_assert_error(error);
+
+    expected_output = g_string_new(NULL);
+    milter_reply_encoder_encode_continue(reply_encoder, &packet, &packet_size);
+    g_string_append_len(expected_output, packet, packet_size);
+
+    wait_output(second_channel, expected_output->len);
+    second_actual_data = gcut_string_io_channel_get_string(second_channel);
+    cut_assert_equal_memory(expected_output->str, expected_output->len,
+                            second_actual_data->str, second_actual_data->len);
+    actual_data = gcut_string_io_channel_get_string(channel);
+    cut_assert_equal_uint(0, actual_data->len);
+
+    release_helo();
+    wait_output(channel, expected_output->len);
+    actual_data = gcut_string_io_channel_get_string(channel);
+    cut_assert_equal_memory(expected_output->str, expected_output->len,
+                            actual_data->str, actual_data->len);
+    pump_all_events();
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
@@ -22,6 +22,8 @@
 #endif
 
 #include <string.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
 
 #include <milter/manager/milter-manager-applicable-condition.h>
 
@@ -34,15 +36,32 @@ void test_name (void);
 void test_description (void);
 void test_data (void);
 void test_merge (void);
+void test_rule_strings (void);
+void test_rule_regexps (void);
+void test_rule_regexps_invalid (void);
+void test_rule_networks (void);
+void test_rule_networks_invalid (void);
+void test_rule_address (void);
+void test_rule_macro (void);
+void test_rule_logical (void);
+void test_stopper_rule (void);
 
 static MilterManagerApplicableCondition *condition;
 static MilterManagerApplicableCondition *merged_condition;
+static MilterManagerConditionRule *rule;
+static GHashTable *macros;
+static GError *actual_error;
+static GError *expected_error;
 
 void
 setup (void)
 {
     condition = NULL;
     merged_condition = NULL;
+    rule = NULL;
+    macros = NULL;
+    actual_error = NULL;
+    expected_error = NULL;
 }
 
 void
@@ -52,6 +71,45 @@ teardown (void)
         g_object_unref(condition);
     if (merged_condition)
         g_object_unref(merged_condition);
+    if (rule)
+        milter_manager_condition_rule_unref(rule);
+    if (macros)
+        g_hash_table_unref(macros);
+    if (actual_error)
+        g_error_free(actual_error);
+    if (expected_error)
+        g_error_free(expected_error);
+}
+
+static gboolean
+match_address (const gchar *value, const gchar *address_string)
+{
+    struct sockaddr_in address_inet;
+    struct sockaddr_in6 address_inet6;
+
+    memset(&address_inet, 0, sizeof(address_inet));
+    address_inet.sin_family = AF_INET;
+    if (inet_pton(AF_INET, address_string, &(address_inet.sin_addr)) == 1)
+        return milter_manager_condition_rule_match(
+            rule, value,
+            (struct sockaddr *)&address_inet, sizeof(address_inet),
+            macros);
+
+    memset(&address_inet6, 0, sizeof(address_inet6));
+    address_inet6.sin6_family = AF_INET6;
+    cut_assert_equal_int(1, inet_pton(AF_INET6, address_string,
+                                      &(address_inet6.sin6_addr)),
+                         cut_message("<%s>", address_string));
+    return milter_manager_condition_rule_match(
+        rule, value,
+        (struct sockaddr *)&address_inet6, sizeof(address_inet6),
+        macros);
+}
+
+static gboolean
+match (const gchar *value)
+{
+    return milter_manager_condition_rule_match(rule, value, NULL, 0, macros);
 }
 
 void
@@ -166,6 +224,204 @@ test_merge (void)
         milter_manager_applicable_condition_get_data(merged_condition));
 }
 
+void
+test_rule_strings (void)
+{
+    const gchar *strings[] = {"unknown", "localhost", NULL};
+
+    rule = milter_manager_condition_rule_new_strings(strings);
+    cut_assert_true(match("unknown"));
+    cut_assert_true(match("localhost"));
+    cut_assert_false(match("unknown.example.com"));
+    cut_assert_false(match(NULL));
+}
+
+void
+test_rule_regexps (void)
+{
+    const gchar *patterns[] = {
+        "(?m:\\.google\\.com\\z)",
+        "(?mi:\\A(?:dhcp|dialup|ppp|[achrsvx]?dsl)[^.]*\\d)",
+        NULL
+    };
+
+    rule = milter_manager_condition_rule_new_regexps(patterns, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_true(match("mail-ot1-f41.google.com"));
+    cut_assert_true(match("PPP-12.example.com"));
+    cut_assert_false(match("mail.example.com"));
+    cut_assert_false(match("google.com.example.com"));
+}
+
+void
+test_rule_regexps_invalid (void)
+{
+    const gchar *patterns[] = {"(", NULL};
+
+    rule = milter_manager_condition_rule_new_regexps(patterns, &actual_error);
+    cut_assert_null(rule);
+    cut_assert_not_null(actual_error);
+    cut_assert_equal_int(MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_REGEXP,
+                         actual_error->code);
+}
+
+void
+test_rule_networks (void)
+{
+    const gchar *networks[] = {
+        "192.168.1.0/24",
+        "10.0.0.0/8",
+        "172.16.0.1",
+        "2001:db8::/32",
+        NULL
+    };
+
+    rule = milter_manager_condition_rule_new_networks(networks, &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_true(match_address(NULL, "192.168.1.29"));
+    cut_assert_false(match_address(NULL, "192.168.2.29"));
+    cut_assert_true(match_address(NULL, "10.2.9.29"));
+    cut_assert_true(match_address(NULL, "172.16.0.1"));
+    cut_assert_false(match_address(NULL, "172.16.0.2"));
+    cut_assert_true(match_address(NULL, "2001:db8::29"));
+    cut_assert_false(match_address(NULL, "2001:db9::29"));
+    cut_assert_false(match(NULL));
+}
+
+void
+test_rule_networks_invalid (void)
+{
+    const gchar *networks[] = {"192.168.1.0/33", NULL};
+
+    expected_error = g_error_new(
+        MILTER_MANAGER_CONDITION_RULE_ERROR,
+        MILTER_MANAGER_CONDITION_RULE_ERROR_INVALID_NETWORK,
+        "invalid network prefix length: <192.168.1.0/33>");
+    rule = milter_manager_condition_rule_new_networks(networks, &actual_error);
+    cut_assert_null(rule);
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_rule_address (void)
+{
+    struct sockaddr_un address_unix;
+
+    rule = milter_manager_condition_rule_new_local_address();
+    cut_assert_true(match_address(NULL, "127.0.0.1"));
+    cut_assert_true(match_address(NULL, "192.168.1.1"));
+    cut_assert_true(match_address(NULL, "172.31.0.1"));
+    cut_assert_false(match_address(NULL, "172.32.0.1"));
+    cut_assert_false(match_address(NULL, "160.29.167.10"));
+    cut_assert_true(match_address(NULL, "::1"));
+    cut_assert_true(match_address(NULL, "fe80::1"));
+    cut_assert_false(match_address(NULL, "2001:db8::1"));
+
+    memset(&address_unix, 0, sizeof(address_unix));
+    address_unix.sun_family = AF_UNIX;
+    cut_assert_true(milter_manager_condition_rule_match(
+                        rule, NULL,
+                        (struct sockaddr *)&address_unix,
+                        sizeof(address_unix),
+                        NULL));
+    milter_manager_condition_rule_unref(rule);
+
+    rule = milter_manager_condition_rule_new_ipv4_address();
+    cut_assert_true(match_address(NULL, "160.29.167.10"));
+    cut_assert_false(match_address(NULL, "2001:db8::1"));
+    milter_manager_condition_rule_unref(rule);
+
+    rule = milter_manager_condition_rule_new_unknown_address();
+    cut_assert_true(match(NULL));
+    cut_assert_false(match_address(NULL, "160.29.167.10"));
+}
+
+void
+test_rule_macro (void)
+{
+    macros = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_insert(macros, "auth_type", "PLAIN");
+
+    rule = milter_manager_condition_rule_new_macro("{auth_type}", "PLAIN");
+    cut_assert_true(match(NULL));
+    milter_manager_condition_rule_unref(rule);
+
+    rule = milter_manager_condition_rule_new_macro("auth_type", "LOGIN");
+    cut_assert_false(match(NULL));
+    milter_manager_condition_rule_unref(rule);
+
+    rule = milter_manager_condition_rule_new_macro("auth_type", NULL);
+    cut_assert_true(match(NULL));
+    milter_manager_condition_rule_unref(rule);
+
+    rule = milter_manager_condition_rule_new_macro("auth_authen", NULL);
+    cut_assert_false(match(NULL));
+}
+
+void
+test_rule_logical (void)
+{
+    const gchar *whitelist[] = {"(?m:\\.example\\.com\\z)", NULL};
+    const gchar *blacklist[] = {"(?m:\\A[^.]*\\d{5})", NULL};
+    const gchar *unknown_hosts[] = {"unknown", NULL};
+    MilterManagerConditionRule *white, *black, *not_white, *ipv4;
+    MilterManagerConditionRule *stop, *unknown;
+
+    white = milter_manager_condition_rule_new_regexps(whitelist,
+                                                      &actual_error);
+    gcut_assert_error(actual_error);
+    black = milter_manager_condition_rule_new_regexps(blacklist,
+                                                      &actual_error);
+    gcut_assert_error(actual_error);
+    not_white = milter_manager_condition_rule_new_not(white);
+    stop = milter_manager_condition_rule_new_and(not_white, black);
+    ipv4 = milter_manager_condition_rule_new_ipv4_address();
+    rule = milter_manager_condition_rule_new_and(ipv4, stop);
+    milter_manager_condition_rule_unref(white);
+    milter_manager_condition_rule_unref(black);
+    milter_manager_condition_rule_unref(not_white);
+    milter_manager_condition_rule_unref(stop);
+    milter_manager_condition_rule_unref(ipv4);
+
+    cut_assert_true(match_address("h12345.example.net", "160.29.167.10"));
+    cut_assert_false(match_address("h12345.example.com", "160.29.167.10"));
+    cut_assert_false(match_address("mail.example.net", "160.29.167.10"));
+    cut_assert_false(match_address("h12345.example.net", "2001:db8::1"));
+
+    milter_manager_condition_rule_unref(rule);
+    black = milter_manager_condition_rule_new_strings(unknown_hosts);
+    unknown = milter_manager_condition_rule_new_unknown_address();
+    rule = milter_manager_condition_rule_new_or(black, unknown);
+    milter_manager_condition_rule_unref(black);
+    milter_manager_condition_rule_unref(unknown);
+    cut_assert_true(match_address("unknown", "160.29.167.10"));
+    cut_assert_false(match_address("mail.example.net", "160.29.167.10"));
+    cut_assert_true(match("mail.example.net"));
+}
+
+void
+test_stopper_rule (void)
+{
+    condition = milter_manager_applicable_condition_new("Remote Network");
+    rule = milter_manager_condition_rule_new_local_address();
+
+    cut_assert_null(milter_manager_applicable_condition_get_stopper_rule(
+                        condition, MILTER_SERVER_CONTEXT_STATE_CONNECT));
+    milter_manager_applicable_condition_set_stopper_rule(
+        condition, MILTER_SERVER_CONTEXT_STATE_CONNECT, rule);
+    cut_assert_equal_pointer(
+        rule,
+        milter_manager_applicable_condition_get_stopper_rule(
+            condition, MILTER_SERVER_CONTEXT_STATE_CONNECT));
+    cut_assert_null(milter_manager_applicable_condition_get_stopper_rule(
+                        condition, MILTER_SERVER_CONTEXT_STATE_HELO));
+
+    milter_manager_applicable_condition_set_stopper_rule(
+        condition, MILTER_SERVER_CONTEXT_STATE_CONNECT, NULL);
+    cut_assert_null(milter_manager_applicable_condition_get_stopper_rule(
+                        condition, MILTER_SERVER_CONTEXT_STATE_CONNECT));
+}
+
 /*
 vi:ts=4:nowrap:ai:expandtab:sw=4
 */
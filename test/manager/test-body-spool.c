@@ -0,0 +1,256 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include <milter/manager/milter-manager-body-spool.h>
+
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_max_on_memory_size (void);
+void test_on_memory (void);
+void test_spooled (void);
+void test_append_after_spooled (void);
+void test_empty (void);
+void test_use_memfd (void);
+void test_max_on_memory_total_size (void);
+void test_max_on_memory_total_size_other (void);
+
+static MilterManagerBodySpool *spool;
+static MilterManagerBodySpool *other_spool;
+static GString *actual_body;
+static GError *actual_error;
+
+void
+setup (void)
+{
+    spool = NULL;
+    other_spool = NULL;
+    actual_body = g_string_new(NULL);
+    actual_error = NULL;
+}
+
+void
+teardown (void)
+{
+    if (spool)
+        g_object_unref(spool);
+    if (other_spool)
+        g_object_unref(other_spool);
+    milter_manager_body_spool_set_max_on_memory_total_size(0);
+    if (actual_body)
+        g_string_free(actual_body, TRUE);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static void
+read_all (gsize chunk_size)
+{
+    gsize offset = 0;
+
+    while (TRUE) {
+        const gchar *chunk;
+        gsize read_size;
+
+        chunk = milter_manager_body_spool_get_chunk(spool,
+                                                    offset,
+                                                    chunk_size,
+                                                    &read_size,
+                                                    &actual_error);
+        gcut_assert_error(actual_error);
+        if (!chunk)
+            break;
+        cut_assert_operator_uint(read_size, <=, chunk_size);
+        g_string_append_len(actual_body, chunk, read_size);
+        offset += read_size;
+    }
+}
+
+static void
+append_to (MilterManagerBodySpool *target, const gchar *chunk)
+{
+    milter_manager_body_spool_append(target, chunk, strlen(chunk),
+                                     &actual_error);
+    gcut_assert_error(actual_error);
+}
+
+static void
+append (const gchar *chunk)
+{
+    cut_trace(append_to(spool, chunk));
+}
+
+void
+test_new (void)
+{
+    spool = milter_manager_body_spool_new(29);
+    cut_assert_equal_uint(
+        29,
+        milter_manager_body_spool_get_max_on_memory_size(spool));
+    cut_assert_equal_uint(0, milter_manager_body_spool_get_size(spool));
+    cut_assert_false(milter_manager_body_spool_is_spooled(spool));
+}
+
+void
+test_max_on_memory_size (void)
+{
+    spool = milter_manager_body_spool_new(29);
+    milter_manager_body_spool_set_max_on_memory_size(spool, 4096);
+    cut_assert_equal_uint(
+        4096,
+        milter_manager_body_spool_get_max_on_memory_size(spool));
+}
+
+void
+test_on_memory (void)
+{
+    spool = milter_manager_body_spool_new(1024);
+    cut_trace(append("Hello "));
+    cut_trace(append("World!"));
+    cut_assert_false(milter_manager_body_spool_is_spooled(spool));
+    cut_assert_equal_uint(12, milter_manager_body_spool_get_size(spool));
+
+    cut_trace(read_all(5));
+    cut_assert_equal_string("Hello World!", actual_body->str);
+    cut_assert_equal_uint(
+        0,
+        milter_manager_body_spool_get_n_spooled_bytes(spool));
+    cut_assert_equal_uint(
+        12,
+        milter_manager_body_spool_get_n_read_bytes(spool));
+}
+
+void
+test_spooled (void)
+{
+    spool = milter_manager_body_spool_new(8);
+    cut_trace(append("Hello "));
+    cut_assert_false(milter_manager_body_spool_is_spooled(spool));
+    cut_trace(append("World!"));
+    cut_assert_true(milter_manager_body_spool_is_spooled(spool));
+    cut_assert_equal_uint(12, milter_manager_body_spool_get_size(spool));
+
+    cut_trace(read_all(5));
+    cut_trace(read_all(64));
+    cut_assert_equal_string("Hello World!Hello World!", actual_body->str);
+    cut_assert_equal_uint(
+        12,
+        milter_manager_body_spool_get_n_spooled_bytes(spool));
+    cut_assert_equal_uint(
+        24,
+        milter_manager_body_spool_get_n_read_bytes(spool));
+}
+
+void
+test_append_after_spooled (void)
+{
+    spool = milter_manager_body_spool_new(4);
+    cut_trace(append("Hello "));
+    cut_trace(read_all(64));
+    cut_assert_equal_string("Hello ", actual_body->str);
+
+    cut_trace(append("World!"));
+    g_string_truncate(actual_body, 0);
+    cut_trace(read_all(64));
+    cut_assert_equal_string("Hello World!", actual_body->str);
+}
+
+void
+test_empty (void)
+{
+    const gchar *chunk;
+    gsize read_size = 29;
+
+    spool = milter_manager_body_spool_new(1024);
+    milter_manager_body_spool_append(spool, NULL, 0, &actual_error);
+    gcut_assert_error(actual_error);
+
+    chunk = milter_manager_body_spool_get_chunk(spool, 0, 64, &read_size,
+                                                &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_null(chunk);
+    cut_assert_equal_uint(0, read_size);
+}
+
+void
+test_use_memfd (void)
+{
+    spool = milter_manager_body_spool_new(4);
+    milter_manager_body_spool_set_use_memfd(spool, TRUE);
+    cut_assert_true(milter_manager_body_spool_get_use_memfd(spool));
+
+    cut_trace(append("Hello World!"));
+    cut_assert_true(milter_manager_body_spool_is_spooled(spool));
+    cut_trace(read_all(5));
+    cut_assert_equal_string("Hello World!", actual_body->str);
+}
+
+void
+test_max_on_memory_total_size (void)
+{
+    milter_manager_body_spool_set_max_on_memory_total_size(12);
+    spool = milter_manager_body_spool_new(1024);
+    other_spool = milter_manager_body_spool_new(1024);
+
+    cut_trace(append_to(other_spool, "Hello "));
+    cut_trace(append_to(spool, "World!"));
+    cut_assert_equal_uint(12,
+                          milter_manager_body_spool_get_on_memory_total_size());
+
+    cut_trace(append_to(spool, "!"));
+    cut_assert_true(milter_manager_body_spool_is_spooled(spool));
+    cut_assert_false(milter_manager_body_spool_is_spooled(other_spool));
+    cut_assert_equal_uint(6,
+                          milter_manager_body_spool_get_on_memory_total_size());
+
+    cut_trace(read_all(64));
+    cut_assert_equal_string("World!!", actual_body->str);
+}
+
+void
+test_max_on_memory_total_size_other (void)
+{
+    milter_manager_body_spool_set_max_on_memory_total_size(12);
+    spool = milter_manager_body_spool_new(1024);
+    other_spool = milter_manager_body_spool_new(1024);
+
+    cut_trace(append_to(spool, "Hello World"));
+    cut_assert_false(milter_manager_body_spool_is_spooled(spool));
+    cut_trace(append_to(other_spool, "!!"));
+    cut_assert_false(milter_manager_body_spool_is_spooled(spool));
+    cut_assert_false(milter_manager_body_spool_is_spooled(other_spool));
+
+    cut_trace(read_all(64));
+    cut_assert_equal_string("Hello World", actual_body->str);
+    cut_assert_true(milter_manager_body_spool_is_spooled(spool));
+    cut_assert_equal_uint(2,
+                          milter_manager_body_spool_get_on_memory_total_size());
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
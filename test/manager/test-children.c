@@ -67,6 +67,8 @@ void test_end_of_header_no_reply (void);
 void test_body (void);
 void test_body_with_protocol_version2 (void);
 void test_body_no_reply (void);
+void test_headers_no_reply_stream (void);
+void test_body_no_reply_stream (void);
 void data_important_status (void);
 void test_important_status (gconstpointer data);
 void data_not_important_status (void);
@@ -575,19 +577,24 @@ cb_timeout_waiting (gpointer data)
     return FALSE;
 }
 
-#define wait_reply(expected, actual)            \
-    cut_trace_with_info_expression(             \
-        wait_reply_helper(expected, &actual),   \
+#define wait_reply(expected, actual)                    \
+    cut_trace_with_info_expression(                     \
+        wait_reply_helper(expected, &actual, 0.5),      \
         wait_reply(expected, actual))
 
+#define wait_reply_with_timeout(expected, actual, timeout)      \
+    cut_trace_with_info_expression(                             \
+        wait_reply_helper(expected, &actual, timeout),          \
+        wait_reply_with_timeout(expected, actual, timeout))
+
 static void
-wait_reply_helper (guint expected, guint *actual)
+wait_reply_helper (guint expected, guint *actual, gdouble timeout)
 {
     gboolean timeout_waiting = TRUE;
     guint timeout_waiting_id;
 
     cut_assert_true(milter_manager_children_is_waiting_reply(children));
-    timeout_waiting_id = milter_event_loop_add_timeout(loop, 0.5,
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, timeout,
                                                        cb_timeout_waiting,
                                                        &timeout_waiting);
     while (timeout_waiting && expected > *actual) {
@@ -1630,6 +1637,73 @@ test_body_no_reply (void)
     cut_assert_false(milter_manager_children_is_waiting_reply(children));
 }
 
+void
+test_headers_no_reply_stream (void)
+{
+    MilterAgent *last_child;
+
+    step |= MILTER_STEP_NO_REPLY_HEADER;
+    arguments_append(arguments1,
+                     "--negotiate-flags", "no-reply-header",
+                     NULL);
+    arguments_append(arguments2,
+                     "--negotiate-flags", "no-reply-header",
+                     NULL);
+    cut_trace(test_data());
+
+    /* The chain advances when the header is flushed. */
+    milter_manager_children_header(children, "From", "<alice@example.com>");
+    cut_assert_equal_uint(5, n_continue_emitted);
+    wait_reply(6, n_continue_emitted);
+    milter_manager_children_header(children, "To", "<bob@example.com>");
+    cut_assert_equal_uint(6, n_continue_emitted);
+    wait_reply(7, n_continue_emitted);
+    milter_manager_children_header(children, "Subject", "Hello");
+    cut_assert_equal_uint(7, n_continue_emitted);
+    wait_reply(8, n_continue_emitted);
+    cut_assert_equal_uint(3, collect_n_received(header));
+
+    milter_manager_children_end_of_header(children);
+    wait_reply(9, n_continue_emitted);
+
+    last_child =
+        g_list_last(milter_manager_children_get_children(children))->data;
+    milter_agent_reset_write_statistics(last_child);
+    milter_manager_children_end_of_message(children, NULL, 0);
+    wait_reply(10, n_continue_emitted);
+    cut_assert_equal_uint(6, collect_n_received(header));
+    /* All headers by a write, END_OF_HEADER and END_OF_MESSAGE. */
+    cut_assert_equal_uint(3, milter_agent_get_n_writes(last_child));
+}
+
+void
+test_body_no_reply_stream (void)
+{
+    gchar *chunk;
+    gsize chunk_size = 20 * MILTER_CHUNK_SIZE;
+
+    step |= MILTER_STEP_NO_REPLY_BODY;
+    arguments_append(arguments1,
+                     "--negotiate-flags", "no-reply-body",
+                     NULL);
+    arguments_append(arguments2,
+                     "--negotiate-flags", "no-reply-body",
+                     NULL);
+    cut_trace(test_end_of_header());
+
+    chunk = cut_take_memory(g_malloc(chunk_size));
+    memset(chunk, 'X', chunk_size);
+
+    /* The chain advances when the whole body is flushed. */
+    milter_manager_children_body(children, chunk, chunk_size);
+    cut_assert_equal_uint(7, n_continue_emitted);
+    wait_reply_with_timeout(8, n_continue_emitted, 5);
+    /* The first 1MiB piece is sent by 16 packets and a packet
+     * for the rest 16 bytes. The remaining is sent by 4
+     * packets. */
+    cut_assert_equal_uint(21, collect_n_received(body));
+}
+
 #define is_important_status(children, state, next_status)                    \
     milter_manager_children_is_important_status(children, state, next_status)
 
@@ -23,6 +23,7 @@
 
 #include <milter/manager/milter-manager-configuration.h>
 #include <milter/manager/milter-manager-children.h>
+#include <milter/manager/milter-manager-body-spool.h>
 
 #include <milter-test-utils.h>
 #include <milter-manager-test-utils.h>
@@ -49,6 +50,7 @@ void test_max_connections (void);
 void test_max_file_descriptors (void);
 void test_custom_configuration_directory (void);
 void test_controller_connection_spec (void);
+void test_controller_metrics_connection_spec (void);
 void test_manager_connection_spec (void);
 void test_fallback_status (void);
 void test_fallback_status_at_disconnect (void);
@@ -58,6 +60,8 @@ void test_event_loop_backend (void);
 void test_connection_check_interval (void);
 void test_location (void);
 void test_n_workers (void);
+void test_reuse_port (void);
+void test_n_event_loop_threads (void);
 void test_default_packet_buffer_size (void);
 void test_prefix (void);
 void test_use_syslog (void);
@@ -65,6 +69,12 @@ void test_syslog_facility (void);
 void test_chunk_size (void);
 void test_chunk_size_over (void);
 void test_max_pending_finished_sessions (void);
+void test_max_on_memory_body_size (void);
+void test_max_on_memory_body_total_size (void);
+void test_use_memfd_body_spool (void);
+void test_short_circuit_reject (void);
+void test_connection_table (void);
+void test_ref_connection_table (void);
 void test_egg (void);
 void test_find_egg (void);
 void test_remove_egg (void);
@@ -440,6 +450,26 @@ test_controller_connection_spec (void)
     cut_assert_equal_string(spec, actual_spec);
 }
 
+void
+test_controller_metrics_connection_spec (void)
+{
+    const gchar spec[] = "inet:9290@localhost";
+    const gchar *actual_spec;
+
+    actual_spec =
+        milter_manager_configuration_get_controller_metrics_connection_spec(
+            config);
+    cut_assert_equal_string(NULL, actual_spec);
+
+    milter_manager_configuration_set_controller_metrics_connection_spec(config,
+                                                                        spec);
+
+    actual_spec =
+        milter_manager_configuration_get_controller_metrics_connection_spec(
+            config);
+    cut_assert_equal_string(spec, actual_spec);
+}
+
 void
 test_manager_connection_spec (void)
 {
@@ -571,6 +601,24 @@ test_n_workers (void)
         milter_manager_configuration_get_n_workers(config));
 }
 
+void
+test_reuse_port (void)
+{
+    cut_assert_false(milter_manager_configuration_is_reuse_port(config));
+    milter_manager_configuration_set_reuse_port(config, TRUE);
+    cut_assert_true(milter_manager_configuration_is_reuse_port(config));
+}
+
+void
+test_n_event_loop_threads (void)
+{
+    cut_assert_equal_uint(
+        0, milter_manager_configuration_get_n_event_loop_threads(config));
+    milter_manager_configuration_set_n_event_loop_threads(config, 4);
+    cut_assert_equal_uint(
+        4, milter_manager_configuration_get_n_event_loop_threads(config));
+}
+
 void
 test_default_packet_buffer_size (void)
 {
@@ -647,6 +695,90 @@ test_max_pending_finished_sessions (void)
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 }
 
+void
+test_max_on_memory_body_size (void)
+{
+    cut_assert_equal_uint(
+        MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+    milter_manager_configuration_set_max_on_memory_body_size(config, 1024);
+    cut_assert_equal_uint(
+        1024,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+}
+
+void
+test_max_on_memory_body_total_size (void)
+{
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_max_on_memory_body_total_size(config));
+    milter_manager_configuration_set_max_on_memory_body_total_size(config,
+                                                                   4096);
+    cut_assert_equal_uint(
+        4096,
+        milter_manager_configuration_get_max_on_memory_body_total_size(config));
+}
+
+void
+test_use_memfd_body_spool (void)
+{
+    cut_assert_false(
+        milter_manager_configuration_get_use_memfd_body_spool(config));
+    milter_manager_configuration_set_use_memfd_body_spool(config, TRUE);
+    cut_assert_true(
+        milter_manager_configuration_get_use_memfd_body_spool(config));
+}
+
+void
+test_short_circuit_reject (void)
+{
+    cut_assert_false(
+        milter_manager_configuration_get_short_circuit_reject(config));
+    milter_manager_configuration_set_short_circuit_reject(config, TRUE);
+    cut_assert_true(
+        milter_manager_configuration_get_short_circuit_reject(config));
+}
+
+void
+test_connection_table (void)
+{
+    MilterManagerConnectionTable *table;
+
+    cut_assert_null(
+        milter_manager_configuration_get_connection_table(config));
+    table = milter_manager_connection_table_new();
+    gcut_take_object(G_OBJECT(table));
+    milter_manager_configuration_set_connection_table(config, table);
+    gcut_assert_equal_object(
+        table,
+        milter_manager_configuration_get_connection_table(config));
+}
+
+void
+test_ref_connection_table (void)
+{
+    MilterManagerConnectionTable *table;
+    gpointer released_table;
+    GError *error = NULL;
+
+    cut_assert_null(
+        milter_manager_configuration_ref_connection_table(config));
+
+    table = milter_manager_connection_table_new();
+    milter_manager_configuration_set_connection_table(config, table);
+    g_object_unref(table);
+
+    table = milter_manager_configuration_ref_connection_table(config);
+    released_table = table;
+    g_object_add_weak_pointer(G_OBJECT(table), &released_table);
+    milter_manager_configuration_clear(config, &error);
+    gcut_assert_error(error);
+    cut_assert_not_null(released_table);
+    g_object_unref(table);
+    cut_assert_null(released_table);
+}
+
 static void
 milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
 {
@@ -658,6 +790,10 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
     cut_assert_equal_string(
         NULL,
         milter_manager_configuration_get_controller_connection_spec(config));
+    cut_assert_equal_string(
+        NULL,
+        milter_manager_configuration_get_controller_metrics_connection_spec(
+            config));
     cut_assert_equal_string(
         MILTER_MANAGER_DEFAULT_EFFECTIVE_USER,
         milter_manager_configuration_get_effective_user(config));
@@ -726,6 +862,10 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
     cut_assert_equal_uint(
         0,
         milter_manager_configuration_get_n_workers(config));
+    cut_assert_false(milter_manager_configuration_is_reuse_port(config));
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_n_event_loop_threads(config));
 
     cut_assert_equal_uint(
         0,
@@ -746,6 +886,20 @@ milter_assert_default_configuration_helper (MilterManagerConfiguration *config)
         0,
         milter_manager_configuration_get_max_pending_finished_sessions(config));
 
+    cut_assert_equal_uint(
+        MILTER_MANAGER_BODY_SPOOL_DEFAULT_MAX_ON_MEMORY_SIZE,
+        milter_manager_configuration_get_max_on_memory_body_size(config));
+    cut_assert_equal_uint(
+        0,
+        milter_manager_configuration_get_max_on_memory_body_total_size(config));
+    cut_assert_false(
+        milter_manager_configuration_get_use_memfd_body_spool(config));
+
+    cut_assert_false(
+        milter_manager_configuration_get_short_circuit_reject(config));
+    cut_assert_null(
+        milter_manager_configuration_get_connection_table(config));
+
     if (expected_children)
         g_object_unref(expected_children);
     expected_children = milter_manager_children_new(config, loop);
@@ -955,6 +1109,7 @@ test_clear (void)
     test_controller_unix_socket_group();
     test_manager_connection_spec();
     test_controller_connection_spec();
+    test_controller_metrics_connection_spec();
     test_fallback_status();
     test_children();
     test_daemon();
@@ -965,11 +1120,17 @@ test_clear (void)
     test_event_loop_backend();
     test_connection_check_interval();
     test_n_workers();
+    test_reuse_port();
+    test_n_event_loop_threads();
     test_default_packet_buffer_size();
     test_use_syslog();
     test_syslog_facility();
     test_chunk_size();
     test_max_pending_finished_sessions();
+    test_max_on_memory_body_size();
+    test_max_on_memory_body_total_size();
+    test_use_memfd_body_spool();
+    test_short_circuit_reject();
 
     handler_id = g_signal_connect(config, "connected",
                                   G_CALLBACK(cb_connected), NULL);
@@ -0,0 +1,224 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <milter/manager/milter-manager-connection-table.h>
+
+#include <gcutter.h>
+
+void test_lookup (void);
+void test_close_wait (void);
+void test_unknown (void);
+void test_lifetime (void);
+
+static MilterManagerConnectionTable *table;
+static GError *actual_error;
+
+static gint server_fd;
+static gint client_fd;
+static gint accepted_fd;
+static struct sockaddr_in server_address;
+static struct sockaddr_in client_address;
+
+void
+setup (void)
+{
+    table = milter_manager_connection_table_new();
+    actual_error = NULL;
+
+    server_fd = -1;
+    client_fd = -1;
+    accepted_fd = -1;
+}
+
+void
+teardown (void)
+{
+    if (table)
+        g_object_unref(table);
+
+    if (accepted_fd >= 0)
+        close(accepted_fd);
+    if (client_fd >= 0)
+        close(client_fd);
+    if (server_fd >= 0)
+        close(server_fd);
+
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static void
+update (void)
+{
+    if (!milter_manager_connection_table_update(table, &actual_error)) {
+        cut_omit("connection table isn't available: %s",
+                 actual_error->message);
+    }
+}
+
+static void
+open_connection (void)
+{
+    socklen_t length;
+
+    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    cut_assert_operator_int(0, <=, server_fd);
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family = AF_INET;
+    server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    cut_assert_errno(bind(server_fd,
+                          (struct sockaddr *)&server_address,
+                          sizeof(server_address)));
+    cut_assert_errno(listen(server_fd, 1));
+    length = sizeof(server_address);
+    cut_assert_errno(getsockname(server_fd,
+                                 (struct sockaddr *)&server_address,
+                                 &length));
+
+    client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    cut_assert_operator_int(0, <=, client_fd);
+    cut_assert_errno(connect(client_fd,
+                             (struct sockaddr *)&server_address,
+                             sizeof(server_address)));
+    length = sizeof(client_address);
+    cut_assert_errno(getsockname(client_fd,
+                                 (struct sockaddr *)&client_address,
+                                 &length));
+
+    accepted_fd = accept(server_fd, NULL, NULL);
+    cut_assert_operator_int(0, <=, accepted_fd);
+}
+
+static MilterManagerConnectionState
+lookup (void)
+{
+    return milter_manager_connection_table_lookup(
+        table,
+        (struct sockaddr *)&client_address, sizeof(client_address),
+        NULL, NULL);
+}
+
+void
+test_lookup (void)
+{
+    struct sockaddr *local_address = NULL;
+    socklen_t local_address_length = 0;
+    struct sockaddr_in *local_address_inet;
+
+    open_connection();
+    update();
+
+    cut_assert_equal_uint(MILTER_MANAGER_CONNECTION_STATE_ESTABLISHED,
+                          milter_manager_connection_table_lookup(
+                              table,
+                              (struct sockaddr *)&client_address,
+                              sizeof(client_address),
+                              &local_address,
+                              &local_address_length));
+    cut_take_memory(local_address);
+    cut_assert_equal_uint(sizeof(struct sockaddr_in), local_address_length);
+    local_address_inet = (struct sockaddr_in *)local_address;
+    cut_assert_equal_uint(AF_INET, local_address_inet->sin_family);
+    cut_assert_equal_uint(ntohs(server_address.sin_port),
+                          ntohs(local_address_inet->sin_port));
+    cut_assert_true(milter_manager_connection_table_is_connected(
+                        table,
+                        (struct sockaddr *)&client_address,
+                        sizeof(client_address)));
+    cut_assert_operator_uint(0, <, milter_manager_connection_table_get_size(table));
+    cut_assert_not_equal_uint(MILTER_MANAGER_CONNECTION_TABLE_SOURCE_NONE,
+                              milter_manager_connection_table_get_source(table));
+}
+
+void
+test_close_wait (void)
+{
+    MilterManagerConnectionState state = MILTER_MANAGER_CONNECTION_STATE_UNKNOWN;
+    gint i;
+
+    open_connection();
+    close(client_fd);
+    client_fd = -1;
+
+    for (i = 0; i < 100; i++) {
+        update();
+        state = lookup();
+        if (state == MILTER_MANAGER_CONNECTION_STATE_CLOSE_WAIT)
+            break;
+        g_usleep(10000);
+    }
+    cut_assert_equal_uint(MILTER_MANAGER_CONNECTION_STATE_CLOSE_WAIT, state);
+    cut_assert_false(milter_manager_connection_table_is_connected(
+                         table,
+                         (struct sockaddr *)&client_address,
+                         sizeof(client_address)));
+}
+
+void
+test_unknown (void)
+{
+    struct sockaddr_in address;
+
+    update();
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(0);
+    cut_assert_equal_uint(MILTER_MANAGER_CONNECTION_STATE_UNKNOWN,
+                          milter_manager_connection_table_lookup(
+                              table,
+                              (struct sockaddr *)&address, sizeof(address),
+                              NULL, NULL));
+    cut_assert_true(milter_manager_connection_table_is_connected(
+                        table,
+                        (struct sockaddr *)&address, sizeof(address)));
+}
+
+void
+test_lifetime (void)
+{
+    milter_manager_connection_table_set_lifetime(table, 60);
+    cut_assert_equal_double(60, 0.1,
+                            milter_manager_connection_table_get_lifetime(table));
+    update();
+
+    open_connection();
+    cut_assert_true(milter_manager_connection_table_ensure_updated(table));
+    cut_assert_equal_uint(MILTER_MANAGER_CONNECTION_STATE_UNKNOWN, lookup());
+
+    milter_manager_connection_table_purge(table);
+    cut_assert_equal_uint(0, milter_manager_connection_table_get_size(table));
+    cut_assert_true(milter_manager_connection_table_ensure_updated(table));
+    cut_assert_equal_uint(MILTER_MANAGER_CONNECTION_STATE_ESTABLISHED, lookup());
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
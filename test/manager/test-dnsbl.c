@@ -0,0 +1,555 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <milter/manager/milter-manager-dnsbl.h>
+
+#include <milter-test-utils.h>
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void test_add_zone (void);
+void data_add_zone_error (void);
+void test_add_zone_error (gconstpointer data);
+void test_name_server (void);
+void test_name_server_error (void);
+void test_listed (void);
+void test_not_listed (void);
+void test_expected_network (void);
+void test_cache (void);
+void test_max_cache_size (void);
+void test_shared_lookup (void);
+void test_timeout (void);
+void test_cancel (void);
+void test_ipv6 (void);
+
+static MilterManagerDNSBL *dnsbl;
+static MilterEventLoop *loop;
+static GError *expected_error;
+static GError *actual_error;
+
+static GIOChannel *server_channel;
+static guint server_watch_id;
+static GHashTable *server_answers;
+static GList *server_queries;
+
+static guint n_checked;
+static gboolean listed;
+
+/* A stub DNS server answers A records in server_answers, doesn't
+ * answer names under "silent." and returns NXDOMAIN for others. */
+static gchar *
+decode_name (const guchar *data, gsize size, gsize *offset)
+{
+    GString *name;
+
+    name = g_string_new(NULL);
+    while (*offset < size && data[*offset] != 0) {
+        guint8 length = data[*offset];
+
+        if (name->len > 0)
+            g_string_append_c(name, '.');
+        g_string_append_len(name, (const gchar *)data + *offset + 1, length);
+        *offset += length + 1;
+    }
+    *offset += 1;
+
+    return g_string_free(name, FALSE);
+}
+
+static void
+append_uint16 (GByteArray *packet, guint16 value)
+{
+    guint8 bytes[2];
+
+    bytes[0] = value >> 8;
+    bytes[1] = value & 0xff;
+    g_byte_array_append(packet, bytes, sizeof(bytes));
+}
+
+static void
+append_uint32 (GByteArray *packet, guint32 value)
+{
+    append_uint16(packet, value >> 16);
+    append_uint16(packet, value & 0xffff);
+}
+
+static gboolean
+cb_server_readable (GIOChannel *channel, GIOCondition condition,
+                    gpointer user_data)
+{
+    guchar query[512];
+    struct sockaddr_storage address;
+    socklen_t address_length = sizeof(address);
+    ssize_t size;
+    gsize offset = 12;
+    gchar *name;
+    const gchar *answer;
+    GByteArray *response;
+    gint fd;
+
+    fd = g_io_channel_unix_get_fd(channel);
+    size = recvfrom(fd, query, sizeof(query), 0,
+                    (struct sockaddr *)&address, &address_length);
+    if (size < 12)
+        return TRUE;
+
+    name = decode_name(query, size, &offset);
+    server_queries = g_list_append(server_queries, name);
+    if (strstr(name, ".silent."))
+        return TRUE;
+
+    answer = g_hash_table_lookup(server_answers, name);
+    response = g_byte_array_new();
+    g_byte_array_append(response, query, 2);
+    append_uint16(response, answer ? 0x8180 : 0x8183);
+    append_uint16(response, 1);
+    append_uint16(response, answer ? 1 : 0);
+    append_uint16(response, answer ? 0 : 1);
+    append_uint16(response, 0);
+    g_byte_array_append(response, query + 12, offset + 4 - 12);
+    append_uint16(response, 0xc00c);
+    if (answer) {
+        struct in_addr answer_address;
+
+        inet_pton(AF_INET, answer, &answer_address);
+        append_uint16(response, 1);
+        append_uint16(response, 1);
+        append_uint32(response, 300);
+        append_uint16(response, 4);
+        g_byte_array_append(response, (guint8 *)&answer_address, 4);
+    } else {
+        guint8 root = 0;
+
+        append_uint16(response, 6);
+        append_uint16(response, 1);
+        append_uint32(response, 3600);
+        append_uint16(response, 22);
+        g_byte_array_append(response, &root, 1);
+        g_byte_array_append(response, &root, 1);
+        append_uint32(response, 1);
+        append_uint32(response, 3600);
+        append_uint32(response, 600);
+        append_uint32(response, 86400);
+        append_uint32(response, 120);
+    }
+    sendto(fd, response->data, response->len, 0,
+           (struct sockaddr *)&address, address_length);
+    g_byte_array_free(response, TRUE);
+
+    return TRUE;
+}
+
+static const gchar *
+start_server (void)
+{
+    struct sockaddr_in address;
+    socklen_t address_length = sizeof(address);
+    gint fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    cut_assert_operator_int(fd, >=, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = g_htonl(INADDR_LOOPBACK);
+    cut_assert_equal_int(0, bind(fd, (struct sockaddr *)&address,
+                                 sizeof(address)));
+    cut_assert_equal_int(0, getsockname(fd, (struct sockaddr *)&address,
+                                        &address_length));
+
+    server_channel = g_io_channel_unix_new(fd);
+    g_io_channel_set_close_on_unref(server_channel, TRUE);
+    server_watch_id = milter_event_loop_watch_io(loop, server_channel,
+                                                 G_IO_IN,
+                                                 cb_server_readable, NULL);
+
+    return cut_take_printf("127.0.0.1:%u", g_ntohs(address.sin_port));
+}
+
+void
+setup (void)
+{
+    loop = milter_test_event_loop_new();
+    dnsbl = milter_manager_dnsbl_new();
+
+    expected_error = NULL;
+    actual_error = NULL;
+
+    server_channel = NULL;
+    server_watch_id = 0;
+    server_answers = g_hash_table_new(g_str_hash, g_str_equal);
+    server_queries = NULL;
+
+    n_checked = 0;
+    listed = FALSE;
+}
+
+void
+teardown (void)
+{
+    if (dnsbl)
+        g_object_unref(dnsbl);
+
+    if (server_watch_id > 0)
+        milter_event_loop_remove(loop, server_watch_id);
+    if (server_channel)
+        g_io_channel_unref(server_channel);
+    if (server_answers)
+        g_hash_table_unref(server_answers);
+    if (server_queries) {
+        g_list_foreach(server_queries, (GFunc)g_free, NULL);
+        g_list_free(server_queries);
+    }
+
+    if (loop)
+        g_object_unref(loop);
+
+    if (expected_error)
+        g_error_free(expected_error);
+    if (actual_error)
+        g_error_free(actual_error);
+}
+
+static void
+setup_zones (void)
+{
+    milter_manager_dnsbl_add_zone(dnsbl, "bl.example.com", NULL, NULL);
+    milter_manager_dnsbl_add_zone(dnsbl, "zen.example.com", "127.0.0.10/31",
+                                  NULL);
+    g_hash_table_insert(server_answers, "2.0.0.127.bl.example.com",
+                        "127.0.0.2");
+    g_hash_table_insert(server_answers, "2.0.0.127.zen.example.com",
+                        "127.0.0.2");
+    g_hash_table_insert(server_answers, "10.0.0.127.zen.example.com",
+                        "127.0.0.11");
+    cut_assert_true(milter_manager_dnsbl_set_name_server(dnsbl,
+                                                         start_server(),
+                                                         NULL));
+}
+
+static const struct sockaddr *
+ipv4_address (const gchar *address_string, socklen_t *address_length)
+{
+    struct sockaddr_in *address;
+
+    address = g_new0(struct sockaddr_in, 1);
+    address->sin_family = AF_INET;
+    inet_pton(AF_INET, address_string, &(address->sin_addr));
+    *address_length = sizeof(*address);
+
+    return cut_take_memory(address);
+}
+
+static void
+cb_checked (MilterManagerDNSBL *dnsbl, gboolean is_listed, gpointer user_data)
+{
+    n_checked++;
+    listed = is_listed;
+}
+
+static gboolean
+cb_timeout_waiting (gpointer data)
+{
+    gboolean *waiting = data;
+
+    *waiting = FALSE;
+    return FALSE;
+}
+
+#define wait_checked(expected)                  \
+    cut_trace_with_info_expression(             \
+        wait_checked_helper(expected),          \
+        wait_checked(expected))
+
+static void
+wait_checked_helper (guint expected)
+{
+    gboolean timeout_waiting = TRUE;
+    guint timeout_waiting_id;
+
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, 1.0,
+                                                       cb_timeout_waiting,
+                                                       &timeout_waiting);
+    while (timeout_waiting && expected > n_checked) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    milter_event_loop_remove(loop, timeout_waiting_id);
+
+    cut_assert_true(timeout_waiting,
+                    cut_message("timeout: expect:<%u> actual:<%u>",
+                                expected, n_checked));
+}
+
+static guint
+check (const gchar *address_string)
+{
+    const struct sockaddr *address;
+    socklen_t address_length;
+
+    address = ipv4_address(address_string, &address_length);
+    return milter_manager_dnsbl_check(dnsbl, loop, address, address_length,
+                                      cb_checked, NULL);
+}
+
+static gboolean
+is_listed (const gchar *address_string)
+{
+    const struct sockaddr *address;
+    socklen_t address_length;
+
+    address = ipv4_address(address_string, &address_length);
+    return milter_manager_dnsbl_is_listed(dnsbl, address, address_length);
+}
+
+void
+test_add_zone (void)
+{
+    cut_assert_equal_uint(0, milter_manager_dnsbl_get_n_zones(dnsbl));
+    milter_manager_dnsbl_add_zone(dnsbl, "bl.example.com.", NULL,
+                                  &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_dnsbl_add_zone(dnsbl, "zen.example.com", "127.0.0.10/31",
+                                  &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_uint(2, milter_manager_dnsbl_get_n_zones(dnsbl));
+
+    milter_manager_dnsbl_clear_zones(dnsbl);
+    cut_assert_equal_uint(0, milter_manager_dnsbl_get_n_zones(dnsbl));
+}
+
+void
+data_add_zone_error (void)
+{
+#define ADD(label, zone, network, code, message)                        \
+    gcut_add_datum(label,                                               \
+                   "zone", G_TYPE_STRING, zone,                         \
+                   "network", G_TYPE_STRING, network,                   \
+                   "code", G_TYPE_INT, code,                            \
+                   "message", G_TYPE_STRING, message,                   \
+                   NULL)
+
+    ADD("empty zone", "", NULL,
+        MILTER_MANAGER_DNSBL_ERROR_INVALID_ZONE,
+        "invalid DNSBL zone: <>");
+    ADD("empty label", "bl..example.com", NULL,
+        MILTER_MANAGER_DNSBL_ERROR_INVALID_ZONE,
+        "invalid DNSBL zone: <bl..example.com>");
+    ADD("invalid address", "bl.example.com", "127.0.0.256",
+        MILTER_MANAGER_DNSBL_ERROR_INVALID_NETWORK,
+        "invalid expected network: <127.0.0.256>");
+    ADD("invalid prefix", "bl.example.com", "127.0.0.0/33",
+        MILTER_MANAGER_DNSBL_ERROR_INVALID_NETWORK,
+        "invalid expected network: <127.0.0.0/33>");
+
+#undef ADD
+}
+
+void
+test_add_zone_error (gconstpointer data)
+{
+    expected_error = g_error_new(MILTER_MANAGER_DNSBL_ERROR,
+                                 gcut_data_get_int(data, "code"),
+                                 "%s",
+                                 gcut_data_get_string(data, "message"));
+    cut_assert_false(
+        milter_manager_dnsbl_add_zone(dnsbl,
+                                      gcut_data_get_string(data, "zone"),
+                                      gcut_data_get_string(data, "network"),
+                                      &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+    cut_assert_equal_uint(0, milter_manager_dnsbl_get_n_zones(dnsbl));
+}
+
+void
+test_name_server (void)
+{
+    cut_assert_null(milter_manager_dnsbl_get_name_server(dnsbl));
+
+    milter_manager_dnsbl_set_name_server(dnsbl, "192.168.1.1:5353",
+                                         &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_string("192.168.1.1:5353",
+                            milter_manager_dnsbl_get_name_server(dnsbl));
+
+    milter_manager_dnsbl_set_name_server(dnsbl, "[::1]:53", &actual_error);
+    gcut_assert_error(actual_error);
+    milter_manager_dnsbl_set_name_server(dnsbl, "::1", &actual_error);
+    gcut_assert_error(actual_error);
+    cut_assert_equal_string("::1",
+                            milter_manager_dnsbl_get_name_server(dnsbl));
+}
+
+void
+test_name_server_error (void)
+{
+    expected_error = g_error_new(MILTER_MANAGER_DNSBL_ERROR,
+                                 MILTER_MANAGER_DNSBL_ERROR_INVALID_NAME_SERVER,
+                                 "invalid name server: <127.0.0.1:99999>");
+    cut_assert_false(milter_manager_dnsbl_set_name_server(dnsbl,
+                                                          "127.0.0.1:99999",
+                                                          &actual_error));
+    gcut_assert_equal_error(expected_error, actual_error);
+}
+
+void
+test_listed (void)
+{
+    setup_zones();
+
+    cut_assert_operator_uint(0, <, check("127.0.0.2"));
+    cut_assert_false(is_listed("127.0.0.2"));
+    wait_checked(1);
+    cut_assert_true(listed);
+    cut_assert_true(is_listed("127.0.0.2"));
+}
+
+void
+test_not_listed (void)
+{
+    setup_zones();
+
+    listed = TRUE;
+    cut_assert_operator_uint(0, <, check("127.0.0.3"));
+    wait_checked(1);
+    cut_assert_false(listed);
+    gcut_assert_equal_list_string(
+        gcut_take_new_list_string("3.0.0.127.bl.example.com",
+                                  "3.0.0.127.zen.example.com",
+                                  NULL),
+        server_queries);
+    cut_assert_equal_uint(1, milter_manager_dnsbl_get_cache_size(dnsbl));
+}
+
+void
+test_expected_network (void)
+{
+    setup_zones();
+    g_hash_table_remove(server_answers, "2.0.0.127.bl.example.com");
+
+    check("127.0.0.2");
+    wait_checked(1);
+    cut_assert_false(listed);
+
+    check("127.0.0.10");
+    wait_checked(2);
+    cut_assert_true(listed);
+}
+
+void
+test_cache (void)
+{
+    setup_zones();
+
+    check("127.0.0.2");
+    wait_checked(1);
+    cut_assert_equal_uint(0, check("127.0.0.2"));
+    cut_assert_true(is_listed("127.0.0.2"));
+
+    milter_manager_dnsbl_clear_cache(dnsbl);
+    cut_assert_equal_uint(0, milter_manager_dnsbl_get_cache_size(dnsbl));
+    cut_assert_false(is_listed("127.0.0.2"));
+}
+
+void
+test_max_cache_size (void)
+{
+    setup_zones();
+    milter_manager_dnsbl_set_max_cache_size(dnsbl, 1);
+
+    check("127.0.0.2");
+    wait_checked(1);
+    check("127.0.0.3");
+    wait_checked(2);
+
+    cut_assert_equal_uint(1, milter_manager_dnsbl_get_cache_size(dnsbl));
+    cut_assert_false(is_listed("127.0.0.2"));
+}
+
+void
+test_shared_lookup (void)
+{
+    setup_zones();
+
+    cut_assert_operator_uint(0, <, check("127.0.0.3"));
+    cut_assert_operator_uint(0, <, check("127.0.0.3"));
+    wait_checked(2);
+    cut_assert_equal_uint(2, g_list_length(server_queries));
+}
+
+void
+test_timeout (void)
+{
+    setup_zones();
+    milter_manager_dnsbl_add_zone(dnsbl, "silent.example.com", NULL, NULL);
+    milter_manager_dnsbl_set_timeout(dnsbl, 0.1);
+
+    listed = TRUE;
+    check("127.0.0.3");
+    wait_checked(1);
+    cut_assert_false(listed);
+    cut_assert_equal_uint(0, milter_manager_dnsbl_get_cache_size(dnsbl));
+}
+
+void
+test_cancel (void)
+{
+    guint id;
+
+    setup_zones();
+
+    id = check("127.0.0.2");
+    milter_manager_dnsbl_cancel(dnsbl, id);
+    check("127.0.0.3");
+    wait_checked(1);
+    cut_assert_equal_uint(1, n_checked);
+    cut_assert_false(listed);
+}
+
+void
+test_ipv6 (void)
+{
+    struct sockaddr_in6 address;
+
+    setup_zones();
+
+    memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "2001:db8::1", &(address.sin6_addr));
+    cut_assert_equal_uint(0,
+                          milter_manager_dnsbl_check(dnsbl, loop,
+                                                     (struct sockaddr *)&address,
+                                                     sizeof(address),
+                                                     cb_checked, NULL));
+    cut_assert_null(server_queries);
+}
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -22,6 +22,8 @@
 #endif
 
 #include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <milter-test-utils.h>
 #include <milter-manager-test-utils.h>
@@ -55,6 +57,19 @@ void test_command (void);
 void test_command_options (void);
 void test_fallback_status (void);
 void test_evaluation_mode (void);
+void test_connection_pool_size (void);
+void test_connection_pool_idle_timeout (void);
+void test_connection_pool (void);
+void test_connection_pool_option_mismatch (void);
+void test_connection_pool_broken (void);
+void test_connection_pool_broken_release (void);
+void test_connection_pool_full (void);
+void test_launch_interval (void);
+void test_try_launch (void);
+void test_alive_waiter (void);
+void test_circuit_breaker (void);
+void test_circuit_breaker_half_open (void);
+void test_circuit_breaker_slow_reply (void);
 void test_merge (void);
 void test_applicable_condition (void);
 void test_attach_applicable_conditions (void);
@@ -74,6 +89,18 @@ static GList *expected_applicable_conditions;
 
 static gchar *actual_xml;
 
+static gint peer_fd;
+static GIOChannel *channel;
+static GIOChannel *leased_channel;
+static MilterOption *option;
+static MilterOption *negotiate_reply_option;
+static MilterOption *leased_negotiate_reply_option;
+static MilterMacrosRequests *macros_requests;
+static MilterMacrosRequests *leased_macros_requests;
+
+
+static MilterEventLoop *loop;
+static guint n_alive_calls;
 
 static const gchar *milter_log_level;
 
@@ -94,6 +121,18 @@ setup (void)
 
     actual_xml = NULL;
 
+    peer_fd = -1;
+    channel = NULL;
+    leased_channel = NULL;
+    option = NULL;
+    negotiate_reply_option = NULL;
+    leased_negotiate_reply_option = NULL;
+    macros_requests = NULL;
+    leased_macros_requests = NULL;
+
+    loop = NULL;
+    n_alive_calls = 0;
+
     milter_log_level = g_getenv("MILTER_LOG_LEVEL");
 }
 
@@ -127,6 +166,26 @@ teardown (void)
     if (actual_xml)
         g_free(actual_xml);
 
+    if (peer_fd != -1)
+        close(peer_fd);
+    if (channel)
+        g_io_channel_unref(channel);
+    if (leased_channel)
+        g_io_channel_unref(leased_channel);
+    if (option)
+        g_object_unref(option);
+    if (negotiate_reply_option)
+        g_object_unref(negotiate_reply_option);
+    if (leased_negotiate_reply_option)
+        g_object_unref(leased_negotiate_reply_option);
+    if (macros_requests)
+        g_object_unref(macros_requests);
+    if (leased_macros_requests)
+        g_object_unref(leased_macros_requests);
+
+    if (loop)
+        g_object_unref(loop);
+
     if (milter_log_level)
         g_setenv("MILTER_LOG_LEVEL", milter_log_level, TRUE);
 }
@@ -396,6 +455,171 @@ test_evaluation_mode (void)
     cut_assert_true(milter_manager_child_is_evaluation_mode(child));
 }
 
+void
+test_connection_pool_size (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    cut_assert_equal_uint(0, milter_manager_egg_get_connection_pool_size(egg));
+
+    milter_manager_egg_set_connection_pool_size(egg, 4);
+    cut_assert_equal_uint(4, milter_manager_egg_get_connection_pool_size(egg));
+}
+
+void
+test_connection_pool_idle_timeout (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    cut_assert_equal_double(60.0, 0.0,
+                            milter_manager_egg_get_connection_pool_idle_timeout(egg));
+
+    milter_manager_egg_set_connection_pool_idle_timeout(egg, 29.0);
+    cut_assert_equal_double(29.0, 0.0,
+                            milter_manager_egg_get_connection_pool_idle_timeout(egg));
+}
+
+static void
+setup_pooled_connection (void)
+{
+    gint fds[2];
+
+    cut_assert_equal_int(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    channel = g_io_channel_unix_new(fds[0]);
+    g_io_channel_set_close_on_unref(channel, TRUE);
+    peer_fd = fds[1];
+
+    option = milter_option_new(6,
+                               MILTER_ACTION_ADD_HEADERS,
+                               MILTER_STEP_NO_HELO);
+    negotiate_reply_option = milter_option_new(6,
+                                               MILTER_ACTION_ADD_HEADERS,
+                                               MILTER_STEP_NONE);
+    macros_requests = milter_macros_requests_new();
+}
+
+void
+test_connection_pool (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    setup_pooled_connection();
+
+    cut_assert_false(milter_manager_egg_release_connection(egg,
+                                                           channel,
+                                                           option,
+                                                           negotiate_reply_option,
+                                                           macros_requests));
+
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          channel,
+                                                          option,
+                                                          negotiate_reply_option,
+                                                          macros_requests));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_released_connections(egg));
+
+    leased_channel =
+        milter_manager_egg_lease_connection(egg,
+                                            option,
+                                            &leased_negotiate_reply_option,
+                                            &leased_macros_requests);
+    cut_assert_equal_pointer(channel, leased_channel);
+    cut_assert_true(milter_option_equal(negotiate_reply_option,
+                                        leased_negotiate_reply_option));
+    cut_assert_equal_pointer(macros_requests, leased_macros_requests);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_reused_connections(egg));
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_missed_connections(egg));
+}
+
+void
+test_connection_pool_option_mismatch (void)
+{
+    MilterOption *other_option;
+
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          channel,
+                                                          option,
+                                                          negotiate_reply_option,
+                                                          macros_requests));
+
+    other_option = milter_option_new(6,
+                                     MILTER_ACTION_ADD_HEADERS,
+                                     MILTER_STEP_NONE);
+    leased_channel =
+        milter_manager_egg_lease_connection(egg,
+                                            other_option,
+                                            &leased_negotiate_reply_option,
+                                            &leased_macros_requests);
+    g_object_unref(other_option);
+    cut_assert_null(leased_channel);
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_missed_connections(egg));
+}
+
+void
+test_connection_pool_broken (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          channel,
+                                                          option,
+                                                          negotiate_reply_option,
+                                                          macros_requests));
+    close(peer_fd);
+    peer_fd = -1;
+
+    leased_channel =
+        milter_manager_egg_lease_connection(egg,
+                                            option,
+                                            &leased_negotiate_reply_option,
+                                            &leased_macros_requests);
+    cut_assert_null(leased_channel);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_broken_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_missed_connections(egg));
+}
+
+void
+test_connection_pool_broken_release (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_count_broken_connection(egg);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_released_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_broken_connections(egg));
+}
+
+void
+test_connection_pool_full (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_connection_pool_size(egg, 1);
+    setup_pooled_connection();
+
+    cut_assert_true(milter_manager_egg_release_connection(egg,
+                                                          channel,
+                                                          option,
+                                                          negotiate_reply_option,
+                                                          macros_requests));
+    cut_assert_false(milter_manager_egg_release_connection(egg,
+                                                           channel,
+                                                           option,
+                                                           negotiate_reply_option,
+                                                           macros_requests));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_pooled_connections(egg));
+
+    milter_manager_egg_set_connection_pool_idle_timeout(egg, 0.0);
+    milter_manager_egg_expire_pooled_connections(egg);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_pooled_connections(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_expired_connections(egg));
+}
+
 void
 test_applicable_condition (void)
 {
@@ -442,6 +666,140 @@ test_attach_applicable_conditions (void)
     cut_assert_true(attached_to);
 }
 
+void
+test_launch_interval (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    cut_assert_equal_double(1.0, 0.0,
+                            milter_manager_egg_get_launch_interval(egg));
+    cut_assert_equal_double(60.0, 0.0,
+                            milter_manager_egg_get_maximum_launch_interval(egg));
+
+    milter_manager_egg_set_launch_interval(egg, 0.5);
+    milter_manager_egg_set_maximum_launch_interval(egg, 300.0);
+    cut_assert_equal_double(0.5, 0.0,
+                            milter_manager_egg_get_launch_interval(egg));
+    cut_assert_equal_double(300.0, 0.0,
+                            milter_manager_egg_get_maximum_launch_interval(egg));
+}
+
+void
+test_try_launch (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    loop = milter_test_event_loop_new();
+    milter_manager_egg_set_launch_interval(egg, 60.0);
+
+    cut_assert_true(milter_manager_egg_try_launch(egg));
+    cut_assert_false(milter_manager_egg_try_launch(egg));
+    cut_assert_false(milter_manager_egg_try_launch(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_launches(egg));
+    cut_assert_equal_uint(2, milter_manager_egg_get_n_suppressed_launches(egg));
+
+    milter_manager_egg_mark_alive(egg, loop);
+    cut_assert_true(milter_manager_egg_try_launch(egg));
+    cut_assert_equal_uint(2, milter_manager_egg_get_n_launches(egg));
+}
+
+void
+test_circuit_breaker (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    cut_assert_true(milter_manager_egg_pass_circuit_breaker(egg));
+    milter_manager_egg_report_reply(egg, FALSE, 0.0);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_circuit_breaker_opens(egg));
+
+    milter_manager_egg_set_circuit_breaker_window_size(egg, 4);
+    milter_manager_egg_report_reply(egg, FALSE, 0.0);
+    milter_manager_egg_report_reply(egg, TRUE, 0.0);
+    milter_manager_egg_report_reply(egg, TRUE, 0.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+
+    milter_manager_egg_report_reply(egg, FALSE, 0.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+    cut_assert_equal_double(0.5, 0.0,
+                            milter_manager_egg_get_circuit_breaker_current_error_rate(egg));
+    cut_assert_false(milter_manager_egg_pass_circuit_breaker(egg));
+    cut_assert_false(milter_manager_egg_pass_circuit_breaker(egg));
+    cut_assert_equal_uint(1, milter_manager_egg_get_n_circuit_breaker_opens(egg));
+    cut_assert_equal_uint(2,
+                          milter_manager_egg_get_n_circuit_breaker_rejections(egg));
+}
+
+void
+test_circuit_breaker_half_open (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_circuit_breaker_window_size(egg, 1);
+    milter_manager_egg_set_circuit_breaker_open_time(egg, 0.0);
+
+    milter_manager_egg_report_reply(egg, FALSE, 0.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+
+    cut_assert_true(milter_manager_egg_pass_circuit_breaker(egg));
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+    milter_manager_egg_report_reply(egg, FALSE, 0.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+    cut_assert_equal_uint(2, milter_manager_egg_get_n_circuit_breaker_opens(egg));
+
+    cut_assert_true(milter_manager_egg_pass_circuit_breaker(egg));
+    milter_manager_egg_report_reply(egg, TRUE, 0.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+    cut_assert_equal_double(0.0, 0.0,
+                            milter_manager_egg_get_circuit_breaker_current_error_rate(egg));
+}
+
+void
+test_circuit_breaker_slow_reply (void)
+{
+    egg = milter_manager_egg_new("child-milter");
+    milter_manager_egg_set_circuit_breaker_window_size(egg, 2);
+    milter_manager_egg_set_circuit_breaker_error_rate(egg, 1.0);
+    milter_manager_egg_set_circuit_breaker_slow_reply_time(egg, 1.0);
+
+    milter_manager_egg_report_reply(egg, TRUE, 0.5);
+    milter_manager_egg_report_reply(egg, TRUE, 1.5);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_CLOSED,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+
+    milter_manager_egg_report_reply(egg, TRUE, 2.0);
+    cut_assert_equal_int(MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN,
+                         milter_manager_egg_get_circuit_breaker_state(egg));
+}
+
+static void
+cb_alive (MilterManagerEgg *egg, gpointer user_data)
+{
+    n_alive_calls++;
+}
+
+void
+test_alive_waiter (void)
+{
+    guint id;
+
+    egg = milter_manager_egg_new("child-milter");
+    loop = milter_test_event_loop_new();
+
+    milter_manager_egg_add_alive_waiter(egg, loop, cb_alive, NULL);
+    id = milter_manager_egg_add_alive_waiter(egg, loop, cb_alive, NULL);
+    milter_manager_egg_add_alive_waiter(egg, loop, cb_alive, NULL);
+    cut_assert_equal_uint(3, milter_manager_egg_get_n_alive_waiters(egg));
+
+    milter_manager_egg_remove_alive_waiter(egg, loop, id);
+    cut_assert_equal_uint(2, milter_manager_egg_get_n_alive_waiters(egg));
+
+    milter_manager_egg_mark_alive(egg, loop);
+    cut_assert_equal_uint(2, n_alive_calls);
+    cut_assert_equal_uint(0, milter_manager_egg_get_n_alive_waiters(egg));
+}
+
 void
 test_merge (void)
 {
@@ -455,6 +813,8 @@ test_merge (void)
     milter_manager_egg_set_writing_timeout(egg, 2.929);
     milter_manager_egg_set_reading_timeout(egg, 2.92929);
     milter_manager_egg_set_end_of_message_timeout(egg, 29.29);
+    milter_manager_egg_set_connection_pool_size(egg, 29);
+    milter_manager_egg_set_connection_pool_idle_timeout(egg, 2.9);
     milter_manager_egg_set_user_name(egg, "milter-user");
     milter_manager_egg_set_command(egg, "milter-test-client");
     milter_manager_egg_set_command_options(egg, "-s inet:2929@localhost");
@@ -493,6 +853,11 @@ test_merge (void)
     cut_assert_equal_double(29.29,
                             milter_manager_egg_get_end_of_message_timeout(merged_egg),
                             0.0001);
+    cut_assert_equal_uint(29,
+                          milter_manager_egg_get_connection_pool_size(merged_egg));
+    cut_assert_equal_double(2.9,
+                            milter_manager_egg_get_connection_pool_idle_timeout(merged_egg),
+                            0.01);
     cut_assert_equal_string("milter-user",
                             milter_manager_egg_get_user_name(merged_egg));
     cut_assert_equal_string("milter-test-client",
@@ -540,6 +905,21 @@ test_to_xml (void)
                             "  <additional-field>VALUE</additional-field>\n"
                             "</milter>\n",
                             actual_xml);
+
+    milter_manager_egg_set_connection_pool_size(egg, 4);
+    g_free(actual_xml);
+    actual_xml = milter_manager_egg_to_xml(egg);
+    cut_assert_equal_string("<milter>\n"
+                            "  <name>child-milter</name>\n"
+                            "  <enabled>true</enabled>\n"
+                            "  <fallback-status>accept</fallback-status>\n"
+                            "  <evaluation-mode>false</evaluation-mode>\n"
+                            "  <connection-pool-size>4</connection-pool-size>\n"
+                            "  <connection-pool-idle-timeout>60"
+                            "</connection-pool-idle-timeout>\n"
+                            "  <additional-field>VALUE</additional-field>\n"
+                            "</milter>\n",
+                            actual_xml);
 }
 
 /*
@@ -1625,6 +1625,8 @@ data_scenario_helo (void)
 {
     cut_add_data("helo - reject - evaluation",
                  g_strdup("helo-reject-evaluation.txt"), g_free,
+                 "helo - reject - short circuit",
+                 g_strdup("helo-reject-short-circuit.txt"), g_free,
                  "helo - temporary-failure - evaluation",
                  g_strdup("helo-temporary-failure-evaluation.txt"), g_free,
                  NULL);
@@ -0,0 +1,596 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ *  Copyright (C) 2026  milter manager project
+ *
+ *  This library is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <milter/manager/milter-manager-metrics.h>
+#include <milter/manager/milter-manager-leader.h>
+#include <milter/manager/milter-manager-egg.h>
+
+#include <milter-manager-test-utils.h>
+
+#include <gcutter.h>
+
+void test_new (void);
+void test_slot (void);
+void test_reuse_slot (void);
+void test_reply_duration (void);
+void test_replies (void);
+void test_timeouts (void);
+void test_connections (void);
+void test_spooled_body_bytes (void);
+void test_event_loop_lag (void);
+void test_aggregate_slots (void);
+void test_leaders_xml (void);
+void test_buffered_body_xml (void);
+void test_egg_failures_xml (void);
+void test_egg_in_flight_xml (void);
+void test_reuse_slot_xml (void);
+void test_client_fork (void);
+void test_circuit_breaker_xml (void);
+void test_launch_xml (void);
+
+static MilterManagerMetrics *metrics;
+static MilterClient *client;
+static gchar *actual;
+
+void
+setup (void)
+{
+    metrics = NULL;
+    client = NULL;
+    actual = NULL;
+}
+
+void
+teardown (void)
+{
+    if (metrics)
+        g_object_unref(metrics);
+    if (client)
+        g_object_unref(client);
+    if (actual)
+        g_free(actual);
+}
+
+static void
+dump (void)
+{
+    if (actual)
+        g_free(actual);
+    actual = milter_manager_metrics_to_open_metrics(metrics);
+}
+
+static void
+dump_xml (const gchar *egg_name)
+{
+    GString *string;
+
+    if (actual)
+        g_free(actual);
+    string = g_string_new("\n");
+    if (egg_name)
+        milter_manager_metrics_egg_to_xml_string(metrics, egg_name, string, 0);
+    else
+        milter_manager_metrics_to_xml_string(metrics, string, 0);
+    actual = g_string_free(string, FALSE);
+}
+
+static void
+dump_launch_xml (const gchar *egg_name)
+{
+    GString *string;
+
+    if (actual)
+        g_free(actual);
+    string = g_string_new("\n");
+    milter_manager_metrics_egg_launch_to_xml_string(metrics, egg_name,
+                                                    string, 0);
+    actual = g_string_free(string, FALSE);
+}
+
+static void
+dump_circuit_breaker_xml (const gchar *egg_name)
+{
+    GString *string;
+
+    if (actual)
+        g_free(actual);
+    string = g_string_new("\n");
+    milter_manager_metrics_egg_circuit_breaker_to_xml_string(metrics,
+                                                             egg_name,
+                                                             string,
+                                                             0);
+    actual = g_string_free(string, FALSE);
+}
+
+static void
+assert_have_line (const gchar *line)
+{
+    const gchar *pattern;
+
+    pattern = cut_take_printf("\n%s\n", line);
+    cut_assert_not_null(strstr(actual, pattern),
+                        cut_message("<%s>\n%s", line, actual));
+}
+
+static void
+assert_not_have_line (const gchar *line)
+{
+    const gchar *pattern;
+
+    pattern = cut_take_printf("\n%s\n", line);
+    cut_assert_null(strstr(actual, pattern),
+                    cut_message("<%s>\n%s", line, actual));
+}
+
+void
+test_new (void)
+{
+    metrics = milter_manager_metrics_new(3);
+    cut_assert_equal_uint(3, milter_manager_metrics_get_n_slots(metrics));
+    cut_assert_equal_uint(0, milter_manager_metrics_get_slot(metrics));
+}
+
+void
+test_slot (void)
+{
+    metrics = milter_manager_metrics_new(3);
+    milter_manager_metrics_set_slot(metrics, 2);
+    cut_assert_equal_uint(2, milter_manager_metrics_get_slot(metrics));
+    milter_manager_metrics_set_slot(metrics, 3);
+    cut_assert_equal_uint(2, milter_manager_metrics_get_slot(metrics));
+}
+
+void
+test_reuse_slot (void)
+{
+    metrics = milter_manager_metrics_new(2);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_open_child(metrics, "milter@10026");
+    milter_manager_metrics_set_event_loop_lag(metrics, 0.5);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_DATA,
+                                         MILTER_STATUS_ACCEPT,
+                                         0.1);
+    milter_manager_metrics_count_timeout(metrics,
+                                         "milter@10026",
+                                         MILTER_MANAGER_METRICS_TIMEOUT_READING);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 29);
+
+    /* A respawned worker reclaims the slot. */
+    milter_manager_metrics_set_slot(metrics, 0);
+    milter_manager_metrics_set_slot(metrics, 1);
+    dump();
+
+    assert_have_line("milter_manager_child_connections"
+                     "{milter=\"milter@10026\"} 0");
+    assert_have_line("milter_manager_event_loop_lag_seconds"
+                     "{worker=\"1\"} 0.000000");
+    assert_have_line("milter_manager_child_replies_total"
+                     "{milter=\"milter@10026\",status=\"accept\"} 1");
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{milter=\"milter@10026\",kind=\"reading\"} 1");
+    assert_have_line("milter_manager_body_spooled_bytes_total 29");
+}
+
+void
+test_reply_duration (void)
+{
+    const gchar *labels = "milter=\"milter@10026\",stage=\"connect\"";
+
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_CONNECT,
+                                         MILTER_STATUS_CONTINUE,
+                                         0.003);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_CONNECT,
+                                         MILTER_STATUS_CONTINUE,
+                                         20.0);
+    dump();
+
+    assert_have_line("# TYPE milter_manager_child_reply_duration_seconds "
+                     "histogram");
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_bucket"
+                         "{%s,le=\"0.001\"} 0", labels));
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_bucket"
+                         "{%s,le=\"0.005\"} 1", labels));
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_bucket"
+                         "{%s,le=\"10\"} 1", labels));
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_bucket"
+                         "{%s,le=\"+Inf\"} 2", labels));
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_sum"
+                         "{%s} 20.003000", labels));
+    assert_have_line(cut_take_printf(
+                         "milter_manager_child_reply_duration_seconds_count"
+                         "{%s} 2", labels));
+}
+
+void
+test_replies (void)
+{
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_HELO,
+                                         MILTER_STATUS_REJECT,
+                                         0.1);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_ENVELOPE_FROM,
+                                         MILTER_STATUS_REJECT,
+                                         0.1);
+    dump();
+
+    assert_have_line("milter_manager_child_replies_total"
+                     "{milter=\"milter@10026\",status=\"reject\"} 2");
+    assert_not_have_line("milter_manager_child_replies_total"
+                         "{milter=\"milter@10026\",status=\"continue\"} 0");
+}
+
+void
+test_timeouts (void)
+{
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_count_timeout(
+        metrics,
+        "milter@10026",
+        MILTER_MANAGER_METRICS_TIMEOUT_READING);
+    milter_manager_metrics_count_timeout(
+        metrics,
+        "milter@10026",
+        MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE);
+    milter_manager_metrics_count_timeout(
+        metrics,
+        "milter@10026",
+        MILTER_MANAGER_METRICS_TIMEOUT_END_OF_MESSAGE);
+    dump();
+
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{milter=\"milter@10026\",kind=\"writing\"} 0");
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{milter=\"milter@10026\",kind=\"reading\"} 1");
+    assert_have_line("milter_manager_child_timeouts_total"
+                     "{milter=\"milter@10026\",kind=\"end-of-message\"} 2");
+}
+
+void
+test_connections (void)
+{
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_open_child(metrics, "milter@10026");
+    milter_manager_metrics_open_child(metrics, "milter@10026");
+    milter_manager_metrics_close_child(metrics, "milter@10026");
+    milter_manager_metrics_close_child(metrics, "milter@10027");
+    dump();
+
+    assert_have_line("milter_manager_child_connections"
+                     "{milter=\"milter@10026\"} 1");
+    assert_have_line("milter_manager_child_connections"
+                     "{milter=\"milter@10027\"} 0");
+}
+
+void
+test_spooled_body_bytes (void)
+{
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 29);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 100);
+    dump();
+
+    assert_have_line("milter_manager_body_spooled_bytes_total 129");
+}
+
+void
+test_event_loop_lag (void)
+{
+    metrics = milter_manager_metrics_new(2);
+    milter_manager_metrics_set_event_loop_lag(metrics, 0.5);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_set_event_loop_lag(metrics, 0.25);
+    dump();
+
+    assert_have_line("milter_manager_event_loop_lag_seconds"
+                     "{worker=\"0\"} 0.500000");
+    assert_have_line("milter_manager_event_loop_lag_seconds"
+                     "{worker=\"1\"} 0.250000");
+}
+
+void
+test_aggregate_slots (void)
+{
+    metrics = milter_manager_metrics_new(3);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_DATA,
+                                         MILTER_STATUS_ACCEPT,
+                                         0.1);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 10);
+    milter_manager_metrics_set_slot(metrics, 2);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10027",
+                                         MILTER_SERVER_CONTEXT_STATE_DATA,
+                                         MILTER_STATUS_ACCEPT,
+                                         0.1);
+    milter_manager_metrics_observe_reply(metrics,
+                                         "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_DATA,
+                                         MILTER_STATUS_ACCEPT,
+                                         0.1);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 20);
+    dump();
+
+    assert_have_line("milter_manager_child_replies_total"
+                     "{milter=\"milter@10026\",status=\"accept\"} 2");
+    assert_have_line("milter_manager_child_replies_total"
+                     "{milter=\"milter@10027\",status=\"accept\"} 1");
+    assert_have_line("milter_manager_body_spooled_bytes_total 30");
+}
+
+void
+test_leaders_xml (void)
+{
+    metrics = milter_manager_metrics_new(2);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_INVALID,
+                                          MILTER_MANAGER_LEADER_STATE_START);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_START,
+                                          MILTER_MANAGER_LEADER_STATE_CONNECT);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_INVALID,
+                                          MILTER_MANAGER_LEADER_STATE_CONNECT);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_INVALID,
+                                          MILTER_MANAGER_LEADER_STATE_HELO);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_HELO,
+                                          MILTER_MANAGER_LEADER_STATE_INVALID);
+    dump_xml(NULL);
+
+    assert_have_line("    <name>connect</name>");
+    assert_have_line("    <count>2</count>");
+    assert_not_have_line("    <name>start</name>");
+    assert_not_have_line("    <name>helo</name>");
+}
+
+void
+test_buffered_body_xml (void)
+{
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_add_buffered_body_bytes(metrics, 100);
+    milter_manager_metrics_add_buffered_body_bytes(metrics, 29);
+    milter_manager_metrics_add_buffered_body_bytes(metrics, -100);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 10);
+    dump_xml(NULL);
+
+    assert_have_line("  <buffered>29</buffered>");
+    assert_have_line("  <spooled>10</spooled>");
+}
+
+void
+test_egg_failures_xml (void)
+{
+    metrics = milter_manager_metrics_new(2);
+    milter_manager_metrics_open_child(metrics, "milter@10026");
+    milter_manager_metrics_count_connect_failure(metrics, "milter@10026");
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_count_connect_failure(metrics, "milter@10026");
+    milter_manager_metrics_count_negotiate_failure(metrics, "milter@10026");
+    milter_manager_metrics_count_negotiate_failure(metrics, "milter@10027");
+    dump_xml("milter@10026");
+
+    assert_have_line("<connections>1</connections>");
+    assert_have_line("<connect-failures>2</connect-failures>");
+    assert_have_line("<negotiate-failures>1</negotiate-failures>");
+}
+
+void
+test_egg_in_flight_xml (void)
+{
+    gint64 now;
+
+    now = g_get_monotonic_time();
+    metrics = milter_manager_metrics_new(1);
+    milter_manager_metrics_start_command(metrics, "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_HEADER,
+                                         now);
+    milter_manager_metrics_start_command(metrics, "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_HEADER,
+                                         now);
+    milter_manager_metrics_start_command(metrics, "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_BODY,
+                                         now);
+    milter_manager_metrics_finish_command(metrics, "milter@10026",
+                                          MILTER_SERVER_CONTEXT_STATE_BODY,
+                                          now);
+    dump_xml("milter@10026");
+
+    assert_have_line("    <name>header</name>");
+    assert_have_line("    <count>2</count>");
+    assert_not_have_line("    <name>body</name>");
+}
+
+void
+test_reuse_slot_xml (void)
+{
+    metrics = milter_manager_metrics_new(2);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_transit_leader(metrics,
+                                          MILTER_MANAGER_LEADER_STATE_INVALID,
+                                          MILTER_MANAGER_LEADER_STATE_BODY);
+    milter_manager_metrics_add_buffered_body_bytes(metrics, 100);
+    milter_manager_metrics_add_spooled_body_bytes(metrics, 10);
+    milter_manager_metrics_open_child(metrics, "milter@10026");
+    milter_manager_metrics_count_connect_failure(metrics, "milter@10026");
+    milter_manager_metrics_start_command(metrics, "milter@10026",
+                                         MILTER_SERVER_CONTEXT_STATE_BODY,
+                                         g_get_monotonic_time());
+
+    /* A respawned worker reclaims the slot. */
+    milter_manager_metrics_set_slot(metrics, 0);
+    milter_manager_metrics_set_slot(metrics, 1);
+
+    dump_xml(NULL);
+    assert_have_line("<leaders>");
+    assert_have_line("</leaders>");
+    assert_not_have_line("    <name>body</name>");
+    assert_have_line("  <buffered>0</buffered>");
+    assert_have_line("  <spooled>10</spooled>");
+
+    dump_xml("milter@10026");
+    assert_have_line("<connections>0</connections>");
+    assert_have_line("<connect-failures>1</connect-failures>");
+    assert_have_line("<in-flight>");
+    assert_have_line("</in-flight>");
+    assert_not_have_line("    <name>body</name>");
+}
+void
+test_client_fork (void)
+{
+    GPid pid;
+    gint status;
+
+    client = milter_client_new();
+    milter_client_set_n_workers(client, 1);
+    metrics = milter_manager_metrics_new_with_client(client);
+    cut_assert_equal_uint(2, milter_manager_metrics_get_n_slots(metrics));
+
+    pid = fork();
+    if (pid == 0) {
+        milter_manager_metrics_set_slot(metrics, 1);
+        milter_manager_metrics_open_child(metrics, "milter@10026");
+        milter_manager_metrics_count_connect_failure(metrics, "milter@10026");
+        milter_manager_metrics_transit_leader(metrics,
+                                              MILTER_MANAGER_LEADER_STATE_INVALID,
+                                              MILTER_MANAGER_LEADER_STATE_BODY);
+        _exit(EXIT_SUCCESS);
+    }
+    cut_assert_operator_int(0, <, pid);
+    cut_assert_equal_int(pid, waitpid(pid, &status, 0));
+    cut_assert_true(WIFEXITED(status));
+
+    dump_xml(NULL);
+    assert_have_line("    <name>body</name>");
+    dump_xml("milter@10026");
+    assert_have_line("<connections>1</connections>");
+    assert_have_line("<connect-failures>1</connect-failures>");
+
+    /* The master clears the gauges of the dead worker. */
+    milter_manager_metrics_clear_slot(metrics, 1);
+    dump_xml(NULL);
+    assert_not_have_line("    <name>body</name>");
+    dump_xml("milter@10026");
+    assert_have_line("<connections>0</connections>");
+    assert_have_line("<connect-failures>1</connect-failures>");
+}
+
+
+void
+test_circuit_breaker_xml (void)
+{
+    metrics = milter_manager_metrics_new(3);
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_set_circuit_breaker(
+        metrics, "milter@10026",
+        MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN, 0.5);
+    milter_manager_metrics_count_circuit_breaker_rejection(metrics,
+                                                           "milter@10026");
+    milter_manager_metrics_count_circuit_breaker_rejection(metrics,
+                                                           "milter@10026");
+    milter_manager_metrics_set_slot(metrics, 2);
+    milter_manager_metrics_set_circuit_breaker(
+        metrics, "milter@10026",
+        MILTER_MANAGER_CIRCUIT_BREAKER_STATE_HALF_OPEN, 0.8);
+    milter_manager_metrics_set_circuit_breaker(
+        metrics, "milter@10026",
+        MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN, 0.8);
+    milter_manager_metrics_set_circuit_breaker(
+        metrics, "milter@10026",
+        MILTER_MANAGER_CIRCUIT_BREAKER_STATE_OPEN, 0.8);
+
+    dump_circuit_breaker_xml("milter@10026");
+    assert_have_line("  <state>open</state>");
+    assert_have_line("  <error-rate>0.8</error-rate>");
+    assert_have_line("  <opened>2</opened>");
+    assert_have_line("  <rejected>2</rejected>");
+
+    /* Dead workers don't keep their circuit breakers open. */
+    milter_manager_metrics_clear_slot(metrics, 1);
+    milter_manager_metrics_clear_slot(metrics, 2);
+    dump_circuit_breaker_xml("milter@10026");
+    assert_have_line("  <state>closed</state>");
+    assert_have_line("  <error-rate>0</error-rate>");
+    assert_have_line("  <opened>2</opened>");
+    assert_have_line("  <rejected>2</rejected>");
+}
+
+
+void
+test_launch_xml (void)
+{
+    metrics = milter_manager_metrics_new(3);
+    milter_manager_metrics_count_launch(metrics, "milter@10026", TRUE);
+    dump_launch_xml("milter@10026");
+    assert_not_have_line("<launch>");
+
+    milter_manager_metrics_set_slot(metrics, 1);
+    milter_manager_metrics_count_launch(metrics, "milter@10026", FALSE);
+    milter_manager_metrics_add_alive_waiters(metrics, "milter@10026", 1);
+    milter_manager_metrics_set_slot(metrics, 2);
+    milter_manager_metrics_count_launch(metrics, "milter@10026", FALSE);
+    milter_manager_metrics_count_launch(metrics, "milter@10026", TRUE);
+    milter_manager_metrics_add_alive_waiters(metrics, "milter@10026", 1);
+    milter_manager_metrics_add_alive_waiters(metrics, "milter@10026", 1);
+    milter_manager_metrics_add_alive_waiters(metrics, "milter@10026", -1);
+
+    dump_launch_xml("milter@10026");
+    assert_have_line("<launch>");
+    assert_have_line("  <launched>2</launched>");
+    assert_have_line("  <suppressed>2</suppressed>");
+    assert_have_line("  <waiting>2</waiting>");
+
+    milter_manager_metrics_clear_slot(metrics, 1);
+    dump_launch_xml("milter@10026");
+    assert_have_line("  <launched>2</launched>");
+    assert_have_line("  <waiting>1</waiting>");
+}
+
+
+/*
+vi:ts=4:nowrap:ai:expandtab:sw=4
+*/
@@ -22,6 +22,7 @@
 #endif
 
 #include <errno.h>
+#include <string.h>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -48,11 +49,16 @@ void test_envelope_recipient_temporary_failure (void);
 void test_envelope_recipient_reject (void);
 void test_envelope_recipient_discard (void);
 void test_envelope_recipient_accept (void);
+void test_stream_headers (void);
+void test_stream_headers_stop (void);
+void test_stream_body (void);
 void test_status (void);
 void test_state (void);
 void test_last_state (void);
 void test_macro (void);
 void test_macros_hash_table (void);
+void test_share_macros_hash_table (void);
+void test_reuse_codecs (void);
 void data_has_accepted_recipient (void);
 void test_has_accepted_recipient (gconstpointer data);
 
@@ -71,6 +77,14 @@ static gboolean command_received;
 static gboolean reply_received;
 static gboolean ready_received;
 static gboolean connection_timeout_received;
+static gboolean stopped_received;
+static GList *transited_states;
+
+static GList *received_headers;
+static guint n_received_headers;
+static guint n_received_bodies;
+static gsize received_body_size;
+static gchar *stop_header_name;
 
 static MilterMessageResult *message_result;
 
@@ -173,6 +187,37 @@ cb_command_received (MilterDecoder *decoder, gpointer user_data)
     }
 }
 
+static void
+cb_header_received (MilterDecoder *decoder,
+                    const gchar *name, const gchar *value,
+                    gpointer user_data)
+{
+    received_headers = g_list_append(received_headers,
+                                     g_strdup_printf("%s: %s", name, value));
+    n_received_headers++;
+
+    if (milter_option_get_step(option) & MILTER_STEP_NO_REPLY_HEADER) {
+        command_received = TRUE;
+        return;
+    }
+    cb_command_received(decoder, user_data);
+}
+
+static void
+cb_body_received (MilterDecoder *decoder,
+                  const gchar *chunk, gsize size,
+                  gpointer user_data)
+{
+    n_received_bodies++;
+    received_body_size += size;
+
+    if (milter_option_get_step(option) & MILTER_STEP_NO_REPLY_BODY) {
+        command_received = TRUE;
+        return;
+    }
+    cb_command_received(decoder, user_data);
+}
+
 static void
 cb_reply_received (MilterServerContext *context, gpointer user_data)
 {
@@ -185,6 +230,29 @@ cb_ready_received (MilterServerContext *context, gpointer user_data)
     ready_received = TRUE;
 }
 
+static void
+cb_stopped (MilterServerContext *context, gpointer user_data)
+{
+    stopped_received = TRUE;
+}
+
+static void
+cb_state_transited (MilterServerContext *context,
+                    MilterServerContextState state,
+                    gpointer user_data)
+{
+    transited_states = g_list_append(transited_states,
+                                     GUINT_TO_POINTER(state));
+}
+
+static gboolean
+cb_stop_on_header (MilterServerContext *context,
+                   const gchar *name, const gchar *value,
+                   gpointer user_data)
+{
+    return stop_header_name && g_str_equal(name, stop_header_name);
+}
+
 static void
 cb_error_received (MilterServerContext *context, GError *error,
                    gpointer user_data)
@@ -229,6 +297,12 @@ setup_server_context_signals (MilterServerContext *context)
 
     g_signal_connect(context, "message-processed",
                      G_CALLBACK(cb_message_processed), NULL);
+    g_signal_connect(context, "stopped",
+                     G_CALLBACK(cb_stopped), NULL);
+    g_signal_connect(context, "state-transited",
+                     G_CALLBACK(cb_state_transited), NULL);
+    g_signal_connect(context, "stop-on-header",
+                     G_CALLBACK(cb_stop_on_header), NULL);
 }
 
 static void
@@ -245,15 +319,16 @@ setup_command_signals (MilterDecoder *decoder)
     CONNECT(helo);
     CONNECT(envelope_from);
     CONNECT(envelope_recipient);
-    CONNECT(header);
     CONNECT(end_of_header);
-    CONNECT(body);
     CONNECT(end_of_message);
     CONNECT(abort);
     CONNECT(quit);
     CONNECT(unknown);
 
 #undef CONNECT
+
+    g_signal_connect(decoder, "header", G_CALLBACK(cb_header_received), NULL);
+    g_signal_connect(decoder, "body", G_CALLBACK(cb_body_received), NULL);
 }
 
 void
@@ -291,6 +366,14 @@ cut_setup (void)
     reply_status = MILTER_STATUS_CONTINUE;
     ready_received = FALSE;
     connection_timeout_received = FALSE;
+    stopped_received = FALSE;
+    transited_states = NULL;
+
+    received_headers = NULL;
+    n_received_headers = 0;
+    n_received_bodies = 0;
+    received_body_size = 0;
+    stop_header_name = NULL;
 
     message_result = NULL;
 }
@@ -319,6 +402,11 @@ cut_teardown (void)
     if (expected_error)
         g_error_free(expected_error);
 
+    if (transited_states)
+        g_list_free(transited_states);
+    if (received_headers)
+        gcut_list_string_free(received_headers);
+
     if (loop)
         g_object_unref(loop);
 }
@@ -433,6 +521,24 @@ wait_for_receiving_reply (void)
     }
 }
 
+static void
+wait_for_receiving_streamed_commands (guint *n_received, guint n_expected)
+{
+    gboolean timeout_waiting = TRUE;
+    guint timeout_waiting_id;
+
+    timeout_waiting_id = milter_event_loop_add_timeout(loop, 2,
+                                                       cb_timeout_waiting,
+                                                       &timeout_waiting);
+    while (timeout_waiting && *n_received < n_expected) {
+        milter_event_loop_iterate(loop, TRUE);
+    }
+    milter_event_loop_remove(loop, timeout_waiting_id);
+    cut_assert_true(timeout_waiting,
+                    cut_message("timeout: expect:<%u> actual:<%u>",
+                                n_expected, *n_received));
+}
+
 void
 test_negotiate (void)
 {
@@ -704,6 +810,113 @@ test_envelope_recipient_accept (void)
                            milter_message_result_get_status(message_result));
 }
 
+static MilterHeaders *
+streamed_headers_new (void)
+{
+    MilterHeaders *headers;
+
+    headers = milter_headers_new();
+    gcut_take_object(G_OBJECT(headers));
+    milter_headers_add_header(headers, "From", " alice@example.com");
+    milter_headers_add_header(headers, "To", " bob@example.com");
+    milter_headers_add_header(headers, "Subject", " Hello");
+
+    return headers;
+}
+
+void
+test_stream_headers (void)
+{
+    MilterAgent *agent = MILTER_AGENT(context);
+
+    milter_option_add_step(option, MILTER_STEP_NO_REPLY_HEADER);
+    cut_trace(test_envelope_recipient());
+    cut_assert_false(milter_server_context_need_reply(
+                         context, MILTER_SERVER_CONTEXT_STATE_HEADER));
+
+    milter_agent_reset_write_statistics(agent);
+    cut_assert_true(milter_server_context_stream_headers(context,
+                                                         streamed_headers_new(),
+                                                         1,
+                                                         TRUE));
+    cut_assert_equal_uint(1, milter_agent_get_n_writes(agent));
+    cut_assert_true(milter_server_context_is_processing(context));
+
+    cut_trace(wait_for_receiving_streamed_commands(&n_received_headers, 3));
+    gcut_assert_equal_list_string(
+        gcut_take_new_list_string("From: alice@example.com",
+                                  "To: bob@example.com",
+                                  "Subject: Hello",
+                                  NULL),
+        received_headers);
+    cut_assert_equal_uint(1, milter_agent_get_n_writes(agent));
+
+    cut_assert_false(milter_server_context_is_processing(context));
+    gcut_assert_equal_enum(MILTER_TYPE_SERVER_CONTEXT_STATE,
+                           MILTER_SERVER_CONTEXT_STATE_HEADER,
+                           GPOINTER_TO_UINT(g_list_last(transited_states)->data));
+}
+
+void
+test_stream_headers_stop (void)
+{
+    MilterAgent *agent = MILTER_AGENT(context);
+    MilterHeaders *result_headers;
+
+    milter_option_add_step(option, MILTER_STEP_NO_REPLY_HEADER);
+    cut_trace(test_envelope_recipient());
+
+    stop_header_name = "To";
+    milter_agent_reset_write_statistics(agent);
+    cut_assert_true(milter_server_context_stream_headers(context,
+                                                         streamed_headers_new(),
+                                                         1,
+                                                         TRUE));
+    cut_assert_true(stopped_received);
+    gcut_assert_equal_enum(MILTER_TYPE_STATUS,
+                           MILTER_STATUS_STOP,
+                           milter_server_context_get_status(context));
+    cut_assert_equal_uint(1, milter_agent_get_n_writes(agent));
+
+    cut_trace(wait_for_receiving_streamed_commands(&n_received_headers, 1));
+    milter_test_pump_all_events(loop);
+    gcut_assert_equal_list_string(
+        gcut_take_new_list_string("From: alice@example.com", NULL),
+        received_headers);
+
+    cut_assert_not_null(message_result);
+    result_headers = milter_message_result_get_headers(message_result);
+    cut_assert_equal_uint(2, milter_headers_length(result_headers));
+}
+
+void
+test_stream_body (void)
+{
+    MilterAgent *agent = MILTER_AGENT(context);
+    gchar *body;
+    guint n_packets = 20;
+    gsize body_size = n_packets * MILTER_CHUNK_SIZE;
+
+    milter_option_add_step(option, MILTER_STEP_NO_REPLY_BODY);
+    cut_trace(test_envelope_recipient());
+    cut_assert_false(milter_server_context_need_reply(
+                         context, MILTER_SERVER_CONTEXT_STATE_BODY));
+
+    body = cut_take_memory(g_malloc(body_size));
+    memset(body, 'X', body_size);
+
+    milter_agent_reset_write_statistics(agent);
+    cut_assert_true(milter_server_context_body(context, body, body_size));
+    cut_assert_equal_uint(1, milter_agent_get_n_writes(agent));
+
+    cut_trace(wait_for_receiving_streamed_commands(&n_received_bodies,
+                                                   n_packets));
+    cut_assert_equal_uint(body_size, received_body_size);
+    /* 16 packets by the first write and the rest 4 packets by
+     * the next write after the first write is flushed. */
+    cut_assert_equal_uint(2, milter_agent_get_n_writes(agent));
+}
+
 void
 test_status (void)
 {
@@ -802,6 +1015,61 @@ test_macros_hash_table (void)
         milter_protocol_agent_get_available_macros(agent));
 }
 
+void
+test_share_macros_hash_table (void)
+{
+    MilterProtocolAgent *agent;
+    GHashTable *shared_macros;
+
+    agent = MILTER_PROTOCOL_AGENT(context);
+    milter_protocol_agent_set_macro_context(agent, MILTER_COMMAND_CONNECT);
+
+    shared_macros =
+        gcut_take_new_hash_table_string_string("if_name", "localhost",
+                                               NULL);
+    milter_protocol_agent_share_macros_hash_table(agent,
+                                                  MILTER_COMMAND_CONNECT,
+                                                  shared_macros);
+    cut_assert_true(milter_protocol_agent_is_shared_macros(
+                        agent, MILTER_COMMAND_CONNECT));
+    cut_assert_equal_pointer(shared_macros,
+                             milter_protocol_agent_get_macros(agent));
+
+    milter_protocol_agent_set_macro(agent, MILTER_COMMAND_CONNECT,
+                                    "if_addr", "IPv6:::1");
+    cut_assert_false(milter_protocol_agent_is_shared_macros(
+                         agent, MILTER_COMMAND_CONNECT));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          "if_addr", "IPv6:::1",
+                                          NULL),
+        milter_protocol_agent_get_available_macros(agent));
+    gcut_assert_equal_hash_table_string_string(
+        gcut_hash_table_string_string_new("if_name", "localhost",
+                                          NULL),
+        shared_macros);
+}
+
+void
+test_reuse_codecs (void)
+{
+    MilterServerContext *finished_context, *new_context;
+    MilterDecoder *decoder;
+    MilterEncoder *encoder;
+
+    finished_context = milter_server_context_new();
+    decoder = milter_agent_get_decoder(MILTER_AGENT(finished_context));
+    encoder = milter_agent_get_encoder(MILTER_AGENT(finished_context));
+    g_object_unref(finished_context);
+
+    new_context = milter_server_context_new();
+    gcut_take_object(G_OBJECT(new_context));
+    cut_assert_equal_pointer(decoder,
+                             milter_agent_get_decoder(MILTER_AGENT(new_context)));
+    cut_assert_equal_pointer(encoder,
+                             milter_agent_get_encoder(MILTER_AGENT(new_context)));
+}
+
 void
 data_has_accepted_recipient (void)
 {